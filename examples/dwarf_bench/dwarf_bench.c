@@ -0,0 +1,1629 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "common/elf_core.h"
+#include "reader/elf_reader.h"
+#include "dwarf/elf_dwarf.h"
+#include "dwarf/dwarf_leb128.h"
+#include "dwarf/dwarf_consts.h"
+
+/*
+ * Throughput benchmarks of the DWARF module.
+ *
+ * The whole file is loaded in memory before timing so the numbers measure the
+ * parsers and not the storage. Every benchmark repeats its work until at least
+ * MIN_SECONDS have elapsed.
+ *
+ * Build (from the repository root):
+ *   cc -O2 -Isrc examples/dwarf_bench/dwarf_bench.c src/reader/elf_reader.c src/dwarf/elf_dwarf.c src/dwarf/dwarf_*.c -lpthread -o dwarf_bench
+ */
+
+#define MIN_SECONDS 1.0
+
+typedef struct
+{
+    const uint8_t *data;
+    uint64_t size;
+} MemFile;
+
+static MemFile g_file;
+
+static ElfResult mem_read_cb(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+    MemFile *f = (MemFile *)user_ctx;
+
+    if ((offset > f->size) || (size > f->size - offset))
+        return ELF_IO_EOF;
+
+    memcpy(buffer, f->data + offset, size);
+    return ELF_OK;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int load_file(const char *path, MemFile *f)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        perror("fopen");
+        return 1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    uint8_t *data = malloc(size > 0 ? (size_t)size : 1);
+    if (!data || fread(data, 1, (size_t)size, fp) != (size_t)size)
+    {
+        fprintf(stderr, "failed to read %s\n", path);
+        fclose(fp);
+        free(data);
+        return 1;
+    }
+
+    fclose(fp);
+    f->data = data;
+    f->size = (uint64_t)size;
+    return 0;
+}
+
+/* Walks every unit of .debug_info, counting DIEs. */
+static DwrfResult walk_units(DwrfCtx *dwarf, uint64_t *units, uint64_t *dies)
+{
+    DwrfUnitHeader unit;
+    uint64_t off = 0;
+    DwrfResult res;
+
+    *units = 0;
+    *dies = 0;
+    while ((res = dwarf_get_unit_header(dwarf, off, &unit)) == DWRF_OK)
+    {
+        uint64_t n;
+        res = dwarf_unit_count_dies(dwarf, &unit, &n);
+        if (res != DWRF_OK)
+            return res;
+
+        *dies += n;
+        (*units)++;
+        off = unit.NextOffset;
+    }
+
+    /* BAD_ARG marks the end of the section */
+    return (res == DWRF_BAD_ARG) ? DWRF_OK : res;
+}
+
+/* Positions a cursor on every unit, which parses (or fetches from the cache) its abbreviation table. */
+static DwrfResult load_abbrevs(DwrfCtx *dwarf)
+{
+    DwrfCursor cur;
+    DwrfUnitHeader unit;
+    uint64_t off = 0;
+    DwrfResult res;
+
+    dwarf_cursor_init(dwarf, &cur);
+    while ((res = dwarf_get_unit_header(dwarf, off, &unit)) == DWRF_OK)
+    {
+        res = dwarf_cursor_seek_unit(&cur, off);
+        if (res != DWRF_OK)
+            return res;
+        off = unit.NextOffset;
+    }
+    return (res == DWRF_BAD_ARG) ? DWRF_OK : res;
+}
+
+/*
+ * Abbreviation parsing: a fresh context per pass so every table is parsed again.
+ * DIE skipping: walk of every unit with all the tables already cached.
+ */
+static int bench_abbrev(const ElfCtx *elf)
+{
+    DwrfCtx dwarf;
+    DwrfStats stats;
+    uint64_t units, dies;
+    uint64_t iters = 0;
+    double start, elapsed;
+
+    start = now_seconds();
+    do
+    {
+        if ((dwarf_init(elf, &dwarf) != DWRF_OK) || (load_abbrevs(&dwarf) != DWRF_OK))
+        {
+            fprintf(stderr, "failed to load the abbreviation tables\n");
+            return 1;
+        }
+        dwarf_get_stats(&dwarf, &stats);
+        dwarf_destroy(&dwarf);
+        iters++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_SECONDS);
+
+    printf("abbrev:   %" PRIu64 " tables, %" PRIu64 " abbrevs, %.0f abbrevs parsed/sec\n",
+           stats.AbbrevTables, stats.Abbrevs, (double)(stats.Abbrevs * iters) / elapsed);
+
+    dwarf_init(elf, &dwarf);
+    if (walk_units(&dwarf, &units, &dies) != DWRF_OK)
+    {
+        fprintf(stderr, "failed to walk .debug_info\n");
+        dwarf_destroy(&dwarf);
+        return 1;
+    }
+
+    iters = 0;
+    start = now_seconds();
+    do
+    {
+        walk_units(&dwarf, &units, &dies);
+        iters++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_SECONDS);
+
+    printf("skip:     %" PRIu64 " units, %" PRIu64 " DIEs, %.0f DIEs skipped/sec\n",
+           units, dies, (double)(dies * iters) / elapsed);
+
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+/* Full .debug_info scan with the streaming cursor, one DIE at a time. */
+static double scan_pass(DwrfCtx *dwarf, uint64_t *dies)
+{
+    DwrfCursor cur;
+    DwrfDie die;
+    uint64_t n = 0;
+    double start = now_seconds();
+
+    dwarf_cursor_init(dwarf, &cur);
+    while (dwarf_cursor_next(&cur, &die) == DWRF_OK)
+        n++;
+
+    *dies = n;
+    return now_seconds() - start;
+}
+
+static int bench_scan(const ElfCtx *elf)
+{
+    DwrfCtx dwarf;
+    ElfSecHeader info;
+    uint64_t dies = 0;
+
+    if (get_section_by_name(elf, (const uint8_t *)".debug_info", &info) != ELF_OK)
+    {
+        fprintf(stderr, "no .debug_info\n");
+        return 1;
+    }
+
+    for (int mapped = 0; mapped < 2; mapped++)
+    {
+        uint64_t iters = 0;
+        double elapsed = 0;
+
+        if (dwarf_init(elf, &dwarf) != DWRF_OK)
+        {
+            fprintf(stderr, "dwarf_init failed\n");
+            return 1;
+        }
+
+        if (mapped)
+            dwarf_set_image(&dwarf, g_file.data, g_file.size);
+
+        scan_pass(&dwarf, &dies); // warm up the abbreviation cache
+        do
+        {
+            elapsed += scan_pass(&dwarf, &dies);
+            iters++;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("scan:     %-8s %" PRIu64 " DIEs, %.0f DIEs/sec, %.1f MB/s of .debug_info\n",
+               mapped ? "mapped" : "window", dies,
+               (double)(dies * iters) / elapsed, (double)(info.Size * iters) / elapsed / 1e6);
+        dwarf_destroy(&dwarf);
+    }
+    return 0;
+}
+
+/*
+ * LEB128 decoding on the values of the file: every ULEB128 of .debug_abbrev plus the
+ * numeric attributes of the DIEs (decl_line, byte_size...), and as SLEB128 the deltas
+ * between consecutive decl_line values, which look like line program advances.
+ * The library decoders are compared with the byte at a time loops they replaced.
+ */
+
+typedef struct
+{
+    uint8_t *data;
+    uint64_t size;
+    uint64_t cap;
+    uint64_t count;
+} LebStream;
+
+static int ref_uleb(const uint8_t *p, uint64_t *val, uint8_t *len)
+{
+    uint8_t byte, shift = 0, count = 0;
+
+    *val = 0;
+    do
+    {
+        byte = *p++;
+        uint64_t temp = (uint64_t)(byte & 0x7F);
+        count++;
+        if ((shift > 63) || ((temp << shift) >> shift != temp))
+            return 1;
+        *val |= temp << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    *len = count;
+    return 0;
+}
+
+static int ref_sleb(const uint8_t *p, int64_t *val, uint8_t *len)
+{
+    uint8_t byte, shift = 0, count = 0;
+
+    *val = 0;
+    do
+    {
+        byte = *p++;
+        uint64_t temp = (uint64_t)(byte & 0x7F);
+        count++;
+        if ((shift > 63) || ((temp << shift) >> shift != temp))
+            return 1;
+        *val |= temp << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    if ((shift < 64) && (byte & 0x40))
+        *val |= (int64_t)((~0ULL) << shift);
+
+    *len = count;
+    return 0;
+}
+
+static void leb_push(LebStream *s, uint64_t v, int is_signed)
+{
+    if (s->size + 16 > s->cap)
+    {
+        s->cap = s->cap ? s->cap * 2 : 4096;
+        s->data = realloc(s->data, s->cap);
+    }
+
+    int more = 1;
+    while (more)
+    {
+        uint8_t byte = v & 0x7F;
+        if (is_signed)
+        {
+            v = (uint64_t)((int64_t)v >> 7);
+            more = !(((v == 0) && !(byte & 0x40)) || ((v == ~0ULL) && (byte & 0x40)));
+        }
+        else
+        {
+            v >>= 7;
+            more = (v != 0);
+        }
+        s->data[s->size++] = byte | (more ? 0x80 : 0);
+    }
+    s->count++;
+}
+
+static int leb_corpus(const ElfCtx *elf, LebStream *u, LebStream *sl)
+{
+    static const uint16_t names[] = {
+        DW_AT_decl_line, DW_AT_decl_file, DW_AT_decl_column, DW_AT_byte_size,
+        DW_AT_data_member_location, DW_AT_call_line, DW_AT_upper_bound,
+    };
+    DwrfAttr attrs[sizeof(names) / sizeof(names[0])];
+    ElfSecHeader abbrev;
+    DwrfCtx dwarf;
+    DwrfCursor cur;
+    uint64_t v, prev_line = 0;
+    int64_t sv;
+    uint8_t len;
+
+    if (get_section_by_name(elf, (const uint8_t *)".debug_abbrev", &abbrev) != ELF_OK)
+        return 1;
+
+    /* code, tag, children, (name, form [, implicit const])*, 0, 0 */
+    const uint8_t *p = g_file.data + abbrev.Offset;
+    const uint8_t *end = p + abbrev.Size;
+    while (p < end)
+    {
+        ref_uleb(p, &v, &len), p += len, leb_push(u, v, 0);
+        if (v == 0)
+            continue;
+        ref_uleb(p, &v, &len), p += len, leb_push(u, v, 0);
+        p++;
+        for (;;)
+        {
+            uint64_t name, form;
+            ref_uleb(p, &name, &len), p += len, leb_push(u, name, 0);
+            ref_uleb(p, &form, &len), p += len, leb_push(u, form, 0);
+            if (form == DW_FORM_implicit_const)
+                ref_sleb(p, &sv, &len), p += len, leb_push(sl, (uint64_t)sv, 1);
+            if ((name == 0) && (form == 0))
+                break;
+        }
+    }
+
+    if (dwarf_init(elf, &dwarf) != DWRF_OK)
+        return 1;
+
+    dwarf_cursor_init(&dwarf, &cur);
+    while (dwarf_cursor_next(&cur, NULL) == DWRF_OK)
+    {
+        dwarf_cursor_get_attrs(&cur, names, sizeof(names) / sizeof(names[0]), attrs);
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        {
+            if ((attrs[i].Form == 0) || attrs[i].Size)
+                continue;
+
+            leb_push(u, attrs[i].Value, 0);
+            if (names[i] == DW_AT_decl_line)
+            {
+                leb_push(sl, attrs[i].Value - prev_line, 1);
+                prev_line = attrs[i].Value;
+            }
+        }
+    }
+    dwarf_destroy(&dwarf);
+
+    /* padding so the reference loops can't run past the end */
+    memset(u->data + u->size, 0, 16);
+    memset(sl->data + sl->size, 0, 16);
+    return 0;
+}
+
+typedef uint64_t (*LebPass)(const LebStream *s, uint64_t *vals);
+
+static uint64_t uleb_ref_pass(const LebStream *s, uint64_t *vals)
+{
+    const uint8_t *p = s->data;
+    uint64_t sum = 0, v;
+    uint8_t len;
+
+    (void)vals;
+    for (uint64_t i = 0; i < s->count; i++)
+    {
+        if (ref_uleb(p, &v, &len))
+            break;
+        p += len;
+        sum += v;
+    }
+    return sum;
+}
+
+static uint64_t uleb_fast_pass(const LebStream *s, uint64_t *vals)
+{
+    const uint8_t *p = s->data;
+    const uint8_t *end = s->data + s->size;
+    uint64_t sum = 0, v;
+    uint8_t len;
+
+    (void)vals;
+    for (uint64_t i = 0; i < s->count; i++)
+    {
+        if (dwarf_decode_uleb128(p, end, &v, &len))
+            break;
+        p += len;
+        sum += v;
+    }
+    return sum;
+}
+
+static uint64_t uleb_batch_pass(const LebStream *s, uint64_t *vals)
+{
+    uint64_t sum = 0;
+    size_t used;
+
+    dwarf_decode_uleb128_batch(s->data, s->data + s->size, vals, s->count, &used);
+    for (uint64_t i = 0; i < s->count; i++)
+        sum += vals[i];
+    return sum;
+}
+
+static uint64_t sleb_ref_pass(const LebStream *s, uint64_t *vals)
+{
+    const uint8_t *p = s->data;
+    uint64_t sum = 0;
+    int64_t v;
+    uint8_t len;
+
+    (void)vals;
+    for (uint64_t i = 0; i < s->count; i++)
+    {
+        if (ref_sleb(p, &v, &len))
+            break;
+        p += len;
+        sum += (uint64_t)v;
+    }
+    return sum;
+}
+
+static uint64_t sleb_fast_pass(const LebStream *s, uint64_t *vals)
+{
+    const uint8_t *p = s->data;
+    const uint8_t *end = s->data + s->size;
+    uint64_t sum = 0;
+    int64_t v;
+    uint8_t len;
+
+    (void)vals;
+    for (uint64_t i = 0; i < s->count; i++)
+    {
+        if (dwarf_decode_sleb128(p, end, &v, &len))
+            break;
+        p += len;
+        sum += (uint64_t)v;
+    }
+    return sum;
+}
+
+static uint64_t sleb_batch_pass(const LebStream *s, uint64_t *vals)
+{
+    uint64_t sum = 0;
+    size_t used;
+
+    dwarf_decode_sleb128_batch(s->data, s->data + s->size, (int64_t *)vals, s->count, &used);
+    for (uint64_t i = 0; i < s->count; i++)
+        sum += vals[i];
+    return sum;
+}
+
+static int bench_leb(const ElfCtx *elf)
+{
+    static const struct
+    {
+        const char *name;
+        int is_signed;
+        LebPass pass;
+    } passes[] = {
+        {"loop", 0, uleb_ref_pass}, {"fast", 0, uleb_fast_pass}, {"batch", 0, uleb_batch_pass},
+        {"loop", 1, sleb_ref_pass}, {"fast", 1, sleb_fast_pass}, {"batch", 1, sleb_batch_pass},
+    };
+    LebStream streams[2] = {{0}, {0}};
+    uint64_t expected[2] = {0, 0};
+    uint64_t *vals;
+    int ret = 0;
+
+    if (leb_corpus(elf, &streams[0], &streams[1]))
+    {
+        fprintf(stderr, "failed to collect LEB128 values\n");
+        return 1;
+    }
+
+    vals = malloc((streams[0].count + streams[1].count + 1) * sizeof(uint64_t));
+    for (size_t i = 0; i < sizeof(passes) / sizeof(passes[0]); i++)
+    {
+        const LebStream *s = &streams[passes[i].is_signed];
+        uint64_t iters = 0, sum;
+        double start = now_seconds(), elapsed;
+
+        do
+        {
+            sum = passes[i].pass(s, vals);
+            iters++;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        if (passes[i].pass == uleb_ref_pass || passes[i].pass == sleb_ref_pass)
+            expected[passes[i].is_signed] = sum;
+        else if (sum != expected[passes[i].is_signed])
+        {
+            fprintf(stderr, "%s %s: checksum mismatch\n", passes[i].is_signed ? "sleb" : "uleb", passes[i].name);
+            ret = 1;
+        }
+
+        printf("leb:      %s %-5s %" PRIu64 " values (%.2f bytes avg), %.0f values/sec\n",
+               passes[i].is_signed ? "sleb" : "uleb", passes[i].name, s->count,
+               s->count ? (double)s->size / (double)s->count : 0.0, (double)(s->count * iters) / elapsed);
+    }
+
+    free(vals);
+    free(streams[0].data);
+    free(streams[1].data);
+    return ret;
+}
+
+/* Line table of the whole file, built with one thread and with one per CPU, then address lookups. */
+static int bench_line(const ElfCtx *elf)
+{
+    static const uint32_t threads[] = {1, 0};
+    DwrfCtx dwarf;
+    DwrfLineTable *table = NULL;
+    const DwrfLineRow *rows, *row;
+    uint64_t count = 0, found = 0;
+
+    if ((dwarf_init(elf, &dwarf) != DWRF_OK) || (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        return 1;
+    }
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+    {
+        uint64_t iters = 0;
+        double elapsed = 0;
+
+        do
+        {
+            double start = now_seconds();
+            DwrfResult res = dwarf_line_table_all(&dwarf, threads[t], &table);
+            elapsed += now_seconds() - start;
+
+            if (res != DWRF_OK)
+            {
+                fprintf(stderr, "failed to build the line table: %d\n", res);
+                dwarf_destroy(&dwarf);
+                return 1;
+            }
+
+            dwarf_line_rows(table, &rows, &count);
+            iters++;
+            if (elapsed < MIN_SECONDS)
+                dwarf_line_table_destroy(table);
+        } while (elapsed < MIN_SECONDS);
+
+        printf("line:     %-8s %" PRIu64 " rows, %.0f rows/sec\n",
+               threads[t] ? "1 thread" : "all cpus", count, (double)(count * iters) / elapsed);
+        if (t + 1 < sizeof(threads) / sizeof(threads[0]))
+            dwarf_line_table_destroy(table);
+    }
+
+    /* lookups of pseudo random row addresses */
+    if (count)
+    {
+        uint64_t iters = 0, x = 88172645463325252ULL;
+        double start = now_seconds(), elapsed;
+
+        do
+        {
+            for (int i = 0; i < 1000; i++)
+            {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                found += (dwarf_line_lookup(table, rows[x % count].Address, &row) == DWRF_OK);
+            }
+            iters += 1000;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("line:     lookup   %.0f lookups/sec (%.1f%% found)\n",
+               (double)iters / elapsed, 100.0 * (double)found / (double)iters);
+    }
+
+    dwarf_line_table_destroy(table);
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+static int bench_addr(const ElfCtx *elf)
+{
+    DwrfCtx dwarf;
+    DwrfAddrIndex *index = NULL;
+    const DwrfAddrRange *ranges;
+    uint64_t count = 0, iters = 0, found = 0, unit;
+    double elapsed = 0;
+
+    if ((dwarf_init(elf, &dwarf) != DWRF_OK) || (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        return 1;
+    }
+
+    do
+    {
+        double start = now_seconds();
+        DwrfResult res = dwarf_addr_index_build(&dwarf, &index);
+        elapsed += now_seconds() - start;
+
+        if (res != DWRF_OK)
+        {
+            fprintf(stderr, "failed to build the address index: %d\n", res);
+            dwarf_destroy(&dwarf);
+            return 1;
+        }
+
+        dwarf_addr_index_ranges(index, &ranges, &count);
+        iters++;
+        if (elapsed < MIN_SECONDS)
+            dwarf_addr_index_destroy(index);
+    } while (elapsed < MIN_SECONDS);
+
+    printf("addr:     build    %" PRIu64 " ranges, %.0f builds/sec\n", count, (double)iters / elapsed);
+
+    /* lookups of pseudo random addresses spread over the indexed span */
+    if (count)
+    {
+        uint64_t x = 88172645463325252ULL, low = ranges[0].Low, span = ranges[count - 1].High - low;
+        double start = now_seconds();
+
+        iters = 0;
+        do
+        {
+            for (int i = 0; i < 1000; i++)
+            {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                found += (dwarf_addr_index_lookup(index, low + x % span, &unit) == DWRF_OK);
+            }
+            iters += 1000;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("addr:     lookup   %.0f lookups/sec (%.1f%% found)\n",
+               (double)iters / elapsed, 100.0 * (double)found / (double)iters);
+    }
+
+    dwarf_addr_index_destroy(index);
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+/* Names of the functions of the file, the queries of the name index benchmark */
+#define NAME_QUERIES 4096
+
+static uint32_t collect_names(DwrfCtx *dwarf, char (*names)[128])
+{
+    DwrfCursor cur;
+    DwrfDie die;
+    DwrfAttr attr;
+    uint32_t count = 0;
+
+    dwarf_cursor_init(dwarf, &cur);
+    while ((count < NAME_QUERIES) && (dwarf_cursor_next(&cur, &die) == DWRF_OK))
+    {
+        if ((die.Tag == DW_TAG_subprogram) && (dwarf_cursor_get_attr(&cur, DW_AT_name, &attr) == DWRF_OK) &&
+            (dwarf_cursor_resolve(&cur, &attr) == DWRF_OK) && (dwarf_get_string(dwarf, &attr, (uint8_t *)names[count], sizeof(names[0])) == DWRF_OK))
+            count++;
+    }
+    return count;
+}
+
+static int bench_names(const ElfCtx *elf)
+{
+    static const uint32_t threads[] = {1, 0};
+    static char names[NAME_QUERIES][128];
+    DwrfCtx dwarf;
+    DwrfNameIndex *index = NULL;
+    DwrfNameEntry entries[16];
+    uint64_t count = 0, found = 0;
+    uint32_t queries, matches;
+
+    if ((dwarf_init(elf, &dwarf) != DWRF_OK) || (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        return 1;
+    }
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+    {
+        uint64_t iters = 0;
+        double elapsed = 0;
+
+        do
+        {
+            double start = now_seconds();
+            DwrfResult res = dwarf_name_index_build(&dwarf, threads[t], &index);
+            elapsed += now_seconds() - start;
+
+            if (res != DWRF_OK)
+            {
+                fprintf(stderr, "failed to build the name index: %d\n", res);
+                dwarf_destroy(&dwarf);
+                return 1;
+            }
+
+            dwarf_name_index_size(index, &count);
+            iters++;
+            if ((elapsed < MIN_SECONDS) || (t + 1 < sizeof(threads) / sizeof(threads[0])))
+                dwarf_name_index_destroy(index);
+        } while (elapsed < MIN_SECONDS);
+
+        printf("names:    %-8s %" PRIu64 " names, %.1f ms per build\n",
+               threads[t] ? "1 thread" : "all cpus", count, 1e3 * elapsed / (double)iters);
+    }
+
+    queries = collect_names(&dwarf, names);
+    if (queries)
+    {
+        uint64_t iters = 0;
+        double start = now_seconds(), elapsed;
+
+        do
+        {
+            for (uint32_t i = 0; i < queries; i++)
+            {
+                DwrfResult res = dwarf_name_index_find(index, names[i], entries, 16, &matches);
+                found += (res == DWRF_OK) || (res == DWRF_BUFFER_OVERFLOW);
+            }
+            iters += queries;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("names:    lookup   %.0f lookups/sec (%.1f%% found)\n",
+               (double)iters / elapsed, 100.0 * (double)found / (double)iters);
+    }
+
+    dwarf_name_index_destroy(index);
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+static int bench_gdb_index(const ElfCtx *elf)
+{
+    static char names[NAME_QUERIES][128];
+    DwrfCtx dwarf;
+    DwrfGdbIndex *index = NULL;
+    DwrfGdbIndexInfo info;
+    DwrfGdbSymbol symbols[16];
+    DwrfNameEntry entries[16];
+    uint64_t iters = 0, found = 0;
+    uint32_t queries, matches;
+    double start, elapsed = 0;
+    DwrfResult res;
+
+    if ((dwarf_init(elf, &dwarf) != DWRF_OK) || (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        return 1;
+    }
+
+    do
+    {
+        start = now_seconds();
+        res = dwarf_gdb_index_open(&dwarf, &index);
+        elapsed += now_seconds() - start;
+
+        if (res == DWRF_SEC_MISSING)
+        {
+            printf("gdbindex: no .gdb_index\n");
+            dwarf_destroy(&dwarf);
+            return 0;
+        }
+        if (res != DWRF_OK)
+        {
+            fprintf(stderr, "failed to open .gdb_index: %d\n", res);
+            dwarf_destroy(&dwarf);
+            return 1;
+        }
+
+        iters++;
+        if (elapsed < MIN_SECONDS)
+            dwarf_gdb_index_destroy(index);
+    } while (elapsed < MIN_SECONDS);
+
+    dwarf_gdb_index_info(index, &info);
+    printf("gdbindex: v%u, %u units, %u symbols, %.3f ms per open\n", info.Version, info.Units, info.Symbols,
+           1e3 * elapsed / (double)iters);
+
+    queries = collect_names(&dwarf, names);
+    for (int dies = 0; queries && (dies < 2); dies++)
+    {
+        iters = 0;
+        found = 0;
+        start = now_seconds();
+        do
+        {
+            for (uint32_t i = 0; i < queries; i++)
+            {
+                res = dies ? dwarf_gdb_index_find_dies(index, names[i], entries, 16, &matches)
+                           : dwarf_gdb_index_find(index, names[i], symbols, 16, &matches);
+                found += (res == DWRF_OK) || (res == DWRF_BUFFER_OVERFLOW);
+            }
+            iters += queries;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("gdbindex: %-8s %.0f lookups/sec (%.1f%% found)\n", dies ? "dies" : "units", (double)iters / elapsed,
+               100.0 * (double)found / (double)iters);
+    }
+
+    dwarf_gdb_index_destroy(index);
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+/* Attributes that use the indexed forms in DWARF 5 output */
+static const uint16_t indexed_attrs[] = { DW_AT_name, DW_AT_linkage_name, DW_AT_low_pc, DW_AT_high_pc, DW_AT_ranges, DW_AT_location };
+#define INDEXED_ATTRS (sizeof(indexed_attrs) / sizeof(indexed_attrs[0]))
+#define INDEXED_MAX   (1u << 20)
+
+typedef struct
+{
+    uint64_t unit;
+    DwrfAttr attr;
+} IndexedValue;
+
+static int is_indexed(uint16_t form)
+{
+    return ((form >= DW_FORM_strx1) && (form <= DW_FORM_addrx4)) || (form == DW_FORM_strx) ||
+           (form == DW_FORM_addrx) || (form == DW_FORM_rnglistx) || (form == DW_FORM_loclistx);
+}
+
+static int bench_forms(const ElfCtx *elf)
+{
+    DwrfCtx dwarf;
+    DwrfCursor cur;
+    DwrfDie die;
+    DwrfAttr attrs[INDEXED_ATTRS];
+    IndexedValue *values;
+    uint64_t count = 0, iters = 0, failed = 0;
+    double start, elapsed;
+
+    values = malloc(INDEXED_MAX * sizeof(IndexedValue));
+    if ((values == NULL) || (dwarf_init(elf, &dwarf) != DWRF_OK) ||
+        (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        free(values);
+        return 1;
+    }
+
+    /* values are collected in file order, so they are grouped by unit */
+    dwarf_cursor_init(&dwarf, &cur);
+    while ((count < INDEXED_MAX) && (dwarf_cursor_next(&cur, &die) == DWRF_OK))
+    {
+        dwarf_cursor_get_attrs(&cur, indexed_attrs, INDEXED_ATTRS, attrs);
+        for (size_t i = 0; (i < INDEXED_ATTRS) && (count < INDEXED_MAX); i++)
+        {
+            if (is_indexed(attrs[i].Form))
+                values[count++] = (IndexedValue){ die.UnitOffset, attrs[i] };
+        }
+    }
+
+    if (count == 0)
+    {
+        printf("forms:    no indexed values\n");
+        free(values);
+        dwarf_destroy(&dwarf);
+        return 0;
+    }
+
+    start = now_seconds();
+    do
+    {
+        uint64_t unit = UINT64_MAX;
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+            DwrfAttr attr = values[i].attr;
+
+            if ((values[i].unit != unit) && (dwarf_cursor_seek_unit(&cur, values[i].unit) == DWRF_OK))
+                unit = values[i].unit;
+            failed += (dwarf_cursor_resolve(&cur, &attr) != DWRF_OK);
+        }
+        iters += count;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_SECONDS);
+
+    printf("forms:    resolve  %" PRIu64 " indexed values, %.0f resolves/sec (%.1f%% resolved)\n",
+           count, (double)iters / elapsed, 100.0 * (double)(iters - failed) / (double)iters);
+
+    free(values);
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+/* Range and location lists referenced from the DIEs, decoded cold and then from the list cache */
+static const uint16_t list_attrs[] = { DW_AT_ranges, DW_AT_location, DW_AT_frame_base };
+#define LIST_ATTRS (sizeof(list_attrs) / sizeof(list_attrs[0]))
+
+static int is_list(uint16_t form)
+{
+    return (form == DW_FORM_sec_offset) || (form == DW_FORM_rnglistx) || (form == DW_FORM_loclistx);
+}
+
+static uint64_t list_pass(DwrfCursor *cur, DwrfListCache *cache, const IndexedValue *values, uint64_t count,
+                          uint64_t *items)
+{
+    uint64_t unit = UINT64_MAX, failed = 0;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const DwrfRange *ranges;
+        const DwrfLocation *locs;
+        uint64_t n = 0;
+
+        if ((values[i].unit != unit) && (dwarf_cursor_seek_unit(cur, values[i].unit) == DWRF_OK))
+            unit = values[i].unit;
+
+        if (values[i].attr.Name == DW_AT_ranges)
+            failed += (dwarf_list_ranges(cache, cur, &values[i].attr, &ranges, &n) != DWRF_OK);
+        else
+            failed += (dwarf_list_locations(cache, cur, &values[i].attr, &locs, &n) != DWRF_OK);
+        *items += n;
+    }
+    return failed;
+}
+
+static int bench_lists(const ElfCtx *elf)
+{
+    DwrfCtx dwarf;
+    DwrfCursor cur;
+    DwrfDie die;
+    DwrfAttr attrs[LIST_ATTRS];
+    DwrfListCache *cache = NULL;
+    DwrfListCacheStats stats;
+    IndexedValue *values;
+    uint64_t count = 0;
+    double start, elapsed;
+
+    values = malloc(INDEXED_MAX * sizeof(IndexedValue));
+    if ((values == NULL) || (dwarf_init(elf, &dwarf) != DWRF_OK) ||
+        (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        free(values);
+        return 1;
+    }
+
+    dwarf_cursor_init(&dwarf, &cur);
+    while ((count < INDEXED_MAX) && (dwarf_cursor_next(&cur, &die) == DWRF_OK))
+    {
+        dwarf_cursor_get_attrs(&cur, list_attrs, LIST_ATTRS, attrs);
+        for (size_t i = 0; (i < LIST_ATTRS) && (count < INDEXED_MAX); i++)
+        {
+            if (is_list(attrs[i].Form))
+                values[count++] = (IndexedValue){ die.UnitOffset, attrs[i] };
+        }
+    }
+
+    if (count == 0)
+    {
+        printf("lists:    no range or location lists\n");
+        free(values);
+        dwarf_destroy(&dwarf);
+        return 0;
+    }
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        uint64_t iters = 0, items = 0, failed = 0;
+
+        start = now_seconds();
+        do
+        {
+            /* the cold pass starts every iteration from an empty cache */
+            if ((pass == 0) || (cache == NULL))
+            {
+                dwarf_list_cache_destroy(cache);
+                if (dwarf_list_cache_create(&cache) != DWRF_OK)
+                {
+                    fprintf(stderr, "failed to create the list cache\n");
+                    free(values);
+                    dwarf_destroy(&dwarf);
+                    return 1;
+                }
+            }
+
+            failed += list_pass(&cur, cache, values, count, &items);
+            iters += count;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("lists:    %-6s %" PRIu64 " lists, %.0f lists/sec, %.1f entries per list (%.1f%% decoded)\n",
+               pass ? "cached" : "cold", count, (double)iters / elapsed, (double)items / (double)iters,
+               100.0 * (double)(iters - failed) / (double)iters);
+    }
+
+    dwarf_list_cache_stats(cache, &stats);
+    printf("lists:    cache  %" PRIu64 " distinct lists in %" PRIu64 " KiB\n", stats.Misses, stats.Bytes / 1024);
+
+    dwarf_list_cache_destroy(cache);
+    free(values);
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+/* Location expressions of the DIEs and their location lists, compiled cold and then from the expression cache */
+static const uint16_t expr_attrs[] = { DW_AT_location, DW_AT_frame_base };
+#define EXPR_ATTRS (sizeof(expr_attrs) / sizeof(expr_attrs[0]))
+
+typedef struct
+{
+    uint64_t unit;
+    DwrfAttr attr;              // exprloc attribute, or a location list entry when expr is set
+    const uint8_t *expr;
+    uint64_t len;
+} ExprValue;
+
+static DwrfResult expr_reg(void *user, uint32_t reg, uint64_t *value)
+{
+    (void)user;
+    *value = 0x7ff000000000ull + reg * 8;
+    return DWRF_OK;
+}
+
+static DwrfResult expr_mem(void *user, uint64_t addr, void *buff, uint32_t size)
+{
+    (void)user;
+    memset(buff, (int)(addr & 0xff), size);
+    return DWRF_OK;
+}
+
+static uint64_t expr_pass(DwrfCursor *cur, DwrfExprCache *cache, const ExprValue *values, uint64_t count)
+{
+    static const DwrfExprEnv env = { expr_reg, expr_mem, NULL, NULL, NULL, 0, 0x7ff000001000ull, 0x7ff000002000ull,
+                                     0, 0, 1, 1, 0, 0 };
+    uint64_t unit = UINT64_MAX, failed = 0;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const DwrfExpr *expr;
+        DwrfLocPiece pieces[8];
+        uint32_t n;
+        DwrfResult res;
+
+        if ((values[i].unit != unit) && (dwarf_cursor_seek_unit(cur, values[i].unit) == DWRF_OK))
+            unit = values[i].unit;
+
+        if (values[i].expr != NULL)
+            res = dwarf_expr_compile(cache, cur, values[i].expr, values[i].len, &expr);
+        else
+            res = dwarf_expr_compile_attr(cache, cur, &values[i].attr, &expr);
+        if (res == DWRF_OK)
+            res = dwarf_expr_eval(expr, &env, pieces, 8, &n);
+        failed += (res != DWRF_OK);
+    }
+    return failed;
+}
+
+static int bench_expr(const ElfCtx *elf)
+{
+    DwrfCtx dwarf;
+    DwrfCursor cur;
+    DwrfDie die;
+    DwrfAttr attrs[EXPR_ATTRS];
+    DwrfListCache *lists = NULL;
+    DwrfExprCache *cache = NULL;
+    DwrfExprCacheStats stats;
+    ExprValue *values;
+    uint64_t count = 0;
+    double start, elapsed;
+
+    values = malloc(INDEXED_MAX * sizeof(ExprValue));
+    if ((values == NULL) || (dwarf_init(elf, &dwarf) != DWRF_OK) ||
+        (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK) || (dwarf_list_cache_create(&lists) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        free(values);
+        return 1;
+    }
+
+    dwarf_cursor_init(&dwarf, &cur);
+    while ((count < INDEXED_MAX) && (dwarf_cursor_next(&cur, &die) == DWRF_OK))
+    {
+        dwarf_cursor_get_attrs(&cur, expr_attrs, EXPR_ATTRS, attrs);
+        for (size_t i = 0; (i < EXPR_ATTRS) && (count < INDEXED_MAX); i++)
+        {
+            const DwrfLocation *locs;
+            uint64_t n;
+
+            if (attrs[i].Form == DW_FORM_exprloc)
+                values[count++] = (ExprValue){ die.UnitOffset, attrs[i], NULL, 0 };
+            else if (is_list(attrs[i].Form) && (dwarf_list_locations(lists, &cur, &attrs[i], &locs, &n) == DWRF_OK))
+            {
+                for (uint64_t j = 0; (j < n) && (count < INDEXED_MAX); j++)
+                    values[count++] = (ExprValue){ die.UnitOffset, attrs[i], locs[j].Expr, locs[j].ExprLen };
+            }
+        }
+    }
+
+    if (count == 0)
+    {
+        printf("expr:     no location expressions\n");
+        dwarf_list_cache_destroy(lists);
+        free(values);
+        dwarf_destroy(&dwarf);
+        return 0;
+    }
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        uint64_t iters = 0, failed = 0;
+
+        start = now_seconds();
+        do
+        {
+            /* the cold pass decodes every expression again, the cached one only evaluates */
+            if ((pass == 0) || (cache == NULL))
+            {
+                dwarf_expr_cache_destroy(cache);
+                if (dwarf_expr_cache_create(&dwarf, &cache) != DWRF_OK)
+                {
+                    fprintf(stderr, "failed to create the expression cache\n");
+                    dwarf_list_cache_destroy(lists);
+                    free(values);
+                    dwarf_destroy(&dwarf);
+                    return 1;
+                }
+            }
+
+            failed += expr_pass(&cur, cache, values, count);
+            iters += count;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("expr:     %-6s %" PRIu64 " expressions, %.0f evaluations/sec (%.1f%% evaluated)\n",
+               pass ? "cached" : "cold", count, (double)iters / elapsed, 100.0 * (double)(iters - failed) / (double)iters);
+    }
+
+    dwarf_expr_cache_stats(cache, &stats);
+    printf("expr:     cache  %" PRIu64 " expressions, %.1f instructions each, %" PRIu64 " KiB\n", stats.Misses,
+           (double)stats.Insns / (double)(stats.Misses ? stats.Misses : 1), stats.Bytes / 1024);
+
+    dwarf_expr_cache_destroy(cache);
+    dwarf_list_cache_destroy(lists);
+    free(values);
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+/* Pseudo random addresses spread over the code described by the address index */
+#define SYM_ADDRS 1024
+
+static uint64_t sym_addrs(DwrfCtx *dwarf, uint64_t *addrs, uint64_t *units, uint64_t *unit_count)
+{
+    DwrfAddrIndex *index;
+    const DwrfAddrRange *ranges;
+    uint64_t count, x = 88172645463325252ULL;
+
+    *unit_count = 0;
+    if ((dwarf_addr_index_build(dwarf, &index) != DWRF_OK) || (dwarf_addr_index_ranges(index, &ranges, &count) != DWRF_OK))
+        return 0;
+
+    for (uint64_t i = 0; count && (i < SYM_ADDRS); i++)
+    {
+        const DwrfAddrRange *r;
+
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        r = &ranges[x % count];
+        addrs[i] = r->Low + (x >> 20) % (r->High - r->Low);
+    }
+
+    /* first address of every unit, the lookups that load it */
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t u = 0;
+        while ((u < *unit_count) && (units[2 * u] != ranges[i].UnitOffset))
+            u++;
+        if ((u == *unit_count) && (u < SYM_ADDRS))
+        {
+            units[2 * u] = ranges[i].UnitOffset;
+            units[2 * u + 1] = ranges[i].Low;
+            (*unit_count)++;
+        }
+    }
+
+    dwarf_addr_index_destroy(index);
+    return count ? SYM_ADDRS : 0;
+}
+
+static int bench_symbolize(const ElfCtx *elf)
+{
+    static uint64_t addrs[SYM_ADDRS], units[2 * SYM_ADDRS];
+    DwrfCtx dwarf;
+    DwrfSymbolizer *sym;
+    DwrfFrame frames[16];
+    uint64_t count, unit_count, iters = 0, found = 0;
+    uint32_t n;
+    double elapsed = 0, worst = 0;
+
+    if ((dwarf_init(elf, &dwarf) != DWRF_OK) || (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        return 1;
+    }
+
+    if ((count = sym_addrs(&dwarf, addrs, units, &unit_count)) == 0)
+    {
+        printf("symbolize: no address ranges\n");
+        dwarf_destroy(&dwarf);
+        return 0;
+    }
+
+    /* cold: the first lookup in each unit decodes its line table and scopes */
+    do
+    {
+        double start = now_seconds();
+        if (dwarf_symbolizer_create(&dwarf, 0, 0, &sym) != DWRF_OK)
+        {
+            fprintf(stderr, "failed to create the symbolizer\n");
+            dwarf_destroy(&dwarf);
+            return 1;
+        }
+        elapsed += now_seconds() - start;
+        iters++;
+
+        for (uint64_t u = 0; u < unit_count; u++)
+        {
+            double t = now_seconds();
+            dwarf_symbolize(sym, units[2 * u + 1], frames, 16, &n);
+            t = now_seconds() - t;
+            if (t > worst)
+                worst = t;
+        }
+        dwarf_symbolizer_destroy(sym);
+    } while (elapsed < MIN_SECONDS / 4);
+
+    printf("symbolize: create  %.3f ms, cold lookup up to %.3f ms (%" PRIu64 " units)\n",
+           elapsed * 1e3 / (double)iters, worst * 1e3, unit_count);
+
+    /* warm: units loaded, every lookup walks the segments and the line table */
+    dwarf_symbolizer_create(&dwarf, 0, 0, &sym);
+    for (uint64_t i = 0; i < count; i++)
+        dwarf_symbolize(sym, addrs[i], frames, 16, &n);
+
+    iters = 0;
+    elapsed = 0;
+    double start = now_seconds();
+    do
+    {
+        for (uint64_t i = 0; i < count; i++)
+            found += (dwarf_symbolize(sym, addrs[i], frames, 16, &n) != DWRF_NOT_FOUND);
+        iters += count;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_SECONDS);
+    dwarf_symbolizer_destroy(sym);
+
+    printf("symbolize: warm    %.0f lookups/sec (%.1f%% found)\n", (double)iters / elapsed,
+           100.0 * (double)found / (double)iters);
+
+    /* hot: answered by the result cache */
+    dwarf_symbolizer_create(&dwarf, 0, 4 * SYM_ADDRS, &sym);
+    iters = 0;
+    start = now_seconds();
+    do
+    {
+        for (uint64_t i = 0; i < count; i++)
+            dwarf_symbolize(sym, addrs[i], frames, 16, &n);
+        iters += count;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_SECONDS);
+    dwarf_symbolizer_destroy(sym);
+
+    printf("symbolize: hot     %.0f lookups/sec\n", (double)iters / elapsed);
+
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+/* Per unit result of bench_units, allocated in the worker arena. */
+typedef struct
+{
+    uint64_t dies;
+    uint64_t rows;
+} UnitCounts;
+
+static DwrfResult count_unit(DwrfCtx *ctx, const DwrfUnitHeader *unit, DwrfArena *arena, void *user, void **result)
+{
+    DwrfCursor cur;
+    DwrfDie die;
+    DwrfLineTable *table;
+    const DwrfLineRow *rows;
+    DwrfResult res;
+    UnitCounts *counts = dwarf_arena_alloc(arena, sizeof(UnitCounts));
+
+    (void)user;
+    if (!counts)
+        return DWRF_NO_MEM;
+
+    counts->dies = 0;
+    counts->rows = 0;
+
+    dwarf_cursor_init(ctx, &cur);
+    res = dwarf_cursor_seek_unit(&cur, unit->Offset);
+    while ((res == DWRF_OK) && ((res = dwarf_cursor_next(&cur, &die)) == DWRF_OK) && (die.UnitOffset == unit->Offset))
+        counts->dies++;
+    if ((res != DWRF_OK) && (res != DWRF_END))
+        return res;
+
+    if (dwarf_line_table_unit(ctx, unit, &table) == DWRF_OK)
+    {
+        dwarf_line_rows(table, &rows, &counts->rows);
+        dwarf_line_table_destroy(table);
+    }
+
+    *result = counts;
+    return DWRF_OK;
+}
+
+static DwrfResult sum_unit(void *user, const DwrfUnitHeader *unit, void *result)
+{
+    UnitCounts *total = (UnitCounts *)user;
+    const UnitCounts *counts = (const UnitCounts *)result;
+
+    (void)unit;
+    total->dies += counts->dies;
+    total->rows += counts->rows;
+    return DWRF_OK;
+}
+
+static int bench_units(const ElfCtx *elf)
+{
+    static const uint32_t threads[] = {1, 0};
+    DwrfCtx dwarf;
+
+    if ((dwarf_init(elf, &dwarf) != DWRF_OK) || (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        return 1;
+    }
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+    {
+        UnitCounts total;
+        uint64_t iters = 0;
+        double elapsed = 0;
+
+        do
+        {
+            total.dies = 0;
+            total.rows = 0;
+
+            double start = now_seconds();
+            DwrfResult res = dwarf_for_each_cu_parallel(&dwarf, threads[t], count_unit, sum_unit, &total);
+            elapsed += now_seconds() - start;
+
+            if (res != DWRF_OK)
+            {
+                fprintf(stderr, "failed to parse the units: %d\n", res);
+                dwarf_destroy(&dwarf);
+                return 1;
+            }
+            iters++;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("units:    %-8s %" PRIu64 " dies, %" PRIu64 " rows, %.2f ms per pass\n",
+               threads[t] ? "1 thread" : "all cpus", total.dies, total.rows, elapsed * 1e3 / (double)iters);
+    }
+
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+/* Pseudo random addresses inside the functions of .symtab, for files stripped of their DWARF */
+static uint64_t func_addrs(const ElfCtx *elf, uint64_t *addrs)
+{
+    ElfSymTabEntry *funcs = NULL;
+    uint64_t count = 0, x = 88172645463325252ULL;
+
+    for (uint32_t s = 1; (s < get_section_count(elf)) && (count == 0); s++)
+    {
+        ElfSecHeader sh;
+        uint32_t n;
+
+        if ((get_section_header(elf, s, &sh) != ELF_OK) || (sh.Type != SHT_SYMTAB))
+            continue;
+
+        n = get_symbol_count(elf, &sh);
+        funcs = malloc(((size_t)n + 1) * sizeof(ElfSymTabEntry));
+        if ((funcs == NULL) || (get_symbol_entries(elf, &sh, 0, n, funcs) != ELF_OK))
+            break;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if ((funcs[i].Type == STT_FUNC) && (funcs[i].Size != 0))
+                funcs[count++] = funcs[i];
+        }
+    }
+
+    for (uint64_t i = 0; count && (i < SYM_ADDRS); i++)
+    {
+        const ElfSymTabEntry *f;
+
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        f = &funcs[x % count];
+        addrs[i] = f->Value + (x >> 20) % f->Size;
+    }
+
+    free(funcs);
+    return count ? SYM_ADDRS : 0;
+}
+
+/*
+ * Unwind lookups of addresses spread over the code, interpreted and then from the precompiled rows.
+ * The call frames don't need .debug_info, without it the addresses come from the symbol table.
+ */
+static int bench_unwind(const ElfCtx *elf)
+{
+    static uint64_t addrs[SYM_ADDRS], units[2 * SYM_ADDRS];
+    DwrfCtx dwarf;
+    DwrfCfi *cfi;
+    DwrfCfiStats stats;
+    DwrfUnwindRow row;
+    uint64_t count = 0, unit_count, found;
+    double start, elapsed;
+
+    /* 6 is rbp on x86-64, the register only changes what the rows report */
+    if (dwarf_cfi_create(elf, 6, &cfi) != DWRF_OK)
+    {
+        printf("unwind:   no call frame information\n");
+        return 0;
+    }
+
+    if (dwarf_init(elf, &dwarf) == DWRF_OK)
+    {
+        count = sym_addrs(&dwarf, addrs, units, &unit_count);
+        dwarf_destroy(&dwarf);
+    }
+    if ((count == 0) && ((count = func_addrs(elf, addrs)) == 0))
+    {
+        printf("unwind:   no address ranges\n");
+        dwarf_cfi_destroy(cfi);
+        return 0;
+    }
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        uint64_t iters = 0;
+
+        if (pass == 1)
+        {
+            start = now_seconds();
+            if (dwarf_cfi_precompile(cfi) != DWRF_OK)
+            {
+                fprintf(stderr, "failed to precompile the rows\n");
+                break;
+            }
+            elapsed = now_seconds() - start;
+            dwarf_cfi_stats(cfi, &stats);
+            printf("unwind:   precompiled %" PRIu64 " FDEs into %" PRIu64 " rows (%" PRIu64 " KiB) in %.2f ms\n",
+                   stats.Fdes, stats.Rows, stats.RowBytes / 1024, elapsed * 1e3);
+        }
+
+        found = 0;
+        start = now_seconds();
+        do
+        {
+            for (uint64_t i = 0; i < count; i++)
+                found += (dwarf_cfi_find(cfi, addrs[i], &row) == DWRF_OK);
+            iters += count;
+            elapsed = now_seconds() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("unwind:   %-11s %.0f lookups/sec (%.1f%% found)\n", pass ? "precompiled" : "interpreted",
+               (double)iters / elapsed, 100.0 * (double)found / (double)iters);
+    }
+
+    dwarf_cfi_destroy(cfi);
+    return 0;
+}
+
+/* Type deduplication on one thread and on every CPU, then the size of the table and of its serialized form */
+static int bench_types(const ElfCtx *elf)
+{
+    static const uint32_t threads[] = {1, 0};
+    DwrfCtx dwarf;
+    DwrfTypeTable *table = NULL;
+    DwrfTypeTableStats stats;
+    uint64_t blob;
+
+    if ((dwarf_init(elf, &dwarf) != DWRF_OK) || (dwarf_set_image(&dwarf, g_file.data, g_file.size) != DWRF_OK))
+    {
+        fprintf(stderr, "dwarf_init failed\n");
+        return 1;
+    }
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+    {
+        uint64_t iters = 0;
+        double elapsed = 0;
+
+        do
+        {
+            dwarf_type_table_destroy(table);
+
+            double start = now_seconds();
+            DwrfResult res = dwarf_type_table_build(&dwarf, threads[t], &table);
+            elapsed += now_seconds() - start;
+
+            if (res != DWRF_OK)
+            {
+                fprintf(stderr, "failed to build the type table: %d\n", res);
+                dwarf_destroy(&dwarf);
+                return 1;
+            }
+            iters++;
+        } while (elapsed < MIN_SECONDS);
+
+        printf("types:    %-8s %.2f ms per build\n", threads[t] ? "1 thread" : "all cpus",
+               elapsed * 1e3 / (double)iters);
+    }
+
+    dwarf_type_table_stats(table, &stats);
+    dwarf_type_table_serialize(table, NULL, 0, &blob);
+    if (stats.InputTypes == 0)
+        printf("types:    no type entries\n");
+    else
+    {
+        printf("types:    %" PRIu64 " types, %" PRIu64 " members -> %" PRIu64 " types, %" PRIu64
+               " members (%.2fx), %" PRIu64 " declarations resolved in %u rounds\n",
+               stats.InputTypes, stats.InputMembers, stats.Types, stats.Members,
+               (double)stats.InputTypes / (double)(stats.Types ? stats.Types : 1), stats.Declarations, stats.Rounds);
+        printf("types:    %" PRIu64 " KiB -> %" PRIu64 " KiB (%.2fx), %" PRIu64 " KiB serialized, %" PRIu64
+               " KiB DIE map\n",
+               stats.InputBytes / 1024, stats.Bytes / 1024, (double)stats.InputBytes / (double)stats.Bytes,
+               blob / 1024, stats.DieMapBytes / 1024);
+    }
+
+    dwarf_type_table_destroy(table);
+    dwarf_destroy(&dwarf);
+    return 0;
+}
+
+typedef struct
+{
+    const char *name;
+    int (*run)(const ElfCtx *elf);
+} Bench;
+
+static const Bench benches[] = {
+    {"abbrev", bench_abbrev},
+    {"scan", bench_scan},
+    {"leb", bench_leb},
+    {"line", bench_line},
+    {"addr", bench_addr},
+    {"names", bench_names},
+    {"gdbindex", bench_gdb_index},
+    {"forms", bench_forms},
+    {"lists", bench_lists},
+    {"expr", bench_expr},
+    {"units", bench_units},
+    {"symbolize", bench_symbolize},
+    {"unwind", bench_unwind},
+    {"types", bench_types},
+};
+
+int main(int argc, char **argv)
+{
+    ElfCtx elf;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <elf-file> [benchmark...]\n", argv[0]);
+        fprintf(stderr, "Benchmarks:");
+        for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+            fprintf(stderr, " %s", benches[i].name);
+        fprintf(stderr, " (default: all)\n");
+        return 1;
+    }
+
+    if (load_file(argv[1], &g_file))
+        return 1;
+
+    if (elf_init(&g_file, mem_read_cb, &elf) != ELF_OK)
+    {
+        fprintf(stderr, "elf_init failed\n");
+        return 1;
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        int selected = (argc == 2);
+        for (int a = 2; a < argc; a++)
+            selected |= (strcmp(argv[a], benches[i].name) == 0);
+
+        if (selected)
+            ret |= benches[i].run(&elf);
+    }
+
+    free((void *)g_file.data);
+    return ret;
+}
@@ -0,0 +1,886 @@
+#define _POSIX_C_SOURCE 200809L // mkdir
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "common/elf_core.h"
+#include "common/elf_repr.h"
+#include "writer/elf_writer.h"
+#include "writer/elf_writer_dwarf.h"
+#include "dwarf/dwarf_producer.h"
+#include "dwarf/dwarf_consts.h"
+
+/*
+ * Generates synthetic relocatable ELF files to test and benchmark readers.
+ *
+ *   elf_corpus [options] -o <file>
+ *   elf_corpus [options] -n <count> -o <dir>
+ *       --seed N          seed of everything generated, 1 by default
+ *       --sections N      content sections, 16 by default. From 65280 sections on the file uses
+ *                         extended section numbering (SHN_XINDEX) and a .symtab_shndx section
+ *       --symbols N       symbols besides the null one, 1000 by default
+ *       --names DIST      length of the symbol names: fixed:N, uniform:MIN:MAX (the default is
+ *                         uniform:4:32), geometric:MEAN or mangled (mostly 12 to 60 bytes with
+ *                         a tail up to 2000, starting with _Z)
+ *       --relocs N        relocations against .text, 1000 by default
+ *       --class 32|64     64 by default
+ *       --endian little|big
+ *       --machine NAME    x86_64, i386, ppc64, ppc, aarch64 or riscv, by default the first one
+ *                         that matches the class and byte order
+ *       --dwarf N         functions described in .debug_info and .debug_line, 0 by default
+ *
+ * With -n, file k of the directory is generated with seed + k. The same options and seed give
+ * the same bytes: every random choice is a hash of the seed and the index of what it is for,
+ * and the name lengths are drawn from integer tables instead of floating point.
+ *
+ * The size of the files is only limited by the disk. The symbol table, its strings, the
+ * relocations and .text are produced in pieces while the writer streams the file (see
+ * elfw_section_append_source()), so 10^8 symbols never sit in memory. The other content
+ * sections point into one shared block of random bytes.
+ *
+ * Build (from the repository root):
+ *   cc -O2 -Isrc examples/elf_corpus/elf_corpus.c src/writer/elf_writer.c src/writer/elf_writer_dwarf.c \
+ *      src/dwarf/dwarf_producer.c src/dwarf/dwarf_leb128.c -o elf_corpus
+ */
+
+#define MAX_NAME    4096        // longest generated name, without its unique suffix
+#define NAME_CKPT   4096        // symbols between two saved string table offsets
+#define POOL_SIZE   8192        // shared bytes of the small sections
+#define DWARF_UNIT  512         // functions per compile unit
+#define FUNC_SIZE   16          // bytes of .text per described function
+
+/* Streams of the generator, hashed with the seed so each choice is independent of the others */
+enum
+{
+    TAG_SECTION = 1,
+    TAG_SYMBOL,
+    TAG_NAME,
+    TAG_RELOC,
+    TAG_TEXT,
+    TAG_POOL,
+    TAG_DWARF,
+};
+
+static inline uint64_t mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t rnd(uint64_t seed, uint64_t tag, uint64_t k)
+{
+    return mix(mix(seed ^ (tag << 56)) + k);
+}
+
+/***************
+ *   Options   *
+ ***************/
+
+typedef struct
+{
+    const char *name;
+    ElfMachine machine;
+    EiClass class_;     // ELFCLASSNONE if both exist
+    EiData data;        // ELFDATANONE if both exist
+    int rela;
+    uint32_t abs32;     // word sized absolute relocation of 32-bit files
+    uint32_t abs64;     // of 64-bit files
+    uint32_t pc32;      // 32-bit PC relative relocation
+} Machine;
+
+/* Relocation types from each psABI */
+static const Machine machines[] = {
+    { "x86_64",  EM_X86_64,  ELFCLASS64,   ELFDATA2LSB, 1,  10,   1,   2 },   // R_X86_64_32, _64, _PC32
+    { "i386",    EM_386,     ELFCLASS32,   ELFDATA2LSB, 0,   1,   0,   2 },   // R_386_32, R_386_PC32
+    { "ppc64",   EM_PPC64,   ELFCLASS64,   ELFDATANONE, 1,   1,  38,  26 },   // R_PPC64_ADDR32, _ADDR64, _REL32
+    { "ppc",     EM_PPC,     ELFCLASS32,   ELFDATA2MSB, 1,   1,   0,  26 },   // R_PPC_ADDR32, R_PPC_REL32
+    { "aarch64", EM_AARCH64, ELFCLASS64,   ELFDATANONE, 1, 258, 257, 261 },   // R_AARCH64_ABS32, _ABS64, _PREL32
+    { "riscv",   EM_RISCV,   ELFCLASSNONE, ELFDATA2LSB, 1,   1,   2,  57 },   // R_RISCV_32, _64, _32_PCREL
+};
+
+typedef struct
+{
+    uint64_t seed;
+    uint32_t sections;
+    uint64_t symbols;
+    uint64_t relocs;
+    uint64_t dwarf;
+    EiClass class_;
+    EiData data;
+    const Machine *machine;
+    uint64_t *name_cdf;     // name_cdf[n] = weight of the lengths up to n, n in [0, MAX_NAME]
+    const char *name_prefix;
+} Options;
+
+/* Integer weights of each name length, the cumulative table is sampled by binary search */
+static int parse_names(Options *opt, const char *spec)
+{
+    static uint64_t w[MAX_NAME + 1];
+    unsigned a, b;
+
+    memset(w, 0, sizeof(w));
+    opt->name_prefix = "";
+
+    if ((sscanf(spec, "fixed:%u", &a) == 1) && (a >= 1) && (a <= MAX_NAME))
+    {
+        w[a] = 1;
+    }
+    else if ((sscanf(spec, "uniform:%u:%u", &a, &b) == 2) && (a >= 1) && (a <= b) && (b <= MAX_NAME))
+    {
+        for (unsigned n = a; n <= b; n++)
+            w[n] = 1;
+    }
+    else if ((sscanf(spec, "geometric:%u", &a) == 1) && (a >= 1) && (a <= MAX_NAME / 8))
+    {
+        /* P(n) = (1 - 1/mean)^(n - 1) / mean, in 2^40 fixed point */
+        uint64_t p = 1ULL << 40;
+        for (unsigned n = 1; n <= MAX_NAME; n++)
+        {
+            w[n] = p;
+            p -= p / a;
+        }
+    }
+    else if (strcmp(spec, "mangled") == 0)
+    {
+        for (unsigned n = 12; n <= 60; n++)
+            w[n] = 70 * (1ULL << 32) / 49;
+        for (unsigned n = 61; n <= 200; n++)
+            w[n] = 25 * (1ULL << 32) / 140;
+        for (unsigned n = 201; n <= 2000; n++)
+            w[n] = 5 * (1ULL << 32) / 1800;
+        opt->name_prefix = "_Z";
+    }
+    else
+    {
+        return 1;
+    }
+
+    opt->name_cdf[0] = 0;
+    for (unsigned n = 1; n <= MAX_NAME; n++)
+        opt->name_cdf[n] = opt->name_cdf[n - 1] + w[n];
+    return 0;
+}
+
+/***************
+ *  Generator  *
+ ***************/
+
+typedef struct
+{
+    const Options *opt;
+    uint64_t seed;
+    ElfwCtx *elf;
+    int is32;
+    uint32_t word;              // bytes of an address
+
+    /* content sections, index i is section i + 1 of the file, 0 is .text */
+    uint8_t *kind;
+    uint32_t *size;
+    uint64_t text_size;
+    uint8_t pool[POOL_SIZE];
+
+    /* symbols */
+    uint64_t locals;            // symbols 1 to locals are local
+    uint64_t strtab_size;
+    uint64_t *ckpt;             // string table offset of symbol 1 + c * NAME_CKPT
+    uint64_t cursor_sym;        // last name located, to continue from it on sequential reads
+    uint64_t cursor_off;
+
+    /* scratch of the source callbacks */
+    ElfSymTabEntry *syms;
+    ElfRelocation *rels;
+    uint8_t *encoded;
+    uint32_t *shndx;
+    uint64_t scratch_entries;
+} Gen;
+
+enum
+{
+    KIND_TEXT,
+    KIND_DATA,
+    KIND_RODATA,
+    KIND_BSS,
+};
+
+static const char *kind_prefix[] = { ".text.f", ".data.v", ".rodata.c", ".bss.b" };
+
+static inline char digit36(uint64_t v)
+{
+    return "0123456789abcdefghijklmnopqrstuvwxyz"[v % 36];
+}
+
+/* Base 36 digits of k, the unique part of each name */
+static unsigned id_length(uint64_t k)
+{
+    unsigned n = 1;
+
+    while (k >= 36)
+    {
+        k /= 36;
+        n++;
+    }
+    return n;
+}
+
+/* Names are <prefix><random alphanumerics>_<k in base 36>, never shorter than what makes them unique */
+static uint32_t name_length(const Gen *g, uint64_t k)
+{
+    const uint64_t *cdf = g->opt->name_cdf;
+    uint64_t r = rnd(g->seed, TAG_NAME, k) % cdf[MAX_NAME];
+    uint32_t lo = 1, hi = MAX_NAME;
+    uint32_t min = (uint32_t)strlen(g->opt->name_prefix) + id_length(k) + 2;
+
+    /* first length whose cumulative weight passes r */
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (cdf[mid] > r)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return (lo < min) ? min : lo;
+}
+
+static uint32_t make_name(const Gen *g, uint64_t k, char *out)
+{
+    static const char alnum[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    uint32_t len = name_length(g, k);
+    uint32_t prefix = (uint32_t)strlen(g->opt->name_prefix);
+    uint32_t id = id_length(k);
+    uint64_t r = 0;
+
+    memcpy(out, g->opt->name_prefix, prefix);
+    for (uint32_t i = prefix; i < len - id - 1; i++)
+    {
+        if ((i - prefix) % 8 == 0)
+            r = rnd(g->seed, TAG_NAME, k * 1024 + (i - prefix) / 8 + 1);
+        /* the first character is a letter */
+        out[i] = alnum[(r & 0xff) % ((i == prefix) ? 52 : 62)];
+        r >>= 8;
+    }
+
+    out[len - id - 1] = '_';
+    for (uint32_t i = len; i > len - id; i--, k /= 36)
+        out[i - 1] = digit36(k);
+    out[len] = '\0';
+    return len;
+}
+
+/* String table offset of the name of symbol k, walking from a checkpoint or from the last answer */
+static uint64_t name_offset(Gen *g, uint64_t k)
+{
+    uint64_t at, off;
+
+    if ((g->cursor_sym != 0) && (g->cursor_sym <= k) && (k - g->cursor_sym < NAME_CKPT))
+    {
+        at = g->cursor_sym;
+        off = g->cursor_off;
+    }
+    else
+    {
+        at = 1 + (k - 1) / NAME_CKPT * NAME_CKPT;
+        off = g->ckpt[(k - 1) / NAME_CKPT];
+    }
+
+    for (; at < k; at++)
+        off += name_length(g, at) + 1;
+
+    g->cursor_sym = k;
+    g->cursor_off = off;
+    return off;
+}
+
+/* Symbol k, 1 <= k <= symbols, 0 is the null symbol */
+static void make_symbol(Gen *g, uint64_t k, uint64_t name_off, ElfSymTabEntry *sym)
+{
+    uint64_t r = rnd(g->seed, TAG_SYMBOL, k);
+    int local = (k <= g->locals);
+
+    memset(sym, 0, sizeof(*sym));
+    if (k == 0)
+        return;
+
+    sym->NameIdx = (uint32_t)name_off;
+    sym->Binding = local ? STB_LOCAL : (((r >> 4) % 8 == 0) ? STB_WEAK : STB_GLOBAL);
+    sym->Visib = (!local && ((r >> 12) % 16 == 0)) ? STV_HIDDEN : STV_DEFAULT;
+
+    if (!local && (r % 10 == 0))
+    {
+        sym->Type = STT_NOTYPE;
+        sym->Attr = STA_UNDEF;
+        sym->Visib = STV_DEFAULT;
+        return;
+    }
+
+    {
+        uint32_t sec = (uint32_t)((r >> 8) % g->opt->sections);
+        uint64_t size = (sec == 0) ? g->text_size : g->size[sec];
+        uint64_t value = (r >> 32) % size;
+
+        sym->Type = (g->kind[sec] == KIND_TEXT) ? STT_FUNC : STT_OBJECT;
+        sym->Attr = STA_DEFAULT;
+        sym->SecIdx = sec + 1;
+        sym->Value = value;
+        sym->Size = 1 + (r >> 48) % 64;
+        if (sym->Size > size - value)
+            sym->Size = size - value;
+    }
+}
+
+static int scratch_reserve(Gen *g, uint64_t entries)
+{
+    if (entries <= g->scratch_entries)
+        return 0;
+
+    free(g->syms);
+    free(g->rels);
+    free(g->encoded);
+    free(g->shndx);
+    g->syms = malloc(entries * sizeof(ElfSymTabEntry));
+    g->rels = malloc(entries * sizeof(ElfRelocation));
+    g->encoded = malloc(entries * 24);
+    g->shndx = malloc(entries * sizeof(uint32_t));
+    g->scratch_entries = entries;
+
+    return (g->syms == NULL) || (g->rels == NULL) || (g->encoded == NULL) || (g->shndx == NULL);
+}
+
+/*
+ * Source callbacks. The writer asks for pieces that don't follow entry boundaries, the entries
+ * overlapping a piece are encoded and the piece is copied out of them.
+ */
+
+static ElfResult text_cb(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+    Gen *g = user_ctx;
+    uint8_t *out = buffer;
+
+    for (uint64_t i = 0; i < size; i++)
+    {
+        uint64_t at = offset + i;
+        out[i] = (uint8_t)(rnd(g->seed, TAG_TEXT, at / 8) >> (8 * (at % 8)));
+    }
+    return ELF_OK;
+}
+
+static ElfResult strtab_cb(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+    Gen *g = user_ctx;
+    uint8_t *out = buffer;
+    uint64_t k = 1, off, end = offset + size;
+    char name[MAX_NAME + 64];
+
+    if (offset == 0)
+    {
+        out[0] = '\0';
+        if (size == 1)
+            return ELF_OK;
+    }
+
+    /* last checkpoint at or before the piece, then the names one by one */
+    {
+        uint64_t lo = 0, hi = (g->opt->symbols + NAME_CKPT - 1) / NAME_CKPT;
+        while (hi - lo > 1)
+        {
+            uint64_t mid = (lo + hi) / 2;
+            if (g->ckpt[mid] <= offset)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        k = 1 + lo * NAME_CKPT;
+        off = g->ckpt[lo];
+    }
+
+    if ((g->cursor_sym != 0) && (g->cursor_off <= offset) && (g->cursor_off >= off))
+    {
+        k = g->cursor_sym;
+        off = g->cursor_off;
+    }
+
+    for (; (k <= g->opt->symbols) && (off < end); k++)
+    {
+        uint32_t len = name_length(g, k) + 1;
+
+        if (off + len > offset)
+        {
+            uint64_t from = (off < offset) ? offset - off : 0;
+            uint64_t to = (off + len > end) ? end - off : len;
+
+            make_name(g, k, name);
+            memcpy(out + (off + from - offset), name + from, to - from);
+
+            g->cursor_sym = k;
+            g->cursor_off = off;
+        }
+        off += len;
+    }
+    return ELF_OK;
+}
+
+/* Encodes the symbols overlapping a piece of .symtab or .symtab_shndx */
+static ElfResult symbols_cb(Gen *g, uint64_t offset, uint64_t size, void *buffer, int shndx)
+{
+    uint64_t entry = shndx ? sizeof(uint32_t) : elfw_symbol_entry_size(g->elf);
+    uint64_t first = offset / entry;
+    uint64_t last = (offset + size - 1) / entry;
+    uint64_t count = last - first + 1;
+    ElfResult res;
+
+    if (scratch_reserve(g, count))
+        return ELF_NO_MEM;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t k = first + i;
+        make_symbol(g, k, (!shndx && (k != 0)) ? name_offset(g, k) : 0, &g->syms[i]);
+    }
+
+    res = elfw_encode_symbols(g->elf, g->syms, (uint32_t)count, g->encoded, g->shndx);
+    if (res != ELF_OK)
+        return res;
+
+    memcpy(buffer, (shndx ? (uint8_t *)g->shndx : g->encoded) + (offset - first * entry), size);
+    return ELF_OK;
+}
+
+static ElfResult symtab_cb(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+    return symbols_cb(user_ctx, offset, size, buffer, 0);
+}
+
+static ElfResult shndx_cb(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+    return symbols_cb(user_ctx, offset, size, buffer, 1);
+}
+
+/* Relocation j patches the word at j * word of .text */
+static ElfResult reloc_cb(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+    Gen *g = user_ctx;
+    const Machine *m = g->opt->machine;
+    uint64_t entry = elfw_relocation_entry_size(g->elf, m->rela);
+    uint64_t first = offset / entry;
+    uint64_t count = (offset + size - 1) / entry - first + 1;
+    uint64_t targets = g->opt->symbols;
+    ElfResult res;
+
+    /* 32-bit r_info holds 24-bit symbol indexes */
+    if (g->is32 && (targets > 0xffffff))
+        targets = 0xffffff;
+
+    if (scratch_reserve(g, count))
+        return ELF_NO_MEM;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t j = first + i;
+        uint64_t r = rnd(g->seed, TAG_RELOC, j);
+        int pc = (r & 1);
+
+        g->rels[i].Offset = j * g->word;
+        g->rels[i].Type = pc ? m->pc32 : (g->is32 ? m->abs32 : m->abs64);
+        g->rels[i].Symbol = targets ? (uint32_t)(1 + (r >> 8) % targets) : 0;
+        g->rels[i].Addend = pc ? -4 : (int64_t)((r >> 40) % 256);
+    }
+
+    res = elfw_encode_relocations(g->elf, g->rels, (uint32_t)count, m->rela, g->encoded);
+    if (res != ELF_OK)
+        return res;
+
+    memcpy(buffer, g->encoded + (offset - first * entry), size);
+    return ELF_OK;
+}
+
+/***************
+ *    DWARF    *
+ ***************/
+
+/* One compile unit per DWARF_UNIT functions laid out FUNC_SIZE bytes apart from the start of .text */
+static DwrfResult add_dwarf(Gen *g, DwrfProducer *prod)
+{
+    uint32_t cu, base, sub, leaf, param;
+    DwrfResult res = DWRF_OK;
+    uint64_t units = (g->opt->dwarf + DWARF_UNIT - 1) / DWARF_UNIT;
+    char name[64];
+
+    DwrfAbbrevSpec cus[] = {
+        { DW_AT_producer, DW_FORM_strp, 0 },     { DW_AT_language, DW_FORM_data2, 0 },
+        { DW_AT_name, DW_FORM_line_strp, 0 },    { DW_AT_comp_dir, DW_FORM_line_strp, 0 },
+        { DW_AT_low_pc, DW_FORM_addr, 0 },       { DW_AT_high_pc, DW_FORM_data4, 0 },
+        { DW_AT_stmt_list, DW_FORM_sec_offset, 0 },
+    };
+    DwrfAbbrevSpec bases[] = {
+        { DW_AT_name, DW_FORM_strp, 0 }, { DW_AT_byte_size, DW_FORM_data1, 0 }, { DW_AT_encoding, DW_FORM_data1, 0 },
+    };
+    DwrfAbbrevSpec subs[] = {
+        { DW_AT_name, DW_FORM_strp, 0 },      { DW_AT_low_pc, DW_FORM_addr, 0 },
+        { DW_AT_high_pc, DW_FORM_data4, 0 },  { DW_AT_decl_file, DW_FORM_implicit_const, 0 },
+        { DW_AT_decl_line, DW_FORM_data4, 0 }, { DW_AT_type, DW_FORM_ref4, 0 },
+        { DW_AT_external, DW_FORM_flag_present, 0 },
+    };
+    DwrfAbbrevSpec params[] = {
+        { DW_AT_name, DW_FORM_strp, 0 }, { DW_AT_type, DW_FORM_ref4, 0 },
+    };
+
+    if ((res = dwarf_producer_abbrev(prod, DW_TAG_compile_unit, DW_CHILDREN_yes, cus, 7, &cu)) ||
+        (res = dwarf_producer_abbrev(prod, DW_TAG_base_type, DW_CHILDREN_no, bases, 3, &base)) ||
+        (res = dwarf_producer_abbrev(prod, DW_TAG_subprogram, DW_CHILDREN_yes, subs, 7, &sub)) ||
+        (res = dwarf_producer_abbrev(prod, DW_TAG_subprogram, DW_CHILDREN_no, subs, 7, &leaf)) ||
+        (res = dwarf_producer_abbrev(prod, DW_TAG_formal_parameter, DW_CHILDREN_no, params, 2, &param)))
+        return res;
+
+    for (uint64_t u = 0; (res == DWRF_OK) && (u < units); u++)
+    {
+        uint64_t first = u * DWARF_UNIT;
+        uint64_t count = (g->opt->dwarf - first < DWARF_UNIT) ? g->opt->dwarf - first : DWARF_UNIT;
+        DwrfLineProgramInfo li = { "/corpus", name, 1, 1, 0, 0 };
+        DwrfLineProgram *lp;
+        DwrfLineRow rows[4];
+        DwrfDieRef int_type;
+        uint64_t stmt;
+        uint32_t file;
+
+        snprintf(name, sizeof(name), "unit%" PRIu64 ".c", u);
+        if ((res = dwarf_line_program_begin(prod, &li, &lp)))
+            break;
+
+        /* three rows per function and one sequence for the unit */
+        res = dwarf_line_program_file(lp, name, 0, &file);
+        for (uint64_t f = 0; (res == DWRF_OK) && (f < count); f++)
+        {
+            uint64_t addr = (first + f) * FUNC_SIZE;
+            uint32_t line = (uint32_t)(1 + f * 8 + rnd(g->seed, TAG_DWARF, first + f) % 4);
+            uint32_t n = 0;
+
+            rows[n++] = (DwrfLineRow){ addr, file, line, 0, DWRF_LINE_IS_STMT };
+            rows[n++] = (DwrfLineRow){ addr + 4, file, line + 1, 5, DWRF_LINE_IS_STMT | DWRF_LINE_PROLOGUE_END };
+            rows[n++] = (DwrfLineRow){ addr + 12, file, line + 2, 1, DWRF_LINE_IS_STMT };
+            if (f == count - 1)
+                rows[n++] = (DwrfLineRow){ addr + FUNC_SIZE, file, line + 2, 0, DWRF_LINE_END_SEQUENCE };
+            res = dwarf_line_program_rows(lp, rows, n);
+        }
+        if (res)
+        {
+            dwarf_line_program_end(lp, NULL);
+            break;
+        }
+        if ((res = dwarf_line_program_end(lp, &stmt)))
+            break;
+
+        if ((res = dwarf_producer_unit_begin(prod, DW_UT_compile)))
+            break;
+
+        /* DW_LANG_C11 */
+        res = dwarf_producer_die(prod, cu, (DwrfValue[]){ { 0, "elf_corpus" }, { 0x1d, NULL }, { 0, name }, { 0, "/corpus" },
+                                                          { first * FUNC_SIZE, NULL }, { count * FUNC_SIZE, NULL },
+                                                          { stmt, NULL } }, NULL);
+        if (res == DWRF_OK)
+            res = dwarf_producer_die(prod, base, (DwrfValue[]){ { 0, "int" }, { 4, NULL }, { DW_ATE_signed, NULL } },
+                                     &int_type);
+
+        for (uint64_t f = 0; (res == DWRF_OK) && (f < count); f++)
+        {
+            uint64_t r = rnd(g->seed, TAG_DWARF, first + f);
+            uint64_t params = (r >> 8) % 4;
+            char fn[32];
+
+            snprintf(fn, sizeof(fn), "fn_%" PRIu64, first + f);
+            res = dwarf_producer_die(prod, params ? sub : leaf, (DwrfValue[]){ { 0, fn }, { (first + f) * FUNC_SIZE, NULL },
+                                                               { FUNC_SIZE, NULL }, { 0, NULL },
+                                                               { 1 + f * 8 + r % 4, NULL }, { int_type, NULL },
+                                                               { 0, NULL } }, NULL);
+
+            for (uint64_t p = 0; (res == DWRF_OK) && (p < params); p++)
+                res = dwarf_producer_die(prod, param, (DwrfValue[]){ { 0, (const char *[]){ "a", "b", "c" }[p] },
+                                                                     { int_type, NULL } }, NULL);
+            if ((res == DWRF_OK) && params)
+                res = dwarf_producer_die_end(prod);
+        }
+
+        if (res == DWRF_OK)
+            res = dwarf_producer_die_end(prod);
+        if (res == DWRF_OK)
+            res = dwarf_producer_unit_end(prod);
+    }
+    return res;
+}
+
+/***************
+ *   Output    *
+ ***************/
+
+static ElfResult file_write_cb(void *user_ctx, uint64_t offset, uint64_t size, const void *buffer)
+{
+    (void)offset; // calls are sequential
+
+    return (fwrite(buffer, 1, size, (FILE *)user_ctx) == size) ? ELF_OK : ELF_IO_ERROR;
+}
+
+static void gen_release(Gen *g)
+{
+    free(g->kind);
+    free(g->size);
+    free(g->ckpt);
+    free(g->syms);
+    free(g->rels);
+    free(g->encoded);
+    free(g->shndx);
+}
+
+/* Lays out the file described by the options and writes it to path */
+static int generate(const Options *opt, uint64_t seed, const char *path)
+{
+    Gen g = { .opt = opt, .seed = seed };
+    ElfwHeaderCreateInfo hdr = { opt->class_, opt->data, ET_REL, opt->machine->machine, ELFOSABI_NONE, 0, 0, 0 };
+    DwrfProducer *prod = NULL;
+    sec_hndl text, strtab, symtab, shndx, rel;
+    ElfResult res = ELF_OK;
+    FILE *fp = NULL;
+    int ret = 1;
+
+    g.is32 = (opt->class_ == ELFCLASS32);
+    g.word = g.is32 ? 4 : 8;
+    g.locals = opt->symbols / 4;
+
+    g.kind = malloc(opt->sections);
+    g.size = malloc((size_t)opt->sections * sizeof(uint32_t));
+    g.ckpt = malloc(((opt->symbols + NAME_CKPT - 1) / NAME_CKPT + 1) * sizeof(uint64_t));
+    if ((g.kind == NULL) || (g.size == NULL) || (g.ckpt == NULL) || ((g.elf = elfw_create()) == NULL))
+    {
+        fprintf(stderr, "elf_corpus: out of memory\n");
+        goto out;
+    }
+
+    if ((res = elfw_create_header(g.elf, &hdr)) != ELF_OK)
+        goto out;
+
+    for (uint32_t i = 0; i < POOL_SIZE; i++)
+        g.pool[i] = (uint8_t)rnd(seed, TAG_POOL, i);
+
+    /* .text holds every relocated word and every described function */
+    g.text_size = 256;
+    if (opt->relocs * g.word > g.text_size)
+        g.text_size = opt->relocs * g.word;
+    if (opt->dwarf * FUNC_SIZE > g.text_size)
+        g.text_size = opt->dwarf * FUNC_SIZE;
+    if (g.is32 && (g.text_size > UINT32_MAX / 2))
+    {
+        fprintf(stderr, "elf_corpus: too many relocations or functions for a 32-bit file\n");
+        goto out;
+    }
+
+    {
+        ElfwSectionCreateInfo info = { ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 0, NULL, 0, 16, 0 };
+
+        if (((res = elfw_add_section(g.elf, &info, &text)) != ELF_OK) ||
+            ((res = elfw_section_append_source(text, text_cb, &g, g.text_size, 1)) != ELF_OK))
+            goto out;
+        g.kind[0] = KIND_TEXT;
+        g.size[0] = 0;
+    }
+
+    for (uint32_t i = 1; i < opt->sections; i++)
+    {
+        static const uint64_t flags[] = { SHF_ALLOC | SHF_EXECINSTR, SHF_ALLOC | SHF_WRITE, SHF_ALLOC, SHF_ALLOC | SHF_WRITE };
+        static const ElfSectionType types[] = { SHT_PROGBITS, SHT_PROGBITS, SHT_PROGBITS, SHT_NOBITS };
+        uint64_t r = rnd(seed, TAG_SECTION, i);
+        uint8_t kind = (uint8_t)(((r % 8) < 4) ? KIND_TEXT : ((r % 8) < 6) ? KIND_DATA : ((r % 8) == 6) ? KIND_RODATA : KIND_BSS);
+        uint32_t size = (uint32_t)(1 + (r >> 8) % ((kind == KIND_BSS) ? 4096 : 256));
+        char name[32];
+        ElfwSectionCreateInfo info = { name, types[kind], flags[kind], 0, NULL, 0, 1ULL << ((r >> 24) % 5), 0 };
+        sec_hndl sec;
+
+        snprintf(name, sizeof(name), "%s%" PRIu32, kind_prefix[kind], i);
+        if ((res = elfw_add_section(g.elf, &info, &sec)) != ELF_OK)
+            goto out;
+        res = elfw_section_append_data(sec, (kind == KIND_BSS) ? NULL : g.pool + (r >> 32) % (POOL_SIZE - size), size, 1);
+        if (res != ELF_OK)
+            goto out;
+
+        g.kind[i] = kind;
+        g.size[i] = size;
+    }
+
+    /* name offsets at every checkpoint, the string table size comes with them */
+    g.strtab_size = 1;
+    for (uint64_t k = 1; k <= opt->symbols; k++)
+    {
+        if ((k - 1) % NAME_CKPT == 0)
+            g.ckpt[(k - 1) / NAME_CKPT] = g.strtab_size;
+        g.strtab_size += name_length(&g, k) + 1;
+    }
+    if (g.strtab_size > UINT32_MAX)
+    {
+        fprintf(stderr, "elf_corpus: the names take more than 4 GiB, use fewer symbols or shorter names\n");
+        goto out;
+    }
+
+    {
+        uint64_t entries = opt->symbols + 1;
+        ElfwSectionCreateInfo str_info = { ".strtab", SHT_STRTAB, 0, 0, NULL, 0, 1, 0 };
+        ElfwSectionCreateInfo sym_info = { ".symtab", SHT_SYMTAB, 0, 0, NULL, (uint32_t)(g.locals + 1), g.word,
+                                           elfw_symbol_entry_size(g.elf) };
+        ElfwSectionCreateInfo ndx_info = { ".symtab_shndx", SHT_SYMTAB_SHNDX, 0, 0, NULL, 0, 4, 4 };
+
+        if (((res = elfw_add_section(g.elf, &str_info, &strtab)) != ELF_OK) ||
+            ((res = elfw_section_append_source(strtab, strtab_cb, &g, g.strtab_size, 1)) != ELF_OK))
+            goto out;
+
+        sym_info.Link = strtab;
+        if (((res = elfw_add_section(g.elf, &sym_info, &symtab)) != ELF_OK) ||
+            ((res = elfw_section_append_source(symtab, symtab_cb, &g, entries * sym_info.EntrySize, 1)) != ELF_OK))
+            goto out;
+
+        /* symbols of sections past the reserved range keep their index here */
+        if (opt->sections + 1 >= SHN_LORESERVE)
+        {
+            ndx_info.Link = symtab;
+            if (((res = elfw_add_section(g.elf, &ndx_info, &shndx)) != ELF_OK) ||
+                ((res = elfw_section_append_source(shndx, shndx_cb, &g, entries * 4, 1)) != ELF_OK))
+                goto out;
+        }
+    }
+
+    if (opt->relocs != 0)
+    {
+        const Machine *m = opt->machine;
+        ElfwSectionCreateInfo info = { m->rela ? ".rela.text" : ".rel.text", m->rela ? SHT_RELA : SHT_REL, SHF_INFO_LINK, 0,
+                                       symtab, elfw_section_index(text), g.word, elfw_relocation_entry_size(g.elf, m->rela) };
+
+        if (((res = elfw_add_section(g.elf, &info, &rel)) != ELF_OK) ||
+            ((res = elfw_section_append_source(rel, reloc_cb, &g, opt->relocs * info.EntrySize, 1)) != ELF_OK))
+            goto out;
+    }
+
+    if (opt->dwarf != 0)
+    {
+        DwrfProducerInfo info = { (uint8_t)g.word, opt->data == ELFDATA2MSB };
+        DwrfResult dr;
+
+        if ((dr = dwarf_producer_create(&info, &prod)) || (dr = add_dwarf(&g, prod)) || (dr = dwarf_producer_finish(prod)))
+        {
+            fprintf(stderr, "elf_corpus: DWARF error %d\n", (int)dr);
+            goto out;
+        }
+        if ((res = elfw_add_dwarf(g.elf, prod)) != ELF_OK)
+            goto out;
+    }
+
+    if ((fp = fopen(path, "wb")) == NULL)
+    {
+        fprintf(stderr, "elf_corpus: %s: %s\n", path, strerror(errno));
+        goto out;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+
+    res = elfw_write(g.elf, fp, file_write_cb);
+    if ((fclose(fp) != 0) && (res == ELF_OK))
+        res = ELF_IO_ERROR;
+    ret = (res != ELF_OK);
+
+out:
+    if (res != ELF_OK)
+        fprintf(stderr, "elf_corpus: %s: writer error %d\n", path, (int)res);
+    dwarf_producer_destroy(prod);
+    elfw_destroy(g.elf);
+    gen_release(&g);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static uint64_t name_cdf[MAX_NAME + 1];
+    Options opt = { .seed = 1, .sections = 16, .symbols = 1000, .relocs = 1000, .class_ = ELFCLASS64,
+                    .data = ELFDATA2LSB, .name_cdf = name_cdf };
+    const char *names = "uniform:4:32", *machine = NULL, *output = NULL;
+    uint64_t files = 0;
+    int ret = 0;
+
+    for (int a = 1; a < argc; a++)
+    {
+        const char *arg = argv[a];
+        const char *val = (a + 1 < argc) ? argv[a + 1] : NULL;
+
+        if (val == NULL)
+            goto usage;
+        a++;
+
+        if (strcmp(arg, "--seed") == 0)
+            opt.seed = strtoull(val, NULL, 0);
+        else if (strcmp(arg, "--sections") == 0)
+            opt.sections = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(arg, "--symbols") == 0)
+            opt.symbols = strtoull(val, NULL, 0);
+        else if (strcmp(arg, "--names") == 0)
+            names = val;
+        else if (strcmp(arg, "--relocs") == 0)
+            opt.relocs = strtoull(val, NULL, 0);
+        else if (strcmp(arg, "--class") == 0)
+            opt.class_ = (strcmp(val, "32") == 0) ? ELFCLASS32 : (strcmp(val, "64") == 0) ? ELFCLASS64 : ELFCLASSNONE;
+        else if (strcmp(arg, "--endian") == 0)
+            opt.data = (strcmp(val, "little") == 0) ? ELFDATA2LSB : (strcmp(val, "big") == 0) ? ELFDATA2MSB : ELFDATANONE;
+        else if (strcmp(arg, "--machine") == 0)
+            machine = val;
+        else if (strcmp(arg, "--dwarf") == 0)
+            opt.dwarf = strtoull(val, NULL, 0);
+        else if (strcmp(arg, "-n") == 0)
+            files = strtoull(val, NULL, 0);
+        else if (strcmp(arg, "-o") == 0)
+            output = val;
+        else
+            goto usage;
+    }
+
+    if ((output == NULL) || (opt.class_ == ELFCLASSNONE) || (opt.data == ELFDATANONE) || (opt.sections == 0) ||
+        (opt.sections > UINT32_MAX - 16) || (opt.symbols > UINT32_MAX - 1) || (opt.relocs > UINT32_MAX) ||
+        (opt.dwarf > UINT32_MAX) || parse_names(&opt, names))
+        goto usage;
+
+    for (size_t m = 0; m < sizeof(machines) / sizeof(machines[0]); m++)
+    {
+        const Machine *mc = &machines[m];
+
+        if (machine ? (strcmp(machine, mc->name) == 0)
+                    : (((mc->class_ == ELFCLASSNONE) || (mc->class_ == opt.class_)) &&
+                       ((mc->data == ELFDATANONE) || (mc->data == opt.data))))
+        {
+            opt.machine = mc;
+            break;
+        }
+    }
+    if (opt.machine == NULL)
+    {
+        fprintf(stderr, "elf_corpus: unknown machine %s\n", machine);
+        return 1;
+    }
+
+    if (files == 0)
+        return generate(&opt, opt.seed, output);
+
+    if ((mkdir(output, 0777) != 0) && (errno != EEXIST))
+    {
+        fprintf(stderr, "elf_corpus: %s: %s\n", output, strerror(errno));
+        return 1;
+    }
+
+    for (uint64_t k = 0; (k < files) && (ret == 0); k++)
+    {
+        char path[4096];
+
+        snprintf(path, sizeof(path), "%s/%05" PRIu64 ".o", output, k);
+        ret = generate(&opt, opt.seed + k, path);
+    }
+    return ret;
+
+usage:
+    fprintf(stderr, "Usage: elf_corpus [--seed N] [--sections N] [--symbols N] [--names DIST] [--relocs N] [--class 32|64]\n"
+                    "                  [--endian little|big] [--machine NAME] [--dwarf N] [-n count] -o <file-or-dir>\n");
+    return 1;
+}
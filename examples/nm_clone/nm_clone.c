@@ -0,0 +1,1102 @@
+#define _POSIX_C_SOURCE 200809L // mmap, pthreads, clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common/elf_core.h"
+#include "reader/elf_reader.h"
+
+/*
+ * Lists the symbols of many ELF files in the output format of `nm`.
+ *
+ *   nm_clone [-j threads] [-n | -p] [-D] [--dedup] [--time] <file-or-dir>...
+ *       -j threads  worker threads, one per CPU by default
+ *       -n          sort by address instead of by name
+ *       -p          don't sort, list the symbols in symbol table order
+ *       -D          list .dynsym instead of .symtab
+ *       --dedup     list each name once across all the inputs, where it first appears
+ *       --time      report the files, the symbols and the symbols per second on stderr
+ *
+ * Directories are walked recursively. Files are handed to the workers one at a time:
+ * each one reads the section headers and the symbols in batches, stores the symbols in
+ * columns (values, name offsets, nm letters) with the string table read whole, sorts them
+ * with a radix sort and formats its listing into a buffer of its own. The main thread
+ * writes the listings in input order as they complete. A single large file gets every
+ * thread for its sort instead.
+ *
+ * Names are compared as bytes, as `LC_ALL=C nm` does, and --dedup hashes the raw
+ * (mangled) names. Symbol versions are not printed, compare -D with
+ * `nm -D --without-symbol-versions`.
+ *
+ * Build (from the repository root):
+ *   cc -O2 -Isrc examples/nm_clone/nm_clone.c src/reader/elf_reader.c -lpthread -o nm_clone
+ */
+
+/* Special section indexes, see the ELF specification */
+#define NM_SHN_UNDEF  0x0000
+#define NM_SHN_ABS    0xfff1
+#define NM_SHN_COMMON 0xfff2
+
+#define SYM_BATCH        8192        // symbols decoded per get_symbol_entries() call
+#define PARALLEL_SORT    (1u << 16)  // smallest table sorted with more than one thread
+#define RADIX_THREADS    64
+#define SMALL_RUN        16          // runs of equal keys sorted by insertion
+#define DEDUP_SHARDS     64
+
+typedef enum
+{
+    SORT_NAME,
+    SORT_ADDR,
+    SORT_NONE,
+} SortMode;
+
+typedef struct
+{
+    const uint8_t *data;
+    uint64_t size;
+} MemFile;
+
+static ElfResult mem_read_cb(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+    MemFile *f = (MemFile *)user_ctx;
+
+    if ((offset > f->size) || (size > f->size - offset))
+        return ELF_IO_EOF;
+
+    memcpy(buffer, f->data + offset, size);
+    return ELF_OK;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Maps a whole file read only, returns NULL on failure or for empty files */
+static const uint8_t *map_file(const char *path, uint64_t *size)
+{
+    struct stat st;
+    void *data;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) || (st.st_size == 0))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    *size = (uint64_t)st.st_size;
+    return data;
+}
+
+/***************
+ *   Inputs    *
+ ***************/
+
+typedef struct
+{
+    char **paths;
+    size_t count;
+    size_t cap;
+} PathList;
+
+static int path_push(PathList *list, const char *path)
+{
+    if (list->count == list->cap)
+    {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        char **paths = realloc(list->paths, cap * sizeof(char *));
+        if (paths == NULL)
+            return 1;
+        list->paths = paths;
+        list->cap = cap;
+    }
+
+    if ((list->paths[list->count] = strdup(path)) == NULL)
+        return 1;
+    list->count++;
+    return 0;
+}
+
+/* Adds a file, or every regular file under a directory */
+static int collect(PathList *list, const char *path)
+{
+    struct stat st;
+    DIR *dir;
+    struct dirent *ent;
+    int ret = 0;
+
+    if (lstat(path, &st) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    if (S_ISREG(st.st_mode))
+        return path_push(list, path);
+    if (!S_ISDIR(st.st_mode))
+        return 0;
+
+    if ((dir = opendir(path)) == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    while ((ret == 0) && ((ent = readdir(dir)) != NULL))
+    {
+        char child[4096];
+
+        if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0))
+            continue;
+        if (snprintf(child, sizeof(child), "%s/%s", path, ent->d_name) >= (int)sizeof(child))
+            continue;
+        ret = collect(list, child);
+    }
+
+    closedir(dir);
+    return ret;
+}
+
+/***************
+ *   Columns   *
+ ***************/
+
+/* Listed symbols of one file, one array per field */
+typedef struct
+{
+    uint64_t *value;
+    uint32_t *name;         // offset in strtab
+    char *letter;
+    uint64_t *hash;         // of the name, --dedup only
+    uint32_t *order;        // listing order, indexes of the arrays above
+    uint32_t count;
+    char *strtab;           // whole string table, NUL terminated
+    uint64_t strtab_size;
+    int wide;               // 64-bit file, 16 digit values
+} SymColumns;
+
+static void columns_free(SymColumns *c)
+{
+    free(c->value);
+    free(c->name);
+    free(c->letter);
+    free(c->hash);
+    free(c->order);
+    free(c->strtab);
+    memset(c, 0, sizeof(*c));
+}
+
+static int columns_alloc(SymColumns *c, uint32_t cap, int dedup)
+{
+    size_t n = (size_t)cap + 1;
+
+    c->value = malloc(n * sizeof(uint64_t));
+    c->name = malloc(n * sizeof(uint32_t));
+    c->letter = malloc(n);
+    c->order = malloc(n * sizeof(uint32_t));
+    c->hash = dedup ? malloc(n * sizeof(uint64_t)) : NULL;
+
+    return (c->value == NULL) || (c->name == NULL) || (c->letter == NULL) || (c->order == NULL) ||
+           (dedup && (c->hash == NULL));
+}
+
+static inline const char *sym_name(const SymColumns *c, uint32_t i)
+{
+    return (c->name[i] < c->strtab_size) ? c->strtab + c->name[i] : "";
+}
+
+/* Undefined symbols print no value */
+static inline int sym_undefined(const SymColumns *c, uint32_t i)
+{
+    return (c->letter[i] == 'U') || (c->letter[i] == 'w') || (c->letter[i] == 'v');
+}
+
+/* The letter nm prints for a symbol, lower case for local symbols. On GNU systems STT_LOOS is
+   an indirect function and STB_LOOS a unique global */
+static char sym_letter(const ElfSymTabEntry *sym, const ElfSecHeader *headers, uint32_t sec_count)
+{
+    char c;
+
+    if (sym->Type == STT_LOOS)
+        return 'i';
+
+    if (sym->Binding == STB_WEAK)
+    {
+        if (sym->SecIdx == NM_SHN_UNDEF)
+            return (sym->Type == STT_OBJECT) ? 'v' : 'w';
+        return (sym->Type == STT_OBJECT) ? 'V' : 'W';
+    }
+
+    if (sym->SecIdx == NM_SHN_UNDEF)
+        return 'U';
+    if (sym->Binding == STB_LOOS)
+        return 'u';
+
+    if (sym->SecIdx == NM_SHN_ABS)
+    {
+        c = 'a';
+    }
+    else if (sym->SecIdx == NM_SHN_COMMON)
+    {
+        c = 'c';
+    }
+    else if (sym->SecIdx < sec_count)
+    {
+        const ElfSecHeader *sh = &headers[sym->SecIdx];
+
+        if (sh->Type == SHT_NOBITS)
+            c = 'b';
+        else if (sh->Flags & SHF_EXECINSTR)
+            c = 't';
+        else if (!(sh->Flags & SHF_ALLOC))
+            c = 'n';
+        else if (sh->Flags & SHF_WRITE)
+            c = 'd';
+        else
+            c = 'r';
+    }
+    else
+    {
+        return '?';
+    }
+
+    return (sym->Binding == STB_GLOBAL) ? (char)(c - 'a' + 'A') : c;
+}
+
+/* FNV-1a, only compared between names of the same run */
+static uint64_t name_hash(const char *s)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    while (*s)
+        h = (h ^ (uint8_t)*s++) * 0x100000001b3ULL;
+    return h;
+}
+
+/***************
+ *   Sorting   *
+ ***************/
+
+/*
+ * LSD radix sort of 64-bit keys carrying 32-bit indexes, 8 bits per pass. Passes where every
+ * key has the same byte are skipped. With several threads each one owns a contiguous chunk:
+ * the threads count the bytes of their chunk, derive where each of their buckets starts from
+ * the counts of all threads and scatter their chunk, which keeps the sort stable.
+ */
+typedef struct
+{
+    uint64_t *keys[2];
+    uint32_t *idx[2];
+    uint32_t count;
+    unsigned threads;
+    uint32_t (*hist)[8][256];   // per thread, all passes
+    int result;                 // the sorted keys are in keys[result]
+    pthread_barrier_t barrier;
+} RadixSort;
+
+typedef struct
+{
+    RadixSort *rs;
+    unsigned t;
+} RadixWorker;
+
+static void *radix_worker(void *arg)
+{
+    RadixWorker *w = arg;
+    RadixSort *rs = w->rs;
+    uint32_t lo = (uint32_t)((uint64_t)rs->count * w->t / rs->threads);
+    uint32_t hi = (uint32_t)((uint64_t)rs->count * (w->t + 1) / rs->threads);
+    uint32_t (*h)[256] = rs->hist[w->t];
+    int skip[8] = { 0 };
+    int src = 0, scattered = 0;
+
+    /* one read of the chunk for the totals of every pass, they don't depend on the order */
+    memset(h, 0, sizeof(rs->hist[0]));
+    for (uint32_t i = lo; i < hi; i++)
+    {
+        uint64_t k = rs->keys[0][i];
+        for (int b = 0; b < 8; b++)
+            h[b][(k >> (8 * b)) & 0xff]++;
+    }
+    pthread_barrier_wait(&rs->barrier);
+
+    /* every thread reaches the same decisions from the same totals */
+    for (int b = 0; b < 8; b++)
+    {
+        for (int d = 0; (d < 256) && !skip[b]; d++)
+        {
+            uint64_t total = 0;
+            for (unsigned t = 0; t < rs->threads; t++)
+                total += rs->hist[t][b][d];
+            skip[b] = (total == rs->count);
+        }
+    }
+    pthread_barrier_wait(&rs->barrier);
+
+    for (int b = 0; b < 8; b++)
+    {
+        uint32_t offset[256];
+        uint32_t base = 0;
+        unsigned shift = 8 * b;
+
+        if (skip[b])
+            continue;
+
+        /* the chunks changed with the previous pass, count this byte again */
+        if (scattered)
+        {
+            memset(h[b], 0, sizeof(h[b]));
+            for (uint32_t i = lo; i < hi; i++)
+                h[b][(rs->keys[src][i] >> shift) & 0xff]++;
+            pthread_barrier_wait(&rs->barrier);
+        }
+
+        for (int d = 0; d < 256; d++)
+        {
+            for (unsigned t = 0; t < rs->threads; t++)
+            {
+                if (t == w->t)
+                    offset[d] = base;
+                base += rs->hist[t][b][d];
+            }
+        }
+
+        for (uint32_t i = lo; i < hi; i++)
+        {
+            uint64_t k = rs->keys[src][i];
+            uint32_t at = offset[(k >> shift) & 0xff]++;
+
+            rs->keys[src ^ 1][at] = k;
+            rs->idx[src ^ 1][at] = rs->idx[src][i];
+        }
+        src ^= 1;
+        scattered = 1;
+
+        /* nobody counts or reads the next pass before every chunk is scattered */
+        pthread_barrier_wait(&rs->barrier);
+    }
+
+    if (w->t == 0)
+        rs->result = src;
+    return NULL;
+}
+
+/* Sorts keys[0..count) with idx alongside, the scratch arrays hold count elements */
+static int radix_sort(uint64_t *keys, uint32_t *idx, uint64_t *keys_tmp, uint32_t *idx_tmp, uint32_t count,
+                      unsigned threads)
+{
+    RadixSort rs = { .keys = { keys, keys_tmp }, .idx = { idx, idx_tmp }, .count = count };
+    RadixWorker workers[RADIX_THREADS];
+    pthread_t tids[RADIX_THREADS];
+
+    if (threads > RADIX_THREADS)
+        threads = RADIX_THREADS;
+    if (count < PARALLEL_SORT)
+        threads = 1;
+    rs.threads = threads;
+
+    if ((rs.hist = malloc(threads * sizeof(rs.hist[0]))) == NULL)
+        return 1;
+    pthread_barrier_init(&rs.barrier, NULL, threads);
+
+    for (unsigned t = 0; t < threads; t++)
+        workers[t] = (RadixWorker){ &rs, t };
+    for (unsigned t = 1; t < threads; t++)
+        pthread_create(&tids[t], NULL, radix_worker, &workers[t]);
+    radix_worker(&workers[0]);
+    for (unsigned t = 1; t < threads; t++)
+        pthread_join(tids[t], NULL);
+
+    if (rs.result)
+    {
+        memcpy(keys, keys_tmp, (size_t)count * sizeof(uint64_t));
+        memcpy(idx, idx_tmp, (size_t)count * sizeof(uint32_t));
+    }
+
+    pthread_barrier_destroy(&rs.barrier);
+    free(rs.hist);
+    return 0;
+}
+
+/* The first 8 bytes of a name in an integer that compares like the bytes */
+static uint64_t name_prefix(const char *s)
+{
+    uint64_t k = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        k = (k << 8) | (uint8_t)*s;
+        if (*s)
+            s++;
+    }
+    return k;
+}
+
+/* Full comparison of two symbols whose radix keys are equal, the table index breaks the ties */
+static int sym_cmp(const SymColumns *c, SortMode mode, uint32_t a, uint32_t b)
+{
+    int r;
+
+    if (mode == SORT_ADDR)
+    {
+        /* undefined symbols first, their keys are 0 */
+        if (sym_undefined(c, a) != sym_undefined(c, b))
+            return sym_undefined(c, a) ? -1 : 1;
+        if (c->value[a] != c->value[b])
+            return (c->value[a] < c->value[b]) ? -1 : 1;
+    }
+
+    if ((r = strcmp(sym_name(c, a), sym_name(c, b))) != 0)
+        return r;
+
+    if ((mode == SORT_NAME) && (c->value[a] != c->value[b]))
+        return (c->value[a] < c->value[b]) ? -1 : 1;
+
+    return (a < b) ? -1 : (a > b);
+}
+
+/* Merge sort of a run of equal radix keys */
+static void sort_run(const SymColumns *c, SortMode mode, uint32_t *run, uint32_t *tmp, uint32_t n)
+{
+    uint32_t half = n / 2, i = 0, j = half, k = 0;
+
+    if (n <= SMALL_RUN)
+    {
+        for (uint32_t x = 1; x < n; x++)
+        {
+            uint32_t v = run[x], y = x;
+
+            for (; (y > 0) && (sym_cmp(c, mode, run[y - 1], v) > 0); y--)
+                run[y] = run[y - 1];
+            run[y] = v;
+        }
+        return;
+    }
+
+    sort_run(c, mode, run, tmp, half);
+    sort_run(c, mode, run + half, tmp, n - half);
+
+    while ((i < half) && (j < n))
+        tmp[k++] = (sym_cmp(c, mode, run[j], run[i]) < 0) ? run[j++] : run[i++];
+    while (i < half)
+        tmp[k++] = run[i++];
+    while (j < n)
+        tmp[k++] = run[j++];
+    memcpy(run, tmp, (size_t)n * sizeof(uint32_t));
+}
+
+/* Fills c->order with the listing order */
+static int sort_symbols(SymColumns *c, SortMode mode, unsigned threads)
+{
+    uint32_t n = c->count;
+    uint64_t *keys, *keys_tmp;
+    uint32_t *idx_tmp;
+    int ret = 0;
+
+    for (uint32_t i = 0; i < n; i++)
+        c->order[i] = i;
+    if ((mode == SORT_NONE) || (n < 2))
+        return 0;
+
+    keys = malloc((size_t)n * sizeof(uint64_t));
+    keys_tmp = malloc((size_t)n * sizeof(uint64_t));
+    idx_tmp = malloc((size_t)n * sizeof(uint32_t));
+
+    if ((keys == NULL) || (keys_tmp == NULL) || (idx_tmp == NULL))
+    {
+        ret = 1;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (mode == SORT_ADDR)
+                keys[i] = sym_undefined(c, i) ? 0 : c->value[i];
+            else
+                keys[i] = name_prefix(sym_name(c, i));
+        }
+
+        ret = radix_sort(keys, c->order, keys_tmp, idx_tmp, n, threads);
+
+        /* equal keys: same address, or names sharing their first 8 bytes */
+        for (uint32_t a = 0, b; !ret && (a < n); a = b)
+        {
+            for (b = a + 1; (b < n) && (keys[b] == keys[a]); b++)
+                ;
+            if (b - a > 1)
+                sort_run(c, mode, c->order + a, idx_tmp, b - a);
+        }
+    }
+
+    free(keys);
+    free(keys_tmp);
+    free(idx_tmp);
+    return ret;
+}
+
+/***************
+ *    Dedup    *
+ ***************/
+
+/*
+ * Names seen across the inputs, sharded by hash so the workers rarely wait on each other.
+ * Each name remembers the earliest place it is listed at, file first and then rank in the
+ * listing of that file, whatever the order the workers get there in.
+ */
+typedef struct
+{
+    uint64_t hash;
+    const char *name;
+    uint32_t file;
+    uint32_t rank;
+} DedupEntry;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    DedupEntry *slots;
+    uint64_t cap;           // power of two
+    uint64_t used;
+} DedupShard;
+
+typedef struct
+{
+    DedupShard shards[DEDUP_SHARDS];
+} DedupSet;
+
+static inline DedupShard *dedup_shard(DedupSet *set, uint64_t hash)
+{
+    return &set->shards[hash >> 58];
+}
+
+static DedupEntry *shard_find(DedupShard *s, uint64_t hash, const char *name)
+{
+    for (uint64_t i = hash & (s->cap - 1);; i = (i + 1) & (s->cap - 1))
+    {
+        DedupEntry *e = &s->slots[i];
+
+        if ((e->name == NULL) || ((e->hash == hash) && (strcmp(e->name, name) == 0)))
+            return e;
+    }
+}
+
+static int shard_grow(DedupShard *s)
+{
+    DedupShard grown = { .cap = s->cap ? s->cap * 2 : 1024 };
+
+    if ((grown.slots = calloc((size_t)grown.cap, sizeof(DedupEntry))) == NULL)
+        return 1;
+
+    for (uint64_t i = 0; i < s->cap; i++)
+    {
+        if (s->slots[i].name != NULL)
+            *shard_find(&grown, s->slots[i].hash, s->slots[i].name) = s->slots[i];
+    }
+
+    free(s->slots);
+    s->slots = grown.slots;
+    s->cap = grown.cap;
+    return 0;
+}
+
+static int dedup_insert(DedupSet *set, uint64_t hash, const char *name, uint32_t file, uint32_t rank)
+{
+    DedupShard *s = dedup_shard(set, hash);
+    DedupEntry *e;
+    int ret = 0;
+
+    pthread_mutex_lock(&s->lock);
+    if ((s->used + 1) * 4 > s->cap * 3)
+        ret = shard_grow(s);
+
+    if (ret == 0)
+    {
+        e = shard_find(s, hash, name);
+        if (e->name == NULL)
+        {
+            *e = (DedupEntry){ hash, name, file, rank };
+            s->used++;
+        }
+        else if ((file < e->file) || ((file == e->file) && (rank < e->rank)))
+        {
+            e->name = name;
+            e->file = file;
+            e->rank = rank;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    return ret;
+}
+
+/* Whether the symbol at "rank" of "file" is where its name is listed, read once the inserts are done */
+static int dedup_first(DedupSet *set, uint64_t hash, const char *name, uint32_t file, uint32_t rank)
+{
+    const DedupEntry *e = shard_find(dedup_shard(set, hash), hash, name);
+
+    return (e->file == file) && (e->rank == rank);
+}
+
+/***************
+ *   Listing   *
+ ***************/
+
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+static int buf_reserve(Buffer *b, size_t n)
+{
+    if (b->len + n > b->cap)
+    {
+        size_t cap = b->cap ? b->cap : 4096;
+        char *data;
+
+        while (cap < b->len + n)
+            cap *= 2;
+        if ((data = realloc(b->data, cap)) == NULL)
+            return 1;
+        b->data = data;
+        b->cap = cap;
+    }
+    return 0;
+}
+
+/* "%0*" PRIx64, the buffer must have room for the digits */
+static inline void put_hex(Buffer *b, uint64_t v, int digits)
+{
+    char *p = b->data + b->len;
+
+    for (int i = digits - 1; i >= 0; i--)
+    {
+        p[i] = "0123456789abcdef"[v & 0xf];
+        v >>= 4;
+    }
+    b->len += (size_t)digits;
+}
+
+typedef enum
+{
+    FILE_PENDING,
+    FILE_LISTED,
+    FILE_EMPTY,             // ELF file without symbols, listed with its heading only
+    FILE_SKIPPED,           // not an ELF file
+    FILE_FAILED,
+} FileStatus;
+
+typedef struct
+{
+    const char *path;
+    SymColumns cols;
+    Buffer out;
+    const char *error;      // unless FILE_LISTED
+    FileStatus status;
+    int formatted;
+} FileJob;
+
+typedef struct
+{
+    FileJob *files;
+    size_t count;
+    size_t next;            // next file to take
+    SortMode sort;
+    int dynamic;
+    int dedup;
+    int headers;            // print the path before each listing
+    unsigned sort_threads;
+    DedupSet set;
+    uint64_t symbols;
+    pthread_mutex_t lock;
+    pthread_cond_t done;    // a file was formatted
+} ListJob;
+
+static int format_file(ListJob *job, size_t i)
+{
+    FileJob *f = &job->files[i];
+    SymColumns *c = &f->cols;
+    int digits = c->wide ? 16 : 8;
+
+    if (job->headers)
+    {
+        if (buf_reserve(&f->out, strlen(f->path) + 4))
+            return 1;
+        f->out.len += (size_t)sprintf(f->out.data + f->out.len, "\n%s:\n", f->path);
+    }
+    if (f->status != FILE_LISTED)
+        return 0;
+
+    for (uint32_t r = 0; r < c->count; r++)
+    {
+        uint32_t s = c->order[r];
+        const char *name = sym_name(c, s);
+        size_t len = strlen(name);
+
+        if (job->dedup && !dedup_first(&job->set, c->hash[s], name, (uint32_t)i, r))
+            continue;
+
+        if (buf_reserve(&f->out, (size_t)digits + len + 4))
+            return 1;
+
+        if (sym_undefined(c, s))
+        {
+            memset(f->out.data + f->out.len, ' ', (size_t)digits);
+            f->out.len += (size_t)digits;
+        }
+        else
+        {
+            put_hex(&f->out, c->value[s], digits);
+        }
+
+        f->out.data[f->out.len++] = ' ';
+        f->out.data[f->out.len++] = c->letter[s];
+        f->out.data[f->out.len++] = ' ';
+        memcpy(f->out.data + f->out.len, name, len);
+        f->out.len += len;
+        f->out.data[f->out.len++] = '\n';
+    }
+    return 0;
+}
+
+/* Reads, filters and sorts the symbols of one file into its columns */
+static void load_file(ListJob *job, size_t i)
+{
+    FileJob *f = &job->files[i];
+    SymColumns *c = &f->cols;
+    MemFile file;
+    ElfCtx elf;
+    ElfHeader hdr;
+    ElfSecHeader *headers = NULL, *symtab = NULL;
+    ElfSymTabEntry *batch = NULL;
+    uint32_t sec_count, sym_count;
+
+    f->status = FILE_FAILED;
+    if ((file.data = map_file(f->path, &file.size)) == NULL)
+    {
+        f->status = FILE_SKIPPED;
+        f->error = "cannot map the file";
+        return;
+    }
+
+    if ((file.size < 4) || (memcmp(file.data, "\x7f" "ELF", 4) != 0) || (elf_init(&file, mem_read_cb, &elf) != ELF_OK))
+    {
+        f->status = FILE_SKIPPED;
+        f->error = "file format not recognized";
+        munmap((void *)file.data, (size_t)file.size);
+        return;
+    }
+
+    get_header(&elf, &hdr);
+    c->wide = (hdr.EI_Class == ELFCLASS64);
+    sec_count = get_section_count(&elf);
+
+    headers = malloc((size_t)sec_count * sizeof(ElfSecHeader) + 1);
+    if ((headers == NULL) || (get_section_headers(&elf, 0, sec_count, headers) != ELF_OK))
+    {
+        f->error = "bad section header table";
+        goto out;
+    }
+
+    for (uint32_t s = 0; (s < sec_count) && (symtab == NULL); s++)
+    {
+        if (headers[s].Type == (job->dynamic ? SHT_DYNSYM : SHT_SYMTAB))
+            symtab = &headers[s];
+    }
+
+    if ((symtab == NULL) || ((sym_count = get_symbol_count(&elf, symtab)) < 2))
+    {
+        f->status = FILE_EMPTY;
+        f->error = "no symbols";
+        goto out;
+    }
+
+    /* names are offsets in one copy of the whole string table */
+    if ((symtab->Link >= sec_count) || (headers[symtab->Link].Type != SHT_STRTAB) ||
+        ((c->strtab = malloc((size_t)headers[symtab->Link].Size + 1)) == NULL) ||
+        (get_section_data(&elf, &headers[symtab->Link], 0, headers[symtab->Link].Size, c->strtab) != ELF_OK))
+    {
+        f->error = "bad string table";
+        goto out;
+    }
+    c->strtab_size = headers[symtab->Link].Size;
+    c->strtab[c->strtab_size] = '\0';
+
+    batch = malloc(SYM_BATCH * sizeof(ElfSymTabEntry));
+    if ((batch == NULL) || columns_alloc(c, sym_count, job->dedup))
+    {
+        f->error = "out of memory";
+        goto out;
+    }
+
+    /* the null symbol is never listed, nor are file and section symbols */
+    for (uint32_t first = 1; first < sym_count; first += SYM_BATCH)
+    {
+        uint32_t n = (sym_count - first < SYM_BATCH) ? sym_count - first : SYM_BATCH;
+
+        if (get_symbol_entries(&elf, symtab, first, n, batch) != ELF_OK)
+        {
+            f->error = "bad symbol table";
+            goto out;
+        }
+
+        for (uint32_t j = 0; j < n; j++)
+        {
+            const ElfSymTabEntry *sym = &batch[j];
+
+            if ((sym->Type == STT_FILE) || (sym->Type == STT_SECTION))
+                continue;
+
+            c->value[c->count] = sym->Value;
+            c->name[c->count] = sym->NameIdx;
+            c->letter[c->count] = sym_letter(sym, headers, sec_count);
+            c->count++;
+        }
+    }
+
+    if (sort_symbols(c, job->sort, job->sort_threads))
+    {
+        f->error = "out of memory";
+        goto out;
+    }
+
+    for (uint32_t r = 0; job->dedup && (r < c->count); r++)
+    {
+        uint32_t s = c->order[r];
+        const char *name = sym_name(c, s);
+
+        c->hash[s] = name_hash(name);
+        if (dedup_insert(&job->set, c->hash[s], name, (uint32_t)i, r))
+        {
+            f->error = "out of memory";
+            goto out;
+        }
+    }
+
+    f->status = FILE_LISTED;
+
+out:
+    free(batch);
+    free(headers);
+    munmap((void *)file.data, (size_t)file.size);
+}
+
+static void finish_file(ListJob *job, size_t i)
+{
+    FileJob *f = &job->files[i];
+
+    if (((f->status == FILE_LISTED) || (f->status == FILE_EMPTY)) && format_file(job, i))
+    {
+        f->status = FILE_FAILED;
+        f->error = "out of memory";
+    }
+
+    pthread_mutex_lock(&job->lock);
+    if (f->status == FILE_LISTED)
+        job->symbols += f->cols.count;
+    f->formatted = 1;
+    pthread_cond_broadcast(&job->done);
+    pthread_mutex_unlock(&job->lock);
+
+    /* the names of the dedup set point into the string tables */
+    if (!job->dedup)
+        columns_free(&f->cols);
+}
+
+/* Without --dedup a file is formatted as soon as it is loaded, with it once every file is */
+static void *load_worker(void *arg)
+{
+    ListJob *job = arg;
+
+    for (;;)
+    {
+        size_t i;
+
+        pthread_mutex_lock(&job->lock);
+        i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (i >= job->count)
+            return NULL;
+
+        load_file(job, i);
+        if (!job->dedup)
+            finish_file(job, i);
+    }
+}
+
+static void *format_worker(void *arg)
+{
+    ListJob *job = arg;
+
+    for (;;)
+    {
+        size_t i;
+
+        pthread_mutex_lock(&job->lock);
+        i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (i >= job->count)
+            return NULL;
+
+        finish_file(job, i);
+    }
+}
+
+/* Writes the listings in input order while the workers produce them */
+static int write_listings(ListJob *job)
+{
+    int failed = 0;
+
+    for (size_t i = 0; i < job->count; i++)
+    {
+        FileJob *f = &job->files[i];
+
+        pthread_mutex_lock(&job->lock);
+        while (!f->formatted)
+            pthread_cond_wait(&job->done, &job->lock);
+        pthread_mutex_unlock(&job->lock);
+
+        fwrite(f->out.data, 1, f->out.len, stdout);
+        if (f->status != FILE_LISTED)
+            fprintf(stderr, "nm_clone: %s: %s\n", f->path, f->error);
+
+        failed |= (f->status == FILE_FAILED);
+        free(f->out.data);
+        f->out = (Buffer){ 0 };
+    }
+    return failed;
+}
+
+/* Runs a pass over the files, returns whether a listing failed when it also writes them */
+static int run_workers(ListJob *job, void *(*fn)(void *), long threads_count, pthread_t *threads, int write)
+{
+    int failed = 0;
+
+    job->next = 0;
+    for (long t = 0; t < threads_count; t++)
+        pthread_create(&threads[t], NULL, fn, job);
+    if (write)
+        failed = write_listings(job);
+    for (long t = 0; t < threads_count; t++)
+        pthread_join(threads[t], NULL);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    PathList inputs = { 0 };
+    ListJob job = { 0 };
+    pthread_t *threads;
+    long threads_count = sysconf(_SC_NPROCESSORS_ONLN);
+    int timing = 0, ret = 0, a = 1;
+    double start;
+
+    for (; (a < argc) && (argv[a][0] == '-'); a++)
+    {
+        if ((strcmp(argv[a], "-j") == 0) && (a + 1 < argc))
+            threads_count = atol(argv[++a]);
+        else if (strcmp(argv[a], "-n") == 0)
+            job.sort = SORT_ADDR;
+        else if (strcmp(argv[a], "-p") == 0)
+            job.sort = SORT_NONE;
+        else if (strcmp(argv[a], "-D") == 0)
+            job.dynamic = 1;
+        else if (strcmp(argv[a], "--dedup") == 0)
+            job.dedup = 1;
+        else if (strcmp(argv[a], "--time") == 0)
+            timing = 1;
+        else
+            break;
+    }
+
+    if ((a >= argc) || (threads_count < 1))
+    {
+        fprintf(stderr, "Usage: nm_clone [-j threads] [-n | -p] [-D] [--dedup] [--time] <file-or-dir>...\n");
+        return 1;
+    }
+
+    for (; a < argc; a++)
+    {
+        if (collect(&inputs, argv[a]))
+            return 1;
+    }
+
+    start = now_seconds();
+
+    job.files = calloc(inputs.count + 1, sizeof(FileJob));
+    threads = malloc((size_t)threads_count * sizeof(pthread_t));
+    if ((job.files == NULL) || (threads == NULL))
+        return 1;
+
+    for (size_t i = 0; i < inputs.count; i++)
+        job.files[i].path = inputs.paths[i];
+    job.count = inputs.count;
+    job.headers = (inputs.count > 1);
+
+    /* a lone file gets every thread for its sort, many files one thread each */
+    job.sort_threads = (inputs.count == 1) ? (unsigned)threads_count : 1;
+    if ((size_t)threads_count > inputs.count)
+        threads_count = inputs.count ? (long)inputs.count : 1;
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.done, NULL);
+    for (int s = 0; s < DEDUP_SHARDS; s++)
+        pthread_mutex_init(&job.set.shards[s].lock, NULL);
+
+    if (job.dedup)
+    {
+        run_workers(&job, load_worker, threads_count, threads, 0);
+        ret = run_workers(&job, format_worker, threads_count, threads, 1);
+    }
+    else
+    {
+        ret = run_workers(&job, load_worker, threads_count, threads, 1);
+    }
+    fflush(stdout);
+
+    if (timing)
+    {
+        double elapsed = now_seconds() - start;
+
+        fprintf(stderr, "%zu files, %" PRIu64 " symbols with %ld threads in %.3f s, %.1f M symbols/s\n",
+                inputs.count, job.symbols, (job.sort_threads > 1) ? (long)job.sort_threads : threads_count, elapsed, (double)job.symbols / elapsed / 1e6);
+    }
+
+    for (size_t i = 0; i < inputs.count; i++)
+        columns_free(&job.files[i].cols);
+    for (int s = 0; s < DEDUP_SHARDS; s++)
+    {
+        pthread_mutex_destroy(&job.set.shards[s].lock);
+        free(job.set.shards[s].slots);
+    }
+    pthread_cond_destroy(&job.done);
+    pthread_mutex_destroy(&job.lock);
+    for (size_t i = 0; i < inputs.count; i++)
+        free(inputs.paths[i]);
+    free(inputs.paths);
+    free(job.files);
+    free(threads);
+    return ret;
+}
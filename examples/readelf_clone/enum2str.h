@@ -48,12 +48,20 @@ static const char *machine_to_str(ElfMachine m)
 {
     switch (m)
     {
-    //case :
-    //    return "ARM";
-    //case MACHINE_RISCV:
-    //    return "RISC-V";
-    //case MACHINE_AARCH64:
-    //    return "AArch64";
+    case EM_386:
+        return "Intel 80386";
+    case EM_PPC:
+        return "PowerPC";
+    case EM_PPC64:
+        return "PowerPC64";
+    case EM_ARM:
+        return "ARM";
+    case EM_X86_64:
+        return "Advanced Micro Devices X86-64";
+    case EM_AARCH64:
+        return "AArch64";
+    case EM_RISCV:
+        return "RISC-V";
     default:
         return "Unknown";
     }
@@ -95,20 +103,22 @@ static const char *segment_type_to_str(ElfSegmentType t)
 {
     switch (t)
     {
-    case SEGMENT_NULL:
+    case PT_NULL:
         return "NULL";
-    case SEGMENT_LOAD:
+    case PT_LOAD:
         return "LOAD";
-    case SEGMENT_DYNAMIC:
+    case PT_DYNAMIC:
         return "DYNAMIC";
-    case SEGMENT_INTERP:
+    case PT_INTERP:
         return "INTERP";
-    case SEGMENT_NOTE:
+    case PT_NOTE:
         return "NOTE";
-    case SEGMENT_SHLIB:
+    case PT_SHLIB:
         return "SHLIB";
-    case SEGMENT_PHDR:
+    case PT_PHDR:
         return "PHDR";
+    case PT_TLS:
+        return "TLS";
     default:
         return "UNKNOWN";
     }
@@ -1,39 +1,487 @@
+#define _POSIX_C_SOURCE 200809L // fseeko, clock_gettime
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
+#include <time.h>
 #include "common/elf_core.h"
 #include "reader/elf_reader.h"
 #include "enum2str.h"
 
+/*
+ * Prints the ELF header, section headers, program headers and symbol tables of a file,
+ * in the spirit of `readelf -h -S -l -s`.
+ *
+ *   print_header [--time] <elf-file>
+ *       --time  reports the wall time, the read callback calls and the bytes read and
+ *               written on stderr once the output is complete.
+ *
+ * Tables are read with the batch functions of the library and every string table is
+ * read whole once, so a file costs a few hundred callback calls whatever its size.
+ * The output is formatted into a large buffer by the out_* helpers below, which only
+ * know the handful of conversions this tool needs, and written with one fwrite() per
+ * buffer.
+ *
+ * Build (from the repository root):
+ *   cc -O2 -Isrc examples/readelf_clone/print_header.c src/reader/elf_reader.c -o print_header
+ */
+
+#define OUT_BUFFER_SIZE (1u << 20)
+#define OUT_FILL_CHUNK  64          // padding bytes written per size check
+#define SYM_BATCH       4096        // symbols decoded per get_symbol_entries() call
+
+typedef struct
+{
+    FILE *f;
+    uint64_t calls;
+    uint64_t bytes;
+} FileSource;
+
 static ElfResult file_read_cb(void *user_ctx,
                               uint64_t offset,
-                              size_t size,
+                              uint64_t size,
                               void *buffer)
 {
-    FILE *f = (FILE *)user_ctx;
+    FileSource *src = (FileSource *)user_ctx;
+
+    src->calls++;
+    src->bytes += size;
 
     /* Seek to requested offset */
-    if (fseeko(f, offset, SEEK_SET) != 0)
+    if (fseeko(src->f, (off_t)offset, SEEK_SET) != 0)
         return ELF_IO_ERROR;
 
     /* Read exactly `size` bytes */
-    if (fread(buffer, 1, size, f) != size)
-        return feof(f) ? ELF_IO_EOF : ELF_IO_ERROR;
+    if (fread(buffer, 1, size, src->f) != size)
+        return feof(src->f) ? ELF_IO_EOF : ELF_IO_ERROR;
 
     return ELF_OK;
 }
 
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/***************
+ *   Output    *
+ ***************/
+
+typedef struct
+{
+    char *buf;
+    size_t len;
+    uint64_t written;
+    FILE *f;
+} Out;
+
+static void out_flush(Out *o)
+{
+    fwrite(o->buf, 1, o->len, o->f);
+    o->written += o->len;
+    o->len = 0;
+}
+
+/* Makes room for "n" more bytes */
+static inline void out_reserve(Out *o, size_t n)
+{
+    if (o->len + n > OUT_BUFFER_SIZE)
+        out_flush(o);
+}
+
+static void out_bytes(Out *o, const char *s, size_t n)
+{
+    if (n > OUT_BUFFER_SIZE)
+    {
+        out_flush(o);
+        fwrite(s, 1, n, o->f);
+        o->written += n;
+        return;
+    }
+
+    out_reserve(o, n);
+    memcpy(o->buf + o->len, s, n);
+    o->len += n;
+}
+
+static inline void out_str(Out *o, const char *s)
+{
+    out_bytes(o, s, strlen(s));
+}
+
+static inline void out_char(Out *o, char c)
+{
+    out_reserve(o, 1);
+    o->buf[o->len++] = c;
+}
+
+static void out_fill(Out *o, char c, size_t n)
+{
+    while (n > 0)
+    {
+        size_t chunk = (n < OUT_FILL_CHUNK) ? n : OUT_FILL_CHUNK;
+
+        out_reserve(o, chunk);
+        memset(o->buf + o->len, c, chunk);
+        o->len += chunk;
+        n -= chunk;
+    }
+}
+
+/* Like "%-*s": the string padded with spaces on the right up to "width" */
+static void out_str_left(Out *o, const char *s, size_t width)
+{
+    size_t n = strlen(s);
+
+    out_bytes(o, s, n);
+    if (n < width)
+        out_fill(o, ' ', width - n);
+}
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Writes the digits of v ending at "end", returns where they start */
+static char *fmt_dec(char *end, uint64_t v)
+{
+    while (v >= 100)
+    {
+        const char *pair = &digit_pairs[(v % 100) * 2];
+        v /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+
+    if (v >= 10)
+    {
+        *--end = digit_pairs[v * 2 + 1];
+        *--end = digit_pairs[v * 2];
+    }
+    else
+    {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+static char *fmt_hex(char *end, uint64_t v)
+{
+    do
+    {
+        *--end = "0123456789abcdef"[v & 0xf];
+        v >>= 4;
+    } while (v != 0);
+    return end;
+}
+
+/*
+ * Writes a number formatted by fmt_dec() or fmt_hex(), padded with "pad" to "width" characters,
+ * on the left like "%5u" and "%016x" or on the right like "%-10u".
+ */
+static void out_num(Out *o, char *(*fmt)(char *, uint64_t), uint64_t v, size_t width, char pad, int left)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *start = fmt(end, v);
+    size_t n = (size_t)(end - start);
+    size_t fill = (n < width) ? width - n : 0;
+    char *p;
+
+    out_reserve(o, n + fill);
+    p = o->buf + o->len;
+    if (!left)
+    {
+        memset(p, pad, fill);
+        p += fill;
+    }
+    memcpy(p, start, n);
+    p += n;
+    if (left)
+    {
+        memset(p, pad, fill);
+        p += fill;
+    }
+    o->len = (size_t)(p - o->buf);
+}
+
+/* "%*" PRIu64 */
+static inline void out_dec(Out *o, uint64_t v, size_t width)
+{
+    out_num(o, fmt_dec, v, width, ' ', 0);
+}
+
+/* "%0*" PRIx64 */
+static inline void out_hex(Out *o, uint64_t v, size_t width)
+{
+    out_num(o, fmt_hex, v, width, '0', 0);
+}
+
+/* "%*" PRIx64 */
+static inline void out_hex_spaced(Out *o, uint64_t v, size_t width)
+{
+    out_num(o, fmt_hex, v, width, ' ', 0);
+}
+
+/***************
+ *   Tables    *
+ ***************/
+
+/* Whole contents of a string table, NUL terminated even if the file's copy isn't */
+typedef struct
+{
+    uint32_t index;
+    char *data;
+    uint64_t size;
+} StrTab;
+
+static void strtab_release(StrTab *tab)
+{
+    free(tab->data);
+    tab->data = NULL;
+    tab->size = 0;
+}
+
+/* Reads section "index" unless it is already the one held by "tab" */
+static void strtab_load(const ElfCtx *ctx, const ElfSecHeader *headers, const uint8_t *valid, uint32_t count,
+                        uint32_t index, StrTab *tab)
+{
+    const ElfSecHeader *sh;
+
+    if ((tab->data != NULL) && (tab->index == index))
+        return;
+
+    strtab_release(tab);
+    tab->index = index;
+
+    if ((index >= count) || !valid[index])
+        return;
+
+    sh = &headers[index];
+    if ((sh->Type != SHT_STRTAB) || (sh->Size >= SIZE_MAX))
+        return;
+
+    tab->data = malloc((size_t)sh->Size + 1);
+    if (tab->data == NULL)
+        return;
+
+    if (get_section_data(ctx, sh, 0, sh->Size, tab->data) != ELF_OK)
+    {
+        strtab_release(tab);
+        return;
+    }
+
+    tab->data[sh->Size] = '\0';
+    tab->size = sh->Size;
+}
+
+static const char *strtab_get(const StrTab *tab, uint64_t idx, const char *fallback)
+{
+    if ((tab->data == NULL) || (idx >= tab->size))
+        return fallback;
+    return tab->data + idx;
+}
+
+/*
+ * Reads the whole section header table, falling back to one header at a time if the
+ * batch read fails so a single malformed header only hides itself.
+ */
+static ElfSecHeader *read_section_headers(const ElfCtx *ctx, uint32_t count, uint8_t **valid)
+{
+    ElfSecHeader *headers = malloc((size_t)count * sizeof(ElfSecHeader) + 1);
+    uint8_t *ok = malloc((size_t)count + 1);
+
+    if ((headers == NULL) || (ok == NULL))
+    {
+        free(headers);
+        free(ok);
+        return NULL;
+    }
+
+    if (get_section_headers(ctx, 0, count, headers) == ELF_OK)
+    {
+        memset(ok, 1, count);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; i++)
+            ok[i] = (get_section_header(ctx, i, &headers[i]) == ELF_OK);
+    }
+
+    *valid = ok;
+    return headers;
+}
+
+/***************
+ *  Printing   *
+ ***************/
+
+static void print_file_header(Out *o, const ElfHeader *hdr)
+{
+    out_str(o, "ELF Header:\n");
+    out_str(o, "  Class:                             "); out_str(o, class_to_str(hdr->EI_Class)); out_char(o, '\n');
+    out_str(o, "  Data:                              "); out_str(o, data_to_str(hdr->EI_Data)); out_char(o, '\n');
+    out_str(o, "  Version:                           "); out_dec(o, EV_CURRENT, 0); out_str(o, " (current)\n");
+    out_str(o, "  OS/ABI:                            "); out_str(o, abi_to_str(hdr->EI_OS_ABI)); out_char(o, '\n');
+    out_str(o, "  ABI Version:                       "); out_dec(o, hdr->EI_ABI_Version, 0); out_char(o, '\n');
+    out_str(o, "  Type:                              "); out_str(o, type_to_str(hdr->Type)); out_char(o, '\n');
+    out_str(o, "  Machine:                           "); out_str(o, machine_to_str(hdr->Machine)); out_char(o, '\n');
+    out_str(o, "  Version:                           0x"); out_hex(o, hdr->Version, 0); out_char(o, '\n');
+    out_str(o, "  Entry point address:               0x"); out_hex(o, hdr->Entry, 0); out_char(o, '\n');
+    out_str(o, "  Start of program headers:          "); out_dec(o, hdr->ProHeadOff, 0); out_str(o, " (bytes into file)\n");
+    out_str(o, "  Start of section headers:          "); out_dec(o, hdr->SecHeadOff, 0); out_str(o, " (bytes into file)\n");
+    out_str(o, "  Flags:                             0x"); out_hex(o, hdr->Flags, 0); out_char(o, '\n');
+    out_str(o, "  Size of this header:               "); out_dec(o, hdr->HeadSize, 0); out_str(o, " (bytes)\n");
+    out_str(o, "  Size of program headers:           "); out_dec(o, hdr->PHEntrySize, 0); out_str(o, " (bytes)\n");
+    out_str(o, "  Number of program headers:         "); out_dec(o, hdr->PHEntryNum, 0); out_char(o, '\n');
+    out_str(o, "  Size of section headers:           "); out_dec(o, hdr->SHEntrySize, 0); out_str(o, " (bytes)\n");
+    out_str(o, "  Number of section headers:         "); out_dec(o, hdr->SHEntryNum, 0); out_char(o, '\n');
+    out_str(o, "  Section header string table index: "); out_dec(o, hdr->SecStrIndx, 0); out_char(o, '\n');
+}
+
+static void print_section_headers(Out *o, const ElfSecHeader *headers, const uint8_t *valid, uint32_t count,
+                                  const StrTab *shstrtab)
+{
+    out_str(o, "\nSection Headers:\n");
+    out_str(o, "[Nr] Name                 Type       Addr             Off      Size     ES  Flg Lk Inf Al\n");
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const ElfSecHeader *sh = &headers[i];
+
+        if (!valid[i])
+            continue;
+
+        out_char(o, '[');
+        out_dec(o, i, 2);
+        out_str(o, "] ");
+        out_str_left(o, strtab_get(shstrtab, sh->NameIdx, "<error>"), 20);
+        out_char(o, ' ');
+        out_num(o, fmt_dec, (uint32_t)sh->Type, 10, ' ', 1);
+        out_char(o, ' ');
+        out_hex(o, sh->Address, 16);
+        out_char(o, ' ');
+        out_hex(o, sh->Offset, 8);
+        out_char(o, ' ');
+        out_hex(o, sh->Size, 8);
+        out_char(o, ' ');
+        out_hex(o, sh->EntrySize, 2);
+        out_char(o, ' ');
+        out_hex_spaced(o, sh->Flags, 3);
+        out_char(o, ' ');
+        out_dec(o, sh->Link, 2);
+        out_char(o, ' ');
+        out_dec(o, sh->Info, 3);
+        out_char(o, ' ');
+        out_hex_spaced(o, sh->Alignment, 2);
+        out_char(o, '\n');
+    }
+}
+
+static void print_program_headers(Out *o, const ElfCtx *ctx)
+{
+    out_str(o, "\nProgram Headers:\n");
+    out_str(o, " Type           Offset     VirtAddr   PhysAddr   FileSiz  MemSiz  Flags  Align\n");
+
+    /* a handful of entries, read one at a time */
+    for (uint32_t i = 0; i < get_program_header_count(ctx); i++)
+    {
+        ElfProHeader ph;
+        if (get_program_header(ctx, i, &ph) != ELF_OK)
+            continue;
+
+        out_char(o, ' ');
+        out_str_left(o, segment_type_to_str(ph.Type), 14);
+        out_char(o, ' ');
+        out_hex(o, ph.Offset, 10);
+        out_char(o, ' ');
+        out_hex(o, ph.VirAddress, 10);
+        out_char(o, ' ');
+        out_hex(o, ph.PhyAddress, 10);
+        out_char(o, ' ');
+        out_hex(o, ph.FileSize, 8);
+        out_char(o, ' ');
+        out_hex(o, ph.MemSize, 7);
+        out_char(o, ' ');
+        out_hex_spaced(o, ph.Flags, 5);
+        out_char(o, ' ');
+        out_hex_spaced(o, ph.Alignment, 6);
+        out_char(o, '\n');
+    }
+}
+
+static void print_symbol_table(Out *o, const ElfCtx *ctx, const ElfSecHeader *sh, const char *sec_name,
+                               const StrTab *names, ElfSymTabEntry *syms)
+{
+    uint32_t count = get_symbol_count(ctx, sh);
+
+    out_str(o, "\nSymbol table '");
+    out_str(o, sec_name);
+    out_str(o, "':\n");
+    out_str(o, " Num:    Value          Size Type     Bind     Sec Name\n");
+
+    for (uint32_t first = 0; first < count; first += SYM_BATCH)
+    {
+        uint32_t n = (count - first < SYM_BATCH) ? count - first : SYM_BATCH;
+
+        if (get_symbol_entries(ctx, sh, first, n, syms) != ELF_OK)
+            return;
+
+        for (uint32_t j = 0; j < n; j++)
+        {
+            const ElfSymTabEntry *sym = &syms[j];
+
+            out_dec(o, first + j, 5);
+            out_str(o, ": ");
+            out_hex(o, sym->Value, 16);
+            out_char(o, ' ');
+            out_dec(o, sym->Size, 5);
+            out_char(o, ' ');
+            out_str_left(o, sym_type_to_str(sym->Type), 8);
+            out_char(o, ' ');
+            out_str_left(o, sym_bind_to_str(sym->Binding), 8);
+            out_char(o, ' ');
+            out_dec(o, sym->SecIdx, 3);
+            out_char(o, ' ');
+            out_str(o, strtab_get(names, sym->NameIdx, "<err>"));
+            out_char(o, '\n');
+        }
+    }
+}
+
 int main(int argc, char **argv)
 {
-    if (argc < 2)
+    const char *path = NULL;
+    int timing = 0;
+    int files = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--time") == 0)
+        {
+            timing = 1;
+        }
+        else
+        {
+            path = argv[i];
+            files++;
+        }
+    }
+
+    if (files != 1)
     {
-        fprintf(stderr, "Usage: %s <elf-file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s [--time] <elf-file>\n", argv[0]);
         return 1;
     }
 
-    FILE *f = fopen(argv[1], "rb");
-    if (!f)
+    double start = now_seconds();
+
+    FileSource src = { fopen(path, "rb"), 0, 0 };
+    if (!src.f)
     {
         perror("fopen");
         return 1;
@@ -41,11 +489,11 @@ int main(int argc, char **argv)
 
     ElfCtx ctx; /* caller-allocated, opaque */
 
-    ElfResult err = elf_init(f, file_read_cb, &ctx);
+    ElfResult err = elf_init(&src, file_read_cb, &ctx);
     if (err != ELF_OK)
     {
         fprintf(stderr, "elf_init failed: %s\n", elferr_to_str(err));
-        fclose(f);
+        fclose(src.f);
         return 1;
     }
 
@@ -54,120 +502,65 @@ int main(int argc, char **argv)
     if (err != ELF_OK)
     {
         fprintf(stderr, "get_header failed: %s\n", elferr_to_str(err));
-        fclose(f);
+        fclose(src.f);
         return 1;
     }
 
-    /* Print readelf-style summary */
-    printf("ELF Header:\n");
-    printf("  Class:                             %s\n", class_to_str(hdr.EI_Class));
-    printf("  Data:                              %s\n", data_to_str(hdr.EI_Data));
-    printf("  Version:                           %d (current)\n", EV_CURRENT);
-    printf("  Version:                           %s\n", abi_to_str(hdr.EI_OS_ABI));
-    printf("  ABI Version:                       %u\n", hdr.EI_ABI_Version);
-    printf("  Type:                              %s\n", type_to_str(hdr.Type));
-    printf("  Machine:                           %s\n", machine_to_str(hdr.Machine));
-    printf("  Version:                           0x%" PRIx32 "\n", hdr.Version);
-    printf("  Entry point address:               0x%" PRIx64 "\n", hdr.Entry);
-    printf("  Start of program headers:          %" PRIu64 " (bytes into file)\n", hdr.ProHeadOff);
-    printf("  Start of section headers:          %" PRIu64 " (bytes into file)\n", hdr.SecHeadOff);
-    printf("  Flags:                             0x%" PRIx32 "\n", hdr.Flags);
-    printf("  Size of this header:               %u (bytes)\n", hdr.HeadSize);
-    printf("  Size of program headers:           %u (bytes)\n", hdr.PHEntrySize);
-    printf("  Number of program headers:         %u\n", hdr.PHEntryNum);
-    printf("  Size of section headers:           %u (bytes)\n", hdr.SHEntrySize);
-    printf("  Number of section headers:         %u\n", hdr.SHEntryNum);
-    printf("  Section header string table index: %u\n", hdr.SecStrIndx);
-
-    printf("\nSection Headers:\n");
-    printf("[Nr] Name                 Type       Addr             Off      Size     ES  Flg Lk Inf Al\n");
-
-    for (uint16_t i = 0; i < get_section_count(&ctx); i++)
-    {
-        ElfSecHeader sh;
-        if (get_section_header(&ctx, i, &sh) != ELF_OK)
-            continue;
+    Out out = { malloc(OUT_BUFFER_SIZE), 0, 0, stdout };
+    uint32_t sec_count = get_section_count(&ctx);
+    uint8_t *valid = NULL;
+    ElfSecHeader *headers = read_section_headers(&ctx, sec_count, &valid);
+    ElfSymTabEntry *syms = malloc(SYM_BATCH * sizeof(ElfSymTabEntry));
+    StrTab shstrtab = { 0 }, names = { 0 };
 
-        uint8_t name[256];
-        if (get_section_name(&ctx, &sh, name, sizeof(name)) != ELF_OK)
-            strcpy((char *)name, "<error>");
-
-        printf("[%2u] %-20s %-10u %016" PRIx64 " %08" PRIx64
-               " %08" PRIx64 " %02" PRIx64 " %3" PRIx64 " %2u %3u %2" PRIx64 "\n",
-               i,
-               name,
-               (uint32_t)sh.Type,
-               sh.Address,
-               sh.Offset,
-               sh.Size,
-               sh.EntrySize,
-               sh.Flags,
-               sh.Link,
-               sh.Info,
-               sh.Alignment);
-    }
-
-    printf("\nProgram Headers:\n");
-    printf(" Type           Offset     VirtAddr   PhysAddr   FileSiz  MemSiz  Flags  Align\n");
-    for (uint32_t i = 0; i < get_program_header_count(&ctx); i++)
+    if ((out.buf == NULL) || (headers == NULL) || (syms == NULL))
     {
-        ElfProHeader ph;
-        if (get_program_header(&ctx, i, &ph) != ELF_OK)
-            continue;
-
-        printf(" %-14s %010" PRIx64 " %010" PRIx64 " %010" PRIx64
-               " %08" PRIx64 " %07" PRIx64 " %5" PRIx32 " %6" PRIx64 "\n",
-               segment_type_to_str(ph.Type),
-               ph.Offset,
-               ph.VirAddress,
-               ph.PhyAddress,
-               ph.FileSize,
-               ph.MemSize,
-               ph.Flags,
-               ph.Alignment);
+        fprintf(stderr, "out of memory\n");
+        free(out.buf);
+        free(headers);
+        free(valid);
+        free(syms);
+        fclose(src.f);
+        return 1;
     }
 
-    printf("\nSymbol Tables:\n");
+    /* Print readelf-style summary */
+    print_file_header(&out, &hdr);
+
+    strtab_load(&ctx, headers, valid, sec_count, hdr.SecStrIndx, &shstrtab);
+    print_section_headers(&out, headers, valid, sec_count, &shstrtab);
 
-    printf("\nSymbol Tables:\n");
+    print_program_headers(&out, &ctx);
 
-    for (uint16_t i = 0; i < get_section_count(&ctx); i++)
+    out_str(&out, "\nSymbol Tables:\n");
+
+    for (uint32_t i = 0; i < sec_count; i++)
     {
-        ElfSecHeader sh;
-        if (get_section_header(&ctx, i, &sh) != ELF_OK)
-            continue;
+        const ElfSecHeader *sh = &headers[i];
 
-        if (sh.Type != SHT_SYMTAB && sh.Type != SHT_DYNSYM)
+        if (!valid[i] || ((sh->Type != SHT_SYMTAB) && (sh->Type != SHT_DYNSYM)))
             continue;
 
-        uint8_t sec_name[256];
-        get_section_name(&ctx, &sh, sec_name, sizeof(sec_name));
+        /* consecutive tables usually share their string table */
+        strtab_load(&ctx, headers, valid, sec_count, sh->Link, &names);
+        print_symbol_table(&out, &ctx, sh, strtab_get(&shstrtab, sh->NameIdx, "<error>"), &names, syms);
+    }
 
-        printf("\nSymbol table '%s':\n", sec_name);
-        printf(" Num:    Value          Size Type     Bind     Sec Name\n");
+    out_flush(&out);
+    fflush(stdout);
 
-        uint64_t count = sh.Size / sh.EntrySize;
-        for (uint64_t j = 0; j < count; j++)
-        {
-            ElfSymTabEntry sym;
-            if (get_symbol_entry(&ctx, &sh, j, &sym) != ELF_OK)
-                continue;
-
-            uint8_t name[256];
-            if (get_symbol_name(&ctx, sh.Link, &sym, name, sizeof(name)) != ELF_OK)
-                strcpy((char *)name, "<err>");
-
-            printf("%5" PRIu64 ": %016" PRIx64 " %5" PRIu64 " %-8s %-8s %3lu %s\n",
-                   j,
-                   sym.Value,
-                   sym.Size,
-                   sym_type_to_str(sym.Type),
-                   sym_bind_to_str(sym.Binding),
-                   sym.SecIdx,
-                   name);
-        }
+    if (timing)
+    {
+        fprintf(stderr, "%.3f ms, %" PRIu64 " read callback calls, %" PRIu64 " bytes read, %" PRIu64 " bytes written\n",
+                (now_seconds() - start) * 1e3, src.calls, src.bytes, out.written);
     }
 
-    fclose(f);
+    strtab_release(&shstrtab);
+    strtab_release(&names);
+    free(out.buf);
+    free(headers);
+    free(valid);
+    free(syms);
+    fclose(src.f);
     return 0;
-}
\ No newline at end of file
+}
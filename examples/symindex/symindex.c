@@ -0,0 +1,437 @@
+#define _POSIX_C_SOURCE 200809L // mmap, pthreads, clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common/elf_core.h"
+#include "reader/elf_reader.h"
+#include "dwarf/elf_dwarf.h"
+
+/*
+ * Builds and queries persistent symbol indexes.
+ *
+ *   symindex build [-j threads] <out-dir> <file-or-dir>...
+ *       Indexes every ELF file found (directories are walked recursively), one file per
+ *       thread. Each index is written to <out-dir>/<build-id>.symidx, or <name>.symidx
+ *       for files without a build ID.
+ *
+ *   symindex lookup <index> <0xaddress|symbol>...
+ *       Maps the index and resolves addresses to symbol, unit and source line, and
+ *       symbol names to addresses.
+ *
+ * Build (from the repository root):
+ *   cc -O2 -Isrc examples/symindex/symindex.c src/reader/elf_reader.c src/dwarf/elf_dwarf.c src/dwarf/dwarf_*.c -lpthread -o symindex
+ */
+
+typedef struct
+{
+    const uint8_t *data;
+    uint64_t size;
+} MemFile;
+
+static ElfResult mem_read_cb(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+    MemFile *f = (MemFile *)user_ctx;
+
+    if ((offset > f->size) || (size > f->size - offset))
+        return ELF_IO_EOF;
+
+    memcpy(buffer, f->data + offset, size);
+    return ELF_OK;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Maps a whole file read only, returns NULL on failure or for empty files */
+static const uint8_t *map_file(const char *path, uint64_t *size)
+{
+    struct stat st;
+    void *data;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) || (st.st_size == 0))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    *size = (uint64_t)st.st_size;
+    return data;
+}
+
+/***************
+ *    Build    *
+ ***************/
+
+typedef struct
+{
+    char **paths;
+    size_t count;
+    size_t cap;
+} PathList;
+
+typedef struct
+{
+    const PathList *inputs;
+    const char *out_dir;
+    size_t next;                // next input to index
+    unsigned failed;
+    pthread_mutex_t lock;
+} BuildJob;
+
+static int path_push(PathList *list, const char *path)
+{
+    if (list->count == list->cap)
+    {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        char **paths = realloc(list->paths, cap * sizeof(char *));
+        if (paths == NULL)
+            return 1;
+        list->paths = paths;
+        list->cap = cap;
+    }
+
+    if ((list->paths[list->count] = strdup(path)) == NULL)
+        return 1;
+    list->count++;
+    return 0;
+}
+
+/* Adds a file, or every regular file under a directory */
+static int collect(PathList *list, const char *path)
+{
+    struct stat st;
+    DIR *dir;
+    struct dirent *ent;
+    int ret = 0;
+
+    if (lstat(path, &st) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    if (S_ISREG(st.st_mode))
+        return path_push(list, path);
+    if (!S_ISDIR(st.st_mode))
+        return 0;
+
+    if ((dir = opendir(path)) == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    while ((ret == 0) && ((ent = readdir(dir)) != NULL))
+    {
+        char child[4096];
+
+        if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0))
+            continue;
+        if (snprintf(child, sizeof(child), "%s/%s", path, ent->d_name) >= (int)sizeof(child))
+            continue;
+        ret = collect(list, child);
+    }
+
+    closedir(dir);
+    return ret;
+}
+
+/* Index file name: the build ID in hex, or the name of the input */
+static void index_name(const DwrfSymIndex *index, const char *input, const char *out_dir, char *buff, size_t len)
+{
+    const uint8_t *id;
+    uint32_t id_len;
+    char hex[2 * 32 + 1];
+    const char *base = strrchr(input, '/');
+
+    dwarf_sym_index_build_id(index, &id, &id_len);
+    if (id_len == 0)
+    {
+        snprintf(buff, len, "%s/%s.symidx", out_dir, base ? base + 1 : input);
+        return;
+    }
+
+    for (uint32_t i = 0; i < id_len; i++)
+        sprintf(hex + 2 * i, "%02x", id[i]);
+    snprintf(buff, len, "%s/%s.symidx", out_dir, hex);
+}
+
+/* Writes next to the destination and renames, readers never map a partial index. Copies of
+   the same binary have the same build ID, the job number keeps their temporary files apart. */
+static int write_index(const char *path, size_t job, const void *blob, uint64_t size)
+{
+    char tmp[4200];
+    FILE *fp;
+    int ok;
+
+    snprintf(tmp, sizeof(tmp), "%s.%ld-%zu.tmp", path, (long)getpid(), job);
+    if ((fp = fopen(tmp, "wb")) == NULL)
+        return 1;
+
+    ok = (fwrite(blob, 1, (size_t)size, fp) == (size_t)size);
+    ok &= (fclose(fp) == 0);
+    if (!ok || (rename(tmp, path) != 0))
+    {
+        remove(tmp);
+        return 1;
+    }
+    return 0;
+}
+
+/* Indexes one file, returns 0 when the file was indexed or isn't an ELF file */
+static int build_one(const char *input, size_t job, const char *out_dir)
+{
+    MemFile file;
+    ElfCtx elf;
+    DwrfCtx dwarf;
+    DwrfSymIndex *index;
+    DwrfSymIndexInfo info;
+    DwrfResult res;
+    void *blob = NULL;
+    uint64_t size;
+    char out[4096];
+    int has_dwarf, ret = 0;
+    double start = now_seconds();
+
+    if ((file.data = map_file(input, &file.size)) == NULL)
+        return 0;
+
+    if ((file.size < 4) || (memcmp(file.data, "\x7f" "ELF", 4) != 0) || (elf_init(&file, mem_read_cb, &elf) != ELF_OK))
+    {
+        munmap((void *)file.data, (size_t)file.size);
+        return 0;
+    }
+
+    /* files without debug information still get their symbols indexed */
+    has_dwarf = (dwarf_init(&elf, &dwarf) == DWRF_OK);
+    if (has_dwarf)
+        dwarf_set_image(&dwarf, file.data, file.size);
+
+    res = dwarf_sym_index_build(&elf, has_dwarf ? &dwarf : NULL, 1, &blob, &size);
+    if (res == DWRF_OK)
+        res = dwarf_sym_index_open(blob, size, &index);
+
+    if (res != DWRF_OK)
+    {
+        fprintf(stderr, "%s: failed to build the index (%d)\n", input, res);
+        ret = 1;
+    }
+    else
+    {
+        index_name(index, input, out_dir, out, sizeof(out));
+        dwarf_sym_index_info(index, &info);
+        dwarf_sym_index_destroy(index);
+
+        if (write_index(out, job, blob, size))
+        {
+            fprintf(stderr, "%s: failed to write %s\n", input, out);
+            ret = 1;
+        }
+        else
+            printf("%s -> %s (%" PRIu64 " symbols, %" PRIu64 " units, %" PRIu64 " rows, %" PRIu64 " KiB, %.1f ms)\n",
+                   input, out, info.Symbols, info.Units, info.Rows, info.Size / 1024, (now_seconds() - start) * 1e3);
+    }
+
+    free(blob);
+    if (has_dwarf)
+        dwarf_destroy(&dwarf);
+    munmap((void *)file.data, (size_t)file.size);
+    return ret;
+}
+
+static void *build_worker(void *arg)
+{
+    BuildJob *job = arg;
+
+    for (;;)
+    {
+        size_t i;
+
+        pthread_mutex_lock(&job->lock);
+        i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (i >= job->inputs->count)
+            return NULL;
+
+        if (build_one(job->inputs->paths[i], i, job->out_dir))
+        {
+            pthread_mutex_lock(&job->lock);
+            job->failed++;
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+}
+
+static int cmd_build(int argc, char **argv)
+{
+    PathList inputs = {0};
+    BuildJob job = {0};
+    pthread_t *threads;
+    long threads_count = sysconf(_SC_NPROCESSORS_ONLN);
+    int a = 0;
+    double start;
+
+    if ((argc > 1) && (strcmp(argv[0], "-j") == 0))
+    {
+        threads_count = atol(argv[1]);
+        a = 2;
+    }
+    if ((argc - a < 2) || (threads_count < 1))
+    {
+        fprintf(stderr, "Usage: symindex build [-j threads] <out-dir> <file-or-dir>...\n");
+        return 1;
+    }
+
+    job.out_dir = argv[a++];
+    for (; a < argc; a++)
+    {
+        if (collect(&inputs, argv[a]))
+            return 1;
+    }
+
+    if ((size_t)threads_count > inputs.count)
+        threads_count = inputs.count ? (long)inputs.count : 1;
+
+    threads = malloc((size_t)threads_count * sizeof(pthread_t));
+    if (threads == NULL)
+        return 1;
+
+    job.inputs = &inputs;
+    pthread_mutex_init(&job.lock, NULL);
+
+    start = now_seconds();
+    for (long t = 1; t < threads_count; t++)
+        pthread_create(&threads[t], NULL, build_worker, &job);
+    build_worker(&job);
+    for (long t = 1; t < threads_count; t++)
+        pthread_join(threads[t], NULL);
+
+    printf("%zu files scanned with %ld threads in %.2f s, %u failed\n", inputs.count, threads_count,
+           now_seconds() - start, job.failed);
+
+    pthread_mutex_destroy(&job.lock);
+    for (size_t i = 0; i < inputs.count; i++)
+        free(inputs.paths[i]);
+    free(inputs.paths);
+    free(threads);
+    return job.failed != 0;
+}
+
+/***************
+ *   Lookup    *
+ ***************/
+
+static void lookup_addr(const DwrfSymIndex *index, uint64_t addr)
+{
+    DwrfIndexSymbol sym;
+    DwrfLineRow row;
+    const char *file;
+    uint64_t unit;
+
+    printf("0x%" PRIx64 ":", addr);
+    if (dwarf_sym_index_symbol(index, addr, &sym) == DWRF_OK)
+        printf(" %s+0x%" PRIx64, sym.Name, addr - sym.Address);
+    else
+        printf(" ??");
+
+    if (dwarf_sym_index_line(index, addr, &row, &file) == DWRF_OK)
+        printf(" at %s:%" PRIu32 ":%u", file ? file : "??", row.Line, (unsigned)row.Column);
+    if (dwarf_sym_index_unit(index, addr, &unit) == DWRF_OK)
+        printf(" (unit 0x%" PRIx64 ")", unit);
+    printf("\n");
+}
+
+static void lookup_name(const DwrfSymIndex *index, const char *name)
+{
+    DwrfIndexSymbol sym;
+
+    if (dwarf_sym_index_find_symbol(index, name, &sym) == DWRF_OK)
+        printf("%s: 0x%" PRIx64 " size %" PRIu64 "\n", name, sym.Address, sym.Size);
+    else
+        printf("%s: not found\n", name);
+}
+
+static int cmd_lookup(int argc, char **argv)
+{
+    const uint8_t *data;
+    uint64_t size;
+    DwrfSymIndex *index;
+    DwrfSymIndexInfo info;
+    DwrfResult res;
+    double start;
+
+    if (argc < 1)
+    {
+        fprintf(stderr, "Usage: symindex lookup <index> <0xaddress|symbol>...\n");
+        return 1;
+    }
+
+    if ((data = map_file(argv[0], &size)) == NULL)
+    {
+        fprintf(stderr, "%s: cannot map the file\n", argv[0]);
+        return 1;
+    }
+
+    start = now_seconds();
+    if ((res = dwarf_sym_index_open(data, size, &index)) != DWRF_OK)
+    {
+        fprintf(stderr, "%s: invalid index (%d)\n", argv[0], res);
+        munmap((void *)data, (size_t)size);
+        return 1;
+    }
+
+    dwarf_sym_index_info(index, &info);
+    printf("%s: %" PRIu64 " symbols, %" PRIu64 " units, %" PRIu64 " rows, %" PRIu64 " files, opened in %.2f ms\n",
+           argv[0], info.Symbols, info.Units, info.Rows, info.Files, (now_seconds() - start) * 1e3);
+
+    for (int a = 1; a < argc; a++)
+    {
+        char *end;
+
+        /* addresses need the 0x prefix, "add" is a valid symbol name */
+        if ((strncmp(argv[a], "0x", 2) == 0) && (strtoull(argv[a], &end, 16), *end == '\0'))
+            lookup_addr(index, strtoull(argv[a], NULL, 16));
+        else
+            lookup_name(index, argv[a]);
+    }
+
+    dwarf_sym_index_destroy(index);
+    munmap((void *)data, (size_t)size);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if ((argc >= 2) && (strcmp(argv[1], "build") == 0))
+        return cmd_build(argc - 2, argv + 2);
+    if ((argc >= 2) && (strcmp(argv[1], "lookup") == 0))
+        return cmd_lookup(argc - 2, argv + 2);
+
+    fprintf(stderr, "Usage: %s build [-j threads] <out-dir> <file-or-dir>...\n", argv[0]);
+    fprintf(stderr, "       %s lookup <index> <0xaddress|symbol>...\n", argv[0]);
+    return 1;
+}
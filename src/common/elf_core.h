@@ -74,7 +74,14 @@ typedef struct
 
         typedef enum ElfMachine
         {
-                EM_NONE = 0,
+                EM_NONE    = 0,
+                EM_386     = 3,   // Intel 80386
+                EM_PPC     = 20,  // PowerPC
+                EM_PPC64   = 21,  // 64-bit PowerPC
+                EM_ARM     = 40,  // 32-bit Arm
+                EM_X86_64  = 62,  // AMD x86-64
+                EM_AARCH64 = 183, // 64-bit Arm
+                EM_RISCV   = 243, // RISC-V
 
                 /* You may add your application-specific machines here */
 
@@ -123,8 +130,8 @@ typedef struct
                 uint16_t PHEntrySize;   // Size of one entry in the program header table
                 uint16_t PHEntryNum;    // Number of entries in the program header table
                 uint16_t SHEntrySize;   // Size of one entry in the section header table
-                uint16_t SHEntryNum;    // Number of entries in the section header table
-                uint16_t SecStrIndx;    // Index of the entry in the section table that points to the section names
+                uint32_t SHEntryNum;    // Number of entries in the section header table (extended numbering resolved)
+                uint32_t SecStrIndx;    // Index of the entry in the section table that points to the section names
         } ElfHeader;
 
 /****************
@@ -293,6 +300,20 @@ typedef struct
                 uint64_t Size;         // Size of the referenced entity (bytes or required allocation)
         } ElfSymTabEntry;
 
+
+/***************
+ * Relocations *
+ ***************/
+        /**
+         * @brief Abstract view of a REL or RELA entry, the meaning of Type depends on the machine.
+         */
+        typedef struct
+        {
+                uint64_t Offset;       // Location to patch, section offset in relocatable files, address otherwise
+                uint32_t Symbol;       // Index in the associated symbol table (0 = no symbol)
+                uint32_t Type;         // Machine specific relocation type
+                int64_t  Addend;       // Explicit addend of RELA entries, 0 for REL ones
+        } ElfRelocation;
     
 /****************
  *   Segments   *
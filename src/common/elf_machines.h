@@ -1,6 +1,131 @@
 #ifndef _ELF_MACHINES
 #define _ELF_MACHINES
 
-//TODO:
+/**
+ * Machine specific values, from the psABI of each architecture.
+ */
 
-#endif // include guard;
\ No newline at end of file
+/***************
+ *   x86-64    *
+ ***************/
+        typedef enum ElfRelocX86_64
+        {
+                R_X86_64_NONE           = 0,
+                R_X86_64_64             = 1,  // S + A
+                R_X86_64_PC32           = 2,  // S + A - P
+                R_X86_64_GOT32          = 3,
+                R_X86_64_PLT32          = 4,  // L + A - P
+                R_X86_64_COPY           = 5,
+                R_X86_64_GLOB_DAT       = 6,
+                R_X86_64_JUMP_SLOT      = 7,
+                R_X86_64_RELATIVE       = 8,
+                R_X86_64_GOTPCREL       = 9,
+                R_X86_64_32             = 10, // S + A, zero extended
+                R_X86_64_32S            = 11, // S + A, sign extended
+                R_X86_64_16             = 12,
+                R_X86_64_PC16           = 13,
+                R_X86_64_8              = 14,
+                R_X86_64_PC8            = 15,
+                R_X86_64_DTPMOD64       = 16,
+                R_X86_64_DTPOFF64       = 17,
+                R_X86_64_TPOFF64        = 18,
+                R_X86_64_TLSGD          = 19,
+                R_X86_64_TLSLD          = 20,
+                R_X86_64_DTPOFF32       = 21,
+                R_X86_64_GOTTPOFF       = 22,
+                R_X86_64_TPOFF32        = 23,
+                R_X86_64_PC64           = 24,
+                R_X86_64_GOTOFF64       = 25,
+                R_X86_64_GOTPC32        = 26,
+                R_X86_64_SIZE32         = 32,
+                R_X86_64_SIZE64         = 33,
+                R_X86_64_IRELATIVE      = 37,
+                R_X86_64_GOTPCRELX      = 41, // GOTPCREL that may be relaxed
+                R_X86_64_REX_GOTPCRELX  = 42,
+        } ElfRelocX86_64;
+
+/***************
+ *   AArch64   *
+ ***************/
+        typedef enum ElfRelocAArch64
+        {
+                R_AARCH64_NONE                  = 0,
+                R_AARCH64_NONE_OLD              = 256, // Withdrawn, still found in old objects
+                R_AARCH64_ABS64                 = 257,
+                R_AARCH64_ABS32                 = 258,
+                R_AARCH64_ABS16                 = 259,
+                R_AARCH64_PREL64                = 260,
+                R_AARCH64_PREL32                = 261,
+                R_AARCH64_PREL16                = 262,
+                R_AARCH64_MOVW_UABS_G0          = 263,
+                R_AARCH64_MOVW_UABS_G0_NC       = 264,
+                R_AARCH64_MOVW_UABS_G1          = 265,
+                R_AARCH64_MOVW_UABS_G1_NC       = 266,
+                R_AARCH64_MOVW_UABS_G2          = 267,
+                R_AARCH64_MOVW_UABS_G2_NC       = 268,
+                R_AARCH64_MOVW_UABS_G3          = 269,
+                R_AARCH64_ADR_PREL_LO21         = 274,
+                R_AARCH64_ADR_PREL_PG_HI21      = 275,
+                R_AARCH64_ADR_PREL_PG_HI21_NC   = 276,
+                R_AARCH64_ADD_ABS_LO12_NC       = 277,
+                R_AARCH64_LDST8_ABS_LO12_NC     = 278,
+                R_AARCH64_TSTBR14               = 279,
+                R_AARCH64_CONDBR19              = 280,
+                R_AARCH64_JUMP26                = 282,
+                R_AARCH64_CALL26                = 283,
+                R_AARCH64_LDST16_ABS_LO12_NC    = 284,
+                R_AARCH64_LDST32_ABS_LO12_NC    = 285,
+                R_AARCH64_LDST64_ABS_LO12_NC    = 286,
+                R_AARCH64_LDST128_ABS_LO12_NC   = 299,
+                R_AARCH64_ADR_GOT_PAGE          = 311,
+                R_AARCH64_LD64_GOT_LO12_NC      = 312,
+                R_AARCH64_COPY                  = 1024,
+                R_AARCH64_GLOB_DAT              = 1025,
+                R_AARCH64_JUMP_SLOT             = 1026,
+                R_AARCH64_RELATIVE              = 1027,
+        } ElfRelocAArch64;
+
+/***************
+ *   RISC-V    *
+ ***************/
+        typedef enum ElfRelocRiscV
+        {
+                R_RISCV_NONE            = 0,
+                R_RISCV_32              = 1,
+                R_RISCV_64              = 2,
+                R_RISCV_RELATIVE        = 3,
+                R_RISCV_COPY            = 4,
+                R_RISCV_JUMP_SLOT       = 5,
+                R_RISCV_BRANCH          = 16, // B-type, 13-bit PC relative
+                R_RISCV_JAL             = 17, // J-type, 21-bit PC relative
+                R_RISCV_CALL            = 18, // auipc + jalr pair
+                R_RISCV_CALL_PLT        = 19,
+                R_RISCV_GOT_HI20        = 20,
+                R_RISCV_PCREL_HI20      = 23, // auipc
+                R_RISCV_PCREL_LO12_I    = 24, // S is the auipc of the matching PCREL_HI20
+                R_RISCV_PCREL_LO12_S    = 25,
+                R_RISCV_HI20            = 26, // lui
+                R_RISCV_LO12_I          = 27,
+                R_RISCV_LO12_S          = 28,
+                R_RISCV_ADD8            = 33, // V + S + A, in place
+                R_RISCV_ADD16           = 34,
+                R_RISCV_ADD32           = 35,
+                R_RISCV_ADD64           = 36,
+                R_RISCV_SUB8            = 37, // V - S - A, in place
+                R_RISCV_SUB16           = 38,
+                R_RISCV_SUB32           = 39,
+                R_RISCV_SUB64           = 40,
+                R_RISCV_ALIGN           = 43, // Padding the linker may shrink
+                R_RISCV_RVC_BRANCH      = 44, // c.beqz, c.bnez
+                R_RISCV_RVC_JUMP        = 45, // c.j
+                R_RISCV_RELAX           = 51, // The instruction may be relaxed
+                R_RISCV_SUB6            = 52,
+                R_RISCV_SET6            = 53,
+                R_RISCV_SET8            = 54,
+                R_RISCV_SET16           = 55,
+                R_RISCV_SET32           = 56,
+                R_RISCV_32_PCREL        = 57,
+                R_RISCV_PLT32           = 59,
+        } ElfRelocRiscV;
+
+#endif // include guard;
@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ * Addr index  *
+ ***************/
+ // section 6.1.2 of spec v5
+
+#define ADDR_INDEX_MAGIC   0x49415744u  // "DWAI" in memory on little endian hosts
+#define ADDR_INDEX_VERSION 1u
+
+struct DwrfAddrIndex
+{
+        const DwrfAddrRange *ranges;
+        uint64_t count;
+        DwrfAddrRange *owned;   // NULL when the ranges live in a caller's blob
+};
+
+/** Layout of the serialized index, followed by count DwrfAddrRange */
+typedef struct
+{
+        uint32_t magic;
+        uint16_t version;
+        uint16_t range_size;    // sizeof(DwrfAddrRange), guards against layout changes
+        uint64_t count;
+} AddrIndexBlob;
+
+_Static_assert(sizeof(AddrIndexBlob) % 8 == 0, "ranges must stay aligned after the blob header");
+
+/** Growable array of ranges and the units already described */
+typedef struct
+{
+        DwrfAddrRange *ranges;
+        uint64_t count;
+        uint64_t cap;
+        DwrfMap covered;        // units with .debug_aranges entries
+        uint64_t unit;          // unit of the ranges being added
+} AddrBuilder;
+
+static DwrfResult addr_push(void *user, uint64_t low, uint64_t high)
+{
+        AddrBuilder *ab = user;
+
+        if (low >= high)
+                return DWRF_OK;
+
+        if (ab->count == ab->cap)
+        {
+                uint64_t cap = ab->cap ? ab->cap * 2 : 64;
+                DwrfAddrRange *ranges = realloc(ab->ranges, (size_t)cap * sizeof(DwrfAddrRange));
+                if (ranges == NULL)
+                        return DWRF_NO_MEM;
+                ab->ranges = ranges;
+                ab->cap = cap;
+        }
+
+        ab->ranges[ab->count++] = (DwrfAddrRange){ low, high, ab->unit };
+        return DWRF_OK;
+}
+
+/** Reads every set of .debug_aranges, section 6.1.2 */
+static DwrfResult addr_read_aranges(InternalDwarfCtx *ctx, AddrBuilder *ab)
+{
+        const DwrfSection *sec = &ctx->debug_aranges;
+        uint64_t off = 0;
+        DwrfResult res;
+
+        if ((res = dwrf_load_section(ctx, &ctx->debug_aranges)))
+                return res;
+
+        while (off < sec->hdr.Size)
+        {
+                DwrfBuf b = buf_make(ctx, sec, off, sec->hdr.Size);
+                uint64_t length, version, unit, addr_size, seg_size, tuple;
+                uint8_t offset_size = 4;
+
+                if ((res = buf_uN(&b, 4, &length)))
+                        return res;
+                if (length == 0xFFFFFFFFu)
+                {
+                        offset_size = 8;
+                        if ((res = buf_uN(&b, 8, &length)))
+                                return res;
+                }
+                else if (length >= 0xFFFFFFF0u)
+                        return DWRF_DECODE_ERR;
+
+                if (length > buf_left(&b))
+                        return DWRF_DECODE_ERR;
+                b.end = b.p + length;
+
+                if ((res = buf_uN(&b, 2, &version)) || (res = buf_uN(&b, offset_size, &unit)) ||
+                    (res = buf_uN(&b, 1, &addr_size)) || (res = buf_uN(&b, 1, &seg_size)))
+                        return res;
+
+                if (version != 2)
+                        return DWRF_UNSUPPORTED;
+                if ((addr_size == 0) || (addr_size > 8) || (seg_size > 8))
+                        return DWRF_DECODE_ERR;
+
+                /* the tuples are aligned to their own size from the start of the set */
+                tuple = 2 * addr_size + seg_size;
+                {
+                        uint64_t used = (uint64_t)(b.p - (sec->data + off));
+                        uint64_t align = 2 * addr_size;
+                        if ((res = buf_skip(&b, (align - used % align) % align)))
+                                return res;
+                }
+
+                ab->unit = unit;
+                while (buf_left(&b) >= tuple)
+                {
+                        uint64_t addr, len;
+
+                        if ((res = buf_skip(&b, seg_size)) || (res = buf_uN(&b, (uint8_t)addr_size, &addr)) ||
+                            (res = buf_uN(&b, (uint8_t)addr_size, &len)))
+                                return res;
+
+                        if ((addr == 0) && (len == 0))
+                                break;
+                        if ((res = addr_push(ab, addr, addr + len)))
+                                return res;
+                }
+
+                if ((res = dwrf_map_put(&ab->covered, unit, ab)))
+                        return res;
+                off = (uint64_t)(b.end - sec->data);
+        }
+        return DWRF_OK;
+}
+
+/** Ranges of the unit DIE: DW_AT_low_pc with DW_AT_high_pc, or DW_AT_ranges. */
+static DwrfResult addr_read_unit_die(DwrfCtx *ctx, DwrfCursor *cur, const DwrfUnitHeader *unit, AddrBuilder *ab)
+{
+        enum { LOW, HIGH, RANGES, COUNT };
+        static const uint16_t names[COUNT] = { DW_AT_low_pc, DW_AT_high_pc, DW_AT_ranges };
+        const DwrfUnitBases *bases;
+        DwrfAttr attrs[COUNT];
+        DwrfResult res;
+
+        if ((res = dwarf_cursor_seek_unit(cur, unit->Offset)) || (res = dwarf_cursor_next(cur, NULL)) ||
+            (res = dwarf_cursor_get_attrs(cur, names, COUNT, attrs)))
+                return (res == DWRF_END) ? DWRF_OK : res;
+
+        if ((res = dwrf_unit_bases(CTX(ctx), unit, &bases)))
+                return res;
+        ab->unit = unit->Offset;
+
+        if (attrs[RANGES].Form != 0)
+        {
+                if ((res = dwarf_cursor_resolve(cur, &attrs[RANGES])))
+                        return res;
+                return dwrf_ranges_for_each(CTX(ctx), bases, attrs[RANGES].Value, addr_push, ab);
+        }
+
+        if ((attrs[LOW].Form != 0) && (attrs[HIGH].Form != 0))
+        {
+                if ((res = dwarf_cursor_resolve(cur, &attrs[HIGH])))
+                        return res;
+
+                /* the address class is absolute, constants are an offset from low_pc */
+                if (attrs[HIGH].Form != DW_FORM_addr)
+                        attrs[HIGH].Value += bases->low_pc;
+
+                return addr_push(ab, bases->low_pc, attrs[HIGH].Value);
+        }
+        return DWRF_OK;
+}
+
+static int addr_range_cmp(const void *a, const void *b)
+{
+        const DwrfAddrRange *x = a;
+        const DwrfAddrRange *y = b;
+
+        if (x->Low != y->Low)
+                return (x->Low > y->Low) ? 1 : -1;
+        if (x->UnitOffset != y->UnitOffset)
+                return (x->UnitOffset > y->UnitOffset) ? 1 : -1;
+        return (x->High > y->High) - (x->High < y->High);
+}
+
+/**
+ * Sorts the ranges and makes them disjoint: contiguous or overlapping ranges of a unit are
+ * merged, addresses claimed by several units stay with the range that starts first.
+ * @return Number of ranges kept.
+ */
+static uint64_t addr_normalize(DwrfAddrRange *ranges, uint64_t count)
+{
+        uint64_t kept = 0;
+
+        qsort(ranges, (size_t)count, sizeof(DwrfAddrRange), addr_range_cmp);
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+                DwrfAddrRange r = ranges[i];
+
+                if (kept)
+                {
+                        DwrfAddrRange *last = &ranges[kept - 1];
+
+                        if ((r.UnitOffset == last->UnitOffset) && (r.Low <= last->High))
+                        {
+                                if (r.High > last->High)
+                                        last->High = r.High;
+                                continue;
+                        }
+
+                        if (r.Low < last->High)
+                                r.Low = last->High;
+                        if (r.Low >= r.High)
+                                continue;
+                }
+                ranges[kept++] = r;
+        }
+        return kept;
+}
+
+DwrfResult dwrf_addr_index_make(DwrfAddrRange *ranges, uint64_t count, DwrfAddrIndex **index)
+{
+        DwrfAddrIndex *idx;
+
+        idx = malloc(sizeof(DwrfAddrIndex));
+        if (idx == NULL)
+        {
+                free(ranges);
+                return DWRF_NO_MEM;
+        }
+
+        idx->count = addr_normalize(ranges, count);
+        idx->ranges = ranges;
+        idx->owned = ranges;
+        *index = idx;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_addr_index_build(DwrfCtx *ctx, DwrfAddrIndex **index)
+{
+        AddrBuilder ab = {0};
+        DwrfCursor cur;
+        DwrfUnitHeader unit;
+        uint64_t off = 0;
+        DwrfResult res = DWRF_OK;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (index == NULL)
+                return DWRF_BAD_ARG;
+
+        if (CTX(ctx)->debug_aranges.present)
+                res = addr_read_aranges(CTX(ctx), &ab);
+
+        /* units without aranges */
+        dwarf_cursor_init(ctx, &cur);
+        while ((res == DWRF_OK) && ((res = dwarf_get_unit_header(ctx, off, &unit)) == DWRF_OK))
+        {
+                off = unit.NextOffset;
+
+                if ((unit.UnitType == DW_UT_type) || (unit.UnitType == DW_UT_split_type) ||
+                    (dwrf_map_get(&ab.covered, unit.Offset) != NULL))
+                        continue;
+
+                res = addr_read_unit_die(ctx, &cur, &unit, &ab);
+        }
+
+        /* BAD_ARG marks the end of the section */
+        dwrf_map_destroy(&ab.covered, NULL);
+        if (res != DWRF_BAD_ARG)
+        {
+                free(ab.ranges);
+                return res;
+        }
+
+        return dwrf_addr_index_make(ab.ranges, ab.count, index);
+}
+
+DwrfResult dwarf_addr_index_lookup(const DwrfAddrIndex *index, uint64_t addr, uint64_t *unit_offset)
+{
+        uint64_t lo = 0, hi;
+
+        if ((index == NULL) || (unit_offset == NULL))
+                return DWRF_BAD_ARG;
+
+        /* last range starting at or before addr */
+        hi = index->count;
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (index->ranges[mid].Low <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        if ((lo == 0) || (addr >= index->ranges[lo - 1].High))
+                return DWRF_NOT_FOUND;
+
+        *unit_offset = index->ranges[lo - 1].UnitOffset;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_addr_index_ranges(const DwrfAddrIndex *index, const DwrfAddrRange **ranges, uint64_t *count)
+{
+        if ((index == NULL) || (ranges == NULL) || (count == NULL))
+                return DWRF_BAD_ARG;
+
+        *ranges = index->ranges;
+        *count = index->count;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_addr_index_serialize(const DwrfAddrIndex *index, void *buff, uint64_t len, uint64_t *size)
+{
+        AddrIndexBlob hdr;
+        uint64_t total;
+
+        if ((index == NULL) || (size == NULL))
+                return DWRF_BAD_ARG;
+
+        total = sizeof(AddrIndexBlob) + index->count * sizeof(DwrfAddrRange);
+        *size = total;
+        if (buff == NULL)
+                return DWRF_OK;
+        if (len < total)
+                return DWRF_BUFFER_OVERFLOW;
+
+        hdr = (AddrIndexBlob){ ADDR_INDEX_MAGIC, ADDR_INDEX_VERSION, sizeof(DwrfAddrRange), index->count };
+        memcpy(buff, &hdr, sizeof(hdr));
+        if (index->count)
+                memcpy((uint8_t *)buff + sizeof(hdr), index->ranges, (size_t)(index->count * sizeof(DwrfAddrRange)));
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_addr_index_load(const void *blob, uint64_t size, DwrfAddrIndex **index)
+{
+        AddrIndexBlob hdr;
+        DwrfAddrIndex *idx;
+        const uint8_t *data = (const uint8_t *)blob + sizeof(AddrIndexBlob);
+
+        if ((blob == NULL) || (index == NULL))
+                return DWRF_BAD_ARG;
+
+        if (size < sizeof(AddrIndexBlob))
+                return DWRF_DECODE_ERR;
+
+        memcpy(&hdr, blob, sizeof(hdr));
+        if (hdr.magic != ADDR_INDEX_MAGIC)
+        {
+                /* a byte swapped magic is a blob from a host of the other endianness */
+                uint32_t m = hdr.magic;
+                m = (m >> 24) | ((m >> 8) & 0xFF00u) | ((m << 8) & 0xFF0000u) | (m << 24);
+                return (m == ADDR_INDEX_MAGIC) ? DWRF_UNSUPPORTED : DWRF_DECODE_ERR;
+        }
+        if ((hdr.version != ADDR_INDEX_VERSION) || (hdr.range_size != sizeof(DwrfAddrRange)))
+                return DWRF_UNSUPPORTED;
+        if (hdr.count > (size - sizeof(AddrIndexBlob)) / sizeof(DwrfAddrRange))
+                return DWRF_DECODE_ERR;
+
+        idx = malloc(sizeof(DwrfAddrIndex));
+        if (idx == NULL)
+                return DWRF_NO_MEM;
+
+        idx->count = hdr.count;
+        idx->owned = NULL;
+        if (((uintptr_t)data % _Alignof(DwrfAddrRange)) == 0)
+                idx->ranges = (const DwrfAddrRange *)data;
+        else
+        {
+                idx->owned = malloc((size_t)(hdr.count * sizeof(DwrfAddrRange)) + 1);
+                if (idx->owned == NULL)
+                {
+                        free(idx);
+                        return DWRF_NO_MEM;
+                }
+                memcpy(idx->owned, data, (size_t)(hdr.count * sizeof(DwrfAddrRange)));
+                idx->ranges = idx->owned;
+        }
+
+        *index = idx;
+        return DWRF_OK;
+}
+
+void dwarf_addr_index_destroy(DwrfAddrIndex *index)
+{
+        if (index == NULL)
+                return;
+
+        free(index->owned);
+        free(index);
+}
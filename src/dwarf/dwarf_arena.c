@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(DWRF_NO_THREADS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // pthreads
+#endif
+
+#include "dwarf_internal.h"
+
+#ifndef DWRF_NO_THREADS
+#include <pthread.h>
+#endif
+
+/***************
+ *   Arenas    *
+ ***************/
+
+/* Chunks are linked through a header, allocations start after it at the arena alignment */
+struct DwrfArenaChunk
+{
+        struct DwrfArenaChunk *next;
+        size_t size;            // bytes after the header
+};
+
+#define DWRF_ARENA_ALIGN  _Alignof(max_align_t)
+#define DWRF_ARENA_HEADER ((sizeof(struct DwrfArenaChunk) + DWRF_ARENA_ALIGN - 1) & ~(DWRF_ARENA_ALIGN - 1))
+#define DWRF_ARENA_CHUNK  (64u * 1024u)
+
+void dwrf_arena_init(DwrfArena *arena)
+{
+        *arena = (DwrfArena){0};
+}
+
+void dwrf_arena_init_sized(DwrfArena *arena, size_t size)
+{
+        *arena = (DwrfArena){0};
+        arena->first = size;
+}
+
+size_t dwrf_arena_size(size_t size)
+{
+        size = (size + DWRF_ARENA_ALIGN - 1) & ~(DWRF_ARENA_ALIGN - 1);
+        return (size == 0) ? DWRF_ARENA_ALIGN : size;
+}
+
+void *dwarf_arena_alloc(DwrfArena *arena, size_t size)
+{
+        size_t chunk;
+
+        if (arena == NULL)
+                return NULL;
+
+        size = dwrf_arena_size(size);
+        if (size <= (size_t)(arena->end - arena->cur))
+        {
+                void *p = arena->cur;
+                arena->cur += size;
+                arena->used += size;
+                return p;
+        }
+
+        /* large requests get a chunk of their own, the current chunk keeps serving the small ones */
+        chunk = (size > DWRF_ARENA_CHUNK / 4) ? size : DWRF_ARENA_CHUNK;
+        if (arena->first >= size)
+                chunk = arena->first;
+        arena->first = 0;
+        if (chunk > SIZE_MAX - DWRF_ARENA_HEADER)
+                return NULL;
+
+        struct DwrfArenaChunk *c = malloc(DWRF_ARENA_HEADER + chunk);
+        if (c == NULL)
+                return NULL;
+
+        uint8_t *data = (uint8_t *)c + DWRF_ARENA_HEADER;
+        c->size = chunk;
+        c->next = arena->chunks;
+        arena->chunks = c;
+        arena->reserved += chunk;
+        arena->used += size;
+
+        if (chunk != size)
+        {
+                arena->cur = data + size;
+                arena->end = data + chunk;
+        }
+        return data;
+}
+
+void dwrf_arena_unwind(DwrfArena *arena, void *last, size_t size)
+{
+        struct DwrfArenaChunk *c = arena->chunks;
+
+        size = dwrf_arena_size(size);
+        if ((uint8_t *)last + size == arena->cur)
+        {
+                arena->cur = last;
+                arena->used -= size;
+        }
+        else if ((c != NULL) && ((uint8_t *)c + DWRF_ARENA_HEADER == last) && (c->size == size))
+        {
+                /* a chunk of its own, the current one is further down the list */
+                arena->chunks = c->next;
+                arena->reserved -= c->size;
+                arena->used -= size;
+                free(c);
+        }
+}
+
+void dwrf_arena_destroy(DwrfArena *arena)
+{
+        struct DwrfArenaChunk *c = arena->chunks;
+
+        while (c != NULL)
+        {
+                struct DwrfArenaChunk *next = c->next;
+                free(c);
+                c = next;
+        }
+        *arena = (DwrfArena){0};
+}
+
+/***************
+ *   Budgets   *
+ ***************/
+
+#ifndef DWRF_NO_THREADS
+typedef pthread_mutex_t BudgetLock;
+#define budget_lock_init(l)    pthread_mutex_init((l), NULL)
+#define budget_lock_destroy(l) pthread_mutex_destroy(l)
+#define budget_lock(l)         pthread_mutex_lock(l)
+#define budget_unlock(l)       pthread_mutex_unlock(l)
+#else
+typedef uint8_t BudgetLock;
+#define budget_lock_init(l)    ((void)(l))
+#define budget_lock_destroy(l) ((void)(l))
+#define budget_lock(l)         ((void)(l))
+#define budget_unlock(l)       ((void)(l))
+#endif
+
+struct DwrfMemBudget
+{
+        BudgetLock lock;
+        DwrfBudgetItem *head;   // most recently used
+        DwrfBudgetItem *tail;
+        uint64_t limit;         // 0 for no limit
+        uint64_t used;
+        uint64_t items;
+        uint64_t evictions;
+        uint32_t owners;
+};
+
+DwrfResult dwarf_mem_budget_create(uint64_t limit, DwrfMemBudget **budget)
+{
+        DwrfMemBudget *b;
+
+        if (budget == NULL)
+                return DWRF_BAD_ARG;
+
+        if ((b = calloc(1, sizeof(DwrfMemBudget))) == NULL)
+                return DWRF_NO_MEM;
+
+        budget_lock_init(&b->lock);
+        b->limit = limit;
+        *budget = b;
+        return DWRF_OK;
+}
+
+void dwarf_mem_budget_destroy(DwrfMemBudget *budget)
+{
+        if (budget == NULL)
+                return;
+
+        budget_lock_destroy(&budget->lock);
+        free(budget);
+}
+
+DwrfResult dwarf_mem_budget_set_limit(DwrfMemBudget *budget, uint64_t limit)
+{
+        if (budget == NULL)
+                return DWRF_BAD_ARG;
+
+        budget_lock(&budget->lock);
+        budget->limit = limit;
+        dwrf_budget_evict(budget);
+        budget_unlock(&budget->lock);
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_mem_budget_stats(DwrfMemBudget *budget, DwrfMemBudgetStats *stats)
+{
+        if ((budget == NULL) || (stats == NULL))
+                return DWRF_BAD_ARG;
+
+        budget_lock(&budget->lock);
+        stats->Limit = budget->limit;
+        stats->Used = budget->used;
+        stats->Units = budget->items;
+        stats->Evictions = budget->evictions;
+        stats->Owners = budget->owners;
+        budget_unlock(&budget->lock);
+        return DWRF_OK;
+}
+
+void dwrf_budget_lock(DwrfMemBudget *budget)
+{
+        budget_lock(&budget->lock);
+}
+
+void dwrf_budget_unlock(DwrfMemBudget *budget)
+{
+        budget_unlock(&budget->lock);
+}
+
+static void budget_unlink(DwrfMemBudget *budget, DwrfBudgetItem *item)
+{
+        if (item->prev)
+                item->prev->next = item->next;
+        else
+                budget->head = item->next;
+
+        if (item->next)
+                item->next->prev = item->prev;
+        else
+                budget->tail = item->prev;
+
+        item->prev = NULL;
+        item->next = NULL;
+}
+
+static void budget_push(DwrfMemBudget *budget, DwrfBudgetItem *item)
+{
+        item->prev = NULL;
+        item->next = budget->head;
+        if (budget->head)
+                budget->head->prev = item;
+        else
+                budget->tail = item;
+        budget->head = item;
+}
+
+void dwrf_budget_add(DwrfMemBudget *budget, DwrfBudgetItem *item)
+{
+        budget_push(budget, item);
+        budget->used += item->bytes;
+        budget->items++;
+}
+
+void dwrf_budget_touch(DwrfMemBudget *budget, DwrfBudgetItem *item)
+{
+        if (budget->head == item)
+                return;
+
+        budget_unlink(budget, item);
+        budget_push(budget, item);
+}
+
+void dwrf_budget_remove(DwrfMemBudget *budget, DwrfBudgetItem *item)
+{
+        budget_unlink(budget, item);
+        budget->used -= item->bytes;
+        budget->items--;
+}
+
+void dwrf_budget_evict(DwrfMemBudget *budget)
+{
+        DwrfBudgetItem *item = budget->tail;
+
+        while ((budget->limit != 0) && (budget->used > budget->limit) && (item != NULL))
+        {
+                DwrfBudgetItem *prev = item->prev;
+
+                if (item->refs == 0)
+                {
+                        dwrf_budget_remove(budget, item);
+                        budget->evictions++;
+                        item->evict(item);
+                }
+                item = prev;
+        }
+}
+
+void dwrf_budget_attach(DwrfMemBudget *budget)
+{
+        budget->owners++;
+}
+
+void dwrf_budget_detach(DwrfMemBudget *budget)
+{
+        budget->owners--;
+}
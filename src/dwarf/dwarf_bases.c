@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ * Unit bases  *
+ ***************/
+ // sections 3.1.1 and 7.26 to 7.29 of spec v5
+
+/*
+ * The tables the indexed forms point into are arrays of fixed size entries, so once the
+ * section is in memory (loaded or mapped with dwarf_set_image()) a lookup is a bound check
+ * and one load. The bases they are relative to live in the unit DIE; they are decoded
+ * once per unit and kept in the context.
+ */
+
+DwrfResult dwrf_table_entry(const InternalDwarfCtx *ctx, const DwrfSection *sec, uint64_t base, uint64_t index,
+                            uint8_t size, uint64_t *val)
+{
+        if ((size == 0) || (size > 8))
+                return DWRF_DECODE_ERR;
+        if (sec->data == NULL)
+                return sec->present ? DWRF_BAD_ARG : DWRF_SEC_MISSING;
+
+        if ((base > sec->hdr.Size) || (index >= (sec->hdr.Size - base) / size))
+                return DWRF_DECODE_ERR;
+
+        *val = load_uN(sec->data + base + index * size, size, ctx->endianness == ELFDATA2MSB);
+        return DWRF_OK;
+}
+
+/** Same as dwrf_table_entry(), loading the section first if needed. */
+static DwrfResult bases_load_entry(InternalDwarfCtx *ctx, DwrfSection *sec, uint64_t base, uint64_t index,
+                                   uint8_t size, uint64_t *val)
+{
+        DwrfResult res;
+
+        if ((sec->data == NULL) && sec->present && (res = dwrf_load_section(ctx, sec)))
+                return res;
+        return dwrf_table_entry(ctx, sec, base, index, size, val);
+}
+
+DwrfResult dwrf_read_strx(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t index, uint64_t *offset)
+{
+        return bases_load_entry(ctx, &ctx->debug_str_offsets, bases->str_offsets_base, index, bases->offset_size, offset);
+}
+
+DwrfResult dwrf_read_addrx(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t index, uint64_t *addr)
+{
+        return bases_load_entry(ctx, &ctx->debug_addr, bases->addr_base, index, bases->addr_size, addr);
+}
+
+/* entries of the offsets tables are relative to the table itself */
+
+DwrfResult dwrf_rnglistx_offset(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t index, uint64_t *offset)
+{
+        DwrfResult res = bases_load_entry(ctx, &ctx->debug_rnglists, bases->rnglists_base, index, bases->offset_size, offset);
+
+        if (res == DWRF_OK)
+                *offset += bases->rnglists_base;
+        return res;
+}
+
+DwrfResult dwrf_loclistx_offset(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t index, uint64_t *offset)
+{
+        DwrfResult res = bases_load_entry(ctx, &ctx->debug_loclists, bases->loclists_base, index, bases->offset_size, offset);
+
+        if (res == DWRF_OK)
+                *offset += bases->loclists_base;
+        return res;
+}
+
+/** Decodes the bases from the unit DIE, attributes that are missing keep their default. */
+static DwrfResult bases_read_unit_die(InternalDwarfCtx *ctx, const DwrfUnitHeader *unit, DwrfUnitBases *bases)
+{
+        enum { LOW, STR_OFFSETS, ADDR, RNGLISTS, LOCLISTS, GNU_ADDR, COUNT };
+        static const uint16_t names[COUNT] = {
+                DW_AT_low_pc, DW_AT_str_offsets_base, DW_AT_addr_base, DW_AT_rnglists_base,
+                DW_AT_loclists_base, DW_AT_GNU_addr_base
+        };
+        uint64_t *fields[COUNT] = {
+                &bases->low_pc, &bases->str_offsets_base, &bases->addr_base, &bases->rnglists_base,
+                &bases->loclists_base, &bases->addr_base
+        };
+        DwrfAttr attrs[COUNT];
+        DwrfCursor cur;
+        DwrfResult res;
+
+        /* the cursor's window lives on the stack, nothing is allocated */
+        if ((res = dwarf_cursor_init((DwrfCtx *)ctx, &cur)) || (res = dwarf_cursor_seek_unit(&cur, unit->Offset)) ||
+            (res = dwarf_cursor_next(&cur, NULL)) || (res = dwarf_cursor_get_attrs(&cur, names, COUNT, attrs)))
+                return (res == DWRF_END) ? DWRF_OK : res; // a unit without DIEs has nothing to override
+
+        for (uint32_t i = 0; i < COUNT; i++)
+        {
+                if (attrs[i].Form != 0)
+                        *fields[i] = attrs[i].Value;
+        }
+
+        /* low_pc may itself be an index, resolved once the address base is known */
+        if ((attrs[LOW].Form != 0) && (attrs[LOW].Form != DW_FORM_addr))
+                return dwrf_read_addrx(ctx, bases, attrs[LOW].Value, &bases->low_pc);
+        return DWRF_OK;
+}
+
+DwrfResult dwrf_unit_bases(InternalDwarfCtx *ctx, const DwrfUnitHeader *unit, const DwrfUnitBases **bases)
+{
+        DwrfUnitBases *b = dwrf_map_get(&ctx->unit_bases, unit->Offset);
+        DwrfResult res;
+
+        if (b != NULL)
+        {
+                *bases = b;
+                return DWRF_OK;
+        }
+
+        if ((b = dwarf_arena_alloc(&ctx->arena, sizeof(DwrfUnitBases))) == NULL)
+                return DWRF_NO_MEM;
+        *b = (DwrfUnitBases){0};
+
+        b->version = unit->Version;
+        b->addr_size = unit->AddrSize;
+        b->offset_size = unit->OffsetSize;
+
+        /*
+         * Split units carry no base attributes, their tables start right after the header
+         * of their contribution: 8 or 16 bytes, plus the offset entry count for the lists.
+         */
+        if (unit->Version >= 5)
+        {
+                uint64_t hdr = (unit->OffsetSize == 8) ? 16 : 8;
+
+                b->str_offsets_base = hdr;
+                b->addr_base = hdr;
+                b->rnglists_base = hdr + 4;
+                b->loclists_base = hdr + 4;
+        }
+
+        /* the addresses of a split unit are in the skeleton's .debug_addr */
+        if (ctx->linked && ((unit->UnitType == DW_UT_split_compile) || (unit->UnitType == DW_UT_split_type)))
+                b->addr_base = ctx->skeleton_addr_base;
+
+        if ((res = bases_read_unit_die(ctx, unit, b)) || (res = dwrf_map_put(&ctx->unit_bases, unit->Offset, b)))
+        {
+                dwrf_arena_unwind(&ctx->arena, b, sizeof(DwrfUnitBases));
+                return res;
+        }
+
+        *bases = b;
+        return DWRF_OK;
+}
@@ -20,9 +20,104 @@
  * SOFTWARE.
  */
 
-#ifndef DWARF__ATTRLIB
+#ifndef DWARF_ATTR_LIB
 #define DWARF_ATTR_LIB
 
+typedef enum
+{
+    DW_UT_compile                   = 0x01,
+    DW_UT_type                      = 0x02,
+    DW_UT_partial                   = 0x03,
+    DW_UT_skeleton                  = 0x04,
+    DW_UT_split_compile             = 0x05,
+    DW_UT_split_type                = 0x06,
+
+    DW_UT_lo_user                   = 0x80,
+    DW_UT_hi_user                   = 0xff
+} DwrfUnitType;
+
+typedef enum
+{
+    DW_TAG_array_type               = 0x01,
+    DW_TAG_class_type               = 0x02,
+    DW_TAG_entry_point              = 0x03,
+    DW_TAG_enumeration_type         = 0x04,
+    DW_TAG_formal_parameter         = 0x05,
+    /* 0x06 reserved */
+    /* 0x07 reserved */
+    DW_TAG_imported_declaration     = 0x08,
+    /* 0x09 reserved */
+    DW_TAG_label                    = 0x0a,
+    DW_TAG_lexical_block            = 0x0b,
+    /* 0x0c reserved */
+    DW_TAG_member                   = 0x0d,
+    /* 0x0e reserved */
+    DW_TAG_pointer_type             = 0x0f,
+    DW_TAG_reference_type           = 0x10,
+    DW_TAG_compile_unit             = 0x11,
+    DW_TAG_string_type              = 0x12,
+    DW_TAG_structure_type           = 0x13,
+    /* 0x14 reserved */
+    DW_TAG_subroutine_type          = 0x15,
+    DW_TAG_typedef                  = 0x16,
+    DW_TAG_union_type               = 0x17,
+    DW_TAG_unspecified_parameters   = 0x18,
+    DW_TAG_variant                  = 0x19,
+    DW_TAG_common_block             = 0x1a,
+    DW_TAG_common_inclusion         = 0x1b,
+    DW_TAG_inheritance              = 0x1c,
+    DW_TAG_inlined_subroutine       = 0x1d,
+    DW_TAG_module                   = 0x1e,
+    DW_TAG_ptr_to_member_type       = 0x1f,
+    DW_TAG_set_type                 = 0x20,
+    DW_TAG_subrange_type            = 0x21,
+    DW_TAG_with_stmt                = 0x22,
+    DW_TAG_access_declaration       = 0x23,
+    DW_TAG_base_type                = 0x24,
+    DW_TAG_catch_block              = 0x25,
+    DW_TAG_const_type               = 0x26,
+    DW_TAG_constant                 = 0x27,
+    DW_TAG_enumerator               = 0x28,
+    DW_TAG_file_type                = 0x29,
+    DW_TAG_friend                   = 0x2a,
+    DW_TAG_namelist                 = 0x2b,
+    DW_TAG_namelist_item            = 0x2c,
+    DW_TAG_packed_type              = 0x2d,
+    DW_TAG_subprogram               = 0x2e,
+    DW_TAG_template_type_parameter  = 0x2f,
+    DW_TAG_template_value_parameter = 0x30,
+    DW_TAG_thrown_type              = 0x31,
+    DW_TAG_try_block                = 0x32,
+    DW_TAG_variant_part             = 0x33,
+    DW_TAG_variable                 = 0x34,
+    DW_TAG_volatile_type            = 0x35,
+    DW_TAG_dwarf_procedure          = 0x36,
+    DW_TAG_restrict_type            = 0x37,
+    DW_TAG_interface_type           = 0x38,
+    DW_TAG_namespace                = 0x39,
+    DW_TAG_imported_module          = 0x3a,
+    DW_TAG_unspecified_type         = 0x3b,
+    DW_TAG_partial_unit             = 0x3c,
+    DW_TAG_imported_unit            = 0x3d,
+    /* 0x3e reserved */
+    DW_TAG_condition                = 0x3f,
+    DW_TAG_shared_type              = 0x40,
+    DW_TAG_type_unit                = 0x41,
+    DW_TAG_rvalue_reference_type    = 0x42,
+    DW_TAG_template_alias           = 0x43,
+    DW_TAG_coarray_type             = 0x44,
+    DW_TAG_generic_subrange         = 0x45,
+    DW_TAG_dynamic_type             = 0x46,
+    DW_TAG_atomic_type              = 0x47,
+    DW_TAG_call_site                = 0x48,
+    DW_TAG_call_site_parameter      = 0x49,
+    DW_TAG_skeleton_unit            = 0x4a,
+    DW_TAG_immutable_type           = 0x4b,
+
+    DW_TAG_lo_user                  = 0x4080,
+    DW_TAG_hi_user                  = 0xffff
+} DwrfTag;
+
 typedef enum {
         DW_CHILDREN_no  = 0x00,
         DW_CHILDREN_yes = 0x01
@@ -172,6 +267,16 @@ typedef enum
     DW_AT_loclists_base             = 0x8c,
 
     DW_AT_lo_user                   = 0x2000,
+
+    /* pre-standard DW_AT_linkage_name, emitted by older GCC releases */
+    DW_AT_MIPS_linkage_name         = 0x2007,
+
+    /* pre-standard split DWARF, emitted by GCC for -gsplit-dwarf -gdwarf-4 */
+    DW_AT_GNU_dwo_name              = 0x2130,
+    DW_AT_GNU_dwo_id                = 0x2131,
+    DW_AT_GNU_ranges_base           = 0x2132,
+    DW_AT_GNU_addr_base             = 0x2133,
+
     DW_AT_hi_user                   = 0x3fff
 } DwrfAttrName;
 
@@ -220,7 +325,291 @@ typedef enum
     DW_FORM_addrx1          = 0x29,
     DW_FORM_addrx2          = 0x2a,
     DW_FORM_addrx3          = 0x2b,
-    DW_FORM_addrx4          = 0x2c
+    DW_FORM_addrx4          = 0x2c,
+
+    /* GNU extensions, DW_FORM_addrx, strx, ref_sup4 and strp_sup before DWARF 5 */
+    DW_FORM_GNU_addr_index  = 0x1f01,
+    DW_FORM_GNU_str_index   = 0x1f02,
+    DW_FORM_GNU_ref_alt     = 0x1f20,
+    DW_FORM_GNU_strp_alt    = 0x1f21
 } DwrfForm;
 
+typedef enum
+{
+    DW_LNS_copy                     = 0x01,
+    DW_LNS_advance_pc               = 0x02,
+    DW_LNS_advance_line             = 0x03,
+    DW_LNS_set_file                 = 0x04,
+    DW_LNS_set_column               = 0x05,
+    DW_LNS_negate_stmt              = 0x06,
+    DW_LNS_set_basic_block          = 0x07,
+    DW_LNS_const_add_pc             = 0x08,
+    DW_LNS_fixed_advance_pc         = 0x09,
+    DW_LNS_set_prologue_end         = 0x0a,
+    DW_LNS_set_epilogue_begin       = 0x0b,
+    DW_LNS_set_isa                  = 0x0c
+} DwrfLineStdOp;
+
+typedef enum
+{
+    DW_LNE_end_sequence             = 0x01,
+    DW_LNE_set_address              = 0x02,
+    DW_LNE_define_file              = 0x03, // DWARF 4 and earlier
+    DW_LNE_set_discriminator        = 0x04,
+
+    DW_LNE_lo_user                  = 0x80,
+    DW_LNE_hi_user                  = 0xff
+} DwrfLineExtOp;
+
+typedef enum
+{
+    DW_LNCT_path                    = 0x1,
+    DW_LNCT_directory_index         = 0x2,
+    DW_LNCT_timestamp               = 0x3,
+    DW_LNCT_size                    = 0x4,
+    DW_LNCT_MD5                     = 0x5,
+
+    DW_LNCT_lo_user                 = 0x2000,
+    DW_LNCT_hi_user                 = 0x3fff
+} DwrfLineContent;
+
+typedef enum
+{
+    DW_RLE_end_of_list              = 0x00,
+    DW_RLE_base_addressx            = 0x01,
+    DW_RLE_startx_endx              = 0x02,
+    DW_RLE_startx_length            = 0x03,
+    DW_RLE_offset_pair              = 0x04,
+    DW_RLE_base_address             = 0x05,
+    DW_RLE_start_end                = 0x06,
+    DW_RLE_start_length             = 0x07
+} DwrfRangeListEntry;
+
+typedef enum
+{
+    DW_LLE_end_of_list              = 0x00,
+    DW_LLE_base_addressx            = 0x01,
+    DW_LLE_startx_endx              = 0x02,
+    DW_LLE_startx_length            = 0x03,
+    DW_LLE_offset_pair              = 0x04,
+    DW_LLE_default_location         = 0x05,
+    DW_LLE_base_address             = 0x06,
+    DW_LLE_start_end                = 0x07,
+    DW_LLE_start_length             = 0x08,
+    DW_LLE_GNU_view_pair            = 0x09  // location views (GCC), two ULEB128 view numbers
+} DwrfLocListEntry;
+
+typedef enum
+{
+    DW_INL_not_inlined              = 0x0,
+    DW_INL_inlined                  = 0x1,
+    DW_INL_declared_not_inlined     = 0x2,
+    DW_INL_declared_inlined         = 0x3
+} DwrfInline;
+
+typedef enum
+{
+    DW_IDX_compile_unit             = 0x1,
+    DW_IDX_type_unit                = 0x2,
+    DW_IDX_die_offset               = 0x3,
+    DW_IDX_parent                   = 0x4,
+    DW_IDX_type_hash                = 0x5,
+
+    DW_IDX_lo_user                  = 0x2000,
+    DW_IDX_hi_user                  = 0x3fff
+} DwrfNameIndexAttr;
+
+typedef enum
+{
+    DW_CFA_advance_loc              = 0x40, // high 2 bits, delta in the low 6
+    DW_CFA_offset                   = 0x80, // high 2 bits, register in the low 6
+    DW_CFA_restore                  = 0xc0, // high 2 bits, register in the low 6
+
+    DW_CFA_nop                      = 0x00,
+    DW_CFA_set_loc                  = 0x01,
+    DW_CFA_advance_loc1             = 0x02,
+    DW_CFA_advance_loc2             = 0x03,
+    DW_CFA_advance_loc4             = 0x04,
+    DW_CFA_offset_extended          = 0x05,
+    DW_CFA_restore_extended         = 0x06,
+    DW_CFA_undefined                = 0x07,
+    DW_CFA_same_value               = 0x08,
+    DW_CFA_register                 = 0x09,
+    DW_CFA_remember_state           = 0x0a,
+    DW_CFA_restore_state            = 0x0b,
+    DW_CFA_def_cfa                  = 0x0c,
+    DW_CFA_def_cfa_register         = 0x0d,
+    DW_CFA_def_cfa_offset           = 0x0e,
+    DW_CFA_def_cfa_expression       = 0x0f,
+    DW_CFA_expression               = 0x10,
+    DW_CFA_offset_extended_sf       = 0x11,
+    DW_CFA_def_cfa_sf               = 0x12,
+    DW_CFA_def_cfa_offset_sf        = 0x13,
+    DW_CFA_val_offset               = 0x14,
+    DW_CFA_val_offset_sf            = 0x15,
+    DW_CFA_val_expression           = 0x16,
+
+    DW_CFA_lo_user                  = 0x1c,
+    DW_CFA_MIPS_advance_loc8        = 0x1d,
+    DW_CFA_GNU_window_save          = 0x2d, // DW_CFA_AARCH64_negate_ra_state on AArch64
+    DW_CFA_GNU_args_size            = 0x2e,
+    DW_CFA_GNU_negative_offset_extended = 0x2f,
+    DW_CFA_hi_user                  = 0x3f
+} DwrfCallFrameInsn;
+
+/* Operations of DWARF expressions, section 7.7.1 */
+typedef enum
+{
+    DW_OP_addr                      = 0x03,
+    DW_OP_deref                     = 0x06,
+    DW_OP_const1u                   = 0x08,
+    DW_OP_const1s                   = 0x09,
+    DW_OP_const2u                   = 0x0a,
+    DW_OP_const2s                   = 0x0b,
+    DW_OP_const4u                   = 0x0c,
+    DW_OP_const4s                   = 0x0d,
+    DW_OP_const8u                   = 0x0e,
+    DW_OP_const8s                   = 0x0f,
+    DW_OP_constu                    = 0x10,
+    DW_OP_consts                    = 0x11,
+    DW_OP_dup                       = 0x12,
+    DW_OP_drop                      = 0x13,
+    DW_OP_over                      = 0x14,
+    DW_OP_pick                      = 0x15,
+    DW_OP_swap                      = 0x16,
+    DW_OP_rot                       = 0x17,
+    DW_OP_xderef                    = 0x18,
+    DW_OP_abs                       = 0x19,
+    DW_OP_and                       = 0x1a,
+    DW_OP_div                       = 0x1b,
+    DW_OP_minus                     = 0x1c,
+    DW_OP_mod                       = 0x1d,
+    DW_OP_mul                       = 0x1e,
+    DW_OP_neg                       = 0x1f,
+    DW_OP_not                       = 0x20,
+    DW_OP_or                        = 0x21,
+    DW_OP_plus                      = 0x22,
+    DW_OP_plus_uconst               = 0x23,
+    DW_OP_shl                       = 0x24,
+    DW_OP_shr                       = 0x25,
+    DW_OP_shra                      = 0x26,
+    DW_OP_xor                       = 0x27,
+    DW_OP_bra                       = 0x28,
+    DW_OP_eq                        = 0x29,
+    DW_OP_ge                        = 0x2a,
+    DW_OP_gt                        = 0x2b,
+    DW_OP_le                        = 0x2c,
+    DW_OP_lt                        = 0x2d,
+    DW_OP_ne                        = 0x2e,
+    DW_OP_skip                      = 0x2f,
+    DW_OP_lit0                      = 0x30,  // lit0 + n pushes n
+    DW_OP_lit31                     = 0x4f,
+    DW_OP_reg0                      = 0x50,  // reg0 + n names register n
+    DW_OP_reg31                     = 0x6f,
+    DW_OP_breg0                     = 0x70,  // breg0 + n pushes register n plus a SLEB128 offset
+    DW_OP_breg31                    = 0x8f,
+    DW_OP_regx                      = 0x90,
+    DW_OP_fbreg                     = 0x91,
+    DW_OP_bregx                     = 0x92,
+    DW_OP_piece                     = 0x93,
+    DW_OP_deref_size                = 0x94,
+    DW_OP_xderef_size               = 0x95,
+    DW_OP_nop                       = 0x96,
+    DW_OP_push_object_address       = 0x97,
+    DW_OP_call2                     = 0x98,
+    DW_OP_call4                     = 0x99,
+    DW_OP_call_ref                  = 0x9a,
+    DW_OP_form_tls_address          = 0x9b,
+    DW_OP_call_frame_cfa            = 0x9c,
+    DW_OP_bit_piece                 = 0x9d,
+    DW_OP_implicit_value            = 0x9e,
+    DW_OP_stack_value               = 0x9f,
+    DW_OP_implicit_pointer          = 0xa0,
+    DW_OP_addrx                     = 0xa1,
+    DW_OP_constx                    = 0xa2,
+    DW_OP_entry_value               = 0xa3,
+    DW_OP_const_type                = 0xa4,
+    DW_OP_regval_type               = 0xa5,
+    DW_OP_deref_type                = 0xa6,
+    DW_OP_xderef_type               = 0xa7,
+    DW_OP_convert                   = 0xa8,
+    DW_OP_reinterpret               = 0xa9,
+
+    DW_OP_GNU_push_tls_address      = 0xe0,  // pre-standard DW_OP_form_tls_address
+    DW_OP_GNU_uninit                = 0xf0,
+    DW_OP_GNU_implicit_pointer      = 0xf2,
+    DW_OP_GNU_entry_value           = 0xf3,
+    DW_OP_GNU_const_type            = 0xf4,
+    DW_OP_GNU_regval_type           = 0xf5,
+    DW_OP_GNU_deref_type            = 0xf6,
+    DW_OP_GNU_convert               = 0xf7,
+    DW_OP_GNU_reinterpret           = 0xf9,
+    DW_OP_GNU_parameter_ref         = 0xfa,
+    DW_OP_GNU_addr_index            = 0xfb,  // split DWARF in DWARF 4, DW_OP_addrx
+    DW_OP_GNU_const_index           = 0xfc,  // DW_OP_constx
+    DW_OP_GNU_variable_value        = 0xfd,
+
+    DW_OP_lo_user                   = 0xe0,
+    DW_OP_hi_user                   = 0xff
+} DwrfOp;
+
+/* Encodings of base types, section 7.8 */
+typedef enum
+{
+    DW_ATE_address                  = 0x01,
+    DW_ATE_boolean                  = 0x02,
+    DW_ATE_complex_float            = 0x03,
+    DW_ATE_float                    = 0x04,
+    DW_ATE_signed                   = 0x05,
+    DW_ATE_signed_char              = 0x06,
+    DW_ATE_unsigned                 = 0x07,
+    DW_ATE_unsigned_char            = 0x08,
+    DW_ATE_imaginary_float          = 0x09,
+    DW_ATE_packed_decimal           = 0x0a,
+    DW_ATE_numeric_string           = 0x0b,
+    DW_ATE_edited                   = 0x0c,
+    DW_ATE_signed_fixed             = 0x0d,
+    DW_ATE_unsigned_fixed           = 0x0e,
+    DW_ATE_decimal_float            = 0x0f,
+    DW_ATE_UTF                      = 0x10,
+    DW_ATE_UCS                      = 0x11,
+    DW_ATE_ASCII                    = 0x12
+} DwrfBaseTypeEncoding;
+
+/* Pointer encodings of .eh_frame and .eh_frame_hdr (LSB core specification), format in the low nibble */
+typedef enum
+{
+    DW_EH_PE_absptr                 = 0x00,
+    DW_EH_PE_uleb128                = 0x01,
+    DW_EH_PE_udata2                 = 0x02,
+    DW_EH_PE_udata4                 = 0x03,
+    DW_EH_PE_udata8                 = 0x04,
+    DW_EH_PE_sleb128                = 0x09,
+    DW_EH_PE_sdata2                 = 0x0a,
+    DW_EH_PE_sdata4                 = 0x0b,
+    DW_EH_PE_sdata8                 = 0x0c,
+
+    DW_EH_PE_pcrel                  = 0x10,
+    DW_EH_PE_textrel                = 0x20,
+    DW_EH_PE_datarel                = 0x30,
+    DW_EH_PE_funcrel                = 0x40,
+    DW_EH_PE_aligned                = 0x50,
+
+    DW_EH_PE_indirect               = 0x80,
+    DW_EH_PE_omit                   = 0xff
+} DwrfEhPointerEnc;
+
+
+/* Section identifiers of the package indexes (.debug_cu_index, .debug_tu_index) */
+typedef enum
+{
+    DW_SECT_info                    = 1,
+    DW_SECT_abbrev                  = 3,
+    DW_SECT_line                    = 4,
+    DW_SECT_loclists                = 5,
+    DW_SECT_str_offsets             = 6,
+    DW_SECT_macro                   = 7,
+    DW_SECT_rnglists                = 8
+} DwrfPackageSection;
+
 #endif // include guard;
\ No newline at end of file
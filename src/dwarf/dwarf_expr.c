@@ -0,0 +1,1417 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ * Expressions *
+ ***************/
+ // sections 2.5 and 2.6 of spec v5
+
+#define EXPR_NO_UNIT    UINT64_MAX      // unit of the expressions compiled without a cursor
+#define EXPR_MAX_STACK  64u
+#define EXPR_MAX_CALLS  8u              // nesting of DW_OP_call*
+#define EXPR_MAX_STEPS  1000000u        // instructions run by one evaluation, bounds the loops made with DW_OP_skip
+#define EXPR_NO_INSN    UINT32_MAX
+
+enum
+{
+        EXPR_GENERIC,                   // integer of the size of an address, unspecified signedness
+        EXPR_SIGNED,
+        EXPR_UNSIGNED,
+        EXPR_FLOAT,
+};
+
+typedef struct
+{
+        uint8_t size;
+        uint8_t kind;
+} ExprType;
+
+/**
+ * Decoded operation. Constants and literals become DW_OP_constu (typed for DW_OP_const_type), registers
+ * DW_OP_regx, base registers DW_OP_bregx, DW_OP_deref DW_OP_deref_size, DW_OP_piece DW_OP_bit_piece and
+ * the GNU extensions their standard counterparts.
+ */
+typedef struct
+{
+        uint64_t a;             // constant, address, offset, size in bits, branch target or DW_OP_call* target
+        uint64_t b;             // offset of base registers and implicit pointers, DW_OP_bit_piece offset
+        uint32_t reg;
+        uint16_t type;          // index in the type table, 0 for the generic type
+        uint8_t op;             // DW_OP_*
+        uint8_t size;           // bytes read by the dereferences
+} ExprInsn;
+
+_Static_assert(sizeof(ExprInsn) == 24, "ExprInsn layout");
+
+struct DwrfExpr
+{
+        struct DwrfExpr *next;  // expressions at the same address compiled for another unit or length
+        uint64_t unit;          // offset of the unit, EXPR_NO_UNIT outside units
+        uint64_t len;           // bytes of the source expression
+        const ExprInsn *insns;
+        const struct DwrfExpr **calls;  // DW_OP_call* targets
+        const ExprType *types;  // types[0] is the generic type
+        const uint8_t *data;    // DW_OP_implicit_value bytes
+        uint32_t count;
+        uint8_t addr_size;
+        uint8_t big;
+};
+
+struct DwrfExprCache
+{
+        DwrfCtx *ctx;
+        DwrfArena arena;        // every DwrfExpr
+        DwrfMap exprs;          // address of the bytes -> DwrfExpr chain
+        DwrfExprCacheStats stats;
+        uint8_t addr_size;      // of the expressions outside units, from the ELF class
+        uint8_t big;
+};
+
+typedef struct
+{
+        uint64_t die;           // unit relative offset of the base type DIE
+        ExprType t;
+} ExprBuildType;
+
+/** State of one compilation, each DW_OP_call* target gets its own */
+typedef struct
+{
+        DwrfExprCache *cache;
+        InternalDwarfCtx *ctx;
+        DwrfCursor *cur;                // NULL outside units
+        DwrfCursor *tmp;                // reads base types and call targets, allocated on first use
+        const DwrfUnitBases *bases;
+        uint64_t unit;
+        ExprInsn *insns;
+        uint32_t count, cap;
+        ExprBuildType *types;
+        uint32_t ntypes, tcap;
+        const DwrfExpr **calls;
+        uint32_t ncalls, ccap;
+        uint8_t *data;
+        uint64_t ndata, dcap;
+        uint32_t *at;                   // instruction of each byte offset, EXPR_NO_INSN within operands
+        uint32_t depth;
+        uint8_t addr_size;
+        uint8_t offset_size;
+        uint8_t version;
+        uint8_t big;
+} ExprBuild;
+
+static DwrfResult expr_get(DwrfExprCache *cache, DwrfCursor *cur, const uint8_t *expr, uint64_t len, uint32_t depth,
+                           const DwrfExpr **out);
+
+/** Makes room for one more element of "size" bytes */
+static DwrfResult expr_grow(void **items, uint32_t count, uint32_t *cap, size_t size)
+{
+        void *p;
+        uint32_t n;
+
+        if (count < *cap)
+                return DWRF_OK;
+
+        n = *cap ? *cap * 2 : 16;
+        p = realloc(*items, (size_t)n * size);
+        if (p == NULL)
+                return DWRF_NO_MEM;
+
+        *items = p;
+        *cap = n;
+        return DWRF_OK;
+}
+
+static DwrfResult expr_emit(ExprBuild *b, uint8_t op, uint64_t a, uint64_t v, uint32_t reg)
+{
+        DwrfResult res;
+        ExprInsn *in;
+
+        if ((res = expr_grow((void **)&b->insns, b->count, &b->cap, sizeof(ExprInsn))))
+                return res;
+
+        in = &b->insns[b->count++];
+        memset(in, 0, sizeof(ExprInsn));
+        in->op = op;
+        in->a = a;
+        in->b = v;
+        in->reg = reg;
+        return DWRF_OK;
+}
+
+/** Cursor for the DIEs an expression refers to */
+static DwrfResult expr_tmp_cursor(ExprBuild *b, uint64_t die_offset, DwrfDie *die)
+{
+        DwrfResult res;
+
+        if (b->cur == NULL)
+                return DWRF_DECODE_ERR; // unit references outside units
+
+        if (b->tmp == NULL)
+        {
+                b->tmp = malloc(sizeof(DwrfCursor));
+                if (b->tmp == NULL)
+                        return DWRF_NO_MEM;
+                if ((res = dwarf_cursor_init(b->cache->ctx, b->tmp)) || (res = dwarf_cursor_seek_unit(b->tmp, b->unit)))
+                {
+                        free(b->tmp);
+                        b->tmp = NULL;
+                        return res;
+                }
+        }
+
+        if ((res = dwarf_cursor_seek_die(b->tmp, die_offset, die)))
+                return (res == DWRF_BAD_ARG) ? DWRF_DECODE_ERR : res;
+        return DWRF_OK;
+}
+
+/** Index in the type table of the base type DIE at unit relative offset "die", 0 being the generic type */
+static DwrfResult expr_type(ExprBuild *b, uint64_t die, uint16_t *index)
+{
+        static const uint16_t names[] = { DW_AT_byte_size, DW_AT_encoding };
+        DwrfAttr attrs[2];
+        DwrfDie d;
+        ExprType t;
+        DwrfResult res;
+
+        if (die == 0)
+        {
+                *index = 0;
+                return DWRF_OK;
+        }
+
+        for (uint32_t i = 1; i < b->ntypes; i++)
+        {
+                if (b->types[i].die == die)
+                {
+                        *index = (uint16_t)i;
+                        return DWRF_OK;
+                }
+        }
+
+        if ((res = expr_tmp_cursor(b, b->unit + die, &d)))
+                return res;
+        if (d.Tag != DW_TAG_base_type)
+                return DWRF_DECODE_ERR;
+        if ((res = dwarf_cursor_get_attrs(b->tmp, names, 2, attrs)))
+                return res;
+        if ((attrs[0].Form == 0) || (attrs[1].Form == 0) || (attrs[0].Value == 0))
+                return DWRF_DECODE_ERR;
+
+        switch (attrs[1].Value)
+        {
+        case DW_ATE_signed:
+        case DW_ATE_signed_char:
+        case DW_ATE_signed_fixed:
+                t.kind = EXPR_SIGNED;
+                break;
+        case DW_ATE_address:
+        case DW_ATE_boolean:
+        case DW_ATE_unsigned:
+        case DW_ATE_unsigned_char:
+        case DW_ATE_unsigned_fixed:
+        case DW_ATE_UTF:
+        case DW_ATE_UCS:
+        case DW_ATE_ASCII:
+                t.kind = EXPR_UNSIGNED;
+                break;
+        case DW_ATE_float:
+                if ((attrs[0].Value != 4) && (attrs[0].Value != 8))
+                        return DWRF_UNSUPPORTED;
+                t.kind = EXPR_FLOAT;
+                break;
+        default:
+                return DWRF_UNSUPPORTED;
+        }
+
+        if (attrs[0].Value > 8)
+                return DWRF_UNSUPPORTED;
+        t.size = (uint8_t)attrs[0].Value;
+
+        if (b->ntypes > UINT16_MAX)
+                return DWRF_UNSUPPORTED;
+        if ((res = expr_grow((void **)&b->types, b->ntypes, &b->tcap, sizeof(ExprBuildType))))
+                return res;
+
+        b->types[b->ntypes] = (ExprBuildType){ die, t };
+        *index = (uint16_t)b->ntypes++;
+        return DWRF_OK;
+}
+
+/** DW_OP_call*: compiles the DW_AT_location of the DIE, which becomes a no-op when it has none */
+static DwrfResult expr_call(ExprBuild *b, uint64_t die_offset)
+{
+        DwrfAttr attr;
+        DwrfDie d;
+        const DwrfExpr *callee;
+        const DwrfSection *sec = &b->ctx->debug_info;
+        DwrfResult res;
+
+        if ((res = expr_tmp_cursor(b, die_offset, &d)))
+                return res;
+
+        res = dwarf_cursor_get_attr(b->tmp, DW_AT_location, &attr);
+        if (res == DWRF_NOT_FOUND)
+                return DWRF_OK;
+        if (res)
+                return res;
+
+        if ((attr.Form != DW_FORM_exprloc) && (attr.Form != DW_FORM_block) && (attr.Form != DW_FORM_block1) &&
+            (attr.Form != DW_FORM_block2) && (attr.Form != DW_FORM_block4))
+                return DWRF_UNSUPPORTED; // location list
+
+        if ((res = dwrf_load_section(b->ctx, &b->ctx->debug_info)))
+                return res;
+        if ((attr.Value > sec->hdr.Size) || (attr.Size > sec->hdr.Size - attr.Value))
+                return DWRF_DECODE_ERR;
+
+        if ((res = expr_get(b->cache, b->tmp, sec->data + attr.Value, attr.Size, b->depth + 1, &callee)))
+                return res;
+
+        if ((res = expr_grow((void **)&b->calls, b->ncalls, &b->ccap, sizeof(DwrfExpr *))))
+                return res;
+        b->calls[b->ncalls] = callee;
+        return expr_emit(b, DW_OP_call4, b->ncalls++, 0, 0);
+}
+
+/** DW_OP_entry_value: only the value of a register on entry is supported */
+static DwrfResult expr_entry_value(ExprBuild *b, DwrfBuf *buf)
+{
+        DwrfBuf block;
+        uint64_t len, reg;
+        DwrfResult res;
+
+        if ((res = buf_uleb(buf, &len)) || (buf_left(buf) < len))
+                return res ? res : DWRF_DECODE_ERR;
+
+        block = (DwrfBuf){ buf->p, buf->p + len, buf->big };
+        buf->p += len;
+
+        if (len == 0)
+                return DWRF_DECODE_ERR;
+
+        if ((*block.p >= DW_OP_reg0) && (*block.p <= DW_OP_reg31))
+        {
+                reg = *block.p++ - DW_OP_reg0;
+        }
+        else if (*block.p == DW_OP_regx)
+        {
+                block.p++;
+                if ((res = buf_uleb(&block, &reg)))
+                        return res;
+        }
+        else
+                return DWRF_UNSUPPORTED;
+
+        if ((buf_left(&block) != 0) || (reg > UINT32_MAX))
+                return DWRF_UNSUPPORTED;
+
+        return expr_emit(b, DW_OP_entry_value, 0, 0, (uint32_t)reg);
+}
+
+/** Decodes one operation at the start of buf */
+static DwrfResult expr_decode_op(ExprBuild *b, DwrfBuf *buf, uint64_t start)
+{
+        uint8_t op = *buf->p++;
+        uint64_t u, v;
+        int64_t s;
+        uint16_t type;
+        DwrfResult res = DWRF_OK;
+
+        if ((op >= DW_OP_lit0) && (op <= DW_OP_lit31))
+                return expr_emit(b, DW_OP_constu, op - DW_OP_lit0, 0, 0);
+        if ((op >= DW_OP_reg0) && (op <= DW_OP_reg31))
+                return expr_emit(b, DW_OP_regx, 0, 0, op - DW_OP_reg0);
+        if ((op >= DW_OP_breg0) && (op <= DW_OP_breg31))
+        {
+                if ((res = buf_sleb(buf, &s)))
+                        return res;
+                return expr_emit(b, DW_OP_bregx, 0, (uint64_t)s, op - DW_OP_breg0);
+        }
+
+        switch (op)
+        {
+        case DW_OP_addr:
+                if ((res = buf_uN(buf, b->addr_size, &u)))
+                        return res;
+                return expr_emit(b, DW_OP_addr, u, 0, 0);
+
+        case DW_OP_addrx:
+        case DW_OP_GNU_addr_index:
+        case DW_OP_constx:
+        case DW_OP_GNU_const_index:
+                if (b->bases == NULL)
+                        return DWRF_DECODE_ERR;
+                if ((res = buf_uleb(buf, &u)) || (res = dwrf_read_addrx(b->ctx, b->bases, u, &v)))
+                        return res;
+                /* constx values (TLS offsets) aren't relocated by the load bias */
+                return expr_emit(b, ((op == DW_OP_addrx) || (op == DW_OP_GNU_addr_index)) ? DW_OP_addr : DW_OP_constu, v, 0, 0);
+
+        case DW_OP_const1u:
+        case DW_OP_const2u:
+        case DW_OP_const4u:
+        case DW_OP_const8u:
+        case DW_OP_const1s:
+        case DW_OP_const2s:
+        case DW_OP_const4s:
+        case DW_OP_const8s:
+        {
+                uint8_t size = (uint8_t)(1u << ((op - DW_OP_const1u) / 2));
+
+                if ((res = buf_uN(buf, size, &u)))
+                        return res;
+                if (((op - DW_OP_const1u) & 1) && (size < 8))
+                {
+                        uint64_t sign = 1ULL << (8 * size - 1);
+                        u = (u ^ sign) - sign;
+                }
+                return expr_emit(b, DW_OP_constu, u, 0, 0);
+        }
+
+        case DW_OP_constu:
+                if ((res = buf_uleb(buf, &u)))
+                        return res;
+                return expr_emit(b, DW_OP_constu, u, 0, 0);
+
+        case DW_OP_consts:
+                if ((res = buf_sleb(buf, &s)))
+                        return res;
+                return expr_emit(b, DW_OP_constu, (uint64_t)s, 0, 0);
+
+        case DW_OP_dup:
+        case DW_OP_drop:
+        case DW_OP_over:
+        case DW_OP_swap:
+        case DW_OP_rot:
+        case DW_OP_abs:
+        case DW_OP_and:
+        case DW_OP_div:
+        case DW_OP_minus:
+        case DW_OP_mod:
+        case DW_OP_mul:
+        case DW_OP_neg:
+        case DW_OP_not:
+        case DW_OP_or:
+        case DW_OP_plus:
+        case DW_OP_shl:
+        case DW_OP_shr:
+        case DW_OP_shra:
+        case DW_OP_xor:
+        case DW_OP_eq:
+        case DW_OP_ge:
+        case DW_OP_gt:
+        case DW_OP_le:
+        case DW_OP_lt:
+        case DW_OP_ne:
+        case DW_OP_push_object_address:
+        case DW_OP_form_tls_address:
+        case DW_OP_call_frame_cfa:
+        case DW_OP_stack_value:
+                return expr_emit(b, op, 0, 0, 0);
+
+        case DW_OP_GNU_push_tls_address:
+                return expr_emit(b, DW_OP_form_tls_address, 0, 0, 0);
+
+        case DW_OP_deref:
+        case DW_OP_xderef:
+                if ((res = expr_emit(b, (op == DW_OP_deref) ? DW_OP_deref_size : DW_OP_xderef_size, 0, 0, 0)))
+                        return res;
+                b->insns[b->count - 1].size = b->addr_size;
+                return DWRF_OK;
+
+        case DW_OP_deref_size:
+        case DW_OP_xderef_size:
+                if ((res = buf_uN(buf, 1, &u)))
+                        return res;
+                if ((u == 0) || (u > 8))
+                        return DWRF_DECODE_ERR;
+                if ((res = expr_emit(b, op, 0, 0, 0)))
+                        return res;
+                b->insns[b->count - 1].size = (uint8_t)u;
+                return DWRF_OK;
+
+        case DW_OP_pick:
+                if ((res = buf_uN(buf, 1, &u)))
+                        return res;
+                return expr_emit(b, op, u, 0, 0);
+
+        case DW_OP_plus_uconst:
+        case DW_OP_fbreg:
+                if (op == DW_OP_fbreg)
+                        res = buf_sleb(buf, &s), u = (uint64_t)s;
+                else
+                        res = buf_uleb(buf, &u);
+                if (res)
+                        return res;
+                return expr_emit(b, op, u, 0, 0);
+
+        case DW_OP_skip:
+        case DW_OP_bra:
+                if ((res = buf_uN(buf, 2, &u)))
+                        return res;
+                /* byte offset of the target for now, turned into an instruction index once every operation is decoded */
+                s = (int64_t)(start + 3) + (int16_t)(uint16_t)u;
+                return expr_emit(b, op, (uint64_t)s, 0, 0);
+
+        case DW_OP_regx:
+                if ((res = buf_uleb(buf, &u)))
+                        return res;
+                if (u > UINT32_MAX)
+                        return DWRF_DECODE_ERR;
+                return expr_emit(b, DW_OP_regx, 0, 0, (uint32_t)u);
+
+        case DW_OP_bregx:
+                if ((res = buf_uleb(buf, &u)) || (res = buf_sleb(buf, &s)))
+                        return res;
+                if (u > UINT32_MAX)
+                        return DWRF_DECODE_ERR;
+                return expr_emit(b, DW_OP_bregx, 0, (uint64_t)s, (uint32_t)u);
+
+        case DW_OP_piece:
+                if ((res = buf_uleb(buf, &u)))
+                        return res;
+                if (u > UINT64_MAX / 8)
+                        return DWRF_DECODE_ERR;
+                return expr_emit(b, DW_OP_bit_piece, u * 8, 0, 0);
+
+        case DW_OP_bit_piece:
+                if ((res = buf_uleb(buf, &u)) || (res = buf_uleb(buf, &v)))
+                        return res;
+                return expr_emit(b, DW_OP_bit_piece, u, v, 0);
+
+        case DW_OP_nop:
+        case DW_OP_GNU_uninit:
+                return DWRF_OK;
+
+        case DW_OP_call2:
+        case DW_OP_call4:
+        case DW_OP_call_ref:
+                if (b->bases == NULL)
+                        return DWRF_DECODE_ERR;
+                if (b->depth >= EXPR_MAX_CALLS)
+                        return DWRF_DECODE_ERR;
+                if ((res = buf_uN(buf, (op == DW_OP_call2) ? 2 : (op == DW_OP_call4) ? 4 : b->offset_size, &u)))
+                        return res;
+                return expr_call(b, (op == DW_OP_call_ref) ? u : b->unit + u);
+
+        case DW_OP_implicit_value:
+                if ((res = buf_uleb(buf, &u)) || (buf_left(buf) < u))
+                        return res ? res : DWRF_DECODE_ERR;
+                while (b->ndata + u > b->dcap)
+                {
+                        uint64_t cap = b->dcap ? b->dcap * 2 : 64;
+                        uint8_t *p = realloc(b->data, (size_t)cap);
+                        if (p == NULL)
+                                return DWRF_NO_MEM;
+                        b->data = p;
+                        b->dcap = cap;
+                }
+                if (u > 0)
+                        memcpy(b->data + b->ndata, buf->p, (size_t)u);
+                buf->p += u;
+                b->ndata += u;
+                return expr_emit(b, op, b->ndata - u, u, 0);
+
+        case DW_OP_implicit_pointer:
+        case DW_OP_GNU_implicit_pointer:
+                if (b->bases == NULL)
+                        return DWRF_DECODE_ERR;
+                if ((res = buf_uN(buf, (b->version <= 2) ? b->addr_size : b->offset_size, &u)) || (res = buf_sleb(buf, &s)))
+                        return res;
+                return expr_emit(b, DW_OP_implicit_pointer, u, (uint64_t)s, 0);
+
+        case DW_OP_entry_value:
+        case DW_OP_GNU_entry_value:
+                return expr_entry_value(b, buf);
+
+        case DW_OP_const_type:
+        case DW_OP_GNU_const_type:
+                if ((res = buf_uleb(buf, &u)) || (res = expr_type(b, u, &type)) || (res = buf_uN(buf, 1, &v)))
+                        return res;
+                if (v > 8)
+                        return DWRF_UNSUPPORTED;
+                if ((v == 0) || (buf_left(buf) < v))
+                        return DWRF_DECODE_ERR;
+                u = load_uN(buf->p, (uint8_t)v, buf->big);
+                buf->p += v;
+                if ((res = expr_emit(b, DW_OP_constu, u, 0, 0)))
+                        return res;
+                b->insns[b->count - 1].type = type;
+                return DWRF_OK;
+
+        case DW_OP_regval_type:
+        case DW_OP_GNU_regval_type:
+                if ((res = buf_uleb(buf, &u)) || (res = buf_uleb(buf, &v)) || (res = expr_type(b, v, &type)))
+                        return res;
+                if (u > UINT32_MAX)
+                        return DWRF_DECODE_ERR;
+                if ((res = expr_emit(b, DW_OP_regval_type, 0, 0, (uint32_t)u)))
+                        return res;
+                b->insns[b->count - 1].type = type;
+                return DWRF_OK;
+
+        case DW_OP_deref_type:
+        case DW_OP_GNU_deref_type:
+        case DW_OP_xderef_type:
+                if ((res = buf_uN(buf, 1, &u)) || (res = buf_uleb(buf, &v)) || (res = expr_type(b, v, &type)))
+                        return res;
+                if ((u == 0) || (u > 8))
+                        return DWRF_DECODE_ERR;
+                if ((res = expr_emit(b, (op == DW_OP_xderef_type) ? op : DW_OP_deref_type, 0, 0, 0)))
+                        return res;
+                b->insns[b->count - 1].size = (uint8_t)u;
+                b->insns[b->count - 1].type = type;
+                return DWRF_OK;
+
+        case DW_OP_convert:
+        case DW_OP_GNU_convert:
+        case DW_OP_reinterpret:
+        case DW_OP_GNU_reinterpret:
+                if ((res = buf_uleb(buf, &u)) || (res = expr_type(b, u, &type)))
+                        return res;
+                if ((res = expr_emit(b, ((op == DW_OP_convert) || (op == DW_OP_GNU_convert)) ? DW_OP_convert : DW_OP_reinterpret,
+                                     0, 0, 0)))
+                        return res;
+                b->insns[b->count - 1].type = type;
+                return DWRF_OK;
+
+        case DW_OP_GNU_parameter_ref:
+        case DW_OP_GNU_variable_value:
+                return DWRF_UNSUPPORTED;
+
+        default:
+                return DWRF_DECODE_ERR;
+        }
+}
+
+/** Decodes the operations and resolves the branch targets */
+static DwrfResult expr_decode(ExprBuild *b, const uint8_t *expr, uint64_t len)
+{
+        DwrfBuf buf = { expr, expr + len, b->big };
+        DwrfResult res;
+
+        if (len >= UINT32_MAX)
+                return DWRF_DECODE_ERR;
+
+        b->at = malloc(((size_t)len + 1) * sizeof(uint32_t));
+        if (b->at == NULL)
+                return DWRF_NO_MEM;
+        for (uint64_t i = 0; i <= len; i++)
+                b->at[i] = EXPR_NO_INSN;
+
+        while (buf.p < buf.end)
+        {
+                uint64_t start = (uint64_t)(buf.p - expr);
+
+                b->at[start] = b->count;
+                if ((res = expr_decode_op(b, &buf, start)))
+                        return res;
+        }
+        b->at[len] = b->count;
+
+        for (uint32_t i = 0; i < b->count; i++)
+        {
+                ExprInsn *in = &b->insns[i];
+
+                if ((in->op != DW_OP_skip) && (in->op != DW_OP_bra))
+                        continue;
+                /* targets must start an operation, negative offsets wrap past len */
+                if ((in->a > len) || (b->at[in->a] == EXPR_NO_INSN))
+                        return DWRF_DECODE_ERR;
+                in->a = b->at[in->a];
+        }
+        return DWRF_OK;
+}
+
+static void expr_build_release(ExprBuild *b)
+{
+        free(b->tmp);
+        free(b->insns);
+        free(b->types);
+        free(b->calls);
+        free(b->data);
+        free(b->at);
+}
+
+/** Copies the decoded expression to the arena */
+static DwrfResult expr_store(ExprBuild *b, uint64_t len, DwrfExpr **out)
+{
+        size_t insns = (size_t)b->count * sizeof(ExprInsn);
+        size_t calls = (size_t)b->ncalls * sizeof(DwrfExpr *);
+        size_t types = (size_t)b->ntypes * sizeof(ExprType);
+        size_t bytes = sizeof(DwrfExpr) + insns + calls + types + (size_t)b->ndata;
+        uint8_t *p;
+        DwrfExpr *e;
+
+        e = dwarf_arena_alloc(&b->cache->arena, bytes);
+        if (e == NULL)
+                return DWRF_NO_MEM;
+
+        p = (uint8_t *)(e + 1);
+        e->next = NULL;
+        e->unit = b->unit;
+        e->len = len;
+        e->count = b->count;
+        e->addr_size = b->addr_size;
+        e->big = b->big;
+
+        e->insns = (const ExprInsn *)p;
+        if (insns)
+                memcpy(p, b->insns, insns);
+        p += insns;
+
+        e->calls = (const DwrfExpr **)p;
+        if (calls)
+                memcpy(p, b->calls, calls);
+        p += calls;
+
+        e->types = (const ExprType *)p;
+        for (uint32_t i = 0; i < b->ntypes; i++)
+                ((ExprType *)p)[i] = b->types[i].t;
+        p += types;
+
+        e->data = p;
+        if (b->ndata)
+                memcpy(p, b->data, (size_t)b->ndata);
+
+        b->cache->stats.Insns += b->count;
+        b->cache->stats.Bytes += bytes;
+        *out = e;
+        return DWRF_OK;
+}
+
+static DwrfResult expr_build(ExprBuild *b, const uint8_t *expr, uint64_t len, DwrfExpr **out)
+{
+        DwrfResult res;
+
+        /* types[0] is the generic type */
+        if ((res = expr_grow((void **)&b->types, 0, &b->tcap, sizeof(ExprBuildType))))
+                return res;
+        b->types[0] = (ExprBuildType){ 0, { b->addr_size, EXPR_GENERIC } };
+        b->ntypes = 1;
+
+        if ((res = expr_decode(b, expr, len)))
+                return res;
+        return expr_store(b, len, out);
+}
+
+/** Expression of the cache, compiled on a miss */
+static DwrfResult expr_get(DwrfExprCache *cache, DwrfCursor *cur, const uint8_t *expr, uint64_t len, uint32_t depth,
+                           const DwrfExpr **out)
+{
+        ExprBuild b;
+        DwrfUnitHeader unit;
+        DwrfExpr *head, *e;
+        uint64_t key = (uint64_t)(uintptr_t)expr;
+        DwrfResult res;
+
+        memset(&b, 0, sizeof(b));
+        b.cache = cache;
+        b.ctx = CTX(cache->ctx);
+        b.depth = depth;
+        b.unit = EXPR_NO_UNIT;
+        b.addr_size = cache->addr_size;
+        b.offset_size = 4;
+        b.big = cache->big;
+
+        if (cur != NULL)
+        {
+                InternalDwarfCtx *ctx;
+
+                if ((res = dwrf_cursor_bases(cur, &ctx, &b.bases)) || (res = dwarf_cursor_unit(cur, &unit)))
+                        return res;
+                if (ctx != b.ctx)
+                        return DWRF_BAD_ARG;
+                if ((unit.AddrSize == 0) || (unit.AddrSize > 8))
+                        return DWRF_DECODE_ERR;
+
+                b.cur = cur;
+                b.unit = unit.Offset;
+                b.addr_size = unit.AddrSize;
+                b.offset_size = unit.OffsetSize;
+                b.version = (uint8_t)unit.Version;
+        }
+
+        head = dwrf_map_get(&cache->exprs, key);
+        for (e = head; e != NULL; e = e->next)
+        {
+                if ((e->unit == b.unit) && (e->len == len))
+                {
+                        cache->stats.Hits++;
+                        *out = e;
+                        return DWRF_OK;
+                }
+        }
+
+        res = expr_build(&b, expr, len, &e);
+        expr_build_release(&b);
+        if (res)
+                return res;
+
+        /* a DW_OP_call* target may have added expressions at this address in the meantime */
+        e->next = dwrf_map_get(&cache->exprs, key);
+        if ((res = dwrf_map_put(&cache->exprs, key, e)))
+                return res;
+
+        cache->stats.Misses++;
+        *out = e;
+        return DWRF_OK;
+}
+
+/***************
+ * Evaluation  *
+ ***************/
+
+typedef struct
+{
+        uint64_t v;
+        ExprType t;
+} ExprValue;
+
+typedef struct
+{
+        const DwrfExprEnv *env;
+        ExprValue stack[EXPR_MAX_STACK];
+        uint32_t depth;
+        uint32_t steps;
+        DwrfLocPiece loc;       // location of the current piece, once its kind is known
+        uint8_t kind;           // DWRF_LOC_MEMORY until an operation says otherwise
+        uint8_t pending;        // operations ran since the last piece
+        DwrfLocPiece *pieces;
+        uint32_t max;
+        uint32_t count;
+} ExprState;
+
+static inline uint64_t expr_mask(uint8_t size)
+{
+        return (size >= 8) ? UINT64_MAX : ((1ULL << (8 * size)) - 1);
+}
+
+static inline int64_t expr_sext(uint64_t v, uint8_t size)
+{
+        uint64_t sign;
+
+        if (size >= 8)
+                return (int64_t)v;
+        sign = 1ULL << (8 * size - 1);
+        return (int64_t)(((v & expr_mask(size)) ^ sign) - sign);
+}
+
+static inline DwrfResult expr_push(ExprState *s, uint64_t v, ExprType t)
+{
+        if (s->depth == EXPR_MAX_STACK)
+                return DWRF_DECODE_ERR;
+
+        s->stack[s->depth++] = (ExprValue){ v & expr_mask(t.size), t };
+        return DWRF_OK;
+}
+
+static inline DwrfResult expr_pop(ExprState *s, ExprValue *v)
+{
+        if (s->depth == 0)
+                return DWRF_DECODE_ERR;
+
+        *v = s->stack[--s->depth];
+        return DWRF_OK;
+}
+
+static double expr_to_double(ExprValue v)
+{
+        if (v.t.size == 4)
+        {
+                uint32_t bits = (uint32_t)v.v;
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                return f;
+        }
+        else
+        {
+                double d;
+                memcpy(&d, &v.v, sizeof(d));
+                return d;
+        }
+}
+
+static uint64_t expr_from_double(double d, uint8_t size)
+{
+        uint64_t bits = 0;
+
+        if (size == 4)
+        {
+                float f = (float)d;
+                uint32_t b;
+                memcpy(&b, &f, sizeof(b));
+                bits = b;
+        }
+        else
+                memcpy(&bits, &d, sizeof(d));
+        return bits;
+}
+
+/** Target memory as an unsigned integer */
+static DwrfResult expr_read_mem(ExprState *s, uint64_t addr, uint8_t size, uint8_t big, uint64_t *v)
+{
+        uint8_t buff[8];
+        DwrfResult res;
+
+        if (s->env->ReadMem == NULL)
+                return DWRF_NOT_FOUND;
+        if ((res = s->env->ReadMem(s->env->User, addr, buff, size)))
+                return res;
+
+        *v = load_uN(buff, size, big);
+        return DWRF_OK;
+}
+
+static DwrfResult expr_read_reg(ExprState *s, uint32_t reg, uint64_t *v)
+{
+        if (s->env->ReadReg == NULL)
+                return DWRF_NOT_FOUND;
+        return s->env->ReadReg(s->env->User, reg, v);
+}
+
+/** DW_OP_convert, integers are extended according to the signedness of their type (the generic one is unsigned) */
+static uint64_t expr_convert(ExprValue v, ExprType to)
+{
+        if (v.t.kind == EXPR_FLOAT)
+        {
+                double d = expr_to_double(v);
+
+                if (to.kind == EXPR_FLOAT)
+                        return expr_from_double(d, to.size);
+                if ((to.kind == EXPR_SIGNED) || (d < 0))
+                        return (uint64_t)(int64_t)d;
+                return (uint64_t)d;
+        }
+
+        if (to.kind == EXPR_FLOAT)
+        {
+                if (v.t.kind == EXPR_SIGNED)
+                        return expr_from_double((double)expr_sext(v.v, v.t.size), to.size);
+                return expr_from_double((double)v.v, to.size);
+        }
+
+        return (v.t.kind == EXPR_SIGNED) ? (uint64_t)expr_sext(v.v, v.t.size) : v.v;
+}
+
+/** Comparisons on two values of the same type, generic values compare as signed */
+static int expr_compare(ExprValue x, ExprValue y)
+{
+        if (x.t.kind == EXPR_FLOAT)
+        {
+                double a = expr_to_double(x), b = expr_to_double(y);
+                return (a < b) ? -1 : (a > b) ? 1 : 0;
+        }
+        if (x.t.kind == EXPR_UNSIGNED)
+                return (x.v < y.v) ? -1 : (x.v > y.v) ? 1 : 0;
+
+        int64_t a = expr_sext(x.v, x.t.size), b = expr_sext(y.v, y.t.size);
+        return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+/** Operations popping two values of the same type and pushing one */
+static DwrfResult expr_binary(ExprState *s, uint8_t op, const ExprType *generic)
+{
+        ExprValue x, y;
+        uint64_t r;
+        int c;
+        DwrfResult res;
+
+        if ((res = expr_pop(s, &y)) || (res = expr_pop(s, &x)))
+                return res;
+
+        /* shift amounts may be of any integral type */
+        if ((op == DW_OP_shl) || (op == DW_OP_shr) || (op == DW_OP_shra))
+        {
+                if ((x.t.kind == EXPR_FLOAT) || (y.t.kind == EXPR_FLOAT))
+                        return DWRF_DECODE_ERR;
+
+                uint64_t n = y.v, bits = 8u * x.t.size;
+                if (op == DW_OP_shl)
+                        r = (n >= bits) ? 0 : x.v << n;
+                else if ((op == DW_OP_shr) || (x.t.kind == EXPR_UNSIGNED))
+                        r = (n >= bits) ? 0 : (x.v & expr_mask(x.t.size)) >> n;
+                else
+                {
+                        int64_t v = expr_sext(x.v, x.t.size);
+                        r = (uint64_t)((n >= bits) ? ((v < 0) ? -1 : 0) : (v < 0) ? ~(~v >> n) : (v >> n));
+                }
+                return expr_push(s, r, x.t);
+        }
+
+        if ((x.t.size != y.t.size) || (x.t.kind != y.t.kind))
+                return DWRF_DECODE_ERR;
+
+        switch (op)
+        {
+        case DW_OP_eq:
+        case DW_OP_ne:
+        case DW_OP_lt:
+        case DW_OP_le:
+        case DW_OP_gt:
+        case DW_OP_ge:
+                c = expr_compare(x, y);
+                r = (op == DW_OP_eq) ? (c == 0) : (op == DW_OP_ne) ? (c != 0) : (op == DW_OP_lt) ? (c < 0) :
+                    (op == DW_OP_le) ? (c <= 0) : (op == DW_OP_gt) ? (c > 0) : (c >= 0);
+                return expr_push(s, r, *generic);
+        default:
+                break;
+        }
+
+        if (x.t.kind == EXPR_FLOAT)
+        {
+                double a = expr_to_double(x), b = expr_to_double(y);
+
+                switch (op)
+                {
+                case DW_OP_plus:
+                        return expr_push(s, expr_from_double(a + b, x.t.size), x.t);
+                case DW_OP_minus:
+                        return expr_push(s, expr_from_double(a - b, x.t.size), x.t);
+                case DW_OP_mul:
+                        return expr_push(s, expr_from_double(a * b, x.t.size), x.t);
+                case DW_OP_div:
+                        return expr_push(s, expr_from_double(a / b, x.t.size), x.t);
+                default:
+                        return DWRF_DECODE_ERR;
+                }
+        }
+
+        switch (op)
+        {
+        case DW_OP_and:
+                r = x.v & y.v;
+                break;
+        case DW_OP_or:
+                r = x.v | y.v;
+                break;
+        case DW_OP_xor:
+                r = x.v ^ y.v;
+                break;
+        case DW_OP_plus:
+                r = x.v + y.v;
+                break;
+        case DW_OP_minus:
+                r = x.v - y.v;
+                break;
+        case DW_OP_mul:
+                r = x.v * y.v;
+                break;
+        case DW_OP_div:
+        case DW_OP_mod:
+                if (y.v == 0)
+                        return DWRF_DECODE_ERR;
+                /* DW_OP_div is signed for the generic type, DW_OP_mod unsigned as in other consumers */
+                if ((x.t.kind == EXPR_SIGNED) || ((x.t.kind == EXPR_GENERIC) && (op == DW_OP_div)))
+                {
+                        int64_t a = expr_sext(x.v, x.t.size), d = expr_sext(y.v, y.t.size);
+
+                        if ((a == INT64_MIN) && (d == -1))
+                                r = (op == DW_OP_div) ? (uint64_t)a : 0;
+                        else
+                                r = (uint64_t)((op == DW_OP_div) ? a / d : a % d);
+                }
+                else
+                        r = (op == DW_OP_div) ? x.v / y.v : x.v % y.v;
+                break;
+        default:
+                return DWRF_DECODE_ERR;
+        }
+        return expr_push(s, r, x.t);
+}
+
+/** Closes the current piece (DW_OP_piece, DW_OP_bit_piece or the end of the expression) */
+static DwrfResult expr_piece(ExprState *s, uint64_t bits, uint64_t offset)
+{
+        DwrfLocPiece p = s->loc;
+        ExprValue v;
+        DwrfResult res;
+
+        if (s->kind == DWRF_LOC_MEMORY)
+        {
+                memset(&p, 0, sizeof(p));
+                if (s->depth == 0)
+                        p.Kind = DWRF_LOC_EMPTY;
+                else
+                {
+                        if ((res = expr_pop(s, &v)))
+                                return res;
+                        p.Kind = DWRF_LOC_MEMORY;
+                        p.Value = v.v;
+                }
+        }
+
+        p.PieceBits = bits;
+        p.PieceOffset = offset;
+        if (s->count < s->max)
+                s->pieces[s->count] = p;
+        s->count++;
+
+        s->kind = DWRF_LOC_MEMORY;
+        s->pending = false;
+        return DWRF_OK;
+}
+
+static DwrfResult expr_run(ExprState *s, const DwrfExpr *e)
+{
+        const DwrfExprEnv *env = s->env;
+        const ExprType generic = e->types[0];
+        ExprValue x, y, z;
+        uint64_t v;
+        DwrfResult res;
+
+        for (uint32_t i = 0; i < e->count; i++)
+        {
+                const ExprInsn *in = &e->insns[i];
+
+                if (++s->steps > EXPR_MAX_STEPS)
+                        return DWRF_DECODE_ERR;
+
+                /* register, implicit and stack value locations are only followed by a piece */
+                if ((s->kind != DWRF_LOC_MEMORY) && (in->op != DW_OP_bit_piece))
+                        return DWRF_DECODE_ERR;
+                s->pending = (in->op != DW_OP_bit_piece);
+
+                switch (in->op)
+                {
+                case DW_OP_constu:
+                        res = expr_push(s, in->a, e->types[in->type]);
+                        break;
+                case DW_OP_addr:
+                        res = expr_push(s, in->a + env->Bias, generic);
+                        break;
+                case DW_OP_dup:
+                case DW_OP_over:
+                case DW_OP_pick:
+                        v = (in->op == DW_OP_dup) ? 0 : (in->op == DW_OP_over) ? 1 : in->a;
+                        if (v >= s->depth)
+                                return DWRF_DECODE_ERR;
+                        x = s->stack[s->depth - 1 - v];
+                        res = expr_push(s, x.v, x.t);
+                        break;
+                case DW_OP_drop:
+                        res = expr_pop(s, &x);
+                        break;
+                case DW_OP_swap:
+                        if (s->depth < 2)
+                                return DWRF_DECODE_ERR;
+                        x = s->stack[s->depth - 1];
+                        s->stack[s->depth - 1] = s->stack[s->depth - 2];
+                        s->stack[s->depth - 2] = x;
+                        res = DWRF_OK;
+                        break;
+                case DW_OP_rot:
+                        /* the top entry moves to the third position, the second and third move up */
+                        if ((res = expr_pop(s, &x)) || (res = expr_pop(s, &y)) || (res = expr_pop(s, &z)))
+                                return res;
+                        s->stack[s->depth++] = x;
+                        s->stack[s->depth++] = z;
+                        s->stack[s->depth++] = y;
+                        break;
+                case DW_OP_abs:
+                case DW_OP_neg:
+                case DW_OP_not:
+                        if ((res = expr_pop(s, &x)))
+                                return res;
+                        if (x.t.kind == EXPR_FLOAT)
+                        {
+                                double d = expr_to_double(x);
+                                if (in->op == DW_OP_not)
+                                        return DWRF_DECODE_ERR;
+                                d = ((in->op == DW_OP_neg) || (d < 0)) ? -d : d;
+                                res = expr_push(s, expr_from_double(d, x.t.size), x.t);
+                        }
+                        else if (in->op == DW_OP_not)
+                                res = expr_push(s, ~x.v, x.t);
+                        else if (in->op == DW_OP_neg)
+                                res = expr_push(s, (uint64_t)0 - x.v, x.t);
+                        else
+                                res = expr_push(s, ((x.t.kind != EXPR_UNSIGNED) && (expr_sext(x.v, x.t.size) < 0)) ?
+                                                (uint64_t)0 - x.v : x.v, x.t);
+                        break;
+                case DW_OP_and:
+                case DW_OP_div:
+                case DW_OP_minus:
+                case DW_OP_mod:
+                case DW_OP_mul:
+                case DW_OP_or:
+                case DW_OP_plus:
+                case DW_OP_shl:
+                case DW_OP_shr:
+                case DW_OP_shra:
+                case DW_OP_xor:
+                case DW_OP_eq:
+                case DW_OP_ge:
+                case DW_OP_gt:
+                case DW_OP_le:
+                case DW_OP_lt:
+                case DW_OP_ne:
+                        res = expr_binary(s, in->op, &generic);
+                        break;
+                case DW_OP_plus_uconst:
+                        if ((res = expr_pop(s, &x)))
+                                return res;
+                        if (x.t.kind == EXPR_FLOAT)
+                                return DWRF_DECODE_ERR;
+                        res = expr_push(s, x.v + in->a, x.t);
+                        break;
+                case DW_OP_skip:
+                        i = (uint32_t)in->a - 1;
+                        continue;
+                case DW_OP_bra:
+                        if ((res = expr_pop(s, &x)))
+                                return res;
+                        if (x.v != 0)
+                                i = (uint32_t)in->a - 1;
+                        continue;
+                case DW_OP_regx:
+                        s->kind = DWRF_LOC_REGISTER;
+                        s->loc = (DwrfLocPiece){ .Value = in->reg, .Kind = DWRF_LOC_REGISTER };
+                        res = DWRF_OK;
+                        break;
+                case DW_OP_bregx:
+                        if ((res = expr_read_reg(s, in->reg, &v)))
+                                return res;
+                        res = expr_push(s, v + in->b, generic);
+                        break;
+                case DW_OP_regval_type:
+                        if ((res = expr_read_reg(s, in->reg, &v)))
+                                return res;
+                        res = expr_push(s, v, e->types[in->type]);
+                        break;
+                case DW_OP_fbreg:
+                        if (!env->HasFrameBase)
+                                return DWRF_NOT_FOUND;
+                        res = expr_push(s, env->FrameBase + in->a, generic);
+                        break;
+                case DW_OP_call_frame_cfa:
+                        if (!env->HasCfa)
+                                return DWRF_NOT_FOUND;
+                        res = expr_push(s, env->Cfa, generic);
+                        break;
+                case DW_OP_push_object_address:
+                        if (!env->HasObjectAddress)
+                                return DWRF_NOT_FOUND;
+                        res = expr_push(s, env->ObjectAddress, generic);
+                        break;
+                case DW_OP_form_tls_address:
+                        if ((res = expr_pop(s, &x)))
+                                return res;
+                        if (env->TlsAddr == NULL)
+                                return DWRF_NOT_FOUND;
+                        if ((res = env->TlsAddr(env->User, x.v, &v)))
+                                return res;
+                        res = expr_push(s, v, generic);
+                        break;
+                case DW_OP_entry_value:
+                        if (env->EntryReg == NULL)
+                                return DWRF_NOT_FOUND;
+                        if ((res = env->EntryReg(env->User, in->reg, &v)))
+                                return res;
+                        res = expr_push(s, v, generic);
+                        break;
+                case DW_OP_deref_size:
+                case DW_OP_deref_type:
+                        if ((res = expr_pop(s, &x)) || (res = expr_read_mem(s, x.v, in->size, e->big, &v)))
+                                return res;
+                        res = expr_push(s, v, (in->op == DW_OP_deref_type) ? e->types[in->type] : generic);
+                        break;
+                case DW_OP_xderef_size:
+                case DW_OP_xderef_type:
+                        return DWRF_UNSUPPORTED;
+                case DW_OP_convert:
+                        if ((res = expr_pop(s, &x)))
+                                return res;
+                        res = expr_push(s, expr_convert(x, e->types[in->type]), e->types[in->type]);
+                        break;
+                case DW_OP_reinterpret:
+                        if ((res = expr_pop(s, &x)))
+                                return res;
+                        if (x.t.size != e->types[in->type].size)
+                                return DWRF_DECODE_ERR;
+                        res = expr_push(s, x.v, e->types[in->type]);
+                        break;
+                case DW_OP_call4:
+                        res = expr_run(s, e->calls[in->a]);
+                        break;
+                case DW_OP_stack_value:
+                        if ((res = expr_pop(s, &x)))
+                                return res;
+                        s->kind = DWRF_LOC_VALUE;
+                        s->loc = (DwrfLocPiece){ .Value = x.v, .Kind = DWRF_LOC_VALUE };
+                        break;
+                case DW_OP_implicit_value:
+                        s->kind = DWRF_LOC_IMPLICIT;
+                        s->loc = (DwrfLocPiece){ .Data = e->data + in->a, .Size = in->b, .Kind = DWRF_LOC_IMPLICIT };
+                        res = DWRF_OK;
+                        break;
+                case DW_OP_implicit_pointer:
+                        s->kind = DWRF_LOC_IMPLICIT_POINTER;
+                        s->loc = (DwrfLocPiece){ .Value = in->a, .Offset = (int64_t)in->b, .Kind = DWRF_LOC_IMPLICIT_POINTER };
+                        res = DWRF_OK;
+                        break;
+                case DW_OP_bit_piece:
+                        res = expr_piece(s, in->a, in->b);
+                        break;
+                default:
+                        return DWRF_DECODE_ERR;
+                }
+
+                if (res)
+                        return res;
+        }
+        return DWRF_OK;
+}
+
+/***************
+ *     API     *
+ ***************/
+
+DwrfResult dwarf_expr_cache_create(DwrfCtx *ctx, DwrfExprCache **cache)
+{
+        InternalDwarfCtx *c = CTX(ctx);
+        DwrfExprCache *out;
+        ElfHeader hdr;
+        DwrfResult res;
+
+        if ((res = validate_ctx(ctx)))
+                return res;
+        if (cache == NULL)
+                return DWRF_BAD_ARG;
+
+        if (get_header(c->elf, &hdr) != ELF_OK)
+                return DWRF_IO_ERR;
+
+        out = calloc(1, sizeof(DwrfExprCache));
+        if (out == NULL)
+                return DWRF_NO_MEM;
+
+        out->ctx = ctx;
+        out->addr_size = (hdr.EI_Class == ELFCLASS64) ? 8 : 4;
+        out->big = (c->endianness == ELFDATA2MSB);
+        dwrf_arena_init(&out->arena);
+        *cache = out;
+        return DWRF_OK;
+}
+
+void dwarf_expr_cache_destroy(DwrfExprCache *cache)
+{
+        if (cache == NULL)
+                return;
+
+        /* the expressions live in the arena */
+        dwrf_map_destroy(&cache->exprs, NULL);
+        dwrf_arena_destroy(&cache->arena);
+        free(cache);
+}
+
+DwrfResult dwarf_expr_compile(DwrfExprCache *cache, DwrfCursor *cur, const uint8_t *expr, uint64_t len,
+                              const DwrfExpr **out)
+{
+        if ((cache == NULL) || ((expr == NULL) && (len > 0)) || (out == NULL))
+                return DWRF_BAD_ARG;
+
+        return expr_get(cache, cur, expr, len, 0, out);
+}
+
+DwrfResult dwarf_expr_compile_attr(DwrfExprCache *cache, DwrfCursor *cur, const DwrfAttr *attr,
+                                   const DwrfExpr **out)
+{
+        InternalDwarfCtx *ctx;
+        DwrfSection *sec;
+        DwrfUnitHeader unit;
+        DwrfResult res;
+
+        if ((cache == NULL) || (cur == NULL) || (attr == NULL) || (out == NULL))
+                return DWRF_BAD_ARG;
+
+        if ((res = dwarf_cursor_unit(cur, &unit)))
+                return res;
+
+        switch (attr->Form)
+        {
+        case DW_FORM_exprloc:
+                break;
+        case DW_FORM_block:
+        case DW_FORM_block1:
+        case DW_FORM_block2:
+        case DW_FORM_block4:
+                if (unit.Version >= 4)
+                        return DWRF_BAD_ARG;
+                break;
+        default:
+                return DWRF_BAD_ARG;
+        }
+
+        ctx = CTX(cache->ctx);
+        sec = &ctx->debug_info;
+        if ((res = dwrf_load_section(ctx, sec)))
+                return res;
+        if ((attr->Value > sec->hdr.Size) || (attr->Size > sec->hdr.Size - attr->Value))
+                return DWRF_DECODE_ERR;
+
+        return expr_get(cache, cur, sec->data + attr->Value, attr->Size, 0, out);
+}
+
+DwrfResult dwarf_expr_eval(const DwrfExpr *expr, const DwrfExprEnv *env, DwrfLocPiece *pieces, uint32_t max,
+                           uint32_t *count)
+{
+        static const DwrfExprEnv no_env;
+        ExprState s;
+        DwrfResult res;
+
+        if ((expr == NULL) || ((pieces == NULL) && (max > 0)) || (count == NULL))
+                return DWRF_BAD_ARG;
+
+        memset(&s, 0, sizeof(s));
+        s.env = (env != NULL) ? env : &no_env;
+        s.kind = DWRF_LOC_MEMORY;
+        s.pieces = pieces;
+        s.max = max;
+
+        if (s.env->HasInitial && (res = expr_push(&s, s.env->Initial, expr->types[0])))
+                return res;
+
+        if ((res = expr_run(&s, expr)))
+                return res;
+
+        if (s.count == 0)
+        {
+                /* a single location, memory ones take the address on top of the stack */
+                if ((res = expr_piece(&s, 0, 0)))
+                        return res;
+        }
+        else if (s.pending)
+                return DWRF_DECODE_ERR; // operations after the last piece
+
+        *count = s.count;
+        return (s.count > max) ? DWRF_BUFFER_OVERFLOW : DWRF_OK;
+}
+
+DwrfResult dwarf_expr_cache_stats(const DwrfExprCache *cache, DwrfExprCacheStats *stats)
+{
+        if ((cache == NULL) || (stats == NULL))
+                return DWRF_BAD_ARG;
+
+        *stats = cache->stats;
+        return DWRF_OK;
+}
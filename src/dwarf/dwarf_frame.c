@@ -0,0 +1,1368 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ * Call frames *
+ ***************/
+ // section 6.4 of spec v5, .eh_frame and .eh_frame_hdr are described by the LSB core specification
+
+#define CFI_COLUMNS     2u      // registers whose rules are tracked
+#define CFI_COL_RA      0
+#define CFI_COL_FP      1
+#define CFI_STACK_DEPTH 16u     // nesting of DW_CFA_remember_state
+
+/* Kinds of the CFA of precompiled rows besides the DwrfRuleKind ones */
+#define CFI_ROW_NONE    0xFEu   // no FDE covers the addresses
+#define CFI_ROW_SLOW    0xFDu   // the rules don't fit a compact row, the FDE is interpreted
+
+enum { CFI_SRC_EH, CFI_SRC_DEBUG, CFI_SRC_COUNT };
+
+/** Entry of a search table built from the FDEs of a section */
+typedef struct
+{
+        uint64_t pc;            // [pc, end) covered by the FDE
+        uint64_t end;
+        uint64_t offset;        // offset of the FDE in the section
+} CfiFdeRef;
+
+/** One section of call frame information and the table its FDEs are looked up in */
+typedef struct
+{
+        const uint8_t *data;
+        uint64_t size;
+        uint64_t addr;          // virtual address of the section, base of DW_EH_PE_pcrel pointers
+        uint8_t eh;             // .eh_frame layout: relative CIE pointers, encoded addresses
+        uint8_t present;
+        CfiFdeRef *fdes;        // built table, NULL when .eh_frame_hdr is used
+        uint64_t fde_count;
+        const uint8_t *hdr;     // .eh_frame_hdr, the sorted (initial location, FDE address) pairs are read in place
+        const uint8_t *hdr_table;
+        uint64_t hdr_addr;
+        uint64_t hdr_count;
+        uint8_t hdr_enc;        // DW_EH_PE_* of the pairs
+        uint8_t hdr_size;       // bytes of one value of a pair
+} CfiSource;
+
+/** Precompiled row, valid from pc up to the pc of the next one */
+typedef struct
+{
+        uint64_t pc;
+        int32_t cfa;                    // offset from cfa_reg or index of the expression
+        int32_t col[CFI_COLUMNS];       // offset, register or expression index, depending on the kind
+        uint16_t cfa_reg;               // source of CFI_ROW_SLOW rows
+        uint16_t ra_reg;
+        uint8_t cfa_kind;               // DWRF_RULE_* or CFI_ROW_*
+        uint8_t kind[CFI_COLUMNS];
+        uint8_t signal;
+} CfiRow;
+
+_Static_assert(sizeof(CfiRow) == 32, "precompiled rows are expected to stay compact");
+
+typedef struct
+{
+        const uint8_t *expr;
+        uint32_t len;
+} CfiExpr;
+
+struct DwrfCfi
+{
+        DwrfCtx dwarf;                          // first for alignment, owns the frame sections
+        CfiSource sources[CFI_SRC_COUNT];       // searched in order
+        CfiRow *rows;                           // precompiled, ends with a CFI_ROW_NONE row
+        uint64_t row_count;
+        CfiExpr *exprs;
+        uint64_t expr_count;
+        uint16_t fp_reg;
+        uint8_t addr_size;
+        uint8_t big;
+};
+
+/** Common Information Entry, the part of an FDE shared by many */
+typedef struct
+{
+        const uint8_t *insns;           // initial instructions
+        const uint8_t *insns_end;
+        uint64_t code_align;
+        int64_t data_align;
+        uint64_t ra_reg;
+        uint8_t fde_enc;                // DW_EH_PE_* of the FDE addresses
+        uint8_t aug_data;               // 'z', the FDEs carry augmentation data
+        uint8_t signal;                 // 'S'
+        uint8_t addr_size;
+        uint8_t seg_size;
+} CfiCie;
+
+typedef struct
+{
+        CfiCie cie;
+        uint64_t pc;                    // [pc, end) covered by the FDE
+        uint64_t end;
+        const uint8_t *insns;
+        const uint8_t *insns_end;
+} CfiFde;
+
+/** Last CIE parsed, consecutive FDEs usually share it */
+typedef struct
+{
+        uint64_t offset;
+        CfiCie cie;
+} CfiCieCache;
+
+/** Rules of the CFA and of the tracked registers at one address */
+typedef struct
+{
+        DwrfRule cfa;
+        DwrfRule cols[CFI_COLUMNS];
+} CfiState;
+
+/** Interpreter of the call frame instructions */
+typedef struct
+{
+        const DwrfCfi *cfi;
+        const CfiSource *src;
+        const CfiCie *cie;
+        uint64_t regs[CFI_COLUMNS];     // register of each tracked column
+        CfiState init;                  // after the initial instructions, for DW_CFA_restore
+        CfiState stack[CFI_STACK_DEPTH];
+        uint32_t depth;
+} CfiMachine;
+
+/** Receives the rows of an FDE as they are found, [low, high) */
+typedef DwrfResult (*CfiRowFn)(void *user, uint64_t low, uint64_t high, const CfiState *state);
+
+static inline uint64_t cfi_mask(const DwrfCfi *cfi, uint64_t v)
+{
+        return (cfi->addr_size == 8) ? v : (v & 0xFFFFFFFFu);
+}
+
+/** Size of the values of a fixed size pointer encoding, 0 for the variable ones */
+static uint8_t cfi_enc_size(const DwrfCfi *cfi, uint8_t enc)
+{
+        switch (enc & 0x0F)
+        {
+        case DW_EH_PE_absptr:
+                return cfi->addr_size;
+        case DW_EH_PE_udata2:
+        case DW_EH_PE_sdata2:
+                return 2;
+        case DW_EH_PE_udata4:
+        case DW_EH_PE_sdata4:
+                return 4;
+        case DW_EH_PE_udata8:
+        case DW_EH_PE_sdata8:
+                return 8;
+        default:
+                return 0;
+        }
+}
+
+static inline uint64_t cfi_sign_extend(uint64_t v, uint8_t size)
+{
+        uint64_t sign;
+
+        if (size >= 8)
+                return v;
+        sign = 1ULL << (8 * size - 1);
+        return (v ^ sign) - sign;
+}
+
+/**
+ * Reads a pointer encoded with enc (DW_EH_PE_*). Only the format is applied when apply is false,
+ * which is how the FDE ranges and the pointers that are skipped are read.
+ */
+static DwrfResult cfi_pointer(const DwrfCfi *cfi, const CfiSource *src, DwrfBuf *b, uint8_t enc, uint8_t apply,
+                              uint64_t *val)
+{
+        uint64_t field = src->addr + (uint64_t)(b->p - src->data);
+        uint8_t size = cfi_enc_size(cfi, enc);
+        DwrfResult res;
+        uint64_t v;
+        int64_t s;
+
+        if ((enc & 0x70) == DW_EH_PE_aligned)
+        {
+                uint64_t pad = (cfi->addr_size - field % cfi->addr_size) % cfi->addr_size;
+                if ((res = buf_skip(b, pad)))
+                        return res;
+                field += pad;
+        }
+
+        switch (enc & 0x0F)
+        {
+        case DW_EH_PE_uleb128:
+                res = buf_uleb(b, &v);
+                break;
+        case DW_EH_PE_sleb128:
+                res = buf_sleb(b, &s);
+                v = (uint64_t)s;
+                break;
+        default:
+                if (size == 0)
+                        return DWRF_DECODE_ERR;
+                if ((res = buf_uN(b, size, &v)))
+                        return res;
+                if (enc & 0x08)
+                        v = cfi_sign_extend(v, size);
+                break;
+        }
+        if (res || !apply)
+        {
+                *val = v;
+                return res;
+        }
+
+        switch (enc & 0x70)
+        {
+        case DW_EH_PE_absptr:
+        case DW_EH_PE_aligned:
+                break;
+        case DW_EH_PE_pcrel:
+                v += field;
+                break;
+        case DW_EH_PE_datarel:
+                /* relative to .eh_frame_hdr in the header, to the GOT elsewhere, which isn't known here */
+                if (src->hdr == NULL)
+                        return DWRF_UNSUPPORTED;
+                v += src->hdr_addr;
+                break;
+        default:
+                return DWRF_UNSUPPORTED;
+        }
+
+        if (enc & DW_EH_PE_indirect)
+                return DWRF_UNSUPPORTED;
+
+        *val = cfi_mask(cfi, v);
+        return DWRF_OK;
+}
+
+/**
+ * Reads the header of the CIE or FDE at offset: *b is bounded to the entry and left after its id,
+ * *cie_off receives the offset of the CIE of an FDE (UINT64_MAX for a CIE) and *next the offset of
+ * the following entry. DWRF_END marks the terminator of .eh_frame and the end of the section.
+ */
+static DwrfResult cfi_entry(const DwrfCfi *cfi, const CfiSource *src, uint64_t offset, DwrfBuf *b, uint64_t *cie_off,
+                            uint64_t *next)
+{
+        uint64_t length, id, id_off;
+        uint8_t offset_size = 4;
+        DwrfResult res;
+
+        if (offset >= src->size)
+                return DWRF_END;
+
+        *b = (DwrfBuf){ src->data + offset, src->data + src->size, cfi->big };
+        if ((res = buf_uN(b, 4, &length)))
+                return res;
+        if (length == 0xFFFFFFFFu)
+        {
+                offset_size = 8;
+                if ((res = buf_uN(b, 8, &length)))
+                        return res;
+        }
+        else if (length >= 0xFFFFFFF0u)
+                return DWRF_DECODE_ERR;
+
+        if (length == 0)
+                return src->eh ? DWRF_END : DWRF_DECODE_ERR;
+        if (length > buf_left(b))
+                return DWRF_DECODE_ERR;
+
+        b->end = b->p + length;
+        *next = (uint64_t)(b->end - src->data);
+
+        id_off = (uint64_t)(b->p - src->data);
+        if ((res = buf_uN(b, src->eh ? 4 : offset_size, &id)))
+                return res;
+
+        if (src->eh)
+        {
+                /* .eh_frame CIE pointers count back from their own position */
+                if (id == 0)
+                        *cie_off = UINT64_MAX;
+                else if (id > id_off)
+                        return DWRF_DECODE_ERR;
+                else
+                        *cie_off = id_off - id;
+        }
+        else
+        {
+                if (id == ((offset_size == 4) ? 0xFFFFFFFFu : UINT64_MAX))
+                        *cie_off = UINT64_MAX;
+                else
+                        *cie_off = id;
+        }
+        return DWRF_OK;
+}
+
+static DwrfResult cfi_parse_cie(const DwrfCfi *cfi, const CfiSource *src, uint64_t offset, CfiCie *cie)
+{
+        const char *aug;
+        uint64_t cie_off, next, version, v;
+        DwrfResult res;
+        DwrfBuf b;
+
+        if ((res = cfi_entry(cfi, src, offset, &b, &cie_off, &next)))
+                return (res == DWRF_END) ? DWRF_DECODE_ERR : res;
+        if (cie_off != UINT64_MAX)
+                return DWRF_DECODE_ERR;
+
+        if ((res = buf_uN(&b, 1, &version)))
+                return res;
+        if ((version != 1) && (version != 3) && (version != 4))
+                return DWRF_UNSUPPORTED;
+
+        aug = (const char *)b.p;
+        while ((b.p < b.end) && (*b.p != 0))
+                b.p++;
+        if ((res = buf_skip(&b, 1)))
+                return res;
+
+        *cie = (CfiCie){0};
+        cie->addr_size = cfi->addr_size;
+        cie->fde_enc = DW_EH_PE_absptr;
+
+        /* pointer of the old GCC "eh" augmentation, before the alignment factors */
+        if ((strcmp(aug, "eh") == 0) && (res = buf_skip(&b, cfi->addr_size)))
+                return res;
+
+        if (version >= 4)
+        {
+                uint64_t addr_size, seg_size;
+
+                if ((res = buf_uN(&b, 1, &addr_size)) || (res = buf_uN(&b, 1, &seg_size)))
+                        return res;
+                if ((addr_size == 0) || (addr_size > 8) || (seg_size > 8))
+                        return DWRF_DECODE_ERR;
+                cie->addr_size = (uint8_t)addr_size;
+                cie->seg_size = (uint8_t)seg_size;
+        }
+
+        if ((res = buf_uleb(&b, &cie->code_align)) || (res = buf_sleb(&b, &cie->data_align)))
+                return res;
+        if (version == 1)
+                res = buf_uN(&b, 1, &cie->ra_reg);
+        else
+                res = buf_uleb(&b, &cie->ra_reg);
+        if (res)
+                return res;
+
+        if (aug[0] == 'z')
+        {
+                DwrfBuf data = b;
+
+                if ((res = buf_uleb(&b, &v)) || (res = buf_skip(&b, v)))
+                        return res;
+                data.p = b.p - v;
+                data.end = b.p;
+
+                /* letters after an unknown one can't be located, their data is skipped with the rest */
+                for (const char *c = aug + 1; *c != 0; c++)
+                {
+                        uint64_t enc;
+
+                        if (*c == 'S')
+                                cie->signal = true;
+                        else if ((*c == 'B') || (*c == 'G'))
+                                continue;       // AArch64 pointer authentication key and memory tagging
+                        else if ((*c == 'L') || (*c == 'R') || (*c == 'P'))
+                        {
+                                if ((res = buf_uN(&data, 1, &enc)))
+                                        return res;
+                                if (*c == 'R')
+                                        cie->fde_enc = (uint8_t)enc;
+                                else if ((*c == 'P') &&
+                                         (res = cfi_pointer(cfi, src, &data, (uint8_t)(enc & 0x7F), false, &v)))
+                                        return res;
+                        }
+                        else
+                                break;
+                }
+                cie->aug_data = true;
+        }
+        else if ((aug[0] != 0) && (strcmp(aug, "eh") != 0))
+                return DWRF_UNSUPPORTED;        // the layout of the rest is unknown
+
+        cie->insns = b.p;
+        cie->insns_end = b.end;
+        return DWRF_OK;
+}
+
+/** Parses the FDE at offset and its CIE, cache (optional) keeps the last CIE parsed. */
+static DwrfResult cfi_parse_fde(const DwrfCfi *cfi, const CfiSource *src, uint64_t offset, CfiCieCache *cache,
+                                CfiFde *fde)
+{
+        uint64_t cie_off, next, range, len;
+        DwrfResult res;
+        DwrfBuf b;
+
+        if ((res = cfi_entry(cfi, src, offset, &b, &cie_off, &next)))
+                return (res == DWRF_END) ? DWRF_DECODE_ERR : res;
+        if (cie_off == UINT64_MAX)
+                return DWRF_DECODE_ERR;
+
+        if ((cache != NULL) && (cache->offset == cie_off))
+                fde->cie = cache->cie;
+        else
+        {
+                if ((res = cfi_parse_cie(cfi, src, cie_off, &fde->cie)))
+                        return res;
+                if (cache != NULL)
+                {
+                        cache->offset = cie_off;
+                        cache->cie = fde->cie;
+                }
+        }
+
+        const CfiCie *cie = &fde->cie;
+        uint8_t enc = cie->fde_enc;
+
+        /* .debug_frame addresses are plain values of the CIE's address size */
+        if (!src->eh)
+                enc = (cie->addr_size == 8) ? DW_EH_PE_udata8 : ((cie->addr_size == 4) ? DW_EH_PE_udata4 : DW_EH_PE_udata2);
+
+        if ((res = buf_skip(&b, cie->seg_size)) || (res = cfi_pointer(cfi, src, &b, enc, true, &fde->pc)) ||
+            (res = cfi_pointer(cfi, src, &b, (uint8_t)(enc & 0x0F), false, &range)))
+                return res;
+
+        if (cie->aug_data && ((res = buf_uleb(&b, &len)) || (res = buf_skip(&b, len))))
+                return res;
+
+        fde->end = fde->pc + range;
+        fde->insns = b.p;
+        fde->insns_end = b.end;
+        return DWRF_OK;
+}
+
+/***************
+ * Interpreter *
+ ***************/
+
+static void cfi_set(const CfiMachine *m, CfiState *st, uint64_t reg, DwrfRule rule)
+{
+        for (uint32_t i = 0; i < CFI_COLUMNS; i++)
+        {
+                if (m->regs[i] == reg)
+                        st->cols[i] = rule;
+        }
+}
+
+static void cfi_restore(const CfiMachine *m, CfiState *st, uint64_t reg)
+{
+        for (uint32_t i = 0; i < CFI_COLUMNS; i++)
+        {
+                if (m->regs[i] == reg)
+                        st->cols[i] = m->init.cols[i];
+        }
+}
+
+static inline int64_t cfi_factor(const CfiCie *cie, uint64_t v)
+{
+        return (int64_t)(v * (uint64_t)cie->data_align);
+}
+
+static DwrfResult cfi_block(DwrfBuf *b, DwrfRule *rule)
+{
+        uint64_t len;
+        DwrfResult res;
+
+        if ((res = buf_uleb(b, &len)))
+                return res;
+        if ((len > buf_left(b)) || (len > UINT32_MAX))
+                return DWRF_DECODE_ERR;
+
+        rule->Expr = b->p;
+        rule->ExprLen = (uint32_t)len;
+        b->p += len;
+        return DWRF_OK;
+}
+
+static DwrfResult cfi_cfa_reg(uint64_t reg, DwrfRule *cfa)
+{
+        if (reg > UINT16_MAX)
+                return DWRF_UNSUPPORTED;
+
+        cfa->Kind = DWRF_RULE_REGISTER;
+        cfa->Reg = (uint16_t)reg;
+        cfa->Expr = NULL;
+        cfa->ExprLen = 0;
+        return DWRF_OK;
+}
+
+/**
+ * Runs the instructions [b.p, b.end) from address *loc. Rows are handed to fn (optional) as the location
+ * advances. Stops with DWRF_END before an advance past target, *next then receives the end of the row.
+ */
+static DwrfResult cfi_execute(CfiMachine *m, CfiState *st, DwrfBuf b, uint64_t *loc, uint64_t target, uint64_t *next,
+                              CfiRowFn fn, void *user)
+{
+        const CfiCie *cie = m->cie;
+        DwrfResult res = DWRF_OK;
+
+        while ((b.p < b.end) && (res == DWRF_OK))
+        {
+                uint64_t op, reg, v, new_loc = *loc;
+                uint8_t advance = false;
+                DwrfRule rule = {0};
+                int64_t s;
+
+                if ((res = buf_uN(&b, 1, &op)))
+                        break;
+
+                switch (op & 0xC0)
+                {
+                case DW_CFA_advance_loc:
+                        new_loc = *loc + (op & 0x3F) * cie->code_align;
+                        advance = true;
+                        break;
+                case DW_CFA_offset:
+                        if ((res = buf_uleb(&b, &v)))
+                                break;
+                        rule.Kind = DWRF_RULE_OFFSET;
+                        rule.Offset = cfi_factor(cie, v);
+                        cfi_set(m, st, op & 0x3F, rule);
+                        break;
+                case DW_CFA_restore:
+                        cfi_restore(m, st, op & 0x3F);
+                        break;
+                default:
+                        switch (op)
+                        {
+                        case DW_CFA_nop:
+                        case DW_CFA_GNU_window_save:
+                                break;
+                        case DW_CFA_set_loc:
+                        {
+                                uint8_t enc = m->src->eh ? cie->fde_enc :
+                                              ((cie->addr_size == 8) ? DW_EH_PE_udata8 : DW_EH_PE_udata4);
+                                res = cfi_pointer(m->cfi, m->src, &b, enc, true, &new_loc);
+                                advance = true;
+                                break;
+                        }
+                        case DW_CFA_advance_loc1:
+                        case DW_CFA_advance_loc2:
+                        case DW_CFA_advance_loc4:
+                        case DW_CFA_MIPS_advance_loc8:
+                        {
+                                static const uint8_t sizes[] = { 1, 2, 4 };
+                                uint8_t size = (op == DW_CFA_MIPS_advance_loc8) ? 8 : sizes[op - DW_CFA_advance_loc1];
+                                res = buf_uN(&b, size, &v);
+                                new_loc = *loc + v * cie->code_align;
+                                advance = true;
+                                break;
+                        }
+                        case DW_CFA_offset_extended:
+                        case DW_CFA_val_offset:
+                                if ((res = buf_uleb(&b, &reg)) || (res = buf_uleb(&b, &v)))
+                                        break;
+                                rule.Kind = (op == DW_CFA_val_offset) ? DWRF_RULE_VAL_OFFSET : DWRF_RULE_OFFSET;
+                                rule.Offset = cfi_factor(cie, v);
+                                cfi_set(m, st, reg, rule);
+                                break;
+                        case DW_CFA_offset_extended_sf:
+                        case DW_CFA_val_offset_sf:
+                                if ((res = buf_uleb(&b, &reg)) || (res = buf_sleb(&b, &s)))
+                                        break;
+                                rule.Kind = (op == DW_CFA_val_offset_sf) ? DWRF_RULE_VAL_OFFSET : DWRF_RULE_OFFSET;
+                                rule.Offset = cfi_factor(cie, (uint64_t)s);
+                                cfi_set(m, st, reg, rule);
+                                break;
+                        case DW_CFA_GNU_negative_offset_extended:
+                                if ((res = buf_uleb(&b, &reg)) || (res = buf_uleb(&b, &v)))
+                                        break;
+                                rule.Kind = DWRF_RULE_OFFSET;
+                                rule.Offset = -cfi_factor(cie, v);
+                                cfi_set(m, st, reg, rule);
+                                break;
+                        case DW_CFA_restore_extended:
+                                if ((res = buf_uleb(&b, &reg)) == DWRF_OK)
+                                        cfi_restore(m, st, reg);
+                                break;
+                        case DW_CFA_undefined:
+                        case DW_CFA_same_value:
+                                if ((res = buf_uleb(&b, &reg)))
+                                        break;
+                                rule.Kind = (op == DW_CFA_undefined) ? DWRF_RULE_UNDEFINED : DWRF_RULE_SAME_VALUE;
+                                cfi_set(m, st, reg, rule);
+                                break;
+                        case DW_CFA_register:
+                                if ((res = buf_uleb(&b, &reg)) || (res = buf_uleb(&b, &v)))
+                                        break;
+                                if (v > UINT16_MAX)
+                                {
+                                        res = DWRF_UNSUPPORTED;
+                                        break;
+                                }
+                                rule.Kind = DWRF_RULE_REGISTER;
+                                rule.Reg = (uint16_t)v;
+                                cfi_set(m, st, reg, rule);
+                                break;
+                        case DW_CFA_remember_state:
+                                if (m->depth == CFI_STACK_DEPTH)
+                                {
+                                        res = DWRF_UNSUPPORTED;
+                                        break;
+                                }
+                                m->stack[m->depth++] = *st;
+                                break;
+                        case DW_CFA_restore_state:
+                                if (m->depth == 0)
+                                {
+                                        res = DWRF_DECODE_ERR;
+                                        break;
+                                }
+                                *st = m->stack[--m->depth];
+                                break;
+                        case DW_CFA_def_cfa:
+                                if ((res = buf_uleb(&b, &reg)) || (res = buf_uleb(&b, &v)) || (res = cfi_cfa_reg(reg, &st->cfa)))
+                                        break;
+                                st->cfa.Offset = (int64_t)v;
+                                break;
+                        case DW_CFA_def_cfa_sf:
+                                if ((res = buf_uleb(&b, &reg)) || (res = buf_sleb(&b, &s)) || (res = cfi_cfa_reg(reg, &st->cfa)))
+                                        break;
+                                st->cfa.Offset = cfi_factor(cie, (uint64_t)s);
+                                break;
+                        case DW_CFA_def_cfa_register:
+                                if ((res = buf_uleb(&b, &reg)) == DWRF_OK)
+                                        res = cfi_cfa_reg(reg, &st->cfa);
+                                break;
+                        case DW_CFA_def_cfa_offset:
+                                res = buf_uleb(&b, &v);
+                                st->cfa.Offset = (int64_t)v;
+                                break;
+                        case DW_CFA_def_cfa_offset_sf:
+                                res = buf_sleb(&b, &s);
+                                st->cfa.Offset = cfi_factor(cie, (uint64_t)s);
+                                break;
+                        case DW_CFA_def_cfa_expression:
+                                rule.Kind = DWRF_RULE_VAL_EXPRESSION;
+                                if ((res = cfi_block(&b, &rule)) == DWRF_OK)
+                                        st->cfa = rule;
+                                break;
+                        case DW_CFA_expression:
+                        case DW_CFA_val_expression:
+                                rule.Kind = (op == DW_CFA_expression) ? DWRF_RULE_EXPRESSION : DWRF_RULE_VAL_EXPRESSION;
+                                if (((res = buf_uleb(&b, &reg)) == DWRF_OK) && ((res = cfi_block(&b, &rule)) == DWRF_OK))
+                                        cfi_set(m, st, reg, rule);
+                                break;
+                        case DW_CFA_GNU_args_size:
+                                res = buf_uleb(&b, &v);
+                                break;
+                        default:
+                                res = DWRF_DECODE_ERR;
+                                break;
+                        }
+                        break;
+                }
+
+                if (res || !advance)
+                        continue;
+
+                if (new_loc < *loc)
+                        return DWRF_DECODE_ERR;
+                if (new_loc > target)
+                {
+                        *next = new_loc;
+                        return DWRF_END;
+                }
+                if ((fn != NULL) && (new_loc > *loc) && (res = fn(user, *loc, new_loc, st)))
+                        return res;
+                *loc = new_loc;
+        }
+        return res;
+}
+
+/** Prepares the machine for an FDE and runs the initial instructions of its CIE into *st. */
+static DwrfResult cfi_machine_init(const DwrfCfi *cfi, const CfiSource *src, const CfiFde *fde, CfiMachine *m, CfiState *st)
+{
+        uint64_t loc = fde->pc, next;
+        DwrfResult res;
+
+        m->cfi = cfi;
+        m->src = src;
+        m->cie = &fde->cie;
+        m->regs[CFI_COL_RA] = fde->cie.ra_reg;
+        m->regs[CFI_COL_FP] = cfi->fp_reg;
+        m->depth = 0;
+
+        *st = (CfiState){0};
+        st->cfa.Kind = DWRF_RULE_UNDEFINED;
+        for (uint32_t i = 0; i < CFI_COLUMNS; i++)
+                st->cols[i].Kind = DWRF_RULE_SAME_VALUE;
+
+        /* the initial instructions don't advance the location */
+        res = cfi_execute(m, st, (DwrfBuf){ fde->cie.insns, fde->cie.insns_end, cfi->big }, &loc, UINT64_MAX, &next,
+                          NULL, NULL);
+        m->init = *st;
+        m->depth = 0;
+        return res;
+}
+
+static void cfi_fill_row(const CfiFde *fde, const CfiState *st, uint64_t low, uint64_t high, DwrfUnwindRow *row)
+{
+        row->Low = low;
+        row->High = high;
+        row->Cfa = st->cfa;
+        row->Ra = st->cols[CFI_COL_RA];
+        row->Fp = st->cols[CFI_COL_FP];
+        row->RaReg = (uint16_t)fde->cie.ra_reg;
+        row->Signal = fde->cie.signal;
+}
+
+/***************
+ *   Search    *
+ ***************/
+
+static inline uint64_t cfi_hdr_value(const DwrfCfi *cfi, const CfiSource *src, const uint8_t *p)
+{
+        uint64_t v = load_uN(p, src->hdr_size, cfi->big);
+
+        if (src->hdr_enc & 0x08)
+                v = cfi_sign_extend(v, src->hdr_size);
+
+        if ((src->hdr_enc & 0x70) == DW_EH_PE_datarel)
+                v += src->hdr_addr;
+        else if ((src->hdr_enc & 0x70) == DW_EH_PE_pcrel)
+                v += src->hdr_addr + (uint64_t)(p - src->hdr);
+        return cfi_mask(cfi, v);
+}
+
+/** Offset of the FDE whose initial location is the closest at or below pc, DWRF_NOT_FOUND if none. */
+static DwrfResult cfi_search(const DwrfCfi *cfi, const CfiSource *src, uint64_t pc, uint64_t *offset)
+{
+        uint64_t lo = 0, hi;
+
+        if (src->hdr != NULL)
+        {
+                uint8_t pair = (uint8_t)(2 * src->hdr_size);
+                uint64_t addr;
+
+                hi = src->hdr_count;
+                while (lo < hi)
+                {
+                        uint64_t mid = lo + (hi - lo) / 2;
+                        if (cfi_hdr_value(cfi, src, src->hdr_table + mid * pair) <= pc)
+                                lo = mid + 1;
+                        else
+                                hi = mid;
+                }
+                if (lo == 0)
+                        return DWRF_NOT_FOUND;
+
+                addr = cfi_hdr_value(cfi, src, src->hdr_table + (lo - 1) * pair + src->hdr_size);
+                if ((addr < src->addr) || (addr - src->addr >= src->size))
+                        return DWRF_DECODE_ERR;
+                *offset = addr - src->addr;
+                return DWRF_OK;
+        }
+
+        hi = src->fde_count;
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (src->fdes[mid].pc <= pc)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if ((lo == 0) || (pc >= src->fdes[lo - 1].end))
+                return DWRF_NOT_FOUND;
+
+        *offset = src->fdes[lo - 1].offset;
+        return DWRF_OK;
+}
+
+/** Interprets the FDE of a section that covers pc. */
+static DwrfResult cfi_find_source(const DwrfCfi *cfi, const CfiSource *src, uint64_t pc, DwrfUnwindRow *row)
+{
+        uint64_t offset, loc, next;
+        CfiMachine m;
+        CfiState st;
+        CfiFde fde;
+        DwrfResult res;
+
+        if (!src->present)
+                return DWRF_NOT_FOUND;
+
+        if ((res = cfi_search(cfi, src, pc, &offset)) || (res = cfi_parse_fde(cfi, src, offset, NULL, &fde)))
+                return res;
+        if ((pc < fde.pc) || (pc >= fde.end))
+                return DWRF_NOT_FOUND;
+
+        if ((res = cfi_machine_init(cfi, src, &fde, &m, &st)))
+                return res;
+
+        loc = fde.pc;
+        next = fde.end;
+        res = cfi_execute(&m, &st, (DwrfBuf){ fde.insns, fde.insns_end, cfi->big }, &loc, pc, &next, NULL, NULL);
+        if (res && (res != DWRF_END))
+                return res;
+
+        cfi_fill_row(&fde, &st, loc, (next < fde.end) ? next : fde.end, row);
+        return DWRF_OK;
+}
+
+/***************
+ *   Tables    *
+ ***************/
+
+/** Growable list of FDE references */
+typedef struct
+{
+        CfiFdeRef *refs;
+        uint64_t count;
+        uint64_t cap;
+} CfiRefList;
+
+static DwrfResult cfi_ref_push(CfiRefList *list, CfiFdeRef ref)
+{
+        if (list->count == list->cap)
+        {
+                uint64_t cap = list->cap ? list->cap * 2 : 256;
+                CfiFdeRef *refs = realloc(list->refs, (size_t)cap * sizeof(CfiFdeRef));
+                if (refs == NULL)
+                        return DWRF_NO_MEM;
+                list->refs = refs;
+                list->cap = cap;
+        }
+
+        list->refs[list->count++] = ref;
+        return DWRF_OK;
+}
+
+static int cfi_ref_cmp(const void *a, const void *b)
+{
+        const CfiFdeRef *x = a, *y = b;
+
+        if (x->pc != y->pc)
+                return (x->pc < y->pc) ? -1 : 1;
+        if (x->offset != y->offset)
+                return (x->offset < y->offset) ? -1 : 1;
+        return 0;
+}
+
+/**
+ * Walks every entry of a section and lists its FDEs, the offset of those of the second
+ * source are tagged with the top bit. FDEs with an empty or wrapping range (discarded by the linker) are left out.
+ */
+static DwrfResult cfi_collect(const DwrfCfi *cfi, const CfiSource *src, uint64_t tag, CfiRefList *list)
+{
+        CfiCieCache cache = { UINT64_MAX, {0} };
+        uint64_t offset = 0, next, cie_off;
+        DwrfResult res;
+        DwrfBuf b;
+
+        while ((res = cfi_entry(cfi, src, offset, &b, &cie_off, &next)) == DWRF_OK)
+        {
+                CfiFde fde;
+
+                if (cie_off != UINT64_MAX)
+                {
+                        if ((res = cfi_parse_fde(cfi, src, offset, &cache, &fde)))
+                                return res;
+                        if ((fde.end > fde.pc) && (res = cfi_ref_push(list, (CfiFdeRef){ fde.pc, fde.end, offset | tag })))
+                                return res;
+                }
+                offset = next;
+        }
+        return (res == DWRF_END) ? DWRF_OK : res;
+}
+
+/** Sets up the in place lookup through .eh_frame_hdr, false when the header can't be used. */
+static uint8_t cfi_read_header(const DwrfCfi *cfi, CfiSource *src, const DwrfSection *sec)
+{
+        CfiSource hdr = { .data = sec->data, .size = sec->hdr.Size, .addr = sec->hdr.Address, .eh = true };
+        DwrfBuf b = { sec->data, sec->data + sec->hdr.Size, cfi->big };
+        uint64_t version, ptr_enc, count_enc, table_enc, ptr, count;
+        uint8_t size;
+
+        /* datarel values of the header are relative to its start */
+        hdr.hdr = sec->data;
+        hdr.hdr_addr = sec->hdr.Address;
+
+        if (buf_uN(&b, 1, &version) || buf_uN(&b, 1, &ptr_enc) || buf_uN(&b, 1, &count_enc) || buf_uN(&b, 1, &table_enc))
+                return false;
+        if ((version != 1) || (count_enc == DW_EH_PE_omit) || (table_enc == DW_EH_PE_omit))
+                return false;
+        if ((ptr_enc != DW_EH_PE_omit) && cfi_pointer(cfi, &hdr, &b, (uint8_t)ptr_enc, true, &ptr))
+                return false;
+        if (cfi_pointer(cfi, &hdr, &b, (uint8_t)count_enc, true, &count))
+                return false;
+
+        /* the pairs are only searched in place when their values have a fixed size */
+        size = cfi_enc_size(cfi, (uint8_t)table_enc);
+        if ((size == 0) || (table_enc & DW_EH_PE_indirect))
+                return false;
+        if (((table_enc & 0x70) != DW_EH_PE_absptr) && ((table_enc & 0x70) != DW_EH_PE_datarel) &&
+            ((table_enc & 0x70) != DW_EH_PE_pcrel))
+                return false;
+        if (count > buf_left(&b) / (2u * size))
+                return false;
+
+        src->hdr = sec->data;
+        src->hdr_table = b.p;
+        src->hdr_addr = sec->hdr.Address;
+        src->hdr_count = count;
+        src->hdr_enc = (uint8_t)table_enc;
+        src->hdr_size = size;
+        return true;
+}
+
+/** Builds the search table of a section that has no usable header */
+static DwrfResult cfi_build_table(const DwrfCfi *cfi, CfiSource *src)
+{
+        CfiRefList list = {0};
+        DwrfResult res;
+
+        if ((res = cfi_collect(cfi, src, 0, &list)))
+        {
+                free(list.refs);
+                return res;
+        }
+
+        qsort(list.refs, (size_t)list.count, sizeof(CfiFdeRef), cfi_ref_cmp);
+        src->fdes = list.refs;
+        src->fde_count = list.count;
+        return DWRF_OK;
+}
+
+static DwrfResult cfi_open_source(InternalDwarfCtx *ctx, DwrfCfi *cfi, CfiSource *src, DwrfSection *sec, uint8_t eh)
+{
+        DwrfResult res;
+
+        if (!sec->present)
+                return DWRF_OK;
+        if ((res = dwrf_load_section(ctx, sec)))
+                return res;
+
+        src->data = sec->data;
+        src->size = sec->hdr.Size;
+        src->addr = sec->hdr.Address;
+        src->eh = eh;
+        src->present = true;
+
+        if (eh && ctx->eh_frame_hdr.present && (dwrf_load_section(ctx, &ctx->eh_frame_hdr) == DWRF_OK) &&
+            cfi_read_header(cfi, src, &ctx->eh_frame_hdr))
+                return DWRF_OK;
+
+        return cfi_build_table(cfi, src);
+}
+
+void dwarf_cfi_destroy(DwrfCfi *cfi)
+{
+        if (cfi == NULL)
+                return;
+
+        for (uint32_t i = 0; i < CFI_SRC_COUNT; i++)
+                free(cfi->sources[i].fdes);
+        free(cfi->rows);
+        free(cfi->exprs);
+        dwarf_destroy(&cfi->dwarf);
+        free(cfi);
+}
+
+DwrfResult dwarf_cfi_create(const ElfCtx *elf, uint16_t fp_reg, DwrfCfi **cfi)
+{
+        InternalDwarfCtx *c;
+        DwrfCfi *out;
+        DwrfResult res;
+        ElfHeader hdr;
+
+        if ((elf == NULL) || (cfi == NULL))
+                return DWRF_BAD_ARG;
+
+        if (get_header(elf, &hdr) != ELF_OK)
+                return DWRF_UNINIT;
+
+        out = calloc(1, sizeof(DwrfCfi));
+        if (out == NULL)
+                return DWRF_NO_MEM;
+
+        if ((res = dwrf_open_sections(elf, &out->dwarf)))
+        {
+                free(out);
+                return res;
+        }
+
+        c = CTX(&out->dwarf);
+        out->fp_reg = fp_reg;
+        out->addr_size = (hdr.EI_Class == ELFCLASS64) ? 8 : 4;
+        out->big = (c->endianness == ELFDATA2MSB);
+
+        if (!c->eh_frame.present && !c->debug_frame.present)
+                res = DWRF_SEC_MISSING;
+        else if (!(res = cfi_open_source(c, out, &out->sources[CFI_SRC_EH], &c->eh_frame, true)))
+                res = cfi_open_source(c, out, &out->sources[CFI_SRC_DEBUG], &c->debug_frame, false);
+
+        if (res)
+        {
+                dwarf_cfi_destroy(out);
+                return res;
+        }
+
+        *cfi = out;
+        return DWRF_OK;
+}
+
+/***************
+ * Precompiled *
+ ***************/
+
+/** Rows of the FDE being compiled */
+typedef struct
+{
+        DwrfCfi *cfi;
+        const CfiFde *fde;
+        uint64_t rows_cap;
+        uint64_t exprs_cap;
+        uint8_t source;
+} CfiCompiler;
+
+static DwrfResult cfi_push_row(CfiCompiler *cc, const CfiRow *row)
+{
+        DwrfCfi *cfi = cc->cfi;
+
+        if (cfi->row_count == cc->rows_cap)
+        {
+                uint64_t cap = cc->rows_cap ? cc->rows_cap * 2 : 1024;
+                CfiRow *rows = realloc(cfi->rows, (size_t)cap * sizeof(CfiRow));
+                if (rows == NULL)
+                        return DWRF_NO_MEM;
+                cfi->rows = rows;
+                cc->rows_cap = cap;
+        }
+
+        cfi->rows[cfi->row_count++] = *row;
+        return DWRF_OK;
+}
+
+/** Index of an expression in the table, consecutive rows usually share theirs */
+static DwrfResult cfi_push_expr(CfiCompiler *cc, const DwrfRule *rule, int32_t *index)
+{
+        DwrfCfi *cfi = cc->cfi;
+
+        if ((cfi->expr_count > 0) && (cfi->exprs[cfi->expr_count - 1].expr == rule->Expr) &&
+            (cfi->exprs[cfi->expr_count - 1].len == rule->ExprLen))
+        {
+                *index = (int32_t)(cfi->expr_count - 1);
+                return DWRF_OK;
+        }
+
+        if (cfi->expr_count == INT32_MAX)
+                return DWRF_UNSUPPORTED;
+        if (cfi->expr_count == cc->exprs_cap)
+        {
+                uint64_t cap = cc->exprs_cap ? cc->exprs_cap * 2 : 16;
+                CfiExpr *exprs = realloc(cfi->exprs, (size_t)cap * sizeof(CfiExpr));
+                if (exprs == NULL)
+                        return DWRF_NO_MEM;
+                cfi->exprs = exprs;
+                cc->exprs_cap = cap;
+        }
+
+        cfi->exprs[cfi->expr_count] = (CfiExpr){ rule->Expr, rule->ExprLen };
+        *index = (int32_t)cfi->expr_count++;
+        return DWRF_OK;
+}
+
+/** Compact value of a rule, DWRF_UNSUPPORTED if it doesn't fit in 32 bits */
+static DwrfResult cfi_pack_rule(CfiCompiler *cc, const DwrfRule *rule, int32_t *val)
+{
+        switch (rule->Kind)
+        {
+        case DWRF_RULE_OFFSET:
+        case DWRF_RULE_VAL_OFFSET:
+                if ((rule->Offset < INT32_MIN) || (rule->Offset > INT32_MAX))
+                        return DWRF_UNSUPPORTED;
+                *val = (int32_t)rule->Offset;
+                return DWRF_OK;
+        case DWRF_RULE_REGISTER:
+                *val = rule->Reg;
+                return DWRF_OK;
+        case DWRF_RULE_EXPRESSION:
+        case DWRF_RULE_VAL_EXPRESSION:
+                return cfi_push_expr(cc, rule, val);
+        default:
+                *val = 0;
+                return DWRF_OK;
+        }
+}
+
+static uint8_t cfi_row_same(const CfiRow *a, const CfiRow *b)
+{
+        if ((a->cfa_kind != b->cfa_kind) || (a->cfa != b->cfa) || (a->cfa_reg != b->cfa_reg) ||
+            (a->ra_reg != b->ra_reg) || (a->signal != b->signal))
+                return false;
+
+        for (uint32_t i = 0; i < CFI_COLUMNS; i++)
+        {
+                if ((a->kind[i] != b->kind[i]) || (a->col[i] != b->col[i]))
+                        return false;
+        }
+        return true;
+}
+
+/** Appends a row, merged into the previous one when the rules are the same */
+static DwrfResult cfi_append(CfiCompiler *cc, const CfiRow *row)
+{
+        DwrfCfi *cfi = cc->cfi;
+
+        if ((cfi->row_count > 0) && cfi_row_same(&cfi->rows[cfi->row_count - 1], row))
+                return DWRF_OK;
+        return cfi_push_row(cc, row);
+}
+
+static DwrfResult cfi_compile_row(void *user, uint64_t low, uint64_t high, const CfiState *st)
+{
+        CfiCompiler *cc = user;
+        const CfiFde *fde = cc->fde;
+        CfiRow row = {0};
+        DwrfResult res;
+
+        (void)high;     // the row runs until the next one
+        if (low >= fde->end)
+                return DWRF_OK;
+
+        row.pc = low;
+        row.ra_reg = (uint16_t)fde->cie.ra_reg;
+        row.signal = fde->cie.signal;
+        row.cfa_kind = st->cfa.Kind;
+        row.cfa_reg = st->cfa.Reg;
+
+        if (st->cfa.Kind == DWRF_RULE_REGISTER)
+        {
+                if ((st->cfa.Offset < INT32_MIN) || (st->cfa.Offset > INT32_MAX))
+                        res = DWRF_UNSUPPORTED;
+                else
+                {
+                        row.cfa = (int32_t)st->cfa.Offset;
+                        res = DWRF_OK;
+                }
+        }
+        else
+                res = cfi_pack_rule(cc, &st->cfa, &row.cfa);
+
+        for (uint32_t i = 0; (i < CFI_COLUMNS) && (res == DWRF_OK); i++)
+        {
+                row.kind[i] = st->cols[i].Kind;
+                res = cfi_pack_rule(cc, &st->cols[i], &row.col[i]);
+        }
+
+        if (res == DWRF_UNSUPPORTED)
+        {
+                /* left to the interpreter */
+                row = (CfiRow){0};
+                row.pc = low;
+                row.cfa_kind = CFI_ROW_SLOW;
+                row.cfa_reg = cc->source;
+                res = DWRF_OK;
+        }
+        if (res)
+                return res;
+
+        return cfi_append(cc, &row);
+}
+
+/** Appends the rows of one FDE */
+static DwrfResult cfi_compile_fde(CfiCompiler *cc, const CfiSource *src, uint64_t offset)
+{
+        const DwrfCfi *cfi = cc->cfi;
+        uint64_t loc, next;
+        CfiMachine m;
+        CfiState st;
+        CfiFde fde;
+        DwrfResult res;
+
+        if ((res = cfi_parse_fde(cfi, src, offset, NULL, &fde)) || (res = cfi_machine_init(cfi, src, &fde, &m, &st)))
+                return res;
+
+        cc->fde = &fde;
+        loc = fde.pc;
+        res = cfi_execute(&m, &st, (DwrfBuf){ fde.insns, fde.insns_end, cfi->big }, &loc, UINT64_MAX, &next,
+                          cfi_compile_row, cc);
+        if (res)
+                return res;
+
+        /* the last row runs to the end of the FDE */
+        return cfi_compile_row(cc, loc, fde.end, &st);
+}
+
+DwrfResult dwarf_cfi_precompile(DwrfCfi *cfi)
+{
+        const uint64_t tag = 1ULL << 63;
+        CfiCompiler cc = { cfi, NULL, 0, 0, 0 };
+        CfiRefList list = {0};
+        uint64_t end = 0;
+        DwrfResult res = DWRF_OK;
+
+        if (cfi == NULL)
+                return DWRF_BAD_ARG;
+
+        free(cfi->rows);
+        free(cfi->exprs);
+        cfi->rows = NULL;
+        cfi->exprs = NULL;
+        cfi->row_count = 0;
+        cfi->expr_count = 0;
+
+        for (uint32_t i = 0; (i < CFI_SRC_COUNT) && (res == DWRF_OK); i++)
+        {
+                if (cfi->sources[i].present)
+                        res = cfi_collect(cfi, &cfi->sources[i], i ? tag : 0, &list);
+        }
+
+        /* by address, .eh_frame first among FDEs that start at the same one */
+        if (res == DWRF_OK)
+                qsort(list.refs, (size_t)list.count, sizeof(CfiFdeRef), cfi_ref_cmp);
+
+        for (uint64_t i = 0; (i < list.count) && (res == DWRF_OK); i++)
+        {
+                const CfiFdeRef *ref = &list.refs[i];
+                CfiRow gap = { .pc = end, .cfa_kind = CFI_ROW_NONE };
+
+                if ((cfi->row_count > 0) && (ref->pc < end))
+                        continue;       // overlaps an FDE already compiled
+
+                if ((cfi->row_count > 0) && (ref->pc > end))
+                        res = cfi_push_row(&cc, &gap);
+                if (res == DWRF_OK)
+                {
+                        cc.source = (ref->offset & tag) ? CFI_SRC_DEBUG : CFI_SRC_EH;
+                        res = cfi_compile_fde(&cc, &cfi->sources[cc.source], ref->offset & ~tag);
+                }
+                end = ref->end;
+        }
+
+        if ((res == DWRF_OK) && (cfi->row_count > 0))
+        {
+                CfiRow last = { .pc = end, .cfa_kind = CFI_ROW_NONE };
+                res = cfi_push_row(&cc, &last);
+        }
+
+        free(list.refs);
+        if (res)
+        {
+                free(cfi->rows);
+                free(cfi->exprs);
+                cfi->rows = NULL;
+                cfi->exprs = NULL;
+                cfi->row_count = 0;
+                cfi->expr_count = 0;
+        }
+        return res;
+}
+
+static void cfi_unpack_rule(const DwrfCfi *cfi, uint8_t kind, int32_t val, DwrfRule *rule)
+{
+        *rule = (DwrfRule){0};
+        rule->Kind = kind;
+
+        switch (kind)
+        {
+        case DWRF_RULE_OFFSET:
+        case DWRF_RULE_VAL_OFFSET:
+                rule->Offset = val;
+                break;
+        case DWRF_RULE_REGISTER:
+                rule->Reg = (uint16_t)val;
+                break;
+        case DWRF_RULE_EXPRESSION:
+        case DWRF_RULE_VAL_EXPRESSION:
+                rule->Expr = cfi->exprs[val].expr;
+                rule->ExprLen = cfi->exprs[val].len;
+                break;
+        default:
+                break;
+        }
+}
+
+DwrfResult dwarf_cfi_find(const DwrfCfi *cfi, uint64_t pc, DwrfUnwindRow *row)
+{
+        DwrfResult res = DWRF_NOT_FOUND;
+
+        if ((cfi == NULL) || (row == NULL))
+                return DWRF_BAD_ARG;
+
+        if (cfi->row_count > 0)
+        {
+                const CfiRow *r;
+                uint64_t lo = 0, hi = cfi->row_count;
+
+                while (lo < hi)
+                {
+                        uint64_t mid = lo + (hi - lo) / 2;
+                        if (cfi->rows[mid].pc <= pc)
+                                lo = mid + 1;
+                        else
+                                hi = mid;
+                }
+                if (lo == 0)
+                        return DWRF_NOT_FOUND;
+
+                r = &cfi->rows[lo - 1];
+                if (r->cfa_kind == CFI_ROW_NONE)
+                        return DWRF_NOT_FOUND;
+                if (r->cfa_kind == CFI_ROW_SLOW)
+                        return cfi_find_source(cfi, &cfi->sources[r->cfa_reg], pc, row);
+
+                /* the table ends with a CFI_ROW_NONE row, every other one has a successor */
+                row->Low = r->pc;
+                row->High = r[1].pc;
+                if (r->cfa_kind == DWRF_RULE_REGISTER)
+                {
+                        row->Cfa = (DwrfRule){0};
+                        row->Cfa.Kind = DWRF_RULE_REGISTER;
+                        row->Cfa.Reg = r->cfa_reg;
+                        row->Cfa.Offset = r->cfa;
+                }
+                else
+                        cfi_unpack_rule(cfi, r->cfa_kind, r->cfa, &row->Cfa);
+                cfi_unpack_rule(cfi, r->kind[CFI_COL_RA], r->col[CFI_COL_RA], &row->Ra);
+                cfi_unpack_rule(cfi, r->kind[CFI_COL_FP], r->col[CFI_COL_FP], &row->Fp);
+                row->RaReg = r->ra_reg;
+                row->Signal = r->signal;
+                return DWRF_OK;
+        }
+
+        for (uint32_t i = 0; (i < CFI_SRC_COUNT) && (res == DWRF_NOT_FOUND); i++)
+                res = cfi_find_source(cfi, &cfi->sources[i], pc, row);
+        return res;
+}
+
+DwrfResult dwarf_cfi_stats(const DwrfCfi *cfi, DwrfCfiStats *stats)
+{
+        if ((cfi == NULL) || (stats == NULL))
+                return DWRF_BAD_ARG;
+
+        *stats = (DwrfCfiStats){0};
+        for (uint32_t i = 0; i < CFI_SRC_COUNT; i++)
+        {
+                stats->Fdes += cfi->sources[i].fde_count + cfi->sources[i].hdr_count;
+                stats->HeaderFdes += cfi->sources[i].hdr_count;
+        }
+        stats->Rows = cfi->row_count;
+        stats->RowBytes = cfi->row_count * sizeof(CfiRow) + cfi->expr_count * sizeof(CfiExpr);
+        return DWRF_OK;
+}
@@ -0,0 +1,712 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ *  GDB index  *
+ ***************/
+ // .gdb_index versions 7 to 9, as described in the "Index Section Format" appendix of the GDB manual
+
+#define GDB_MIN_VERSION 7u
+#define GDB_MAX_VERSION 9u      // adds the shortcut table to the header
+#define GDB_CU_ENTRY    16u     // offset, length
+#define GDB_TU_ENTRY    24u     // offset, type offset, signature
+#define GDB_ADDR_ENTRY  20u     // low, high, CU index
+#define GDB_SLOT        8u      // name offset, CU vector offset
+#define GDB_MAX_SCOPES  64u
+
+/* CU vector entries: unit index, symbol kind and static flag */
+#define GDB_UNIT(v)     ((v) & 0x00FFFFFFu)
+#define GDB_KIND(v)     (((v) >> 28) & 7u)
+#define GDB_STATIC(v)   ((v) >> 31)
+
+struct DwrfGdbIndex
+{
+        DwrfCtx *ctx;
+        const uint8_t *cus;
+        const uint8_t *tus;
+        const uint8_t *slots;
+        const uint8_t *pool;            // constant pool, runs to the end of the section
+        uint64_t pool_size;
+        uint32_t version;
+        uint32_t cu_count;
+        uint32_t tu_count;
+        uint32_t slot_count;            // zero or a power of two
+        uint32_t used_slots;
+        uint64_t range_count;
+        DwrfAddrIndex *addrs;
+};
+
+/** The format is little endian whatever the target */
+static uint64_t gdb_load(const uint8_t *p, uint8_t size)
+{
+        return load_uN(p, size, false);
+}
+
+/** mapped_index_string_hash() of GDB for versions 5 and later, case folded */
+static uint32_t gdb_hash(const char *name)
+{
+        uint32_t h = 0;
+
+        for (const uint8_t *p = (const uint8_t *)name; *p; p++)
+        {
+                uint8_t c = *p;
+                if ((c >= 'A') && (c <= 'Z'))
+                        c += 'a' - 'A';
+                h = h * 67 + c - 113;
+        }
+        return h;
+}
+
+/** @return NUL terminated string at offset of the constant pool, NULL if it runs past the end. */
+static const char *gdb_pool_str(const DwrfGdbIndex *idx, uint64_t offset)
+{
+        if ((offset >= idx->pool_size) || (memchr(idx->pool + offset, '\0', (size_t)(idx->pool_size - offset)) == NULL))
+                return NULL;
+        return (const char *)idx->pool + offset;
+}
+
+/** Locates the tables from the header, each one ends where the next starts */
+static DwrfResult gdb_read_header(DwrfGdbIndex *idx, const uint8_t *data, uint64_t size, const uint8_t **area,
+                                  uint64_t *area_count)
+{
+        uint64_t offs[7];
+        uint32_t fields;
+
+        if (size < 4)
+                return DWRF_DECODE_ERR;
+
+        idx->version = (uint32_t)gdb_load(data, 4);
+        if ((idx->version < GDB_MIN_VERSION) || (idx->version > GDB_MAX_VERSION))
+                return DWRF_UNSUPPORTED;
+
+        fields = (idx->version >= 9) ? 7 : 6;
+        if (size < 4u * fields)
+                return DWRF_DECODE_ERR;
+
+        offs[0] = 4u * fields;
+        for (uint32_t i = 1; i < fields; i++)
+        {
+                offs[i] = gdb_load(data + 4 * i, 4);
+                if ((offs[i] < offs[i - 1]) || (offs[i] > size))
+                        return DWRF_DECODE_ERR;
+        }
+
+        if (((offs[2] - offs[1]) % GDB_CU_ENTRY) || ((offs[3] - offs[2]) % GDB_TU_ENTRY) ||
+            ((offs[4] - offs[3]) % GDB_ADDR_ENTRY) || ((offs[5] - offs[4]) % GDB_SLOT))
+                return DWRF_DECODE_ERR;
+
+        idx->cus = data + offs[1];
+        idx->cu_count = (uint32_t)((offs[2] - offs[1]) / GDB_CU_ENTRY);
+        idx->tus = data + offs[2];
+        idx->tu_count = (uint32_t)((offs[3] - offs[2]) / GDB_TU_ENTRY);
+        *area = data + offs[3];
+        *area_count = (offs[4] - offs[3]) / GDB_ADDR_ENTRY;
+        idx->slots = data + offs[4];
+        idx->slot_count = (uint32_t)((offs[5] - offs[4]) / GDB_SLOT);
+        idx->pool = data + offs[fields - 1];
+        idx->pool_size = size - offs[fields - 1];
+
+        /* CU vector entries hold 24-bit unit indexes */
+        if ((idx->slot_count & (idx->slot_count - 1)) || ((uint64_t)idx->cu_count + idx->tu_count > GDB_UNIT(~0u)))
+                return DWRF_DECODE_ERR;
+
+        for (uint32_t i = 0; i < idx->slot_count; i++)
+                idx->used_slots += (gdb_load(idx->slots + i * GDB_SLOT, 8) != 0);
+        return DWRF_OK;
+}
+
+/** Builds the address index from the address area, whose ranges are neither sorted nor merged */
+static DwrfResult gdb_read_addrs(DwrfGdbIndex *idx, const uint8_t *area, uint64_t count)
+{
+        DwrfAddrRange *ranges;
+        uint64_t kept = 0;
+
+        ranges = malloc((size_t)(count ? count : 1) * sizeof(DwrfAddrRange));
+        if (ranges == NULL)
+                return DWRF_NO_MEM;
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+                const uint8_t *p = area + i * GDB_ADDR_ENTRY;
+                uint64_t low = gdb_load(p, 8);
+                uint64_t high = gdb_load(p + 8, 8);
+                uint32_t unit = (uint32_t)gdb_load(p + 16, 4);
+
+                if (unit >= idx->cu_count)
+                {
+                        free(ranges);
+                        return DWRF_DECODE_ERR;
+                }
+                if (low < high)
+                        ranges[kept++] = (DwrfAddrRange){ low, high, gdb_load(idx->cus + (uint64_t)unit * GDB_CU_ENTRY, 8) };
+        }
+
+        return dwrf_addr_index_make(ranges, kept, &idx->addrs);
+}
+
+/**
+ * Probes the symbol table for the name, with the double hashing of find_slot_in_mapped_hash() in GDB.
+ * @return DWRF_OK with the entries of its CU vector, DWRF_NOT_FOUND or DWRF_DECODE_ERR.
+ */
+static DwrfResult gdb_lookup(const DwrfGdbIndex *idx, const char *name, const uint8_t **vec, uint32_t *count)
+{
+        uint32_t hash, mask, slot, step;
+
+        if (idx->slot_count == 0)
+                return DWRF_NOT_FOUND;
+
+        hash = gdb_hash(name);
+        mask = idx->slot_count - 1;
+        slot = hash & mask;
+        step = ((hash * 17) & mask) | 1;
+
+        /* the step is odd so every slot is visited once, bounding the walk of a full table */
+        for (uint32_t n = 0; n < idx->slot_count; n++, slot = (slot + step) & mask)
+        {
+                const uint8_t *p = idx->slots + (uint64_t)slot * GDB_SLOT;
+                uint64_t name_off = gdb_load(p, 4);
+                uint64_t vec_off = gdb_load(p + 4, 4);
+                const char *str;
+
+                if ((name_off == 0) && (vec_off == 0))
+                        return DWRF_NOT_FOUND;
+
+                str = gdb_pool_str(idx, name_off);
+                if ((str == NULL) || strcmp(str, name))
+                        continue;
+
+                if ((idx->pool_size < 4) || (vec_off > idx->pool_size - 4))
+                        return DWRF_DECODE_ERR;
+                *count = (uint32_t)gdb_load(idx->pool + vec_off, 4);
+                if (*count > (idx->pool_size - vec_off - 4) / 4)
+                        return DWRF_DECODE_ERR;
+                *vec = idx->pool + vec_off + 4;
+                return DWRF_OK;
+        }
+        return DWRF_NOT_FOUND;
+}
+
+static DwrfResult gdb_symbol(const DwrfGdbIndex *idx, uint32_t v, DwrfGdbSymbol *sym)
+{
+        uint32_t unit = GDB_UNIT(v);
+
+        if (unit < idx->cu_count)
+        {
+                sym->UnitOffset = gdb_load(idx->cus + (uint64_t)unit * GDB_CU_ENTRY, 8);
+                sym->Signature = 0;
+                sym->TypeUnit = false;
+        }
+        else if (unit - idx->cu_count < idx->tu_count)
+        {
+                const uint8_t *p = idx->tus + (uint64_t)(unit - idx->cu_count) * GDB_TU_ENTRY;
+                sym->UnitOffset = gdb_load(p, 8);
+                sym->Signature = gdb_load(p + 16, 8);
+                sym->TypeUnit = true;
+        }
+        else
+                return DWRF_DECODE_ERR;
+
+        sym->Unit = unit;
+        sym->Kind = (uint8_t)GDB_KIND(v);
+        sym->Static = (uint8_t)GDB_STATIC(v);
+        return DWRF_OK;
+}
+
+/***************
+ *    DIEs     *
+ ***************/
+
+/** Matches of a lookup and the per unit state of the walk */
+typedef struct
+{
+        InternalDwarfCtx *ctx;
+        const char *name;
+        DwrfNameEntry *entries;
+        uint32_t max;
+        uint32_t count;
+
+        /* declarations and abstract instances named "name", reported if no definition refers to them */
+        DwrfNameEntry *decls;
+        uint8_t *used;
+        uint32_t decl_count;
+        uint32_t decl_cap;
+
+        /* unnamed DIEs referring to a later DIE: target, then the DIE */
+        uint64_t *pending;
+        DwrfNameEntry *pending_dies;
+        uint8_t *pending_decl;
+        uint32_t pending_count;
+        uint32_t pending_cap;
+} GdbWalk;
+
+static void gdb_match(GdbWalk *w, const DwrfNameEntry *e)
+{
+        if (w->count < w->max)
+                w->entries[w->count] = *e;
+        if (w->count < UINT32_MAX)
+                w->count++;
+}
+
+static DwrfResult gdb_add_decl(GdbWalk *w, const DwrfNameEntry *e)
+{
+        if (w->decl_count == w->decl_cap)
+        {
+                uint32_t cap = w->decl_cap ? w->decl_cap * 2 : 8;
+                DwrfNameEntry *decls = realloc(w->decls, cap * sizeof(DwrfNameEntry));
+                uint8_t *used;
+
+                if (decls == NULL)
+                        return DWRF_NO_MEM;
+                w->decls = decls;
+                if ((used = realloc(w->used, cap)) == NULL)
+                        return DWRF_NO_MEM;
+                w->used = used;
+                w->decl_cap = cap;
+        }
+
+        w->decls[w->decl_count] = *e;
+        w->used[w->decl_count++] = false;
+        return DWRF_OK;
+}
+
+static DwrfResult gdb_add_pending(GdbWalk *w, uint64_t target, const DwrfNameEntry *e, uint8_t decl)
+{
+        if (w->pending_count == w->pending_cap)
+        {
+                uint32_t cap = w->pending_cap ? w->pending_cap * 2 : 16;
+                uint64_t *pending = realloc(w->pending, cap * sizeof(uint64_t));
+                DwrfNameEntry *dies;
+                uint8_t *flags;
+
+                if (pending == NULL)
+                        return DWRF_NO_MEM;
+                w->pending = pending;
+                if ((dies = realloc(w->pending_dies, cap * sizeof(DwrfNameEntry))) == NULL)
+                        return DWRF_NO_MEM;
+                w->pending_dies = dies;
+                if ((flags = realloc(w->pending_decl, cap)) == NULL)
+                        return DWRF_NO_MEM;
+                w->pending_decl = flags;
+                w->pending_cap = cap;
+        }
+
+        w->pending[w->pending_count] = target;
+        w->pending_dies[w->pending_count] = *e;
+        w->pending_decl[w->pending_count++] = decl;
+        return DWRF_OK;
+}
+
+/**
+ * Resolves a DIE that takes its name from "target": when the target was named after the lookup
+ * it is marked as used and the DIE becomes a match, or another declaration for abstract instances.
+ * @return DWRF_OK, DWRF_NOT_FOUND if the target isn't one of the declarations seen so far.
+ */
+static DwrfResult gdb_resolve(GdbWalk *w, uint64_t target, const DwrfNameEntry *e, uint8_t decl)
+{
+        for (uint32_t i = 0; i < w->decl_count; i++)
+        {
+                if (w->decls[i].DieOffset != target)
+                        continue;
+
+                w->used[i] = true;
+                if (decl)
+                        return gdb_add_decl(w, e);
+                gdb_match(w, e);
+                return DWRF_OK;
+        }
+        return DWRF_NOT_FOUND;
+}
+
+/** @return string of a string class attribute, NULL for other forms */
+static const char *gdb_attr_str(InternalDwarfCtx *ctx, DwrfCursor *cur, DwrfAttr *attr)
+{
+        const DwrfSection *sec;
+
+        if (dwarf_cursor_resolve(cur, attr))
+                return NULL;
+
+        switch (attr->Form)
+        {
+        case DW_FORM_string:
+                sec = &ctx->debug_info;
+                break;
+        case DW_FORM_strp:
+                sec = &ctx->debug_str;
+                break;
+        case DW_FORM_line_strp:
+                sec = &ctx->debug_line_str;
+                break;
+        default:
+                return NULL;
+        }
+
+        if ((sec->data == NULL) || (attr->Value >= sec->hdr.Size) ||
+            (memchr(sec->data + attr->Value, '\0', (size_t)(sec->hdr.Size - attr->Value)) == NULL))
+                return NULL;
+        return (const char *)sec->data + attr->Value;
+}
+
+/** DIEs that carry the names GDB indexes or hold them as children */
+static int gdb_indexed_tag(uint16_t tag)
+{
+        switch (tag)
+        {
+        case DW_TAG_base_type:
+        case DW_TAG_class_type:
+        case DW_TAG_constant:
+        case DW_TAG_enumeration_type:
+        case DW_TAG_enumerator:
+        case DW_TAG_interface_type:
+        case DW_TAG_member:
+        case DW_TAG_module:
+        case DW_TAG_namespace:
+        case DW_TAG_structure_type:
+        case DW_TAG_subprogram:
+        case DW_TAG_subrange_type:
+        case DW_TAG_template_alias:
+        case DW_TAG_typedef:
+        case DW_TAG_union_type:
+        case DW_TAG_unspecified_type:
+        case DW_TAG_variable:
+                return 1;
+        default:
+                return 0;
+        }
+}
+
+/**
+ * Whether a scope named "scope" whose parents make up the first "len" bytes of the looked up
+ * name can contain it, *len then covers the scope and its "::" separator.
+ */
+static int gdb_enter_scope(const char *name, uint64_t *len, const char *scope)
+{
+        size_t n = strlen(scope);
+
+        if (strncmp(name + *len, scope, n) || (name[*len + n] != ':') || (name[*len + n + 1] != ':'))
+                return false;
+
+        *len += n + 2;
+        return true;
+}
+
+/**
+ * Walks the unit for the DIEs whose qualified name is the looked up one. The qualified names are
+ * never built: a scope is only entered when the name starts with it, so at any point the name
+ * of the enclosing scopes is a prefix of the looked up one and only its length is kept.
+ */
+static DwrfResult gdb_walk_unit(GdbWalk *w, DwrfCursor *cur, uint64_t unit_offset)
+{
+        enum { NAME, DECL, INLINE, SPEC, ORIGIN, ENUM_CLASS, COUNT };
+        static const uint16_t attr_names[COUNT] = {
+                DW_AT_name, DW_AT_declaration, DW_AT_inline, DW_AT_specification, DW_AT_abstract_origin, DW_AT_enum_class
+        };
+        uint32_t depths[GDB_MAX_SCOPES];
+        uint64_t lens[GDB_MAX_SCOPES];
+        uint32_t top = 0;
+        DwrfUnitHeader unit;
+        DwrfDie die;
+        DwrfAttr attrs[COUNT];
+        DwrfResult res;
+
+        w->decl_count = 0;
+        w->pending_count = 0;
+        if ((res = dwarf_cursor_seek_unit(cur, unit_offset)) || (res = dwarf_cursor_unit(cur, &unit)))
+                return res;
+
+        /* the unit DIE */
+        if ((res = dwarf_cursor_next(cur, &die)))
+                return (res == DWRF_END) ? DWRF_OK : res;
+
+        while ((res = dwarf_cursor_next(cur, &die)) == DWRF_OK)
+        {
+                DwrfNameEntry e = { die.Offset, die.UnitOffset, die.Tag };
+                const char *name;
+                uint64_t len;
+                uint8_t decl;
+                int enter;
+
+                if (die.UnitOffset != unit_offset)
+                        break;
+
+                while (top && (depths[top - 1] >= die.Depth))
+                        top--;
+                len = top ? lens[top - 1] : 0;
+
+                if (!gdb_indexed_tag(die.Tag))
+                {
+                        if (die.HasChildren && (res = dwarf_cursor_skip_children(cur)))
+                                break;
+                        continue;
+                }
+
+                if ((res = dwarf_cursor_get_attrs(cur, attr_names, COUNT, attrs)))
+                        break;
+
+                name = gdb_attr_str(w->ctx, cur, &attrs[NAME]);
+                if ((name == NULL) && (die.Tag == DW_TAG_namespace))
+                        name = "(anonymous namespace)";
+                decl = (attrs[DECL].Form && attrs[DECL].Value) ||
+                       (attrs[INLINE].Form && ((attrs[INLINE].Value == DW_INL_inlined) ||
+                                               (attrs[INLINE].Value == DW_INL_declared_inlined)));
+
+                if (name != NULL)
+                {
+                        /* only static data members are indexed */
+                        if ((strcmp(w->name + len, name) == 0) && ((die.Tag != DW_TAG_member) || decl))
+                        {
+                                if (decl)
+                                        res = gdb_add_decl(w, &e);
+                                else
+                                        gdb_match(w, &e);
+                        }
+                }
+                else if (attrs[SPEC].Form || attrs[ORIGIN].Form)
+                {
+                        const DwrfAttr *ref = attrs[SPEC].Form ? &attrs[SPEC] : &attrs[ORIGIN];
+                        uint64_t target = (ref->Form == DW_FORM_ref_addr) ? ref->Value : unit.Offset + ref->Value;
+
+                        res = gdb_resolve(w, target, &e, decl);
+                        if (res == DWRF_NOT_FOUND)
+                                res = (target > die.Offset) ? gdb_add_pending(w, target, &e, decl) : DWRF_OK;
+                }
+                if (res)
+                        break;
+
+                if (!die.HasChildren)
+                        continue;
+
+                /* unnamed aggregates and unscoped enumerations don't qualify the names they hold */
+                switch (die.Tag)
+                {
+                case DW_TAG_class_type:
+                case DW_TAG_interface_type:
+                case DW_TAG_module:
+                case DW_TAG_namespace:
+                case DW_TAG_structure_type:
+                case DW_TAG_union_type:
+                        enter = (name == NULL) || gdb_enter_scope(w->name, &len, name);
+                        break;
+                case DW_TAG_enumeration_type:
+                        enter = (name == NULL) || !(attrs[ENUM_CLASS].Form && attrs[ENUM_CLASS].Value) ||
+                                gdb_enter_scope(w->name, &len, name);
+                        break;
+                default:
+                        enter = false;  // function bodies and the like
+                        break;
+                }
+
+                if (enter && (top < GDB_MAX_SCOPES))
+                {
+                        depths[top] = die.Depth;
+                        lens[top++] = len;
+                }
+                else if ((res = dwarf_cursor_skip_children(cur)))
+                        break;
+        }
+
+        if (res != DWRF_OK && res != DWRF_END)
+                return res;
+
+        for (uint32_t i = 0; i < w->pending_count; i++)
+        {
+                res = gdb_resolve(w, w->pending[i], &w->pending_dies[i], w->pending_decl[i]);
+                if (res && (res != DWRF_NOT_FOUND))
+                        return res;
+        }
+
+        for (uint32_t i = 0; i < w->decl_count; i++)
+        {
+                if (!w->used[i])
+                        gdb_match(w, &w->decls[i]);
+        }
+        return DWRF_OK;
+}
+
+/** Whether the type unit of the symbol is in .debug_info, DWARF 4 ones are in .debug_types */
+static int gdb_type_unit_here(DwrfCtx *ctx, const DwrfGdbSymbol *sym)
+{
+        DwrfUnitHeader unit;
+
+        if (dwarf_get_unit_header(ctx, sym->UnitOffset, &unit))
+                return false;
+        return ((unit.UnitType == DW_UT_type) || (unit.UnitType == DW_UT_split_type)) &&
+               (unit.Signature == sym->Signature);
+}
+
+/***************
+ *     API     *
+ ***************/
+
+DwrfResult dwarf_gdb_index_open(DwrfCtx *ctx, DwrfGdbIndex **index)
+{
+        DwrfSection *sec;
+        DwrfGdbIndex *idx;
+        const uint8_t *area;
+        const DwrfAddrRange *ranges;
+        uint64_t area_count;
+        DwrfResult res;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (index == NULL)
+                return DWRF_BAD_ARG;
+
+        sec = &CTX(ctx)->gdb_index;
+        if (!sec->present)
+                return DWRF_SEC_MISSING;
+        if ((res = dwrf_load_section(CTX(ctx), sec)))
+                return res;
+
+        idx = calloc(1, sizeof(DwrfGdbIndex));
+        if (idx == NULL)
+                return DWRF_NO_MEM;
+
+        idx->ctx = ctx;
+        if ((res = gdb_read_header(idx, sec->data, sec->hdr.Size, &area, &area_count)) ||
+            (res = gdb_read_addrs(idx, area, area_count)))
+        {
+                dwarf_gdb_index_destroy(idx);
+                return res;
+        }
+
+        dwarf_addr_index_ranges(idx->addrs, &ranges, &idx->range_count);
+        *index = idx;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_gdb_index_find(const DwrfGdbIndex *index, const char *name, DwrfGdbSymbol *symbols, uint32_t max,
+                                uint32_t *count)
+{
+        const uint8_t *vec;
+        uint32_t n;
+        DwrfResult res;
+
+        if ((index == NULL) || (name == NULL) || (count == NULL) || ((symbols == NULL) && (max != 0)))
+                return DWRF_BAD_ARG;
+
+        *count = 0;
+        if ((res = gdb_lookup(index, name, &vec, &n)))
+                return res;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+                DwrfGdbSymbol sym;
+
+                if ((res = gdb_symbol(index, (uint32_t)gdb_load(vec + 4 * (uint64_t)i, 4), &sym)))
+                        return res;
+                if (i < max)
+                        symbols[i] = sym;
+        }
+
+        *count = n;
+        if (n == 0)
+                return DWRF_NOT_FOUND;
+        return (n > max) ? DWRF_BUFFER_OVERFLOW : DWRF_OK;
+}
+
+DwrfResult dwarf_gdb_index_find_dies(const DwrfGdbIndex *index, const char *name, DwrfNameEntry *entries,
+                                     uint32_t max, uint32_t *count)
+{
+        GdbWalk w;
+        DwrfMap walked = {0};   // unit offset -> unit, a unit can be listed once per symbol kind
+        DwrfCursor cur;
+        InternalDwarfCtx *ctx;
+        const uint8_t *vec;
+        uint32_t n;
+        DwrfResult res;
+
+        if ((index == NULL) || (name == NULL) || (count == NULL) || ((entries == NULL) && (max != 0)))
+                return DWRF_BAD_ARG;
+
+        *count = 0;
+        if ((res = gdb_lookup(index, name, &vec, &n)))
+                return res;
+
+        /* the names are compared in place */
+        ctx = CTX(index->ctx);
+        if ((res = dwrf_load_section(ctx, &ctx->debug_info)) || (res = dwrf_load_section(ctx, &ctx->debug_str)) ||
+            (ctx->debug_line_str.present && (res = dwrf_load_section(ctx, &ctx->debug_line_str))))
+                return res;
+
+        w = (GdbWalk){ .ctx = ctx, .name = name, .entries = entries, .max = max };
+        dwarf_cursor_init(index->ctx, &cur);
+        for (uint32_t i = 0; (i < n) && (res == DWRF_OK); i++)
+        {
+                DwrfGdbSymbol sym;
+
+                if ((res = gdb_symbol(index, (uint32_t)gdb_load(vec + 4 * (uint64_t)i, 4), &sym)))
+                        break;
+                if (dwrf_map_get(&walked, sym.UnitOffset) || (sym.TypeUnit && !gdb_type_unit_here(index->ctx, &sym)))
+                        continue;
+                if ((res = dwrf_map_put(&walked, sym.UnitOffset, (void *)(uintptr_t)(sym.Unit + 1))))
+                        break;
+                res = gdb_walk_unit(&w, &cur, sym.UnitOffset);
+        }
+
+        dwrf_map_destroy(&walked, NULL);
+        free(w.decls);
+        free(w.used);
+        free(w.pending);
+        free(w.pending_dies);
+        free(w.pending_decl);
+        if (res)
+                return res;
+
+        *count = w.count;
+        if (w.count == 0)
+                return DWRF_NOT_FOUND;
+        return (w.count > max) ? DWRF_BUFFER_OVERFLOW : DWRF_OK;
+}
+
+DwrfResult dwarf_gdb_index_lookup_addr(const DwrfGdbIndex *index, uint64_t addr, uint64_t *unit_offset)
+{
+        if (index == NULL)
+                return DWRF_BAD_ARG;
+
+        return dwarf_addr_index_lookup(index->addrs, addr, unit_offset);
+}
+
+DwrfResult dwarf_gdb_index_info(const DwrfGdbIndex *index, DwrfGdbIndexInfo *info)
+{
+        if ((index == NULL) || (info == NULL))
+                return DWRF_BAD_ARG;
+
+        info->Version = index->version;
+        info->Units = index->cu_count;
+        info->TypeUnits = index->tu_count;
+        info->Ranges = index->range_count;
+        info->Slots = index->slot_count;
+        info->Symbols = index->used_slots;
+        return DWRF_OK;
+}
+
+void dwarf_gdb_index_destroy(DwrfGdbIndex *index)
+{
+        if (index == NULL)
+                return;
+
+        dwarf_addr_index_destroy(index->addrs);
+        free(index);
+}
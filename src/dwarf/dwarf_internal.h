@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DWARF_INTERNAL_INC
+#define DWARF_INTERNAL_INC
+
+/* Definitions shared by the source files of the DWARF module, not part of the public API. */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "elf_dwarf.h"
+#include "dwarf_consts.h"
+#include "dwarf_leb128.h"
+#include "reader/elf_reader.h"
+
+#define CTX(ctx) ((InternalDwarfCtx *)(ctx))
+
+/** How the bytes of a section are stored in the file */
+typedef enum
+{
+        DWRF_PACK_NONE,
+        DWRF_PACK_ZLIB,         // zlib stream after a compression header (SHF_COMPRESSED or .zdebug_*)
+        DWRF_PACK_OTHER,        // compressed with an unsupported algorithm
+} DwrfPacking;
+
+/**
+ * Raw view of a section. The contents are copied to the heap on first use,
+ * sections that are never touched cost nothing.
+ * For compressed sections hdr.Size is the uncompressed size, the contents are
+ * inflated on load (see DWRF_ZLIB) and never read in place.
+ */
+typedef struct
+{
+        ElfSecHeader hdr;
+        const uint8_t *data;    // NULL until loaded
+        uint64_t packed_size;   // size in the file of a compressed section
+        uint8_t owned;          // data is a heap copy released on dwarf_destroy()
+        uint8_t present;        // optional sections may be missing from the file
+        uint8_t packing;        // DwrfPacking
+        uint8_t pack_header;    // bytes of compression header before the stream
+        uint8_t dwo;            // found under its split DWARF name (.debug_*.dwo)
+} DwrfSection;
+
+/** Slots of the sections dwarf_init() looks for, in the order of the fields of InternalDwarfCtx */
+typedef enum
+{
+        DWRF_SEC_INFO,
+        DWRF_SEC_ABBREV,
+        DWRF_SEC_STR,
+        DWRF_SEC_LINE,
+        DWRF_SEC_LINE_STR,
+        DWRF_SEC_ARANGES,
+        DWRF_SEC_RANGES,
+        DWRF_SEC_RNGLISTS,
+        DWRF_SEC_ADDR,
+        DWRF_SEC_NAMES,
+        DWRF_SEC_STR_OFFSETS,
+        DWRF_SEC_LOCLISTS,
+        DWRF_SEC_LOC,
+        DWRF_SEC_FRAME,
+        DWRF_SEC_MACRO,
+        DWRF_SEC_CU_INDEX,
+        DWRF_SEC_TU_INDEX,
+        DWRF_SEC_EH_FRAME,
+        DWRF_SEC_EH_FRAME_HDR,
+        DWRF_SEC_GDB_INDEX,
+        DWRF_SEC_COUNT
+} DwrfSectionId;
+
+/**
+ * Open addressing hash map from 64-bit keys (usually section offsets) to pointers.
+ * NULL values mark the empty slots so they can't be stored.
+ */
+typedef struct
+{
+        uint64_t key;
+        void *val;
+} DwrfMapSlot;
+
+typedef struct
+{
+        DwrfMapSlot *slots;
+        uint32_t count;
+        uint32_t capacity;      // zero or a power of two
+} DwrfMap;
+
+typedef void (*DwrfElemDestroyFn)(void *elem);
+
+/** Bump allocator released as a whole by dwrf_arena_destroy(). Not thread safe, each worker owns one. */
+struct DwrfArena
+{
+        struct DwrfArenaChunk *chunks;  // most recent first
+        uint8_t *cur;                   // free space left in the current chunk
+        uint8_t *end;
+        uint64_t used;                  // bytes handed out
+        uint64_t reserved;              // bytes of all the chunks
+        size_t first;                   // size of the first chunk, 0 for the default
+};
+
+typedef struct
+{
+        const ElfCtx *elf;
+        EiData endianness;
+        const uint8_t *image;   // whole file in memory, NULL if unset
+        uint64_t image_size;
+        union
+        {
+                DwrfSection sections[DWRF_SEC_COUNT];   // indexed by DwrfSectionId
+                struct
+                {
+                        DwrfSection debug_info;
+                        DwrfSection debug_abbrev;
+                        DwrfSection debug_str;
+                        DwrfSection debug_line;
+                        DwrfSection debug_line_str;
+                        DwrfSection debug_aranges;
+                        DwrfSection debug_ranges;      // DWARF 4 range lists
+                        DwrfSection debug_rnglists;    // DWARF 5 range lists
+                        DwrfSection debug_addr;
+                        DwrfSection debug_names;
+                        DwrfSection debug_str_offsets;
+                        DwrfSection debug_loclists;
+                        DwrfSection debug_loc;         // DWARF 4 location lists
+                        DwrfSection debug_frame;
+                        DwrfSection debug_macro;
+                        DwrfSection debug_cu_index;    // package (.dwp) indexes
+                        DwrfSection debug_tu_index;
+                        DwrfSection eh_frame;          // loaded sections, found by their exact name
+                        DwrfSection eh_frame_hdr;
+                        DwrfSection gdb_index;
+                };
+        };
+        DwrfMap abbrev_cache;   // .debug_abbrev offset -> DwrfAbbrevTable
+        DwrfMap unit_bases;     // .debug_info unit offset -> DwrfUnitBases
+        DwrfArena arena;        // abbreviation tables and unit bases, released at once by dwarf_destroy()
+        DwrfStats stats;
+        const DwrfCtx *sup;             // supplementary file, NULL if unset
+        uint64_t skeleton_addr_base;    // DW_AT_addr_base of the skeleton unit, valid when linked
+        uint8_t split;                  // the units are split units (.dwo file or package unit)
+        uint8_t linked;                 // .debug_addr is borrowed from the skeleton's context
+        uint8_t initialized;
+} InternalDwarfCtx;
+
+_Static_assert(sizeof(InternalDwarfCtx) <= DWARF_CTX_SIZE, "DWARF_CTX_SIZE too small");
+_Static_assert(offsetof(InternalDwarfCtx, gdb_index) == offsetof(InternalDwarfCtx, sections[DWRF_SEC_GDB_INDEX]),
+               "section fields out of sync with DwrfSectionId");
+
+/** Bounded reader over section bytes */
+typedef struct
+{
+        const uint8_t *p;
+        const uint8_t *end;
+        uint8_t big;            // data is big endian
+} DwrfBuf;
+
+/** Helper expression to reduce repetition */
+static inline DwrfResult validate_ctx(const DwrfCtx *ctx)
+{
+        if ((ctx == NULL) || !(CTX(ctx)->initialized))
+                return DWRF_UNINIT;
+        
+        return DWRF_OK;
+}
+
+/***************
+ *     Map     *
+ ***************/
+
+void *dwrf_map_get(const DwrfMap *m, uint64_t key);
+DwrfResult dwrf_map_put(DwrfMap *m, uint64_t key, void *val);
+/** Removes the key and returns its value, NULL if it wasn't there. */
+void *dwrf_map_remove(DwrfMap *m, uint64_t key);
+void dwrf_map_destroy(DwrfMap *m, DwrfElemDestroyFn destroy);
+
+/***************
+ *  Sections   *
+ ***************/
+
+/** dwarf_init() without its required sections, for the features that don't read DIEs (call frames) */
+DwrfResult dwrf_open_sections(const ElfCtx *elf, DwrfCtx *ctx);
+
+/** Makes the contents of the section available in memory */
+DwrfResult dwrf_load_section(InternalDwarfCtx *ctx, DwrfSection *sec);
+
+/** Copies bytes of a section, served from memory when the section is already there. Compressed sections are loaded first. */
+DwrfResult dwrf_section_read(InternalDwarfCtx *ctx, DwrfSection *sec, uint64_t offset, uint64_t size, void *out);
+
+void dwrf_section_release(DwrfSection *sec);
+
+/***************
+ * Unit bases  *
+ ***************/
+
+/** Attributes of a unit DIE that the indexed forms and other sections are relative to */
+typedef struct
+{
+        uint64_t low_pc;                // base address of the unit's range and location lists
+        uint64_t str_offsets_base;      // DW_AT_str_offsets_base, start of the unit's entries in .debug_str_offsets
+        uint64_t addr_base;             // DW_AT_addr_base (DW_AT_GNU_addr_base), start of the unit's entries in .debug_addr
+        uint64_t rnglists_base;         // DW_AT_rnglists_base, start of the offsets table in .debug_rnglists
+        uint64_t loclists_base;         // DW_AT_loclists_base, start of the offsets table in .debug_loclists
+        uint16_t version;
+        uint8_t addr_size;
+        uint8_t offset_size;
+} DwrfUnitBases;
+
+/**
+ * Bases of a unit, read from its unit DIE on first use and cached in the context.
+ * Split units default to the first contribution of each section.
+ */
+DwrfResult dwrf_unit_bases(InternalDwarfCtx *ctx, const DwrfUnitHeader *unit, const DwrfUnitBases **bases);
+
+/**
+ * Entry "index" of the table of "size" byte values that starts at "base" of a section,
+ * which must already be in memory (DWRF_BAD_ARG otherwise).
+ */
+DwrfResult dwrf_table_entry(const InternalDwarfCtx *ctx, const DwrfSection *sec, uint64_t base, uint64_t index,
+                            uint8_t size, uint64_t *val);
+
+/** Offset in .debug_str of entry index of the unit's .debug_str_offsets table (DW_FORM_strx*). */
+DwrfResult dwrf_read_strx(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t index, uint64_t *offset);
+
+/** Reads entry index of the unit's .debug_addr table (DW_FORM_addrx*). */
+DwrfResult dwrf_read_addrx(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t index, uint64_t *addr);
+
+/** Offset in .debug_rnglists of the list of a DW_FORM_rnglistx index. */
+DwrfResult dwrf_rnglistx_offset(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t index, uint64_t *offset);
+
+/** Offset in .debug_loclists of the list of a DW_FORM_loclistx index. */
+DwrfResult dwrf_loclistx_offset(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t index, uint64_t *offset);
+
+/** Context and bases of the unit a cursor is in, DWRF_BAD_ARG before it enters one. */
+DwrfResult dwrf_cursor_bases(DwrfCursor *cur, InternalDwarfCtx **ctx, const DwrfUnitBases **bases);
+
+/***************
+ *   Ranges    *
+ ***************/
+
+/** Receives the ranges of a list one at a time, [low, high) */
+typedef DwrfResult (*DwrfRangeFn)(void *user, uint64_t low, uint64_t high);
+
+/** Walks the range list at offset of .debug_rnglists (DWARF 5) or .debug_ranges (older units). Empty ranges are skipped. */
+DwrfResult dwrf_ranges_for_each(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t offset, DwrfRangeFn fn, void *user);
+
+/**
+ * Receives the entries of a location list one at a time, [low, high) and the bytes of the location
+ * description. The default location of DW_LLE_default_location comes with dflt set and no range.
+ */
+typedef DwrfResult (*DwrfLocFn)(void *user, uint64_t low, uint64_t high, const uint8_t *expr, uint64_t len, uint8_t dflt);
+
+/** Walks the location list at offset of .debug_loclists (DWARF 5) or .debug_loc (older units). Empty entries are skipped. */
+DwrfResult dwrf_locs_for_each(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t offset, DwrfLocFn fn, void *user);
+
+/***************
+ * Addr index  *
+ ***************/
+
+/** Index over the ranges, which are sorted and made disjoint first. Takes ownership of the array, even on failure. */
+DwrfResult dwrf_addr_index_make(DwrfAddrRange *ranges, uint64_t count, DwrfAddrIndex **index);
+
+/***************
+ * Line tables *
+ ***************/
+
+/** Number of files of a table and the bytes it holds, strings aside. */
+void dwrf_line_table_usage(const DwrfLineTable *table, uint32_t *files, uint64_t *bytes);
+
+/***************
+ *  Sym index  *
+ ***************/
+
+/** 64-bit checksum of the serialized indexes, over the bytes after their header. */
+uint64_t dwrf_checksum(const uint8_t *p, uint64_t size);
+
+/***************
+ *   Arenas    *
+ ***************/
+
+void dwrf_arena_init(DwrfArena *arena);
+
+/** Arena whose first chunk holds "size" bytes, for owners that know what they'll allocate up front. */
+void dwrf_arena_init_sized(DwrfArena *arena, size_t size);
+
+/** Bytes an allocation of "size" takes in an arena, padding included. */
+size_t dwrf_arena_size(size_t size);
+
+/** Gives back "last" if it is the most recent allocation of the arena, for the error paths of its owners. */
+void dwrf_arena_unwind(DwrfArena *arena, void *last, size_t size);
+
+void dwrf_arena_destroy(DwrfArena *arena);
+
+/***************
+ *   Budgets   *
+ ***************/
+
+/** Memory charged to a DwrfMemBudget, kept in the least recently used order of the budget */
+typedef struct DwrfBudgetItem
+{
+        struct DwrfBudgetItem *prev;    // most recent first
+        struct DwrfBudgetItem *next;
+        void (*evict)(struct DwrfBudgetItem *item);     // detaches the item from its owner and frees it
+        uint64_t bytes;
+        uint32_t refs;                  // readers, the item isn't evicted meanwhile
+} DwrfBudgetItem;
+
+/**
+ * The owners of the items share the lock of the budget, which guards the items, the list and whatever
+ * the owners reach from their evict callback. The functions below expect it held.
+ */
+void dwrf_budget_lock(DwrfMemBudget *budget);
+void dwrf_budget_unlock(DwrfMemBudget *budget);
+
+/** Charges the item and makes it the most recent one. */
+void dwrf_budget_add(DwrfMemBudget *budget, DwrfBudgetItem *item);
+
+/** Makes the item the most recent one. */
+void dwrf_budget_touch(DwrfMemBudget *budget, DwrfBudgetItem *item);
+
+/** Uncharges the item, the caller frees it. */
+void dwrf_budget_remove(DwrfMemBudget *budget, DwrfBudgetItem *item);
+
+/** Evicts the least recently used items nobody is reading until the rest fits the limit. */
+void dwrf_budget_evict(DwrfMemBudget *budget);
+
+/** Counts the owners charging the budget, for its stats. */
+void dwrf_budget_attach(DwrfMemBudget *budget);
+void dwrf_budget_detach(DwrfMemBudget *budget);
+
+/***************
+ *   Workers   *
+ ***************/
+
+#define DWRF_MAX_WORKERS 64u
+
+/** Runs job "job" on the thread numbered "worker" (0 to workers-1) */
+typedef void (*DwrfJobFn)(void *arg, uint64_t job, uint32_t worker);
+
+/**
+ * Loads the sections the cursors read, parses the abbreviation table and reads the bases
+ * of every unit, after which copies made with dwrf_worker_ctx() only read the shared state.
+ */
+DwrfResult dwrf_prepare_workers(InternalDwarfCtx *ctx);
+
+/** Private copy of a prepared context for one thread, sections and caches are borrowed and must not be released. */
+void dwrf_worker_ctx(const InternalDwarfCtx *ctx, DwrfCtx *worker);
+
+/** Adds the counters of a worker copy to the context. */
+void dwrf_worker_join(InternalDwarfCtx *ctx, const DwrfCtx *worker);
+
+/** Number of threads to use for "jobs" jobs, 0 threads means one per CPU. */
+uint32_t dwrf_worker_count(uint32_t threads, uint64_t jobs);
+
+/**
+ * Runs jobs 0 to count-1 on "workers" threads, the caller is one of them. Each thread starts
+ * on its own contiguous share and steals half of the largest remaining share once it is done.
+ */
+void dwrf_run_jobs(uint32_t workers, uint64_t count, DwrfJobFn fn, void *arg);
+
+/***************
+ *   Buffers   *
+ ***************/
+
+static inline DwrfBuf buf_make(const InternalDwarfCtx *ctx, const DwrfSection *sec, uint64_t start, uint64_t end)
+{
+        return (DwrfBuf){ sec->data + start, sec->data + end, ctx->endianness == ELFDATA2MSB };
+}
+
+static inline uint64_t buf_left(const DwrfBuf *b)
+{
+        return (uint64_t)(b->end - b->p);
+}
+
+/** Loads an unsigned integer of 1 to 8 bytes in the data endianness, does not perform bound checks. */
+static inline uint64_t load_uN(const uint8_t *p, uint8_t size, uint8_t big)
+{
+        uint64_t v = 0;
+
+        if (big)
+        {
+                for (uint8_t i = 0; i < size; i++)
+                        v = (v << 8) | p[i];
+        }
+        else
+        {
+                for (uint8_t i = size; i > 0; i--)
+                        v = (v << 8) | p[i - 1];
+        }
+        return v;
+}
+
+static inline DwrfResult buf_uN(DwrfBuf *b, uint8_t size, uint64_t *v)
+{
+        if (buf_left(b) < size)
+                return DWRF_DECODE_ERR;
+
+        *v = load_uN(b->p, size, b->big);
+        b->p += size;
+        return DWRF_OK;
+}
+
+static inline DwrfResult buf_skip(DwrfBuf *b, uint64_t n)
+{
+        if (buf_left(b) < n)
+                return DWRF_DECODE_ERR;
+
+        b->p += n;
+        return DWRF_OK;
+}
+
+static inline DwrfResult buf_uleb(DwrfBuf *b, uint64_t *v)
+{
+        uint8_t len;
+        DwrfResult res = dwarf_decode_uleb128(b->p, b->end, v, &len);
+
+        if (res)
+                return res;
+
+        b->p += len;
+        return DWRF_OK;
+}
+
+static inline DwrfResult buf_sleb(DwrfBuf *b, int64_t *v)
+{
+        uint8_t len;
+        DwrfResult res = dwarf_decode_sleb128(b->p, b->end, v, &len);
+
+        if (res)
+                return res;
+
+        b->p += len;
+        return DWRF_OK;
+}
+
+#endif // include guard
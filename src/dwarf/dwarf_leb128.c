@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_leb128.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* Bytes classified at once by their continuation bit */
+#if defined(__AVX2__)
+#define LEB_BLOCK 32u
+#elif defined(__SSE2__)
+#define LEB_BLOCK 16u
+#else
+#define LEB_BLOCK 8u
+#endif
+
+#define LEB_BLOCK_MASK ((uint32_t)((1ULL << LEB_BLOCK) - 1))
+
+/** @return Bit i set if byte i of the block has its continuation bit set. */
+static inline uint32_t leb_cont_mask(const uint8_t *p)
+{
+#if defined(__AVX2__)
+        return (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)p));
+#elif defined(__SSE2__)
+        return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p));
+#else
+        uint64_t flags = (dwarf_leb_load8(p) >> 7) & 0x0101010101010101ULL;
+        return (uint32_t)((flags * 0x0102040810204080ULL) >> 56);
+#endif
+}
+
+/*
+ * Both batch decoders classify a block of LEB_BLOCK bytes with one compare. Blocks made
+ * only of single-byte values are widened with a fixed count loop (vectorized by the
+ * compiler), otherwise every value that ends inside the block and is at most 8 bytes long
+ * is extracted from an 8-byte load at its start, the terminating bytes being the clear bits
+ * of the mask. Longer values, which are the only ones that can overflow, go through the
+ * scalar decoder. The block path needs 8 bytes of slack after the block for those loads.
+ */
+
+/**
+ * Extracts the values that end inside the block at p, raw and lens need room for LEB_BLOCK entries.
+ * @return Number of bytes consumed, 0 if the first value is too long for the block path.
+ */
+static inline unsigned leb_block(const uint8_t *p, uint64_t *raw, uint8_t *lens, unsigned *n)
+{
+        uint32_t term = ~leb_cont_mask(p) & LEB_BLOCK_MASK;
+        unsigned pos = 0;
+        unsigned k = 0;
+
+        while (term)
+        {
+                unsigned last = dwarf_leb_ctz(term);
+                unsigned len = last - pos + 1;
+                uint64_t w;
+
+                if (len > 8)
+                        break;
+
+                w = dwarf_leb_load8(p + pos) & (~0ULL >> (64 - 8 * len));
+
+                raw[k] = dwarf_leb_pack7(w);
+                lens[k] = (uint8_t)len;
+                k++;
+                pos = last + 1;
+                term &= term - 1;
+        }
+
+        *n = k;
+        return pos;
+}
+
+DwrfResult dwarf_decode_uleb128_batch(const uint8_t *p, const uint8_t *end, uint64_t *vals, size_t count, size_t *consumed)
+{
+        const uint8_t *start = p;
+        uint8_t lens[LEB_BLOCK];
+        size_t i = 0;
+        uint8_t len;
+        DwrfResult res;
+
+        if ((p == NULL) || (end < p) || ((vals == NULL) && count) || (consumed == NULL))
+                return DWRF_BAD_ARG;
+
+        while (i < count)
+        {
+                if ((count - i >= LEB_BLOCK) && ((size_t)(end - p) >= LEB_BLOCK + 8))
+                {
+                        unsigned n, used;
+
+                        if (!leb_cont_mask(p))
+                        {
+                                for (unsigned j = 0; j < LEB_BLOCK; j++)
+                                        vals[i + j] = p[j];
+                                i += LEB_BLOCK;
+                                p += LEB_BLOCK;
+                                continue;
+                        }
+
+                        used = leb_block(p, &vals[i], lens, &n);
+                        if (used)
+                        {
+                                i += n;
+                                p += used;
+                                continue;
+                        }
+                }
+
+                res = dwarf_decode_uleb128(p, end, &vals[i], &len);
+                if (res)
+                {
+                        *consumed = (size_t)(p - start);
+                        return res;
+                }
+                p += len;
+                i++;
+        }
+
+        *consumed = (size_t)(p - start);
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_decode_sleb128_batch(const uint8_t *p, const uint8_t *end, int64_t *vals, size_t count, size_t *consumed)
+{
+        const uint8_t *start = p;
+        uint8_t lens[LEB_BLOCK];
+        size_t i = 0;
+        uint8_t len;
+        DwrfResult res;
+
+        if ((p == NULL) || (end < p) || ((vals == NULL) && count) || (consumed == NULL))
+                return DWRF_BAD_ARG;
+
+        while (i < count)
+        {
+                if ((count - i >= LEB_BLOCK) && ((size_t)(end - p) >= LEB_BLOCK + 8))
+                {
+                        unsigned n, used;
+
+                        if (!leb_cont_mask(p))
+                        {
+                                /* sign extension of the 7-bit values */
+                                for (unsigned j = 0; j < LEB_BLOCK; j++)
+                                        vals[i + j] = (int64_t)(p[j] ^ 0x40) - 0x40;
+                                i += LEB_BLOCK;
+                                p += LEB_BLOCK;
+                                continue;
+                        }
+
+                        used = leb_block(p, (uint64_t *)&vals[i], lens, &n);
+                        if (used)
+                        {
+                                for (unsigned j = 0; j < n; j++)
+                                {
+                                        uint64_t sign = 1ULL << (7 * lens[j] - 1);
+                                        vals[i + j] = (int64_t)(((uint64_t)vals[i + j] ^ sign) - sign);
+                                }
+                                i += n;
+                                p += used;
+                                continue;
+                        }
+                }
+
+                res = dwarf_decode_sleb128(p, end, &vals[i], &len);
+                if (res)
+                {
+                        *consumed = (size_t)(p - start);
+                        return res;
+                }
+                p += len;
+                i++;
+        }
+
+        *consumed = (size_t)(p - start);
+        return DWRF_OK;
+}
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DWARF_LEB128_LIB
+#define DWARF_LEB128_LIB
+
+#include <stddef.h>
+#include <string.h>
+#include "elf_dwarf.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * LEB128 decoders.
+ *
+ * ULEB128 encodes an unsigned integer using a variable number of bytes.
+ * The value is split into 7-bit groups, starting from the least significant
+ * bits. Each group is stored in one byte. The most significant bit (bit 7)
+ * of each byte is used as a continuation flag: it is set to 1 if another
+ * byte follows, and set to 0 in the final (most significant) byte.
+ *
+ * SLEB128 uses the same layout, the sign of the result is determined from
+ * bit 6 of the final byte and sign-extended if required.
+ *
+ * Most values found in DWARF (abbrev codes, attribute names and forms, line
+ * program operands) fit in a single byte, so that case is tested first. Longer
+ * values are decoded from one unaligned 8-byte load when the buffer allows it:
+ * the terminating byte is found from the continuation bits and the 7-bit groups
+ * are packed with pext (BMI2) or three mask and shift steps otherwise.
+ *
+ * Values that don't fit in 64 bits are rejected (DWRF_DECODE_ERR), as are
+ * encodings longer than 10 bytes and values truncated by the end of the buffer.
+ */
+
+#define DWRF_LEB_MAX_BYTES 10u
+
+#define DWRF_LEB_CONT_BITS  0x8080808080808080ULL
+#define DWRF_LEB_VALUE_BITS 0x7F7F7F7F7F7F7F7FULL
+
+/** Loads 8 bytes in memory order, the first byte ends up in the least significant bits. */
+static inline uint64_t dwarf_leb_load8(const uint8_t *p)
+{
+        uint64_t w;
+
+        memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        w = __builtin_bswap64(w);
+#endif
+        return w;
+}
+
+/** Index of the lowest set bit, w must not be zero. */
+static inline unsigned dwarf_leb_ctz(uint64_t w)
+{
+#if defined(__GNUC__)
+        return (unsigned)__builtin_ctzll(w);
+#else
+        unsigned n = 0;
+        while (!(w & 1u))
+        {
+                w >>= 1;
+                n++;
+        }
+        return n;
+#endif
+}
+
+/** Packs the low 7 bits of each byte of w into a 56-bit value. */
+static inline uint64_t dwarf_leb_pack7(uint64_t w)
+{
+#if defined(__BMI2__)
+        return _pext_u64(w, DWRF_LEB_VALUE_BITS);
+#else
+        w &= DWRF_LEB_VALUE_BITS;
+        w = ((w & 0x7F007F007F007F00ULL) >> 1) | (w & 0x007F007F007F007FULL);
+        w = ((w & 0x3FFF00003FFF0000ULL) >> 2) | (w & 0x00003FFF00003FFFULL);
+        w = ((w & 0x0FFFFFFF00000000ULL) >> 4) | (w & 0x000000000FFFFFFFULL);
+        return w;
+#endif
+}
+
+/**
+ * Decodes the 7-bit groups of a LEB128 value without interpreting the last byte.
+ * Values of up to 9 bytes are returned whole in *val, for 10-byte values *val holds
+ * the low 63 bits and *last the final byte so the caller can check it.
+ */
+static inline DwrfResult dwarf_leb_raw(const uint8_t *p, const uint8_t *end, uint64_t *val, uint8_t *len, uint8_t *last)
+{
+        size_t avail = (size_t)(end - p);
+        uint64_t v;
+        unsigned n;
+
+        if (avail >= 8)
+        {
+                uint64_t w = dwarf_leb_load8(p);
+                uint64_t stop = ~w & DWRF_LEB_CONT_BITS;
+
+                if (stop)
+                {
+                        unsigned bits = dwarf_leb_ctz(stop) + 1;        // bytes * 8
+                        if (bits < 64)
+                                w &= (1ULL << bits) - 1;
+
+                        *val = dwarf_leb_pack7(w);
+                        *len = (uint8_t)(bits / 8);
+                        *last = 0;
+                        return DWRF_OK;
+                }
+                v = dwarf_leb_pack7(w);
+                n = 8;
+        }
+        else
+        {
+                v = 0;
+                n = 0;
+        }
+
+        for (; n < DWRF_LEB_MAX_BYTES; n++)
+        {
+                if (n >= avail)
+                        return DWRF_DECODE_ERR;
+
+                uint8_t byte = p[n];
+                if (n == DWRF_LEB_MAX_BYTES - 1)
+                {
+                        if (byte & 0x80)
+                                return DWRF_DECODE_ERR;
+
+                        *val = v;
+                        *len = DWRF_LEB_MAX_BYTES;
+                        *last = byte;
+                        return DWRF_OK;
+                }
+
+                v |= (uint64_t)(byte & 0x7F) << (7 * n);
+                if (!(byte & 0x80))
+                {
+                        *val = v;
+                        *len = (uint8_t)(n + 1);
+                        *last = 0;
+                        return DWRF_OK;
+                }
+        }
+        return DWRF_DECODE_ERR;
+}
+
+/**
+ * Decodes an unsigned LEB128 value.
+ *
+ * @param p Start of the encoded value.
+ * @param end End of the readable bytes, the decoder never reads at or past it.
+ * @param val (out) Decoded value.
+ * @param len (out) Number of bytes consumed.
+ * @return DWRF_OK, DWRF_DECODE_ERR on overflow or truncated input.
+ */
+static inline DwrfResult dwarf_decode_uleb128(const uint8_t *p, const uint8_t *end, uint64_t *val, uint8_t *len)
+{
+        uint8_t last;
+        DwrfResult res;
+
+        if ((p < end) && !(*p & 0x80))
+        {
+                *val = *p;
+                *len = 1;
+                return DWRF_OK;
+        }
+
+        res = dwarf_leb_raw(p, end, val, len, &last);
+        if (res)
+                return res;
+
+        if (*len == DWRF_LEB_MAX_BYTES)
+        {
+                /* the 10th byte only holds bit 63 */
+                if (last > 1)
+                        return DWRF_DECODE_ERR;
+                *val |= (uint64_t)last << 63;
+        }
+        return DWRF_OK;
+}
+
+/**
+ * Decodes a signed LEB128 value.
+ *
+ * @param p Start of the encoded value.
+ * @param end End of the readable bytes, the decoder never reads at or past it.
+ * @param val (out) Decoded value.
+ * @param len (out) Number of bytes consumed.
+ * @return DWRF_OK, DWRF_DECODE_ERR on overflow or truncated input.
+ */
+static inline DwrfResult dwarf_decode_sleb128(const uint8_t *p, const uint8_t *end, int64_t *val, uint8_t *len)
+{
+        uint64_t v, sign;
+        uint8_t last;
+        DwrfResult res;
+
+        if ((p < end) && !(*p & 0x80))
+        {
+                *val = (int64_t)((uint64_t)(*p ^ 0x40) - 0x40);
+                *len = 1;
+                return DWRF_OK;
+        }
+
+        res = dwarf_leb_raw(p, end, &v, len, &last);
+        if (res)
+                return res;
+
+        if (*len == DWRF_LEB_MAX_BYTES)
+        {
+                /* bit 0 of the 10th byte is bit 63, the other six are its sign extension */
+                if ((last != 0x00) && (last != 0x7F))
+                        return DWRF_DECODE_ERR;
+                *val = (int64_t)(v | ((uint64_t)last << 63));
+                return DWRF_OK;
+        }
+
+        sign = 1ULL << (7 * *len - 1);
+        *val = (int64_t)((v ^ sign) - sign);
+        return DWRF_OK;
+}
+
+/**
+ * Decodes a run of consecutive unsigned LEB128 values into an array.
+ * Blocks of single-byte values are detected with SIMD compares (SSE2/AVX2 when
+ * available, 8 bytes at a time otherwise) and widened without a per-byte branch.
+ *
+ * @param p Start of the first encoded value.
+ * @param end End of the readable bytes.
+ * @param vals (out) Array receiving count values.
+ * @param count Number of values to decode.
+ * @param consumed (out) Number of bytes consumed, set on failure to the offset of the bad value.
+ * @return DWRF_OK, DWRF_DECODE_ERR if a value is malformed or truncated.
+ */
+DwrfResult dwarf_decode_uleb128_batch(const uint8_t *p, const uint8_t *end, uint64_t *vals, size_t count, size_t *consumed);
+
+/**
+ * Decodes a run of consecutive signed LEB128 values into an array.
+ * @see dwarf_decode_uleb128_batch
+ */
+DwrfResult dwarf_decode_sleb128_batch(const uint8_t *p, const uint8_t *end, int64_t *vals, size_t count, size_t *consumed);
+
+/**
+ * LEB128 encoders, the inverse of the decoders above. The output buffers must hold
+ * DWRF_LEB_MAX_BYTES bytes, the encodings are the shortest ones so the decoders accept
+ * them and their sizes match dwarf_uleb128_size() and dwarf_sleb128_size().
+ */
+
+/** Number of bytes of the unsigned LEB128 encoding of val. */
+static inline uint8_t dwarf_uleb128_size(uint64_t val)
+{
+        uint8_t n = 1;
+
+        while (val >= 0x80)
+        {
+                val >>= 7;
+                n++;
+        }
+        return n;
+}
+
+/** Number of bytes of the signed LEB128 encoding of val. */
+static inline uint8_t dwarf_sleb128_size(int64_t val)
+{
+        /* the magnitude with the sign bit folded away, one more bit is needed for the sign */
+        uint64_t v = (val < 0) ? ~(uint64_t)val : (uint64_t)val;
+        uint8_t n = 1;
+
+        while (v >= 0x40)
+        {
+                v >>= 7;
+                n++;
+        }
+        return n;
+}
+
+/**
+ * Encodes an unsigned LEB128 value.
+ *
+ * @param val Value to encode.
+ * @param out (out) Buffer of at least DWRF_LEB_MAX_BYTES bytes.
+ * @return Number of bytes written.
+ */
+static inline uint8_t dwarf_encode_uleb128(uint64_t val, uint8_t *out)
+{
+        uint8_t n = 0;
+
+        if (val < 0x80)
+        {
+                out[0] = (uint8_t)val;
+                return 1;
+        }
+
+        while (val >= 0x80)
+        {
+                out[n++] = (uint8_t)(val | 0x80);
+                val >>= 7;
+        }
+        out[n++] = (uint8_t)val;
+        return n;
+}
+
+/**
+ * Encodes a signed LEB128 value.
+ *
+ * @param val Value to encode.
+ * @param out (out) Buffer of at least DWRF_LEB_MAX_BYTES bytes.
+ * @return Number of bytes written.
+ */
+static inline uint8_t dwarf_encode_sleb128(int64_t val, uint8_t *out)
+{
+        uint8_t n = 0;
+
+        if ((val >= -0x40) && (val < 0x40))
+        {
+                out[0] = (uint8_t)val & 0x7F;
+                return 1;
+        }
+
+        for (;;)
+        {
+                uint8_t byte = (uint8_t)val & 0x7F;
+
+                /* arithmetic shift without relying on the implementation defined one */
+                val = (val < 0) ? ~(~val >> 7) : (val >> 7);
+                if (((val == 0) && !(byte & 0x40)) || ((val == -1) && (byte & 0x40)))
+                {
+                        out[n++] = byte;
+                        return n;
+                }
+                out[n++] = byte | 0x80;
+        }
+}
+
+#endif // include guard
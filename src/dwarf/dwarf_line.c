@@ -0,0 +1,1193 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ * Line tables *
+ ***************/
+ // section 6.2 of spec v5
+
+#define LINE_MAX_PATH 4096u
+
+/** Rows of one sequence, [low, high) are the addresses it covers */
+typedef struct
+{
+        uint64_t low;
+        uint64_t high;
+        uint64_t first;         // index of the first row
+        uint64_t count;         // rows, the end_sequence one included
+} LineSeq;
+
+struct DwrfLineTable
+{
+        DwrfLineRow *rows;
+        LineSeq *seqs;
+        DwrfLineFile *files;
+        uint64_t row_count;
+        uint64_t seq_count;
+        uint32_t file_count;
+};
+
+/** File entry of a line program header, strings point into the loaded sections */
+typedef struct
+{
+        const char *name;
+        uint64_t dir;
+        uint64_t mtime;
+        uint64_t size;
+        uint8_t md5[16];
+        uint8_t has_md5;
+} LineRawFile;
+
+/** Work item of one line program, filled by the decoder */
+typedef struct
+{
+        uint64_t stmt_list;     // offset of the program in .debug_line
+        char *comp_dir;         // DW_AT_comp_dir of the unit, NULL if absent
+        uint64_t str_offsets_base;      // of the unit, for strx forms in the header
+        uint8_t str_offset_size;        // zero if the unit has no string offsets
+        uint8_t addr_size;
+        const char **dirs;
+        uint64_t dir_count;
+        LineRawFile *files;
+        uint64_t file_count;
+        DwrfLineRow *rows;
+        uint64_t row_count;
+        uint64_t row_cap;
+        LineSeq *seqs;
+        uint64_t seq_count;
+        uint64_t seq_cap;
+        DwrfResult res;
+} LineUnit;
+
+/** Fields of the program header used by the state machine */
+typedef struct
+{
+        uint16_t version;
+        uint8_t offset_size;
+        uint8_t min_inst_len;
+        uint8_t max_ops;
+        uint8_t default_is_stmt;
+        int8_t line_base;
+        uint8_t line_range;
+        uint8_t opcode_base;
+        const uint8_t *opcode_lengths;
+        const uint8_t *program;
+        const uint8_t *end;
+} LineHeader;
+
+static void line_unit_free(LineUnit *u)
+{
+        free(u->comp_dir);
+        free(u->dirs);
+        free(u->files);
+        free(u->rows);
+        free(u->seqs);
+        *u = (LineUnit){0};
+}
+
+/** @return NUL terminated string at offset of the section, NULL if it runs past the end. */
+static const char *line_section_str(const DwrfSection *sec, uint64_t offset)
+{
+        if ((sec->data == NULL) || (offset >= sec->hdr.Size))
+                return NULL;
+
+        if (memchr(sec->data + offset, '\0', (size_t)(sec->hdr.Size - offset)) == NULL)
+                return NULL;
+        return (const char *)sec->data + offset;
+}
+
+static DwrfResult line_buf_str(DwrfBuf *b, const char **str)
+{
+        const uint8_t *nul = memchr(b->p, '\0', (size_t)buf_left(b));
+
+        if (nul == NULL)
+                return DWRF_DECODE_ERR;
+
+        *str = (const char *)b->p;
+        b->p = nul + 1;
+        return DWRF_OK;
+}
+
+/** Offset in .debug_str of a strx form, indexes are relative to the string offsets of the unit that owns the program. */
+static DwrfResult line_read_strx(const InternalDwarfCtx *ctx, const LineUnit *u, DwrfBuf *b, uint64_t form, uint64_t *off)
+{
+        DwrfResult res;
+        uint64_t idx;
+
+        if (form == DW_FORM_strx)
+                res = buf_uleb(b, &idx);
+        else
+                res = buf_uN(b, (uint8_t)(form - DW_FORM_strx1 + 1), &idx);
+        if (res)
+                return res;
+
+        return dwrf_table_entry(ctx, &ctx->debug_str_offsets, u->str_offsets_base, idx, u->str_offset_size, off);
+}
+
+/**
+ * Value of one field of a DWARF 5 directory or file entry.
+ * Strings are returned in *str, constants in *val and data16 in md5.
+ */
+static DwrfResult line_read_field(const InternalDwarfCtx *ctx, const LineUnit *u, DwrfBuf *b, uint64_t form,
+                                  uint8_t offset_size, uint64_t *val, const char **str, uint8_t *md5)
+{
+        DwrfResult res;
+        uint64_t off;
+
+        *val = 0;
+        *str = NULL;
+        switch (form)
+        {
+        case DW_FORM_string:
+                return line_buf_str(b, str);
+        case DW_FORM_line_strp:
+        case DW_FORM_strp:
+                if ((res = buf_uN(b, offset_size, &off)))
+                        return res;
+                *str = line_section_str((form == DW_FORM_strp) ? &ctx->debug_str : &ctx->debug_line_str, off);
+                return (*str != NULL) ? DWRF_OK : DWRF_DECODE_ERR;
+        case DW_FORM_strx:
+        case DW_FORM_strx1:
+        case DW_FORM_strx2:
+        case DW_FORM_strx3:
+        case DW_FORM_strx4:
+                if ((res = line_read_strx(ctx, u, b, form, &off)))
+                        return res;
+                *str = line_section_str(&ctx->debug_str, off);
+                return (*str != NULL) ? DWRF_OK : DWRF_DECODE_ERR;
+        case DW_FORM_udata:
+                return buf_uleb(b, val);
+        case DW_FORM_data1:
+                return buf_uN(b, 1, val);
+        case DW_FORM_data2:
+                return buf_uN(b, 2, val);
+        case DW_FORM_data4:
+                return buf_uN(b, 4, val);
+        case DW_FORM_data8:
+                return buf_uN(b, 8, val);
+        case DW_FORM_data16:
+                if (buf_left(b) < 16)
+                        return DWRF_DECODE_ERR;
+                memcpy(md5, b->p, 16);
+                b->p += 16;
+                return DWRF_OK;
+        case DW_FORM_block:
+                if ((res = buf_uleb(b, &off)))
+                        return res;
+                return buf_skip(b, off);
+        default:
+                return DWRF_DECODE_ERR;
+        }
+}
+
+/**
+ * Parses a DWARF 5 entry format description followed by its entries.
+ * With files == NULL the entries are directories, only their path is kept.
+ */
+static DwrfResult line_read_entries(const InternalDwarfCtx *ctx, const LineUnit *u, DwrfBuf *b, uint8_t offset_size,
+                                    const char ***dirs, LineRawFile **files, uint64_t *count)
+{
+        uint64_t format[2 * 255];
+        uint64_t fmt_count, n;
+        size_t used;
+        DwrfResult res;
+
+        if ((res = buf_uN(b, 1, &fmt_count)))
+                return res;
+
+        /* (content type, form) pairs */
+        res = dwarf_decode_uleb128_batch(b->p, b->end, format, (size_t)(2 * fmt_count), &used);
+        if (res)
+                return res;
+        b->p += used;
+
+        if ((res = buf_uleb(b, &n)))
+                return res;
+
+        /* every entry takes at least one byte */
+        if (n > buf_left(b))
+                return DWRF_DECODE_ERR;
+
+        if (n)
+        {
+                void *arr = calloc((size_t)n, (files != NULL) ? sizeof(LineRawFile) : sizeof(const char *));
+                if (arr == NULL)
+                        return DWRF_NO_MEM;
+
+                if (files != NULL)
+                        *files = arr;
+                else
+                        *dirs = arr;
+        }
+        *count = n;
+
+        for (uint64_t i = 0; i < n; i++)
+        {
+                LineRawFile tmp = {0};
+                LineRawFile *f = (files != NULL) ? &(*files)[i] : &tmp;
+
+                for (uint64_t j = 0; j < fmt_count; j++)
+                {
+                        uint64_t val;
+                        const char *str;
+                        uint8_t md5[16] = {0};
+
+                        res = line_read_field(ctx, u, b, format[2 * j + 1], offset_size, &val, &str, md5);
+                        if (res)
+                                return res;
+
+                        switch (format[2 * j])
+                        {
+                        case DW_LNCT_path:
+                                f->name = str;
+                                break;
+                        case DW_LNCT_directory_index:
+                                f->dir = val;
+                                break;
+                        case DW_LNCT_timestamp:
+                                f->mtime = val;
+                                break;
+                        case DW_LNCT_size:
+                                f->size = val;
+                                break;
+                        case DW_LNCT_MD5:
+                                memcpy(f->md5, md5, 16);
+                                f->has_md5 = (format[2 * j + 1] == DW_FORM_data16);
+                                break;
+                        default:
+                                break; // vendor content, skipped
+                        }
+                }
+
+                if (files == NULL)
+                        (*dirs)[i] = tmp.name;
+        }
+        return DWRF_OK;
+}
+
+/** DWARF 2 to 4 include_directories and file_names, the compilation directory becomes directory 0. */
+static DwrfResult line_read_legacy_entries(DwrfBuf *b, LineUnit *u)
+{
+        DwrfBuf scan;
+        const char *str;
+        uint64_t n = 0;
+        uint64_t dummy;
+        DwrfResult res;
+
+        /* count first so both arrays are allocated once */
+        scan = *b;
+        while (buf_left(&scan) && (*scan.p != 0))
+        {
+                if ((res = line_buf_str(&scan, &str)))
+                        return res;
+                n++;
+        }
+        if ((res = buf_skip(&scan, 1)))
+                return res;
+
+        u->dirs = calloc((size_t)n + 1, sizeof(const char *));
+        if (u->dirs == NULL)
+                return DWRF_NO_MEM;
+
+        u->dirs[0] = u->comp_dir;
+        u->dir_count = n + 1;
+        for (uint64_t i = 1; i <= n; i++)
+                line_buf_str(b, &u->dirs[i]);
+        b->p++;
+
+        n = 0;
+        scan = *b;
+        while (buf_left(&scan) && (*scan.p != 0))
+        {
+                if ((res = line_buf_str(&scan, &str)) || (res = buf_uleb(&scan, &dummy)) ||
+                    (res = buf_uleb(&scan, &dummy)) || (res = buf_uleb(&scan, &dummy)))
+                        return res;
+                n++;
+        }
+        if ((res = buf_skip(&scan, 1)))
+                return res;
+
+        if (n)
+        {
+                u->files = calloc((size_t)n, sizeof(LineRawFile));
+                if (u->files == NULL)
+                        return DWRF_NO_MEM;
+        }
+
+        u->file_count = n;
+        for (uint64_t i = 0; i < n; i++)
+        {
+                LineRawFile *f = &u->files[i];
+                line_buf_str(b, &f->name);
+                buf_uleb(b, &f->dir);
+                buf_uleb(b, &f->mtime);
+                buf_uleb(b, &f->size);
+        }
+        b->p++;
+        return DWRF_OK;
+}
+
+static DwrfResult line_read_header(const InternalDwarfCtx *ctx, LineUnit *u, LineHeader *h)
+{
+        const DwrfSection *sec = &ctx->debug_line;
+        DwrfBuf b;
+        uint64_t length, header_length, v;
+        const uint8_t *unit_end, *program;
+        DwrfResult res;
+
+        if (u->stmt_list >= sec->hdr.Size)
+                return DWRF_DECODE_ERR;
+
+        b = buf_make(ctx, sec, u->stmt_list, sec->hdr.Size);
+        if ((res = buf_uN(&b, 4, &length)))
+                return res;
+
+        h->offset_size = 4;
+        if (length == 0xFFFFFFFFu)
+        {
+                h->offset_size = 8;
+                if ((res = buf_uN(&b, 8, &length)))
+                        return res;
+        }
+        else if (length >= 0xFFFFFFF0u)
+                return DWRF_DECODE_ERR;
+
+        if (length > buf_left(&b))
+                return DWRF_DECODE_ERR;
+        unit_end = b.p + length;
+        b.end = unit_end;
+
+        if ((res = buf_uN(&b, 2, &v)))
+                return res;
+        h->version = (uint16_t)v;
+        if ((h->version < 2) || (h->version > 5))
+                return DWRF_UNSUPPORTED;
+
+        if (h->version >= 5)
+        {
+                if ((res = buf_uN(&b, 1, &v)))
+                        return res;
+                u->addr_size = (uint8_t)v;
+                if ((res = buf_uN(&b, 1, &v)))  // segment_selector_size
+                        return res;
+        }
+
+        if ((res = buf_uN(&b, h->offset_size, &header_length)))
+                return res;
+        if (header_length > buf_left(&b))
+                return DWRF_DECODE_ERR;
+        program = b.p + header_length;
+
+        if ((res = buf_uN(&b, 1, &v)))
+                return res;
+        h->min_inst_len = (uint8_t)v;
+
+        h->max_ops = 1;
+        if (h->version >= 4)
+        {
+                if ((res = buf_uN(&b, 1, &v)))
+                        return res;
+                h->max_ops = (uint8_t)v;
+        }
+
+        if ((res = buf_uN(&b, 1, &v)))
+                return res;
+        h->default_is_stmt = (v != 0);
+        if ((res = buf_uN(&b, 1, &v)))
+                return res;
+        h->line_base = (int8_t)(uint8_t)v;
+        if ((res = buf_uN(&b, 1, &v)))
+                return res;
+        h->line_range = (uint8_t)v;
+        if ((res = buf_uN(&b, 1, &v)))
+                return res;
+        h->opcode_base = (uint8_t)v;
+
+        if ((h->line_range == 0) || (h->max_ops == 0) || (h->opcode_base == 0))
+                return DWRF_DECODE_ERR;
+
+        h->opcode_lengths = b.p;
+        if ((res = buf_skip(&b, h->opcode_base - 1u)))
+                return res;
+
+        if (h->version >= 5)
+        {
+                res = line_read_entries(ctx, u, &b, h->offset_size, &u->dirs, NULL, &u->dir_count);
+                if (res == DWRF_OK)
+                        res = line_read_entries(ctx, u, &b, h->offset_size, NULL, &u->files, &u->file_count);
+        }
+        else
+                res = line_read_legacy_entries(&b, u);
+
+        if (res)
+                return res;
+
+        if (b.p > program)
+                return DWRF_DECODE_ERR;
+
+        h->program = program;
+        h->end = unit_end;
+        return DWRF_OK;
+}
+
+/** Closes the sequence started at row first, empty sequences are dropped. */
+static DwrfResult line_end_sequence(LineUnit *u, uint64_t first)
+{
+        uint64_t low = u->rows[first].Address;
+        uint64_t high = u->rows[u->row_count - 1].Address;
+
+        if ((u->row_count - first < 2) || (low >= high))
+        {
+                u->row_count = first;
+                return DWRF_OK;
+        }
+
+        if (u->seq_count == u->seq_cap)
+        {
+                uint64_t cap = u->seq_cap ? u->seq_cap * 2 : 16;
+                LineSeq *seqs = realloc(u->seqs, (size_t)cap * sizeof(LineSeq));
+                if (seqs == NULL)
+                        return DWRF_NO_MEM;
+                u->seqs = seqs;
+                u->seq_cap = cap;
+        }
+
+        u->seqs[u->seq_count++] = (LineSeq){ low, high, first, u->row_count - first };
+        return DWRF_OK;
+}
+
+/** Registers of the state machine, the row being built holds address, column and flags */
+typedef struct
+{
+        DwrfLineRow row;
+        uint64_t file;
+        uint64_t line;
+        uint64_t op_index;
+        uint64_t seq_first;     // first row of the current sequence
+} LineState;
+
+static inline void line_reset(const LineHeader *h, const LineUnit *u, LineState *st)
+{
+        st->row = (DwrfLineRow){0};
+        st->row.Flags = h->default_is_stmt ? DWRF_LINE_IS_STMT : 0;
+        st->file = 1;
+        st->line = 1;
+        st->op_index = 0;
+        st->seq_first = u->row_count;
+}
+
+/** Appends a row and clears the flags that only apply to one row. */
+static inline DwrfResult line_emit(const LineHeader *h, LineUnit *u, LineState *st)
+{
+        uint64_t file = st->file;
+
+        /* file register to index in the unit's file list, DWARF 5 counts from 0 and older versions from 1 */
+        if (h->version < 5)
+                file--;
+        st->row.File = (file < u->file_count) ? (uint32_t)file : DWRF_LINE_NO_FILE;
+        st->row.Line = (uint32_t)st->line;
+
+        if (u->row_count == u->row_cap)
+        {
+                uint64_t cap = u->row_cap * 2;
+                DwrfLineRow *rows = realloc(u->rows, (size_t)cap * sizeof(DwrfLineRow));
+                if (rows == NULL)
+                        return DWRF_NO_MEM;
+                u->rows = rows;
+                u->row_cap = cap;
+        }
+
+        u->rows[u->row_count++] = st->row;
+        st->row.Flags &= DWRF_LINE_IS_STMT;
+        return DWRF_OK;
+}
+
+/** Advance of the address by an operation advance, section 6.2.5.1 */
+static inline void line_advance(const LineHeader *h, LineState *st, uint64_t adv)
+{
+        if (h->max_ops == 1)
+        {
+                st->row.Address += h->min_inst_len * adv;
+                return;
+        }
+
+        st->row.Address += h->min_inst_len * ((st->op_index + adv) / h->max_ops);
+        st->op_index = (st->op_index + adv) % h->max_ops;
+}
+
+/** Runs the line number state machine over the program of one unit. */
+static DwrfResult line_run_program(const InternalDwarfCtx *ctx, LineUnit *u)
+{
+        LineHeader h;
+        LineState st;
+        const uint8_t *p, *end;
+        uint8_t is_big = (ctx->endianness == ELFDATA2MSB);
+        DwrfResult res;
+
+        res = line_read_header(ctx, u, &h);
+        if (res)
+                return res;
+
+        /* rough guess from the usual density of line programs */
+        u->row_cap = (uint64_t)(h.end - h.program) / 3 + 16;
+        u->rows = malloc((size_t)u->row_cap * sizeof(DwrfLineRow));
+        if (u->rows == NULL)
+                return DWRF_NO_MEM;
+
+        p = h.program;
+        end = h.end;
+        line_reset(&h, u, &st);
+
+        while (p < end)
+        {
+                uint8_t op = *p++;
+                uint64_t uval;
+                int64_t sval;
+                uint8_t len;
+
+                if (op >= h.opcode_base)
+                {
+                        /* special opcode */
+                        uint8_t adj = op - h.opcode_base;
+                        line_advance(&h, &st, adj / h.line_range);
+                        st.line += (uint64_t)((int64_t)h.line_base + (adj % h.line_range));
+                        if ((res = line_emit(&h, u, &st)))
+                                return res;
+                        continue;
+                }
+
+                switch (op)
+                {
+                case 0:
+                {
+                        /* extended opcode */
+                        const uint8_t *ext_end;
+
+                        if ((res = dwarf_decode_uleb128(p, end, &uval, &len)))
+                                return res;
+                        p += len;
+                        if ((uval == 0) || (uval > (uint64_t)(end - p)))
+                                return DWRF_DECODE_ERR;
+                        ext_end = p + uval;
+
+                        switch (*p++)
+                        {
+                        case DW_LNE_end_sequence:
+                                st.row.Flags |= DWRF_LINE_END_SEQUENCE;
+                                if ((res = line_emit(&h, u, &st)) || (res = line_end_sequence(u, st.seq_first)))
+                                        return res;
+                                line_reset(&h, u, &st);
+                                break;
+                        case DW_LNE_set_address:
+                                if ((ext_end - p == 0) || (ext_end - p > 8))
+                                        return DWRF_DECODE_ERR;
+                                st.row.Address = load_uN(p, (uint8_t)(ext_end - p), is_big);
+                                st.op_index = 0;
+                                break;
+                        default:
+                                break; // discriminators, DW_LNE_define_file and vendor opcodes are skipped
+                        }
+                        p = ext_end;
+                        break;
+                }
+                case DW_LNS_copy:
+                        if ((res = line_emit(&h, u, &st)))
+                                return res;
+                        break;
+                case DW_LNS_advance_pc:
+                        if ((res = dwarf_decode_uleb128(p, end, &uval, &len)))
+                                return res;
+                        p += len;
+                        line_advance(&h, &st, uval);
+                        break;
+                case DW_LNS_advance_line:
+                        if ((res = dwarf_decode_sleb128(p, end, &sval, &len)))
+                                return res;
+                        p += len;
+                        st.line += (uint64_t)sval;
+                        break;
+                case DW_LNS_set_file:
+                        if ((res = dwarf_decode_uleb128(p, end, &st.file, &len)))
+                                return res;
+                        p += len;
+                        break;
+                case DW_LNS_set_column:
+                        if ((res = dwarf_decode_uleb128(p, end, &uval, &len)))
+                                return res;
+                        p += len;
+                        st.row.Column = (uval > 0xFFFF) ? 0xFFFF : (uint16_t)uval;
+                        break;
+                case DW_LNS_negate_stmt:
+                        st.row.Flags ^= DWRF_LINE_IS_STMT;
+                        break;
+                case DW_LNS_set_basic_block:
+                        st.row.Flags |= DWRF_LINE_BASIC_BLOCK;
+                        break;
+                case DW_LNS_const_add_pc:
+                        line_advance(&h, &st, (255u - h.opcode_base) / h.line_range);
+                        break;
+                case DW_LNS_fixed_advance_pc:
+                        if (end - p < 2)
+                                return DWRF_DECODE_ERR;
+                        st.row.Address += load_uN(p, 2, is_big);
+                        st.op_index = 0;
+                        p += 2;
+                        break;
+                case DW_LNS_set_prologue_end:
+                        st.row.Flags |= DWRF_LINE_PROLOGUE_END;
+                        break;
+                case DW_LNS_set_epilogue_begin:
+                        st.row.Flags |= DWRF_LINE_EPILOGUE_BEGIN;
+                        break;
+                default:
+                {
+                        /* DW_LNS_set_isa and opcodes this decoder doesn't know, skipped using their operand count */
+                        uint64_t args[255];
+                        size_t used;
+
+                        res = dwarf_decode_uleb128_batch(p, end, args, h.opcode_lengths[op - 1], &used);
+                        if (res)
+                                return res;
+                        p += used;
+                        break;
+                }
+                }
+        }
+
+        /* rows of an unterminated sequence don't cover any range */
+        u->row_count = st.seq_first;
+        return DWRF_OK;
+}
+
+/***************
+ *    Units    *
+ ***************/
+
+static int line_unit_cmp(const void *a, const void *b)
+{
+        uint64_t x = ((const LineUnit *)a)->stmt_list;
+        uint64_t y = ((const LineUnit *)b)->stmt_list;
+        return (x > y) - (x < y);
+}
+
+/**
+ * Reads DW_AT_stmt_list and DW_AT_comp_dir from the unit DIE, and the string offsets base of
+ * DWARF 5 units. DWRF_NOT_FOUND if the unit has no line program.
+ */
+static DwrfResult line_unit_info(DwrfCtx *ctx, DwrfCursor *cur, const DwrfUnitHeader *unit, LineUnit *u)
+{
+        static const uint16_t names[2] = { DW_AT_stmt_list, DW_AT_comp_dir };
+        const DwrfUnitBases *bases;
+        DwrfAttr attrs[2];
+        char path[LINE_MAX_PATH];
+        DwrfResult res;
+
+        if ((res = dwarf_cursor_seek_unit(cur, unit->Offset)) || (res = dwarf_cursor_next(cur, NULL)) ||
+            (res = dwarf_cursor_get_attrs(cur, names, 2, attrs)))
+                return (res == DWRF_END) ? DWRF_NOT_FOUND : res;
+
+        if (attrs[0].Form == 0)
+                return DWRF_NOT_FOUND;
+
+        *u = (LineUnit){0};
+        u->stmt_list = attrs[0].Value;
+        u->addr_size = unit->AddrSize;
+
+        if (unit->Version >= 5)
+        {
+                if ((res = dwrf_unit_bases(CTX(ctx), unit, &bases)))
+                        return res;
+                u->str_offsets_base = bases->str_offsets_base;
+                u->str_offset_size = bases->offset_size;
+        }
+
+        if ((attrs[1].Form != 0) && (dwarf_cursor_resolve(cur, &attrs[1]) == DWRF_OK) &&
+            (dwarf_get_string(ctx, &attrs[1], (uint8_t *)path, sizeof(path)) == DWRF_OK))
+        {
+                size_t len = strlen(path) + 1;
+
+                u->comp_dir = malloc(len);
+                if (u->comp_dir == NULL)
+                        return DWRF_NO_MEM;
+                memcpy(u->comp_dir, path, len);
+        }
+        return DWRF_OK;
+}
+
+/** Lists the line programs of the compile units, sorted by offset and without duplicates. */
+static DwrfResult line_collect_units(DwrfCtx *ctx, LineUnit **out, uint64_t *out_count)
+{
+        DwrfCursor cur;
+        DwrfUnitHeader unit;
+        LineUnit *units = NULL;
+        uint64_t count = 0, cap = 0, off = 0;
+        DwrfResult res;
+
+        dwarf_cursor_init(ctx, &cur);
+        while ((res = dwarf_get_unit_header(ctx, off, &unit)) == DWRF_OK)
+        {
+                off = unit.NextOffset;
+
+                /* type units share the line program of their compile unit */
+                if ((unit.UnitType == DW_UT_type) || (unit.UnitType == DW_UT_split_type))
+                        continue;
+
+                if (count == cap)
+                {
+                        LineUnit *grown;
+
+                        cap = cap ? cap * 2 : 16;
+                        grown = realloc(units, (size_t)cap * sizeof(LineUnit));
+                        if (grown == NULL)
+                        {
+                                res = DWRF_NO_MEM;
+                                break;
+                        }
+                        units = grown;
+                }
+
+                res = line_unit_info(ctx, &cur, &unit, &units[count]);
+                if (res == DWRF_NOT_FOUND)
+                        continue;
+                if (res)
+                        break;
+                count++;
+        }
+
+        /* BAD_ARG marks the end of the section */
+        if (res != DWRF_BAD_ARG)
+        {
+                for (uint64_t i = 0; i < count; i++)
+                        line_unit_free(&units[i]);
+                free(units);
+                return res;
+        }
+
+        if (count > 1)
+        {
+                uint64_t kept = 1;
+
+                qsort(units, (size_t)count, sizeof(LineUnit), line_unit_cmp);
+                for (uint64_t i = 1; i < count; i++)
+                {
+                        if (units[i].stmt_list == units[kept - 1].stmt_list)
+                                line_unit_free(&units[i]);
+                        else
+                                units[kept++] = units[i];
+                }
+                count = kept;
+        }
+
+        *out = units;
+        *out_count = count;
+        return DWRF_OK;
+}
+
+/***************
+ *   Decoding  *
+ ***************/
+
+typedef struct
+{
+        const InternalDwarfCtx *ctx;
+        LineUnit *units;
+} LineJobs;
+
+static void line_job(void *arg, uint64_t job, uint32_t worker)
+{
+        LineJobs *jobs = arg;
+
+        (void)worker;
+        jobs->units[job].res = line_run_program(jobs->ctx, &jobs->units[job]);
+}
+
+/**
+ * Decodes every unit, the sections are loaded beforehand so the workers only read the context.
+ * Units are handed out one at a time as their sizes vary a lot.
+ */
+static DwrfResult line_decode_units(InternalDwarfCtx *ctx, LineUnit *units, uint64_t count, uint32_t threads)
+{
+        LineJobs jobs = { .ctx = ctx, .units = units };
+        DwrfResult res;
+
+        if ((res = dwrf_load_section(ctx, &ctx->debug_line)) || (res = dwrf_load_section(ctx, &ctx->debug_str)))
+                return res;
+        if (ctx->debug_line_str.present && (res = dwrf_load_section(ctx, &ctx->debug_line_str)))
+                return res;
+        if (ctx->debug_str_offsets.present && (res = dwrf_load_section(ctx, &ctx->debug_str_offsets)))
+                return res;
+
+        dwrf_run_jobs(dwrf_worker_count(threads, count), count, line_job, &jobs);
+
+        /* report the error of the first failing unit so the result doesn't depend on scheduling */
+        for (uint64_t i = 0; i < count; i++)
+        {
+                if (units[i].res)
+                        return units[i].res;
+        }
+        return DWRF_OK;
+}
+
+/***************
+ *    Merge    *
+ ***************/
+
+typedef struct
+{
+        uint64_t low;
+        uint32_t unit;
+        uint32_t seq;
+} LineSeqRef;
+
+static int line_seq_ref_cmp(const void *a, const void *b)
+{
+        const LineSeqRef *x = a;
+        const LineSeqRef *y = b;
+
+        if (x->low != y->low)
+                return (x->low > y->low) ? 1 : -1;
+        if (x->unit != y->unit)
+                return (x->unit > y->unit) ? 1 : -1;
+        return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+static inline int line_path_is_absolute(const char *path)
+{
+        return (path[0] == '/') || ((path[0] != '\0') && (path[1] == ':')); // POSIX and DOS paths
+}
+
+/** Size of directory i once joined with directory 0, including the terminator. */
+static size_t line_dir_size(const LineUnit *u, uint64_t i)
+{
+        const char *dir = u->dirs[i];
+
+        if (dir == NULL)
+                return 0;
+        if ((i == 0) || (u->dirs[0] == NULL) || line_path_is_absolute(dir))
+                return strlen(dir) + 1;
+        return strlen(u->dirs[0]) + 1 + strlen(dir) + 1;
+}
+
+static char *line_pool_copy(char **pool, const char *a, const char *b)
+{
+        char *start = *pool;
+        size_t len = strlen(a);
+
+        memcpy(*pool, a, len);
+        *pool += len;
+        if (b != NULL)
+        {
+                *(*pool)++ = '/';
+                len = strlen(b);
+                memcpy(*pool, b, len);
+                *pool += len;
+        }
+        *(*pool)++ = '\0';
+        return start;
+}
+
+/**
+ * Builds the table in a single allocation: rows, sequences, files and the string pool.
+ * Sequences are ordered by start address, ties broken by unit and position so the
+ * layout is the same whatever the decoding order was.
+ */
+static DwrfResult line_merge(LineUnit *units, uint64_t count, DwrfLineTable **out)
+{
+        uint64_t rows = 0, seqs = 0, files = 0, pool = 0, max_dirs = 0;
+        LineSeqRef *refs;
+        const char **dirs;
+        uint32_t *file_base;
+        DwrfLineTable *t;
+        char *str;
+        uint64_t k = 0;
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+                const LineUnit *u = &units[i];
+
+                rows += u->row_count;
+                seqs += u->seq_count;
+                files += u->file_count;
+                if (u->dir_count > max_dirs)
+                        max_dirs = u->dir_count;
+
+                for (uint64_t d = 0; d < u->dir_count; d++)
+                        pool += line_dir_size(u, d);
+                for (uint64_t f = 0; f < u->file_count; f++)
+                        pool += (u->files[f].name != NULL) ? strlen(u->files[f].name) + 1 : 1;
+        }
+
+        if ((files >= DWRF_LINE_NO_FILE) || (count > UINT32_MAX))
+                return DWRF_UNSUPPORTED;
+
+        t = malloc(sizeof(DwrfLineTable) + rows * sizeof(DwrfLineRow) + seqs * sizeof(LineSeq) +
+                   files * sizeof(DwrfLineFile) + pool);
+        refs = malloc((size_t)(seqs + 1) * sizeof(LineSeqRef));
+        dirs = malloc((size_t)(max_dirs + 1) * sizeof(const char *));
+        file_base = malloc((size_t)(count + 1) * sizeof(uint32_t));
+        if ((t == NULL) || (refs == NULL) || (dirs == NULL) || (file_base == NULL))
+        {
+                free(t);
+                free(refs);
+                free(dirs);
+                free(file_base);
+                return DWRF_NO_MEM;
+        }
+
+        t->rows = (DwrfLineRow *)(t + 1);
+        t->seqs = (LineSeq *)(t->rows + rows);
+        t->files = (DwrfLineFile *)(t->seqs + seqs);
+        t->row_count = rows;
+        t->seq_count = seqs;
+        t->file_count = (uint32_t)files;
+        str = (char *)(t->files + files);
+
+        /* files and their strings */
+        files = 0;
+        for (uint64_t i = 0; i < count; i++)
+        {
+                const LineUnit *u = &units[i];
+
+                file_base[i] = (uint32_t)files;
+                for (uint64_t d = 0; d < u->dir_count; d++)
+                {
+                        const char *dir = u->dirs[d];
+
+                        if (dir == NULL)
+                                dirs[d] = NULL;
+                        else if ((d == 0) || (u->dirs[0] == NULL) || line_path_is_absolute(dir))
+                                dirs[d] = line_pool_copy(&str, dir, NULL);
+                        else
+                                dirs[d] = line_pool_copy(&str, u->dirs[0], dir);
+                }
+
+                for (uint64_t f = 0; f < u->file_count; f++)
+                {
+                        const LineRawFile *raw = &u->files[f];
+                        DwrfLineFile *file = &t->files[files++];
+
+                        file->Name = line_pool_copy(&str, (raw->name != NULL) ? raw->name : "", NULL);
+                        file->Dir = (raw->dir < u->dir_count) ? dirs[raw->dir] : NULL;
+                        file->Mtime = raw->mtime;
+                        file->Size = raw->size;
+                        file->HasMd5 = raw->has_md5;
+                        memcpy(file->Md5, raw->md5, 16);
+                }
+        }
+
+        /* sequences in address order */
+        for (uint64_t i = 0; i < count; i++)
+        {
+                for (uint64_t s = 0; s < units[i].seq_count; s++)
+                        refs[k++] = (LineSeqRef){ units[i].seqs[s].low, (uint32_t)i, (uint32_t)s };
+        }
+        qsort(refs, (size_t)seqs, sizeof(LineSeqRef), line_seq_ref_cmp);
+
+        rows = 0;
+        for (uint64_t s = 0; s < seqs; s++)
+        {
+                const LineUnit *u = &units[refs[s].unit];
+                LineSeq seq = u->seqs[refs[s].seq];
+                DwrfLineRow *dst = &t->rows[rows];
+
+                memcpy(dst, &u->rows[seq.first], (size_t)seq.count * sizeof(DwrfLineRow));
+                for (uint64_t r = 0; r < seq.count; r++)
+                {
+                        if (dst[r].File != DWRF_LINE_NO_FILE)
+                                dst[r].File += file_base[refs[s].unit];
+                }
+
+                seq.first = rows;
+                t->seqs[s] = seq;
+                rows += seq.count;
+        }
+
+        free(refs);
+        free(dirs);
+        free(file_base);
+        *out = t;
+        return DWRF_OK;
+}
+
+static DwrfResult line_build(InternalDwarfCtx *ctx, LineUnit *units, uint64_t count, uint32_t threads, DwrfLineTable **table)
+{
+        DwrfResult res = line_decode_units(ctx, units, count, threads);
+
+        if (res == DWRF_OK)
+                res = line_merge(units, count, table);
+
+        for (uint64_t i = 0; i < count; i++)
+                line_unit_free(&units[i]);
+        return res;
+}
+
+/***************
+ *     API     *
+ ***************/
+
+DwrfResult dwarf_line_table_unit(DwrfCtx *ctx, const DwrfUnitHeader *unit, DwrfLineTable **table)
+{
+        DwrfCursor cur;
+        LineUnit u;
+        DwrfResult res;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if ((unit == NULL) || (table == NULL))
+                return DWRF_BAD_ARG;
+
+        if (!CTX(ctx)->debug_line.present)
+                return DWRF_SEC_MISSING;
+
+        dwarf_cursor_init(ctx, &cur);
+        res = line_unit_info(ctx, &cur, unit, &u);
+        if (res)
+                return res;
+
+        return line_build(CTX(ctx), &u, 1, 1, table);
+}
+
+DwrfResult dwarf_line_table_all(DwrfCtx *ctx, uint32_t threads, DwrfLineTable **table)
+{
+        LineUnit *units;
+        uint64_t count;
+        DwrfResult res;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (table == NULL)
+                return DWRF_BAD_ARG;
+
+        if (!CTX(ctx)->debug_line.present)
+                return DWRF_SEC_MISSING;
+
+        res = line_collect_units(ctx, &units, &count);
+        if (res)
+                return res;
+
+        res = line_build(CTX(ctx), units, count, threads, table);
+        free(units);
+        return res;
+}
+
+void dwarf_line_table_destroy(DwrfLineTable *table)
+{
+        free(table);
+}
+
+DwrfResult dwarf_line_lookup(const DwrfLineTable *table, uint64_t addr, const DwrfLineRow **row)
+{
+        uint64_t lo, hi;
+        const LineSeq *seq;
+
+        if ((table == NULL) || (row == NULL))
+                return DWRF_BAD_ARG;
+
+        /* last sequence starting at or before addr */
+        lo = 0;
+        hi = table->seq_count;
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (table->seqs[mid].low <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if ((lo == 0) || (addr >= table->seqs[lo - 1].high))
+                return DWRF_NOT_FOUND;
+        seq = &table->seqs[lo - 1];
+
+        /* last row at or before addr, the end_sequence row is never a candidate */
+        lo = seq->first;
+        hi = seq->first + seq->count - 1;
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (table->rows[mid].Address <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        *row = &table->rows[lo - 1];
+        return DWRF_OK;
+}
+
+void dwrf_line_table_usage(const DwrfLineTable *table, uint32_t *files, uint64_t *bytes)
+{
+        *files = table->file_count;
+        *bytes = sizeof(DwrfLineTable) + table->row_count * sizeof(DwrfLineRow) + table->seq_count * sizeof(LineSeq) +
+                 table->file_count * sizeof(DwrfLineFile);
+}
+
+DwrfResult dwarf_line_rows(const DwrfLineTable *table, const DwrfLineRow **rows, uint64_t *count)
+{
+        if ((table == NULL) || (rows == NULL) || (count == NULL))
+                return DWRF_BAD_ARG;
+
+        *rows = table->rows;
+        *count = table->row_count;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_line_get_file(const DwrfLineTable *table, uint32_t file, DwrfLineFile *out)
+{
+        if ((table == NULL) || (out == NULL) || (file >= table->file_count))
+                return DWRF_BAD_ARG;
+
+        *out = table->files[file];
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_line_file_path(const DwrfLineTable *table, uint32_t file, char *buff, uint16_t len)
+{
+        const DwrfLineFile *f;
+        size_t dir_len = 0, name_len, total;
+
+        if ((table == NULL) || (buff == NULL) || (len == 0) || (file >= table->file_count))
+                return DWRF_BAD_ARG;
+
+        f = &table->files[file];
+        name_len = strlen(f->Name);
+        if ((f->Dir != NULL) && (f->Dir[0] != '\0') && !line_path_is_absolute(f->Name))
+                dir_len = strlen(f->Dir) + 1;
+
+        total = dir_len + name_len + 1;
+        if (total > len)
+        {
+                buff[0] = '\0';
+                return DWRF_BUFFER_OVERFLOW;
+        }
+
+        if (dir_len)
+        {
+                memcpy(buff, f->Dir, dir_len - 1);
+                buff[dir_len - 1] = '/';
+        }
+        memcpy(buff + dir_len, f->Name, name_len + 1);
+        return DWRF_OK;
+}
@@ -0,0 +1,1042 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ * Name index  *
+ ***************/
+ // section 6.1.1 of spec v5
+
+/** Abbreviation of the entry pool, the attributes are a slice of NamesUnit.attrs */
+typedef struct
+{
+        uint64_t code;
+        uint32_t first_attr;
+        uint16_t attr_count;
+        uint16_t tag;
+} NamesAbbrev;
+
+typedef struct
+{
+        uint16_t idx;           // DW_IDX_*
+        uint16_t form;
+} NamesAttr;
+
+/** One name index of .debug_names, the arrays point into the section */
+typedef struct
+{
+        const uint8_t *cus;
+        const uint8_t *local_tus;
+        const uint8_t *buckets;
+        const uint8_t *hashes;
+        const uint8_t *str_offsets;
+        const uint8_t *entry_offsets;
+        const uint8_t *pool;
+        const uint8_t *end;
+        uint32_t cu_count;
+        uint32_t local_tu_count;
+        uint32_t foreign_tu_count;
+        uint32_t bucket_count;
+        uint32_t name_count;
+        uint32_t abbrev_count;
+        uint8_t offset_size;
+        NamesAbbrev *abbrevs;   // sorted by code
+        NamesAttr *attrs;
+} NamesUnit;
+
+/** Name of the scanned units, its entries are a slice of DwrfNameIndex.entries */
+typedef struct
+{
+        uint64_t str;           // offset in the string pool
+        uint64_t first;
+        uint32_t count;
+        uint32_t hash;
+} NamesSlot;
+
+struct DwrfNameIndex
+{
+        /* .debug_names, borrowed from the context */
+        NamesUnit *units;
+        uint32_t unit_count;
+        const DwrfSection *str;
+        uint8_t big;
+
+        /* units the section doesn't cover, indexed by scanning them */
+        char *pool;
+        NamesSlot *slots;
+        uint64_t slot_count;
+        uint32_t *table;        // slot + 1, 0 marks empty buckets
+        uint64_t table_mask;
+        DwrfNameEntry *entries;
+};
+
+/** DJB hash of the case folded name, the hash function of section 7.33 for ASCII names */
+static uint32_t names_hash(const char *name)
+{
+        uint32_t h = 5381;
+
+        for (const uint8_t *p = (const uint8_t *)name; *p; p++)
+        {
+                uint8_t c = *p;
+                if ((c >= 'A') && (c <= 'Z'))
+                        c += 'a' - 'A';
+                h = h * 33 + c;
+        }
+        return h;
+}
+
+/** @return NUL terminated string at offset of the section, NULL if it runs past the end. */
+static const char *names_section_str(const DwrfSection *sec, uint64_t offset)
+{
+        if ((sec->data == NULL) || (offset >= sec->hdr.Size))
+                return NULL;
+
+        if (memchr(sec->data + offset, '\0', (size_t)(sec->hdr.Size - offset)) == NULL)
+                return NULL;
+        return (const char *)sec->data + offset;
+}
+
+/** Accumulates the matches of a lookup */
+typedef struct
+{
+        DwrfNameEntry *entries;
+        uint32_t max;
+        uint32_t count;
+} NamesMatches;
+
+static void names_match(NamesMatches *m, const DwrfNameEntry *e)
+{
+        if (m->count < m->max)
+                m->entries[m->count] = *e;
+        if (m->count < UINT32_MAX)
+                m->count++;
+}
+
+/***************
+ * .debug_names*
+ ***************/
+
+static DwrfResult names_read_form(DwrfBuf *b, uint16_t form, uint8_t offset_size, uint64_t *val)
+{
+        int64_t sval;
+        DwrfResult res;
+
+        switch (form)
+        {
+        case DW_FORM_flag_present:
+                *val = 1;
+                return DWRF_OK;
+        case DW_FORM_data1:
+        case DW_FORM_ref1:
+        case DW_FORM_flag:
+                return buf_uN(b, 1, val);
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+                return buf_uN(b, 2, val);
+        case DW_FORM_data4:
+        case DW_FORM_ref4:
+                return buf_uN(b, 4, val);
+        case DW_FORM_data8:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_sig8:
+                return buf_uN(b, 8, val);
+        case DW_FORM_udata:
+        case DW_FORM_ref_udata:
+                return buf_uleb(b, val);
+        case DW_FORM_sdata:
+                res = buf_sleb(b, &sval);
+                *val = (uint64_t)sval;
+                return res;
+        case DW_FORM_strp:
+        case DW_FORM_sec_offset:
+                return buf_uN(b, offset_size, val);
+        case DW_FORM_data16:
+                *val = 0;
+                return buf_skip(b, 16);
+        default:
+                return DWRF_UNSUPPORTED;
+        }
+}
+
+static int names_abbrev_cmp(const void *a, const void *b)
+{
+        const NamesAbbrev *x = a;
+        const NamesAbbrev *y = b;
+
+        return (x->code > y->code) - (x->code < y->code);
+}
+
+/** Parses the abbreviation table of a name index, section 6.1.1.4.7 */
+static DwrfResult names_read_abbrevs(NamesUnit *u, DwrfBuf b)
+{
+        DwrfBuf scan = b;
+        uint64_t code, tag, idx, form;
+        uint32_t abbrevs = 0, attrs = 0;
+        DwrfResult res;
+
+        /* sizing pass */
+        for (;;)
+        {
+                if ((res = buf_uleb(&scan, &code)))
+                        return res;
+                if (code == 0)
+                        break;
+                if ((res = buf_uleb(&scan, &tag)))
+                        return res;
+                for (;;)
+                {
+                        if ((res = buf_uleb(&scan, &idx)) || (res = buf_uleb(&scan, &form)))
+                                return res;
+                        if ((idx == 0) && (form == 0))
+                                break;
+                        attrs++;
+                }
+                abbrevs++;
+        }
+
+        u->abbrevs = malloc((abbrevs ? abbrevs : 1) * sizeof(NamesAbbrev));
+        u->attrs = malloc((attrs ? attrs : 1) * sizeof(NamesAttr));
+        if ((u->abbrevs == NULL) || (u->attrs == NULL))
+                return DWRF_NO_MEM;
+
+        attrs = 0;
+        for (uint32_t i = 0; i < abbrevs; i++)
+        {
+                NamesAbbrev *a = &u->abbrevs[i];
+
+                buf_uleb(&b, &code);
+                buf_uleb(&b, &tag);
+                *a = (NamesAbbrev){ .code = code, .first_attr = attrs, .tag = (uint16_t)tag };
+                for (;;)
+                {
+                        buf_uleb(&b, &idx);
+                        buf_uleb(&b, &form);
+                        if ((idx == 0) && (form == 0))
+                                break;
+                        if ((idx > UINT16_MAX) || (form > UINT16_MAX) || (a->attr_count == UINT16_MAX))
+                                return DWRF_DECODE_ERR;
+                        u->attrs[attrs++] = (NamesAttr){ (uint16_t)idx, (uint16_t)form };
+                        a->attr_count++;
+                }
+        }
+
+        u->abbrev_count = abbrevs;
+        qsort(u->abbrevs, abbrevs, sizeof(NamesAbbrev), names_abbrev_cmp);
+        return DWRF_OK;
+}
+
+/** Parses the header of the name index at "off" and locates its arrays, section 6.1.1.4.1 */
+static DwrfResult names_read_unit(const InternalDwarfCtx *ctx, uint64_t off, NamesUnit *u, uint64_t *next)
+{
+        const DwrfSection *sec = &ctx->debug_names;
+        DwrfBuf b = buf_make(ctx, sec, off, sec->hdr.Size);
+        uint64_t length, version, padding, val[7], size;
+        uint8_t offset_size = 4;
+        DwrfResult res;
+
+        *u = (NamesUnit){0};
+        if ((res = buf_uN(&b, 4, &length)))
+                return res;
+        if (length == 0xFFFFFFFFu)
+        {
+                offset_size = 8;
+                if ((res = buf_uN(&b, 8, &length)))
+                        return res;
+        }
+        else if (length >= 0xFFFFFFF0u)
+                return DWRF_DECODE_ERR;
+
+        if (length > buf_left(&b))
+                return DWRF_DECODE_ERR;
+        b.end = b.p + length;
+        *next = (uint64_t)(b.end - sec->data);
+
+        if ((res = buf_uN(&b, 2, &version)) || (res = buf_uN(&b, 2, &padding)))
+                return res;
+        if (version != 5)
+                return DWRF_UNSUPPORTED;
+
+        /* CU, local TU and foreign TU counts, buckets, names, abbreviation table and augmentation sizes */
+        for (int i = 0; i < 7; i++)
+        {
+                if ((res = buf_uN(&b, 4, &val[i])))
+                        return res;
+        }
+        if ((res = buf_skip(&b, val[6])))
+                return res;
+
+        *u = (NamesUnit){
+                .cu_count = (uint32_t)val[0],
+                .local_tu_count = (uint32_t)val[1],
+                .foreign_tu_count = (uint32_t)val[2],
+                .bucket_count = (uint32_t)val[3],
+                .name_count = (uint32_t)val[4],
+                .offset_size = offset_size,
+        };
+
+        /* the counts are 32-bit, none of the sizes can overflow */
+        size = ((uint64_t)u->cu_count + u->local_tu_count) * offset_size + (uint64_t)u->foreign_tu_count * 8 +
+               (uint64_t)u->bucket_count * 4 + (u->bucket_count ? (uint64_t)u->name_count * 4 : 0) +
+               (uint64_t)u->name_count * 2 * offset_size + val[5];
+        if (size > buf_left(&b))
+                return DWRF_DECODE_ERR;
+
+        u->cus = b.p;
+        u->local_tus = u->cus + (uint64_t)u->cu_count * offset_size;
+        u->buckets = u->local_tus + (uint64_t)u->local_tu_count * offset_size + (uint64_t)u->foreign_tu_count * 8;
+        u->hashes = u->buckets + (uint64_t)u->bucket_count * 4;
+        u->str_offsets = u->hashes + (u->bucket_count ? (uint64_t)u->name_count * 4 : 0);
+        u->entry_offsets = u->str_offsets + (uint64_t)u->name_count * offset_size;
+        u->pool = u->entry_offsets + (uint64_t)u->name_count * offset_size + val[5];
+        u->end = b.end;
+
+        b.p = u->pool - val[5];
+        b.end = u->pool;
+        return names_read_abbrevs(u, b);
+}
+
+static const NamesAbbrev *names_find_abbrev(const NamesUnit *u, uint64_t code)
+{
+        uint32_t lo = 0, hi = u->abbrev_count;
+
+        while (lo < hi)
+        {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (u->abbrevs[mid].code == code)
+                        return &u->abbrevs[mid];
+                if (u->abbrevs[mid].code < code)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        return NULL;
+}
+
+/** Decodes the entries of the name "i" of the index, section 6.1.1.4.8 */
+static DwrfResult names_read_entries(const DwrfNameIndex *index, const NamesUnit *u, uint32_t i, NamesMatches *m)
+{
+        uint64_t off = load_uN(u->entry_offsets + (uint64_t)i * u->offset_size, u->offset_size, index->big);
+        DwrfBuf b = { u->pool, u->end, index->big };
+        uint64_t code;
+        DwrfResult res;
+
+        if ((res = buf_skip(&b, off)))
+                return res;
+
+        while ((res = buf_uleb(&b, &code)) == DWRF_OK)
+        {
+                const NamesAbbrev *a;
+                uint64_t cu = UINT64_MAX, tu = UINT64_MAX, die = UINT64_MAX, val;
+                DwrfNameEntry e;
+
+                if (code == 0)
+                        return DWRF_OK;
+                if ((a = names_find_abbrev(u, code)) == NULL)
+                        return DWRF_DECODE_ERR;
+
+                for (uint16_t j = 0; j < a->attr_count; j++)
+                {
+                        const NamesAttr *at = &u->attrs[a->first_attr + j];
+
+                        if ((res = names_read_form(&b, at->form, u->offset_size, &val)))
+                                return res;
+                        if (at->idx == DW_IDX_compile_unit)
+                                cu = val;
+                        else if (at->idx == DW_IDX_type_unit)
+                                tu = val;
+                        else if (at->idx == DW_IDX_die_offset)
+                                die = val;
+                }
+
+                /* a single unit may be implied, entries of foreign type units live in other files */
+                if ((tu == UINT64_MAX) && (cu == UINT64_MAX) && (u->cu_count == 1))
+                        cu = 0;
+                if (die == UINT64_MAX)
+                        continue;
+                if (tu != UINT64_MAX)
+                {
+                        if (tu >= u->local_tu_count)
+                                continue;
+                        e.UnitOffset = load_uN(u->local_tus + tu * u->offset_size, u->offset_size, index->big);
+                }
+                else if (cu < u->cu_count)
+                        e.UnitOffset = load_uN(u->cus + cu * u->offset_size, u->offset_size, index->big);
+                else
+                        return DWRF_DECODE_ERR;
+
+                e.DieOffset = e.UnitOffset + die;
+                e.Tag = a->tag;
+                names_match(m, &e);
+        }
+        return res;
+}
+
+static DwrfResult names_find_section(const DwrfNameIndex *index, const NamesUnit *u, const char *name, uint32_t hash,
+                                     NamesMatches *m)
+{
+        uint32_t i, bucket = 0;
+
+        /* without hash table the names are searched linearly */
+        if (u->bucket_count)
+        {
+                bucket = hash % u->bucket_count;
+                i = (uint32_t)load_uN(u->buckets + (uint64_t)bucket * 4, 4, index->big);
+                if (i == 0)
+                        return DWRF_OK;
+                i--;
+        }
+        else
+                i = 0;
+
+        for (; i < u->name_count; i++)
+        {
+                const char *str;
+
+                if (u->bucket_count)
+                {
+                        uint32_t h = (uint32_t)load_uN(u->hashes + (uint64_t)i * 4, 4, index->big);
+                        if (h % u->bucket_count != bucket)
+                                break;
+                        if (h != hash)
+                                continue;
+                }
+
+                str = names_section_str(index->str,
+                                        load_uN(u->str_offsets + (uint64_t)i * u->offset_size, u->offset_size, index->big));
+                if ((str != NULL) && (strcmp(str, name) == 0))
+                        return names_read_entries(index, u, i, m);
+        }
+        return DWRF_OK;
+}
+
+/** Reads every name index of .debug_names and marks the units they cover */
+static DwrfResult names_read_section(InternalDwarfCtx *ctx, DwrfNameIndex *index, DwrfMap *covered)
+{
+        const DwrfSection *sec = &ctx->debug_names;
+        uint64_t off = 0, next;
+        uint32_t cap = 0;
+        DwrfResult res;
+
+        if ((res = dwrf_load_section(ctx, &ctx->debug_names)) || (res = dwrf_load_section(ctx, &ctx->debug_str)))
+                return res;
+
+        index->str = &ctx->debug_str;
+        index->big = (ctx->endianness == ELFDATA2MSB);
+
+        while (off < sec->hdr.Size)
+        {
+                NamesUnit *u;
+
+                if (index->unit_count == cap)
+                {
+                        NamesUnit *units;
+
+                        cap = cap ? cap * 2 : 4;
+                        units = realloc(index->units, cap * sizeof(NamesUnit));
+                        if (units == NULL)
+                                return DWRF_NO_MEM;
+                        index->units = units;
+                }
+
+                u = &index->units[index->unit_count];
+                res = names_read_unit(ctx, off, u, &next);
+                if (res)
+                {
+                        free(u->abbrevs);
+                        free(u->attrs);
+                        return res;
+                }
+                index->unit_count++;
+
+                for (uint32_t i = 0; i < u->cu_count + u->local_tu_count; i++)
+                {
+                        uint64_t unit = load_uN(u->cus + (uint64_t)i * u->offset_size, u->offset_size, index->big);
+                        if ((res = dwrf_map_put(covered, unit, index)))
+                                return res;
+                }
+                off = next;
+        }
+        return DWRF_OK;
+}
+
+/***************
+ *    Scan     *
+ ***************/
+
+/** Name found in a unit, "str" is set once the string pools stop growing */
+typedef struct
+{
+        const char *str;
+        uint64_t off;           // offset in the worker's pool
+        uint32_t hash;
+        uint32_t worker;
+        DwrfNameEntry entry;
+} NamesRaw;
+
+/** DIE named after the declaration or abstract instance it refers to */
+typedef struct
+{
+        uint64_t target;
+        DwrfNameEntry entry;
+} NamesPending;
+
+typedef struct
+{
+        DwrfCtx ctx;            // first for alignment
+        char *pool;
+        uint64_t pool_len;
+        uint64_t pool_cap;
+        NamesRaw *raw;
+        uint64_t raw_count;
+        uint64_t raw_cap;
+        NamesPending *pending;
+        uint64_t pending_count;
+        uint64_t pending_cap;
+} NamesWorker;
+
+typedef struct
+{
+        NamesWorker *workers;
+        const uint64_t *units;
+        DwrfResult *results;
+} NamesJobs;
+
+static DwrfResult names_grow(void **arr, uint64_t *cap, uint64_t need, size_t elem)
+{
+        uint64_t n = *cap ? *cap : 64;
+        void *p;
+
+        while (n < need)
+                n *= 2;
+        if (n == *cap)
+                return DWRF_OK;
+
+        p = realloc(*arr, (size_t)n * elem);
+        if (p == NULL)
+                return DWRF_NO_MEM;
+        *arr = p;
+        *cap = n;
+        return DWRF_OK;
+}
+
+/** Copies the name to the worker's pool, @return its offset plus one so it can be stored in a map */
+static DwrfResult names_intern(NamesWorker *w, const char *str, uint64_t *off)
+{
+        size_t len = strlen(str) + 1;
+        DwrfResult res;
+
+        if ((res = names_grow((void **)&w->pool, &w->pool_cap, w->pool_len + len, 1)))
+                return res;
+
+        memcpy(w->pool + w->pool_len, str, len);
+        *off = w->pool_len + 1;
+        w->pool_len += len;
+        return DWRF_OK;
+}
+
+static DwrfResult names_add(NamesWorker *w, uint32_t worker, uint64_t off, const DwrfNameEntry *e)
+{
+        DwrfResult res;
+
+        if ((res = names_grow((void **)&w->raw, &w->raw_cap, w->raw_count + 1, sizeof(NamesRaw))))
+                return res;
+
+        w->raw[w->raw_count++] = (NamesRaw){
+                .off = off - 1,
+                .hash = names_hash(w->pool + off - 1),
+                .worker = worker,
+                .entry = *e,
+        };
+        return DWRF_OK;
+}
+
+/** @return string of a string class attribute, NULL for other forms */
+static const char *names_attr_str(InternalDwarfCtx *ctx, DwrfCursor *cur, DwrfAttr *attr)
+{
+        if (dwarf_cursor_resolve(cur, attr))
+                return NULL;
+
+        switch (attr->Form)
+        {
+        case DW_FORM_string:
+                return names_section_str(&ctx->debug_info, attr->Value);
+        case DW_FORM_strp:
+                return names_section_str(&ctx->debug_str, attr->Value);
+        case DW_FORM_line_strp:
+                return names_section_str(&ctx->debug_line_str, attr->Value);
+        default:
+                return NULL;
+        }
+}
+
+/** Entities the producers put in .debug_names outside of function bodies, section 6.1.1.1 */
+static int names_indexed_tag(uint16_t tag)
+{
+        switch (tag)
+        {
+        case DW_TAG_array_type:
+        case DW_TAG_atomic_type:
+        case DW_TAG_base_type:
+        case DW_TAG_class_type:
+        case DW_TAG_coarray_type:
+        case DW_TAG_const_type:
+        case DW_TAG_constant:
+        case DW_TAG_dynamic_type:
+        case DW_TAG_enumeration_type:
+        case DW_TAG_enumerator:
+        case DW_TAG_file_type:
+        case DW_TAG_immutable_type:
+        case DW_TAG_interface_type:
+        case DW_TAG_namespace:
+        case DW_TAG_packed_type:
+        case DW_TAG_pointer_type:
+        case DW_TAG_ptr_to_member_type:
+        case DW_TAG_reference_type:
+        case DW_TAG_restrict_type:
+        case DW_TAG_rvalue_reference_type:
+        case DW_TAG_set_type:
+        case DW_TAG_shared_type:
+        case DW_TAG_string_type:
+        case DW_TAG_structure_type:
+        case DW_TAG_subprogram:
+        case DW_TAG_subrange_type:
+        case DW_TAG_subroutine_type:
+        case DW_TAG_template_alias:
+        case DW_TAG_typedef:
+        case DW_TAG_union_type:
+        case DW_TAG_unspecified_type:
+        case DW_TAG_variable:
+        case DW_TAG_volatile_type:
+                return 1;
+        default:
+                return 0;
+        }
+}
+
+static uint64_t names_ref(const DwrfUnitHeader *unit, const DwrfAttr *attr)
+{
+        return (attr->Form == DW_FORM_ref_addr) ? attr->Value : unit->Offset + attr->Value;
+}
+
+/**
+ * Indexes the named DIEs of one unit. Inside function bodies only the inlined
+ * subroutines are indexed, locals and function scoped types are left out.
+ * DIEs that take their name from a declaration (DW_AT_specification) or an abstract
+ * instance (DW_AT_abstract_origin) are resolved once the whole unit has been seen,
+ * references to other units are not followed.
+ */
+static DwrfResult names_scan_unit(NamesWorker *w, uint32_t worker, uint64_t unit_offset)
+{
+        enum { NAME, LINKAGE, DECL, INLINE, SPEC, ORIGIN, COUNT };
+        static const uint16_t attr_names[COUNT] = {
+                DW_AT_name, DW_AT_linkage_name, DW_AT_declaration, DW_AT_inline, DW_AT_specification, DW_AT_abstract_origin
+        };
+        InternalDwarfCtx *ctx = CTX(&w->ctx);
+        DwrfMap named = {0};    // DIE offset -> pool offset + 1 of its name
+        DwrfMap linked = {0};   // DIE offset -> pool offset + 1 of its linkage name
+        DwrfMap refs = {0};     // DIE offset -> DIE it is named after
+        DwrfUnitHeader unit;
+        DwrfCursor cur;
+        DwrfDie die;
+        DwrfAttr attrs[COUNT];
+        uint32_t body = UINT32_MAX;     // depth of the subprogram being walked
+        DwrfResult res;
+
+        w->pending_count = 0;
+        dwarf_cursor_init(&w->ctx, &cur);
+        if ((res = dwarf_cursor_seek_unit(&cur, unit_offset)) || (res = dwarf_cursor_unit(&cur, &unit)))
+                return res;
+
+        /* the unit DIE itself is never indexed */
+        if ((res = dwarf_cursor_next(&cur, &die)))
+                return (res == DWRF_END) ? DWRF_OK : res;
+
+        while ((res = dwarf_cursor_next(&cur, &die)) == DWRF_OK)
+        {
+                DwrfNameEntry e = { die.Offset, die.UnitOffset, die.Tag };
+                const char *name, *linkage;
+                uint64_t off = 0, loff = 0;
+                int skip;
+
+                if (die.UnitOffset != unit_offset)
+                        break;
+
+                if (die.Depth <= body)
+                        body = UINT32_MAX;
+                if ((body != UINT32_MAX) ? (die.Tag != DW_TAG_inlined_subroutine) : !names_indexed_tag(die.Tag))
+                        continue;
+
+                if ((res = dwarf_cursor_get_attrs(&cur, attr_names, COUNT, attrs)))
+                        break;
+                if ((die.Tag == DW_TAG_subprogram) && die.HasChildren && (body == UINT32_MAX))
+                        body = die.Depth;
+
+                name = names_attr_str(ctx, &cur, &attrs[NAME]);
+                linkage = names_attr_str(ctx, &cur, &attrs[LINKAGE]);
+
+                /* declarations and abstract instances are indexed through their concrete DIEs */
+                skip = (attrs[DECL].Form && attrs[DECL].Value) ||
+                       (attrs[INLINE].Form && ((attrs[INLINE].Value == DW_INL_inlined) ||
+                                               (attrs[INLINE].Value == DW_INL_declared_inlined)));
+
+                if ((name == NULL) && (linkage == NULL))
+                {
+                        const DwrfAttr *ref = attrs[SPEC].Form ? &attrs[SPEC] : &attrs[ORIGIN];
+                        uint64_t target;
+
+                        if ((ref->Form == 0) || ((target = names_ref(&unit, ref)) == 0))
+                                continue;
+                        if ((res = dwrf_map_put(&refs, die.Offset, (void *)(uintptr_t)target)))
+                                break;
+                        if (skip)
+                                continue;
+                        if ((res = names_grow((void **)&w->pending, &w->pending_cap, w->pending_count + 1,
+                                              sizeof(NamesPending))))
+                                break;
+                        w->pending[w->pending_count++] = (NamesPending){ target, e };
+                        continue;
+                }
+
+                if (name && (res = names_intern(w, name, &off)))
+                        break;
+                if (linkage && ((name == NULL) || strcmp(name, linkage)) && (res = names_intern(w, linkage, &loff)))
+                        break;
+                if ((die.Tag == DW_TAG_subprogram) || (die.Tag == DW_TAG_variable))
+                {
+                        if ((off && (res = dwrf_map_put(&named, die.Offset, (void *)(uintptr_t)off))) ||
+                            (loff && (res = dwrf_map_put(&linked, die.Offset, (void *)(uintptr_t)loff))))
+                                break;
+                }
+
+                if (skip)
+                        continue;
+                if ((off && (res = names_add(w, worker, off, &e))) || (loff && (res = names_add(w, worker, loff, &e))))
+                        break;
+        }
+
+        if ((res == DWRF_OK) || (res == DWRF_END))
+        {
+                res = DWRF_OK;
+                for (uint64_t i = 0; (i < w->pending_count) && (res == DWRF_OK); i++)
+                {
+                        uint64_t target = w->pending[i].target;
+                        uintptr_t off = 0, loff = 0;
+
+                        /* concrete instance -> abstract instance -> declaration, bounded in case of a cycle */
+                        for (int hops = 0; (hops < 8) && (target != 0); hops++)
+                        {
+                                off = (uintptr_t)dwrf_map_get(&named, target);
+                                loff = (uintptr_t)dwrf_map_get(&linked, target);
+                                if (off || loff)
+                                        break;
+                                target = (uintptr_t)dwrf_map_get(&refs, target);
+                        }
+
+                        if (off)
+                                res = names_add(w, worker, off, &w->pending[i].entry);
+                        if (loff && (res == DWRF_OK))
+                                res = names_add(w, worker, loff, &w->pending[i].entry);
+                }
+        }
+
+        dwrf_map_destroy(&named, NULL);
+        dwrf_map_destroy(&linked, NULL);
+        dwrf_map_destroy(&refs, NULL);
+        return res;
+}
+
+static void names_job(void *arg, uint64_t job, uint32_t worker)
+{
+        NamesJobs *jobs = arg;
+
+        jobs->results[job] = names_scan_unit(&jobs->workers[worker], worker, jobs->units[job]);
+}
+
+static int names_raw_cmp(const void *a, const void *b)
+{
+        const NamesRaw *x = a;
+        const NamesRaw *y = b;
+        int c;
+
+        if (x->hash != y->hash)
+                return (x->hash > y->hash) ? 1 : -1;
+        if ((c = strcmp(x->str, y->str)))
+                return c;
+        if (x->entry.DieOffset != y->entry.DieOffset)
+                return (x->entry.DieOffset > y->entry.DieOffset) ? 1 : -1;
+        return (x->entry.Tag > y->entry.Tag) - (x->entry.Tag < y->entry.Tag);
+}
+
+/**
+ * Builds the hash table of the scanned names. Sorting makes the result independent
+ * of the number of threads and of the order the units were handed out.
+ */
+static DwrfResult names_merge(DwrfNameIndex *index, NamesWorker *workers, uint32_t count)
+{
+        NamesRaw *all;
+        uint64_t total = 0, pool_len = 0, n = 0, cap;
+
+        for (uint32_t i = 0; i < count; i++)
+                total += workers[i].raw_count;
+        if (total == 0)
+                return DWRF_OK;
+
+        all = malloc((size_t)total * sizeof(NamesRaw));
+        if (all == NULL)
+                return DWRF_NO_MEM;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+                for (uint64_t j = 0; j < workers[i].raw_count; j++)
+                {
+                        all[n] = workers[i].raw[j];
+                        all[n].str = workers[i].pool + all[n].off;
+                        n++;
+                }
+        }
+        qsort(all, (size_t)total, sizeof(NamesRaw), names_raw_cmp);
+
+        /* one slot and one copy of the string per distinct name */
+        for (uint64_t i = 0; i < total; i++)
+        {
+                if ((i == 0) || (all[i].hash != all[i - 1].hash) || strcmp(all[i].str, all[i - 1].str))
+                {
+                        index->slot_count++;
+                        pool_len += strlen(all[i].str) + 1;
+                }
+        }
+
+        for (cap = 16; cap < index->slot_count * 2; cap *= 2)
+                ;
+
+        index->pool = malloc((size_t)pool_len);
+        index->slots = malloc((size_t)index->slot_count * sizeof(NamesSlot));
+        index->entries = malloc((size_t)total * sizeof(DwrfNameEntry));
+        index->table = calloc((size_t)cap, sizeof(uint32_t));
+        if ((index->pool == NULL) || (index->slots == NULL) || (index->entries == NULL) || (index->table == NULL) ||
+            (index->slot_count >= UINT32_MAX))
+        {
+                free(all);
+                return DWRF_NO_MEM;
+        }
+        index->table_mask = cap - 1;
+
+        pool_len = 0;
+        n = 0;
+        for (uint64_t i = 0; i < total; i++)
+        {
+                NamesSlot *s = &index->slots[n ? n - 1 : 0];
+
+                if ((i == 0) || (all[i].hash != all[i - 1].hash) || strcmp(all[i].str, all[i - 1].str))
+                {
+                        size_t len = strlen(all[i].str) + 1;
+                        uint64_t h;
+
+                        s = &index->slots[n];
+                        *s = (NamesSlot){ .str = pool_len, .first = i, .count = 0, .hash = all[i].hash };
+                        memcpy(index->pool + pool_len, all[i].str, len);
+                        pool_len += len;
+
+                        /* linear probing */
+                        for (h = s->hash & index->table_mask; index->table[h]; h = (h + 1) & index->table_mask)
+                                ;
+                        index->table[h] = (uint32_t)(n + 1);
+                        n++;
+                }
+
+                index->entries[i] = all[i].entry;
+                s->count++;
+        }
+
+        free(all);
+        return DWRF_OK;
+}
+
+static DwrfResult names_find_scanned(const DwrfNameIndex *index, const char *name, uint32_t hash, NamesMatches *m)
+{
+        if (index->table == NULL)
+                return DWRF_OK;
+
+        for (uint64_t h = hash & index->table_mask; index->table[h]; h = (h + 1) & index->table_mask)
+        {
+                const NamesSlot *s = &index->slots[index->table[h] - 1];
+
+                if ((s->hash == hash) && (strcmp(index->pool + s->str, name) == 0))
+                {
+                        for (uint32_t i = 0; i < s->count; i++)
+                                names_match(m, &index->entries[s->first + i]);
+                        break;
+                }
+        }
+        return DWRF_OK;
+}
+
+/** Indexes the units in parallel, each thread works on its own copy of the context */
+static DwrfResult names_scan(InternalDwarfCtx *ctx, DwrfNameIndex *index, const uint64_t *units, uint64_t count,
+                             uint32_t threads)
+{
+        NamesJobs jobs = { .units = units };
+        uint32_t workers = dwrf_worker_count(threads, count);
+        DwrfResult res;
+
+        if ((res = dwrf_prepare_workers(ctx)))
+                return res;
+
+        jobs.workers = calloc(workers, sizeof(NamesWorker));
+        jobs.results = calloc((size_t)count, sizeof(DwrfResult));
+        if ((jobs.workers == NULL) || (jobs.results == NULL))
+        {
+                free(jobs.workers);
+                free(jobs.results);
+                return DWRF_NO_MEM;
+        }
+
+        for (uint32_t i = 0; i < workers; i++)
+                dwrf_worker_ctx(ctx, &jobs.workers[i].ctx);
+
+        dwrf_run_jobs(workers, count, names_job, &jobs);
+
+        /* report the error of the first failing unit so the result doesn't depend on scheduling */
+        for (uint64_t i = 0; (i < count) && (res == DWRF_OK); i++)
+                res = jobs.results[i];
+
+        if (res == DWRF_OK)
+                res = names_merge(index, jobs.workers, workers);
+
+        for (uint32_t i = 0; i < workers; i++)
+        {
+                dwrf_worker_join(ctx, &jobs.workers[i].ctx);
+                free(jobs.workers[i].pool);
+                free(jobs.workers[i].raw);
+                free(jobs.workers[i].pending);
+        }
+        free(jobs.workers);
+        free(jobs.results);
+        return res;
+}
+
+/***************
+ *     API     *
+ ***************/
+
+DwrfResult dwarf_name_index_build(DwrfCtx *ctx, uint32_t threads, DwrfNameIndex **index)
+{
+        DwrfNameIndex *idx;
+        DwrfMap covered = {0};
+        DwrfUnitHeader unit;
+        uint64_t *units = NULL, count = 0, cap = 0, off = 0;
+        DwrfResult res = DWRF_OK;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (index == NULL)
+                return DWRF_BAD_ARG;
+
+        idx = calloc(1, sizeof(DwrfNameIndex));
+        if (idx == NULL)
+                return DWRF_NO_MEM;
+
+        if (CTX(ctx)->debug_names.present)
+                res = names_read_section(CTX(ctx), idx, &covered);
+
+        /* units left out of .debug_names, all of them when the section is missing */
+        while ((res == DWRF_OK) && ((res = dwarf_get_unit_header(ctx, off, &unit)) == DWRF_OK))
+        {
+                off = unit.NextOffset;
+                if (dwrf_map_get(&covered, unit.Offset) != NULL)
+                        continue;
+
+                if ((res = names_grow((void **)&units, &cap, count + 1, sizeof(uint64_t))))
+                        break;
+                units[count++] = unit.Offset;
+        }
+
+        /* BAD_ARG marks the end of the section */
+        if (res == DWRF_BAD_ARG)
+                res = count ? names_scan(CTX(ctx), idx, units, count, threads) : DWRF_OK;
+
+        dwrf_map_destroy(&covered, NULL);
+        free(units);
+        if (res)
+        {
+                dwarf_name_index_destroy(idx);
+                return res;
+        }
+
+        *index = idx;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_name_index_find(const DwrfNameIndex *index, const char *name, DwrfNameEntry *entries, uint32_t max,
+                                 uint32_t *count)
+{
+        NamesMatches m = { entries, max, 0 };
+        uint32_t hash;
+        DwrfResult res;
+
+        if ((index == NULL) || (name == NULL) || (count == NULL) || ((entries == NULL) && (max != 0)))
+                return DWRF_BAD_ARG;
+
+        hash = names_hash(name);
+        for (uint32_t i = 0; i < index->unit_count; i++)
+        {
+                if ((res = names_find_section(index, &index->units[i], name, hash, &m)))
+                        return res;
+        }
+        names_find_scanned(index, name, hash, &m);
+
+        *count = m.count;
+        if (m.count == 0)
+                return DWRF_NOT_FOUND;
+        return (m.count > max) ? DWRF_BUFFER_OVERFLOW : DWRF_OK;
+}
+
+DwrfResult dwarf_name_index_size(const DwrfNameIndex *index, uint64_t *names)
+{
+        if ((index == NULL) || (names == NULL))
+                return DWRF_BAD_ARG;
+
+        *names = index->slot_count;
+        for (uint32_t i = 0; i < index->unit_count; i++)
+                *names += index->units[i].name_count;
+        return DWRF_OK;
+}
+
+void dwarf_name_index_destroy(DwrfNameIndex *index)
+{
+        if (index == NULL)
+                return;
+
+        for (uint32_t i = 0; i < index->unit_count; i++)
+        {
+                free(index->units[i].abbrevs);
+                free(index->units[i].attrs);
+        }
+        free(index->units);
+        free(index->pool);
+        free(index->slots);
+        free(index->table);
+        free(index->entries);
+        free(index);
+}
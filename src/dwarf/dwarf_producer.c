@@ -0,0 +1,1317 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+#include "dwarf_producer.h"
+
+/***************
+ *  Producer   *
+ ***************/
+ // sections 6.2.4 (line program header), 6.2.5 (line program), 7.5 (DIE encoding) of spec v5
+
+#define PROD_OPCODE_BASE 13u                    // standard opcodes of DWARF 5
+#define PROD_ROW_MAX     64u                    // bytes one row can take in a line program
+#define PROD_FORWARD     (1ULL << 63)           // DwrfDieRef bit of forward references
+#define PROD_UNBOUND     UINT64_MAX
+#define PROD_MAX_OFFSET  0xFFFFFFF0ULL          // 32-bit DWARF
+
+/* line program parameters the builder tries when the caller leaves the choice to it */
+#define PROD_TUNE_BASE_MIN  (-12)
+#define PROD_TUNE_RANGE_MAX 32
+#define PROD_TUNE_ADV       256u                // address advances and line deltas counted for the choice
+#define PROD_TUNE_LINES     64
+
+static const char *const prod_names[DWRF_PROD_SECTION_COUNT] = {
+        ".debug_info", ".debug_abbrev", ".debug_line", ".debug_str", ".debug_line_str",
+};
+
+static const uint8_t std_opcode_lengths[PROD_OPCODE_BASE - 1] = { 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 };
+
+typedef struct
+{
+        uint8_t *data;
+        uint64_t size;
+        uint64_t cap;
+} ProdBuf;
+
+/** Strings of a section, each one stored once */
+typedef struct
+{
+        uint32_t *slots;        // offset + 1, 0 if empty
+        uint64_t slot_count;
+        uint64_t count;
+} ProdStrings;
+
+typedef struct
+{
+        uint64_t hash;
+        uint64_t first;         // specs
+        uint32_t count;
+        uint16_t tag;
+        uint8_t children;
+} ProdAbbrev;
+
+typedef struct
+{
+        uint64_t start;
+        uint64_t end;
+} ProdUnit;
+
+/** Reference to a DIE not added yet, patched by dwarf_producer_finish() */
+typedef struct
+{
+        uint64_t at;            // offset of the value in .debug_info
+        uint64_t unit;
+        uint64_t forward;
+        uint16_t form;
+} ProdFixup;
+
+struct DwrfProducer
+{
+        ProdBuf secs[DWRF_PROD_SECTION_COUNT];
+        ProdStrings str;
+        ProdStrings line_str;
+
+        ProdAbbrev *abbrevs;
+        DwrfAbbrevSpec *specs;
+        uint32_t *abbrev_slots; // code of each abbreviation, 0 if empty
+        uint64_t abbrev_count;
+        uint64_t abbrev_cap;
+        uint64_t spec_count;
+        uint64_t spec_cap;
+        uint64_t abbrev_slot_count;
+
+        ProdUnit *units;
+        uint64_t *forwards;     // DIE each forward reference is bound to
+        ProdFixup *fixups;
+        uint64_t unit_count;
+        uint64_t unit_cap;
+        uint64_t forward_count;
+        uint64_t forward_cap;
+        uint64_t fixup_count;
+        uint64_t fixup_cap;
+
+        uint64_t depth;         // DIEs of the open unit whose children aren't ended
+        uint8_t unit_open;
+        uint8_t finished;
+        uint8_t address_size;
+        uint8_t big;
+};
+
+/** Grows an array to hold at least "need" elements */
+static int prod_reserve(void **data, uint64_t *cap, uint64_t need, size_t elem)
+{
+        uint64_t n;
+        void *p;
+
+        if (need <= *cap)
+                return true;
+
+        n = *cap ? *cap * 2 : 64;
+        while (n < need)
+                n *= 2;
+        if (n > SIZE_MAX / elem)
+                return false;
+
+        p = realloc(*data, (size_t)n * elem);
+        if (p == NULL)
+                return false;
+        *data = p;
+        *cap = n;
+        return true;
+}
+
+/** Room for n more bytes at the end of the buffer, NULL on failure */
+static inline uint8_t *out_reserve(ProdBuf *b, uint64_t n)
+{
+        if ((b->size + n > b->cap) && !prod_reserve((void **)&b->data, &b->cap, b->size + n, 1))
+                return NULL;
+        return b->data + b->size;
+}
+
+static inline uint8_t *put_uN(uint8_t *p, uint64_t v, uint8_t size, uint8_t big)
+{
+        for (uint8_t i = 0; i < size; i++)
+                p[big ? size - 1 - i : i] = (uint8_t)(v >> (8 * i));
+        return p + size;
+}
+
+static int out_uN(ProdBuf *b, uint64_t v, uint8_t size, uint8_t big)
+{
+        uint8_t *p = out_reserve(b, size);
+
+        if (p == NULL)
+                return false;
+        put_uN(p, v, size, big);
+        b->size += size;
+        return true;
+}
+
+static int out_bytes(ProdBuf *b, const void *data, uint64_t size)
+{
+        uint8_t *p = out_reserve(b, size);
+
+        if (p == NULL)
+                return false;
+        if (size)
+                memcpy(p, data, (size_t)size);
+        b->size += size;
+        return true;
+}
+
+static int out_uleb(ProdBuf *b, uint64_t v)
+{
+        uint8_t *p = out_reserve(b, DWRF_LEB_MAX_BYTES);
+
+        if (p == NULL)
+                return false;
+        b->size += dwarf_encode_uleb128(v, p);
+        return true;
+}
+
+static int out_sleb(ProdBuf *b, int64_t v)
+{
+        uint8_t *p = out_reserve(b, DWRF_LEB_MAX_BYTES);
+
+        if (p == NULL)
+                return false;
+        b->size += dwarf_encode_sleb128(v, p);
+        return true;
+}
+
+static uint64_t prod_hash(uint64_t h, const void *data, size_t size)
+{
+        const uint8_t *p = data;
+
+        for (size_t i = 0; i < size; i++)
+                h = (h ^ p[i]) * 0x100000001b3ULL;
+        return h;
+}
+
+/***************
+ *   Strings   *
+ ***************/
+
+/** Offset of "str" in the string section, added if it isn't there yet */
+static DwrfResult prod_string(ProdStrings *s, ProdBuf *sec, const char *str, uint64_t *offset)
+{
+        size_t len;
+        uint64_t mask, at;
+
+        if (str == NULL)
+                return DWRF_BAD_ARG;
+
+        if (2 * (s->count + 1) > s->slot_count)
+        {
+                uint64_t count = s->slot_count ? 2 * s->slot_count : 256;
+                uint32_t *slots = calloc((size_t)count, sizeof(uint32_t));
+
+                if (slots == NULL)
+                        return DWRF_NO_MEM;
+
+                for (uint64_t i = 0; i < s->slot_count; i++)
+                {
+                        const char *old = (const char *)sec->data + s->slots[i] - 1;
+
+                        if (s->slots[i] == 0)
+                                continue;
+                        at = prod_hash(0xcbf29ce484222325ULL, old, strlen(old)) & (count - 1);
+                        while (slots[at])
+                                at = (at + 1) & (count - 1);
+                        slots[at] = s->slots[i];
+                }
+                free(s->slots);
+                s->slots = slots;
+                s->slot_count = count;
+        }
+
+        len = strlen(str);
+        mask = s->slot_count - 1;
+        for (at = prod_hash(0xcbf29ce484222325ULL, str, len) & mask; s->slots[at]; at = (at + 1) & mask)
+        {
+                const char *old = (const char *)sec->data + s->slots[at] - 1;
+
+                if ((strncmp(old, str, len) == 0) && (old[len] == '\0'))
+                {
+                        *offset = s->slots[at] - 1;
+                        return DWRF_OK;
+                }
+        }
+
+        if (sec->size + len + 1 > PROD_MAX_OFFSET)
+                return DWRF_UNSUPPORTED;
+
+        *offset = sec->size;
+        if (!out_bytes(sec, str, len + 1))
+                return DWRF_NO_MEM;
+        s->slots[at] = (uint32_t)*offset + 1;
+        s->count++;
+        return DWRF_OK;
+}
+
+/***************
+ *   Abbrevs   *
+ ***************/
+
+static int prod_form_ok(uint16_t form)
+{
+        switch (form)
+        {
+        case DW_FORM_addr:
+        case DW_FORM_block2:
+        case DW_FORM_block4:
+        case DW_FORM_data2:
+        case DW_FORM_data4:
+        case DW_FORM_data8:
+        case DW_FORM_string:
+        case DW_FORM_block:
+        case DW_FORM_block1:
+        case DW_FORM_data1:
+        case DW_FORM_flag:
+        case DW_FORM_sdata:
+        case DW_FORM_strp:
+        case DW_FORM_udata:
+        case DW_FORM_ref_addr:
+        case DW_FORM_ref1:
+        case DW_FORM_ref2:
+        case DW_FORM_ref4:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_udata:
+        case DW_FORM_sec_offset:
+        case DW_FORM_exprloc:
+        case DW_FORM_flag_present:
+        case DW_FORM_data16:
+        case DW_FORM_line_strp:
+        case DW_FORM_implicit_const:
+                return true;
+        default:
+                return false;
+        }
+}
+
+static int prod_abbrev_eq(const DwrfProducer *p, const ProdAbbrev *a, uint16_t tag, uint8_t children,
+                          const DwrfAbbrevSpec *specs, uint32_t count)
+{
+        if ((a->tag != tag) || (a->children != children) || (a->count != count))
+                return false;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+                const DwrfAbbrevSpec *s = &p->specs[a->first + i];
+
+                if ((s->Name != specs[i].Name) || (s->Form != specs[i].Form) ||
+                    ((s->Form == DW_FORM_implicit_const) && (s->ImplicitConst != specs[i].ImplicitConst)))
+                        return false;
+        }
+        return true;
+}
+
+static DwrfResult prod_abbrev_slots(DwrfProducer *p)
+{
+        uint64_t count = p->abbrev_slot_count ? 2 * p->abbrev_slot_count : 256;
+        uint32_t *slots = calloc((size_t)count, sizeof(uint32_t));
+
+        if (slots == NULL)
+                return DWRF_NO_MEM;
+
+        for (uint64_t i = 0; i < p->abbrev_count; i++)
+        {
+                uint64_t at = p->abbrevs[i].hash & (count - 1);
+
+                while (slots[at])
+                        at = (at + 1) & (count - 1);
+                slots[at] = (uint32_t)i + 1;
+        }
+        free(p->abbrev_slots);
+        p->abbrev_slots = slots;
+        p->abbrev_slot_count = count;
+        return DWRF_OK;
+}
+
+/***************
+ *    DIEs     *
+ ***************/
+
+static DwrfResult prod_ref(DwrfProducer *p, uint16_t form, uint64_t ref, uint8_t *size, uint64_t *value)
+{
+        const ProdUnit *unit = &p->units[p->unit_count - 1];
+        uint64_t here = p->secs[DWRF_PROD_INFO].size;
+
+        switch (form)
+        {
+        case DW_FORM_ref1:
+                *size = 1;
+                break;
+        case DW_FORM_ref2:
+                *size = 2;
+                break;
+        case DW_FORM_ref4:
+        case DW_FORM_ref_addr:
+                *size = 4;
+                break;
+        case DW_FORM_ref8:
+                *size = 8;
+                break;
+        default:
+                *size = 0;      // ref_udata
+                break;
+        }
+
+        if (ref & PROD_FORWARD)
+        {
+                ProdFixup *f;
+
+                if ((*size == 0) || ((ref & ~PROD_FORWARD) >= p->forward_count))
+                        return DWRF_BAD_ARG;
+                if (!prod_reserve((void **)&p->fixups, &p->fixup_cap, p->fixup_count + 1, sizeof(ProdFixup)))
+                        return DWRF_NO_MEM;
+
+                f = &p->fixups[p->fixup_count++];
+                *f = (ProdFixup){ here, p->unit_count - 1, ref & ~PROD_FORWARD, form };
+                *value = 0;
+                return DWRF_OK;
+        }
+
+        if (ref >= here)
+                return DWRF_BAD_ARG;
+        if (form == DW_FORM_ref_addr)
+        {
+                *value = ref;
+                return DWRF_OK;
+        }
+
+        /* the other forms are relative to the unit */
+        if (ref < unit->start)
+                return DWRF_BAD_ARG;
+        *value = ref - unit->start;
+        if ((*size != 0) && (*size < 8) && (*value >> (8 * *size)))
+                return DWRF_BAD_ARG;
+        return DWRF_OK;
+}
+
+static DwrfResult prod_value(DwrfProducer *p, const DwrfAbbrevSpec *spec, const DwrfValue *v)
+{
+        ProdBuf *info = &p->secs[DWRF_PROD_INFO];
+        uint64_t val = v->Value, len;
+        uint8_t size = 0;
+        DwrfResult res;
+
+        switch (spec->Form)
+        {
+        case DW_FORM_implicit_const:
+        case DW_FORM_flag_present:
+                return DWRF_OK;
+        case DW_FORM_addr:
+                size = p->address_size;
+                break;
+        case DW_FORM_data1:
+        case DW_FORM_flag:
+                size = 1;
+                if (spec->Form == DW_FORM_flag)
+                        val = (val != 0);
+                break;
+        case DW_FORM_data2:
+                size = 2;
+                break;
+        case DW_FORM_data4:
+        case DW_FORM_sec_offset:
+                size = 4;
+                break;
+        case DW_FORM_data8:
+                size = 8;
+                break;
+        case DW_FORM_udata:
+                return out_uleb(info, val) ? DWRF_OK : DWRF_NO_MEM;
+        case DW_FORM_sdata:
+                return out_sleb(info, (int64_t)val) ? DWRF_OK : DWRF_NO_MEM;
+        case DW_FORM_strp:
+        case DW_FORM_line_strp:
+                if (spec->Form == DW_FORM_strp)
+                        res = prod_string(&p->str, &p->secs[DWRF_PROD_STR], v->Data, &val);
+                else
+                        res = prod_string(&p->line_str, &p->secs[DWRF_PROD_LINE_STR], v->Data, &val);
+                if (res)
+                        return res;
+                size = 4;
+                break;
+        case DW_FORM_string:
+                if (v->Data == NULL)
+                        return DWRF_BAD_ARG;
+                return out_bytes(info, v->Data, strlen(v->Data) + 1) ? DWRF_OK : DWRF_NO_MEM;
+        case DW_FORM_data16:
+                if (v->Data == NULL)
+                        return DWRF_BAD_ARG;
+                return out_bytes(info, v->Data, 16) ? DWRF_OK : DWRF_NO_MEM;
+        case DW_FORM_block1:
+        case DW_FORM_block2:
+        case DW_FORM_block4:
+        case DW_FORM_block:
+        case DW_FORM_exprloc:
+                len = v->Value;
+                if ((len != 0) && (v->Data == NULL))
+                        return DWRF_BAD_ARG;
+                if (spec->Form == DW_FORM_block1)
+                        size = 1;
+                else if (spec->Form == DW_FORM_block2)
+                        size = 2;
+                else if (spec->Form == DW_FORM_block4)
+                        size = 4;
+
+                if (size == 0)
+                {
+                        if (!out_uleb(info, len))
+                                return DWRF_NO_MEM;
+                }
+                else if ((len >> (8 * size)) || !out_uN(info, len, size, p->big))
+                        return (len >> (8 * size)) ? DWRF_BAD_ARG : DWRF_NO_MEM;
+                return out_bytes(info, v->Data, len) ? DWRF_OK : DWRF_NO_MEM;
+        default:
+                if ((res = prod_ref(p, spec->Form, v->Value, &size, &val)))
+                        return res;
+                if (size == 0)
+                        return out_uleb(info, val) ? DWRF_OK : DWRF_NO_MEM;
+                break;
+        }
+
+        if ((size < 8) && (val >> (8 * size)))
+                return DWRF_BAD_ARG;
+        return out_uN(info, val, size, p->big) ? DWRF_OK : DWRF_NO_MEM;
+}
+
+/***************
+ *    Lines    *
+ ***************/
+
+typedef struct
+{
+        int8_t line_base;
+        uint8_t line_range;
+        uint8_t const_adv;      // operation advance of DW_LNS_const_add_pc
+} LineParams;
+
+typedef struct
+{
+        uint64_t address;
+        uint32_t file;
+        uint32_t line;
+        uint16_t column;
+        uint8_t is_stmt;
+        uint8_t in_seq;
+} LineState;
+
+typedef struct
+{
+        uint64_t path;          // offset in .debug_line_str
+        uint64_t dir;
+} LineFile;
+
+struct DwrfLineProgram
+{
+        DwrfProducer *prod;
+        ProdBuf ops;            // encoded program
+        DwrfLineRow *rows;      // rows kept until the parameters are chosen
+        uint64_t row_count;
+        uint64_t row_cap;
+        uint64_t *dirs;         // offsets in .debug_line_str
+        LineFile *files;
+        uint64_t dir_count;
+        uint64_t dir_cap;
+        uint64_t file_count;
+        uint64_t file_cap;
+        LineState state;
+        LineParams params;
+        uint8_t min_inst;
+        uint8_t default_is_stmt;
+        uint8_t tune;           // parameters chosen from the rows
+};
+
+static inline LineParams line_params(int8_t line_base, uint8_t line_range)
+{
+        return (LineParams){ line_base, line_range, (uint8_t)((255 - PROD_OPCODE_BASE) / line_range) };
+}
+
+static inline void line_reset(DwrfLineProgram *lp)
+{
+        lp->state = (LineState){ 0, 1, 1, 0, lp->default_is_stmt, false };
+}
+
+/** Operation advance of a special opcode with line delta "dl", the delta must be in range */
+static inline uint64_t line_room(const LineParams *pp, int64_t dl)
+{
+        return (255 - PROD_OPCODE_BASE - (uint64_t)(dl - pp->line_base)) / pp->line_range;
+}
+
+/**
+ * Size of the opcodes adding a row "adv" operations and "dl" lines after the previous one. A special
+ * opcode always ends the row, the line goes into it when it fits and the part of the advance it can't
+ * carry goes into a DW_LNS_const_add_pc when that is enough or a DW_LNS_advance_pc otherwise.
+ */
+static inline uint32_t line_cost(const LineParams *pp, uint64_t adv, int64_t dl)
+{
+        uint32_t cost = 1;
+        uint64_t room;
+
+        if ((dl < pp->line_base) || (dl >= pp->line_base + pp->line_range))
+        {
+                cost += 1 + dwarf_sleb128_size(dl);
+                dl = 0;
+        }
+
+        room = line_room(pp, dl);
+        if (adv > room)
+        {
+                if ((adv >= pp->const_adv) && (adv - pp->const_adv <= room))
+                        cost += 1;
+                else
+                        cost += 1 + dwarf_uleb128_size(adv - room);
+        }
+        return cost;
+}
+
+/** Writes the opcodes line_cost() counts */
+static inline uint8_t *line_advance(const LineParams *pp, uint8_t *p, uint64_t adv, int64_t dl)
+{
+        uint64_t room;
+
+        if ((dl < pp->line_base) || (dl >= pp->line_base + pp->line_range))
+        {
+                *p++ = DW_LNS_advance_line;
+                p += dwarf_encode_sleb128(dl, p);
+                dl = 0;
+        }
+
+        room = line_room(pp, dl);
+        if (adv > room)
+        {
+                if ((adv >= pp->const_adv) && (adv - pp->const_adv <= room))
+                {
+                        *p++ = DW_LNS_const_add_pc;
+                        adv -= pp->const_adv;
+                }
+                else
+                {
+                        *p++ = DW_LNS_advance_pc;
+                        p += dwarf_encode_uleb128(adv - room, p);
+                        adv = room;
+                }
+        }
+
+        *p++ = (uint8_t)((uint64_t)(dl - pp->line_base) + pp->line_range * adv + PROD_OPCODE_BASE);
+        return p;
+}
+
+/**
+ * Operation advance from the current address to the row's, writing DW_LNE_set_address or
+ * DW_LNS_fixed_advance_pc first when the advance can't be expressed in operations.
+ */
+static inline uint8_t *line_address(DwrfLineProgram *lp, uint8_t *p, uint64_t address, uint64_t *adv)
+{
+        uint8_t size = lp->prod->address_size;
+        uint64_t delta = address - lp->state.address;
+
+        lp->state.address = address;
+        *adv = 0;
+
+        if (lp->state.in_seq && (lp->min_inst == 1))
+                *adv = delta;
+        else if (lp->state.in_seq && ((delta % lp->min_inst) == 0))
+                *adv = delta / lp->min_inst;
+        else if (lp->state.in_seq && (delta <= 0xFFFF))
+        {
+                *p++ = DW_LNS_fixed_advance_pc;
+                p = put_uN(p, delta, 2, lp->prod->big);
+        }
+        else
+        {
+                *p++ = 0;
+                *p++ = (uint8_t)(1 + size);
+                *p++ = DW_LNE_set_address;
+                p = put_uN(p, address, size, lp->prod->big);
+                lp->state.in_seq = true;
+        }
+        return p;
+}
+
+/** Appends the opcodes of one row, the program must have room for PROD_ROW_MAX more bytes */
+static DwrfResult line_encode(DwrfLineProgram *lp, const DwrfLineRow *row)
+{
+        LineState *s = &lp->state;
+        uint8_t *start = lp->ops.data + lp->ops.size, *p = start;
+        uint64_t adv;
+
+        if (s->in_seq && (row->Address < s->address))
+                return DWRF_BAD_ARG;
+        if ((lp->prod->address_size == 4) && (row->Address > UINT32_MAX))
+                return DWRF_BAD_ARG;
+
+        p = line_address(lp, p, row->Address, &adv);
+
+        if (row->Flags & DWRF_LINE_END_SEQUENCE)
+        {
+                if (adv == lp->params.const_adv)
+                        *p++ = DW_LNS_const_add_pc;
+                else if (adv)
+                {
+                        *p++ = DW_LNS_advance_pc;
+                        p += dwarf_encode_uleb128(adv, p);
+                }
+                *p++ = 0;
+                *p++ = 1;
+                *p++ = DW_LNE_end_sequence;
+                lp->ops.size += (uint64_t)(p - start);
+                line_reset(lp);
+                return DWRF_OK;
+        }
+
+        if (row->File != s->file)
+        {
+                *p++ = DW_LNS_set_file;
+                p += dwarf_encode_uleb128(row->File, p);
+                s->file = row->File;
+        }
+        if (row->Column != s->column)
+        {
+                *p++ = DW_LNS_set_column;
+                p += dwarf_encode_uleb128(row->Column, p);
+                s->column = row->Column;
+        }
+        if (!(row->Flags & DWRF_LINE_IS_STMT) != !s->is_stmt)
+        {
+                *p++ = DW_LNS_negate_stmt;
+                s->is_stmt = !s->is_stmt;
+        }
+        if (row->Flags & DWRF_LINE_BASIC_BLOCK)
+                *p++ = DW_LNS_set_basic_block;
+        if (row->Flags & DWRF_LINE_PROLOGUE_END)
+                *p++ = DW_LNS_set_prologue_end;
+        if (row->Flags & DWRF_LINE_EPILOGUE_BEGIN)
+                *p++ = DW_LNS_set_epilogue_begin;
+
+        p = line_advance(&lp->params, p, adv, (int64_t)row->Line - (int64_t)s->line);
+        s->line = row->Line;
+        lp->ops.size += (uint64_t)(p - start);
+        return DWRF_OK;
+}
+
+static DwrfResult line_encode_rows(DwrfLineProgram *lp, const DwrfLineRow *rows, uint64_t count)
+{
+        DwrfResult res;
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+                if (out_reserve(&lp->ops, PROD_ROW_MAX) == NULL)
+                        return DWRF_NO_MEM;
+                if ((res = line_encode(lp, &rows[i])))
+                        return res;
+        }
+        return DWRF_OK;
+}
+
+static uint64_t line_tune_cost(const LineParams *pp, const uint32_t *hist, const uint32_t *cells, uint64_t count)
+{
+        uint64_t cost = 0;
+
+        for (uint64_t c = 0; c < count; c++)
+        {
+                uint64_t adv = cells[c] / PROD_TUNE_LINES;
+                int64_t dl = (int64_t)(cells[c] % PROD_TUNE_LINES) - PROD_TUNE_LINES / 2;
+
+                cost += (uint64_t)hist[cells[c]] * line_cost(pp, adv, dl);
+        }
+        return cost;
+}
+
+/**
+ * Picks the line base and range giving the smallest program: the rows are reduced to a histogram
+ * of their (address advance, line delta) pairs and every candidate is costed on its non empty cells.
+ * Rows outside the histogram cost about the same whatever the parameters and are left out.
+ */
+static DwrfResult line_tune(DwrfLineProgram *lp)
+{
+        uint32_t *hist = calloc(PROD_TUNE_ADV * PROD_TUNE_LINES, sizeof(uint32_t));
+        uint32_t *cells = malloc(PROD_TUNE_ADV * PROD_TUNE_LINES * sizeof(uint32_t));
+        uint64_t cell_count = 0, best_cost, prev = 0;
+        uint32_t line = 1;
+        uint8_t in_seq = false;
+        LineParams best = line_params(-5, 14);
+
+        if ((hist == NULL) || (cells == NULL))
+        {
+                free(hist);
+                free(cells);
+                return DWRF_NO_MEM;
+        }
+
+        for (uint64_t i = 0; i < lp->row_count; i++)
+        {
+                const DwrfLineRow *row = &lp->rows[i];
+                uint64_t delta = row->Address - prev, adv = 0;
+                int64_t dl = (int64_t)row->Line - line;
+
+                if (in_seq && (row->Address >= prev) && ((delta % lp->min_inst) == 0))
+                        adv = delta / lp->min_inst;
+                prev = row->Address;
+                line = row->Line;
+                in_seq = true;
+
+                if (row->Flags & DWRF_LINE_END_SEQUENCE)
+                {
+                        line = 1;
+                        in_seq = false;
+                }
+                else if ((adv < PROD_TUNE_ADV) && (dl >= -PROD_TUNE_LINES / 2) && (dl < PROD_TUNE_LINES / 2))
+                {
+                        uint32_t cell = (uint32_t)(adv * PROD_TUNE_LINES + (uint64_t)(dl + PROD_TUNE_LINES / 2));
+
+                        if (hist[cell]++ == 0)
+                                cells[cell_count++] = cell;
+                }
+        }
+
+        /* the default parameters are only replaced by strictly better ones */
+        best_cost = line_tune_cost(&best, hist, cells, cell_count);
+        for (int base = 0; base >= PROD_TUNE_BASE_MIN; base--)
+        {
+                for (int range = 1 - base; range <= PROD_TUNE_RANGE_MAX; range++)
+                {
+                        LineParams pp = line_params((int8_t)base, (uint8_t)range);
+                        uint64_t cost = line_tune_cost(&pp, hist, cells, cell_count);
+
+                        if (cost < best_cost)
+                        {
+                                best = pp;
+                                best_cost = cost;
+                        }
+                }
+        }
+
+        free(hist);
+        free(cells);
+        lp->params = best;
+        return DWRF_OK;
+}
+
+/***************
+ *     API     *
+ ***************/
+
+DwrfResult dwarf_producer_create(const DwrfProducerInfo *info, DwrfProducer **prod)
+{
+        DwrfProducer *p;
+
+        if ((info == NULL) || (prod == NULL) || ((info->AddressSize != 4) && (info->AddressSize != 8)))
+                return DWRF_BAD_ARG;
+
+        p = calloc(1, sizeof(DwrfProducer));
+        if (p == NULL)
+                return DWRF_NO_MEM;
+
+        p->address_size = info->AddressSize;
+        p->big = (info->BigEndian != 0);
+        *prod = p;
+        return DWRF_OK;
+}
+
+void dwarf_producer_destroy(DwrfProducer *prod)
+{
+        if (prod == NULL)
+                return;
+
+        for (int i = 0; i < DWRF_PROD_SECTION_COUNT; i++)
+                free(prod->secs[i].data);
+        free(prod->str.slots);
+        free(prod->line_str.slots);
+        free(prod->abbrevs);
+        free(prod->specs);
+        free(prod->abbrev_slots);
+        free(prod->units);
+        free(prod->forwards);
+        free(prod->fixups);
+        free(prod);
+}
+
+DwrfResult dwarf_producer_abbrev(DwrfProducer *prod, uint16_t tag, uint8_t children, const DwrfAbbrevSpec *specs,
+                                 uint32_t count, uint32_t *code)
+{
+        ProdBuf *out;
+        ProdAbbrev *a;
+        uint64_t hash, at, size;
+        DwrfResult res;
+
+        if ((prod == NULL) || (code == NULL) || ((specs == NULL) && count) || (tag == 0) || (children > 1) ||
+            prod->finished || (prod->abbrev_count >= UINT32_MAX - 1))
+                return DWRF_BAD_ARG;
+
+        hash = prod_hash(0xcbf29ce484222325ULL, &tag, sizeof(tag)) ^ children;
+        for (uint32_t i = 0; i < count; i++)
+        {
+                if (specs[i].Name == 0)
+                        return DWRF_BAD_ARG;
+                if (!prod_form_ok(specs[i].Form))
+                        return DWRF_UNSUPPORTED;
+
+                hash = prod_hash(hash, &specs[i].Name, sizeof(uint16_t));
+                hash = prod_hash(hash, &specs[i].Form, sizeof(uint16_t));
+                if (specs[i].Form == DW_FORM_implicit_const)
+                        hash = prod_hash(hash, &specs[i].ImplicitConst, sizeof(int64_t));
+        }
+
+        if ((2 * (prod->abbrev_count + 1) > prod->abbrev_slot_count) && (res = prod_abbrev_slots(prod)))
+                return res;
+
+        for (at = hash & (prod->abbrev_slot_count - 1); prod->abbrev_slots[at];
+             at = (at + 1) & (prod->abbrev_slot_count - 1))
+        {
+                a = &prod->abbrevs[prod->abbrev_slots[at] - 1];
+                if ((a->hash == hash) && prod_abbrev_eq(prod, a, tag, children, specs, count))
+                {
+                        *code = prod->abbrev_slots[at];
+                        return DWRF_OK;
+                }
+        }
+
+        if (!prod_reserve((void **)&prod->abbrevs, &prod->abbrev_cap, prod->abbrev_count + 1, sizeof(ProdAbbrev)) ||
+            !prod_reserve((void **)&prod->specs, &prod->spec_cap, prod->spec_count + count, sizeof(DwrfAbbrevSpec)))
+                return DWRF_NO_MEM;
+
+        /* the table entry, rolled back if the buffer can't grow */
+        out = &prod->secs[DWRF_PROD_ABBREV];
+        size = out->size;
+        if (!out_uleb(out, prod->abbrev_count + 1) || !out_uleb(out, tag) || !out_uN(out, children, 1, false))
+        {
+                out->size = size;
+                return DWRF_NO_MEM;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+                if (!out_uleb(out, specs[i].Name) || !out_uleb(out, specs[i].Form) ||
+                    ((specs[i].Form == DW_FORM_implicit_const) && !out_sleb(out, specs[i].ImplicitConst)))
+                {
+                        out->size = size;
+                        return DWRF_NO_MEM;
+                }
+        }
+        if (!out_uN(out, 0, 2, false))
+        {
+                out->size = size;
+                return DWRF_NO_MEM;
+        }
+
+        a = &prod->abbrevs[prod->abbrev_count++];
+        *a = (ProdAbbrev){ hash, prod->spec_count, count, tag, children };
+        if (count)
+                memcpy(prod->specs + prod->spec_count, specs, count * sizeof(DwrfAbbrevSpec));
+        prod->spec_count += count;
+        prod->abbrev_slots[at] = (uint32_t)prod->abbrev_count;
+        *code = (uint32_t)prod->abbrev_count;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_producer_unit_begin(DwrfProducer *prod, uint8_t unit_type)
+{
+        ProdBuf *info;
+        uint8_t *p;
+
+        if ((prod == NULL) || prod->unit_open || prod->finished)
+                return DWRF_BAD_ARG;
+        if ((unit_type != DW_UT_compile) && (unit_type != DW_UT_partial))
+                return DWRF_UNSUPPORTED;
+
+        info = &prod->secs[DWRF_PROD_INFO];
+        if (!prod_reserve((void **)&prod->units, &prod->unit_cap, prod->unit_count + 1, sizeof(ProdUnit)) ||
+            ((p = out_reserve(info, 12)) == NULL))
+                return DWRF_NO_MEM;
+
+        prod->units[prod->unit_count++] = (ProdUnit){ info->size, 0 };
+
+        /* the length is patched by dwarf_producer_unit_end(), every unit shares the abbreviation table */
+        p = put_uN(p, 0, 4, prod->big);
+        p = put_uN(p, 5, 2, prod->big);
+        *p++ = unit_type;
+        *p++ = prod->address_size;
+        put_uN(p, 0, 4, prod->big);
+        info->size += 12;
+
+        prod->unit_open = true;
+        prod->depth = 0;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_producer_die(DwrfProducer *prod, uint32_t code, const DwrfValue *values, DwrfDieRef *ref)
+{
+        ProdBuf *info;
+        const ProdAbbrev *a;
+        uint64_t start, fixups;
+        DwrfResult res = DWRF_OK;
+
+        if ((prod == NULL) || !prod->unit_open || (code == 0) || (code > prod->abbrev_count))
+                return DWRF_BAD_ARG;
+
+        a = &prod->abbrevs[code - 1];
+        if (a->count && (values == NULL))
+                return DWRF_BAD_ARG;
+
+        info = &prod->secs[DWRF_PROD_INFO];
+        start = info->size;
+        fixups = prod->fixup_count;
+
+        if (!out_uleb(info, code))
+                return DWRF_NO_MEM;
+        for (uint32_t i = 0; (i < a->count) && (res == DWRF_OK); i++)
+                res = prod_value(prod, &prod->specs[a->first + i], &values[i]);
+
+        /* a DIE is added whole or not at all */
+        if ((res == DWRF_OK) && (info->size > PROD_MAX_OFFSET))
+                res = DWRF_UNSUPPORTED;
+        if (res)
+        {
+                info->size = start;
+                prod->fixup_count = fixups;
+                return res;
+        }
+
+        prod->depth += a->children;
+        if (ref != NULL)
+                *ref = start;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_producer_die_end(DwrfProducer *prod)
+{
+        if ((prod == NULL) || !prod->unit_open || (prod->depth == 0))
+                return DWRF_BAD_ARG;
+
+        if (!out_uN(&prod->secs[DWRF_PROD_INFO], 0, 1, false))
+                return DWRF_NO_MEM;
+        prod->depth--;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_producer_unit_end(DwrfProducer *prod)
+{
+        ProdBuf *info;
+        ProdUnit *unit;
+
+        if ((prod == NULL) || !prod->unit_open || prod->depth)
+                return DWRF_BAD_ARG;
+
+        info = &prod->secs[DWRF_PROD_INFO];
+        unit = &prod->units[prod->unit_count - 1];
+        unit->end = info->size;
+        put_uN(info->data + unit->start, unit->end - unit->start - 4, 4, prod->big);
+        prod->unit_open = false;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_producer_forward(DwrfProducer *prod, DwrfDieRef *ref)
+{
+        if ((prod == NULL) || (ref == NULL) || prod->finished)
+                return DWRF_BAD_ARG;
+
+        if (!prod_reserve((void **)&prod->forwards, &prod->forward_cap, prod->forward_count + 1, sizeof(uint64_t)))
+                return DWRF_NO_MEM;
+
+        prod->forwards[prod->forward_count] = PROD_UNBOUND;
+        *ref = PROD_FORWARD | prod->forward_count++;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_producer_bind(DwrfProducer *prod, DwrfDieRef forward, DwrfDieRef die)
+{
+        uint64_t index = forward & ~PROD_FORWARD;
+
+        if ((prod == NULL) || !(forward & PROD_FORWARD) || (index >= prod->forward_count) ||
+            (prod->forwards[index] != PROD_UNBOUND) || (die & PROD_FORWARD) ||
+            (die >= prod->secs[DWRF_PROD_INFO].size))
+                return DWRF_BAD_ARG;
+
+        prod->forwards[index] = die;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_line_program_begin(DwrfProducer *prod, const DwrfLineProgramInfo *info, DwrfLineProgram **prog)
+{
+        DwrfLineProgram *lp;
+        uint32_t index;
+        DwrfResult res;
+
+        if ((prod == NULL) || (info == NULL) || (prog == NULL) || prod->finished || (info->CompDir == NULL) ||
+            (info->File == NULL) || (info->MinInstLength == 0))
+                return DWRF_BAD_ARG;
+
+        /* a row that neither advances nor changes the line needs a special opcode */
+        if (info->LineRange && ((info->LineBase > 0) || (info->LineBase + info->LineRange <= 0) ||
+                                (PROD_OPCODE_BASE - info->LineBase + info->LineRange - 1 > 255)))
+                return DWRF_BAD_ARG;
+
+        lp = calloc(1, sizeof(DwrfLineProgram));
+        if (lp == NULL)
+                return DWRF_NO_MEM;
+
+        lp->prod = prod;
+        lp->min_inst = info->MinInstLength;
+        lp->default_is_stmt = (info->DefaultIsStmt != 0);
+        lp->tune = (info->LineRange == 0);
+        lp->params = line_params(info->LineRange ? info->LineBase : -5, info->LineRange ? info->LineRange : 14);
+        line_reset(lp);
+
+        if ((res = dwarf_line_program_dir(lp, info->CompDir, &index)) ||
+            (res = dwarf_line_program_file(lp, info->File, 0, &index)))
+        {
+                dwarf_line_program_end(lp, NULL);
+                return res;
+        }
+
+        *prog = lp;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_line_program_dir(DwrfLineProgram *prog, const char *path, uint32_t *index)
+{
+        DwrfProducer *p;
+        uint64_t offset;
+        DwrfResult res;
+
+        if ((prog == NULL) || (path == NULL) || (index == NULL))
+                return DWRF_BAD_ARG;
+
+        p = prog->prod;
+        if ((res = prod_string(&p->line_str, &p->secs[DWRF_PROD_LINE_STR], path, &offset)))
+                return res;
+
+        for (uint64_t i = 0; i < prog->dir_count; i++)
+        {
+                if (prog->dirs[i] == offset)
+                {
+                        *index = (uint32_t)i;
+                        return DWRF_OK;
+                }
+        }
+
+        if ((prog->dir_count >= UINT32_MAX) ||
+            !prod_reserve((void **)&prog->dirs, &prog->dir_cap, prog->dir_count + 1, sizeof(uint64_t)))
+                return DWRF_NO_MEM;
+
+        prog->dirs[prog->dir_count] = offset;
+        *index = (uint32_t)prog->dir_count++;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_line_program_file(DwrfLineProgram *prog, const char *path, uint32_t dir, uint32_t *index)
+{
+        DwrfProducer *p;
+        uint64_t offset;
+        DwrfResult res;
+
+        if ((prog == NULL) || (path == NULL) || (index == NULL) || (dir >= prog->dir_count))
+                return DWRF_BAD_ARG;
+
+        p = prog->prod;
+        if ((res = prod_string(&p->line_str, &p->secs[DWRF_PROD_LINE_STR], path, &offset)))
+                return res;
+
+        for (uint64_t i = 0; i < prog->file_count; i++)
+        {
+                if ((prog->files[i].path == offset) && (prog->files[i].dir == dir))
+                {
+                        *index = (uint32_t)i;
+                        return DWRF_OK;
+                }
+        }
+
+        if ((prog->file_count >= DWRF_LINE_NO_FILE) ||
+            !prod_reserve((void **)&prog->files, &prog->file_cap, prog->file_count + 1, sizeof(LineFile)))
+                return DWRF_NO_MEM;
+
+        prog->files[prog->file_count] = (LineFile){ offset, dir };
+        *index = (uint32_t)prog->file_count++;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_line_program_rows(DwrfLineProgram *prog, const DwrfLineRow *rows, uint64_t count)
+{
+        if ((prog == NULL) || ((rows == NULL) && count))
+                return DWRF_BAD_ARG;
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+                if (rows[i].File >= prog->file_count)
+                        return DWRF_BAD_ARG;
+        }
+
+        if (!prog->tune)
+                return line_encode_rows(prog, rows, count);
+
+        if (!prod_reserve((void **)&prog->rows, &prog->row_cap, prog->row_count + count, sizeof(DwrfLineRow)))
+                return DWRF_NO_MEM;
+        if (count)
+                memcpy(prog->rows + prog->row_count, rows, (size_t)count * sizeof(DwrfLineRow));
+        prog->row_count += count;
+
+        /* the open sequence is only tracked to check the program is complete */
+        for (uint64_t i = 0; i < count; i++)
+                prog->state.in_seq = !(rows[i].Flags & DWRF_LINE_END_SEQUENCE);
+        return DWRF_OK;
+}
+
+/** Header of the program, followed by the opcodes */
+static DwrfResult line_write(DwrfLineProgram *lp, uint64_t *offset)
+{
+        DwrfProducer *p = lp->prod;
+        ProdBuf *out = &p->secs[DWRF_PROD_LINE];
+        uint64_t start = out->size, header;
+        uint8_t big = p->big;
+        int ok;
+
+        ok = out_uN(out, 0, 4, big) && out_uN(out, 5, 2, big) && out_uN(out, p->address_size, 1, big) &&
+             out_uN(out, 0, 1, big) && out_uN(out, 0, 4, big);
+        header = out->size;
+
+        ok = ok && out_uN(out, lp->min_inst, 1, big) && out_uN(out, 1, 1, big) &&
+             out_uN(out, lp->default_is_stmt, 1, big) && out_uN(out, (uint8_t)lp->params.line_base, 1, big) &&
+             out_uN(out, lp->params.line_range, 1, big) && out_uN(out, PROD_OPCODE_BASE, 1, big) &&
+             out_bytes(out, std_opcode_lengths, sizeof(std_opcode_lengths));
+
+        /* directories: one path each, files: a path and a directory index */
+        ok = ok && out_uN(out, 1, 1, big) && out_uleb(out, DW_LNCT_path) && out_uleb(out, DW_FORM_line_strp) &&
+             out_uleb(out, lp->dir_count);
+        for (uint64_t i = 0; ok && (i < lp->dir_count); i++)
+                ok = out_uN(out, lp->dirs[i], 4, big);
+
+        ok = ok && out_uN(out, 2, 1, big) && out_uleb(out, DW_LNCT_path) && out_uleb(out, DW_FORM_line_strp) &&
+             out_uleb(out, DW_LNCT_directory_index) && out_uleb(out, DW_FORM_udata) && out_uleb(out, lp->file_count);
+        for (uint64_t i = 0; ok && (i < lp->file_count); i++)
+                ok = out_uN(out, lp->files[i].path, 4, big) && out_uleb(out, lp->files[i].dir);
+
+        if (ok)
+                put_uN(out->data + header - 4, out->size - header, 4, big);
+        ok = ok && out_bytes(out, lp->ops.data, lp->ops.size);
+
+        if (!ok || (out->size > PROD_MAX_OFFSET))
+        {
+                out->size = start;
+                return ok ? DWRF_UNSUPPORTED : DWRF_NO_MEM;
+        }
+
+        put_uN(out->data + start, out->size - start - 4, 4, big);
+        if (offset != NULL)
+                *offset = start;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_line_program_end(DwrfLineProgram *prog, uint64_t *offset)
+{
+        DwrfResult res = DWRF_OK;
+
+        if (prog == NULL)
+                return DWRF_BAD_ARG;
+
+        if (prog->prod->finished || prog->state.in_seq)
+                res = DWRF_BAD_ARG;
+
+        if ((res == DWRF_OK) && prog->tune)
+        {
+                line_reset(prog);
+                if ((res = line_tune(prog)) == DWRF_OK)
+                        res = line_encode_rows(prog, prog->rows, prog->row_count);
+        }
+
+        if (res == DWRF_OK)
+                res = line_write(prog, offset);
+
+        free(prog->ops.data);
+        free(prog->rows);
+        free(prog->dirs);
+        free(prog->files);
+        free(prog);
+        return res;
+}
+
+DwrfResult dwarf_producer_finish(DwrfProducer *prod)
+{
+        ProdBuf *info;
+
+        if (prod == NULL)
+                return DWRF_BAD_ARG;
+        if (prod->finished)
+                return DWRF_OK;
+        if (prod->unit_open)
+                return DWRF_BAD_ARG;
+
+        info = &prod->secs[DWRF_PROD_INFO];
+        for (uint64_t i = 0; i < prod->fixup_count; i++)
+        {
+                const ProdFixup *f = &prod->fixups[i];
+                const ProdUnit *unit = &prod->units[f->unit];
+                uint64_t target = prod->forwards[f->forward];
+
+                if (target == PROD_UNBOUND)
+                        return DWRF_NOT_FOUND;
+                if ((f->form != DW_FORM_ref_addr) && ((target < unit->start) || (target >= unit->end)))
+                        return DWRF_BAD_ARG;
+        }
+
+        /* checked first so a failure leaves the producer as it was */
+        for (uint64_t i = 0; i < prod->fixup_count; i++)
+        {
+                const ProdFixup *f = &prod->fixups[i];
+                uint64_t target = prod->forwards[f->forward];
+                uint8_t size = (f->form == DW_FORM_ref1) ? 1 : (f->form == DW_FORM_ref2) ? 2 : (f->form == DW_FORM_ref8) ? 8 : 4;
+
+                if (f->form != DW_FORM_ref_addr)
+                        target -= prod->units[f->unit].start;
+                if ((size < 8) && (target >> (8 * size)))
+                        return DWRF_BAD_ARG;
+        }
+
+        if (!out_uN(&prod->secs[DWRF_PROD_ABBREV], 0, 1, false))
+                return DWRF_NO_MEM;
+
+        for (uint64_t i = 0; i < prod->fixup_count; i++)
+        {
+                const ProdFixup *f = &prod->fixups[i];
+                uint64_t target = prod->forwards[f->forward];
+                uint8_t size = (f->form == DW_FORM_ref1) ? 1 : (f->form == DW_FORM_ref2) ? 2 : (f->form == DW_FORM_ref8) ? 8 : 4;
+
+                if (f->form != DW_FORM_ref_addr)
+                        target -= prod->units[f->unit].start;
+                put_uN(info->data + f->at, target, size, prod->big);
+        }
+
+        prod->finished = true;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_producer_section(const DwrfProducer *prod, DwrfProducerSection sec, const void **data, uint64_t *size)
+{
+        if ((prod == NULL) || (data == NULL) || (size == NULL) || !prod->finished || ((unsigned)sec >= DWRF_PROD_SECTION_COUNT))
+                return DWRF_BAD_ARG;
+
+        *data = prod->secs[sec].data;
+        *size = prod->secs[sec].size;
+        return DWRF_OK;
+}
+
+const char *dwarf_producer_section_name(DwrfProducerSection sec)
+{
+        return ((unsigned)sec < DWRF_PROD_SECTION_COUNT) ? prod_names[sec] : NULL;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DWARF_PRODUCER_LIB
+#define DWARF_PRODUCER_LIB
+
+#include "elf_dwarf.h"
+
+/**
+ * NOTE: The producer writes 32-bit DWARF 5: compile units with a shared abbreviation table,
+ * line programs and their string sections. Addresses are written as given, producers of
+ * relocatable files apply their relocations on top of the returned sections.
+ *
+ * The output only depends on the calls made, two runs with the same input give identical bytes.
+ * The sections are returned as buffers, src/writer/elf_writer_dwarf.h adds them to a writer.
+ */
+
+/**
+ * @brief Opaque producer, owns the sections being built.
+ */
+typedef struct DwrfProducer DwrfProducer;
+
+/**
+ * @brief Sections built by the producer.
+ */
+typedef enum
+{
+        DWRF_PROD_INFO,         // .debug_info
+        DWRF_PROD_ABBREV,       // .debug_abbrev
+        DWRF_PROD_LINE,         // .debug_line
+        DWRF_PROD_STR,          // .debug_str
+        DWRF_PROD_LINE_STR,     // .debug_line_str
+        DWRF_PROD_SECTION_COUNT
+} DwrfProducerSection;
+
+typedef struct
+{
+        uint8_t AddressSize;    // 4 or 8
+        uint8_t BigEndian;      // Byte order of the target
+} DwrfProducerInfo;
+
+/**
+ * @param info Target description.
+ * @param prod (out) New producer, release with dwarf_producer_destroy().
+ * @return Error code
+ */
+DwrfResult dwarf_producer_create(const DwrfProducerInfo *info, DwrfProducer **prod);
+
+/**
+ * @param prod Producer to release, NULL has no effect. Sections handed to a writer must not be
+ *             used after this call.
+ */
+void dwarf_producer_destroy(DwrfProducer *prod);
+
+/***************
+ *   Abbrevs   *
+ ***************/
+        /**
+         * @brief Attribute specification of an abbreviation.
+         */
+        typedef struct
+        {
+                uint16_t Name;          // DW_AT_*
+                uint16_t Form;          // DW_FORM_*
+                int64_t ImplicitConst;  // Value of DW_FORM_implicit_const, ignored for other forms
+        } DwrfAbbrevSpec;
+
+        /**
+         * @param prod Producer.
+         * @param tag DW_TAG_* of the DIEs using it.
+         * @param children DW_CHILDREN_yes or DW_CHILDREN_no.
+         * @param specs Attributes, in the order the values are given to dwarf_producer_die().
+         * @param count Number of attributes.
+         * @param code (out) Abbreviation code, the same for every identical definition.
+         * @return Error code, DWRF_UNSUPPORTED for forms that need sections the producer doesn't build
+         *         (indexed strings and addresses, supplementary files).
+         */
+        DwrfResult dwarf_producer_abbrev(DwrfProducer *prod, uint16_t tag, uint8_t children, const DwrfAbbrevSpec *specs,
+                                         uint32_t count, uint32_t *code);
+
+/***************
+ *    DIEs     *
+ ***************/
+        /**
+         * @brief DIE reference: offset of the DIE in .debug_info, or a forward reference made with
+         * dwarf_producer_forward().
+         */
+        typedef uint64_t DwrfDieRef;
+
+        /**
+         * @brief Value of one attribute, how it is read depends on the form.
+         *
+         * Constants, flags, addresses and section offsets: Value.
+         * DW_FORM_string, DW_FORM_strp and DW_FORM_line_strp: Data, a NUL terminated string.
+         * Blocks and expressions: Data and Value, the size in bytes. DW_FORM_data16: Data, 16 bytes.
+         * References: Value, a DwrfDieRef.
+         */
+        typedef struct
+        {
+                uint64_t Value;
+                const void *Data;
+        } DwrfValue;
+
+        /**
+         * @param prod Producer.
+         * @param unit_type DW_UT_compile or DW_UT_partial.
+         * @return Error code, DWRF_BAD_ARG if a unit is already open.
+         * @brief Starts a unit, its DIEs are added with dwarf_producer_die() and the first one is the unit DIE.
+         */
+        DwrfResult dwarf_producer_unit_begin(DwrfProducer *prod, uint8_t unit_type);
+
+        /**
+         * @param prod Producer.
+         * @param code Abbreviation of the DIE.
+         * @param values One value per attribute of the abbreviation, NULL if it has none.
+         * @param ref (out) Reference to the new DIE, may be NULL.
+         * @return Error code, DWRF_BAD_ARG if no unit is open or a value doesn't fit its form.
+         * @brief Adds a DIE to the open unit. The DIEs added after one whose abbreviation has children
+         * are its children, up to the matching dwarf_producer_die_end().
+         */
+        DwrfResult dwarf_producer_die(DwrfProducer *prod, uint32_t code, const DwrfValue *values, DwrfDieRef *ref);
+
+        /**
+         * @param prod Producer.
+         * @return Error code, DWRF_BAD_ARG if there is no DIE with children to close.
+         * @brief Ends the children of the innermost DIE that has them.
+         */
+        DwrfResult dwarf_producer_die_end(DwrfProducer *prod);
+
+        /**
+         * @param prod Producer.
+         * @return Error code, DWRF_BAD_ARG if no unit is open or it has DIEs with children left open.
+         */
+        DwrfResult dwarf_producer_unit_end(DwrfProducer *prod);
+
+        /**
+         * @param prod Producer.
+         * @param ref (out) Reference to a DIE that isn't added yet, bind it with dwarf_producer_bind().
+         * @return Error code
+         * @note Forward references are patched by dwarf_producer_finish(), they can only be used with the fixed
+         *       size reference forms (DW_FORM_ref1, ref2, ref4, ref8 and ref_addr).
+         */
+        DwrfResult dwarf_producer_forward(DwrfProducer *prod, DwrfDieRef *ref);
+
+        /**
+         * @param prod Producer.
+         * @param forward Reference returned by dwarf_producer_forward().
+         * @param die DIE it stands for.
+         * @return Error code
+         */
+        DwrfResult dwarf_producer_bind(DwrfProducer *prod, DwrfDieRef forward, DwrfDieRef die);
+
+/***************
+ *  Line prog  *
+ ***************/
+        /**
+         * @brief Line program of one unit being built.
+         */
+        typedef struct DwrfLineProgram DwrfLineProgram;
+
+        typedef struct
+        {
+                const char *CompDir;    // Directory 0, the compilation directory
+                const char *File;       // File 0, the primary source file, in directory 0
+                uint8_t MinInstLength;  // Instruction alignment, the unit of the address advances (1 on x86)
+                uint8_t DefaultIsStmt;
+                int8_t LineBase;        // Special opcode parameters, with LineRange 0 they are chosen from
+                uint8_t LineRange;      // the rows to make the program as small as possible
+        } DwrfLineProgramInfo;
+
+        /**
+         * @param prod Producer receiving the program.
+         * @param info Program parameters.
+         * @param prog (out) New program, ended with dwarf_line_program_end().
+         * @return Error code
+         */
+        DwrfResult dwarf_line_program_begin(DwrfProducer *prod, const DwrfLineProgramInfo *info, DwrfLineProgram **prog);
+
+        /**
+         * @param prog Line program.
+         * @param path Directory, relative ones are relative to the compilation directory.
+         * @param index (out) Index of the directory, identical paths share one.
+         * @return Error code
+         */
+        DwrfResult dwarf_line_program_dir(DwrfLineProgram *prog, const char *path, uint32_t *index);
+
+        /**
+         * @param prog Line program.
+         * @param path File name.
+         * @param dir Index of its directory.
+         * @param index (out) Index of the file for DwrfLineRow.File, identical files share one.
+         * @return Error code
+         */
+        DwrfResult dwarf_line_program_file(DwrfLineProgram *prog, const char *path, uint32_t dir, uint32_t *index);
+
+        /**
+         * @param prog Line program.
+         * @param rows Rows in address order within each sequence, the last row of a sequence has the
+         *             DWRF_LINE_END_SEQUENCE flag and the address right after it.
+         * @param count Number of rows.
+         * @return Error code, DWRF_BAD_ARG if a row goes back in its sequence or uses an unknown file.
+         * @brief Adds rows, each one is encoded with the shortest sequence of opcodes that produces it.
+         */
+        DwrfResult dwarf_line_program_rows(DwrfLineProgram *prog, const DwrfLineRow *rows, uint64_t count);
+
+        /**
+         * @param prog Line program, released by the call whatever the result.
+         * @param offset (out) Offset of the program in .debug_line, the value of DW_AT_stmt_list. May be NULL.
+         * @return Error code, DWRF_BAD_ARG if the last sequence isn't ended.
+         * @brief Encodes the header and appends the program to the producer.
+         */
+        DwrfResult dwarf_line_program_end(DwrfLineProgram *prog, uint64_t *offset);
+
+/***************
+ *   Output    *
+ ***************/
+        /**
+         * @param prod Producer.
+         * @return Error code, DWRF_BAD_ARG if a unit is open, DWRF_NOT_FOUND if a forward reference wasn't bound.
+         * @brief Terminates the abbreviation table and patches the forward references, nothing can be added after.
+         */
+        DwrfResult dwarf_producer_finish(DwrfProducer *prod);
+
+        /**
+         * @param prod Finished producer.
+         * @param sec Section.
+         * @param data (out) Contents, owned by the producer.
+         * @param size (out) Size of the contents, 0 if the section is empty.
+         * @return Error code, DWRF_BAD_ARG if the producer isn't finished.
+         */
+        DwrfResult dwarf_producer_section(const DwrfProducer *prod, DwrfProducerSection sec, const void **data,
+                                          uint64_t *size);
+
+        /**
+         * @param sec Section.
+         * @return Name of the section (".debug_info", ...), NULL for an invalid one.
+         */
+        const char *dwarf_producer_section_name(DwrfProducerSection sec);
+
+#endif // include guard
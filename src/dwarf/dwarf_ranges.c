@@ -0,0 +1,543 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ *   Ranges    *
+ ***************/
+ // sections 2.17.3 and 7.25 of spec v5
+
+/** DWARF 2 to 4 .debug_ranges: (begin, end) pairs relative to the base address. */
+static DwrfResult ranges_v4(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t offset, DwrfRangeFn fn, void *user)
+{
+        const DwrfSection *sec = &ctx->debug_ranges;
+        uint64_t max = (bases->addr_size == 8) ? UINT64_MAX : ((1ULL << (8 * bases->addr_size)) - 1);
+        uint64_t base = bases->low_pc;
+        DwrfResult res;
+        DwrfBuf b;
+
+        if (!sec->present)
+                return DWRF_SEC_MISSING;
+        if ((res = dwrf_load_section(ctx, &ctx->debug_ranges)))
+                return res;
+        if (offset >= sec->hdr.Size)
+                return DWRF_DECODE_ERR;
+
+        b = buf_make(ctx, sec, offset, sec->hdr.Size);
+        for (;;)
+        {
+                uint64_t begin, end;
+
+                if ((res = buf_uN(&b, bases->addr_size, &begin)) || (res = buf_uN(&b, bases->addr_size, &end)))
+                        return res;
+
+                if ((begin == 0) && (end == 0))
+                        return DWRF_OK;
+
+                if (begin == max)
+                {
+                        base = end; // base address selection entry
+                        continue;
+                }
+
+                if ((begin < end) && (res = fn(user, base + begin, base + end)))
+                        return res;
+        }
+}
+
+static DwrfResult ranges_v5(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t offset, DwrfRangeFn fn, void *user)
+{
+        const DwrfSection *sec = &ctx->debug_rnglists;
+        uint64_t base = bases->low_pc;
+        DwrfResult res;
+        DwrfBuf b;
+
+        if (!sec->present)
+                return DWRF_SEC_MISSING;
+        if ((res = dwrf_load_section(ctx, &ctx->debug_rnglists)))
+                return res;
+        if (offset >= sec->hdr.Size)
+                return DWRF_DECODE_ERR;
+
+        b = buf_make(ctx, sec, offset, sec->hdr.Size);
+        for (;;)
+        {
+                uint64_t kind, a, c, low, high;
+
+                if ((res = buf_uN(&b, 1, &kind)))
+                        return res;
+
+                switch (kind)
+                {
+                case DW_RLE_end_of_list:
+                        return DWRF_OK;
+                case DW_RLE_base_addressx:
+                        if ((res = buf_uleb(&b, &a)) || (res = dwrf_read_addrx(ctx, bases, a, &base)))
+                                return res;
+                        continue;
+                case DW_RLE_base_address:
+                        if ((res = buf_uN(&b, bases->addr_size, &base)))
+                                return res;
+                        continue;
+                case DW_RLE_startx_endx:
+                        if ((res = buf_uleb(&b, &a)) || (res = buf_uleb(&b, &c)) ||
+                            (res = dwrf_read_addrx(ctx, bases, a, &low)) || (res = dwrf_read_addrx(ctx, bases, c, &high)))
+                                return res;
+                        break;
+                case DW_RLE_startx_length:
+                        if ((res = buf_uleb(&b, &a)) || (res = buf_uleb(&b, &c)) || (res = dwrf_read_addrx(ctx, bases, a, &low)))
+                                return res;
+                        high = low + c;
+                        break;
+                case DW_RLE_offset_pair:
+                        if ((res = buf_uleb(&b, &a)) || (res = buf_uleb(&b, &c)))
+                                return res;
+                        low = base + a;
+                        high = base + c;
+                        break;
+                case DW_RLE_start_end:
+                        if ((res = buf_uN(&b, bases->addr_size, &low)) || (res = buf_uN(&b, bases->addr_size, &high)))
+                                return res;
+                        break;
+                case DW_RLE_start_length:
+                        if ((res = buf_uN(&b, bases->addr_size, &low)) || (res = buf_uleb(&b, &c)))
+                                return res;
+                        high = low + c;
+                        break;
+                default:
+                        return DWRF_DECODE_ERR;
+                }
+
+                if ((low < high) && (res = fn(user, low, high)))
+                        return res;
+        }
+}
+
+DwrfResult dwrf_ranges_for_each(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t offset, DwrfRangeFn fn, void *user)
+{
+        if ((bases->addr_size == 0) || (bases->addr_size > 8))
+                return DWRF_DECODE_ERR;
+
+        if (bases->version >= 5)
+                return ranges_v5(ctx, bases, offset, fn, user);
+        return ranges_v4(ctx, bases, offset, fn, user);
+}
+
+/***************
+ *  Locations  *
+ ***************/
+ // sections 2.6.2 and 7.29 of spec v5
+
+/** DWARF 2 to 4 .debug_loc: (begin, end) pairs relative to the base address, each followed by a 2-byte length and the expression. */
+static DwrfResult locs_v4(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t offset, DwrfLocFn fn, void *user)
+{
+        const DwrfSection *sec = &ctx->debug_loc;
+        uint64_t max = (bases->addr_size == 8) ? UINT64_MAX : ((1ULL << (8 * bases->addr_size)) - 1);
+        uint64_t base = bases->low_pc;
+        DwrfResult res;
+        DwrfBuf b;
+
+        if (!sec->present)
+                return DWRF_SEC_MISSING;
+        if ((res = dwrf_load_section(ctx, &ctx->debug_loc)))
+                return res;
+        if (offset >= sec->hdr.Size)
+                return DWRF_DECODE_ERR;
+
+        b = buf_make(ctx, sec, offset, sec->hdr.Size);
+        for (;;)
+        {
+                uint64_t begin, end, len;
+                const uint8_t *expr;
+
+                if ((res = buf_uN(&b, bases->addr_size, &begin)) || (res = buf_uN(&b, bases->addr_size, &end)))
+                        return res;
+
+                if ((begin == 0) && (end == 0))
+                        return DWRF_OK;
+
+                if (begin == max)
+                {
+                        base = end; // base address selection entry
+                        continue;
+                }
+
+                expr = b.p + 2;
+                if ((res = buf_uN(&b, 2, &len)) || (res = buf_skip(&b, len)))
+                        return res;
+
+                if ((begin < end) && (res = fn(user, base + begin, base + end, expr, len, false)))
+                        return res;
+        }
+}
+
+static DwrfResult locs_v5(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t offset, DwrfLocFn fn, void *user)
+{
+        const DwrfSection *sec = &ctx->debug_loclists;
+        uint64_t base = bases->low_pc;
+        DwrfResult res;
+        DwrfBuf b;
+
+        if (!sec->present)
+                return DWRF_SEC_MISSING;
+        if ((res = dwrf_load_section(ctx, &ctx->debug_loclists)))
+                return res;
+        if (offset >= sec->hdr.Size)
+                return DWRF_DECODE_ERR;
+
+        b = buf_make(ctx, sec, offset, sec->hdr.Size);
+        for (;;)
+        {
+                uint64_t kind, a, c, low = 0, high = 0, len;
+                const uint8_t *expr;
+
+                if ((res = buf_uN(&b, 1, &kind)))
+                        return res;
+
+                switch (kind)
+                {
+                case DW_LLE_end_of_list:
+                        return DWRF_OK;
+                case DW_LLE_base_addressx:
+                        if ((res = buf_uleb(&b, &a)) || (res = dwrf_read_addrx(ctx, bases, a, &base)))
+                                return res;
+                        continue;
+                case DW_LLE_base_address:
+                        if ((res = buf_uN(&b, bases->addr_size, &base)))
+                                return res;
+                        continue;
+                case DW_LLE_GNU_view_pair:
+                        if ((res = buf_uleb(&b, &a)) || (res = buf_uleb(&b, &c)))
+                                return res;
+                        continue;
+                case DW_LLE_startx_endx:
+                        if ((res = buf_uleb(&b, &a)) || (res = buf_uleb(&b, &c)) ||
+                            (res = dwrf_read_addrx(ctx, bases, a, &low)) || (res = dwrf_read_addrx(ctx, bases, c, &high)))
+                                return res;
+                        break;
+                case DW_LLE_startx_length:
+                        if ((res = buf_uleb(&b, &a)) || (res = buf_uleb(&b, &c)) || (res = dwrf_read_addrx(ctx, bases, a, &low)))
+                                return res;
+                        high = low + c;
+                        break;
+                case DW_LLE_offset_pair:
+                        if ((res = buf_uleb(&b, &a)) || (res = buf_uleb(&b, &c)))
+                                return res;
+                        low = base + a;
+                        high = base + c;
+                        break;
+                case DW_LLE_default_location:
+                        break;
+                case DW_LLE_start_end:
+                        if ((res = buf_uN(&b, bases->addr_size, &low)) || (res = buf_uN(&b, bases->addr_size, &high)))
+                                return res;
+                        break;
+                case DW_LLE_start_length:
+                        if ((res = buf_uN(&b, bases->addr_size, &low)) || (res = buf_uleb(&b, &c)))
+                                return res;
+                        high = low + c;
+                        break;
+                default:
+                        return DWRF_DECODE_ERR;
+                }
+
+                /* counted location description */
+                if ((res = buf_uleb(&b, &len)))
+                        return res;
+                expr = b.p;
+                if ((res = buf_skip(&b, len)))
+                        return res;
+
+                if (kind == DW_LLE_default_location)
+                        res = fn(user, 0, UINT64_MAX, expr, len, true);
+                else if (low < high)
+                        res = fn(user, low, high, expr, len, false);
+                if (res)
+                        return res;
+        }
+}
+
+DwrfResult dwrf_locs_for_each(InternalDwarfCtx *ctx, const DwrfUnitBases *bases, uint64_t offset, DwrfLocFn fn, void *user)
+{
+        if ((bases->addr_size == 0) || (bases->addr_size > 8))
+                return DWRF_DECODE_ERR;
+
+        if (bases->version >= 5)
+                return locs_v5(ctx, bases, offset, fn, user);
+        return locs_v4(ctx, bases, offset, fn, user);
+}
+
+/***************
+ * List cache  *
+ ***************/
+
+/* Key bits above the list offset */
+#define LIST_KEY_V5   (1ULL << 63)      // .debug_rnglists / .debug_loclists rather than the DWARF 4 sections
+#define LIST_KEY_LOCS (1ULL << 62)      // location list
+
+/** A decoded list, the items follow in the same allocation */
+typedef struct ListEntry
+{
+        struct ListEntry *next; // same offset decoded against the bases of another unit
+        uint64_t low_pc;        // bases the list was decoded with
+        uint64_t addr_base;
+        uint64_t count;
+        void *items;            // DwrfRange or DwrfLocation
+} ListEntry;
+
+struct DwrfListCache
+{
+        DwrfArena arena;        // every ListEntry
+        DwrfMap lists;          // key -> ListEntry chain
+        void *scratch;          // items of the list being decoded
+        uint64_t scratch_count;
+        uint64_t scratch_cap;
+        size_t item_size;
+        DwrfListCacheStats stats;
+};
+
+static DwrfResult list_push(DwrfListCache *cache, const void *item)
+{
+        if (cache->scratch_count == cache->scratch_cap)
+        {
+                uint64_t cap = cache->scratch_cap ? cache->scratch_cap * 2 : 16;
+                void *items = realloc(cache->scratch, (size_t)cap * sizeof(DwrfLocation));
+                if (items == NULL)
+                        return DWRF_NO_MEM;
+                cache->scratch = items;
+                cache->scratch_cap = cap;
+        }
+
+        memcpy((uint8_t *)cache->scratch + cache->scratch_count++ * cache->item_size, item, cache->item_size);
+        return DWRF_OK;
+}
+
+static DwrfResult list_push_range(void *user, uint64_t low, uint64_t high)
+{
+        DwrfRange r = { low, high };
+        return list_push(user, &r);
+}
+
+static DwrfResult list_push_loc(void *user, uint64_t low, uint64_t high, const uint8_t *expr, uint64_t len, uint8_t dflt)
+{
+        DwrfLocation l = { low, high, expr, len, dflt };
+        return list_push(user, &l);
+}
+
+static int list_range_cmp(const void *a, const void *b)
+{
+        const DwrfRange *x = a, *y = b;
+
+        if (x->Low != y->Low)
+                return (x->Low < y->Low) ? -1 : 1;
+        if (x->High != y->High)
+                return (x->High < y->High) ? -1 : 1;
+        return 0;
+}
+
+static int list_loc_cmp(const void *a, const void *b)
+{
+        const DwrfLocation *x = a, *y = b;
+
+        if (x->Default != y->Default)
+                return x->Default ? 1 : -1;
+        if (x->Low != y->Low)
+                return (x->Low < y->Low) ? -1 : 1;
+        if (x->High != y->High)
+                return (x->High < y->High) ? -1 : 1;
+        if (x->Expr != y->Expr)
+                return (x->Expr < y->Expr) ? -1 : 1;
+        return 0;
+}
+
+/** Sorts the ranges in scratch and merges the ones that overlap or touch */
+static void list_merge_ranges(DwrfListCache *cache)
+{
+        DwrfRange *r = cache->scratch;
+        uint64_t n = 0;
+
+        if (cache->scratch_count == 0)
+                return;
+
+        qsort(r, (size_t)cache->scratch_count, sizeof(DwrfRange), list_range_cmp);
+        for (uint64_t i = 1; i < cache->scratch_count; i++)
+        {
+                if (r[i].Low <= r[n].High)
+                {
+                        if (r[i].High > r[n].High)
+                                r[n].High = r[i].High;
+                }
+                else
+                        r[++n] = r[i];
+        }
+        cache->scratch_count = n + 1;
+}
+
+/** List of a range or location list attribute, decoded and added to the cache on a miss */
+static DwrfResult list_get(DwrfListCache *cache, DwrfCursor *cur, const DwrfAttr *attr, uint8_t locs, const ListEntry **out)
+{
+        InternalDwarfCtx *ctx;
+        const DwrfUnitBases *bases;
+        DwrfAttr a;
+        ListEntry *head, *e;
+        uint64_t key;
+        size_t bytes;
+        DwrfResult res;
+
+        if ((cache == NULL) || (attr == NULL))
+                return DWRF_BAD_ARG;
+
+        if ((res = dwrf_cursor_bases(cur, &ctx, &bases)))
+                return res;
+
+        a = *attr;
+        if ((res = dwarf_cursor_resolve(cur, &a)))
+                return res;
+
+        /* DWARF 3 and earlier use data4/data8 for section offsets */
+        if ((a.Form != DW_FORM_sec_offset) && (((a.Form != DW_FORM_data4) && (a.Form != DW_FORM_data8)) || (bases->version > 3)))
+                return DWRF_BAD_ARG;
+        if (a.Value >= LIST_KEY_LOCS)
+                return DWRF_DECODE_ERR;
+
+        key = a.Value | ((bases->version >= 5) ? LIST_KEY_V5 : 0) | (locs ? LIST_KEY_LOCS : 0);
+        head = dwrf_map_get(&cache->lists, key);
+        for (e = head; e != NULL; e = e->next)
+        {
+                if ((e->low_pc == bases->low_pc) && (e->addr_base == bases->addr_base))
+                {
+                        cache->stats.Hits++;
+                        *out = e;
+                        return DWRF_OK;
+                }
+        }
+
+        cache->scratch_count = 0;
+        cache->item_size = locs ? sizeof(DwrfLocation) : sizeof(DwrfRange);
+        if (locs)
+                res = dwrf_locs_for_each(ctx, bases, a.Value, list_push_loc, cache);
+        else
+                res = dwrf_ranges_for_each(ctx, bases, a.Value, list_push_range, cache);
+        if (res)
+                return res;
+
+        if (locs)
+        {
+                if (cache->scratch_count > 1)
+                        qsort(cache->scratch, (size_t)cache->scratch_count, sizeof(DwrfLocation), list_loc_cmp);
+        }
+        else
+                list_merge_ranges(cache);
+
+        bytes = sizeof(ListEntry) + (size_t)cache->scratch_count * cache->item_size;
+        e = dwarf_arena_alloc(&cache->arena, bytes);
+        if (e == NULL)
+                return DWRF_NO_MEM;
+
+        e->low_pc = bases->low_pc;
+        e->addr_base = bases->addr_base;
+        e->count = cache->scratch_count;
+        e->items = (cache->scratch_count > 0) ? (void *)(e + 1) : NULL;
+        if (e->items != NULL)
+                memcpy(e->items, cache->scratch, (size_t)cache->scratch_count * cache->item_size);
+
+        e->next = head;
+        if ((res = dwrf_map_put(&cache->lists, key, e)))
+                return res;
+
+        cache->stats.Misses++;
+        cache->stats.Bytes += bytes;
+        *out = e;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_list_cache_create(DwrfListCache **cache)
+{
+        DwrfListCache *c;
+
+        if (cache == NULL)
+                return DWRF_BAD_ARG;
+
+        c = calloc(1, sizeof(DwrfListCache));
+        if (c == NULL)
+                return DWRF_NO_MEM;
+
+        dwrf_arena_init(&c->arena);
+        *cache = c;
+        return DWRF_OK;
+}
+
+void dwarf_list_cache_destroy(DwrfListCache *cache)
+{
+        if (cache == NULL)
+                return;
+
+        /* the entries live in the arena */
+        dwrf_map_destroy(&cache->lists, NULL);
+        dwrf_arena_destroy(&cache->arena);
+        free(cache->scratch);
+        free(cache);
+}
+
+DwrfResult dwarf_list_ranges(DwrfListCache *cache, DwrfCursor *cur, const DwrfAttr *attr, const DwrfRange **ranges,
+                             uint64_t *count)
+{
+        const ListEntry *e;
+        DwrfResult res;
+
+        if ((ranges == NULL) || (count == NULL))
+                return DWRF_BAD_ARG;
+
+        if ((res = list_get(cache, cur, attr, false, &e)))
+                return res;
+
+        *ranges = e->items;
+        *count = e->count;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_list_locations(DwrfListCache *cache, DwrfCursor *cur, const DwrfAttr *attr,
+                                const DwrfLocation **locs, uint64_t *count)
+{
+        const ListEntry *e;
+        DwrfResult res;
+
+        if ((locs == NULL) || (count == NULL))
+                return DWRF_BAD_ARG;
+
+        if ((res = list_get(cache, cur, attr, true, &e)))
+                return res;
+
+        *locs = e->items;
+        *count = e->count;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_list_cache_stats(const DwrfListCache *cache, DwrfListCacheStats *stats)
+{
+        if ((cache == NULL) || (stats == NULL))
+                return DWRF_BAD_ARG;
+
+        *stats = cache->stats;
+        return DWRF_OK;
+}
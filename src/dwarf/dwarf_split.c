@@ -0,0 +1,810 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(DWRF_NO_THREADS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // pthreads
+#endif
+
+#include "dwarf_internal.h"
+
+#ifndef DWRF_NO_THREADS
+#include <pthread.h>
+#endif
+
+/***************
+ * Split DWARF *
+ ***************/
+ // sections 3.1.3 (split units), 7.3.2 to 7.3.5 (.dwo files and packages) and 7.3.6 (supplementary files) of spec v5
+
+#define SPLIT_INDEX_HEADER 16u          // version, padding, section count, unit count, slot count
+#define SPLIT_PATH_MAX     4096u
+#define SPLIT_DEFAULT_OPEN 64u
+
+#ifndef DWRF_NO_THREADS
+typedef pthread_mutex_t SplitLock;
+#define split_lock_init(l)    pthread_mutex_init((l), NULL)
+#define split_lock_destroy(l) pthread_mutex_destroy(l)
+#define split_lock(l)         pthread_mutex_lock(l)
+#define split_unlock(l)       pthread_mutex_unlock(l)
+#else
+typedef uint8_t SplitLock;
+#define split_lock_init(l)    ((void)(l))
+#define split_lock_destroy(l) ((void)(l))
+#define split_lock(l)         ((void)(l))
+#define split_unlock(l)       ((void)(l))
+#endif
+
+/** Decoded header of a package index, the tables point into the loaded section */
+typedef struct
+{
+        const uint8_t *hashes;          // slots signatures
+        const uint8_t *rows;            // slots row numbers, 1-based, 0 for an empty slot
+        const uint8_t *ids;             // DW_SECT_* of each column
+        const uint8_t *offsets;         // units rows of columns offsets
+        const uint8_t *sizes;           // same layout as offsets
+        uint32_t columns;
+        uint32_t units;
+        uint32_t slots;                 // zero or a power of two
+        uint8_t big;
+} SplitIndex;
+
+/** Open split unit, handles given out are pointers to its context */
+typedef struct DwoEntry
+{
+        DwrfCtx ctx;                    // must stay the first member
+        DwrfUnitHeader unit;            // split compilation unit
+        uint64_t id;                    // dwo_id
+        const ElfCtx *elf;              // file opened for the unit, NULL for package units
+        uint32_t refs;                  // holders, the entry isn't evicted meanwhile
+        struct DwoEntry *prev;          // LRU list, most recent first
+        struct DwoEntry *next;
+} DwoEntry;
+
+struct DwrfDwoPool
+{
+        DwrfDwoPoolInfo info;
+        SplitLock lock;                 // guards everything below
+        DwrfMap open;                   // dwo_id -> DwoEntry
+        DwrfMap failed;                 // dwo_id -> DwrfResult of the failed attempt
+        DwoEntry *lru_head;
+        DwoEntry *lru_tail;
+        DwrfDwoPoolStats stats;
+};
+
+/***************
+ *   Package   *
+ ***************/
+
+/** Finds and validates the index of the unit type, its section is loaded on first use. */
+static DwrfResult split_index(InternalDwarfCtx *ctx, uint8_t unit_type, SplitIndex *idx)
+{
+        DwrfSection *sec;
+        const uint8_t *p;
+        uint64_t version, need;
+        DwrfResult res;
+
+        if (unit_type == DW_UT_split_compile)
+                sec = &ctx->debug_cu_index;
+        else if (unit_type == DW_UT_split_type)
+                sec = &ctx->debug_tu_index;
+        else
+                return DWRF_BAD_ARG;
+
+        if (!sec->present)
+                return DWRF_SEC_MISSING;
+        if ((res = dwrf_load_section(ctx, sec)))
+                return res;
+        if (sec->hdr.Size < SPLIT_INDEX_HEADER)
+                return DWRF_DECODE_ERR;
+
+        p = sec->data;
+        idx->big = (ctx->endianness == ELFDATA2MSB);
+
+        /* version 2 is the GNU extension for DWARF 4, its section identifiers differ */
+        version = load_uN(p, 2, idx->big);
+        if (version != 5)
+                return DWRF_UNSUPPORTED;
+
+        idx->columns = (uint32_t)load_uN(p + 4, 4, idx->big);
+        idx->units = (uint32_t)load_uN(p + 8, 4, idx->big);
+        idx->slots = (uint32_t)load_uN(p + 12, 4, idx->big);
+
+        if ((idx->slots & (idx->slots - 1)) || (idx->units > idx->slots) || ((idx->units != 0) && (idx->columns == 0)))
+                return DWRF_DECODE_ERR;
+
+        /* 64-bit arithmetic can't overflow with 32-bit counts */
+        need = SPLIT_INDEX_HEADER + (uint64_t)idx->slots * 12 + (uint64_t)idx->columns * 4 +
+               2 * (uint64_t)idx->units * idx->columns * 4;
+        if (need > sec->hdr.Size)
+                return DWRF_DECODE_ERR;
+
+        idx->hashes = p + SPLIT_INDEX_HEADER;
+        idx->rows = idx->hashes + (uint64_t)idx->slots * 8;
+        idx->ids = idx->rows + (uint64_t)idx->slots * 4;
+        idx->offsets = idx->ids + (uint64_t)idx->columns * 4;
+        idx->sizes = idx->offsets + (uint64_t)idx->units * idx->columns * 4;
+        return DWRF_OK;
+}
+
+/** Fills the contributions of row "row" (1-based) of the index. */
+static DwrfResult split_row(const SplitIndex *idx, uint32_t row, uint64_t signature, DwrfPackageUnit *unit)
+{
+        uint64_t base = (uint64_t)(row - 1) * idx->columns * 4;
+
+        if ((row == 0) || (row > idx->units))
+                return DWRF_DECODE_ERR;
+
+        *unit = (DwrfPackageUnit){ .Signature = signature };
+        for (uint32_t c = 0; c < idx->columns; c++)
+        {
+                uint64_t id = load_uN(idx->ids + (uint64_t)c * 4, 4, idx->big);
+
+                /* identifiers this version doesn't define are skipped */
+                if ((id == 0) || (id >= DWRF_PACKAGE_SECTIONS))
+                        continue;
+
+                unit->Sections[id].Offset = load_uN(idx->offsets + base + (uint64_t)c * 4, 4, idx->big);
+                unit->Sections[id].Size = load_uN(idx->sizes + base + (uint64_t)c * 4, 4, idx->big);
+        }
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_package_find(DwrfCtx *pkg, uint8_t unit_type, uint64_t signature, DwrfPackageUnit *unit)
+{
+        SplitIndex idx;
+        DwrfResult res;
+        uint32_t mask, h, step;
+
+        if (validate_ctx(pkg))
+                return DWRF_UNINIT;
+
+        if (unit == NULL)
+                return DWRF_BAD_ARG;
+
+        if ((res = split_index(CTX(pkg), unit_type, &idx)))
+                return res;
+        if (idx.slots == 0)
+                return DWRF_NOT_FOUND;
+
+        /* open addressing, the step comes from the upper half of the signature and is odd so every slot is probed */
+        mask = idx.slots - 1;
+        h = (uint32_t)(signature & mask);
+        step = (uint32_t)((signature >> 32) & mask) | 1;
+
+        for (uint32_t i = 0; i < idx.slots; i++)
+        {
+                uint32_t row = (uint32_t)load_uN(idx.rows + (uint64_t)h * 4, 4, idx.big);
+
+                if (row == 0)
+                        return DWRF_NOT_FOUND;
+                if (load_uN(idx.hashes + (uint64_t)h * 8, 8, idx.big) == signature)
+                        return split_row(&idx, row, signature, unit);
+
+                h = (h + step) & mask;
+        }
+        return DWRF_NOT_FOUND;
+}
+
+DwrfResult dwarf_package_units(DwrfCtx *pkg, uint8_t unit_type, DwrfPackageUnit *units, uint32_t max,
+                               uint32_t *count)
+{
+        SplitIndex idx;
+        DwrfResult res;
+        uint32_t n = 0;
+
+        if (validate_ctx(pkg))
+                return DWRF_UNINIT;
+
+        if ((count == NULL) || ((units == NULL) && (max != 0)))
+                return DWRF_BAD_ARG;
+
+        if ((res = split_index(CTX(pkg), unit_type, &idx)))
+                return res;
+
+        /* the signatures are only in the hash table, rows are reported in slot order */
+        for (uint32_t h = 0; h < idx.slots; h++)
+        {
+                uint32_t row = (uint32_t)load_uN(idx.rows + (uint64_t)h * 4, 4, idx.big);
+
+                if (row == 0)
+                        continue;
+                if ((n < max) && (res = split_row(&idx, row, load_uN(idx.hashes + (uint64_t)h * 8, 8, idx.big), &units[n])))
+                        return res;
+                n++;
+        }
+
+        *count = n;
+        return (n > max) ? DWRF_BUFFER_OVERFLOW : DWRF_OK;
+}
+
+/** Section of the unit context covering bytes [offset, offset + size) of a loaded package section. */
+static void split_view(DwrfSection *view, const DwrfSection *sec, uint64_t offset, uint64_t size)
+{
+        *view = (DwrfSection){0};
+        view->hdr = sec->hdr;
+        view->hdr.Offset += offset;
+        view->hdr.Size = size;
+        view->data = sec->data + offset;
+        view->present = true;
+        view->dwo = sec->dwo;
+}
+
+DwrfResult dwarf_package_open_unit(DwrfCtx *pkg, const DwrfPackageUnit *unit, DwrfCtx *ctx)
+{
+        /* package section of each DW_SECT_* column */
+        static const int8_t slots[DWRF_PACKAGE_SECTIONS] = {
+                [0] = -1, [2] = -1,
+                [DW_SECT_info] = DWRF_SEC_INFO,
+                [DW_SECT_abbrev] = DWRF_SEC_ABBREV,
+                [DW_SECT_line] = DWRF_SEC_LINE,
+                [DW_SECT_loclists] = DWRF_SEC_LOCLISTS,
+                [DW_SECT_str_offsets] = DWRF_SEC_STR_OFFSETS,
+                [DW_SECT_macro] = DWRF_SEC_MACRO,
+                [DW_SECT_rnglists] = DWRF_SEC_RNGLISTS,
+        };
+        InternalDwarfCtx *p, *v;
+        DwrfResult res;
+
+        if (validate_ctx(pkg))
+                return DWRF_UNINIT;
+
+        if ((unit == NULL) || (ctx == NULL) || (unit->Sections[DW_SECT_info].Size == 0))
+                return DWRF_BAD_ARG;
+
+        p = CTX(pkg);
+        v = CTX(ctx);
+
+        /* the strings are shared by every unit, the rest is cut to the contributions */
+        if ((res = dwrf_load_section(p, &p->debug_str)))
+                return res;
+
+        for (uint32_t s = 1; s < DWRF_PACKAGE_SECTIONS; s++)
+        {
+                const DwrfContribution *c = &unit->Sections[s];
+                DwrfSection *sec;
+
+                if ((slots[s] < 0) || (c->Size == 0))
+                        continue;
+
+                sec = &p->sections[slots[s]];
+                if (!sec->present)
+                        return DWRF_SEC_MISSING;
+                if ((res = dwrf_load_section(p, sec)))
+                        return res;
+                if ((c->Offset > sec->hdr.Size) || (c->Size > sec->hdr.Size - c->Offset))
+                        return DWRF_DECODE_ERR;
+        }
+
+        *v = (InternalDwarfCtx){
+                .elf = p->elf,
+                .endianness = p->endianness,
+                .image = p->image,
+                .image_size = p->image_size,
+                .sup = p->sup,
+                .split = true,
+        };
+
+        split_view(&v->debug_str, &p->debug_str, 0, p->debug_str.hdr.Size);
+        for (uint32_t s = 1; s < DWRF_PACKAGE_SECTIONS; s++)
+        {
+                if ((slots[s] >= 0) && (unit->Sections[s].Size != 0))
+                        split_view(&v->sections[slots[s]], &p->sections[slots[s]], unit->Sections[s].Offset,
+                                   unit->Sections[s].Size);
+        }
+
+        /* an empty abbreviation table is still a table */
+        if (!v->debug_abbrev.present)
+                split_view(&v->debug_abbrev, &p->debug_abbrev, 0, 0);
+
+        v->initialized = true;
+        return DWRF_OK;
+}
+
+/***************
+ *    Links    *
+ ***************/
+
+DwrfResult dwarf_split_link(DwrfCtx *split, DwrfCtx *ctx, const DwrfUnitHeader *skeleton)
+{
+        const DwrfUnitBases *bases;
+        InternalDwarfCtx *s, *c;
+        DwrfResult res;
+
+        if (validate_ctx(split) || validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if ((skeleton == NULL) || (skeleton->UnitType != DW_UT_skeleton) || !CTX(split)->split)
+                return DWRF_BAD_ARG;
+
+        s = CTX(split);
+        c = CTX(ctx);
+        if ((res = dwrf_unit_bases(c, skeleton, &bases)))
+                return res;
+
+        dwrf_section_release(&s->debug_addr);
+        s->debug_addr = (DwrfSection){0};
+        if (c->debug_addr.present)
+        {
+                if ((res = dwrf_load_section(c, &c->debug_addr)))
+                        return res;
+                split_view(&s->debug_addr, &c->debug_addr, 0, c->debug_addr.hdr.Size);
+        }
+
+        /* bases decoded before the link used the wrong address base, they stay in the arena until dwarf_destroy() */
+        dwrf_map_destroy(&s->unit_bases, NULL);
+        s->skeleton_addr_base = bases->addr_base;
+        s->linked = true;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_set_supplementary(DwrfCtx *ctx, const DwrfCtx *sup)
+{
+        if (validate_ctx(ctx) || ((sup != NULL) && validate_ctx(sup)))
+                return DWRF_UNINIT;
+
+        if (sup == ctx)
+                return DWRF_BAD_ARG;
+
+        CTX(ctx)->sup = sup;
+        return DWRF_OK;
+}
+
+/** Copies the name at the start of the buffer, returns its length with the terminator or 0 if it has none. */
+static uint64_t split_copy_name(const uint8_t *p, uint64_t size, char *path, uint16_t len, DwrfResult *res)
+{
+        const uint8_t *end = memchr(p, '\0', (size_t)size);
+        uint64_t n;
+
+        if (end == NULL)
+        {
+                *res = DWRF_DECODE_ERR;
+                return 0;
+        }
+
+        n = (uint64_t)(end - p) + 1;
+        if (n > len)
+        {
+                memcpy(path, p, len - 1);
+                path[len - 1] = '\0';
+                *res = DWRF_BUFFER_OVERFLOW;
+                return n;
+        }
+
+        memcpy(path, p, (size_t)n);
+        *res = DWRF_OK;
+        return n;
+}
+
+DwrfResult dwarf_supplementary_file(DwrfCtx *ctx, char *path, uint16_t len, uint8_t *id, uint16_t *id_len)
+{
+        const InternalDwarfCtx *c;
+        ElfSecHeader sh;
+        uint8_t *data;
+        uint64_t n, sum_len = 0;
+        const uint8_t *sum = NULL;
+        DwrfResult res;
+        uint8_t gnu;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if ((path == NULL) || (len == 0) || ((id != NULL) && (id_len == NULL)))
+                return DWRF_BAD_ARG;
+
+        c = CTX(ctx);
+        gnu = false;
+        if (get_section_by_name(c->elf, (const uint8_t *)".debug_sup", &sh) != ELF_OK)
+        {
+                if (get_section_by_name(c->elf, (const uint8_t *)".gnu_debugaltlink", &sh) != ELF_OK)
+                        return DWRF_NOT_FOUND;
+                gnu = true;
+        }
+
+        if ((sh.Size < 2) || (sh.Size > UINT32_MAX) || (sh.Type == SHT_NOBITS))
+                return DWRF_DECODE_ERR;
+        if ((data = malloc((size_t)sh.Size)) == NULL)
+                return DWRF_NO_MEM;
+        if (get_section_data(c->elf, &sh, 0, sh.Size, data) != ELF_OK)
+        {
+                free(data);
+                return DWRF_IO_ERR;
+        }
+
+        if (gnu)
+        {
+                /* the path, then the build ID of the file up to the end of the section */
+                n = split_copy_name(data, sh.Size, path, len, &res);
+                sum = data + n;
+                sum_len = sh.Size - n;
+        }
+        else
+        {
+                DwrfBuf b = { data, data + sh.Size, c->endianness == ELFDATA2MSB };
+                uint64_t version, is_sup;
+
+                /* version, is_supplementary, filename, checksum length and checksum */
+                res = buf_uN(&b, 2, &version);
+                if ((res == DWRF_OK) && (version != 5))
+                        res = DWRF_UNSUPPORTED;
+                if (res == DWRF_OK)
+                        res = buf_uN(&b, 1, &is_sup);
+                if ((res == DWRF_OK) && is_sup)
+                        res = DWRF_NOT_FOUND;   // this is the supplementary file itself
+                if (res == DWRF_OK)
+                {
+                        n = split_copy_name(b.p, buf_left(&b), path, len, &res);
+                        if ((res == DWRF_OK) || (res == DWRF_BUFFER_OVERFLOW))
+                        {
+                                DwrfResult name_res = res;
+
+                                b.p += n;
+                                if (((res = buf_uleb(&b, &sum_len)) == DWRF_OK) && (sum_len > buf_left(&b)))
+                                        res = DWRF_DECODE_ERR;
+                                sum = b.p;
+                                if (res == DWRF_OK)
+                                        res = name_res;
+                        }
+                }
+        }
+
+        if ((id != NULL) && ((res == DWRF_OK) || (res == DWRF_BUFFER_OVERFLOW)))
+        {
+                if (sum_len > *id_len)
+                        res = DWRF_BUFFER_OVERFLOW;
+                else
+                        memcpy(id, sum, (size_t)sum_len);
+        }
+        if (id_len != NULL)
+                *id_len = (uint16_t)((sum_len > 0xFFFF) ? 0xFFFF : sum_len);
+
+        free(data);
+        return res;
+}
+
+/***************
+ *    Pool     *
+ ***************/
+
+DwrfResult dwarf_dwo_pool_create(const DwrfDwoPoolInfo *info, DwrfDwoPool **pool)
+{
+        DwrfDwoPool *p;
+
+        if ((info == NULL) || (pool == NULL))
+                return DWRF_BAD_ARG;
+
+        if ((info->Package != NULL) && validate_ctx(info->Package))
+                return DWRF_UNINIT;
+
+        if ((p = calloc(1, sizeof(DwrfDwoPool))) == NULL)
+                return DWRF_NO_MEM;
+
+        p->info = *info;
+        if (p->info.MaxOpen == 0)
+                p->info.MaxOpen = SPLIT_DEFAULT_OPEN;
+        split_lock_init(&p->lock);
+
+        *pool = p;
+        return DWRF_OK;
+}
+
+static void dwo_entry_free(DwrfDwoPool *pool, DwoEntry *e)
+{
+        dwarf_destroy(&e->ctx);
+        if ((e->elf != NULL) && (pool->info.Close != NULL))
+                pool->info.Close(pool->info.User, e->elf);
+        free(e);
+}
+
+void dwarf_dwo_pool_destroy(DwrfDwoPool *pool)
+{
+        DwoEntry *e, *next;
+
+        if (pool == NULL)
+                return;
+
+        for (e = pool->lru_head; e != NULL; e = next)
+        {
+                next = e->next;
+                dwo_entry_free(pool, e);
+        }
+
+        dwrf_map_destroy(&pool->open, NULL);
+        dwrf_map_destroy(&pool->failed, NULL);
+        split_lock_destroy(&pool->lock);
+        free(pool);
+}
+
+static void dwo_lru_unlink(DwrfDwoPool *pool, DwoEntry *e)
+{
+        if (e->prev)
+                e->prev->next = e->next;
+        else
+                pool->lru_head = e->next;
+
+        if (e->next)
+                e->next->prev = e->prev;
+        else
+                pool->lru_tail = e->prev;
+
+        e->prev = NULL;
+        e->next = NULL;
+}
+
+static void dwo_lru_push(DwrfDwoPool *pool, DwoEntry *e)
+{
+        e->prev = NULL;
+        e->next = pool->lru_head;
+        if (pool->lru_head)
+                pool->lru_head->prev = e;
+        else
+                pool->lru_tail = e;
+        pool->lru_head = e;
+}
+
+/** Closes the least recently used handles nobody holds until MaxOpen are left, caller holds the lock. */
+static void dwo_evict(DwrfDwoPool *pool)
+{
+        DwoEntry *e = pool->lru_tail;
+
+        while ((pool->stats.Resident > pool->info.MaxOpen) && (e != NULL))
+        {
+                DwoEntry *prev = e->prev;
+
+                if (e->refs == 0)
+                {
+                        dwo_lru_unlink(pool, e);
+                        dwrf_map_remove(&pool->open, e->id);
+                        pool->stats.Resident--;
+                        pool->stats.Evictions++;
+                        dwo_entry_free(pool, e);
+                }
+                e = prev;
+        }
+}
+
+/** Path of the .dwo named by the skeleton unit DIE, relative names are joined with the compilation directory. */
+static DwrfResult dwo_path(DwrfCtx *ctx, const DwrfUnitHeader *skeleton, char *path)
+{
+        enum { NAME, GNU_NAME, COMP_DIR, COUNT };
+        static const uint16_t names[COUNT] = { DW_AT_dwo_name, DW_AT_GNU_dwo_name, DW_AT_comp_dir };
+        DwrfAttr attrs[COUNT];
+        DwrfAttr *name;
+        DwrfCursor cur;
+        DwrfResult res;
+        size_t dir_len;
+
+        if ((res = dwarf_cursor_init(ctx, &cur)) || (res = dwarf_cursor_seek_unit(&cur, skeleton->Offset)) ||
+            (res = dwarf_cursor_next(&cur, NULL)) || (res = dwarf_cursor_get_attrs(&cur, names, COUNT, attrs)))
+                return (res == DWRF_END) ? DWRF_NOT_FOUND : res;
+
+        name = (attrs[NAME].Form != 0) ? &attrs[NAME] : &attrs[GNU_NAME];
+        if (name->Form == 0)
+                return DWRF_NOT_FOUND;
+
+        path[0] = '\0';
+        dir_len = 0;
+        if ((attrs[COMP_DIR].Form != 0) && ((res = dwarf_cursor_resolve(&cur, &attrs[COMP_DIR])) == DWRF_OK) &&
+            (dwarf_get_string(ctx, &attrs[COMP_DIR], (uint8_t *)path, SPLIT_PATH_MAX) == DWRF_OK))
+                dir_len = strlen(path);
+
+        if ((res = dwarf_cursor_resolve(&cur, name)) ||
+            (res = dwarf_get_string(ctx, name, (uint8_t *)path + dir_len + 1, (uint16_t)(SPLIT_PATH_MAX - dir_len - 1))))
+                return res;
+
+        /* absolute names are used as they are */
+        if ((dir_len == 0) || (path[dir_len + 1] == '/'))
+                memmove(path, path + dir_len + 1, strlen(path + dir_len + 1) + 1);
+        else
+                path[dir_len] = '/';
+        return DWRF_OK;
+}
+
+/** Opens the unit from the package, NOT_FOUND if it isn't there. */
+static DwrfResult dwo_open_package(DwrfDwoPool *pool, DwoEntry *e)
+{
+        DwrfPackageUnit unit;
+        DwrfResult res;
+
+        if (pool->info.Package == NULL)
+                return DWRF_NOT_FOUND;
+
+        res = dwarf_package_find(pool->info.Package, DW_UT_split_compile, e->id, &unit);
+        if (res == DWRF_SEC_MISSING)
+                res = DWRF_NOT_FOUND;
+        if (res)
+                return res;
+
+        return dwarf_package_open_unit(pool->info.Package, &unit, &e->ctx);
+}
+
+static DwrfResult dwo_open_file(DwrfDwoPool *pool, DwoEntry *e, const char *path)
+{
+        const void *image = NULL;
+        uint64_t size = 0;
+        DwrfResult res;
+
+        if (pool->info.Open == NULL)
+                return DWRF_NOT_FOUND;
+
+        if ((res = pool->info.Open(pool->info.User, path, &e->elf, &image, &size)))
+        {
+                e->elf = NULL;
+                return res;
+        }
+
+        if ((res = dwarf_init(e->elf, &e->ctx)))
+                return res;
+        if ((image != NULL) && (res = dwarf_set_image(&e->ctx, image, size)))
+                return res;
+
+        /* a regular object file named like the .dwo has no split units */
+        return CTX(&e->ctx)->split ? DWRF_OK : DWRF_NOT_FOUND;
+}
+
+/** Finds the split compilation unit of the skeleton among the units of the context. */
+static DwrfResult dwo_find_unit(DwoEntry *e)
+{
+        uint64_t off = 0;
+        DwrfResult res;
+
+        while ((res = dwarf_get_unit_header(&e->ctx, off, &e->unit)) == DWRF_OK)
+        {
+                if ((e->unit.UnitType == DW_UT_split_compile) && (e->unit.Signature == e->id))
+                        return DWRF_OK;
+                off = e->unit.NextOffset;
+        }
+        return (res == DWRF_BAD_ARG) ? DWRF_NOT_FOUND : res;
+}
+
+/** Opens, links and prepares the split unit of the skeleton, caller holds the lock. */
+static DwrfResult dwo_open(DwrfDwoPool *pool, DwrfCtx *ctx, const DwrfUnitHeader *skeleton, const char *path,
+                           DwoEntry **out)
+{
+        DwoEntry *e = calloc(1, sizeof(DwoEntry));
+        DwrfResult res;
+
+        if (e == NULL)
+                return DWRF_NO_MEM;
+
+        e->id = skeleton->Signature;
+        res = dwo_open_package(pool, e);
+        if ((res == DWRF_NOT_FOUND) && (path != NULL))
+                res = dwo_open_file(pool, e, path);
+
+        /* the bases of the split unit need the link, the cursors of the holders need the preparation */
+        if (res == DWRF_OK)
+                res = dwo_find_unit(e);
+        if (res == DWRF_OK)
+                res = dwarf_split_link(&e->ctx, ctx, skeleton);
+        if (res == DWRF_OK)
+                res = dwrf_prepare_workers(CTX(&e->ctx));
+
+        if (res)
+        {
+                dwo_entry_free(pool, e);
+                return res;
+        }
+        *out = e;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_dwo_acquire(DwrfDwoPool *pool, DwrfCtx *ctx, const DwrfUnitHeader *skeleton, DwrfCtx **split,
+                             DwrfUnitHeader *unit)
+{
+        char path[SPLIT_PATH_MAX];
+        DwrfResult res, path_res;
+        DwoEntry *e;
+        void *failed;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if ((pool == NULL) || (skeleton == NULL) || (split == NULL) || (unit == NULL))
+                return DWRF_BAD_ARG;
+
+        if (skeleton->UnitType != DW_UT_skeleton)
+                return DWRF_BAD_ARG;
+
+        for (int pass = 0; pass < 2; pass++)
+        {
+                split_lock(&pool->lock);
+                if ((e = dwrf_map_get(&pool->open, skeleton->Signature)) != NULL)
+                {
+                        e->refs++;
+                        dwo_lru_unlink(pool, e);
+                        dwo_lru_push(pool, e);
+                        pool->stats.Hits++;
+                        split_unlock(&pool->lock);
+
+                        *split = &e->ctx;
+                        *unit = e->unit;
+                        return DWRF_OK;
+                }
+                if ((failed = dwrf_map_get(&pool->failed, skeleton->Signature)) != NULL)
+                {
+                        split_unlock(&pool->lock);
+                        return (DwrfResult)(uintptr_t)failed;
+                }
+                if (pass == 1)
+                        break;
+                split_unlock(&pool->lock);
+
+                /* the skeleton is read outside the lock, with the caller's context */
+                path_res = (pool->info.Open != NULL) ? dwo_path(ctx, skeleton, path) : DWRF_NOT_FOUND;
+                if ((path_res != DWRF_OK) && (path_res != DWRF_NOT_FOUND))
+                        return path_res;
+        }
+
+        /* still holding the lock, nobody opened it meanwhile */
+        res = dwo_open(pool, ctx, skeleton, (path_res == DWRF_OK) ? path : NULL, &e);
+        if (res == DWRF_OK)
+        {
+                if ((res = dwrf_map_put(&pool->open, e->id, e)))
+                {
+                        dwo_entry_free(pool, e);
+                }
+                else
+                {
+                        e->refs = 1;
+                        dwo_lru_push(pool, e);
+                        pool->stats.Opens++;
+                        pool->stats.Resident++;
+                        dwo_evict(pool);
+
+                        *split = &e->ctx;
+                        *unit = e->unit;
+                }
+        }
+        else if (res != DWRF_NO_MEM)
+        {
+                /* remembered so lookups of the unit don't search again, the map can't hold a zero */
+                pool->stats.Failures++;
+                dwrf_map_put(&pool->failed, skeleton->Signature, (void *)(uintptr_t)res);
+        }
+        split_unlock(&pool->lock);
+        return res;
+}
+
+void dwarf_dwo_release(DwrfDwoPool *pool, DwrfCtx *split)
+{
+        DwoEntry *e = (DwoEntry *)split;
+
+        if ((pool == NULL) || (split == NULL))
+                return;
+
+        split_lock(&pool->lock);
+        if (e->refs > 0)
+                e->refs--;
+        dwo_evict(pool);
+        split_unlock(&pool->lock);
+}
+
+DwrfResult dwarf_dwo_pool_stats(DwrfDwoPool *pool, DwrfDwoPoolStats *stats)
+{
+        if ((pool == NULL) || (stats == NULL))
+                return DWRF_BAD_ARG;
+
+        split_lock(&pool->lock);
+        *stats = pool->stats;
+        split_unlock(&pool->lock);
+        return DWRF_OK;
+}
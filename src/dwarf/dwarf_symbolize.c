@@ -0,0 +1,1438 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(DWRF_NO_THREADS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // pthreads
+#endif
+
+#include "dwarf_internal.h"
+#include "common/elf_repr.h"
+
+#ifndef DWRF_NO_THREADS
+#include <pthread.h>
+#endif
+
+/***************
+ * Symbolizer  *
+ ***************/
+ // sections 3.3.8 (inlined subroutines) and 6.2 (line tables) of spec v5
+
+#define SYM_NONE         UINT32_MAX     // no scope / end of a list
+#define SYM_MAX_FRAMES   64u            // frames kept per address, longer inline chains lose their outer frames
+#define SYM_SHARDS       16u
+#define SYM_MAX_HOPS     8u             // abstract_origin and specification links followed to find a name
+#define SYM_PATH_MAX     4096u
+
+#ifndef DWRF_NO_THREADS
+typedef pthread_mutex_t SymLock;
+#define sym_lock_init(l)    pthread_mutex_init((l), NULL)
+#define sym_lock_destroy(l) pthread_mutex_destroy(l)
+#define sym_lock(l)         pthread_mutex_lock(l)
+#define sym_unlock(l)       pthread_mutex_unlock(l)
+#else
+typedef uint8_t SymLock;
+#define sym_lock_init(l)    ((void)(l))
+#define sym_lock_destroy(l) ((void)(l))
+#define sym_lock(l)         ((void)(l))
+#define sym_unlock(l)       ((void)(l))
+#endif
+
+/** Function symbol of the ELF symbol table */
+typedef struct
+{
+        uint64_t addr;
+        uint64_t size;          // 0 when unknown, the symbol then extends to the next one
+        const char *name;       // points into the loaded string table
+        uint8_t rank;           // preference among symbols at the same address, lower wins
+} SymSymbol;
+
+/** Subprogram or inlined subroutine that has code */
+typedef struct
+{
+        const char *name;
+        const char *linkage;
+        const char *call_file;  // call site of an inlined subroutine, interned path
+        uint32_t call_line;
+        uint32_t parent;        // scope the subroutine was inlined into, SYM_NONE for subprograms
+        uint16_t call_column;
+        uint8_t inlined;
+} SymScope;
+
+/** Addresses from start up to the start of the next segment, "scope" is the innermost scope covering them */
+typedef struct
+{
+        uint64_t start;
+        uint32_t scope;         // SYM_NONE outside any function
+} SymSegment;
+
+/** Lookup state of one unit, loaded on first use */
+typedef struct SymUnit
+{
+        DwrfBudgetItem item;    // first, the budget hands it back to sym_unit_evict(). refs counts the lookups reading it
+        DwrfSymbolizer *sym;
+        uint64_t offset;        // unit header in .debug_info
+        DwrfLineTable *lines;   // NULL if the unit has no line program
+        const char **paths;     // interned path of every file of the line table
+        SymScope *scopes;
+        SymSegment *segs;
+        uint32_t seg_count;
+        DwrfArena arena;        // holds the unit and its tables
+} SymUnit;
+
+/** Cached frames of an address */
+typedef struct
+{
+        uint64_t addr;
+        uint32_t prev;          // LRU list of the shard, most recent first
+        uint32_t next;
+        uint32_t chain;         // next entry of the same bucket
+        uint32_t count;         // 0 for addresses nothing is known about
+        DwrfFrame *frames;
+} SymEntry;
+
+typedef struct
+{
+        SymLock lock;
+        SymEntry *entries;
+        uint32_t *buckets;      // first entry of each bucket
+        uint32_t mask;          // buckets - 1
+        uint32_t capacity;
+        uint32_t used;
+        uint32_t head;
+        uint32_t tail;
+        uint64_t hits;
+        uint64_t misses;
+} SymShard;
+
+/** Interned path, chained with the others of the same hash */
+typedef struct SymPath
+{
+        struct SymPath *next;
+        char str[];
+} SymPath;
+
+struct DwrfSymbolizer
+{
+        DwrfCtx snapshot;       // prepared copy of the context, each unit load works on a copy of it
+        DwrfAddrIndex *index;   // address -> unit
+        uint64_t *units;        // offsets of the unit headers in section order
+        uint64_t unit_count;
+        SymSymbol *symbols;     // sorted by address, one per address
+        uint64_t symbol_count;
+        char *strtab;
+        DwrfDwoPool *dwo;       // split units of the skeletons, NULL to not follow them
+
+        DwrfMemBudget *budget;  // the units are charged to it, its lock guards the fields up to evictions
+        DwrfMemBudget *own_budget;      // private budget, NULL while sharing one
+        uint64_t limit;         // of the private budget
+        DwrfMap loaded;         // unit offset -> SymUnit
+        uint64_t used;
+        uint64_t loads;
+        uint64_t evictions;
+
+        SymLock path_lock;
+        DwrfMap paths;          // hash -> SymPath
+        DwrfArena path_arena;
+
+        uint32_t shard_count;   // 0 when the cache is disabled
+        SymShard shards[SYM_SHARDS];
+};
+
+/* attributes read from subprograms and inlined subroutines, the name ones also from the DIEs they refer to */
+enum { NA_NAME, NA_LINKAGE, NA_MIPS_LINKAGE, NA_ORIGIN, NA_SPEC, NA_COUNT };
+enum { SA_LOW, SA_HIGH, SA_RANGES, SA_CALL_FILE, SA_CALL_LINE, SA_CALL_COLUMN, SA_NAMES, SA_COUNT = SA_NAMES + NA_COUNT };
+
+static const uint16_t name_attrs[NA_COUNT] = {
+        DW_AT_name, DW_AT_linkage_name, DW_AT_MIPS_linkage_name, DW_AT_abstract_origin, DW_AT_specification,
+};
+
+static const uint16_t scope_attrs[SA_COUNT] = {
+        DW_AT_low_pc, DW_AT_high_pc, DW_AT_ranges, DW_AT_call_file, DW_AT_call_line, DW_AT_call_column,
+        DW_AT_name, DW_AT_linkage_name, DW_AT_MIPS_linkage_name, DW_AT_abstract_origin, DW_AT_specification,
+};
+
+typedef struct
+{
+        const char *name;
+        const char *linkage;
+} SymName;
+
+typedef struct
+{
+        uint64_t low;
+        uint64_t high;
+        uint32_t scope;
+        uint32_t depth;         // of the DIE, parents sort before the children starting at the same address
+} SymRange;
+
+/** Scratch state of a unit load */
+typedef struct
+{
+        DwrfCtx ctx;            // private copy of the snapshot
+        DwrfCursor cur;         // walks the unit
+        DwrfCursor ref;         // reads the DIEs the names come from
+        DwrfSymbolizer *sym;
+        SymUnit *u;             // scratch copy, its tables are moved to the arena of the unit at the end
+        SymUnit scratch;
+        DwrfUnitHeader unit;
+        const DwrfUnitBases *bases;
+        uint32_t file_count;
+        DwrfMap names;          // DIE offset -> SymName of the DIEs reached through references
+        DwrfArena arena;
+        SymRange *ranges;
+        uint64_t range_count;
+        uint64_t range_cap;
+        uint32_t scope_count;
+        uint32_t scope_cap;
+        uint32_t *enclosing;    // innermost scope at each DIE depth
+        uint32_t depth_cap;
+        uint32_t range_scope;   // scope and depth of the ranges being added
+        uint32_t range_depth;
+        uint8_t split;          // walking the split unit of a skeleton, its strings don't outlive the load
+        char path[SYM_PATH_MAX];
+} SymLoader;
+
+/***************
+ *   Symbols   *
+ ***************/
+
+static int sym_symbol_cmp(const void *a, const void *b)
+{
+        const SymSymbol *x = a;
+        const SymSymbol *y = b;
+
+        if (x->addr != y->addr)
+                return (x->addr > y->addr) ? 1 : -1;
+        if (x->rank != y->rank)
+                return (x->rank > y->rank) ? 1 : -1;
+        return (x->size < y->size) - (x->size > y->size);
+}
+
+/** Indexes the function symbols of .symtab, or .dynsym when the file is stripped. */
+static DwrfResult sym_load_symbols(DwrfSymbolizer *s, const ElfCtx *elf)
+{
+        ElfSecHeader tab = {0}, strs, hdr;
+        ElfSymTabEntry entry;
+        uint32_t count, sections = get_section_count(elf);
+        uint64_t n = 0;
+
+        for (uint32_t i = 1; i < sections; i++)
+        {
+                if (get_section_header(elf, i, &hdr) != ELF_OK)
+                        continue;
+                if ((hdr.Type == SHT_SYMTAB) || ((hdr.Type == SHT_DYNSYM) && (tab.Type != SHT_DYNSYM)))
+                        tab = hdr;
+                if (tab.Type == SHT_SYMTAB)
+                        break;
+        }
+
+        if (((count = get_symbol_count(elf, &tab)) == 0) || (get_section_header(elf, tab.Link, &strs) != ELF_OK))
+                return DWRF_OK;
+
+        s->strtab = malloc((size_t)strs.Size + 1);
+        s->symbols = malloc((size_t)count * sizeof(SymSymbol));
+        if ((s->strtab == NULL) || (s->symbols == NULL))
+                return DWRF_NO_MEM;
+
+        if (get_section_data(elf, &strs, 0, strs.Size, s->strtab) != ELF_OK)
+                return DWRF_IO_ERR;
+        s->strtab[strs.Size] = '\0';
+
+        for (uint32_t i = 1; i < count; i++)
+        {
+                if (get_symbol_entry(elf, &tab, i, &entry) != ELF_OK)
+                        return DWRF_IO_ERR;
+
+                /* STT_LOOS is STT_GNU_IFUNC, undefined and absolute symbols have no code */
+                if (((entry.Type != STT_FUNC) && (entry.Type != STT_LOOS)) || (entry.SecIdx == SHN_UNDEF) ||
+                    ((entry.SecIdx >= SHN_LORESERVE) && (entry.SecIdx != SHN_XINDEX)) ||
+                    (entry.NameIdx == 0) || (entry.NameIdx >= strs.Size))
+                        continue;
+
+                s->symbols[n++] = (SymSymbol){
+                        entry.Value, entry.Size, s->strtab + entry.NameIdx,
+                        (entry.Binding == STB_GLOBAL) ? 0 : (entry.Binding == STB_WEAK) ? 1 : 2,
+                };
+        }
+
+        /* aliases: the global one with the largest size names the address */
+        qsort(s->symbols, (size_t)n, sizeof(SymSymbol), sym_symbol_cmp);
+        s->symbol_count = 0;
+        for (uint64_t i = 0; i < n; i++)
+        {
+                if ((s->symbol_count == 0) || (s->symbols[s->symbol_count - 1].addr != s->symbols[i].addr))
+                        s->symbols[s->symbol_count++] = s->symbols[i];
+        }
+        return DWRF_OK;
+}
+
+static const SymSymbol *sym_find_symbol(const DwrfSymbolizer *s, uint64_t addr)
+{
+        uint64_t lo = 0, hi = s->symbol_count;
+        const SymSymbol *sym;
+
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (s->symbols[mid].addr <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if (lo == 0)
+                return NULL;
+
+        sym = &s->symbols[lo - 1];
+        if ((sym->size != 0) && (addr - sym->addr >= sym->size))
+                return NULL;
+        return sym;
+}
+
+/***************
+ *    Paths    *
+ ***************/
+
+static uint64_t sym_hash_str(const char *str)
+{
+        uint64_t h = 0xcbf29ce484222325ULL;     // FNV-1a
+
+        while (*str)
+                h = (h ^ (uint8_t)*str++) * 0x100000001b3ULL;
+        return h;
+}
+
+/** Stable copy of a path shared by every unit, caller holds path_lock. */
+static const char *sym_intern(DwrfSymbolizer *s, const char *path)
+{
+        uint64_t h = sym_hash_str(path);
+        SymPath *head = dwrf_map_get(&s->paths, h);
+        size_t len = strlen(path);
+        SymPath *p;
+
+        for (p = head; p != NULL; p = p->next)
+        {
+                if (strcmp(p->str, path) == 0)
+                        return p->str;
+        }
+
+        if ((p = dwarf_arena_alloc(&s->path_arena, sizeof(SymPath) + len + 1)) == NULL)
+                return NULL;
+
+        p->next = head;
+        memcpy(p->str, path, len + 1);
+        if (dwrf_map_put(&s->paths, h, p))
+                return NULL;
+        return p->str;
+}
+
+static DwrfResult sym_load_paths(SymLoader *ld)
+{
+        DwrfSymbolizer *s = ld->sym;
+        SymUnit *u = ld->u;
+        DwrfResult res = DWRF_OK;
+
+        if (ld->file_count == 0)
+                return DWRF_OK;
+
+        if ((u->paths = calloc(ld->file_count, sizeof(const char *))) == NULL)
+                return DWRF_NO_MEM;
+
+        sym_lock(&s->path_lock);
+        for (uint32_t f = 0; (f < ld->file_count) && (res == DWRF_OK); f++)
+        {
+                if (dwarf_line_file_path(u->lines, f, ld->path, sizeof(ld->path)) != DWRF_OK)
+                        continue;
+                if ((u->paths[f] = sym_intern(s, ld->path)) == NULL)
+                        res = DWRF_NO_MEM;
+        }
+        sym_unlock(&s->path_lock);
+        return res;
+}
+
+/***************
+ *    Names    *
+ ***************/
+
+/** String of a name attribute in place in its section, NULL if the DIE doesn't have it. */
+static const char *sym_str(SymLoader *ld, DwrfCursor *cur, DwrfAttr *attr)
+{
+        const InternalDwarfCtx *ctx = CTX(&ld->ctx);
+        const DwrfSection *sec;
+
+        if ((attr->Form == 0) || (dwarf_cursor_resolve(cur, attr) != DWRF_OK))
+                return NULL;
+
+        switch (attr->Form)
+        {
+        case DW_FORM_strp:
+                sec = &ctx->debug_str;
+                break;
+        case DW_FORM_line_strp:
+                sec = &ctx->debug_line_str;
+                break;
+        case DW_FORM_string:
+                sec = &ctx->debug_info;
+                break;
+        default:
+                return NULL;
+        }
+
+        if ((sec->data == NULL) || (attr->Value >= sec->hdr.Size) ||
+            (memchr(sec->data + attr->Value, 0, sec->hdr.Size - attr->Value) == NULL))
+                return NULL;
+        return (const char *)sec->data + attr->Value;
+}
+
+/** Offset in .debug_info of the DIE a reference attribute points to. */
+static DwrfResult sym_ref_offset(DwrfCursor *cur, const DwrfAttr *attr, uint64_t *offset)
+{
+        DwrfUnitHeader unit;
+        DwrfResult res;
+
+        switch (attr->Form)
+        {
+        case DW_FORM_ref1:
+        case DW_FORM_ref2:
+        case DW_FORM_ref4:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_udata:
+                if ((res = dwarf_cursor_unit(cur, &unit)))
+                        return res;
+                *offset = unit.Offset + attr->Value;
+                return DWRF_OK;
+        case DW_FORM_ref_addr:
+                *offset = attr->Value;
+                return DWRF_OK;
+        default:
+                return DWRF_UNSUPPORTED;        // type signatures and supplementary files
+        }
+}
+
+/** Places the reference cursor on a DIE, references into other units (LTO) find their unit by binary search. */
+static DwrfResult sym_seek_ref(SymLoader *ld, uint64_t offset)
+{
+        const DwrfSymbolizer *s = ld->sym;
+        DwrfUnitHeader unit;
+        DwrfResult res;
+
+        if ((dwarf_cursor_unit(&ld->ref, &unit) != DWRF_OK) || (offset < unit.DieOffset) || (offset >= unit.NextOffset))
+        {
+                uint64_t lo = 0, hi = s->unit_count;
+
+                /* the unit offsets are those of the skeletons' file */
+                if (ld->split)
+                        return DWRF_BAD_ARG;
+
+                while (lo < hi)
+                {
+                        uint64_t mid = lo + (hi - lo) / 2;
+                        if (s->units[mid] <= offset)
+                                lo = mid + 1;
+                        else
+                                hi = mid;
+                }
+                if (lo == 0)
+                        return DWRF_BAD_ARG;
+                if ((res = dwarf_cursor_seek_unit(&ld->ref, s->units[lo - 1])))
+                        return res;
+        }
+        return dwarf_cursor_seek_die(&ld->ref, offset, NULL);
+}
+
+static DwrfResult sym_ref_names(SymLoader *ld, uint64_t offset, uint32_t hops, SymName *out);
+
+/**
+ * Names of a DIE from its name attributes. Concrete instances of inline functions and out of line
+ * definitions of methods miss some, they come from the DIE they point to.
+ */
+static void sym_names(SymLoader *ld, DwrfCursor *cur, DwrfAttr *attrs, uint32_t hops, SymName *out)
+{
+        DwrfAttr *ref = (attrs[NA_ORIGIN].Form != 0) ? &attrs[NA_ORIGIN] : &attrs[NA_SPEC];
+        uint64_t offset;
+        SymName up;
+
+        out->name = sym_str(ld, cur, &attrs[NA_NAME]);
+        out->linkage = sym_str(ld, cur, &attrs[NA_LINKAGE]);
+        if (out->linkage == NULL)
+                out->linkage = sym_str(ld, cur, &attrs[NA_MIPS_LINKAGE]);
+
+        /* the reference is decoded before the cursor moves, cur may be the reference cursor */
+        if (((out->name == NULL) || (out->linkage == NULL)) && (ref->Form != 0) && (hops < SYM_MAX_HOPS) &&
+            (sym_ref_offset(cur, ref, &offset) == DWRF_OK) && (sym_ref_names(ld, offset, hops + 1, &up) == DWRF_OK))
+        {
+                if (out->name == NULL)
+                        out->name = up.name;
+                if (out->linkage == NULL)
+                        out->linkage = up.linkage;
+        }
+}
+
+static DwrfResult sym_ref_names(SymLoader *ld, uint64_t offset, uint32_t hops, SymName *out)
+{
+        SymName *cached = dwrf_map_get(&ld->names, offset);
+        DwrfAttr attrs[NA_COUNT];
+        DwrfResult res;
+
+        if (cached != NULL)
+        {
+                *out = *cached;
+                return DWRF_OK;
+        }
+
+        if ((res = sym_seek_ref(ld, offset)) || (res = dwarf_cursor_get_attrs(&ld->ref, name_attrs, NA_COUNT, attrs)))
+                return res;
+        sym_names(ld, &ld->ref, attrs, hops, out);
+
+        /* many inlined calls share an abstract origin */
+        if ((cached = dwarf_arena_alloc(&ld->arena, sizeof(SymName))) == NULL)
+                return DWRF_NO_MEM;
+        *cached = *out;
+        return dwrf_map_put(&ld->names, offset, cached);
+}
+
+/** Copies the names of a split unit into the interned strings, its sections go back to the pool after the load. */
+static DwrfResult sym_keep_names(SymLoader *ld, SymName *names)
+{
+        DwrfSymbolizer *s = ld->sym;
+        DwrfResult res = DWRF_OK;
+
+        sym_lock(&s->path_lock);
+        if ((names->name != NULL) && ((names->name = sym_intern(s, names->name)) == NULL))
+                res = DWRF_NO_MEM;
+        if ((names->linkage != NULL) && ((names->linkage = sym_intern(s, names->linkage)) == NULL))
+                res = DWRF_NO_MEM;
+        sym_unlock(&s->path_lock);
+        return res;
+}
+
+/***************
+ *   Scopes    *
+ ***************/
+
+static DwrfResult sym_push_range(void *user, uint64_t low, uint64_t high)
+{
+        SymLoader *ld = user;
+
+        if (low >= high)
+                return DWRF_OK;
+
+        if (ld->range_count == ld->range_cap)
+        {
+                uint64_t cap = ld->range_cap ? ld->range_cap * 2 : 64;
+                SymRange *ranges = realloc(ld->ranges, (size_t)cap * sizeof(SymRange));
+                if (ranges == NULL)
+                        return DWRF_NO_MEM;
+                ld->ranges = ranges;
+                ld->range_cap = cap;
+        }
+
+        ld->ranges[ld->range_count++] = (SymRange){ low, high, ld->range_scope, ld->range_depth };
+        return DWRF_OK;
+}
+
+/** Records a subprogram or inlined subroutine, *scope is left to SYM_NONE if it has no code. */
+static DwrfResult sym_add_scope(SymLoader *ld, const DwrfDie *die, DwrfAttr *attrs, uint32_t parent, uint32_t *scope)
+{
+        uint64_t before = ld->range_count;
+        SymScope *sc;
+        SymName names;
+        DwrfResult res;
+
+        *scope = SYM_NONE;
+        ld->range_scope = ld->scope_count;
+        ld->range_depth = die->Depth;
+
+        if (attrs[SA_RANGES].Form != 0)
+        {
+                if ((res = dwarf_cursor_resolve(&ld->cur, &attrs[SA_RANGES])) ||
+                    (res = dwrf_ranges_for_each(CTX(&ld->ctx), ld->bases, attrs[SA_RANGES].Value, sym_push_range, ld)))
+                        return res;
+        }
+        else if ((attrs[SA_LOW].Form != 0) && (attrs[SA_HIGH].Form != 0))
+        {
+                if ((res = dwarf_cursor_resolve(&ld->cur, &attrs[SA_LOW])) ||
+                    (res = dwarf_cursor_resolve(&ld->cur, &attrs[SA_HIGH])))
+                        return res;
+
+                /* the address class is absolute, constants are an offset from low_pc */
+                if (attrs[SA_HIGH].Form != DW_FORM_addr)
+                        attrs[SA_HIGH].Value += attrs[SA_LOW].Value;
+
+                if ((res = sym_push_range(ld, attrs[SA_LOW].Value, attrs[SA_HIGH].Value)))
+                        return res;
+        }
+
+        if (ld->range_count == before)
+                return DWRF_OK;
+
+        if (ld->scope_count == ld->scope_cap)
+        {
+                uint32_t cap = ld->scope_cap ? ld->scope_cap * 2 : 64;
+                SymScope *scopes;
+
+                if (cap <= ld->scope_cap)
+                        return DWRF_UNSUPPORTED;
+                if ((scopes = realloc(ld->u->scopes, (size_t)cap * sizeof(SymScope))) == NULL)
+                        return DWRF_NO_MEM;
+                ld->u->scopes = scopes;
+                ld->scope_cap = cap;
+        }
+
+        sym_names(ld, &ld->cur, &attrs[SA_NAMES], 0, &names);
+        if (ld->split && (res = sym_keep_names(ld, &names)))
+                return res;
+
+        sc = &ld->u->scopes[ld->scope_count];
+        *sc = (SymScope){ .name = names.name, .linkage = names.linkage, .parent = SYM_NONE };
+
+        if (die->Tag == DW_TAG_inlined_subroutine)
+        {
+                sc->inlined = 1;
+                sc->parent = parent;
+
+                if (attrs[SA_CALL_FILE].Form != 0)
+                {
+                        /* file numbers count from 1 before DWARF 5, as in the line program */
+                        uint64_t file = attrs[SA_CALL_FILE].Value - (ld->unit.Version < 5);
+
+                        if ((file < ld->file_count) && (ld->u->paths != NULL))
+                                sc->call_file = ld->u->paths[file];
+                }
+                if (attrs[SA_CALL_LINE].Form != 0)
+                        sc->call_line = (attrs[SA_CALL_LINE].Value > UINT32_MAX) ? 0 : (uint32_t)attrs[SA_CALL_LINE].Value;
+                if (attrs[SA_CALL_COLUMN].Form != 0)
+                        sc->call_column = (attrs[SA_CALL_COLUMN].Value > 0xFFFF) ? 0xFFFF : (uint16_t)attrs[SA_CALL_COLUMN].Value;
+        }
+
+        *scope = ld->scope_count++;
+        return DWRF_OK;
+}
+
+/** DIEs whose children never hold code */
+static int sym_skip_children(uint16_t tag)
+{
+        switch (tag)
+        {
+        case DW_TAG_array_type:
+        case DW_TAG_enumeration_type:
+        case DW_TAG_subroutine_type:
+        case DW_TAG_formal_parameter:
+        case DW_TAG_variable:
+                return 1;
+        default:
+                return 0;
+        }
+}
+
+/** Walks the unit collecting the subprograms and inlined subroutines that have code, and their ranges. */
+static DwrfResult sym_load_scopes(SymLoader *ld)
+{
+        DwrfAttr attrs[SA_COUNT];
+        DwrfDie die;
+        DwrfResult res;
+
+        if ((res = dwarf_cursor_seek_unit(&ld->cur, ld->unit.Offset)))
+                return res;
+
+        while (((res = dwarf_cursor_next(&ld->cur, &die)) == DWRF_OK) && (die.UnitOffset == ld->unit.Offset))
+        {
+                uint32_t parent, scope;
+
+                if (die.Depth >= ld->depth_cap)
+                {
+                        uint32_t cap = ld->depth_cap ? ld->depth_cap * 2 : 64;
+                        uint32_t *enclosing;
+
+                        while (cap <= die.Depth)
+                                cap *= 2;
+                        if ((enclosing = realloc(ld->enclosing, (size_t)cap * sizeof(uint32_t))) == NULL)
+                                return DWRF_NO_MEM;
+                        ld->enclosing = enclosing;
+                        ld->depth_cap = cap;
+                }
+
+                parent = (die.Depth > 0) ? ld->enclosing[die.Depth - 1] : SYM_NONE;
+                ld->enclosing[die.Depth] = parent;
+
+                if ((die.Tag == DW_TAG_subprogram) || (die.Tag == DW_TAG_inlined_subroutine))
+                {
+                        if ((res = dwarf_cursor_get_attrs(&ld->cur, scope_attrs, SA_COUNT, attrs)) ||
+                            (res = sym_add_scope(ld, &die, attrs, parent, &scope)))
+                                return res;
+
+                        /* declarations and abstract instances, nothing below them runs */
+                        if (scope == SYM_NONE)
+                        {
+                                if (die.HasChildren && (res = dwarf_cursor_skip_children(&ld->cur)))
+                                        return res;
+                                continue;
+                        }
+                        ld->enclosing[die.Depth] = scope;
+                }
+                else if (die.HasChildren && sym_skip_children(die.Tag))
+                {
+                        if ((res = dwarf_cursor_skip_children(&ld->cur)))
+                                return res;
+                }
+        }
+        return ((res == DWRF_OK) || (res == DWRF_END)) ? DWRF_OK : res;
+}
+
+static int sym_range_cmp(const void *a, const void *b)
+{
+        const SymRange *x = a;
+        const SymRange *y = b;
+
+        if (x->low != y->low)
+                return (x->low > y->low) ? 1 : -1;
+        if (x->depth != y->depth)
+                return (x->depth > y->depth) ? 1 : -1;
+        return (x->high < y->high) - (x->high > y->high);
+}
+
+/** Starts a segment at "start", segments are emitted in address order. */
+static void sym_emit(SymUnit *u, uint64_t start, uint32_t scope)
+{
+        if ((u->seg_count > 0) && (u->segs[u->seg_count - 1].start == start))
+        {
+                /* replaces an empty segment, which may make it a continuation of the one before */
+                u->seg_count--;
+        }
+        if ((u->seg_count > 0) && (u->segs[u->seg_count - 1].scope == scope))
+                return;
+        if ((u->seg_count == 0) && (scope == SYM_NONE))
+                return;
+
+        u->segs[u->seg_count++] = (SymSegment){ start, scope };
+}
+
+/**
+ * Flattens the nested ranges into sorted segments that each name their innermost scope, lookups are
+ * then a single binary search. Scopes nest, a range running past the end of its parent is cut there.
+ */
+static DwrfResult sym_build_segments(SymLoader *ld)
+{
+        SymUnit *u = ld->u;
+        SymRange *r = ld->ranges;
+        uint64_t n = ld->range_count;
+        uint64_t *stack, top = 0;
+
+        if (n == 0)
+                return DWRF_OK;
+        if (n >= UINT32_MAX / 2)
+                return DWRF_UNSUPPORTED;
+
+        qsort(r, (size_t)n, sizeof(SymRange), sym_range_cmp);
+
+        stack = malloc((size_t)n * sizeof(uint64_t));
+        u->segs = malloc((size_t)(2 * n) * sizeof(SymSegment));
+        if ((stack == NULL) || (u->segs == NULL))
+        {
+                free(stack);
+                return DWRF_NO_MEM;
+        }
+
+        for (uint64_t i = 0; i < n; i++)
+        {
+                while ((top > 0) && (r[stack[top - 1]].high <= r[i].low))
+                {
+                        uint64_t end = r[stack[--top]].high;
+                        sym_emit(u, end, (top > 0) ? r[stack[top - 1]].scope : SYM_NONE);
+                }
+
+                if ((top > 0) && (r[i].high > r[stack[top - 1]].high))
+                        r[i].high = r[stack[top - 1]].high;
+                if (r[i].low >= r[i].high)
+                        continue;
+
+                stack[top++] = i;
+                sym_emit(u, r[i].low, r[i].scope);
+        }
+        while (top > 0)
+        {
+                uint64_t end = r[stack[--top]].high;
+                sym_emit(u, end, (top > 0) ? r[stack[top - 1]].scope : SYM_NONE);
+        }
+
+        free(stack);
+        return DWRF_OK;
+}
+
+static uint32_t sym_segment_scope(const SymUnit *u, uint64_t addr)
+{
+        uint32_t lo = 0, hi = u->seg_count;
+
+        while (lo < hi)
+        {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (u->segs[mid].start <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        return (lo == 0) ? SYM_NONE : u->segs[lo - 1].scope;
+}
+
+/***************
+ *    Units    *
+ ***************/
+
+static void sym_unit_free(SymUnit *u)
+{
+        DwrfArena arena = u->arena;     // the unit lives in it
+
+        dwarf_line_table_destroy(u->lines);
+        dwrf_arena_destroy(&arena);
+}
+
+/** Budget callback, the budget lock is held and the unit already uncharged. */
+static void sym_unit_evict(DwrfBudgetItem *item)
+{
+        SymUnit *u = (SymUnit *)item;
+        DwrfSymbolizer *s = u->sym;
+
+        dwrf_map_remove(&s->loaded, u->offset);
+        s->used -= item->bytes;
+        s->evictions++;
+        sym_unit_free(u);
+}
+
+/** Releases a unit of the loaded map, the budget lock is held. */
+static void sym_unit_drop(void *unit)
+{
+        SymUnit *u = unit;
+
+        dwrf_budget_remove(u->sym->budget, &u->item);
+        sym_unit_free(u);
+}
+
+/**
+ * Moves the tables the loader built into an arena sized for them, the unit itself included, so that
+ * releasing a unit is a single free besides its line table.
+ */
+static DwrfResult sym_unit_pack(SymLoader *ld, uint64_t line_bytes, SymUnit **out)
+{
+        const SymUnit *tmp = ld->u;
+        size_t paths = (tmp->paths != NULL) ? ld->file_count * sizeof(const char *) : 0;
+        size_t scopes = ld->scope_count * sizeof(SymScope);
+        size_t segs = tmp->seg_count * sizeof(SymSegment);
+        size_t total = dwrf_arena_size(sizeof(SymUnit));
+        DwrfArena arena;
+        SymUnit *u;
+
+        total += (paths ? dwrf_arena_size(paths) : 0) + (scopes ? dwrf_arena_size(scopes) : 0) +
+                 (segs ? dwrf_arena_size(segs) : 0);
+        dwrf_arena_init_sized(&arena, total);
+
+        /* the first allocation gets the whole chunk, the others can't fail */
+        if ((u = dwarf_arena_alloc(&arena, sizeof(SymUnit))) == NULL)
+                return DWRF_NO_MEM;
+
+        *u = *tmp;
+        u->paths = paths ? memcpy(dwarf_arena_alloc(&arena, paths), tmp->paths, paths) : NULL;
+        u->scopes = scopes ? memcpy(dwarf_arena_alloc(&arena, scopes), tmp->scopes, scopes) : NULL;
+        u->segs = segs ? memcpy(dwarf_arena_alloc(&arena, segs), tmp->segs, segs) : NULL;
+        u->sym = ld->sym;
+        u->item = (DwrfBudgetItem){ .evict = sym_unit_evict, .bytes = arena.reserved + line_bytes };
+        u->arena = arena;
+        *out = u;
+        return DWRF_OK;
+}
+
+/**
+ * Moves the loader to the split unit of a skeleton, the line table stays the skeleton's. A skeleton
+ * whose split unit can't be found keeps its own scopes, which have no functions.
+ */
+static DwrfResult sym_enter_split(SymLoader *ld, DwrfCtx **split)
+{
+        DwrfUnitHeader unit;
+        DwrfResult res;
+
+        *split = NULL;
+        if ((ld->sym->dwo == NULL) || (ld->unit.UnitType != DW_UT_skeleton))
+                return DWRF_OK;
+
+        res = dwarf_dwo_acquire(ld->sym->dwo, &ld->ctx, &ld->unit, split, &unit);
+        if (res)
+                return (res == DWRF_NO_MEM) ? res : DWRF_OK;
+
+        /* the handle is shared, the loader reads a private copy of it */
+        dwrf_worker_ctx(CTX(*split), &ld->ctx);
+        dwarf_cursor_init(&ld->ctx, &ld->cur);
+        dwarf_cursor_init(&ld->ctx, &ld->ref);
+        ld->unit = unit;
+        ld->split = true;
+
+        if ((res = dwarf_cursor_seek_unit(&ld->ref, unit.Offset)))
+                return res;
+        return dwrf_unit_bases(CTX(&ld->ctx), &ld->unit, &ld->bases);
+}
+
+/** Decodes the line table and the scopes of a unit, works on a private copy of the context. */
+static DwrfResult sym_unit_load(DwrfSymbolizer *s, uint64_t offset, SymUnit **out)
+{
+        SymLoader *ld = calloc(1, sizeof(SymLoader));
+        SymUnit *u;
+        DwrfCtx *split = NULL;
+        uint64_t bytes = 0;
+        DwrfResult res;
+
+        if (ld == NULL)
+                return DWRF_NO_MEM;
+
+        dwrf_worker_ctx(CTX(&s->snapshot), &ld->ctx);
+        dwarf_cursor_init(&ld->ctx, &ld->cur);
+        dwarf_cursor_init(&ld->ctx, &ld->ref);
+        dwrf_arena_init(&ld->arena);
+        ld->sym = s;
+        ld->u = u = &ld->scratch;
+        u->offset = offset;
+
+        res = dwarf_get_unit_header(&ld->ctx, offset, &ld->unit);
+        if (res == DWRF_OK)
+                res = dwrf_unit_bases(CTX(&ld->ctx), &ld->unit, &ld->bases);
+
+        if (res == DWRF_OK)
+        {
+                res = dwarf_line_table_unit(&ld->ctx, &ld->unit, &u->lines);
+                if ((res == DWRF_NOT_FOUND) || (res == DWRF_SEC_MISSING))
+                        res = DWRF_OK;  // the scopes still name the functions
+                else if (res == DWRF_OK)
+                        dwrf_line_table_usage(u->lines, &ld->file_count, &bytes);
+        }
+
+        if ((res == DWRF_OK) && ((res = sym_load_paths(ld)) == DWRF_OK) && ((res = sym_enter_split(ld, &split)) == DWRF_OK) &&
+            ((res = sym_load_scopes(ld)) == DWRF_OK))
+                res = sym_build_segments(ld);
+        if (split != NULL)
+                dwarf_dwo_release(s->dwo, split);
+        if (res == DWRF_OK)
+                res = sym_unit_pack(ld, bytes, out);
+        if (res)
+                dwarf_line_table_destroy(u->lines);
+
+        dwrf_map_destroy(&ld->names, NULL);
+        dwrf_arena_destroy(&ld->arena);
+        free(u->paths);
+        free(u->scopes);
+        free(u->segs);
+        free(ld->ranges);
+        free(ld->enclosing);
+        free(ld);
+        return res;
+}
+
+/** Returns the state of a unit, loading it outside the lock on a miss. Release it with sym_release(). */
+static DwrfResult sym_acquire(DwrfSymbolizer *s, uint64_t offset, SymUnit **out)
+{
+        SymUnit *u, *loaded = NULL;
+        DwrfResult res;
+
+        dwrf_budget_lock(s->budget);
+        if ((u = dwrf_map_get(&s->loaded, offset)) != NULL)
+        {
+                u->item.refs++;
+                dwrf_budget_touch(s->budget, &u->item);
+        }
+        dwrf_budget_unlock(s->budget);
+
+        if (u != NULL)
+        {
+                *out = u;
+                return DWRF_OK;
+        }
+
+        if ((res = sym_unit_load(s, offset, &loaded)))
+                return res;
+
+        /* another thread may have loaded it meanwhile, the first copy wins */
+        dwrf_budget_lock(s->budget);
+        if (((u = dwrf_map_get(&s->loaded, offset)) == NULL) && ((res = dwrf_map_put(&s->loaded, offset, loaded)) == DWRF_OK))
+        {
+                u = loaded;
+                loaded = NULL;
+                s->used += u->item.bytes;
+                s->loads++;
+                dwrf_budget_add(s->budget, &u->item);
+        }
+
+        if (u != NULL)
+        {
+                u->item.refs++;
+                dwrf_budget_touch(s->budget, &u->item);
+                dwrf_budget_evict(s->budget);
+        }
+        dwrf_budget_unlock(s->budget);
+
+        if (loaded != NULL)
+                sym_unit_free(loaded);
+        if (res)
+                return res;
+
+        *out = u;
+        return DWRF_OK;
+}
+
+static void sym_release(DwrfSymbolizer *s, SymUnit *u)
+{
+        dwrf_budget_lock(s->budget);
+        u->item.refs--;
+        dwrf_budget_evict(s->budget);
+        dwrf_budget_unlock(s->budget);
+}
+
+/** Starts charging the units to a budget, "own" is the budget when it is a private one. */
+static void sym_attach(DwrfSymbolizer *s, DwrfMemBudget *budget, DwrfMemBudget *own)
+{
+        s->budget = budget;
+        s->own_budget = own;
+        dwrf_budget_lock(budget);
+        dwrf_budget_attach(budget);
+        dwrf_budget_unlock(budget);
+}
+
+/** Releases the loaded units and leaves the budget, destroying it if it is the private one. */
+static void sym_detach(DwrfSymbolizer *s)
+{
+        if (s->budget == NULL)
+                return;
+
+        dwrf_budget_lock(s->budget);
+        dwrf_map_destroy(&s->loaded, sym_unit_drop);
+        s->used = 0;
+        dwrf_budget_detach(s->budget);
+        dwrf_budget_unlock(s->budget);
+
+        dwarf_mem_budget_destroy(s->own_budget);
+        s->budget = NULL;
+        s->own_budget = NULL;
+}
+
+/** Frames of an address of the unit, innermost first. */
+static uint32_t sym_unit_frames(const SymUnit *u, uint64_t addr, DwrfFrame *frames)
+{
+        uint32_t scope = sym_segment_scope(u, addr);
+        const DwrfLineRow *row;
+        DwrfFrame loc = {0};
+        uint32_t n = 0;
+
+        if ((u->lines != NULL) && (dwarf_line_lookup(u->lines, addr, &row) == DWRF_OK))
+        {
+                loc.File = ((row->File != DWRF_LINE_NO_FILE) && (u->paths != NULL)) ? u->paths[row->File] : NULL;
+                loc.Line = row->Line;
+                loc.Column = row->Column;
+        }
+
+        if (scope == SYM_NONE)
+        {
+                if ((loc.File != NULL) || (loc.Line != 0))
+                        frames[n++] = loc;
+                return n;
+        }
+
+        /* each inlined subroutine is located by the row, the caller by the call site of its callee */
+        while ((scope != SYM_NONE) && (n < SYM_MAX_FRAMES))
+        {
+                const SymScope *sc = &u->scopes[scope];
+
+                frames[n] = loc;
+                frames[n].Function = sc->name;
+                frames[n].LinkageName = sc->linkage;
+                frames[n].Inlined = sc->inlined;
+                n++;
+
+                loc.File = sc->call_file;
+                loc.Line = sc->call_line;
+                loc.Column = sc->call_column;
+                scope = sc->parent;
+        }
+        return n;
+}
+
+/***************
+ *    Cache    *
+ ***************/
+
+static inline uint64_t sym_hash_addr(uint64_t addr)
+{
+        return addr * 0x9E3779B97F4A7C15ULL;
+}
+
+static inline SymShard *sym_shard(DwrfSymbolizer *s, uint64_t hash)
+{
+        return &s->shards[(hash >> 60) % SYM_SHARDS];
+}
+
+static void sym_entry_unlink(SymShard *sh, uint32_t i)
+{
+        SymEntry *e = &sh->entries[i];
+
+        if (e->prev != SYM_NONE)
+                sh->entries[e->prev].next = e->next;
+        else
+                sh->head = e->next;
+
+        if (e->next != SYM_NONE)
+                sh->entries[e->next].prev = e->prev;
+        else
+                sh->tail = e->prev;
+}
+
+static void sym_entry_push(SymShard *sh, uint32_t i)
+{
+        SymEntry *e = &sh->entries[i];
+
+        e->prev = SYM_NONE;
+        e->next = sh->head;
+        if (sh->head != SYM_NONE)
+                sh->entries[sh->head].prev = i;
+        else
+                sh->tail = i;
+        sh->head = i;
+}
+
+static uint32_t sym_entry_find(const SymShard *sh, uint32_t bucket, uint64_t addr)
+{
+        uint32_t i = sh->buckets[bucket];
+
+        while ((i != SYM_NONE) && (sh->entries[i].addr != addr))
+                i = sh->entries[i].chain;
+        return i;
+}
+
+static int sym_cache_get(DwrfSymbolizer *s, uint64_t addr, DwrfFrame *frames, uint32_t *count)
+{
+        uint64_t h = sym_hash_addr(addr);
+        SymShard *sh = sym_shard(s, h);
+        uint32_t i;
+
+        sym_lock(&sh->lock);
+        if ((i = sym_entry_find(sh, (uint32_t)(h >> 32) & sh->mask, addr)) != SYM_NONE)
+        {
+                const SymEntry *e = &sh->entries[i];
+
+                if (e->count > 0)
+                        memcpy(frames, e->frames, e->count * sizeof(DwrfFrame));
+                *count = e->count;
+                sym_entry_unlink(sh, i);
+                sym_entry_push(sh, i);
+                sh->hits++;
+        }
+        else
+                sh->misses++;
+        sym_unlock(&sh->lock);
+
+        return i != SYM_NONE;
+}
+
+static void sym_cache_put(DwrfSymbolizer *s, uint64_t addr, const DwrfFrame *frames, uint32_t count)
+{
+        uint64_t h = sym_hash_addr(addr);
+        SymShard *sh = sym_shard(s, h);
+        uint32_t bucket = (uint32_t)(h >> 32) & sh->mask;
+        DwrfFrame *copy = NULL, *old = NULL;
+        uint32_t i;
+
+        if ((count > 0) && ((copy = malloc(count * sizeof(DwrfFrame))) == NULL))
+                return;
+        if (count > 0)
+                memcpy(copy, frames, count * sizeof(DwrfFrame));
+
+        sym_lock(&sh->lock);
+        if (sym_entry_find(sh, bucket, addr) == SYM_NONE)
+        {
+                if (sh->used < sh->capacity)
+                        i = sh->used++;
+                else
+                {
+                        /* recycle the least recently used entry, out of its bucket first */
+                        uint32_t *link;
+
+                        i = sh->tail;
+                        sym_entry_unlink(sh, i);
+                        link = &sh->buckets[(uint32_t)(sym_hash_addr(sh->entries[i].addr) >> 32) & sh->mask];
+                        while (*link != i)
+                                link = &sh->entries[*link].chain;
+                        *link = sh->entries[i].chain;
+                        old = sh->entries[i].frames;
+                }
+
+                SymEntry *e = &sh->entries[i];
+                e->addr = addr;
+                e->count = count;
+                e->frames = copy;
+                e->chain = sh->buckets[bucket];
+                sh->buckets[bucket] = i;
+                sym_entry_push(sh, i);
+                copy = NULL;
+        }
+        sym_unlock(&sh->lock);
+
+        /* lost the race to another thread, or the frames of the recycled entry */
+        free(copy);
+        free(old);
+}
+
+static DwrfResult sym_cache_init(DwrfSymbolizer *s, uint32_t entries)
+{
+        uint32_t per_shard = (uint32_t)(((uint64_t)entries + SYM_SHARDS - 1) / SYM_SHARDS);
+        uint32_t buckets = 1;
+
+        if (entries == 0)
+                return DWRF_OK;
+
+        while ((buckets < per_shard) && (buckets < (1u << 31)))
+                buckets *= 2;
+
+        s->shard_count = SYM_SHARDS;
+        for (uint32_t k = 0; k < SYM_SHARDS; k++)
+        {
+                SymShard *sh = &s->shards[k];
+
+                sh->entries = malloc((size_t)per_shard * sizeof(SymEntry));
+                sh->buckets = malloc((size_t)buckets * sizeof(uint32_t));
+                if ((sh->entries == NULL) || (sh->buckets == NULL))
+                        return DWRF_NO_MEM;
+
+                memset(sh->buckets, 0xFF, (size_t)buckets * sizeof(uint32_t));
+                sh->mask = buckets - 1;
+                sh->capacity = per_shard;
+                sh->head = SYM_NONE;
+                sh->tail = SYM_NONE;
+        }
+        return DWRF_OK;
+}
+
+/***************
+ *     API     *
+ ***************/
+
+static DwrfResult sym_collect_units(DwrfSymbolizer *s, DwrfCtx *ctx)
+{
+        DwrfUnitHeader unit;
+        uint64_t off = 0, cap = 0;
+        DwrfResult res;
+
+        while ((res = dwarf_get_unit_header(ctx, off, &unit)) == DWRF_OK)
+        {
+                if (s->unit_count == cap)
+                {
+                        uint64_t *units;
+
+                        cap = cap ? cap * 2 : 64;
+                        if ((units = realloc(s->units, (size_t)cap * sizeof(uint64_t))) == NULL)
+                                return DWRF_NO_MEM;
+                        s->units = units;
+                }
+                s->units[s->unit_count++] = unit.Offset;
+                off = unit.NextOffset;
+        }
+
+        /* BAD_ARG marks the end of the section */
+        return (res == DWRF_BAD_ARG) ? DWRF_OK : res;
+}
+
+DwrfResult dwarf_symbolizer_create(DwrfCtx *ctx, uint64_t budget, uint32_t cache_entries, DwrfSymbolizer **sym)
+{
+        DwrfMemBudget *own;
+        DwrfSymbolizer *s;
+        DwrfResult res;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (sym == NULL)
+                return DWRF_BAD_ARG;
+
+        if ((s = calloc(1, sizeof(DwrfSymbolizer))) == NULL)
+                return DWRF_NO_MEM;
+
+        sym_lock_init(&s->path_lock);
+        for (uint32_t k = 0; k < SYM_SHARDS; k++)
+                sym_lock_init(&s->shards[k].lock);
+        dwrf_arena_init(&s->path_arena);
+        s->limit = budget;
+
+        if ((res = dwarf_mem_budget_create(budget, &own)))
+        {
+                dwarf_symbolizer_destroy(s);
+                return res;
+        }
+        sym_attach(s, own, own);
+
+        /* everything the unit loads share is in memory before the snapshot is taken */
+        res = dwrf_prepare_workers(CTX(ctx));
+        if (res == DWRF_OK)
+                res = dwarf_addr_index_build(ctx, &s->index);
+        if (res == DWRF_OK)
+                res = sym_collect_units(s, ctx);
+        if (res == DWRF_OK)
+                res = sym_load_symbols(s, CTX(ctx)->elf);
+        if (res == DWRF_OK)
+                res = sym_cache_init(s, cache_entries);
+
+        if (res)
+        {
+                dwarf_symbolizer_destroy(s);
+                return res;
+        }
+
+        dwrf_worker_ctx(CTX(ctx), &s->snapshot);
+        *sym = s;
+        return DWRF_OK;
+}
+
+void dwarf_symbolizer_destroy(DwrfSymbolizer *sym)
+{
+        if (sym == NULL)
+                return;
+
+        sym_detach(sym);
+        dwrf_map_destroy(&sym->paths, NULL);
+        dwrf_arena_destroy(&sym->path_arena);
+        dwarf_addr_index_destroy(sym->index);
+
+        for (uint32_t k = 0; k < SYM_SHARDS; k++)
+        {
+                for (uint32_t i = 0; i < sym->shards[k].used; i++)
+                        free(sym->shards[k].entries[i].frames);
+                free(sym->shards[k].entries);
+                free(sym->shards[k].buckets);
+                sym_lock_destroy(&sym->shards[k].lock);
+        }
+        sym_lock_destroy(&sym->path_lock);
+
+        free(sym->units);
+        free(sym->symbols);
+        free(sym->strtab);
+        free(sym);
+}
+
+/** Symbolizes an address without the cache, count is 0 if nothing is known about it. */
+static DwrfResult sym_resolve(DwrfSymbolizer *s, uint64_t addr, DwrfFrame *frames, uint32_t *count)
+{
+        const SymSymbol *symbol = sym_find_symbol(s, addr);
+        uint64_t offset;
+        SymUnit *u;
+        DwrfResult res;
+        uint32_t n = 0;
+
+        res = dwarf_addr_index_lookup(s->index, addr, &offset);
+        if (res == DWRF_OK)
+        {
+                if ((res = sym_acquire(s, offset, &u)))
+                        return res;
+                n = sym_unit_frames(u, addr, frames);
+                sym_release(s, u);
+        }
+        else if (res != DWRF_NOT_FOUND)
+                return res;
+
+        /* code without debug information is still named by the symbol table */
+        if ((symbol != NULL) && ((n == 0) || (frames[n - 1].Function == NULL)))
+        {
+                if (n == 0)
+                        frames[n++] = (DwrfFrame){0};
+                frames[n - 1].Function = symbol->name;
+        }
+
+        *count = n;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_symbolize(DwrfSymbolizer *sym, uint64_t addr, DwrfFrame *frames, uint32_t max, uint32_t *count)
+{
+        DwrfFrame found[SYM_MAX_FRAMES];
+        uint32_t n;
+        DwrfResult res;
+
+        if ((sym == NULL) || (count == NULL) || ((frames == NULL) && (max > 0)))
+                return DWRF_BAD_ARG;
+
+        if ((sym->shard_count == 0) || !sym_cache_get(sym, addr, found, &n))
+        {
+                if ((res = sym_resolve(sym, addr, found, &n)))
+                        return res;
+                if (sym->shard_count != 0)
+                        sym_cache_put(sym, addr, found, n);
+        }
+
+        *count = n;
+        if (n == 0)
+                return DWRF_NOT_FOUND;
+
+        memcpy(frames, found, ((n < max) ? n : max) * sizeof(DwrfFrame));
+        return (n > max) ? DWRF_BUFFER_OVERFLOW : DWRF_OK;
+}
+
+DwrfResult dwarf_symbolizer_set_dwo_pool(DwrfSymbolizer *sym, DwrfDwoPool *pool)
+{
+        if (sym == NULL)
+                return DWRF_BAD_ARG;
+
+        sym->dwo = pool;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_symbolizer_set_budget(DwrfSymbolizer *sym, DwrfMemBudget *budget)
+{
+        DwrfMemBudget *own = NULL;
+        DwrfResult res;
+
+        if (sym == NULL)
+                return DWRF_BAD_ARG;
+
+        if ((budget == sym->budget) || ((budget == NULL) && (sym->own_budget != NULL)))
+                return DWRF_OK;
+
+        if ((budget == NULL) && (res = dwarf_mem_budget_create(sym->limit, &own)))
+                return res;
+
+        sym_detach(sym);
+        sym_attach(sym, own ? own : budget, own);
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_symbolizer_stats(DwrfSymbolizer *sym, DwrfSymbolizerStats *stats)
+{
+        if ((sym == NULL) || (stats == NULL))
+                return DWRF_BAD_ARG;
+
+        *stats = (DwrfSymbolizerStats){0};
+        for (uint32_t k = 0; k < sym->shard_count; k++)
+        {
+                sym_lock(&sym->shards[k].lock);
+                stats->CacheHits += sym->shards[k].hits;
+                stats->CacheMisses += sym->shards[k].misses;
+                sym_unlock(&sym->shards[k].lock);
+        }
+
+        dwrf_budget_lock(sym->budget);
+        stats->UnitsLoaded = sym->loads;
+        stats->UnitsEvicted = sym->evictions;
+        stats->UnitsResident = sym->loaded.count;
+        stats->UnitBytes = sym->used;
+        dwrf_budget_unlock(sym->budget);
+
+        stats->Symbols = sym->symbol_count;
+        return DWRF_OK;
+}
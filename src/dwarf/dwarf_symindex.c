@@ -0,0 +1,840 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+#include "common/elf_common.h"
+#include "common/elf_repr.h"
+
+/***************
+ *  Sym index  *
+ ***************/
+
+/*
+ * Layout of a serialized index, every integer little endian:
+ *
+ *   SymIndexHeader
+ *   table 0 .. table SI_TABLE_COUNT-1, each 8-byte aligned at the offset named by the header
+ *
+ * The checksum covers every byte after the header. Tables only hold offsets and indexes
+ * into other tables, the loader checks their bounds once and the lookups check the
+ * indexes they follow, so a blob that passed dwarf_sym_index_open() is never read
+ * out of bounds.
+ */
+
+#define SYM_INDEX_MAGIC    0x49535744u  // "DWSI"
+#define SYM_INDEX_VERSION  1u
+#define SYM_INDEX_ID_MAX   32u          // longest build ID kept
+#define SYM_INDEX_PATH_MAX 4096u
+#define SYM_INDEX_NONE     UINT32_MAX
+
+typedef enum
+{
+        SI_SYMBOLS,     // SymIndexSymbol sorted by address
+        SI_BUCKETS,     // uint32_t, power of two count, symbol index + 1 or 0 for an empty bucket
+        SI_UNITS,       // SymIndexUnit sorted by address
+        SI_SEQS,        // SymIndexSeq sorted by address
+        SI_ROWS,        // SymIndexRow, sequence after sequence
+        SI_FILES,       // uint32_t offset of the path in SI_STRINGS
+        SI_STRINGS,     // NUL terminated strings, the last byte is always NUL
+        SI_TABLE_COUNT
+} SymIndexTableId;
+
+typedef struct
+{
+        uint64_t offset;        // from the start of the blob
+        uint64_t count;         // elements
+} SymIndexTable;
+
+typedef struct
+{
+        uint32_t magic;
+        uint16_t version;
+        uint16_t header_size;
+        uint64_t size;          // whole blob
+        uint64_t checksum;      // of the bytes after the header
+        uint8_t  build_id[SYM_INDEX_ID_MAX];
+        uint32_t build_id_len;
+        uint32_t table_count;
+        SymIndexTable tables[SI_TABLE_COUNT];
+} SymIndexHeader;
+
+typedef struct
+{
+        uint64_t addr;
+        uint64_t size;
+        uint32_t name;          // offset in SI_STRINGS
+        uint32_t hash;          // of the name, compared before the strings
+} SymIndexSymbol;
+
+typedef struct
+{
+        uint64_t low;
+        uint64_t high;
+        uint64_t unit;
+} SymIndexUnit;
+
+typedef struct
+{
+        uint64_t low;
+        uint64_t high;          // address of the end_sequence row
+        uint64_t first;         // first row
+        uint64_t count;         // rows, the end_sequence one included
+} SymIndexSeq;
+
+typedef struct
+{
+        uint64_t addr;
+        uint32_t file;          // index in SI_FILES, SYM_INDEX_NONE if unknown
+        uint32_t line;
+        uint16_t column;
+        uint8_t  flags;         // DWRF_LINE_*
+        uint8_t  pad[5];
+} SymIndexRow;
+
+_Static_assert(sizeof(SymIndexHeader) % 8 == 0, "tables must stay aligned after the header");
+_Static_assert(sizeof(SymIndexSymbol) == 24, "on disk layout");
+_Static_assert(sizeof(SymIndexUnit) == 24, "on disk layout");
+_Static_assert(sizeof(SymIndexSeq) == 32, "on disk layout");
+_Static_assert(sizeof(SymIndexRow) == 24, "on disk layout");
+
+static const uint8_t table_elem_size[SI_TABLE_COUNT] = {
+        sizeof(SymIndexSymbol), sizeof(uint32_t), sizeof(SymIndexUnit), sizeof(SymIndexSeq),
+        sizeof(SymIndexRow), sizeof(uint32_t), 1,
+};
+
+struct DwrfSymIndex
+{
+        const SymIndexHeader *hdr;
+        const SymIndexSymbol *symbols;
+        const uint32_t *buckets;
+        const SymIndexUnit *units;
+        const SymIndexSeq *seqs;
+        const SymIndexRow *rows;
+        const uint32_t *files;
+        const char *strings;
+        uint64_t counts[SI_TABLE_COUNT];
+};
+
+/** FNV-1a of a symbol name, the hash table uses the low bits */
+static uint32_t si_hash(const char *name)
+{
+        uint64_t h = 0xcbf29ce484222325ULL;
+
+        while (*name)
+                h = (h ^ (uint8_t)*name++) * 0x100000001b3ULL;
+        return (uint32_t)(h ^ (h >> 32));
+}
+
+static inline uint64_t si_rotl(uint64_t v, unsigned n)
+{
+        return (v << n) | (v >> (64 - n));
+}
+
+#define SI_PRIME1 0x9E3779B185EBCA87ULL
+#define SI_PRIME2 0xC2B2AE3D27D4EB4FULL
+
+static inline uint64_t si_round(uint64_t acc, uint64_t word)
+{
+        return si_rotl(acc + word * SI_PRIME2, 31) * SI_PRIME1;
+}
+
+/** 64-bit checksum over four independent lanes, it runs at memory speed on large blobs */
+uint64_t dwrf_checksum(const uint8_t *p, uint64_t size)
+{
+        uint64_t lane[4] = { SI_PRIME1 + SI_PRIME2, SI_PRIME2, 0, -SI_PRIME1 };
+        uint64_t h, w, i = 0;
+
+        for (; i + 32 <= size; i += 32)
+        {
+                for (int l = 0; l < 4; l++)
+                {
+                        memcpy(&w, p + i + 8 * l, 8);
+                        lane[l] = si_round(lane[l], w);
+                }
+        }
+
+        h = si_rotl(lane[0], 1) + si_rotl(lane[1], 7) + si_rotl(lane[2], 12) + si_rotl(lane[3], 18) + size;
+        for (; i + 8 <= size; i += 8)
+        {
+                memcpy(&w, p + i, 8);
+                h = si_rotl(h ^ si_round(0, w), 27) * SI_PRIME1 + SI_PRIME2;
+        }
+        for (; i < size; i++)
+                h = si_rotl(h ^ (p[i] * SI_PRIME1), 11) * SI_PRIME2;
+
+        h ^= h >> 33;
+        h *= SI_PRIME2;
+        h ^= h >> 29;
+        return h;
+}
+
+/***************
+ *   Builder   *
+ ***************/
+
+typedef struct
+{
+        void *data;
+        uint64_t count;
+        uint64_t cap;
+} SiArray;
+
+typedef struct
+{
+        SiArray tables[SI_TABLE_COUNT];
+        DwrfMap strings;        // hash of a string -> its offset + 1
+        uint8_t build_id[SYM_INDEX_ID_MAX];
+        uint32_t build_id_len;
+} SiBuilder;
+
+/** Symbol being collected, rank orders aliases: global, weak, local */
+typedef struct
+{
+        SymIndexSymbol sym;
+        uint8_t rank;
+} SiSymbol;
+
+static void *si_push(SiArray *a, size_t elem, uint64_t n)
+{
+        void *p;
+
+        if (a->count + n > a->cap)
+        {
+                uint64_t cap = a->cap ? a->cap : 64;
+                while (cap < a->count + n)
+                        cap *= 2;
+
+                p = realloc(a->data, (size_t)cap * elem);
+                if (p == NULL)
+                        return NULL;
+                a->data = p;
+                a->cap = cap;
+        }
+
+        p = (uint8_t *)a->data + a->count * elem;
+        a->count += n;
+        return p;
+}
+
+/** Offset of a string in the string table, identical strings are stored once */
+static DwrfResult si_intern(SiBuilder *b, const char *str, uint32_t *offset)
+{
+        SiArray *strs = &b->tables[SI_STRINGS];
+        uint64_t h = 0xcbf29ce484222325ULL;
+        size_t len = strlen(str);
+        uintptr_t found;
+        char *p;
+
+        for (size_t i = 0; i < len; i++)
+                h = (h ^ (uint8_t)str[i]) * 0x100000001b3ULL;
+
+        found = (uintptr_t)dwrf_map_get(&b->strings, h);
+        if ((found != 0) && (strcmp((const char *)strs->data + found - 1, str) == 0))
+        {
+                *offset = (uint32_t)(found - 1);
+                return DWRF_OK;
+        }
+
+        /* offsets are 32 bits */
+        if (strs->count + len + 1 > UINT32_MAX)
+                return DWRF_UNSUPPORTED;
+
+        *offset = (uint32_t)strs->count;
+        if ((p = si_push(strs, 1, len + 1)) == NULL)
+                return DWRF_NO_MEM;
+        memcpy(p, str, len + 1);
+
+        /* on a hash collision the first string keeps the entry */
+        if ((found == 0) && dwrf_map_put(&b->strings, h, (void *)(uintptr_t)(*offset + 1)))
+                return DWRF_NO_MEM;
+        return DWRF_OK;
+}
+
+/** GNU build ID from the first NT_GNU_BUILD_ID note of the SHT_NOTE sections */
+static void si_build_id(SiBuilder *b, const ElfCtx *elf)
+{
+        ElfHeader ehdr;
+        ElfSecHeader hdr;
+        uint32_t sections = get_section_count(elf);
+        uint8_t big;
+
+        if (get_header(elf, &ehdr) != ELF_OK)
+                return;
+        big = (ehdr.EI_Data == ELFDATA2MSB);
+
+        for (uint32_t i = 1; i < sections; i++)
+        {
+                uint8_t *data;
+                uint64_t off = 0;
+
+                if ((get_section_header(elf, i, &hdr) != ELF_OK) || (hdr.Type != SHT_NOTE) || (hdr.Size > (1u << 20)))
+                        continue;
+                if ((data = malloc((size_t)hdr.Size + 1)) == NULL)
+                        return;
+                if (get_section_data(elf, &hdr, 0, hdr.Size, data) != ELF_OK)
+                {
+                        free(data);
+                        continue;
+                }
+
+                /* namesz, descsz, type, then the name and the descriptor padded to 4 bytes */
+                while (off + 12 <= hdr.Size)
+                {
+                        uint64_t namesz = load_uN(data + off, 4, big);
+                        uint64_t descsz = load_uN(data + off + 4, 4, big);
+                        uint64_t type = load_uN(data + off + 8, 4, big);
+                        uint64_t name = off + 12, desc = name + ((namesz + 3) & ~3ULL);
+
+                        if ((desc > hdr.Size) || (descsz > hdr.Size - desc))
+                                break;
+
+                        if ((type == 3) && (namesz == 4) && (memcmp(data + name, "GNU", 4) == 0) &&
+                            (descsz > 0) && (descsz <= SYM_INDEX_ID_MAX))
+                        {
+                                memcpy(b->build_id, data + desc, (size_t)descsz);
+                                b->build_id_len = (uint32_t)descsz;
+                                free(data);
+                                return;
+                        }
+                        off = desc + ((descsz + 3) & ~3ULL);
+                }
+                free(data);
+        }
+}
+
+static int si_symbol_cmp(const void *a, const void *b)
+{
+        const SiSymbol *x = a;
+        const SiSymbol *y = b;
+
+        if (x->sym.addr != y->sym.addr)
+                return (x->sym.addr > y->sym.addr) ? 1 : -1;
+        if (x->rank != y->rank)
+                return (x->rank > y->rank) ? 1 : -1;
+        return (x->sym.size < y->sym.size) - (x->sym.size > y->sym.size);
+}
+
+/** Function and object symbols of .symtab, or .dynsym when the file is stripped, and their hash table */
+static DwrfResult si_add_symbols(SiBuilder *b, const ElfCtx *elf)
+{
+        ElfSecHeader tab = {0}, strs, hdr;
+        ElfSymTabEntry entry;
+        uint32_t count, sections = get_section_count(elf);
+        SiSymbol *syms;
+        SymIndexSymbol *out;
+        uint32_t *buckets;
+        uint64_t n = 0, nbuckets = 1;
+        char *strtab;
+        DwrfResult res = DWRF_OK;
+
+        for (uint32_t i = 1; i < sections; i++)
+        {
+                if (get_section_header(elf, i, &hdr) != ELF_OK)
+                        continue;
+                if ((hdr.Type == SHT_SYMTAB) || ((hdr.Type == SHT_DYNSYM) && (tab.Type != SHT_DYNSYM)))
+                        tab = hdr;
+                if (tab.Type == SHT_SYMTAB)
+                        break;
+        }
+
+        if (((count = get_symbol_count(elf, &tab)) == 0) || (get_section_header(elf, tab.Link, &strs) != ELF_OK))
+                return DWRF_OK;
+
+        strtab = malloc((size_t)strs.Size + 1);
+        syms = malloc((size_t)count * sizeof(SiSymbol));
+        if ((strtab == NULL) || (syms == NULL))
+        {
+                free(strtab);
+                free(syms);
+                return DWRF_NO_MEM;
+        }
+
+        if (get_section_data(elf, &strs, 0, strs.Size, strtab) != ELF_OK)
+                res = DWRF_IO_ERR;
+        strtab[strs.Size] = '\0';
+
+        for (uint32_t i = 1; (i < count) && (res == DWRF_OK); i++)
+        {
+                if (get_symbol_entry(elf, &tab, i, &entry) != ELF_OK)
+                {
+                        res = DWRF_IO_ERR;
+                        break;
+                }
+
+                /* STT_LOOS is STT_GNU_IFUNC, undefined and absolute symbols have no address in the image */
+                if (((entry.Type != STT_FUNC) && (entry.Type != STT_LOOS) && (entry.Type != STT_OBJECT)) ||
+                    (entry.SecIdx == SHN_UNDEF) || ((entry.SecIdx >= SHN_LORESERVE) && (entry.SecIdx != SHN_XINDEX)) ||
+                    (entry.NameIdx == 0) || (entry.NameIdx >= strs.Size))
+                        continue;
+
+                syms[n].sym = (SymIndexSymbol){ entry.Value, entry.Size, 0, si_hash(strtab + entry.NameIdx) };
+                syms[n].rank = (entry.Binding == STB_GLOBAL) ? 0 : (entry.Binding == STB_WEAK) ? 1 : 2;
+                res = si_intern(b, strtab + entry.NameIdx, &syms[n].sym.name);
+                n++;
+        }
+        free(strtab);
+
+        /* aliases stay, the first one of an address names it */
+        if (res == DWRF_OK)
+                qsort(syms, (size_t)n, sizeof(SiSymbol), si_symbol_cmp);
+
+        while ((res == DWRF_OK) && (nbuckets < 2 * n))
+                nbuckets *= 2;
+
+        /* buckets hold 32-bit symbol indexes */
+        if ((res == DWRF_OK) && (n >= UINT32_MAX))
+                res = DWRF_UNSUPPORTED;
+        if ((res == DWRF_OK) && ((out = si_push(&b->tables[SI_SYMBOLS], sizeof(SymIndexSymbol), n)) == NULL))
+                res = DWRF_NO_MEM;
+        if ((res == DWRF_OK) && ((buckets = si_push(&b->tables[SI_BUCKETS], sizeof(uint32_t), nbuckets)) == NULL))
+                res = DWRF_NO_MEM;
+
+        if (res == DWRF_OK)
+        {
+                memset(buckets, 0, (size_t)nbuckets * sizeof(uint32_t));
+                for (uint64_t i = 0; i < n; i++)
+                        out[i] = syms[i].sym;
+
+                /* linear probing, inserted rank by rank so the global symbol of a name is met first */
+                for (uint8_t rank = 0; rank < 3; rank++)
+                {
+                        for (uint64_t i = 0; i < n; i++)
+                        {
+                                uint64_t slot = syms[i].sym.hash & (nbuckets - 1);
+
+                                if (syms[i].rank != rank)
+                                        continue;
+                                while (buckets[slot] != 0)
+                                        slot = (slot + 1) & (nbuckets - 1);
+                                buckets[slot] = (uint32_t)(i + 1);
+                        }
+                }
+        }
+
+        free(syms);
+        return res;
+}
+
+static DwrfResult si_add_units(SiBuilder *b, DwrfCtx *ctx)
+{
+        DwrfAddrIndex *index;
+        const DwrfAddrRange *ranges;
+        SymIndexUnit *out;
+        uint64_t count;
+        DwrfResult res;
+
+        if ((res = dwarf_addr_index_build(ctx, &index)))
+                return res;
+
+        dwarf_addr_index_ranges(index, &ranges, &count);
+        if ((out = si_push(&b->tables[SI_UNITS], sizeof(SymIndexUnit), count)) == NULL)
+                res = DWRF_NO_MEM;
+
+        for (uint64_t i = 0; (res == DWRF_OK) && (i < count); i++)
+                out[i] = (SymIndexUnit){ ranges[i].Low, ranges[i].High, ranges[i].UnitOffset };
+
+        dwarf_addr_index_destroy(index);
+        return res;
+}
+
+static DwrfResult si_add_lines(SiBuilder *b, DwrfCtx *ctx, uint32_t threads)
+{
+        DwrfLineTable *table;
+        const DwrfLineRow *rows;
+        SymIndexRow *out;
+        uint64_t count, first = 0;
+        uint32_t files;
+        uint64_t bytes;
+        char *path;
+        DwrfResult res;
+
+        res = dwarf_line_table_all(ctx, threads, &table);
+        if (res == DWRF_SEC_MISSING)
+                return DWRF_OK;
+        if (res)
+                return res;
+
+        dwarf_line_rows(table, &rows, &count);
+        dwrf_line_table_usage(table, &files, &bytes);
+
+        path = malloc(SYM_INDEX_PATH_MAX);
+        if ((path == NULL) || ((out = si_push(&b->tables[SI_ROWS], sizeof(SymIndexRow), count)) == NULL))
+                res = DWRF_NO_MEM;
+
+        for (uint64_t i = 0; (res == DWRF_OK) && (i < count); i++)
+        {
+                SymIndexSeq *seq;
+
+                out[i] = (SymIndexRow){ rows[i].Address, rows[i].File, rows[i].Line, rows[i].Column, rows[i].Flags, {0} };
+                if (rows[i].File >= files)
+                        out[i].file = SYM_INDEX_NONE;
+
+                if (!(rows[i].Flags & DWRF_LINE_END_SEQUENCE))
+                        continue;
+
+                /* the table already sorts its sequences by address */
+                if ((seq = si_push(&b->tables[SI_SEQS], sizeof(SymIndexSeq), 1)) == NULL)
+                        res = DWRF_NO_MEM;
+                else
+                        *seq = (SymIndexSeq){ rows[first].Address, rows[i].Address, first, i + 1 - first };
+                first = i + 1;
+        }
+
+        for (uint32_t f = 0; (res == DWRF_OK) && (f < files); f++)
+        {
+                uint32_t *slot = si_push(&b->tables[SI_FILES], sizeof(uint32_t), 1);
+
+                if (slot == NULL)
+                        res = DWRF_NO_MEM;
+                else if (dwarf_line_file_path(table, f, path, SYM_INDEX_PATH_MAX) != DWRF_OK)
+                        res = si_intern(b, "", slot);
+                else
+                        res = si_intern(b, path, slot);
+        }
+
+        free(path);
+        dwarf_line_table_destroy(table);
+        return res;
+}
+
+/** Lays the tables out after the header and checksums them */
+static DwrfResult si_serialize(SiBuilder *b, void **blob, uint64_t *size)
+{
+        SymIndexHeader hdr = {0};
+        uint64_t total = sizeof(SymIndexHeader);
+        uint8_t *out;
+
+        hdr.magic = SYM_INDEX_MAGIC;
+        hdr.version = SYM_INDEX_VERSION;
+        hdr.header_size = sizeof(SymIndexHeader);
+        hdr.table_count = SI_TABLE_COUNT;
+        hdr.build_id_len = b->build_id_len;
+        memcpy(hdr.build_id, b->build_id, sizeof(hdr.build_id));
+
+        for (int t = 0; t < SI_TABLE_COUNT; t++)
+        {
+                hdr.tables[t] = (SymIndexTable){ total, b->tables[t].count };
+                total += (b->tables[t].count * table_elem_size[t] + 7) & ~7ULL;
+        }
+
+        out = calloc(1, (size_t)total);
+        if (out == NULL)
+                return DWRF_NO_MEM;
+
+        for (int t = 0; t < SI_TABLE_COUNT; t++)
+        {
+                if (b->tables[t].count)
+                        memcpy(out + hdr.tables[t].offset, b->tables[t].data, (size_t)(b->tables[t].count * table_elem_size[t]));
+        }
+
+        hdr.size = total;
+        hdr.checksum = dwrf_checksum(out + sizeof(SymIndexHeader), total - sizeof(SymIndexHeader));
+        memcpy(out, &hdr, sizeof(hdr));
+
+        *blob = out;
+        *size = total;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_sym_index_build(const ElfCtx *elf, DwrfCtx *ctx, uint32_t threads, void **blob, uint64_t *size)
+{
+        SiBuilder b = {0};
+        uint32_t empty;
+        DwrfResult res;
+
+        if ((elf == NULL) || (blob == NULL) || (size == NULL))
+                return DWRF_BAD_ARG;
+        if ((ctx != NULL) && (res = validate_ctx(ctx)))
+                return res;
+
+        /* the tables are written in the host byte order */
+        if (host_endianness() != ELFDATA2LSB)
+                return DWRF_UNSUPPORTED;
+
+        si_build_id(&b, elf);
+
+        /* offset 0 is the empty string, so the string table is never empty */
+        res = si_intern(&b, "", &empty);
+        if (res == DWRF_OK)
+                res = si_add_symbols(&b, elf);
+        if ((res == DWRF_OK) && (ctx != NULL))
+                res = si_add_units(&b, ctx);
+        if ((res == DWRF_OK) && (ctx != NULL))
+                res = si_add_lines(&b, ctx, threads);
+        if (res == DWRF_OK)
+                res = si_serialize(&b, blob, size);
+
+        for (int t = 0; t < SI_TABLE_COUNT; t++)
+                free(b.tables[t].data);
+        dwrf_map_destroy(&b.strings, NULL);
+        return res;
+}
+
+/***************
+ *   Loading   *
+ ***************/
+
+DwrfResult dwarf_sym_index_open(const void *blob, uint64_t size, DwrfSymIndex **index)
+{
+        const uint8_t *data = blob;
+        SymIndexHeader hdr;
+        DwrfSymIndex *idx;
+
+        if ((blob == NULL) || (index == NULL) || (((uintptr_t)blob % 8) != 0))
+                return DWRF_BAD_ARG;
+        if (host_endianness() != ELFDATA2LSB)
+                return DWRF_UNSUPPORTED;
+
+        if (size < sizeof(SymIndexHeader))
+                return DWRF_DECODE_ERR;
+
+        memcpy(&hdr, blob, sizeof(hdr));
+        if (hdr.magic != SYM_INDEX_MAGIC)
+                return DWRF_DECODE_ERR;
+        if ((hdr.version != SYM_INDEX_VERSION) || (hdr.header_size != sizeof(SymIndexHeader)) ||
+            (hdr.table_count != SI_TABLE_COUNT))
+                return DWRF_UNSUPPORTED;
+        if ((hdr.size < sizeof(SymIndexHeader)) || (hdr.size > size) || (hdr.build_id_len > SYM_INDEX_ID_MAX))
+                return DWRF_DECODE_ERR;
+
+        for (int t = 0; t < SI_TABLE_COUNT; t++)
+        {
+                const SymIndexTable *tab = &hdr.tables[t];
+
+                if ((tab->offset < sizeof(SymIndexHeader)) || (tab->offset > hdr.size) || ((tab->offset % 8) != 0) ||
+                    (tab->count > (hdr.size - tab->offset) / table_elem_size[t]))
+                        return DWRF_DECODE_ERR;
+        }
+
+        /* every string ends before the table does, and the hash table can be probed with a mask */
+        if ((hdr.tables[SI_STRINGS].count == 0) || (data[hdr.tables[SI_STRINGS].offset + hdr.tables[SI_STRINGS].count - 1] != '\0'))
+                return DWRF_DECODE_ERR;
+        if ((hdr.tables[SI_BUCKETS].count & (hdr.tables[SI_BUCKETS].count - 1)) != 0)
+                return DWRF_DECODE_ERR;
+
+        if (dwrf_checksum(data + sizeof(SymIndexHeader), hdr.size - sizeof(SymIndexHeader)) != hdr.checksum)
+                return DWRF_DECODE_ERR;
+
+        idx = malloc(sizeof(DwrfSymIndex));
+        if (idx == NULL)
+                return DWRF_NO_MEM;
+
+        idx->hdr = blob;
+        idx->symbols = (const SymIndexSymbol *)(data + hdr.tables[SI_SYMBOLS].offset);
+        idx->buckets = (const uint32_t *)(data + hdr.tables[SI_BUCKETS].offset);
+        idx->units = (const SymIndexUnit *)(data + hdr.tables[SI_UNITS].offset);
+        idx->seqs = (const SymIndexSeq *)(data + hdr.tables[SI_SEQS].offset);
+        idx->rows = (const SymIndexRow *)(data + hdr.tables[SI_ROWS].offset);
+        idx->files = (const uint32_t *)(data + hdr.tables[SI_FILES].offset);
+        idx->strings = (const char *)(data + hdr.tables[SI_STRINGS].offset);
+        for (int t = 0; t < SI_TABLE_COUNT; t++)
+                idx->counts[t] = hdr.tables[t].count;
+
+        *index = idx;
+        return DWRF_OK;
+}
+
+void dwarf_sym_index_destroy(DwrfSymIndex *index)
+{
+        free(index);
+}
+
+/***************
+ *   Lookups   *
+ ***************/
+
+static const char *si_string(const DwrfSymIndex *idx, uint64_t offset)
+{
+        return (offset < idx->counts[SI_STRINGS]) ? idx->strings + offset : "";
+}
+
+static void si_symbol_out(const DwrfSymIndex *idx, const SymIndexSymbol *s, DwrfIndexSymbol *sym)
+{
+        sym->Address = s->addr;
+        sym->Size = s->size;
+        sym->Name = si_string(idx, s->name);
+}
+
+DwrfResult dwarf_sym_index_build_id(const DwrfSymIndex *index, const uint8_t **id, uint32_t *len)
+{
+        if ((index == NULL) || (id == NULL) || (len == NULL))
+                return DWRF_BAD_ARG;
+
+        *id = index->hdr->build_id;
+        *len = index->hdr->build_id_len;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_sym_index_info(const DwrfSymIndex *index, DwrfSymIndexInfo *info)
+{
+        if ((index == NULL) || (info == NULL))
+                return DWRF_BAD_ARG;
+
+        *info = (DwrfSymIndexInfo){
+                index->counts[SI_SYMBOLS], index->counts[SI_UNITS], index->counts[SI_SEQS],
+                index->counts[SI_ROWS], index->counts[SI_FILES], index->hdr->size,
+        };
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_sym_index_symbol(const DwrfSymIndex *index, uint64_t addr, DwrfIndexSymbol *sym)
+{
+        uint64_t lo = 0, hi, first;
+        const SymIndexSymbol *s;
+
+        if ((index == NULL) || (sym == NULL))
+                return DWRF_BAD_ARG;
+
+        hi = index->counts[SI_SYMBOLS];
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (index->symbols[mid].addr <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if (lo == 0)
+                return DWRF_NOT_FOUND;
+
+        /* aliases are sorted best first */
+        first = lo - 1;
+        while ((first > 0) && (index->symbols[first - 1].addr == index->symbols[lo - 1].addr))
+                first--;
+
+        s = &index->symbols[first];
+        if ((s->size != 0) && (addr - s->addr >= s->size))
+                return DWRF_NOT_FOUND;
+
+        si_symbol_out(index, s, sym);
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_sym_index_find_symbol(const DwrfSymIndex *index, const char *name, DwrfIndexSymbol *sym)
+{
+        uint64_t mask, slot;
+        uint32_t hash;
+
+        if ((index == NULL) || (name == NULL) || (sym == NULL))
+                return DWRF_BAD_ARG;
+        if (index->counts[SI_BUCKETS] == 0)
+                return DWRF_NOT_FOUND;
+
+        hash = si_hash(name);
+        mask = index->counts[SI_BUCKETS] - 1;
+        slot = hash & mask;
+
+        /* probes stop at an empty bucket, or after a full turn of a corrupt table */
+        for (uint64_t n = 0; n <= mask; n++, slot = (slot + 1) & mask)
+        {
+                uint32_t entry = index->buckets[slot];
+                const SymIndexSymbol *s;
+
+                if (entry == 0)
+                        break;
+                if (entry > index->counts[SI_SYMBOLS])
+                        return DWRF_DECODE_ERR;
+
+                s = &index->symbols[entry - 1];
+                if ((s->hash == hash) && (strcmp(si_string(index, s->name), name) == 0))
+                {
+                        si_symbol_out(index, s, sym);
+                        return DWRF_OK;
+                }
+        }
+        return DWRF_NOT_FOUND;
+}
+
+DwrfResult dwarf_sym_index_unit(const DwrfSymIndex *index, uint64_t addr, uint64_t *unit_offset)
+{
+        uint64_t lo = 0, hi;
+
+        if ((index == NULL) || (unit_offset == NULL))
+                return DWRF_BAD_ARG;
+
+        hi = index->counts[SI_UNITS];
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (index->units[mid].low <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if ((lo == 0) || (addr >= index->units[lo - 1].high))
+                return DWRF_NOT_FOUND;
+
+        *unit_offset = index->units[lo - 1].unit;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_sym_index_line(const DwrfSymIndex *index, uint64_t addr, DwrfLineRow *row, const char **file)
+{
+        uint64_t lo = 0, hi;
+        const SymIndexSeq *seq;
+        const SymIndexRow *r;
+
+        if ((index == NULL) || (row == NULL) || (file == NULL))
+                return DWRF_BAD_ARG;
+
+        /* last sequence starting at or before addr */
+        hi = index->counts[SI_SEQS];
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (index->seqs[mid].low <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if ((lo == 0) || (addr >= index->seqs[lo - 1].high))
+                return DWRF_NOT_FOUND;
+
+        seq = &index->seqs[lo - 1];
+        if ((seq->count < 2) || (seq->first > index->counts[SI_ROWS]) || (seq->count > index->counts[SI_ROWS] - seq->first))
+                return DWRF_DECODE_ERR;
+
+        /* last row at or before addr, the end_sequence row is never a candidate */
+        lo = seq->first;
+        hi = seq->first + seq->count - 1;
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if (index->rows[mid].addr <= addr)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if (lo == seq->first)
+                return DWRF_NOT_FOUND;
+
+        r = &index->rows[lo - 1];
+        *row = (DwrfLineRow){ r->addr, r->file, r->line, r->column, r->flags };
+        if ((r->file == SYM_INDEX_NONE) || (r->file >= index->counts[SI_FILES]))
+        {
+                row->File = DWRF_LINE_NO_FILE;
+                *file = NULL;
+        }
+        else
+                *file = si_string(index, index->files[r->file]);
+        return DWRF_OK;
+}
@@ -0,0 +1,842 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+#include "common/elf_common.h"
+#include "common/elf_repr.h"
+
+/***************
+ * Type index  *
+ ***************/
+ // sections 2.15 (identifier names), 3.2 (namespaces) and 5 (type entries) of spec v5
+
+/*
+ * Layout of a serialized index, every integer little endian:
+ *
+ *   TypeIndexHeader
+ *   table 0 .. table TI_TABLE_COUNT-1, each 8-byte aligned at the offset named by the header
+ *
+ * Names are placed with a hash and displace perfect hash: the hash of a name picks a bucket,
+ * the pilot of the bucket is mixed into the hash to pick the slot. The pilots are searched at
+ * build time so that no two names share a slot, a lookup reads one pilot and one slot and
+ * compares one string. The checksum covers every byte after the header.
+ */
+
+#define TYPE_INDEX_MAGIC   0x4e545744u  // "DWTN"
+#define TYPE_INDEX_VERSION 1u
+#define TYPE_INDEX_BUCKET  4u           // names per bucket on average
+#define TYPE_INDEX_LOAD    80u          // percent of the slots holding a name
+#define TYPE_INDEX_PILOTS  (1u << 20)   // pilots tried for a bucket before starting over with another seed
+#define TYPE_INDEX_SEEDS   16u
+#define TYPE_INDEX_NOREF   UINT64_MAX
+
+#define TYPE_INDEX_ANON_NS "(anonymous namespace)"
+
+typedef enum
+{
+        TI_PILOTS,      // uint32_t per bucket
+        TI_SLOTS,       // uint32_t, name index + 1 or 0 for an empty slot
+        TI_NAMES,       // TypeIndexName sorted by string
+        TI_ENTRIES,     // TypeIndexEntry grouped by name, definitions first and then in DIE order
+        TI_STRINGS,     // NUL terminated qualified names, the last byte is always NUL
+        TI_TABLE_COUNT
+} TypeIndexTableId;
+
+typedef struct
+{
+        uint64_t offset;        // from the start of the blob
+        uint64_t count;         // elements
+} TypeIndexTable;
+
+typedef struct
+{
+        uint32_t magic;
+        uint16_t version;
+        uint16_t header_size;
+        uint64_t size;          // whole blob
+        uint64_t checksum;      // of the bytes after the header
+        uint64_t seed;          // of the name hash
+        uint32_t table_count;
+        uint32_t reserved;
+        TypeIndexTable tables[TI_TABLE_COUNT];
+} TypeIndexHeader;
+
+typedef struct
+{
+        uint32_t name;          // offset in TI_STRINGS
+        uint32_t count;         // entries
+        uint64_t first;         // first entry
+} TypeIndexName;
+
+typedef struct
+{
+        uint64_t die;           // offset in .debug_info
+        uint16_t tag;
+        uint8_t  flags;         // DWRF_TYPE_DECLARATION
+        uint8_t  pad[5];
+} TypeIndexEntry;
+
+_Static_assert(sizeof(TypeIndexHeader) % 8 == 0, "tables must stay aligned after the header");
+_Static_assert(sizeof(TypeIndexName) == 16, "on disk layout");
+_Static_assert(sizeof(TypeIndexEntry) == 16, "on disk layout");
+
+static const uint8_t table_elem_size[TI_TABLE_COUNT] = {
+        sizeof(uint32_t), sizeof(uint32_t), sizeof(TypeIndexName), sizeof(TypeIndexEntry), 1,
+};
+
+struct DwrfTypeIndex
+{
+        const TypeIndexHeader *hdr;
+        const uint32_t *pilots;
+        const uint32_t *slots;
+        const TypeIndexName *names;
+        const TypeIndexEntry *entries;
+        const char *strings;
+        uint64_t counts[TI_TABLE_COUNT];
+};
+
+/** FNV-1a of a name under a seed with a final avalanche, the bucket comes from the high half */
+static uint64_t ti_hash(const char *name, uint64_t seed)
+{
+        uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+
+        while (*name)
+                h = (h ^ (uint8_t)*name++) * 0x100000001b3ULL;
+
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+}
+
+static inline uint64_t ti_bucket(uint64_t h, uint64_t buckets)
+{
+        return ((h >> 32) * buckets) >> 32;
+}
+
+static inline uint64_t ti_slot(uint64_t h, uint32_t pilot, uint64_t slots)
+{
+        uint64_t p = ((uint64_t)pilot + 1) * 0x9E3779B97F4A7C15ULL;
+
+        return (h ^ p ^ (p >> 29)) % slots;
+}
+
+/***************
+ *   Reading   *
+ ***************/
+
+/** Type DIE found by a unit scan */
+typedef struct
+{
+        const char *name;       // qualified name
+        uint64_t die;
+        uint16_t tag;
+        uint8_t flags;
+} TiItem;
+
+/** Types of one unit in DIE order */
+typedef struct
+{
+        TiItem *items;
+        uint64_t count;
+} TiUnit;
+
+/** Enclosing DIE at one depth of the walk */
+typedef struct
+{
+        const char *scope;      // qualified name the children are nested in, NULL at the top level
+        size_t len;
+} TiFrame;
+
+typedef struct
+{
+        DwrfCtx *ctx;
+        DwrfCursor cur;
+        DwrfArena *arena;
+        TiFrame *frames;
+        uint64_t frame_cap;
+        TiItem *items;
+        uint64_t count;
+        uint64_t cap;
+        DwrfMap decls;          // DIE offset -> qualified name of the declarations DW_AT_specification refers to
+} TiReader;
+
+enum { TI_NAME, TI_DECLARATION, TI_SPECIFICATION, TI_ATTR_COUNT };
+
+static const uint16_t ti_attrs[TI_ATTR_COUNT] = { DW_AT_name, DW_AT_declaration, DW_AT_specification };
+
+static int ti_is_type(uint16_t tag)
+{
+        switch (tag)
+        {
+        case DW_TAG_array_type:
+        case DW_TAG_class_type:
+        case DW_TAG_enumeration_type:
+        case DW_TAG_pointer_type:
+        case DW_TAG_reference_type:
+        case DW_TAG_string_type:
+        case DW_TAG_structure_type:
+        case DW_TAG_subroutine_type:
+        case DW_TAG_typedef:
+        case DW_TAG_union_type:
+        case DW_TAG_ptr_to_member_type:
+        case DW_TAG_set_type:
+        case DW_TAG_subrange_type:
+        case DW_TAG_base_type:
+        case DW_TAG_const_type:
+        case DW_TAG_file_type:
+        case DW_TAG_packed_type:
+        case DW_TAG_volatile_type:
+        case DW_TAG_restrict_type:
+        case DW_TAG_interface_type:
+        case DW_TAG_unspecified_type:
+        case DW_TAG_shared_type:
+        case DW_TAG_rvalue_reference_type:
+        case DW_TAG_template_alias:
+        case DW_TAG_coarray_type:
+        case DW_TAG_dynamic_type:
+        case DW_TAG_atomic_type:
+        case DW_TAG_immutable_type:
+                return true;
+        default:
+                return false;
+        }
+}
+
+/** DIEs whose children are named relative to them */
+static int ti_is_scope(uint16_t tag)
+{
+        return (tag == DW_TAG_namespace) || (tag == DW_TAG_structure_type) || (tag == DW_TAG_class_type) ||
+               (tag == DW_TAG_union_type) || (tag == DW_TAG_interface_type);
+}
+
+static const char *ti_str(DwrfCtx *ctx, DwrfCursor *cur, DwrfAttr *attr)
+{
+        const InternalDwarfCtx *c = CTX(ctx);
+        const DwrfSection *sec;
+
+        if ((attr->Form == 0) || (dwarf_cursor_resolve(cur, attr) != DWRF_OK))
+                return NULL;
+
+        switch (attr->Form)
+        {
+        case DW_FORM_strp:
+                sec = &c->debug_str;
+                break;
+        case DW_FORM_line_strp:
+                sec = &c->debug_line_str;
+                break;
+        case DW_FORM_string:
+                sec = &c->debug_info;
+                break;
+        default:
+                return NULL;
+        }
+
+        if ((sec->data == NULL) || (attr->Value >= sec->hdr.Size) ||
+            (memchr(sec->data + attr->Value, 0, sec->hdr.Size - attr->Value) == NULL))
+                return NULL;
+        return (const char *)sec->data + attr->Value;
+}
+
+/** Offset in .debug_info of the DIE a reference points to, TYPE_INDEX_NOREF if there's none */
+static uint64_t ti_ref(const DwrfUnitHeader *unit, const DwrfAttr *attr)
+{
+        switch (attr->Form)
+        {
+        case DW_FORM_ref1:
+        case DW_FORM_ref2:
+        case DW_FORM_ref4:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_udata:
+                return unit->Offset + attr->Value;
+        case DW_FORM_ref_addr:
+                return attr->Value;
+        default:
+                return TYPE_INDEX_NOREF;
+        }
+}
+
+/** Makes room for element "count" of an array */
+static int ti_grow(void **data, uint64_t *cap, uint64_t count, size_t elem)
+{
+        void *p;
+        uint64_t n;
+
+        if (count < *cap)
+                return true;
+
+        n = *cap ? *cap * 2 : 256;
+        while (n <= count)
+                n *= 2;
+        p = realloc(*data, (size_t)n * elem);
+        if (p == NULL)
+                return false;
+        *data = p;
+        *cap = n;
+        return true;
+}
+
+/** "scope::name" in the arena */
+static const char *ti_join(TiReader *r, const TiFrame *parent, const char *name)
+{
+        size_t len = strlen(name);
+        size_t at = parent->scope ? parent->len + 2 : 0;
+        char *s = dwarf_arena_alloc(r->arena, at + len + 1);
+
+        if (s == NULL)
+                return NULL;
+
+        if (parent->scope)
+        {
+                memcpy(s, parent->scope, parent->len);
+                memcpy(s + parent->len, "::", 2);
+        }
+        memcpy(s + at, name, len + 1);
+        return s;
+}
+
+/**
+ * Records a named type and sets the frame its children see. Children that can't be named from
+ * outside (those of functions, of anonymous types, of enumerations) are skipped without decoding.
+ */
+static DwrfResult ti_read_die(TiReader *r, const DwrfUnitHeader *unit, const DwrfDie *die, const TiFrame *parent,
+                              TiFrame *frame)
+{
+        DwrfAttr a[TI_ATTR_COUNT];
+        const char *name, *qname = NULL;
+        int type = ti_is_type(die->Tag), scope = ti_is_scope(die->Tag);
+        uint8_t flags;
+        DwrfResult res;
+
+        frame->scope = NULL;
+        frame->len = 0;
+
+        if (die->Depth == 0)
+                return DWRF_OK;
+
+        if (!type && !scope)
+                return die->HasChildren ? dwarf_cursor_skip_children(&r->cur) : DWRF_OK;
+
+        if ((res = dwarf_cursor_get_attrs(&r->cur, ti_attrs, TI_ATTR_COUNT, a)))
+                return res;
+
+        name = ti_str(r->ctx, &r->cur, &a[TI_NAME]);
+        if ((name != NULL) && (name[0] == '\0'))
+                name = NULL;
+        flags = (a[TI_DECLARATION].Form && a[TI_DECLARATION].Value) ? DWRF_TYPE_DECLARATION : 0;
+
+        /* out of line definitions take the name and scope of their declaration */
+        if (a[TI_SPECIFICATION].Form)
+                qname = dwrf_map_get(&r->decls, ti_ref(unit, &a[TI_SPECIFICATION]));
+        if ((qname == NULL) && (name == NULL) && (die->Tag == DW_TAG_namespace))
+                name = TYPE_INDEX_ANON_NS;
+        if ((qname == NULL) && (name != NULL) && ((qname = ti_join(r, parent, name)) == NULL))
+                return DWRF_NO_MEM;
+
+        if (qname == NULL)
+                return die->HasChildren ? dwarf_cursor_skip_children(&r->cur) : DWRF_OK;
+
+        if (type)
+        {
+                if (!ti_grow((void **)&r->items, &r->cap, r->count, sizeof(TiItem)))
+                        return DWRF_NO_MEM;
+                r->items[r->count++] = (TiItem){ qname, die->Offset, die->Tag, flags };
+
+                if (flags && dwrf_map_put(&r->decls, die->Offset, (void *)qname))
+                        return DWRF_NO_MEM;
+        }
+
+        if (!scope)
+                return die->HasChildren ? dwarf_cursor_skip_children(&r->cur) : DWRF_OK;
+
+        frame->scope = qname;
+        frame->len = strlen(qname);
+        return DWRF_OK;
+}
+
+static DwrfResult ti_read_unit(TiReader *r, const DwrfUnitHeader *unit)
+{
+        DwrfDie die;
+        DwrfResult res;
+
+        if ((res = dwarf_cursor_init(r->ctx, &r->cur)) || (res = dwarf_cursor_seek_unit(&r->cur, unit->Offset)))
+                return res;
+
+        while (((res = dwarf_cursor_next(&r->cur, &die)) == DWRF_OK) && (die.UnitOffset == unit->Offset))
+        {
+                if (!ti_grow((void **)&r->frames, &r->frame_cap, die.Depth, sizeof(TiFrame)))
+                        return DWRF_NO_MEM;
+
+                res = ti_read_die(r, unit, &die, die.Depth ? &r->frames[die.Depth - 1] : NULL, &r->frames[die.Depth]);
+                if (res)
+                        return res;
+        }
+        return ((res == DWRF_OK) || (res == DWRF_END)) ? DWRF_OK : res;
+}
+
+static DwrfResult ti_unit(DwrfCtx *ctx, const DwrfUnitHeader *unit, DwrfArena *arena, void *user, void **result)
+{
+        TiReader *r = malloc(sizeof(TiReader));
+        TiUnit *u = NULL;
+        DwrfResult res;
+
+        (void)user;
+        if (r == NULL)
+                return DWRF_NO_MEM;
+
+        *r = (TiReader){ .ctx = ctx, .arena = arena };
+        res = ti_read_unit(r, unit);
+
+        /* the names are in the arena already, the items join them */
+        if ((res == DWRF_OK) && (r->count > 0))
+        {
+                u = dwarf_arena_alloc(arena, sizeof(TiUnit));
+                if ((u == NULL) || ((u->items = dwarf_arena_alloc(arena, (size_t)r->count * sizeof(TiItem))) == NULL))
+                        res = DWRF_NO_MEM;
+                else
+                {
+                        memcpy(u->items, r->items, (size_t)r->count * sizeof(TiItem));
+                        u->count = r->count;
+                        *result = u;
+                }
+        }
+
+        dwrf_map_destroy(&r->decls, NULL);
+        free(r->frames);
+        free(r->items);
+        free(r);
+        return res;
+}
+
+/***************
+ *   Builder   *
+ ***************/
+
+typedef struct
+{
+        TiItem *items;
+        uint64_t count;
+        uint64_t cap;
+        DwrfArena strings;      // names copied out of the worker arenas, once each
+        DwrfMap interned;       // hash -> name in "strings"
+} TiBuilder;
+
+/** Copy of a name that outlives the scan, identical names are stored once */
+static const char *ti_intern(TiBuilder *b, const char *name)
+{
+        uint64_t h = ti_hash(name, 0);
+        const char *found = dwrf_map_get(&b->interned, h);
+        size_t len;
+        char *s;
+
+        if ((found != NULL) && (strcmp(found, name) == 0))
+                return found;
+
+        len = strlen(name) + 1;
+        if ((s = dwarf_arena_alloc(&b->strings, len)) == NULL)
+                return NULL;
+        memcpy(s, name, len);
+
+        /* on a hash collision the first name keeps the entry, the sort groups the copies again */
+        if ((found == NULL) && dwrf_map_put(&b->interned, h, s))
+                return NULL;
+        return s;
+}
+
+static DwrfResult ti_merge(void *user, const DwrfUnitHeader *unit, void *result)
+{
+        TiBuilder *b = user;
+        const TiUnit *u = result;
+
+        (void)unit;
+        if (u == NULL)
+                return DWRF_OK;
+
+        if (!ti_grow((void **)&b->items, &b->cap, b->count + u->count - 1, sizeof(TiItem)))
+                return DWRF_NO_MEM;
+
+        for (uint64_t i = 0; i < u->count; i++)
+        {
+                TiItem *it = &b->items[b->count++];
+
+                *it = u->items[i];
+                if ((it->name = ti_intern(b, it->name)) == NULL)
+                        return DWRF_NO_MEM;
+        }
+        return DWRF_OK;
+}
+
+static int ti_item_cmp(const void *a, const void *b)
+{
+        const TiItem *x = a;
+        const TiItem *y = b;
+        int c = (x->name == y->name) ? 0 : strcmp(x->name, y->name);
+
+        if (c != 0)
+                return c;
+        if (x->flags != y->flags)
+                return (x->flags > y->flags) ? 1 : -1;
+        return (x->die > y->die) - (x->die < y->die);
+}
+
+/** Whether two sorted items have the same name, interned names only differ in pointer on hash collisions */
+static int ti_same_name(const TiItem *x, const TiItem *y)
+{
+        return (x->name == y->name) || (strcmp(x->name, y->name) == 0);
+}
+
+/**
+ * Searches a pilot for every bucket, the largest buckets first while most slots are still free.
+ * DWRF_NOT_FOUND if a bucket can't be placed under this seed, e.g. two names with the same hash.
+ */
+static DwrfResult ti_place(const char *strings, const TypeIndexName *names, uint64_t count, uint64_t seed,
+                           uint32_t *pilots, uint64_t buckets, uint32_t *slots, uint64_t slot_count)
+{
+        uint64_t *hashes = malloc((size_t)count * sizeof(uint64_t));
+        uint64_t *keys = malloc((size_t)count * sizeof(uint64_t));
+        uint64_t *start = calloc((size_t)buckets + 1, sizeof(uint64_t));
+        uint64_t *order = malloc((size_t)buckets * sizeof(uint64_t));
+        uint64_t *sizes = NULL, *pos = NULL, max_size = 0;
+        DwrfResult res = DWRF_OK;
+
+        if ((hashes == NULL) || (keys == NULL) || (start == NULL) || (order == NULL))
+                res = DWRF_NO_MEM;
+
+        /* names grouped by bucket, bucket b holds keys[start[b]] to keys[start[b + 1] - 1] */
+        for (uint64_t i = 0; (res == DWRF_OK) && (i < count); i++)
+        {
+                hashes[i] = ti_hash(strings + names[i].name, seed);
+                start[ti_bucket(hashes[i], buckets) + 1]++;
+        }
+        for (uint64_t b = 0; (res == DWRF_OK) && (b < buckets); b++)
+        {
+                if (start[b + 1] > max_size)
+                        max_size = start[b + 1];
+                start[b + 1] += start[b];
+                order[b] = start[b];
+        }
+        for (uint64_t i = 0; (res == DWRF_OK) && (i < count); i++)
+                keys[order[ti_bucket(hashes[i], buckets)]++] = i;
+
+        /* buckets by decreasing size */
+        if ((res == DWRF_OK) && (((sizes = calloc((size_t)max_size + 2, sizeof(uint64_t))) == NULL) ||
+                                 ((pos = malloc((size_t)max_size * sizeof(uint64_t) + 1)) == NULL)))
+                res = DWRF_NO_MEM;
+        for (uint64_t b = 0; (res == DWRF_OK) && (b < buckets); b++)
+                sizes[max_size - (start[b + 1] - start[b]) + 1]++;
+        for (uint64_t n = 0; (res == DWRF_OK) && (n <= max_size); n++)
+                sizes[n + 1] += sizes[n];
+        for (uint64_t b = 0; (res == DWRF_OK) && (b < buckets); b++)
+                order[sizes[max_size - (start[b + 1] - start[b])]++] = b;
+
+        if (res == DWRF_OK)
+        {
+                memset(pilots, 0, (size_t)buckets * sizeof(uint32_t));
+                memset(slots, 0, (size_t)slot_count * sizeof(uint32_t));
+        }
+
+        for (uint64_t o = 0; (res == DWRF_OK) && (o < buckets); o++)
+        {
+                uint64_t b = order[o], first = start[b], n = start[b + 1] - first;
+                uint32_t pilot;
+
+                if (n == 0)
+                        break;
+
+                for (pilot = 0; pilot < TYPE_INDEX_PILOTS; pilot++)
+                {
+                        uint64_t j;
+
+                        /* slots are taken as they are tried, and given back if one of the bucket is taken */
+                        for (j = 0; j < n; j++)
+                        {
+                                pos[j] = ti_slot(hashes[keys[first + j]], pilot, slot_count);
+                                if (slots[pos[j]] != 0)
+                                        break;
+                                slots[pos[j]] = (uint32_t)(keys[first + j] + 1);
+                        }
+                        if (j == n)
+                                break;
+                        while (j > 0)
+                                slots[pos[--j]] = 0;
+                }
+
+                if (pilot == TYPE_INDEX_PILOTS)
+                        res = DWRF_NOT_FOUND;
+                else
+                        pilots[b] = pilot;
+        }
+
+        free(hashes);
+        free(keys);
+        free(start);
+        free(order);
+        free(sizes);
+        free(pos);
+        return res;
+}
+
+/** Lays the tables out after the header, places the names and checksums the blob */
+static DwrfResult ti_serialize(const TiBuilder *b, void **blob, uint64_t *size)
+{
+        TypeIndexHeader hdr = {0};
+        uint64_t counts[TI_TABLE_COUNT] = {0};
+        uint64_t total = sizeof(TypeIndexHeader), names = 0, bytes = 1;
+        TypeIndexName *name = NULL;
+        TypeIndexEntry *entries;
+        char *strings;
+        uint8_t *out;
+        DwrfResult res;
+
+        /* offset 0 is the empty string, so the string table is never empty */
+        for (uint64_t i = 0; i < b->count; i++)
+        {
+                if ((i == 0) || !ti_same_name(&b->items[i - 1], &b->items[i]))
+                {
+                        names++;
+                        bytes += strlen(b->items[i].name) + 1;
+                }
+        }
+
+        /* names and entries are indexed with 32 bits */
+        if ((names >= UINT32_MAX) || (bytes > UINT32_MAX) || (b->count >= UINT32_MAX))
+                return DWRF_UNSUPPORTED;
+
+        counts[TI_PILOTS] = names ? names / TYPE_INDEX_BUCKET + 1 : 0;
+        counts[TI_SLOTS] = names ? names * 100 / TYPE_INDEX_LOAD + 1 : 0;
+        counts[TI_NAMES] = names;
+        counts[TI_ENTRIES] = b->count;
+        counts[TI_STRINGS] = bytes;
+
+        hdr.magic = TYPE_INDEX_MAGIC;
+        hdr.version = TYPE_INDEX_VERSION;
+        hdr.header_size = sizeof(TypeIndexHeader);
+        hdr.table_count = TI_TABLE_COUNT;
+        for (int t = 0; t < TI_TABLE_COUNT; t++)
+        {
+                hdr.tables[t] = (TypeIndexTable){ total, counts[t] };
+                total += (counts[t] * table_elem_size[t] + 7) & ~7ULL;
+        }
+
+        out = calloc(1, (size_t)total);
+        if (out == NULL)
+                return DWRF_NO_MEM;
+
+        strings = (char *)(out + hdr.tables[TI_STRINGS].offset);
+        entries = (TypeIndexEntry *)(out + hdr.tables[TI_ENTRIES].offset);
+        bytes = 1;
+        for (uint64_t i = 0; i < b->count; i++)
+        {
+                const TiItem *it = &b->items[i];
+
+                if ((i == 0) || !ti_same_name(&b->items[i - 1], it))
+                {
+                        size_t len = strlen(it->name) + 1;
+
+                        name = (name == NULL) ? (TypeIndexName *)(out + hdr.tables[TI_NAMES].offset) : name + 1;
+                        *name = (TypeIndexName){ (uint32_t)bytes, 0, i };
+                        memcpy(strings + bytes, it->name, len);
+                        bytes += len;
+                }
+                name->count++;
+                entries[i] = (TypeIndexEntry){ it->die, it->tag, it->flags, {0} };
+        }
+
+        /* a handful of seeds is plenty, only identical hashes make a seed fail */
+        res = names ? DWRF_NOT_FOUND : DWRF_OK;
+        for (uint32_t s = 0; (s < TYPE_INDEX_SEEDS) && (res == DWRF_NOT_FOUND); s++)
+        {
+                hdr.seed = (s + 1) * 0x9E3779B97F4A7C15ULL;
+                res = ti_place(strings, (const TypeIndexName *)(out + hdr.tables[TI_NAMES].offset), names, hdr.seed,
+                               (uint32_t *)(out + hdr.tables[TI_PILOTS].offset), counts[TI_PILOTS],
+                               (uint32_t *)(out + hdr.tables[TI_SLOTS].offset), counts[TI_SLOTS]);
+        }
+        if (res)
+        {
+                free(out);
+                return (res == DWRF_NOT_FOUND) ? DWRF_UNSUPPORTED : res;
+        }
+
+        hdr.size = total;
+        hdr.checksum = dwrf_checksum(out + sizeof(TypeIndexHeader), total - sizeof(TypeIndexHeader));
+        memcpy(out, &hdr, sizeof(hdr));
+
+        *blob = out;
+        *size = total;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_type_index_build(DwrfCtx *ctx, uint32_t threads, void **blob, uint64_t *size)
+{
+        TiBuilder b = {0};
+        DwrfResult res;
+
+        if ((res = validate_ctx(ctx)))
+                return res;
+        if ((blob == NULL) || (size == NULL))
+                return DWRF_BAD_ARG;
+
+        /* the tables are written in the host byte order */
+        if (host_endianness() != ELFDATA2LSB)
+                return DWRF_UNSUPPORTED;
+
+        dwrf_arena_init(&b.strings);
+        res = dwarf_for_each_cu_parallel(ctx, threads, ti_unit, ti_merge, &b);
+        if (res == DWRF_OK)
+        {
+                if (b.count > 1)
+                        qsort(b.items, (size_t)b.count, sizeof(TiItem), ti_item_cmp);
+                res = ti_serialize(&b, blob, size);
+        }
+
+        free(b.items);
+        dwrf_map_destroy(&b.interned, NULL);
+        dwrf_arena_destroy(&b.strings);
+        return res;
+}
+
+/***************
+ *   Loading   *
+ ***************/
+
+DwrfResult dwarf_type_index_open(const void *blob, uint64_t size, DwrfTypeIndex **index)
+{
+        const uint8_t *data = blob;
+        TypeIndexHeader hdr;
+        DwrfTypeIndex *idx;
+
+        if ((blob == NULL) || (index == NULL) || (((uintptr_t)blob % 8) != 0))
+                return DWRF_BAD_ARG;
+        if (host_endianness() != ELFDATA2LSB)
+                return DWRF_UNSUPPORTED;
+
+        if (size < sizeof(TypeIndexHeader))
+                return DWRF_DECODE_ERR;
+
+        memcpy(&hdr, blob, sizeof(hdr));
+        if (hdr.magic != TYPE_INDEX_MAGIC)
+                return DWRF_DECODE_ERR;
+        if ((hdr.version != TYPE_INDEX_VERSION) || (hdr.header_size != sizeof(TypeIndexHeader)) ||
+            (hdr.table_count != TI_TABLE_COUNT))
+                return DWRF_UNSUPPORTED;
+        if ((hdr.size < sizeof(TypeIndexHeader)) || (hdr.size > size))
+                return DWRF_DECODE_ERR;
+
+        for (int t = 0; t < TI_TABLE_COUNT; t++)
+        {
+                const TypeIndexTable *tab = &hdr.tables[t];
+
+                if ((tab->offset < sizeof(TypeIndexHeader)) || (tab->offset > hdr.size) || ((tab->offset % 8) != 0) ||
+                    (tab->count > (hdr.size - tab->offset) / table_elem_size[t]))
+                        return DWRF_DECODE_ERR;
+        }
+
+        /* every string ends before the table does, and a lookup always has a pilot for its bucket */
+        if ((hdr.tables[TI_STRINGS].count == 0) || (data[hdr.tables[TI_STRINGS].offset + hdr.tables[TI_STRINGS].count - 1] != '\0'))
+                return DWRF_DECODE_ERR;
+        if ((hdr.tables[TI_PILOTS].count == 0) != (hdr.tables[TI_SLOTS].count == 0))
+                return DWRF_DECODE_ERR;
+
+        if (dwrf_checksum(data + sizeof(TypeIndexHeader), hdr.size - sizeof(TypeIndexHeader)) != hdr.checksum)
+                return DWRF_DECODE_ERR;
+
+        idx = malloc(sizeof(DwrfTypeIndex));
+        if (idx == NULL)
+                return DWRF_NO_MEM;
+
+        idx->hdr = blob;
+        idx->pilots = (const uint32_t *)(data + hdr.tables[TI_PILOTS].offset);
+        idx->slots = (const uint32_t *)(data + hdr.tables[TI_SLOTS].offset);
+        idx->names = (const TypeIndexName *)(data + hdr.tables[TI_NAMES].offset);
+        idx->entries = (const TypeIndexEntry *)(data + hdr.tables[TI_ENTRIES].offset);
+        idx->strings = (const char *)(data + hdr.tables[TI_STRINGS].offset);
+        for (int t = 0; t < TI_TABLE_COUNT; t++)
+                idx->counts[t] = hdr.tables[t].count;
+
+        *index = idx;
+        return DWRF_OK;
+}
+
+void dwarf_type_index_destroy(DwrfTypeIndex *index)
+{
+        free(index);
+}
+
+/***************
+ *   Lookups   *
+ ***************/
+
+DwrfResult dwarf_type_index_info(const DwrfTypeIndex *index, DwrfTypeIndexInfo *info)
+{
+        if ((index == NULL) || (info == NULL))
+                return DWRF_BAD_ARG;
+
+        *info = (DwrfTypeIndexInfo){
+                index->counts[TI_NAMES], index->counts[TI_ENTRIES], index->counts[TI_STRINGS],
+                index->counts[TI_PILOTS], index->counts[TI_SLOTS], index->hdr->size,
+        };
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_type_index_find(const DwrfTypeIndex *index, const char *name, DwrfTypeIndexEntry *entries,
+                                 uint32_t max, uint32_t *count)
+{
+        const TypeIndexName *n;
+        uint64_t h, slot;
+        uint32_t e;
+
+        if ((index == NULL) || (name == NULL) || (count == NULL) || ((entries == NULL) && (max > 0)))
+                return DWRF_BAD_ARG;
+
+        *count = 0;
+        if (index->counts[TI_SLOTS] == 0)
+                return DWRF_NOT_FOUND;
+
+        h = ti_hash(name, index->hdr->seed);
+        slot = ti_slot(h, index->pilots[ti_bucket(h, index->counts[TI_PILOTS])], index->counts[TI_SLOTS]);
+        if ((e = index->slots[slot]) == 0)
+                return DWRF_NOT_FOUND;
+
+        /* the loader checked the tables, not the indexes stored in them */
+        if (e > index->counts[TI_NAMES])
+                return DWRF_DECODE_ERR;
+        n = &index->names[e - 1];
+        if ((n->name >= index->counts[TI_STRINGS]) || (n->first > index->counts[TI_ENTRIES]) ||
+            (n->count > index->counts[TI_ENTRIES] - n->first))
+                return DWRF_DECODE_ERR;
+
+        /* names that aren't in the index land on the slot of another one */
+        if (strcmp(index->strings + n->name, name) != 0)
+                return DWRF_NOT_FOUND;
+
+        for (uint32_t i = 0; (i < n->count) && (i < max); i++)
+        {
+                const TypeIndexEntry *te = &index->entries[n->first + i];
+                entries[i] = (DwrfTypeIndexEntry){ te->die, te->tag, (te->flags & DWRF_TYPE_DECLARATION) != 0 };
+        }
+
+        *count = n->count;
+        return (n->count > max) ? DWRF_BUFFER_OVERFLOW : DWRF_OK;
+}
@@ -0,0 +1,1372 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dwarf_internal.h"
+
+/***************
+ * Type table  *
+ ***************/
+ // sections 5 (type entries) and 7.32 (type signatures) of spec v5
+
+#define TYPE_NONE          UINT32_MAX   // no node / no class
+#define TYPE_NOREF         UINT64_MAX   // DIE offset of a missing or unsupported reference
+#define TYPE_CHUNK         4096u        // nodes per hashing job
+#define TYPE_AT_BIT_OFFSET 0x0c         // DW_AT_bit_offset of DWARF 2 to 4 bit fields
+#define TYPE_DECL_CONFLICT UINTPTR_MAX  // several definitions share the name of a declaration
+
+#define TYPE_MAGIC   0x54545744u        // "DWTT"
+#define TYPE_VERSION 1u
+
+#define TYPE_HDR_SIZE    24u
+#define TYPE_REC_SIZE    32u
+#define TYPE_MEMBER_SIZE 24u
+
+/** Type DIE, refs hold DIE offsets while a unit is read */
+typedef struct
+{
+        const char *name;       // points into the sections, NULL if anonymous
+        uint64_t size;
+        uint64_t scope;         // hash of the enclosing namespaces and types
+        uint64_t ref;
+        uint64_t first;         // members
+        uint32_t count;
+        uint16_t tag;
+        uint8_t encoding;
+        uint8_t flags;
+} TypeNode;
+
+typedef struct
+{
+        const char *name;
+        uint64_t value;
+        uint64_t ref;
+        uint64_t owner;         // node of the unit while it is read
+        uint32_t bit_size;
+        uint16_t tag;
+} TypeMember;
+
+/** Types of one unit in DIE order, the members of each node are contiguous */
+typedef struct
+{
+        TypeNode *nodes;
+        TypeMember *members;
+        uint64_t *offsets;      // DIE offset of each node
+        uint64_t node_count;
+        uint64_t member_count;
+        uint64_t name_bytes;    // bytes of the names read, the footprint of the graph before deduplication
+} TypeUnit;
+
+/** Enclosing DIE at one depth of the walk */
+typedef struct
+{
+        uint64_t scope;         // scope of the DIE's children
+        uint32_t node;          // node of the unit, TYPE_NONE if the DIE isn't a type
+        uint16_t tag;
+} TypeFrame;
+
+typedef struct
+{
+        TypeNode *nodes;
+        TypeMember *members;
+        uint64_t *offsets;      // sorted, units and DIEs come in section order
+        uint64_t node_count;
+        uint64_t node_cap;
+        uint64_t offset_cap;
+        uint64_t member_count;
+        uint64_t member_cap;
+        uint64_t name_bytes;
+
+        uint32_t *node_ref;     // linked references, TYPE_NONE for void
+        uint32_t *member_ref;
+        uint32_t *target;       // node itself, or the definition a declaration resolves to
+        uint32_t *cls;          // class of each node in the current partition
+        uint32_t *next;         // partition being built
+        uint64_t *hash;
+        uint32_t *slots;        // open addressing table of class representatives, node + 1
+        uint64_t slot_count;
+        uint32_t workers;
+        uint8_t deep;           // hashing phase: shallow properties or classes of the references
+} TypeBuilder;
+
+struct DwrfTypeTable
+{
+        DwrfType *types;        // id - 1
+        uint32_t *first;        // first member of each type
+        DwrfTypeMember *members;
+        char *strings;
+        uint64_t string_size;
+        uint64_t *die_offsets;  // sorted, NULL for tables loaded from a blob
+        uint32_t *die_types;
+        uint64_t die_count;
+        DwrfTypeTableStats stats;
+};
+
+static inline uint64_t type_mix(uint64_t h, uint64_t v)
+{
+        h = (h ^ v) * 0x100000001b3ULL;
+        return h ^ (h >> 29);
+}
+
+static uint64_t type_hash_str(uint64_t h, const char *str)
+{
+        if (str == NULL)
+                return type_mix(h, 0);
+
+        while (*str)
+                h = (h ^ (uint8_t)*str++) * 0x100000001b3ULL;
+        return type_mix(h, 1);
+}
+
+static int type_str_eq(const char *a, const char *b)
+{
+        if ((a == NULL) || (b == NULL))
+                return a == b;
+        return strcmp(a, b) == 0;
+}
+
+/***************
+ *   Reading   *
+ ***************/
+
+static int type_is_type(uint16_t tag)
+{
+        switch (tag)
+        {
+        case DW_TAG_array_type:
+        case DW_TAG_class_type:
+        case DW_TAG_enumeration_type:
+        case DW_TAG_pointer_type:
+        case DW_TAG_reference_type:
+        case DW_TAG_string_type:
+        case DW_TAG_structure_type:
+        case DW_TAG_subroutine_type:
+        case DW_TAG_typedef:
+        case DW_TAG_union_type:
+        case DW_TAG_ptr_to_member_type:
+        case DW_TAG_set_type:
+        case DW_TAG_subrange_type:
+        case DW_TAG_base_type:
+        case DW_TAG_const_type:
+        case DW_TAG_file_type:
+        case DW_TAG_packed_type:
+        case DW_TAG_volatile_type:
+        case DW_TAG_restrict_type:
+        case DW_TAG_interface_type:
+        case DW_TAG_unspecified_type:
+        case DW_TAG_shared_type:
+        case DW_TAG_rvalue_reference_type:
+        case DW_TAG_template_alias:
+        case DW_TAG_coarray_type:
+        case DW_TAG_dynamic_type:
+        case DW_TAG_atomic_type:
+        case DW_TAG_immutable_type:
+                return true;
+        default:
+                return false;
+        }
+}
+
+static int type_is_record(uint16_t tag)
+{
+        return (tag == DW_TAG_structure_type) || (tag == DW_TAG_class_type) || (tag == DW_TAG_union_type) ||
+               (tag == DW_TAG_interface_type);
+}
+
+/** Whether a DIE is a child the type of its parent is made of */
+static int type_is_member(uint16_t parent, uint16_t tag)
+{
+        if (type_is_record(parent))
+                return (tag == DW_TAG_member) || (tag == DW_TAG_inheritance) || (tag == DW_TAG_variable);
+        if (parent == DW_TAG_enumeration_type)
+                return tag == DW_TAG_enumerator;
+        if (parent == DW_TAG_array_type)
+                return (tag == DW_TAG_subrange_type) || (tag == DW_TAG_generic_subrange);
+        if (parent == DW_TAG_subroutine_type)
+                return (tag == DW_TAG_formal_parameter) || (tag == DW_TAG_unspecified_parameters);
+        return false;
+}
+
+enum
+{
+        TA_NAME, TA_TYPE, TA_BYTE_SIZE, TA_ENCODING, TA_DECLARATION, TA_PROTOTYPED, TA_CONTAINING,
+        TA_LOCATION, TA_DATA_BIT_OFFSET, TA_BIT_OFFSET, TA_BIT_SIZE, TA_CONST, TA_COUNT, TA_UPPER,
+        TA_LOWER, TA_EXTERNAL, TA_MAX
+};
+
+static const uint16_t type_attrs[TA_MAX] = {
+        DW_AT_name, DW_AT_type, DW_AT_byte_size, DW_AT_encoding, DW_AT_declaration, DW_AT_prototyped,
+        DW_AT_containing_type, DW_AT_data_member_location, DW_AT_data_bit_offset, TYPE_AT_BIT_OFFSET,
+        DW_AT_bit_size, DW_AT_const_value, DW_AT_count, DW_AT_upper_bound, DW_AT_lower_bound, DW_AT_external,
+};
+
+static const char *type_str(DwrfCtx *ctx, DwrfCursor *cur, DwrfAttr *attr)
+{
+        const InternalDwarfCtx *c = CTX(ctx);
+        const DwrfSection *sec;
+
+        if ((attr->Form == 0) || (dwarf_cursor_resolve(cur, attr) != DWRF_OK))
+                return NULL;
+
+        switch (attr->Form)
+        {
+        case DW_FORM_strp:
+                sec = &c->debug_str;
+                break;
+        case DW_FORM_line_strp:
+                sec = &c->debug_line_str;
+                break;
+        case DW_FORM_string:
+                sec = &c->debug_info;
+                break;
+        default:
+                return NULL;
+        }
+
+        if ((sec->data == NULL) || (attr->Value >= sec->hdr.Size) ||
+            (memchr(sec->data + attr->Value, 0, sec->hdr.Size - attr->Value) == NULL))
+                return NULL;
+        return (const char *)sec->data + attr->Value;
+}
+
+/** Offset in .debug_info of the DIE a reference points to, TYPE_NOREF if there's none */
+static uint64_t type_ref(const DwrfUnitHeader *unit, const DwrfAttr *attr)
+{
+        switch (attr->Form)
+        {
+        case DW_FORM_ref1:
+        case DW_FORM_ref2:
+        case DW_FORM_ref4:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_udata:
+                return unit->Offset + attr->Value;
+        case DW_FORM_ref_addr:
+                return attr->Value;
+        default:
+                return TYPE_NOREF;      // type signatures and supplementary files
+        }
+}
+
+/** Value of a constant attribute, false for other forms (expressions, references) */
+static int type_const(const DwrfAttr *attr, uint64_t *val)
+{
+        switch (attr->Form)
+        {
+        case DW_FORM_data1:
+        case DW_FORM_data2:
+        case DW_FORM_data4:
+        case DW_FORM_data8:
+        case DW_FORM_sdata:
+        case DW_FORM_udata:
+        case DW_FORM_implicit_const:
+                *val = attr->Value;
+                return true;
+        default:
+                return false;
+        }
+}
+
+/** Byte offset of a data member, from a constant or the DW_OP_plus_uconst expression of DWARF 2 */
+static int type_member_location(DwrfCtx *ctx, const DwrfAttr *attr, uint64_t *val)
+{
+        const DwrfSection *info = &CTX(ctx)->debug_info;
+        const uint8_t *p;
+        uint8_t len;
+
+        if (type_const(attr, val))
+                return true;
+
+        if ((attr->Form != DW_FORM_exprloc) && (attr->Form != DW_FORM_block1) && (attr->Form != DW_FORM_block))
+                return false;
+        if ((info->data == NULL) || (attr->Size < 2) || (attr->Value > info->hdr.Size - attr->Size))
+                return false;
+
+        p = info->data + attr->Value;
+        if ((p[0] != DW_OP_plus_uconst) || dwarf_decode_uleb128(p + 1, p + attr->Size, val, &len))
+                return false;
+        return (uint64_t)len + 1 == attr->Size;
+}
+
+static void type_fill_member(DwrfCtx *ctx, const DwrfAttr *a, TypeMember *m)
+{
+        uint64_t loc = 0, bits, lower = 0, upper, size;
+
+        m->value = 0;
+        m->bit_size = (a[TA_BIT_SIZE].Form && type_const(&a[TA_BIT_SIZE], &bits)) ? (uint32_t)bits : 0;
+
+        switch (m->tag)
+        {
+        case DW_TAG_member:
+        case DW_TAG_inheritance:
+                if (a[TA_DATA_BIT_OFFSET].Form && type_const(&a[TA_DATA_BIT_OFFSET], &m->value))
+                        break;
+                if (a[TA_LOCATION].Form && !type_member_location(ctx, &a[TA_LOCATION], &loc))
+                {
+                        m->value = DWRF_TYPE_NO_VALUE;
+                        break;
+                }
+                if (!a[TA_LOCATION].Form && (a[TA_EXTERNAL].Form || a[TA_DECLARATION].Form))
+                {
+                        m->value = DWRF_TYPE_NO_VALUE;  // static member
+                        break;
+                }
+
+                m->value = loc * 8;
+                /* DW_AT_bit_offset counts from the most significant bit of the storage unit */
+                if (a[TA_BIT_OFFSET].Form && type_const(&a[TA_BIT_OFFSET], &bits))
+                {
+                        if (a[TA_BYTE_SIZE].Form && type_const(&a[TA_BYTE_SIZE], &size) && (size * 8 >= bits + m->bit_size))
+                                m->value += size * 8 - bits - m->bit_size;
+                        else
+                                m->value += bits;
+                }
+                break;
+        case DW_TAG_enumerator:
+                if (!a[TA_CONST].Form || !type_const(&a[TA_CONST], &m->value))
+                        m->value = DWRF_TYPE_NO_VALUE;
+                break;
+        case DW_TAG_subrange_type:
+        case DW_TAG_generic_subrange:
+                if (a[TA_COUNT].Form && type_const(&a[TA_COUNT], &m->value))
+                        break;
+                if (a[TA_LOWER].Form && !type_const(&a[TA_LOWER], &lower))
+                        lower = UINT64_MAX;
+                if (a[TA_UPPER].Form && type_const(&a[TA_UPPER], &upper) && (lower != UINT64_MAX) && (upper + 1 >= lower))
+                        m->value = upper + 1 - lower;
+                else
+                        m->value = DWRF_TYPE_NO_VALUE;
+                break;
+        case DW_TAG_variable:
+                m->value = DWRF_TYPE_NO_VALUE;
+                break;
+        default:
+                break;
+        }
+}
+
+/** Scratch arrays of the unit being read, the result is copied into the arena once it's complete */
+typedef struct
+{
+        TypeNode *nodes;
+        TypeMember *members;
+        uint64_t *offsets;
+        TypeFrame *frames;
+        uint64_t node_cap;
+        uint64_t offset_cap;
+        uint64_t member_cap;
+        uint64_t frame_cap;
+        TypeUnit unit;
+} TypeReader;
+
+static int type_grow(void **data, uint64_t *cap, uint64_t count, size_t elem)
+{
+        void *p;
+        uint64_t n;
+
+        if (count < *cap)
+                return true;
+
+        n = *cap ? *cap * 2 : 256;
+        while (n <= count)
+                n *= 2;
+        p = realloc(*data, (size_t)n * elem);
+        if (p == NULL)
+                return false;
+        *data = p;
+        *cap = n;
+        return true;
+}
+
+static TypeMember *type_push_member(TypeReader *r)
+{
+        if (!type_grow((void **)&r->members, &r->member_cap, r->unit.member_count, sizeof(TypeMember)))
+                return NULL;
+        return &r->members[r->unit.member_count++];
+}
+
+/** Node or member of a DIE, given the frame of its parent */
+static DwrfResult type_read_die(TypeReader *r, DwrfCtx *ctx, DwrfCursor *cur, const DwrfUnitHeader *unit,
+                                const DwrfDie *die, const TypeFrame *parent, TypeFrame *frame)
+{
+        DwrfAttr a[TA_MAX];
+        uint64_t val;
+        const char *name;
+        int member = (parent->node != TYPE_NONE) && type_is_member(parent->tag, die->Tag);
+        int scope = (die->Tag == DW_TAG_namespace) || type_is_record(die->Tag);
+        TypeMember *m;
+        TypeNode *n;
+        DwrfResult res;
+
+        frame->scope = parent->scope;
+        frame->node = TYPE_NONE;
+        frame->tag = die->Tag;
+
+        if (!member && !scope && !type_is_type(die->Tag))
+                return DWRF_OK;
+
+        if ((res = dwarf_cursor_get_attrs(cur, type_attrs, TA_MAX, a)))
+                return res;
+        name = type_str(ctx, cur, &a[TA_NAME]);
+        if ((name != NULL) && (name[0] == '\0'))
+                name = NULL;
+        r->unit.name_bytes += name ? strlen(name) + 1 : 0;
+
+        if (scope)
+                frame->scope = type_hash_str(type_mix(parent->scope, die->Tag), name);
+
+        if (member)
+        {
+                if ((m = type_push_member(r)) == NULL)
+                        return DWRF_NO_MEM;
+                m->name = name;
+                m->tag = die->Tag;
+                m->owner = parent->node;
+                m->ref = a[TA_TYPE].Form ? type_ref(unit, &a[TA_TYPE]) : TYPE_NOREF;
+                type_fill_member(ctx, a, m);
+                return DWRF_OK;
+        }
+
+        if (!type_is_type(die->Tag))
+                return DWRF_OK;
+
+        if ((r->unit.node_count >= UINT32_MAX) ||
+            !type_grow((void **)&r->nodes, &r->node_cap, r->unit.node_count, sizeof(TypeNode)) ||
+            !type_grow((void **)&r->offsets, &r->offset_cap, r->unit.node_count, sizeof(uint64_t)))
+                return DWRF_NO_MEM;
+
+        frame->node = (uint32_t)r->unit.node_count;
+        r->offsets[r->unit.node_count] = die->Offset;
+        n = &r->nodes[r->unit.node_count++];
+        n->name = name;
+        n->tag = die->Tag;
+        n->scope = parent->scope;
+        n->size = (a[TA_BYTE_SIZE].Form && type_const(&a[TA_BYTE_SIZE], &val)) ? val : 0;
+        n->encoding = (a[TA_ENCODING].Form && type_const(&a[TA_ENCODING], &val)) ? (uint8_t)val : 0;
+        n->flags = (a[TA_DECLARATION].Form && a[TA_DECLARATION].Value) ? DWRF_TYPE_DECLARATION : 0;
+        n->flags |= (a[TA_PROTOTYPED].Form && a[TA_PROTOTYPED].Value) ? DWRF_TYPE_PROTOTYPED : 0;
+        n->ref = a[TA_TYPE].Form ? type_ref(unit, &a[TA_TYPE]) : TYPE_NOREF;
+        n->first = 0;
+        n->count = 0;
+
+        /* the containing class of a pointer to member is its only member */
+        if ((die->Tag == DW_TAG_ptr_to_member_type) && a[TA_CONTAINING].Form)
+        {
+                if ((m = type_push_member(r)) == NULL)
+                        return DWRF_NO_MEM;
+                *m = (TypeMember){ NULL, 0, type_ref(unit, &a[TA_CONTAINING]), frame->node, 0, die->Tag };
+        }
+        return DWRF_OK;
+}
+
+static DwrfResult type_read_unit(TypeReader *r, DwrfCtx *ctx, const DwrfUnitHeader *unit)
+{
+        TypeFrame root = { 0xcbf29ce484222325ULL, TYPE_NONE, 0 };
+        DwrfCursor cur;
+        DwrfDie die;
+        DwrfResult res;
+
+        if ((res = dwarf_cursor_init(ctx, &cur)) || (res = dwarf_cursor_seek_unit(&cur, unit->Offset)))
+                return res;
+
+        while (((res = dwarf_cursor_next(&cur, &die)) == DWRF_OK) && (die.UnitOffset == unit->Offset))
+        {
+                if (!type_grow((void **)&r->frames, &r->frame_cap, die.Depth, sizeof(TypeFrame)))
+                        return DWRF_NO_MEM;
+
+                res = type_read_die(r, ctx, &cur, unit, &die, die.Depth ? &r->frames[die.Depth - 1] : &root,
+                                    &r->frames[die.Depth]);
+                if (res)
+                        return res;
+        }
+        return ((res == DWRF_OK) || (res == DWRF_END)) ? DWRF_OK : res;
+}
+
+/** Copies the unit into the arena with the members grouped by owner, in DIE order within a group */
+static DwrfResult type_pack_unit(TypeReader *r, DwrfArena *arena, TypeUnit **result)
+{
+        TypeUnit *u = dwarf_arena_alloc(arena, sizeof(TypeUnit));
+        uint64_t nodes = r->unit.node_count, members = r->unit.member_count, at = 0;
+
+        if (u == NULL)
+                return DWRF_NO_MEM;
+
+        *u = r->unit;
+        u->nodes = dwarf_arena_alloc(arena, (size_t)nodes * sizeof(TypeNode) + 1);
+        u->offsets = dwarf_arena_alloc(arena, (size_t)nodes * sizeof(uint64_t) + 1);
+        u->members = dwarf_arena_alloc(arena, (size_t)members * sizeof(TypeMember) + 1);
+        if ((u->nodes == NULL) || (u->offsets == NULL) || (u->members == NULL))
+                return DWRF_NO_MEM;
+
+        if (nodes)
+        {
+                memcpy(u->nodes, r->nodes, (size_t)nodes * sizeof(TypeNode));
+                memcpy(u->offsets, r->offsets, (size_t)nodes * sizeof(uint64_t));
+        }
+
+        for (uint64_t i = 0; i < members; i++)
+                u->nodes[r->members[i].owner].count++;
+        for (uint64_t i = 0; i < nodes; i++)
+        {
+                u->nodes[i].first = at;
+                at += u->nodes[i].count;
+                u->nodes[i].count = 0;
+        }
+        for (uint64_t i = 0; i < members; i++)
+        {
+                TypeNode *n = &u->nodes[r->members[i].owner];
+                u->members[n->first + n->count++] = r->members[i];
+        }
+
+        *result = u;
+        return DWRF_OK;
+}
+
+static DwrfResult type_unit(DwrfCtx *ctx, const DwrfUnitHeader *unit, DwrfArena *arena, void *user, void **result)
+{
+        TypeReader r;
+        DwrfResult res;
+
+        (void)user;
+        memset(&r, 0, sizeof(r));
+
+        res = type_read_unit(&r, ctx, unit);
+        if (res == DWRF_OK)
+                res = type_pack_unit(&r, arena, (TypeUnit **)result);
+
+        free(r.nodes);
+        free(r.members);
+        free(r.offsets);
+        free(r.frames);
+        return res;
+}
+
+/***************
+ *   Merging   *
+ ***************/
+
+static DwrfResult type_merge(void *user, const DwrfUnitHeader *unit, void *result)
+{
+        TypeBuilder *b = user;
+        const TypeUnit *u = result;
+
+        (void)unit;
+        if ((u == NULL) || (u->node_count == 0))
+                return DWRF_OK;
+
+        if (b->node_count + u->node_count >= UINT32_MAX)
+                return DWRF_NO_MEM;
+
+        if (!type_grow((void **)&b->nodes, &b->node_cap, b->node_count + u->node_count - 1, sizeof(TypeNode)) ||
+            !type_grow((void **)&b->offsets, &b->offset_cap, b->node_count + u->node_count - 1, sizeof(uint64_t)))
+                return DWRF_NO_MEM;
+        if (u->member_count &&
+            !type_grow((void **)&b->members, &b->member_cap, b->member_count + u->member_count - 1, sizeof(TypeMember)))
+                return DWRF_NO_MEM;
+
+        for (uint64_t i = 0; i < u->node_count; i++)
+        {
+                TypeNode *n = &b->nodes[b->node_count + i];
+
+                *n = u->nodes[i];
+                n->first += b->member_count;
+        }
+        for (uint64_t i = 0; i < u->member_count; i++)
+        {
+                TypeMember *m = &b->members[b->member_count + i];
+
+                *m = u->members[i];
+                m->owner += b->node_count;
+        }
+        memcpy(b->offsets + b->node_count, u->offsets, (size_t)u->node_count * sizeof(uint64_t));
+
+        b->node_count += u->node_count;
+        b->member_count += u->member_count;
+        b->name_bytes += u->name_bytes;
+        return DWRF_OK;
+}
+
+/** Node of the DIE at "offset", the nodes are in section order */
+static uint32_t type_find(const TypeBuilder *b, uint64_t offset)
+{
+        uint64_t lo = 0, hi = b->node_count;
+
+        if (offset == TYPE_NOREF)
+                return TYPE_NONE;
+
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+
+                if (b->offsets[mid] < offset)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        return ((lo < b->node_count) && (b->offsets[lo] == offset)) ? (uint32_t)lo : TYPE_NONE;
+}
+
+/** Replaces the DIE offsets of a chunk of nodes and members with node indexes */
+static void type_link_job(void *arg, uint64_t job, uint32_t worker)
+{
+        TypeBuilder *b = arg;
+        uint64_t start = job * TYPE_CHUNK, end = start + TYPE_CHUNK;
+
+        (void)worker;
+        for (uint64_t i = start; (i < end) && (i < b->node_count); i++)
+                b->node_ref[i] = type_find(b, b->nodes[i].ref);
+
+        for (uint64_t i = start; (i < end) && (i < b->member_count); i++)
+                b->member_ref[i] = type_find(b, b->members[i].ref);
+}
+
+/***************
+ * Refinement  *
+ ***************/
+
+static inline uint32_t type_edge(const TypeBuilder *b, uint32_t node)
+{
+        return (node == TYPE_NONE) ? TYPE_NONE : b->cls[b->target[node]];
+}
+
+static uint64_t type_shallow_hash(const TypeBuilder *b, uint32_t i)
+{
+        const TypeNode *n = &b->nodes[i];
+        uint64_t h = type_mix(type_mix(0x9e3779b97f4a7c15ULL, n->tag | (uint64_t)n->flags << 16 | (uint64_t)n->encoding << 24), n->size);
+
+        h = type_hash_str(type_mix(h, n->scope), n->name);
+        h = type_mix(h, n->count);
+        for (uint64_t k = 0; k < n->count; k++)
+        {
+                const TypeMember *m = &b->members[n->first + k];
+
+                h = type_mix(type_mix(h, m->tag | (uint64_t)m->bit_size << 16), m->value);
+                h = type_hash_str(h, m->name);
+        }
+        return h;
+}
+
+static int type_shallow_eq(const TypeBuilder *b, uint32_t i, uint32_t j)
+{
+        const TypeNode *x = &b->nodes[i];
+        const TypeNode *y = &b->nodes[j];
+
+        if ((x->tag != y->tag) || (x->flags != y->flags) || (x->encoding != y->encoding) || (x->size != y->size) ||
+            (x->scope != y->scope) || (x->count != y->count) || !type_str_eq(x->name, y->name))
+                return false;
+
+        for (uint64_t k = 0; k < x->count; k++)
+        {
+                const TypeMember *m = &b->members[x->first + k];
+                const TypeMember *o = &b->members[y->first + k];
+
+                if ((m->tag != o->tag) || (m->value != o->value) || (m->bit_size != o->bit_size) ||
+                    !type_str_eq(m->name, o->name))
+                        return false;
+        }
+        return true;
+}
+
+static uint64_t type_deep_hash(const TypeBuilder *b, uint32_t i)
+{
+        const TypeNode *n = &b->nodes[i];
+        uint64_t h = type_mix(type_mix(0x9e3779b97f4a7c15ULL, b->cls[i]), type_edge(b, b->node_ref[i]));
+
+        for (uint64_t k = 0; k < n->count; k++)
+                h = type_mix(h, type_edge(b, b->member_ref[n->first + k]));
+        return h;
+}
+
+static int type_deep_eq(const TypeBuilder *b, uint32_t i, uint32_t j)
+{
+        const TypeNode *x = &b->nodes[i];
+        const TypeNode *y = &b->nodes[j];
+
+        /* equal classes imply equal member counts */
+        if ((b->cls[i] != b->cls[j]) || (type_edge(b, b->node_ref[i]) != type_edge(b, b->node_ref[j])))
+                return false;
+
+        for (uint64_t k = 0; k < x->count; k++)
+        {
+                if (type_edge(b, b->member_ref[x->first + k]) != type_edge(b, b->member_ref[y->first + k]))
+                        return false;
+        }
+        return true;
+}
+
+static void type_hash_job(void *arg, uint64_t job, uint32_t worker)
+{
+        TypeBuilder *b = arg;
+        uint64_t start = job * TYPE_CHUNK, end = start + TYPE_CHUNK;
+
+        (void)worker;
+        if (end > b->node_count)
+                end = b->node_count;
+
+        for (uint64_t i = start; i < end; i++)
+                b->hash[i] = b->deep ? type_deep_hash(b, (uint32_t)i) : type_shallow_hash(b, (uint32_t)i);
+}
+
+/**
+ * One round: hashes the nodes in parallel and numbers the classes in node order, so the
+ * partition doesn't depend on the thread count. Returns the number of classes.
+ */
+static uint32_t type_round(TypeBuilder *b)
+{
+        uint64_t mask = b->slot_count - 1;
+        uint32_t classes = 0, *swap;
+
+        dwrf_run_jobs(b->workers, (b->node_count + TYPE_CHUNK - 1) / TYPE_CHUNK, type_hash_job, b);
+
+        memset(b->slots, 0, (size_t)b->slot_count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < b->node_count; i++)
+        {
+                uint64_t s = b->hash[i] & mask;
+
+                for (;;)
+                {
+                        uint32_t rep = b->slots[s];
+
+                        if (rep == 0)
+                        {
+                                b->slots[s] = i + 1;
+                                b->next[i] = classes++;
+                                break;
+                        }
+                        rep--;
+                        if ((b->hash[rep] == b->hash[i]) &&
+                            (b->deep ? type_deep_eq(b, rep, i) : type_shallow_eq(b, rep, i)))
+                        {
+                                b->next[i] = b->next[rep];
+                                break;
+                        }
+                        s = (s + 1) & mask;
+                }
+        }
+
+        swap = b->cls;
+        b->cls = b->next;
+        b->next = swap;
+        return classes;
+}
+
+/** Refines the partition from the shallow properties until it is stable */
+static void type_refine(TypeBuilder *b, DwrfTypeTableStats *stats)
+{
+        uint32_t classes, prev;
+
+        b->deep = false;
+        classes = type_round(b);
+        stats->Rounds++;
+
+        b->deep = true;
+        do
+        {
+                prev = classes;
+                classes = type_round(b);
+                stats->Rounds++;
+        } while (classes != prev);
+}
+
+/***************
+ *    Decls    *
+ ***************/
+
+static inline uint16_t type_decl_tag(uint16_t tag)
+{
+        return (tag == DW_TAG_class_type) ? DW_TAG_structure_type : tag;
+}
+
+static uint64_t type_decl_hash(const TypeNode *n)
+{
+        return type_hash_str(type_mix(type_mix(0x84222325cbf29ce4ULL, type_decl_tag(n->tag)), n->scope), n->name);
+}
+
+/**
+ * Points named declarations to the definition of the same kind, name and scope when all the
+ * definitions are equal. Returns the number of declarations resolved.
+ */
+static uint64_t type_resolve_decls(TypeBuilder *b)
+{
+        uint64_t mask = b->slot_count - 1, resolved = 0;
+        uint8_t *conflict = calloc((size_t)b->node_count + 1, 1);
+
+        if (conflict == NULL)
+                return 0;       // the declarations stay, the table is still correct
+
+        memset(b->slots, 0, (size_t)b->slot_count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < b->node_count; i++)
+        {
+                const TypeNode *n = &b->nodes[i];
+                uint64_t s;
+
+                if ((n->name == NULL) || (n->flags & DWRF_TYPE_DECLARATION))
+                        continue;
+
+                for (s = type_decl_hash(n) & mask; b->slots[s]; s = (s + 1) & mask)
+                {
+                        const TypeNode *o = &b->nodes[b->slots[s] - 1];
+
+                        if ((type_decl_tag(o->tag) == type_decl_tag(n->tag)) && (o->scope == n->scope) &&
+                            type_str_eq(o->name, n->name))
+                                break;
+                }
+
+                if (b->slots[s] == 0)
+                        b->slots[s] = i + 1;
+                else if (b->cls[b->slots[s] - 1] != b->cls[i])
+                        conflict[b->slots[s] - 1] = true;
+        }
+
+        for (uint32_t i = 0; i < b->node_count; i++)
+        {
+                const TypeNode *n = &b->nodes[i];
+                uint64_t s;
+
+                if ((n->name == NULL) || !(n->flags & DWRF_TYPE_DECLARATION))
+                        continue;
+
+                for (s = type_decl_hash(n) & mask; b->slots[s]; s = (s + 1) & mask)
+                {
+                        uint32_t def = b->slots[s] - 1;
+                        const TypeNode *o = &b->nodes[def];
+
+                        if ((type_decl_tag(o->tag) == type_decl_tag(n->tag)) && (o->scope == n->scope) &&
+                            type_str_eq(o->name, n->name))
+                        {
+                                if (!conflict[def])
+                                {
+                                        b->target[i] = def;
+                                        resolved++;
+                                }
+                                break;
+                        }
+                }
+        }
+
+        free(conflict);
+        return resolved;
+}
+
+/***************
+ *    Table    *
+ ***************/
+
+/** Deduplicated strings, offset 0 is the empty string standing for NULL */
+typedef struct
+{
+        char *data;
+        uint64_t size;
+        uint64_t cap;
+        uint32_t *slots;        // offset of each string, 0 if empty
+        uint64_t slot_count;
+        uint64_t used;
+} TypeStrings;
+
+static int type_strings_init(TypeStrings *s, uint64_t count)
+{
+        memset(s, 0, sizeof(*s));
+        s->slot_count = 64;
+        while (s->slot_count < 2 * count)
+                s->slot_count *= 2;
+
+        s->slots = calloc((size_t)s->slot_count, sizeof(uint32_t));
+        s->cap = 4096;
+        s->data = malloc((size_t)s->cap);
+        if ((s->slots == NULL) || (s->data == NULL))
+                return false;
+        s->data[0] = '\0';
+        s->size = 1;
+        return true;
+}
+
+/** Offset of "str" in the pool, UINT32_MAX on failure */
+static uint32_t type_strings_add(TypeStrings *s, const char *str)
+{
+        uint64_t mask = s->slot_count - 1, len, at;
+
+        if (str == NULL)
+                return 0;
+
+        for (at = type_hash_str(0, str) & mask; s->slots[at]; at = (at + 1) & mask)
+        {
+                if (strcmp(s->data + s->slots[at], str) == 0)
+                        return s->slots[at];
+        }
+
+        len = strlen(str) + 1;
+        if (s->size + len > UINT32_MAX)
+                return UINT32_MAX;
+        if (!type_grow((void **)&s->data, &s->cap, s->size + len - 1, 1))
+                return UINT32_MAX;
+
+        memcpy(s->data + s->size, str, (size_t)len);
+        s->slots[at] = (uint32_t)s->size;
+        s->size += len;
+        return s->slots[at];
+}
+
+static DwrfTypeTable *type_table_alloc(uint64_t types, uint64_t members)
+{
+        DwrfTypeTable *t = calloc(1, sizeof(DwrfTypeTable));
+
+        if (t == NULL)
+                return NULL;
+
+        t->types = malloc((size_t)types * sizeof(DwrfType) + 1);
+        t->first = malloc((size_t)types * sizeof(uint32_t) + 1);
+        t->members = malloc((size_t)members * sizeof(DwrfTypeMember) + 1);
+        if ((t->types == NULL) || (t->first == NULL) || (t->members == NULL))
+        {
+                dwarf_type_table_destroy(t);
+                return NULL;
+        }
+        t->stats.Types = types;
+        t->stats.Members = members;
+        return t;
+}
+
+/** Points the names, stored as offsets in the pool while the table is filled, into the strings */
+static void type_table_names(DwrfTypeTable *t, const uint32_t *type_names, const uint32_t *member_names)
+{
+        for (uint64_t i = 0; i < t->stats.Types; i++)
+                t->types[i].Name = type_names[i] ? t->strings + type_names[i] : NULL;
+        for (uint64_t i = 0; i < t->stats.Members; i++)
+                t->members[i].Name = member_names[i] ? t->strings + member_names[i] : NULL;
+
+        t->stats.Bytes = t->stats.Types * (sizeof(DwrfType) + sizeof(uint32_t)) +
+                         t->stats.Members * sizeof(DwrfTypeMember) + t->string_size;
+}
+
+/** One type per class of the final partition, numbered in node order */
+static DwrfResult type_emit(TypeBuilder *b, DwrfTypeTableStats *stats, DwrfTypeTable **table)
+{
+        uint32_t *ids = calloc((size_t)b->node_count + 1, sizeof(uint32_t));   // id of each class
+        uint32_t *reps = malloc((size_t)b->node_count * sizeof(uint32_t) + 1);
+        uint32_t *type_names = NULL, *member_names = NULL;
+        uint64_t types = 0, members = 0;
+        DwrfTypeTable *t = NULL;
+        TypeStrings strs;
+        DwrfResult res = DWRF_NO_MEM;
+
+        memset(&strs, 0, sizeof(strs));
+        if ((ids == NULL) || (reps == NULL))
+        {
+                free(ids);
+                free(reps);
+                return DWRF_NO_MEM;
+        }
+
+        for (uint32_t i = 0; i < b->node_count; i++)
+        {
+                if ((b->target[i] == i) && (ids[b->cls[i]] == 0))
+                {
+                        reps[types] = i;
+                        ids[b->cls[i]] = (uint32_t)++types;
+                        members += b->nodes[i].count;
+                }
+        }
+
+        if ((members < UINT32_MAX) && ((t = type_table_alloc(types, members)) != NULL) &&
+            type_strings_init(&strs, types + members) &&
+            ((type_names = malloc((size_t)types * sizeof(uint32_t) + 1)) != NULL) &&
+            ((member_names = malloc((size_t)members * sizeof(uint32_t) + 1)) != NULL))
+                res = DWRF_OK;
+
+        members = 0;
+        for (uint64_t id = 0; (id < types) && (res == DWRF_OK); id++)
+        {
+                const TypeNode *n = &b->nodes[reps[id]];
+                uint32_t ref = type_edge(b, b->node_ref[reps[id]]);
+
+                t->types[id] = (DwrfType){ NULL, n->size, (ref == TYPE_NONE) ? DWRF_TYPE_VOID : ids[ref], n->count,
+                                           n->tag, n->encoding, n->flags };
+                t->first[id] = (uint32_t)members;
+                type_names[id] = type_strings_add(&strs, n->name);
+                if (type_names[id] == UINT32_MAX)
+                        res = DWRF_NO_MEM;
+
+                for (uint64_t k = 0; (k < n->count) && (res == DWRF_OK); k++, members++)
+                {
+                        const TypeMember *m = &b->members[n->first + k];
+
+                        ref = type_edge(b, b->member_ref[n->first + k]);
+                        t->members[members] = (DwrfTypeMember){ NULL, m->value,
+                                                                (ref == TYPE_NONE) ? DWRF_TYPE_VOID : ids[ref],
+                                                                m->bit_size, m->tag };
+                        member_names[members] = type_strings_add(&strs, m->name);
+                        if (member_names[members] == UINT32_MAX)
+                                res = DWRF_NO_MEM;
+                }
+        }
+
+        if (res == DWRF_OK)
+        {
+                t->strings = strs.data;
+                t->string_size = strs.size;
+                strs.data = NULL;
+                type_table_names(t, type_names, member_names);
+
+                /* the node offsets become the DIE map */
+                t->die_types = malloc((size_t)b->node_count * sizeof(uint32_t) + 1);
+                if (t->die_types == NULL)
+                        res = DWRF_NO_MEM;
+                else
+                {
+                        for (uint32_t i = 0; i < b->node_count; i++)
+                                t->die_types[i] = ids[type_edge(b, i)];
+                        t->die_offsets = b->offsets;
+                        t->die_count = b->node_count;
+                        b->offsets = NULL;
+                }
+        }
+
+        if (res == DWRF_OK)
+        {
+                stats->Types = t->stats.Types;
+                stats->Members = t->stats.Members;
+                stats->Bytes = t->stats.Bytes;
+                stats->DieMapBytes = t->die_count * (sizeof(uint64_t) + sizeof(uint32_t));
+                t->stats = *stats;
+                *table = t;
+        }
+        else
+                dwarf_type_table_destroy(t);
+
+        free(strs.data);
+        free(strs.slots);
+        free(type_names);
+        free(member_names);
+        free(reps);
+        free(ids);
+        return res;
+}
+
+static DwrfResult type_build(TypeBuilder *b, uint32_t threads, DwrfTypeTableStats *stats, DwrfTypeTable **table)
+{
+        uint64_t n = b->node_count;
+
+        b->slot_count = 64;
+        while (b->slot_count < 2 * n)
+                b->slot_count *= 2;
+
+        b->node_ref = malloc((size_t)n * sizeof(uint32_t) + 1);
+        b->member_ref = malloc((size_t)b->member_count * sizeof(uint32_t) + 1);
+        b->target = malloc((size_t)n * sizeof(uint32_t) + 1);
+        b->cls = malloc((size_t)n * sizeof(uint32_t) + 1);
+        b->next = malloc((size_t)n * sizeof(uint32_t) + 1);
+        b->hash = malloc((size_t)n * sizeof(uint64_t) + 1);
+        b->slots = malloc((size_t)b->slot_count * sizeof(uint32_t));
+        if ((b->node_ref == NULL) || (b->member_ref == NULL) || (b->target == NULL) || (b->cls == NULL) ||
+            (b->next == NULL) || (b->hash == NULL) || (b->slots == NULL))
+                return DWRF_NO_MEM;
+
+        b->workers = dwrf_worker_count(threads, (n > b->member_count ? n : b->member_count) / TYPE_CHUNK + 1);
+        dwrf_run_jobs(b->workers, ((n > b->member_count ? n : b->member_count) + TYPE_CHUNK - 1) / TYPE_CHUNK,
+                      type_link_job, b);
+
+        for (uint32_t i = 0; i < n; i++)
+                b->target[i] = i;
+
+        type_refine(b, stats);
+
+        /* the references to a resolved declaration now reach the definition, which can merge more types */
+        stats->Declarations = type_resolve_decls(b);
+        if (stats->Declarations)
+                type_refine(b, stats);
+
+        return type_emit(b, stats, table);
+}
+
+/***************
+ *     API     *
+ ***************/
+
+DwrfResult dwarf_type_table_build(DwrfCtx *ctx, uint32_t threads, DwrfTypeTable **table)
+{
+        TypeBuilder b;
+        DwrfTypeTableStats stats;
+        DwrfResult res;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (table == NULL)
+                return DWRF_BAD_ARG;
+
+        memset(&b, 0, sizeof(b));
+        memset(&stats, 0, sizeof(stats));
+
+        res = dwarf_for_each_cu_parallel(ctx, threads, type_unit, type_merge, &b);
+        if (res == DWRF_OK)
+        {
+                stats.InputTypes = b.node_count;
+                stats.InputMembers = b.member_count;
+                stats.InputBytes = b.node_count * (sizeof(DwrfType) + sizeof(uint32_t)) +
+                                   b.member_count * sizeof(DwrfTypeMember) + b.name_bytes;
+                res = type_build(&b, threads, &stats, table);
+        }
+
+        free(b.nodes);
+        free(b.members);
+        free(b.offsets);
+        free(b.node_ref);
+        free(b.member_ref);
+        free(b.target);
+        free(b.cls);
+        free(b.next);
+        free(b.hash);
+        free(b.slots);
+        return res;
+}
+
+void dwarf_type_table_destroy(DwrfTypeTable *table)
+{
+        if (table == NULL)
+                return;
+
+        free(table->types);
+        free(table->first);
+        free(table->members);
+        free(table->strings);
+        free(table->die_offsets);
+        free(table->die_types);
+        free(table);
+}
+
+DwrfResult dwarf_type_table_get(const DwrfTypeTable *table, uint32_t id, DwrfType *type)
+{
+        if ((table == NULL) || (type == NULL) || (id == DWRF_TYPE_VOID) || (id > table->stats.Types))
+                return DWRF_BAD_ARG;
+
+        *type = table->types[id - 1];
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_type_table_members(const DwrfTypeTable *table, uint32_t id, const DwrfTypeMember **members,
+                                    uint32_t *count)
+{
+        if ((table == NULL) || (members == NULL) || (count == NULL) || (id == DWRF_TYPE_VOID) ||
+            (id > table->stats.Types))
+                return DWRF_BAD_ARG;
+
+        *members = table->members + table->first[id - 1];
+        *count = table->types[id - 1].MemberCount;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_type_table_die(const DwrfTypeTable *table, uint64_t die_offset, uint32_t *id)
+{
+        uint64_t lo = 0, hi;
+
+        if ((table == NULL) || (id == NULL))
+                return DWRF_BAD_ARG;
+
+        hi = table->die_count;
+        while (lo < hi)
+        {
+                uint64_t mid = lo + (hi - lo) / 2;
+
+                if (table->die_offsets[mid] < die_offset)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if ((lo == table->die_count) || (table->die_offsets[lo] != die_offset))
+                return DWRF_NOT_FOUND;
+
+        *id = table->die_types[lo];
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_type_table_stats(const DwrfTypeTable *table, DwrfTypeTableStats *stats)
+{
+        if ((table == NULL) || (stats == NULL))
+                return DWRF_BAD_ARG;
+
+        *stats = table->stats;
+        return DWRF_OK;
+}
+
+/***************
+ *    Blobs    *
+ ***************/
+
+static void type_put16(uint8_t *p, uint16_t v)
+{
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+}
+
+static void type_put32(uint8_t *p, uint32_t v)
+{
+        type_put16(p, (uint16_t)v);
+        type_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void type_put64(uint8_t *p, uint64_t v)
+{
+        type_put32(p, (uint32_t)v);
+        type_put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint32_t type_name_offset(const DwrfTypeTable *t, const char *name)
+{
+        return name ? (uint32_t)(name - t->strings) : 0;
+}
+
+DwrfResult dwarf_type_table_serialize(const DwrfTypeTable *table, void *buff, uint64_t len, uint64_t *size)
+{
+        uint8_t *p = buff;
+        uint64_t need;
+
+        if ((table == NULL) || (size == NULL))
+                return DWRF_BAD_ARG;
+
+        need = TYPE_HDR_SIZE + table->stats.Types * TYPE_REC_SIZE + table->stats.Members * TYPE_MEMBER_SIZE +
+               table->string_size;
+        *size = need;
+        if (buff == NULL)
+                return DWRF_OK;
+        if (len < need)
+                return DWRF_BUFFER_OVERFLOW;
+
+        memset(p, 0, (size_t)need);
+        type_put32(p, TYPE_MAGIC);
+        type_put16(p + 4, TYPE_VERSION);
+        type_put16(p + 6, TYPE_HDR_SIZE);
+        type_put32(p + 8, (uint32_t)table->stats.Types);
+        type_put32(p + 12, (uint32_t)table->stats.Members);
+        type_put32(p + 16, (uint32_t)table->string_size);
+        p += TYPE_HDR_SIZE;
+
+        for (uint64_t i = 0; i < table->stats.Types; i++, p += TYPE_REC_SIZE)
+        {
+                const DwrfType *t = &table->types[i];
+
+                type_put32(p, type_name_offset(table, t->Name));
+                type_put32(p + 4, t->Type);
+                type_put32(p + 8, table->first[i]);
+                type_put32(p + 12, t->MemberCount);
+                type_put64(p + 16, t->Size);
+                type_put16(p + 24, t->Tag);
+                p[26] = t->Encoding;
+                p[27] = t->Flags;
+        }
+
+        for (uint64_t i = 0; i < table->stats.Members; i++, p += TYPE_MEMBER_SIZE)
+        {
+                const DwrfTypeMember *m = &table->members[i];
+
+                type_put32(p, type_name_offset(table, m->Name));
+                type_put32(p + 4, m->Type);
+                type_put64(p + 8, m->Value);
+                type_put32(p + 16, m->BitSize);
+                type_put16(p + 20, m->Tag);
+        }
+
+        memcpy(p, table->strings, (size_t)table->string_size);
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_type_table_load(const void *blob, uint64_t size, DwrfTypeTable **table)
+{
+        const uint8_t *p = blob;
+        uint64_t types, members, strings, hdr;
+        uint32_t *type_names, *member_names;
+        DwrfTypeTable *t;
+        DwrfResult res = DWRF_OK;
+
+        if ((blob == NULL) || (table == NULL))
+                return DWRF_BAD_ARG;
+
+        if ((size < TYPE_HDR_SIZE) || (load_uN(p, 4, false) != TYPE_MAGIC))
+                return DWRF_DECODE_ERR;
+        if (load_uN(p + 4, 2, false) != TYPE_VERSION)
+                return DWRF_UNSUPPORTED;
+
+        hdr = load_uN(p + 6, 2, false);
+        types = load_uN(p + 8, 4, false);
+        members = load_uN(p + 12, 4, false);
+        strings = load_uN(p + 16, 4, false);
+        if ((hdr < TYPE_HDR_SIZE) || (strings == 0) ||
+            (hdr + types * TYPE_REC_SIZE + members * TYPE_MEMBER_SIZE + strings > size) ||
+            (p[hdr + types * TYPE_REC_SIZE + members * TYPE_MEMBER_SIZE + strings - 1] != '\0'))
+                return DWRF_DECODE_ERR;
+
+        t = type_table_alloc(types, members);
+        type_names = malloc((size_t)types * sizeof(uint32_t) + 1);
+        member_names = malloc((size_t)members * sizeof(uint32_t) + 1);
+        if ((t == NULL) || (type_names == NULL) || (member_names == NULL) ||
+            ((t->strings = malloc((size_t)strings)) == NULL))
+        {
+                dwarf_type_table_destroy(t);
+                free(type_names);
+                free(member_names);
+                return DWRF_NO_MEM;
+        }
+
+        p += hdr;
+        for (uint64_t i = 0; i < types; i++, p += TYPE_REC_SIZE)
+        {
+                DwrfType *ty = &t->types[i];
+                uint64_t first = load_uN(p + 8, 4, false);
+
+                type_names[i] = (uint32_t)load_uN(p, 4, false);
+                ty->Type = (uint32_t)load_uN(p + 4, 4, false);
+                ty->MemberCount = (uint32_t)load_uN(p + 12, 4, false);
+                ty->Size = load_uN(p + 16, 8, false);
+                ty->Tag = (uint16_t)load_uN(p + 24, 2, false);
+                ty->Encoding = p[26];
+                ty->Flags = p[27];
+                t->first[i] = (uint32_t)first;
+
+                if ((type_names[i] >= strings) || (ty->Type > types) || (first + ty->MemberCount > members))
+                        res = DWRF_DECODE_ERR;
+        }
+
+        for (uint64_t i = 0; i < members; i++, p += TYPE_MEMBER_SIZE)
+        {
+                DwrfTypeMember *m = &t->members[i];
+
+                member_names[i] = (uint32_t)load_uN(p, 4, false);
+                m->Type = (uint32_t)load_uN(p + 4, 4, false);
+                m->Value = load_uN(p + 8, 8, false);
+                m->BitSize = (uint32_t)load_uN(p + 16, 4, false);
+                m->Tag = (uint16_t)load_uN(p + 20, 2, false);
+
+                if ((member_names[i] >= strings) || (m->Type > types))
+                        res = DWRF_DECODE_ERR;
+        }
+
+        if (res == DWRF_OK)
+        {
+                memcpy(t->strings, p, (size_t)strings);
+                t->string_size = strings;
+                type_table_names(t, type_names, member_names);
+                *table = t;
+        }
+        else
+                dwarf_type_table_destroy(t);
+
+        free(type_names);
+        free(member_names);
+        return res;
+}
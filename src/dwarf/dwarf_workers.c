@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(DWRF_NO_THREADS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // pthreads and sysconf
+#endif
+
+#include "dwarf_internal.h"
+
+#ifndef DWRF_NO_THREADS
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#endif
+
+/***************
+ *   Workers   *
+ ***************/
+
+DwrfResult dwrf_prepare_workers(InternalDwarfCtx *ctx)
+{
+        DwrfSection *sections[] = {
+                &ctx->debug_info, &ctx->debug_abbrev, &ctx->debug_str, &ctx->debug_line, &ctx->debug_line_str,
+                &ctx->debug_str_offsets, &ctx->debug_ranges, &ctx->debug_rnglists, &ctx->debug_addr,
+                &ctx->debug_loclists, &ctx->debug_loc,
+        };
+        const DwrfUnitBases *bases;
+        DwrfCursor cur;
+        DwrfUnitHeader unit;
+        uint64_t off = 0;
+        DwrfResult res;
+
+        for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++)
+        {
+                if ((sections[i] == &ctx->debug_info) || (sections[i] == &ctx->debug_abbrev) || sections[i]->present)
+                {
+                        if ((res = dwrf_load_section(ctx, sections[i])))
+                                return res;
+                }
+        }
+
+        /* entering a unit caches its abbreviation table, its bases are cached next */
+        dwarf_cursor_init((DwrfCtx *)ctx, &cur);
+        while ((res = dwarf_get_unit_header((DwrfCtx *)ctx, off, &unit)) == DWRF_OK)
+        {
+                if ((res = dwarf_cursor_seek_unit(&cur, unit.Offset)) || (res = dwrf_unit_bases(ctx, &unit, &bases)))
+                        return res;
+                off = unit.NextOffset;
+        }
+
+        /* BAD_ARG marks the end of the section */
+        return (res == DWRF_BAD_ARG) ? DWRF_OK : res;
+}
+
+void dwrf_worker_ctx(const InternalDwarfCtx *ctx, DwrfCtx *worker)
+{
+        InternalDwarfCtx *w = CTX(worker);
+
+        memcpy(w, ctx, sizeof(InternalDwarfCtx));
+        w->stats = (DwrfStats){0};
+        w->arena = (DwrfArena){0};      // never hands out the free space of the original's chunks
+}
+
+void dwrf_worker_join(InternalDwarfCtx *ctx, const DwrfCtx *worker)
+{
+        const DwrfStats *s = &CTX(worker)->stats;
+
+        ctx->stats.AbbrevTables += s->AbbrevTables;
+        ctx->stats.Abbrevs += s->Abbrevs;
+        ctx->stats.AbbrevHits += s->AbbrevHits;
+        ctx->stats.DiesSkipped += s->DiesSkipped;
+}
+
+uint32_t dwrf_worker_count(uint32_t threads, uint64_t jobs)
+{
+#ifndef DWRF_NO_THREADS
+        if (threads == 0)
+        {
+                long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                threads = (cpus > 0) ? (uint32_t)cpus : 1;
+        }
+        if (threads > DWRF_MAX_WORKERS)
+                threads = DWRF_MAX_WORKERS;
+        if (threads > jobs)
+                threads = (uint32_t)jobs;
+        return threads ? threads : 1;
+#else
+        (void)threads;
+        (void)jobs;
+        return 1;
+#endif
+}
+
+/*
+ * Work stealing: each thread owns a range of jobs packed in one 64-bit word (next job in the
+ * low half, end in the high half) so the owner and the thieves agree with a single CAS. The
+ * owner takes jobs from the front of its range, a thread that runs out takes the back half of
+ * the largest range left. Neighbouring units stay on the same thread until the end.
+ */
+
+#define JOB_RANGE(next, end) (((uint64_t)(end) << 32) | (uint32_t)(next))
+#define JOB_NEXT(range)      ((uint32_t)(range))
+#define JOB_END(range)       ((uint32_t)((range) >> 32))
+
+typedef struct
+{
+        DwrfJobFn fn;
+        void *arg;
+        uint64_t base;          // job number of range position 0
+        uint32_t workers;
+#ifndef DWRF_NO_THREADS
+        atomic_uint_fast64_t ranges[DWRF_MAX_WORKERS];
+#else
+        uint64_t ranges[DWRF_MAX_WORKERS];
+#endif
+} JobQueue;
+
+typedef struct
+{
+        JobQueue *queue;
+        uint32_t worker;
+} JobWorker;
+
+#ifndef DWRF_NO_THREADS
+
+/** Takes the next job of a range, false once it is empty. */
+static int job_take(atomic_uint_fast64_t *range, uint32_t *job)
+{
+        uint_fast64_t r = atomic_load(range);
+
+        while (JOB_NEXT(r) < JOB_END(r))
+        {
+                if (atomic_compare_exchange_weak(range, &r, JOB_RANGE(JOB_NEXT(r) + 1, JOB_END(r))))
+                {
+                        *job = JOB_NEXT(r);
+                        return true;
+                }
+        }
+        return false;
+}
+
+/** Moves the back half of the largest range of the other threads to the thief's range, false if nothing is left. */
+static int job_steal(JobQueue *q, uint32_t thief)
+{
+        for (;;)
+        {
+                uint32_t victim = thief, most = 0;
+                uint_fast64_t r;
+
+                for (uint32_t i = 0; i < q->workers; i++)
+                {
+                        r = atomic_load(&q->ranges[i]);
+                        if ((i != thief) && (JOB_END(r) - JOB_NEXT(r) > most) && (JOB_NEXT(r) < JOB_END(r)))
+                        {
+                                most = JOB_END(r) - JOB_NEXT(r);
+                                victim = i;
+                        }
+                }
+                if (victim == thief)
+                        return false;
+
+                r = atomic_load(&q->ranges[victim]);
+                if (JOB_NEXT(r) >= JOB_END(r))
+                        continue;
+
+                /* a single job left is taken whole */
+                uint32_t mid = JOB_END(r) - (JOB_END(r) - JOB_NEXT(r) + 1) / 2;
+                if (atomic_compare_exchange_strong(&q->ranges[victim], &r, JOB_RANGE(JOB_NEXT(r), mid)))
+                {
+                        /* only the owner refills its empty range, thieves skip it meanwhile */
+                        atomic_store(&q->ranges[thief], JOB_RANGE(mid, JOB_END(r)));
+                        return true;
+                }
+        }
+}
+
+#endif
+
+/** Runs jobs until every range is empty, run by every thread. */
+static void *job_worker(void *arg)
+{
+        JobWorker *jw = arg;
+        JobQueue *q = jw->queue;
+        uint32_t job;
+
+#ifndef DWRF_NO_THREADS
+        do
+        {
+                while (job_take(&q->ranges[jw->worker], &job))
+                        q->fn(q->arg, q->base + job, jw->worker);
+        } while (job_steal(q, jw->worker));
+#else
+        for (job = JOB_NEXT(q->ranges[0]); job < JOB_END(q->ranges[0]); job++)
+                q->fn(q->arg, q->base + job, jw->worker);
+#endif
+        return NULL;
+}
+
+/** Runs a batch of at most UINT32_MAX jobs, the ranges hold 32-bit positions. */
+static void run_batch(JobQueue *q, uint32_t workers, uint32_t count)
+{
+        JobWorker jw[DWRF_MAX_WORKERS];
+
+        q->workers = workers;
+        for (uint32_t i = 0; i < workers; i++)
+        {
+                uint32_t first = (uint32_t)((uint64_t)count * i / workers);
+                uint32_t last = (uint32_t)((uint64_t)count * (i + 1) / workers);
+#ifndef DWRF_NO_THREADS
+                atomic_init(&q->ranges[i], JOB_RANGE(first, last));
+#else
+                q->ranges[i] = JOB_RANGE(first, last);
+#endif
+                jw[i] = (JobWorker){ q, i };
+        }
+
+#ifndef DWRF_NO_THREADS
+        pthread_t tids[DWRF_MAX_WORKERS];
+        uint32_t n = 0;
+
+        /* the calling thread is worker 0, the share of a thread that fails to start is stolen by the others */
+        for (uint32_t i = 1; i < workers; i++)
+        {
+                if (pthread_create(&tids[n], NULL, job_worker, &jw[i]) == 0)
+                        n++;
+        }
+        job_worker(&jw[0]);
+        for (uint32_t i = 0; i < n; i++)
+                pthread_join(tids[i], NULL);
+#else
+        job_worker(&jw[0]);
+#endif
+}
+
+void dwrf_run_jobs(uint32_t workers, uint64_t count, DwrfJobFn fn, void *arg)
+{
+        JobQueue q = { .fn = fn, .arg = arg };
+
+        if (workers == 0)
+                workers = 1;
+        if (workers > DWRF_MAX_WORKERS)
+                workers = DWRF_MAX_WORKERS;
+#ifdef DWRF_NO_THREADS
+        workers = 1;
+#endif
+
+        while (q.base < count)
+        {
+                uint32_t batch = (count - q.base > UINT32_MAX) ? UINT32_MAX : (uint32_t)(count - q.base);
+
+                run_batch(&q, workers, batch);
+                q.base += batch;
+        }
+}
+
+/***************
+ *  Parallel   *
+ ***************/
+
+typedef struct
+{
+        DwrfUnitFn fn;
+        void *user;
+        const DwrfUnitHeader *units;
+        void **results;
+        DwrfResult *status;
+        DwrfCtx *workers;
+        DwrfArena *arenas;
+} UnitJobs;
+
+static void unit_job(void *arg, uint64_t job, uint32_t worker)
+{
+        UnitJobs *jobs = arg;
+
+        jobs->status[job] = jobs->fn(&jobs->workers[worker], &jobs->units[job], &jobs->arenas[worker], jobs->user,
+                                     &jobs->results[job]);
+}
+
+/** Headers of every unit of .debug_info, in section order. */
+static DwrfResult collect_units(InternalDwarfCtx *ctx, DwrfUnitHeader **out, uint64_t *out_count)
+{
+        DwrfUnitHeader *units = NULL, unit;
+        uint64_t count = 0, cap = 0, off = 0;
+        DwrfResult res;
+
+        while ((res = dwarf_get_unit_header((DwrfCtx *)ctx, off, &unit)) == DWRF_OK)
+        {
+                if (count == cap)
+                {
+                        DwrfUnitHeader *grown;
+
+                        cap = cap ? 2 * cap : 64;
+                        grown = realloc(units, (size_t)cap * sizeof(DwrfUnitHeader));
+                        if (grown == NULL)
+                        {
+                                free(units);
+                                return DWRF_NO_MEM;
+                        }
+                        units = grown;
+                }
+                units[count++] = unit;
+                off = unit.NextOffset;
+        }
+
+        /* BAD_ARG marks the end of the section */
+        if (res != DWRF_BAD_ARG)
+        {
+                free(units);
+                return res;
+        }
+
+        *out = units;
+        *out_count = count;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_for_each_cu_parallel(DwrfCtx *ctx, uint32_t threads, DwrfUnitFn fn, DwrfUnitMergeFn merge, void *user)
+{
+        UnitJobs jobs = { .fn = fn, .user = user };
+        DwrfUnitHeader *units;
+        uint64_t count;
+        uint32_t workers;
+        DwrfResult res;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (fn == NULL)
+                return DWRF_BAD_ARG;
+
+        if ((res = dwrf_prepare_workers(CTX(ctx))) || (res = collect_units(CTX(ctx), &units, &count)))
+                return res;
+        if (count == 0)
+        {
+                free(units);
+                return DWRF_OK;
+        }
+
+        workers = dwrf_worker_count(threads, count);
+        jobs.units = units;
+        jobs.results = calloc((size_t)count, sizeof(void *));
+        jobs.status = calloc((size_t)count, sizeof(DwrfResult));
+        jobs.workers = malloc(workers * sizeof(DwrfCtx));
+        jobs.arenas = malloc(workers * sizeof(DwrfArena));
+        if ((jobs.results == NULL) || (jobs.status == NULL) || (jobs.workers == NULL) || (jobs.arenas == NULL))
+                res = DWRF_NO_MEM;
+        else
+        {
+                for (uint32_t i = 0; i < workers; i++)
+                {
+                        dwrf_worker_ctx(CTX(ctx), &jobs.workers[i]);
+                        dwrf_arena_init(&jobs.arenas[i]);
+                }
+
+                dwrf_run_jobs(workers, count, unit_job, &jobs);
+
+                for (uint32_t i = 0; i < workers; i++)
+                        dwrf_worker_join(CTX(ctx), &jobs.workers[i]);
+
+                /* the first failing unit in section order, so the result doesn't depend on scheduling */
+                for (uint64_t i = 0; (i < count) && (res == DWRF_OK); i++)
+                        res = jobs.status[i];
+
+                for (uint64_t i = 0; (i < count) && (res == DWRF_OK) && (merge != NULL); i++)
+                        res = merge(user, &units[i], jobs.results[i]);
+
+                for (uint32_t i = 0; i < workers; i++)
+                        dwrf_arena_destroy(&jobs.arenas[i]);
+        }
+
+        free(jobs.arenas);
+        free(jobs.workers);
+        free(jobs.status);
+        free(jobs.results);
+        free(units);
+        return res;
+}
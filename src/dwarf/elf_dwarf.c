@@ -22,47 +22,376 @@
 
 //? NOTE: keep area of effect of switching elf_core low. this may be useful for other stuff.
 
-#include <stddef.h>
-#include "elf_dwarf.h"
-#include "dwarf_consts.h"
+#include "dwarf_internal.h"
+#include "common/elf_repr.h"
 
-#define CTX(ctx) ((InternalDwarfCtx *)(ctx))
-
-//TODO: this may change to heap allocated copies of the section data.
-typedef struct
-{
-        const ElfCtx *elf;
-        ElfSecHeader debug_info;
-        ElfSecHeader debug_abbrev;
-        ElfSecHeader debug_str;
-        uint8_t initialized;
-} InternalDwarfCtx;
-
-_Static_assert(sizeof(InternalDwarfCtx) <= DWARF_CTX_SIZE, "DWARF_CTX_SIZE too small");
+#if defined(DWRF_ZLIB)
+#include <zlib.h>
+#endif
 
 /***************
  *    Abbrev   *
  ***************/ 
  // section 7.5.3 of spec v5
+
+/* Size classes of a form, values below DWRF_FSZ_BAD are a size in bytes. */
+#define DWRF_FSZ_BAD    0xFC    // unknown form
+#define DWRF_FSZ_ADDR   0xFD    // address size of the unit
+#define DWRF_FSZ_OFFSET 0xFE    // 4 or 8 depending on 32/64-bit DWARF
+#define DWRF_FSZ_VAR    0xFF    // size is encoded in the data (LEB128, strings, blocks...)
+
 typedef struct {
-    DwrfAttrName name;
-    DwrfForm form;
-    int64_t implicit_const;
+        uint16_t name;          // DwrfAttrName
+        uint16_t form;          // DwrfForm
+        uint8_t  size;          // size in bytes or DWRF_FSZ_* class
+        int64_t  implicit_const;
 } DwrfAttrSpec;
 
 typedef struct {
-        uint32_t code; //TODO: determine size
+        uint32_t code;          // 0 marks an unused slot of a dense table
         uint16_t tag;
-        bool has_children;
-        //TODO: list of attrspecs. (num + pointer?)
-        //parsing ends on some conditions like 0 name or somethin, look it up.
+        uint8_t  has_children;
+        uint8_t  fixed;         // size of the attributes only depends on the unit header
+        uint32_t first_spec;    // index of the first attribute in the table's spec array
+        uint16_t spec_count;
+        uint16_t fixed_bytes;   // sum of the sizes known from the form alone
+        uint8_t  addr_count;    // attributes sized as the unit's address
+        uint8_t  offset_count;  // attributes sized as the unit's offsets
+        uint16_t sibling;       // index of DW_AT_sibling relative to first_spec, DWRF_NO_SIBLING if absent
 } DwrfAbbr;
 
+#define DWRF_NO_SIBLING 0xFFFFu
+
+/**
+ * Parsed abbreviation table of one .debug_abbrev offset, shared by every unit that references it.
+ * Abbrev codes are usually dense (1..N) so the declarations are stored in a flat array indexed by
+ * code, tables with very sparse codes fall back to an array sorted by code.
+ * The table, the declarations and the attribute specs live in a single allocation.
+ */
+typedef struct {
+        uint64_t offset;
+        uint32_t count;         // number of declarations
+        uint32_t max_code;
+        uint8_t  dense;         // abbrevs[code] addressing, otherwise sorted by code
+        DwrfAbbr *abbrevs;
+        DwrfAttrSpec *specs;
+} DwrfAbbrevTable;
+
+
+/***************
+ *     Map     *
+ ***************/
 
+static inline uint32_t dwrf_map_slot(const DwrfMap *m, uint64_t key)
+{
+        /* Fibonacci hashing, offsets are often multiples of small powers of two */
+        return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (m->capacity - 1);
+}
 
-DwrfResult dwarf_init(const ElfCtx *elf, DwrfCtx *ctx)
+void *dwrf_map_get(const DwrfMap *m, uint64_t key)
+{
+        if (m->capacity == 0)
+                return NULL;
+
+        for (uint32_t i = dwrf_map_slot(m, key); m->slots[i].val != NULL; i = (i + 1) & (m->capacity - 1))
+        {
+                if (m->slots[i].key == key)
+                        return m->slots[i].val;
+        }
+        return NULL;
+}
+
+DwrfResult dwrf_map_put(DwrfMap *m, uint64_t key, void *val)
+{
+        if (val == NULL)
+                return DWRF_BAD_ARG;
+
+        /* keep the load factor under 3/4 */
+        if ((m->count + 1) * 4 > m->capacity * 3)
+        {
+                DwrfMap grown = { .count = 0, .capacity = (m->capacity == 0) ? 16 : m->capacity * 2 };
+
+                grown.slots = calloc(grown.capacity, sizeof(DwrfMapSlot));
+                if (grown.slots == NULL)
+                        return DWRF_NO_MEM;
+
+                for (uint32_t i = 0; i < m->capacity; i++)
+                {
+                        if (m->slots[i].val != NULL)
+                                dwrf_map_put(&grown, m->slots[i].key, m->slots[i].val);
+                }
+
+                free(m->slots);
+                *m = grown;
+        }
+
+        uint32_t i = dwrf_map_slot(m, key);
+        while ((m->slots[i].val != NULL) && (m->slots[i].key != key))
+                i = (i + 1) & (m->capacity - 1);
+
+        if (m->slots[i].val == NULL)
+                m->count++;
+
+        m->slots[i].key = key;
+        m->slots[i].val = val;
+        return DWRF_OK;
+}
+
+void *dwrf_map_remove(DwrfMap *m, uint64_t key)
+{
+        uint32_t mask = m->capacity - 1;
+        uint32_t i;
+        void *val;
+
+        if (m->capacity == 0)
+                return NULL;
+
+        for (i = dwrf_map_slot(m, key); m->slots[i].val != NULL; i = (i + 1) & mask)
+        {
+                if (m->slots[i].key == key)
+                        break;
+        }
+        if ((val = m->slots[i].val) == NULL)
+                return NULL;
+
+        /* backward shift: later entries of the cluster move into the hole unless it is before their home slot */
+        for (uint32_t j = (i + 1) & mask; m->slots[j].val != NULL; j = (j + 1) & mask)
+        {
+                uint32_t home = dwrf_map_slot(m, m->slots[j].key);
+
+                if (((j - home) & mask) >= ((j - i) & mask))
+                {
+                        m->slots[i] = m->slots[j];
+                        i = j;
+                }
+        }
+
+        m->slots[i].val = NULL;
+        m->count--;
+        return val;
+}
+
+void dwrf_map_destroy(DwrfMap *m, DwrfElemDestroyFn destroy)
+{
+        if (destroy)
+        {
+                for (uint32_t i = 0; i < m->capacity; i++)
+                {
+                        if (m->slots[i].val != NULL)
+                                destroy(m->slots[i].val);
+                }
+        }
+
+        free(m->slots);
+        m->slots = NULL;
+        m->count = 0;
+        m->capacity = 0;
+}
+
+/* Names of the section slots without their ".debug_" (or ".zdebug_") prefix, NULL for the ones matched by full name */
+static const char *const section_names[DWRF_SEC_COUNT] = {
+        [DWRF_SEC_INFO]         = "info",
+        [DWRF_SEC_ABBREV]       = "abbrev",
+        [DWRF_SEC_STR]          = "str",
+        [DWRF_SEC_LINE]         = "line",
+        [DWRF_SEC_LINE_STR]     = "line_str",
+        [DWRF_SEC_ARANGES]      = "aranges",
+        [DWRF_SEC_RANGES]       = "ranges",
+        [DWRF_SEC_RNGLISTS]     = "rnglists",
+        [DWRF_SEC_ADDR]         = "addr",
+        [DWRF_SEC_NAMES]        = "names",
+        [DWRF_SEC_STR_OFFSETS]  = "str_offsets",
+        [DWRF_SEC_LOCLISTS]     = "loclists",
+        [DWRF_SEC_LOC]          = "loc",
+        [DWRF_SEC_FRAME]        = "frame",
+        [DWRF_SEC_MACRO]        = "macro",
+        [DWRF_SEC_CU_INDEX]     = "cu_index",
+        [DWRF_SEC_TU_INDEX]     = "tu_index",
+        [DWRF_SEC_EH_FRAME]     = NULL,
+        [DWRF_SEC_EH_FRAME_HDR] = NULL,
+        [DWRF_SEC_GDB_INDEX]    = NULL,
+};
+
+static void section_init(DwrfSection *sec)
+{
+        *sec = (DwrfSection){0};
+}
+
+/**
+ * Slot of a section name, -1 if it isn't a DWARF section we know. *gnu is set for .zdebug_ names
+ * and *dwo for the names split DWARF files use (.debug_info.dwo...).
+ */
+static int section_slot(const char *name, uint8_t *gnu, uint8_t *dwo)
+{
+        const char *suffix;
+        size_t len;
+
+        *gnu = false;
+        *dwo = false;
+        if (strcmp(name, ".eh_frame") == 0)
+                return DWRF_SEC_EH_FRAME;
+        if (strcmp(name, ".eh_frame_hdr") == 0)
+                return DWRF_SEC_EH_FRAME_HDR;
+        if (strcmp(name, ".gdb_index") == 0)
+                return DWRF_SEC_GDB_INDEX;
+
+        if (strncmp(name, ".debug_", 7) == 0)
+                suffix = name + 7;
+        else if (strncmp(name, ".zdebug_", 8) == 0)
+        {
+                suffix = name + 8;
+                *gnu = true;
+        }
+        else
+                return -1;
+
+        len = strlen(suffix);
+        if ((len > 4) && (strcmp(suffix + len - 4, ".dwo") == 0))
+        {
+                len -= 4;
+                *dwo = true;
+        }
+
+        for (int i = 0; i < DWRF_SEC_COUNT; i++)
+        {
+                if ((section_names[i] != NULL) && (strncmp(suffix, section_names[i], len) == 0) &&
+                    (section_names[i][len] == '\0'))
+                        return i;
+        }
+        return -1;
+}
+
+/**
+ * Reads the compression header of a section so hdr.Size becomes the size of the contents:
+ * an Elf32/64 Chdr for SHF_COMPRESSED, "ZLIB" and a big endian 64-bit size for .zdebug_*.
+ */
+static DwrfResult section_read_packing(InternalDwarfCtx *ctx, const ElfHeader *ehdr, DwrfSection *sec, uint8_t gnu)
+{
+        uint8_t chdr[24];
+        uint8_t big = (ctx->endianness == ELFDATA2MSB);
+        uint8_t wide = (ehdr->EI_Class == ELFCLASS64);
+        uint64_t type, size;
+        uint8_t len;
+
+        len = gnu ? 12 : (wide ? 24 : 12);
+        if (sec->hdr.Size < len)
+                return DWRF_DECODE_ERR;
+        if (get_section_data(ctx->elf, &sec->hdr, 0, len, chdr) != ELF_OK)
+                return DWRF_IO_ERR;
+
+        if (gnu)
+        {
+                /* GNU .zdebug_ sections that don't start with the magic are stored as is */
+                if (memcmp(chdr, "ZLIB", 4) != 0)
+                        return DWRF_OK;
+                type = ELFCOMPRESS_ZLIB;
+                size = load_uN(chdr + 4, 8, true);
+        }
+        else
+        {
+                type = load_uN(chdr, 4, big);
+                size = wide ? load_uN(chdr + 8, 8, big) : load_uN(chdr + 4, 4, big);
+        }
+
+        sec->packed_size = sec->hdr.Size;
+        sec->hdr.Size = size;
+        sec->pack_header = len;
+        sec->packing = (type == ELFCOMPRESS_ZLIB) ? DWRF_PACK_ZLIB : DWRF_PACK_OTHER;
+        return DWRF_OK;
+}
+
+/** Whether the first unit of an uncompressed .debug_info section is a type unit. */
+static int section_holds_types(const InternalDwarfCtx *ctx, const ElfSecHeader *sh)
+{
+        uint8_t hdr[16];
+        uint8_t big = (ctx->endianness == ELFDATA2MSB);
+        uint8_t at;
+
+        if ((sh->Flags & SHF_COMPRESSED) || (sh->Size < sizeof(hdr)) ||
+            (get_section_data(ctx->elf, sh, 0, sizeof(hdr), hdr) != ELF_OK))
+                return false;
+
+        /* unit_length (with its 64-bit escape), version and unit_type */
+        at = (load_uN(hdr, 4, big) == 0xffffffffULL) ? 12 : 4;
+        if (load_uN(hdr + at, 2, big) != 5)
+                return false;
+        return (hdr[at + 2] == DW_UT_type) || (hdr[at + 2] == DW_UT_split_type);
+}
+
+/**
+ * Whether a section replaces the one already found for its slot. Regular names win over .dwo ones and
+ * when type units have sections of their own (as in the .dwo files GCC writes) the .debug_info that
+ * holds the compilation unit wins.
+ */
+static int section_replaces(const InternalDwarfCtx *ctx, int slot, const DwrfSection *cur, const ElfSecHeader *sh,
+                            uint8_t dwo)
+{
+        if (cur->dwo != dwo)
+                return cur->dwo;
+        return (slot == DWRF_SEC_INFO) && section_holds_types(ctx, &cur->hdr) && !section_holds_types(ctx, sh);
+}
+
+/**
+ * Fills the section slots in a single pass over the section header table. The names are
+ * read from one copy of the section name table, the first section with a given name wins
+ * unless section_replaces() prefers a later one.
+ */
+static DwrfResult discover_sections(InternalDwarfCtx *ctx, const ElfHeader *ehdr)
+{
+        ElfSecHeader strtab, sh;
+        DwrfResult res = DWRF_OK;
+        char *names;
+
+        if (get_section_header(ctx->elf, ehdr->SecStrIndx, &strtab) != ELF_OK)
+                return DWRF_SEC_MISSING;
+
+        if (strtab.Size >= SIZE_MAX)
+                return DWRF_NO_MEM;
+
+        names = malloc((size_t)strtab.Size + 1);
+        if (names == NULL)
+                return DWRF_NO_MEM;
+
+        if (get_section_data(ctx->elf, &strtab, 0, strtab.Size, names) != ELF_OK)
+        {
+                free(names);
+                return DWRF_IO_ERR;
+        }
+        names[strtab.Size] = '\0';     // a truncated last name still ends
+
+        // Skip NULL section
+        for (uint32_t i = 1; (i < ehdr->SHEntryNum) && (res == DWRF_OK); i++)
+        {
+                uint8_t gnu, dwo;
+                int slot;
+
+                /* malformed headers can't be one of ours, the contents of SHT_NOBITS sections (e.g. the
+                 * .eh_frame of a file made by objcopy --only-keep-debug) are not in the file */
+                if ((get_section_header(ctx->elf, i, &sh) != ELF_OK) || (sh.NameIdx >= strtab.Size) ||
+                    (sh.Type == SHT_NOBITS))
+                        continue;
+
+                slot = section_slot(names + sh.NameIdx, &gnu, &dwo);
+                if ((slot < 0) || (ctx->sections[slot].present && !section_replaces(ctx, slot, &ctx->sections[slot], &sh, dwo)))
+                        continue;
+
+                DwrfSection *sec = &ctx->sections[slot];
+                section_init(sec);
+                sec->hdr = sh;
+                sec->present = true;
+                sec->dwo = dwo;
+                if ((sh.Flags & SHF_COMPRESSED) || gnu)
+                        res = section_read_packing(ctx, ehdr, sec, !(sh.Flags & SHF_COMPRESSED));
+        }
+
+        free(names);
+        return res;
+}
+
+DwrfResult dwrf_open_sections(const ElfCtx *elf, DwrfCtx *ctx)
 {
-        ElfResult err;
+        DwrfResult res;
+        ElfHeader hdr;
 
         if ((elf == NULL)||(ctx == NULL))
                 return DWRF_BAD_ARG;
@@ -70,146 +399,1443 @@ DwrfResult dwarf_init(const ElfCtx *elf, DwrfCtx *ctx)
         CTX(ctx)->elf = elf;
         CTX(ctx)->initialized = false;
 
-        /**  TODO: only cache does that exist and set the rest to NULL,
-         *   possible sections are:
-         *      .debug_abbrev   - abbreviations used in .debug_info
-         *      .debug_aranges  - map between addr and compilation
-         *      .debug_frame    - call frame info
-         *      .debug_info
-         *      .debug_line     - line numbers program
-         *      .debug_loclists - locations (replaces loc)
-         *      .debug_macinfo  X macros (replaced with .debug_macro)
-         *      .debug_macro    - macros 
-         *      .debug_pubnames X LUT for global objects anf functions
-         *      .debug_pubtypes X LUT for global types
-         *      .debug_names    - replaces pubtypes and pubnames
-         *      .debug_rnglits  - addr ranges (replaces ranges)
-         *      .debug_str      - string table for .debug_info
-         *      .debug_types    X type description (merged into .debug_info)
-         * 
-         *   It would be nice to know which of those are mandatory
-         *   Also look up if version 5 introduces more.
-         *       
-         */      
-        err  = get_section_by_name(elf, ".debug_info", &CTX(ctx)->debug_info);
-        err += get_section_by_name(elf, ".debug_abbrev", &CTX(ctx)->debug_abbrev);
-        err += get_section_by_name(elf, ".debug_str", &CTX(ctx)->debug_str);
-        //TODO: maybe more...
-        
+        if (get_header(elf, &hdr) != ELF_OK)
+                return DWRF_UNINIT;
 
-        if(err)
-                return DWRF_SEC_MISSING;
+        CTX(ctx)->endianness = hdr.EI_Data;
+
+        for (int i = 0; i < DWRF_SEC_COUNT; i++)
+                section_init(&CTX(ctx)->sections[i]);
+
+        if ((res = discover_sections(CTX(ctx), &hdr)))
+                return res;
+
+        CTX(ctx)->image = NULL;
+        CTX(ctx)->image_size = 0;
+        CTX(ctx)->abbrev_cache = (DwrfMap){0};
+        CTX(ctx)->unit_bases = (DwrfMap){0};
+        dwrf_arena_init(&CTX(ctx)->arena);
+        CTX(ctx)->stats = (DwrfStats){0};
+        CTX(ctx)->sup = NULL;
+        CTX(ctx)->skeleton_addr_base = 0;
+        CTX(ctx)->split = CTX(ctx)->debug_info.dwo;
+        CTX(ctx)->linked = false;
 
         CTX(ctx)->initialized = true;
         return DWRF_OK;
 }
 
-void dwarf_destroy(DwrfCtx *ctx)
+DwrfResult dwarf_init(const ElfCtx *elf, DwrfCtx *ctx)
+{
+        DwrfResult res;
+
+        if ((res = dwrf_open_sections(elf, ctx)))
+                return res;
+
+        /* the other sections are optional, each feature checks the ones it needs */
+        if (!CTX(ctx)->debug_info.present || !CTX(ctx)->debug_abbrev.present || !CTX(ctx)->debug_str.present)
+        {
+                dwarf_destroy(ctx);
+                return DWRF_SEC_MISSING;
+        }
+        return DWRF_OK;
+}
+
+void dwrf_section_release(DwrfSection *sec)
+{
+        if (sec->owned)
+                free((void *)sec->data);
+
+        sec->data = NULL;
+        sec->owned = false;
+}
+
+static void release_sections(InternalDwarfCtx *ctx)
 {
- //TODO:
+        for (int i = 0; i < DWRF_SEC_COUNT; i++)
+                dwrf_section_release(&ctx->sections[i]);
 }
 
-/** Helper expression to reduce repetition */
-static inline DwrfResult validate_ctx(const DwrfCtx *ctx)
+void dwarf_destroy(DwrfCtx *ctx)
 {
         if ((ctx == NULL) || !(CTX(ctx)->initialized))
+                return;
+
+        /* the tables and bases live in the arena */
+        dwrf_map_destroy(&CTX(ctx)->abbrev_cache, NULL);
+        dwrf_map_destroy(&CTX(ctx)->unit_bases, NULL);
+        dwrf_arena_destroy(&CTX(ctx)->arena);
+
+        release_sections(CTX(ctx));
+
+        CTX(ctx)->initialized = false;
+}
+
+DwrfResult dwarf_get_stats(const DwrfCtx *ctx, DwrfStats *stats)
+{
+        if (validate_ctx(ctx))
                 return DWRF_UNINIT;
-        
+
+        if (stats == NULL)
+                return DWRF_BAD_ARG;
+
+        *stats = CTX(ctx)->stats;
         return DWRF_OK;
 }
 
-/**
- * ULEB128 encodes an unsigned integer using a variable number of bytes.
- *
- * The value is split into 7-bit groups, starting from the least significant
- * bits. Each group is stored in one byte. The most significant bit (bit 7)
- * of each byte is used as a continuation flag: it is set to 1 if another
- * byte follows, and set to 0 in the final (most significant) byte.
- *
- * Bytes are emitted in little-endian order, meaning the least significant
- * 7-bit group is stored first.
- * 
- * @param uleb128 Pointer to the start of the LEB128 encoded value.
- * @param val (out) Value of the ULEB128 represented as a u64.
- * @param len (out) Number of bytes consumed.
- * @return Error code
- */
-static DwrfResult decode_ULEB128(const uint8_t* uleb128, uint64_t *val, uint8_t *len)
+/** Inflates a compressed section to the heap, only zlib is supported and only when built with DWRF_ZLIB. */
+static DwrfResult section_inflate(InternalDwarfCtx *ctx, DwrfSection *sec)
 {
-        uint8_t byte;
-        uint8_t shift = 0;
-        uint8_t count = 0;
+#if defined(DWRF_ZLIB)
+        ElfSecHeader packed = sec->hdr;
+        const uint8_t *src;
+        uint8_t *copy = NULL, *out;
+        uLongf out_len = (uLongf)sec->hdr.Size;
 
-        if((uleb128 == NULL) || (val == NULL) || (len == NULL))
-                return DWRF_BAD_ARG;
+        if (sec->packing != DWRF_PACK_ZLIB)
+                return DWRF_UNSUPPORTED;
+        if ((sec->hdr.Size > SIZE_MAX) || (sec->hdr.Size != out_len) || (sec->packed_size > SIZE_MAX))
+                return DWRF_NO_MEM;
 
-        *val = 0;
-        do
+        packed.Size = sec->packed_size;
+        if (ctx->image != NULL)
         {
-                byte = *uleb128++;
-                uint64_t temp = (uint64_t)(byte & 0x7FU);
-                
-                count++;
+                if ((packed.Offset > ctx->image_size) || (packed.Size > ctx->image_size - packed.Offset))
+                        return DWRF_DECODE_ERR;
+                src = ctx->image + packed.Offset;
+        }
+        else
+        {
+                copy = malloc((size_t)packed.Size);
+                if (copy == NULL)
+                        return DWRF_NO_MEM;
+                if (get_section_data(ctx->elf, &packed, 0, packed.Size, copy) != ELF_OK)
+                {
+                        free(copy);
+                        return DWRF_IO_ERR;
+                }
+                src = copy;
+        }
+
+        out = malloc((sec->hdr.Size != 0) ? (size_t)sec->hdr.Size : 1);
+        if (out == NULL)
+        {
+                free(copy);
+                return DWRF_NO_MEM;
+        }
+
+        int z = uncompress(out, &out_len, src + sec->pack_header, (uLong)(packed.Size - sec->pack_header));
+        free(copy);
+        if ((z != Z_OK) || (out_len != sec->hdr.Size))
+        {
+                free(out);
+                return (z == Z_MEM_ERROR) ? DWRF_NO_MEM : DWRF_DECODE_ERR;
+        }
+
+        sec->data = out;
+        sec->owned = true;
+        return DWRF_OK;
+#else
+        (void)ctx;
+        (void)sec;
+        return DWRF_UNSUPPORTED;
+#endif
+}
+
+/** Makes the contents of the section available in memory */
+DwrfResult dwrf_load_section(InternalDwarfCtx *ctx, DwrfSection *sec)
+{
+        uint8_t *copy;
 
-                /* if the shifted value overflows */
-                if ((shift > 63) || ((temp << shift) >> shift != temp))
+        if (sec->data != NULL)
+                return DWRF_OK;
+
+        if (sec->packing != DWRF_PACK_NONE)
+                return section_inflate(ctx, sec);
+
+        if (ctx->image != NULL)
+        {
+                if ((sec->hdr.Offset > ctx->image_size) || (sec->hdr.Size > ctx->image_size - sec->hdr.Offset))
                         return DWRF_DECODE_ERR;
 
-                *val |= temp << shift;
-                shift += 7;
-        } while (byte & 0x80);
-        
-        *len = count;
+                sec->data = ctx->image + sec->hdr.Offset;
+                return DWRF_OK;
+        }
+
+        if (sec->hdr.Size > SIZE_MAX)
+                return DWRF_NO_MEM;
+
+        copy = malloc((sec->hdr.Size != 0) ? (size_t)sec->hdr.Size : 1);
+        if (copy == NULL)
+                return DWRF_NO_MEM;
+
+        if (get_section_data(ctx->elf, &sec->hdr, 0, sec->hdr.Size, copy) != ELF_OK)
+        {
+                free(copy);
+                return DWRF_IO_ERR;
+        }
+
+        sec->data = copy;
+        sec->owned = true;
+        return DWRF_OK;
+}
+
+/** Copies bytes of a section, served from memory when the section is already there. */
+DwrfResult dwrf_section_read(InternalDwarfCtx *ctx, DwrfSection *sec, uint64_t offset, uint64_t size, void *out)
+{
+        DwrfResult res;
+
+        if ((offset > sec->hdr.Size) || (size > sec->hdr.Size - offset))
+                return DWRF_DECODE_ERR;
+
+        /* compressed contents can't be read piecewise */
+        if ((sec->data == NULL) && (sec->packing != DWRF_PACK_NONE) && (res = dwrf_load_section(ctx, sec)))
+                return res;
+
+        if (sec->data != NULL)
+        {
+                memcpy(out, sec->data + offset, size);
+                return DWRF_OK;
+        }
+
+        if (ctx->image != NULL)
+        {
+                if ((sec->hdr.Offset > ctx->image_size) || (sec->hdr.Size > ctx->image_size - sec->hdr.Offset))
+                        return DWRF_DECODE_ERR;
+
+                memcpy(out, ctx->image + sec->hdr.Offset + offset, size);
+                return DWRF_OK;
+        }
+
+        if (get_section_data(ctx->elf, &sec->hdr, offset, size, out) != ELF_OK)
+                return DWRF_IO_ERR;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_set_image(DwrfCtx *ctx, const void *image, uint64_t size)
+{
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (image == NULL)
+                return DWRF_BAD_ARG;
+
+        /* heap copies are replaced by views on next use */
+        release_sections(CTX(ctx));
+
+        CTX(ctx)->image = image;
+        CTX(ctx)->image_size = size;
         return DWRF_OK;
 }
 
+/***************
+ *    Forms    *
+ ***************/
+
+/** @return Size in bytes of the form or one of the DWRF_FSZ_* classes. */
+static uint8_t form_size_class(uint16_t form)
+{
+        switch (form)
+        {
+        case DW_FORM_flag_present:
+        case DW_FORM_implicit_const:
+                return 0;
+        case DW_FORM_data1:
+        case DW_FORM_ref1:
+        case DW_FORM_flag:
+        case DW_FORM_strx1:
+        case DW_FORM_addrx1:
+                return 1;
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+        case DW_FORM_strx2:
+        case DW_FORM_addrx2:
+                return 2;
+        case DW_FORM_strx3:
+        case DW_FORM_addrx3:
+                return 3;
+        case DW_FORM_data4:
+        case DW_FORM_ref4:
+        case DW_FORM_ref_sup4:
+        case DW_FORM_strx4:
+        case DW_FORM_addrx4:
+                return 4;
+        case DW_FORM_data8:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_sig8:
+        case DW_FORM_ref_sup8:
+                return 8;
+        case DW_FORM_data16:
+                return 16;
+        case DW_FORM_addr:
+                return DWRF_FSZ_ADDR;
+        case DW_FORM_strp:
+        case DW_FORM_ref_addr:
+        case DW_FORM_sec_offset:
+        case DW_FORM_strp_sup:
+        case DW_FORM_line_strp:
+        case DW_FORM_GNU_ref_alt:
+        case DW_FORM_GNU_strp_alt:
+                return DWRF_FSZ_OFFSET;
+        case DW_FORM_block1:
+        case DW_FORM_block2:
+        case DW_FORM_block4:
+        case DW_FORM_block:
+        case DW_FORM_exprloc:
+        case DW_FORM_string:
+        case DW_FORM_sdata:
+        case DW_FORM_udata:
+        case DW_FORM_ref_udata:
+        case DW_FORM_strx:
+        case DW_FORM_addrx:
+        case DW_FORM_loclistx:
+        case DW_FORM_rnglistx:
+        case DW_FORM_indirect:
+        case DW_FORM_GNU_addr_index:
+        case DW_FORM_GNU_str_index:
+                return DWRF_FSZ_VAR;
+        default:
+                return DWRF_FSZ_BAD;
+        }
+}
+
+/***************
+ *    Abbrev   *
+ ***************/
+
+static int abbrev_cmp(const void *a, const void *b)
+{
+        uint32_t ca = ((const DwrfAbbr *)a)->code;
+        uint32_t cb = ((const DwrfAbbr *)b)->code;
+        return (ca > cb) - (ca < cb);
+}
+
+/** @return the declaration for "code" or NULL if the table does not define it. */
+static inline const DwrfAbbr *abbrev_lookup(const DwrfAbbrevTable *t, uint64_t code)
+{
+        if (t->dense)
+        {
+                if ((code > t->max_code) || (t->abbrevs[code].code == 0))
+                        return NULL;
+                return &t->abbrevs[code];
+        }
+
+        uint32_t lo = 0;
+        uint32_t hi = t->count;
+        while (lo < hi)
+        {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (t->abbrevs[mid].code < code)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        if ((lo < t->count) && (t->abbrevs[lo].code == code))
+                return &t->abbrevs[lo];
+        return NULL;
+}
+
 /**
- * SLEB128 encodes a signed integer using a variable number of bytes.
- *
- * The value is split into 7-bit groups, starting from the least significant
- * bits. Each group is stored in one byte. The most significant bit (bit 7)
- * of each byte is used as a continuation flag: it is set to 1 if another
- * byte follows, and set to 0 in the final byte.
- *
- * The sign of the result is determined from bit 6 of the final byte and
- * sign-extended if required.
- *
- * Bytes are emitted in little-endian order, meaning the least significant
- * 7-bit group is stored first.
- *
- * @param sleb128 Pointer to the start of the LEB128 encoded value.
- * @param val (out) Value of the SLEB128 represented as an i64.
- * @param len (out) Number of bytes consumed.
- * @return Error code
+ * Parses the abbreviation table at "offset" of .debug_abbrev.
+ * A first pass sizes the table so everything can be allocated at once, the second pass fills it.
  */
-static DwrfResult decode_SLEB128(const uint8_t* sleb128, int64_t *val, uint8_t *len){
-        uint8_t byte;
-        uint8_t shift = 0;
-        uint8_t count = 0;
+static DwrfResult parse_abbrev_table(InternalDwarfCtx *ctx, uint64_t offset, DwrfAbbrevTable **out)
+{
+        DwrfResult res;
+        DwrfBuf b;
+        uint64_t code, tag, name, form, children = 0;
+        int64_t implicit;
+        uint32_t count = 0;
+        uint32_t spec_count = 0;
+        uint64_t max_code = 0;
+
+        res = dwrf_load_section(ctx, &ctx->debug_abbrev);
+        if (res)
+                return res;
 
-        if((sleb128 == NULL) || (val == NULL) || (len == NULL))
+        if (offset >= ctx->debug_abbrev.hdr.Size)
                 return DWRF_BAD_ARG;
 
-        *val = 0;
-        do
+        /* Sizing pass */
+        b = buf_make(ctx, &ctx->debug_abbrev, offset, ctx->debug_abbrev.hdr.Size);
+        for (;;)
         {
-                byte = *sleb128++;
-                uint64_t temp = (uint64_t)(byte & 0x7F);
+                if ((res = buf_uleb(&b, &code)))
+                        return res;
+                if (code == 0)
+                        break;
+                if ((res = buf_uleb(&b, &tag)) || (res = buf_skip(&b, 1)))
+                        return res;
 
+                do
+                {
+                        if ((res = buf_uleb(&b, &name)) || (res = buf_uleb(&b, &form)))
+                                return res;
+                        if ((form == DW_FORM_implicit_const) && (res = buf_sleb(&b, &implicit)))
+                                return res;
+                        spec_count++;
+                } while ((name != 0) || (form != 0));
+
+                spec_count--; // terminating (0, 0) pair
                 count++;
-                
-                /* if the shifted value overflows */
-                if ((shift > 63) || ((temp << shift) >> shift != temp))
+                if (code > max_code)
+                        max_code = code;
+        }
+
+        if ((max_code > UINT32_MAX) || (spec_count > UINT32_MAX / 2))
+                return DWRF_UNSUPPORTED;
+
+        /* Codes are usually 1..N, allow some holes before giving up on direct indexing */
+        uint8_t dense = (max_code <= 2 * (uint64_t)count + 64);
+        uint64_t slots = dense ? max_code + 1 : count;
+
+        /* table, declarations and specs share one allocation of the context arena */
+        size_t size = sizeof(DwrfAbbrevTable) + slots * sizeof(DwrfAbbr) + spec_count * sizeof(DwrfAttrSpec);
+        DwrfAbbrevTable *t = dwarf_arena_alloc(&ctx->arena, size);
+        if (t == NULL)
+                return DWRF_NO_MEM;
+        memset(t, 0, size);
+
+        t->offset   = offset;
+        t->count    = count;
+        t->max_code = (uint32_t)max_code;
+        t->dense    = dense;
+        t->specs    = (DwrfAttrSpec *)(t + 1);    // most aligned member first
+        t->abbrevs  = (DwrfAbbr *)(t->specs + spec_count);
+
+        /* Filling pass, the buffer was already validated */
+        b = buf_make(ctx, &ctx->debug_abbrev, offset, ctx->debug_abbrev.hdr.Size);
+        uint32_t next = 0;
+        uint32_t spec = 0;
+        for (;;)
+        {
+                buf_uleb(&b, &code);
+                if (code == 0)
+                        break;
+                buf_uleb(&b, &tag);
+                buf_uN(&b, 1, &children);
+
+                DwrfAbbr *a = dense ? &t->abbrevs[code] : &t->abbrevs[next++];
+                if (a->code != 0)
+                {
+                        /* duplicated code */
+                        dwrf_arena_unwind(&ctx->arena, t, size);
                         return DWRF_DECODE_ERR;
+                }
 
-                *val |= temp << shift;
-                shift += 7;
-        } while (byte & 0x80);
+                a->code         = (uint32_t)code;
+                a->tag          = (uint16_t)tag;
+                a->has_children = (children == DW_CHILDREN_yes);
+                a->first_spec   = spec;
+                a->fixed        = true;
+                a->sibling      = DWRF_NO_SIBLING;
 
-        /* sign extend if sign bit of last byte is set */
-        if ((shift < 64) && (byte & 0x40))
-                *val |=  (int64_t)((~0U) << shift);
-        
-        *len = count;
+                uint32_t fixed_bytes = 0;
+                uint32_t addr_count = 0;
+                uint32_t offset_count = 0;
+                for (;;)
+                {
+                        buf_uleb(&b, &name);
+                        buf_uleb(&b, &form);
+                        if ((name == 0) && (form == 0))
+                                break;
+
+                        DwrfAttrSpec *sp = &t->specs[spec++];
+                        sp->name = (uint16_t)name;
+                        sp->form = (uint16_t)form;
+                        sp->size = (form > UINT16_MAX) ? DWRF_FSZ_BAD : form_size_class((uint16_t)form);
+                        sp->implicit_const = 0;
+                        if (form == DW_FORM_implicit_const)
+                                buf_sleb(&b, &sp->implicit_const);
+                        if ((name == DW_AT_sibling) && (spec - 1 - a->first_spec < DWRF_NO_SIBLING))
+                                a->sibling = (uint16_t)(spec - 1 - a->first_spec);
+
+                        if (sp->size == DWRF_FSZ_ADDR)
+                                addr_count++;
+                        else if (sp->size == DWRF_FSZ_OFFSET)
+                                offset_count++;
+                        else if (sp->size < DWRF_FSZ_BAD)
+                                fixed_bytes += sp->size;
+                        else
+                                a->fixed = false;
+                }
+
+                a->spec_count = (uint16_t)(spec - a->first_spec);
+                if ((spec - a->first_spec > UINT16_MAX) || (fixed_bytes > UINT16_MAX) 
+                 || (addr_count > UINT8_MAX) || (offset_count > UINT8_MAX))
+                {
+                        dwrf_arena_unwind(&ctx->arena, t, size);
+                        return DWRF_UNSUPPORTED;
+                }
+                a->fixed_bytes  = (uint16_t)fixed_bytes;
+                a->addr_count   = (uint8_t)addr_count;
+                a->offset_count = (uint8_t)offset_count;
+        }
+
+        if (!dense)
+                qsort(t->abbrevs, count, sizeof(DwrfAbbr), abbrev_cmp);
+
+        ctx->stats.AbbrevTables++;
+        ctx->stats.Abbrevs += count;
+
+        *out = t;
+        return DWRF_OK;
+}
+
+/** Returns the cached table for "offset", parsing it on the first request. */
+static DwrfResult get_abbrev_table(InternalDwarfCtx *ctx, uint64_t offset, const DwrfAbbrevTable **table)
+{
+        DwrfResult res;
+        DwrfAbbrevTable *t = dwrf_map_get(&ctx->abbrev_cache, offset);
+
+        if (t != NULL)
+        {
+                ctx->stats.AbbrevHits++;
+                *table = t;
+                return DWRF_OK;
+        }
+
+        res = parse_abbrev_table(ctx, offset, &t);
+        if (res)
+                return res;
+
+        res = dwrf_map_put(&ctx->abbrev_cache, offset, t);
+        if (res)
+                return res;     // the table stays in the arena
+
+        *table = t;
+        return DWRF_OK;
+}
+
+/***************
+ *    Units    *
+ ***************/
+
+/* Largest unit header: 64-bit DWARF 5 type unit */
+#define DWRF_MAX_UNIT_HDR 40u
+
+static DwrfResult read_unit_header(InternalDwarfCtx *ctx, uint64_t offset, DwrfUnitHeader *unit)
+{
+        DwrfResult res;
+        DwrfBuf b;
+        uint64_t length, version, val;
+        uint8_t hdr[DWRF_MAX_UNIT_HDR];
+        uint64_t sec_size = ctx->debug_info.hdr.Size;
+        uint64_t avail;
+
+        if (offset >= sec_size)
+                return DWRF_BAD_ARG;
+
+        avail = (sec_size - offset < sizeof(hdr)) ? sec_size - offset : sizeof(hdr);
+        res = dwrf_section_read(ctx, &ctx->debug_info, offset, avail, hdr);
+        if (res)
+                return res;
+
+        b = (DwrfBuf){ hdr, hdr + avail, ctx->endianness == ELFDATA2MSB };
+
+        /* unit_length, 0xffffffff escapes to the 64-bit format */
+        if ((res = buf_uN(&b, 4, &length)))
+                return res;
+
+        unit->OffsetSize = 4;
+        if (length == 0xffffffffULL)
+        {
+                unit->OffsetSize = 8;
+                if ((res = buf_uN(&b, 8, &length)))
+                        return res;
+        }
+        else if (length >= 0xfffffff0ULL)
+        {
+                return DWRF_DECODE_ERR; // reserved values
+        }
+
+        uint64_t start = offset + (uint64_t)(b.p - hdr);
+        if (length > sec_size - start)
+                return DWRF_DECODE_ERR;
+
+        unit->Offset     = offset;
+        unit->NextOffset = start + length;
+        if (length < buf_left(&b))
+                b.end = b.p + length;
+
+        if ((res = buf_uN(&b, 2, &version)))
+                return res;
+
+        unit->Version    = (uint16_t)version;
+        unit->Signature  = 0;
+        unit->TypeOffset = 0;
+
+        if (version == 5)
+        {
+                if ((res = buf_uN(&b, 1, &val)))
+                        return res;
+                unit->UnitType = (uint8_t)val;
+
+                if ((res = buf_uN(&b, 1, &val)))
+                        return res;
+                unit->AddrSize = (uint8_t)val;
+
+                if ((res = buf_uN(&b, unit->OffsetSize, &unit->AbbrevOffset)))
+                        return res;
+
+                switch (unit->UnitType)
+                {
+                case DW_UT_skeleton:
+                case DW_UT_split_compile:
+                        res = buf_uN(&b, 8, &unit->Signature);
+                        break;
+                case DW_UT_type:
+                case DW_UT_split_type:
+                        res = buf_uN(&b, 8, &unit->Signature);
+                        if (!res)
+                                res = buf_uN(&b, unit->OffsetSize, &unit->TypeOffset);
+                        break;
+                case DW_UT_compile:
+                case DW_UT_partial:
+                        break;
+                default:
+                        return DWRF_UNSUPPORTED;
+                }
+                if (res)
+                        return res;
+        }
+        else if (version == 4)
+        {
+                unit->UnitType = DW_UT_compile;
+
+                if ((res = buf_uN(&b, unit->OffsetSize, &unit->AbbrevOffset)))
+                        return res;
+
+                if ((res = buf_uN(&b, 1, &val)))
+                        return res;
+                unit->AddrSize = (uint8_t)val;
+        }
+        else
+        {
+                return DWRF_UNSUPPORTED;
+        }
+
+        if ((unit->AddrSize != 4) && (unit->AddrSize != 8) && (unit->AddrSize != 2))
+                return DWRF_UNSUPPORTED;
+
+        unit->DieOffset = offset + (uint64_t)(b.p - hdr);
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_get_unit_header(DwrfCtx *ctx, uint64_t offset, DwrfUnitHeader *unit)
+{
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (unit == NULL)
+                return DWRF_BAD_ARG;
+
+        return read_unit_header(CTX(ctx), offset, unit);
+}
+
+/***************
+ *   Cursor    *
+ ***************/
+
+#define DWRF_WINDOW_SIZE 3584u
+/* Bytes guaranteed in the window before decoding a value, enough for any fixed size or LEB128 */
+#define DWRF_WINDOW_NEED 32u
+
+#define CUR(cur) ((InternalCursor *)(cur))
+
+typedef struct
+{
+        InternalDwarfCtx *ctx;
+        DwrfUnitHeader unit;
+        const DwrfAbbrevTable *abbrevs;
+        const DwrfUnitBases *bases;     // NULL until an indexed form of the unit is resolved
+        const DwrfAbbr *abbr;   // current DIE, NULL when there is none
+        uint64_t die_off;       // offset of the current DIE
+        uint64_t attr_off;      // offset of the first attribute of the current DIE
+        uint64_t pos;           // offset of the next entry, valid when abbr is NULL
+        uint32_t depth;         // depth of the next entry
+        uint8_t in_unit;        // the unit header has been read
+        const uint8_t *win;     // maps the section offset win_off
+        uint64_t win_off;
+        uint64_t win_len;
+        uint8_t buf[DWRF_WINDOW_SIZE];
+} InternalCursor;
+
+_Static_assert(sizeof(InternalCursor) <= DWARF_CURSOR_SIZE, "DWARF_CURSOR_SIZE too small");
+
+static inline uint64_t cur_offset(const InternalCursor *c, const DwrfBuf *b)
+{
+        return c->win_off + (uint64_t)(b->p - c->win);
+}
+
+/**
+ * Gives access to at least "need" bytes at "off" (less if the unit ends before),
+ * the buffer is bounded by the end of the window or the end of the unit.
+ */
+static DwrfResult cur_window(InternalCursor *c, uint64_t off, uint64_t need, DwrfBuf *b)
+{
+        const DwrfSection *sec = &c->ctx->debug_info;
+        uint64_t end = c->unit.NextOffset;
+
+        if (off > end)
+                return DWRF_DECODE_ERR;
+
+        if (need > end - off)
+                need = end - off;
+
+        if ((off < c->win_off) || (off + need > c->win_off + c->win_len))
+        {
+                /* the whole section is mapped, nothing else to read */
+                if ((sec->data != NULL) && (c->win == sec->data))
+                        return DWRF_DECODE_ERR;
+
+                if (sec->data != NULL)
+                {
+                        /* loaded since the cursor started (e.g. to read expressions in place), switch to it */
+                        c->win = sec->data;
+                        c->win_off = 0;
+                        c->win_len = sec->hdr.Size;
+                        if (off + need > c->win_len)
+                                return DWRF_DECODE_ERR;
+                }
+                else
+                {
+                        if (sec->packing != DWRF_PACK_NONE)
+                                return DWRF_UNSUPPORTED;        // couldn't be inflated
+
+                        uint64_t size = sec->hdr.Size - off;
+                        if (size > DWRF_WINDOW_SIZE)
+                                size = DWRF_WINDOW_SIZE;
+
+                        if (get_section_data(c->ctx->elf, &sec->hdr, off, size, c->buf) != ELF_OK)
+                                return DWRF_IO_ERR;
+
+                        c->win = c->buf;
+                        c->win_off = off;
+                        c->win_len = size;
+                }
+        }
+
+        uint64_t win_end = c->win_off + c->win_len;
+        if (win_end > end)
+                win_end = end;
+
+        b->p   = c->win + (off - c->win_off);
+        b->end = c->win + (win_end - c->win_off);
+        b->big = (c->ctx->endianness == ELFDATA2MSB);
+        return DWRF_OK;
+}
+
+/** Length of the null terminated string at "off", which may span several windows. */
+static DwrfResult cur_strlen(InternalCursor *c, uint64_t off, uint64_t *len)
+{
+        DwrfResult res;
+        DwrfBuf b;
+        uint64_t start = off;
+
+        for (;;)
+        {
+                res = cur_window(c, off, DWRF_WINDOW_SIZE, &b);
+                if (res)
+                        return res;
+
+                if (b.p == b.end)
+                        return DWRF_DECODE_ERR; // unterminated
+
+                const uint8_t *nul = memchr(b.p, '\0', buf_left(&b));
+                if (nul != NULL)
+                {
+                        *len = off - start + (uint64_t)(nul - b.p);
+                        return DWRF_OK;
+                }
+                off += buf_left(&b);
+        }
+}
+
+/**
+ * Decodes the value of an attribute at "*off" and advances the offset past it.
+ * "attr" may be NULL to only skip the value.
+ */
+static DwrfResult cur_read_value(InternalCursor *c, uint16_t form, int64_t implicit, uint64_t *off, DwrfAttr *attr)
+{
+        DwrfResult res;
+        DwrfBuf b;
+        uint64_t val = 0;
+        uint64_t size = 0;
+        uint64_t end = c->unit.NextOffset;
+        uint8_t fsz = form_size_class(form);
+
+        switch (form)
+        {
+        case DW_FORM_implicit_const:
+                val = (uint64_t)implicit;
+                break;
+
+        case DW_FORM_flag_present:
+                val = 1;
+                break;
+
+        case DW_FORM_data16:
+                val = *off;
+                size = 16;
+                if (end - *off < 16)
+                        return DWRF_DECODE_ERR;
+                *off += 16;
+                break;
+
+        case DW_FORM_block1:
+        case DW_FORM_block2:
+        case DW_FORM_block4:
+        case DW_FORM_block:
+        case DW_FORM_exprloc:
+                if ((res = cur_window(c, *off, DWRF_WINDOW_NEED, &b)))
+                        return res;
+
+                if (form == DW_FORM_block1)
+                        res = buf_uN(&b, 1, &size);
+                else if (form == DW_FORM_block2)
+                        res = buf_uN(&b, 2, &size);
+                else if (form == DW_FORM_block4)
+                        res = buf_uN(&b, 4, &size);
+                else
+                        res = buf_uleb(&b, &size);
+                if (res)
+                        return res;
+
+                val = cur_offset(c, &b);
+                if (size > end - val)
+                        return DWRF_DECODE_ERR;
+                *off = val + size;
+                break;
+
+        case DW_FORM_string:
+                if ((res = cur_strlen(c, *off, &size)))
+                        return res;
+                val = *off;
+                *off += size + 1;
+                break;
+
+        case DW_FORM_sdata:
+        {
+                int64_t sval;
+                if ((res = cur_window(c, *off, DWRF_WINDOW_NEED, &b)) || (res = buf_sleb(&b, &sval)))
+                        return res;
+                val = (uint64_t)sval;
+                *off = cur_offset(c, &b);
+                break;
+        }
+
+        case DW_FORM_indirect:
+                if ((res = cur_window(c, *off, DWRF_WINDOW_NEED, &b)) || (res = buf_uleb(&b, &val)))
+                        return res;
+                /* the value of an implicit constant lives in the abbreviation, it can't be indirect */
+                if ((val == DW_FORM_indirect) || (val == DW_FORM_implicit_const) || (val > UINT16_MAX))
+                        return DWRF_DECODE_ERR;
+                *off = cur_offset(c, &b);
+                return cur_read_value(c, (uint16_t)val, 0, off, attr);
+
+        default:
+                if (fsz == DWRF_FSZ_BAD)
+                        return DWRF_UNSUPPORTED;
+
+                if ((res = cur_window(c, *off, DWRF_WINDOW_NEED, &b)))
+                        return res;
+
+                if (fsz == DWRF_FSZ_ADDR)
+                        res = buf_uN(&b, c->unit.AddrSize, &val);
+                else if (fsz == DWRF_FSZ_OFFSET)
+                        res = buf_uN(&b, c->unit.OffsetSize, &val);
+                else if (fsz == DWRF_FSZ_VAR)
+                        res = buf_uleb(&b, &val); // remaining variable forms are ULEB128
+                else
+                        res = buf_uN(&b, fsz, &val);
+                if (res)
+                        return res;
+                *off = cur_offset(c, &b);
+                break;
+        }
+
+        if (attr != NULL)
+        {
+                attr->Form  = form;
+                attr->Value = val;
+                attr->Size  = size;
+        }
+        return DWRF_OK;
+}
+
+/** Advances "*off" over every attribute of a DIE described by "a". */
+static inline DwrfResult cur_skip_attrs(InternalCursor *c, const DwrfAbbr *a, uint64_t *off)
+{
+        DwrfResult res;
+        uint64_t end = c->unit.NextOffset;
+        uint64_t pos = *off;
+
+        /* Fast path, the whole DIE is a table lookup and an add, its bytes are never touched */
+        if (a->fixed)
+        {
+                pos += a->fixed_bytes + (uint32_t)a->addr_count * c->unit.AddrSize + (uint32_t)a->offset_count * c->unit.OffsetSize;
+        }
+        else
+        {
+                const DwrfAttrSpec *sp = &c->abbrevs->specs[a->first_spec];
+                for (uint16_t i = 0; i < a->spec_count; i++, sp++)
+                {
+                        if (sp->size < DWRF_FSZ_BAD)
+                                pos += sp->size;
+                        else if (sp->size == DWRF_FSZ_ADDR)
+                                pos += c->unit.AddrSize;
+                        else if (sp->size == DWRF_FSZ_OFFSET)
+                                pos += c->unit.OffsetSize;
+                        else if ((res = cur_read_value(c, sp->form, 0, &pos, NULL)))
+                                return res;
+                }
+        }
+
+        if (pos > end)
+                return DWRF_DECODE_ERR;
+
+        *off = pos;
+        return DWRF_OK;
+}
+
+/** Reads the abbreviation code at "off", "*next" receives the offset after it. */
+static inline DwrfResult cur_read_code(InternalCursor *c, uint64_t off, uint64_t *code, uint64_t *next)
+{
+        DwrfResult res;
+        DwrfBuf b;
+
+        if ((res = cur_window(c, off, DWRF_WINDOW_NEED, &b)))
+                return res;
+
+        /* single byte codes are by far the most common */
+        if ((b.p < b.end) && !(*b.p & 0x80))
+        {
+                *code = *b.p;
+                *next = off + 1;
+                return DWRF_OK;
+        }
+
+        if ((res = buf_uleb(&b, code)))
+                return res;
+
+        *next = cur_offset(c, &b);
+        return DWRF_OK;
+}
+
+static DwrfResult cur_enter_unit(InternalCursor *c, uint64_t offset)
+{
+        DwrfResult res;
+
+        c->in_unit = false;
+        c->abbr = NULL;
+        c->bases = NULL;
+
+        if ((res = read_unit_header(c->ctx, offset, &c->unit)))
+                return res;
+
+        if ((res = get_abbrev_table(c->ctx, c->unit.AbbrevOffset, &c->abbrevs)))
+                return res;
+
+        c->pos = c->unit.DieOffset;
+        c->depth = 0;
+        c->in_unit = true;
+        return DWRF_OK;
+}
+
+/** Moves to the next DIE of the current unit, DWRF_END once the unit is exhausted. */
+static DwrfResult cur_step(InternalCursor *c)
+{
+        DwrfResult res;
+        uint64_t code, next;
+
+        if (c->abbr != NULL)
+        {
+                uint64_t off = c->attr_off;
+                if ((res = cur_skip_attrs(c, c->abbr, &off)))
+                        return res;
+
+                if (c->abbr->has_children)
+                        c->depth++;
+
+                c->pos = off;
+                c->abbr = NULL;
+        }
+
+        while (c->pos < c->unit.NextOffset)
+        {
+                if ((res = cur_read_code(c, c->pos, &code, &next)))
+                        return res;
+
+                /* null entry, closes a list of siblings */
+                if (code == 0)
+                {
+                        if (c->depth > 0)
+                                c->depth--;
+                        c->pos = next;
+                        continue;
+                }
+
+                const DwrfAbbr *a = abbrev_lookup(c->abbrevs, code);
+                if (a == NULL)
+                        return DWRF_DECODE_ERR;
+
+                c->abbr = a;
+                c->die_off = c->pos;
+                c->attr_off = next;
+                return DWRF_OK;
+        }
+
+        return DWRF_END;
+}
+
+static void cur_reset(InternalCursor *c, InternalDwarfCtx *ctx)
+{
+        c->ctx = ctx;
+        c->abbrevs = NULL;
+        c->bases = NULL;
+        c->abbr = NULL;
+        c->pos = 0;
+        c->depth = 0;
+        c->in_unit = false;
+        c->unit = (DwrfUnitHeader){0};
+
+        /* sections in memory are used in place, the window is the whole section */
+        if ((ctx->debug_info.data == NULL) && ((ctx->image != NULL) || (ctx->debug_info.packing != DWRF_PACK_NONE)))
+                dwrf_load_section(ctx, &ctx->debug_info);
+
+        if (ctx->debug_info.data != NULL)
+        {
+                c->win = ctx->debug_info.data;
+                c->win_off = 0;
+                c->win_len = ctx->debug_info.hdr.Size;
+        }
+        else
+        {
+                c->win = c->buf;
+                c->win_off = 0;
+                c->win_len = 0;
+        }
+}
+
+DwrfResult dwarf_cursor_init(DwrfCtx *ctx, DwrfCursor *cur)
+{
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if (cur == NULL)
+                return DWRF_BAD_ARG;
+
+        cur_reset(CUR(cur), CTX(ctx));
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_cursor_seek_unit(DwrfCursor *cur, uint64_t unit_offset)
+{
+        if ((cur == NULL) || (validate_ctx((DwrfCtx *)CUR(cur)->ctx)))
+                return DWRF_UNINIT;
+
+        return cur_enter_unit(CUR(cur), unit_offset);
+}
+
+DwrfResult dwarf_cursor_seek_die(DwrfCursor *cur, uint64_t die_offset, DwrfDie *die)
+{
+        DwrfResult res;
+        DwrfUnitHeader unit;
+        InternalCursor *c = CUR(cur);
+
+        if ((cur == NULL) || (validate_ctx((DwrfCtx *)c->ctx)))
+                return DWRF_UNINIT;
+
+        /* outside the current unit the owner is found from the start of the section */
+        if (!c->in_unit || (die_offset < c->unit.DieOffset) || (die_offset >= c->unit.NextOffset))
+        {
+                uint64_t off = 0;
+
+                for (;;)
+                {
+                        if ((res = read_unit_header(c->ctx, off, &unit)))
+                                return res;
+                        if (die_offset < unit.NextOffset)
+                                break;
+                        off = unit.NextOffset;
+                }
+
+                if ((res = cur_enter_unit(c, unit.Offset)))
+                        return res;
+                if (die_offset < c->unit.DieOffset)
+                        return DWRF_BAD_ARG;
+        }
+
+        c->abbr = NULL;
+        c->pos = die_offset;
+        c->depth = 0;
+
+        res = cur_step(c);
+        if ((res == DWRF_OK) && (c->die_off != die_offset))
+                res = DWRF_BAD_ARG;     // null entry, not a DIE
+        if (res)
+        {
+                c->abbr = NULL;
+                return (res == DWRF_END) ? DWRF_BAD_ARG : res;
+        }
+
+        if (die != NULL)
+        {
+                die->Offset      = c->die_off;
+                die->UnitOffset  = c->unit.Offset;
+                die->Depth       = 0;
+                die->Tag         = c->abbr->tag;
+                die->HasChildren = c->abbr->has_children;
+        }
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_cursor_next(DwrfCursor *cur, DwrfDie *die)
+{
+        DwrfResult res;
+        InternalCursor *c = CUR(cur);
+
+        if ((cur == NULL) || (validate_ctx((DwrfCtx *)c->ctx)))
+                return DWRF_UNINIT;
+
+        if (!c->in_unit)
+        {
+                if (c->pos >= c->ctx->debug_info.hdr.Size)
+                        return DWRF_END;
+                if ((res = cur_enter_unit(c, c->pos)))
+                        return res;
+        }
+
+        while ((res = cur_step(c)) == DWRF_END)
+        {
+                uint64_t next = c->unit.NextOffset;
+                if (next >= c->ctx->debug_info.hdr.Size)
+                        return DWRF_END;
+
+                if ((res = cur_enter_unit(c, next)))
+                        return res;
+        }
+        if (res)
+                return res;
+
+        if (die != NULL)
+        {
+                die->Offset      = c->die_off;
+                die->UnitOffset  = c->unit.Offset;
+                die->Depth       = c->depth;
+                die->Tag         = c->abbr->tag;
+                die->HasChildren = c->abbr->has_children;
+        }
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_cursor_skip_children(DwrfCursor *cur)
+{
+        DwrfResult res;
+        InternalCursor *c = CUR(cur);
+        uint64_t off, code, next;
+        uint64_t level = 1;
+        uint64_t skipped = 0;
+
+        if ((cur == NULL) || (validate_ctx((DwrfCtx *)c->ctx)))
+                return DWRF_UNINIT;
+
+        if (c->abbr == NULL)
+                return DWRF_BAD_ARG;
+
+        if (!c->abbr->has_children)
+                return DWRF_OK;
+
+        /* DW_AT_sibling lets us jump over the subtree */
+        if (c->abbr->sibling != DWRF_NO_SIBLING)
+        {
+                DwrfAttr sib;
+                const DwrfAttrSpec *sp = &c->abbrevs->specs[c->abbr->first_spec];
+
+                off = c->attr_off;
+                for (uint16_t i = 0; i < c->abbr->sibling; i++)
+                {
+                        if ((res = cur_read_value(c, sp[i].form, sp[i].implicit_const, &off, NULL)))
+                                return res;
+                }
+                if ((res = cur_read_value(c, sp[c->abbr->sibling].form, 0, &off, &sib)))
+                        return res;
+
+                uint64_t target = sib.Value;
+                if (sib.Form != DW_FORM_ref_addr)
+                        target += c->unit.Offset; // unit relative references
+
+                if ((target > c->die_off) && (target <= c->unit.NextOffset))
+                {
+                        c->pos = target;
+                        c->abbr = NULL;
+                        return DWRF_OK;
+                }
+                /* bogus sibling, fall back to walking the subtree */
+        }
+
+        off = c->attr_off;
+        if ((res = cur_skip_attrs(c, c->abbr, &off)))
+                return res;
+
+        while (level > 0)
+        {
+                if (off >= c->unit.NextOffset)
+                        return DWRF_DECODE_ERR;
+
+                if ((res = cur_read_code(c, off, &code, &next)))
+                        return res;
+                off = next;
+
+                if (code == 0)
+                {
+                        level--;
+                        continue;
+                }
+
+                const DwrfAbbr *a = abbrev_lookup(c->abbrevs, code);
+                if (a == NULL)
+                        return DWRF_DECODE_ERR;
+
+                if ((res = cur_skip_attrs(c, a, &off)))
+                        return res;
+
+                level += a->has_children;
+                skipped++;
+        }
+
+        c->ctx->stats.DiesSkipped += skipped;
+        c->pos = off;
+        c->abbr = NULL;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_cursor_unit(const DwrfCursor *cur, DwrfUnitHeader *unit)
+{
+        if ((cur == NULL) || (validate_ctx((const DwrfCtx *)CUR(cur)->ctx)))
+                return DWRF_UNINIT;
+
+        if ((unit == NULL) || !(CUR(cur)->in_unit))
+                return DWRF_BAD_ARG;
+
+        *unit = CUR(cur)->unit;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_cursor_get_attrs(DwrfCursor *cur, const uint16_t *names, uint32_t count, DwrfAttr *attrs)
+{
+        DwrfResult res;
+        InternalCursor *c = CUR(cur);
+        uint32_t found = 0;
+
+        if ((cur == NULL) || (validate_ctx((DwrfCtx *)c->ctx)))
+                return DWRF_UNINIT;
+
+        if ((c->abbr == NULL) || (names == NULL) || (attrs == NULL))
+                return DWRF_BAD_ARG;
+
+        for (uint32_t j = 0; j < count; j++)
+                attrs[j] = (DwrfAttr){ .Name = names[j] };
+
+        uint64_t off = c->attr_off;
+        const DwrfAttrSpec *sp = &c->abbrevs->specs[c->abbr->first_spec];
+        for (uint16_t i = 0; (i < c->abbr->spec_count) && (found < count); i++, sp++)
+        {
+                DwrfAttr *dst = NULL;
+                for (uint32_t j = 0; j < count; j++)
+                {
+                        if ((names[j] == sp->name) && (attrs[j].Form == 0))
+                        {
+                                dst = &attrs[j];
+                                break;
+                        }
+                }
+
+                /* attributes that aren't requested are skipped without decoding when possible */
+                if ((dst == NULL) && (sp->size < DWRF_FSZ_BAD))
+                {
+                        off += sp->size;
+                        continue;
+                }
+
+                if ((res = cur_read_value(c, sp->form, sp->implicit_const, &off, dst)))
+                        return res;
+                found += (dst != NULL);
+        }
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_cursor_get_attr(DwrfCursor *cur, uint16_t name, DwrfAttr *attr)
+{
+        DwrfResult res = dwarf_cursor_get_attrs(cur, &name, 1, attr);
+        if (res)
+                return res;
+
+        return (attr->Form != 0) ? DWRF_OK : DWRF_NOT_FOUND;
+}
+
+DwrfResult dwarf_cursor_resolve(DwrfCursor *cur, DwrfAttr *attr)
+{
+        DwrfResult res;
+        InternalCursor *c = CUR(cur);
+        uint16_t form;
+
+        if ((cur == NULL) || (validate_ctx((DwrfCtx *)c->ctx)))
+                return DWRF_UNINIT;
+
+        if ((attr == NULL) || !(c->in_unit))
+                return DWRF_BAD_ARG;
+
+        switch (attr->Form)
+        {
+        case DW_FORM_strx:
+        case DW_FORM_strx1:
+        case DW_FORM_strx2:
+        case DW_FORM_strx3:
+        case DW_FORM_strx4:
+        case DW_FORM_GNU_str_index:
+                form = DW_FORM_strp;
+                break;
+        case DW_FORM_addrx:
+        case DW_FORM_addrx1:
+        case DW_FORM_addrx2:
+        case DW_FORM_addrx3:
+        case DW_FORM_addrx4:
+        case DW_FORM_GNU_addr_index:
+                form = DW_FORM_addr;
+                break;
+        case DW_FORM_rnglistx:
+        case DW_FORM_loclistx:
+                form = DW_FORM_sec_offset;
+                break;
+        default:
+                return DWRF_OK; // not an index
+        }
+
+        if ((c->bases == NULL) && (res = dwrf_unit_bases(c->ctx, &c->unit, &c->bases)))
+                return res;
+
+        if (form == DW_FORM_strp)
+                res = dwrf_read_strx(c->ctx, c->bases, attr->Value, &attr->Value);
+        else if (form == DW_FORM_addr)
+                res = dwrf_read_addrx(c->ctx, c->bases, attr->Value, &attr->Value);
+        else if (attr->Form == DW_FORM_rnglistx)
+                res = dwrf_rnglistx_offset(c->ctx, c->bases, attr->Value, &attr->Value);
+        else
+                res = dwrf_loclistx_offset(c->ctx, c->bases, attr->Value, &attr->Value);
+        if (res)
+                return res;
+
+        attr->Form = form;
+        return DWRF_OK;
+}
+
+DwrfResult dwrf_cursor_bases(DwrfCursor *cur, InternalDwarfCtx **ctx, const DwrfUnitBases **bases)
+{
+        InternalCursor *c = CUR(cur);
+        DwrfResult res;
+
+        if ((cur == NULL) || (validate_ctx((DwrfCtx *)c->ctx)))
+                return DWRF_UNINIT;
+
+        if (!(c->in_unit))
+                return DWRF_BAD_ARG;
+
+        if ((c->bases == NULL) && (res = dwrf_unit_bases(c->ctx, &c->unit, &c->bases)))
+                return res;
+
+        *ctx = c->ctx;
+        *bases = c->bases;
+        return DWRF_OK;
+}
+
+DwrfResult dwarf_unit_count_dies(DwrfCtx *ctx, const DwrfUnitHeader *unit, uint64_t *count)
+{
+        DwrfResult res;
+        InternalCursor c;
+        uint64_t n = 0;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if ((unit == NULL) || (count == NULL))
+                return DWRF_BAD_ARG;
+
+        /* The cursor's window lives on the stack, nothing is allocated */
+        cur_reset(&c, CTX(ctx));
+        if ((res = cur_enter_unit(&c, unit->Offset)))
+                return res;
+
+        while ((res = cur_step(&c)) == DWRF_OK)
+                n++;
+
+        if (res != DWRF_END)
+                return res;
+
+        CTX(ctx)->stats.DiesSkipped += n;
+        *count = n;
+        return DWRF_OK;
+}
+
+/***************
+ *   Strings   *
+ ***************/
+
+DwrfResult dwarf_get_string(DwrfCtx *ctx, const DwrfAttr *attr, uint8_t *buff, uint16_t len)
+{
+        InternalDwarfCtx *owner;
+        DwrfResult res;
+        DwrfSection *sec;
+        uint64_t avail;
+
+        if (validate_ctx(ctx))
+                return DWRF_UNINIT;
+
+        if ((attr == NULL) || (buff == NULL) || (len == 0))
+                return DWRF_BAD_ARG;
+
+        owner = CTX(ctx);
+        switch (attr->Form)
+        {
+        case DW_FORM_string:
+                sec = &owner->debug_info;
+                break;
+        case DW_FORM_strp:
+                sec = &owner->debug_str;
+                break;
+        case DW_FORM_line_strp:
+                sec = &owner->debug_line_str;
+                break;
+        case DW_FORM_strp_sup:
+        case DW_FORM_GNU_strp_alt:
+                /* the string is in the supplementary file, read through its own context */
+                if (owner->sup == NULL)
+                        return DWRF_SEC_MISSING;
+                owner = CTX(owner->sup);
+                sec = &owner->debug_str;
+                break;
+        default:
+                return DWRF_BAD_ARG;
+        }
+
+        if (attr->Value >= sec->hdr.Size)
+                return DWRF_DECODE_ERR;
+
+        /* read at most len bytes, the terminator must be among them */
+        avail = sec->hdr.Size - attr->Value;
+        if (avail > len)
+                avail = len;
+
+        res = dwrf_section_read(owner, sec, attr->Value, avail, buff);
+        if (res)
+                return res;
+
+        if (memchr(buff, '\0', (size_t)avail) == NULL)
+        {
+                buff[len - 1] = '\0';
+                return (avail == len) ? DWRF_BUFFER_OVERFLOW : DWRF_DECODE_ERR;
+        }
         return DWRF_OK;
 }
@@ -23,11 +23,18 @@
 #ifndef DWARF_LIB
 #define DWARF_LIB
  
+#include <stddef.h>
 #include "common/elf_core.h"
  
 /** NOTE: This library supports DWARF version 5 based on ELF files */
 
-#define DWARF_CTX_SIZE 256u
+/**
+ * NOTE: Compressed debug sections (SHF_COMPRESSED or .zdebug_*) are inflated with zlib when
+ * the module is built with DWRF_ZLIB defined (link with -lz), otherwise reading them fails
+ * with DWRF_UNSUPPORTED.
+ */
+
+#define DWARF_CTX_SIZE 2048u
 
 /**
  * @brief Opaque DWARF library context.
@@ -52,6 +59,12 @@ typedef enum DwrfResult{
         DWRF_BAD_ARG,
         DWRF_SEC_MISSING,
         DWRF_DECODE_ERR,
+        DWRF_UNSUPPORTED,       // valid DWARF this implementation does not handle (e.g. old versions)
+        DWRF_IO_ERR,            // the underlying ELF reader failed
+        DWRF_NO_MEM,
+        DWRF_NOT_FOUND,
+        DWRF_BUFFER_OVERFLOW,
+        DWRF_END,               // iteration finished, not an error
 }DwrfResult;
 
 /**
@@ -62,6 +75,1554 @@ typedef enum DwrfResult{
  */
 DwrfResult dwarf_init(const ElfCtx *elf, DwrfCtx *ctx);
 
+/**
+ * @brief Release every resource owned by the context (cached sections, abbreviation tables...).
+ * @param ctx DWARF context, passing an uninitialized context or NULL has no effect.
+ */
 void dwarf_destroy(DwrfCtx *ctx);
 
+/**
+ * @param ctx DWARF context, initialized with dwarf_init().
+ * @param image Pointer to the whole ELF file in memory (e.g. mmap'ed), must outlive the context.
+ * @param size Size of the image in bytes.
+ * @return Error code
+ * @brief Lets the library access section data in place instead of going through the read callback.
+ *
+ * Optional, when set sections are never copied and cursors read .debug_info directly.
+ * Must be called before creating cursors.
+ */
+DwrfResult dwarf_set_image(DwrfCtx *ctx, const void *image, uint64_t size);
+
+/***************
+ *    Units    *
+ ***************/
+        /**
+         * @brief Abstract view of a unit header in .debug_info, normalizes the 32/64-bit formats
+         * and the different layouts of DWARF 4 and 5.
+         */
+        typedef struct
+        {
+                uint64_t Offset;        // Offset of the unit header in .debug_info
+                uint64_t NextOffset;    // Offset of the following unit header
+                uint64_t DieOffset;     // Offset of the first DIE of the unit
+                uint64_t AbbrevOffset;  // Offset of the unit's abbreviation table in .debug_abbrev
+                uint64_t Signature;     // dwo_id or type signature, 0 if the unit type has none
+                uint64_t TypeOffset;    // Type units only, offset of the type DIE relative to the unit
+                uint16_t Version;
+                uint8_t  UnitType;      // DW_UT_*, DWARF 4 compile units are reported as DW_UT_compile
+                uint8_t  AddrSize;
+                uint8_t  OffsetSize;    // 4 for 32-bit DWARF, 8 for 64-bit DWARF
+        } DwrfUnitHeader;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param offset Offset of the unit header in .debug_info (0 for the first unit, NextOffset for the rest).
+         * @param unit (out) User allocated struct to be filled.
+         * @return Error code, DWRF_BAD_ARG if offset is at or past the end of the section.
+         */
+        DwrfResult dwarf_get_unit_header(DwrfCtx *ctx, uint64_t offset, DwrfUnitHeader *unit);
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param unit Unit header obtained with dwarf_get_unit_header().
+         * @param count (out) Number of DIEs in the unit, null entries are not counted.
+         * @return Error code
+         * @brief Walks every DIE of the unit without decoding any attribute.
+         */
+        DwrfResult dwarf_unit_count_dies(DwrfCtx *ctx, const DwrfUnitHeader *unit, uint64_t *count);
+
+/***************
+ *     DIEs    *
+ ***************/
+        #define DWARF_CURSOR_SIZE 4096u
+
+        /**
+         * @brief Streaming DIE iterator over .debug_info.
+         *
+         * Walks units and DIEs in file order without allocating. When the context has no
+         * image (see dwarf_set_image()) the data is read through a small window buffer
+         * stored in the cursor itself, so the section is never loaded as a whole.
+         * Attributes are only decoded when requested with dwarf_cursor_get_attr().
+         */
+        typedef struct
+        {
+                uint8_t _storage[DWARF_CURSOR_SIZE];
+        } DwrfCursor;
+
+        typedef struct
+        {
+                uint64_t Offset;        // Offset of the DIE in .debug_info
+                uint64_t UnitOffset;    // Offset of the header of the unit that owns the DIE
+                uint32_t Depth;         // Nesting level, 0 for the unit DIE
+                uint16_t Tag;           // DW_TAG_*
+                uint8_t  HasChildren;
+        } DwrfDie;
+
+        typedef struct
+        {
+                uint16_t Name;          // DW_AT_*
+                uint16_t Form;          // DW_FORM_*, DW_FORM_indirect is resolved to the actual form
+                uint64_t Value;         // Constants, flags, addresses, indexes, section offsets and references
+                                        // (unit relative for ref1..ref_udata). sdata and implicit_const are two's complement.
+                uint64_t Size;          // Blocks, exprloc, data16 and inline strings: Value is the offset of
+                                        // the bytes in .debug_info and Size their length.
+        } DwrfAttr;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param cur (out) User allocated cursor, positioned before the first DIE of the section.
+         * @return Error code
+         * @note The context must outlive the cursor.
+         */
+        DwrfResult dwarf_cursor_init(DwrfCtx *ctx, DwrfCursor *cur);
+
+        /**
+         * @param cur Initialized cursor.
+         * @param unit_offset Offset of a unit header in .debug_info.
+         * @return Error code
+         * @brief Positions the cursor before the first DIE of the unit.
+         */
+        DwrfResult dwarf_cursor_seek_unit(DwrfCursor *cur, uint64_t unit_offset);
+
+        /**
+         * @param cur Initialized cursor.
+         * @param die_offset Offset of a DIE in .debug_info, e.g. the target of a reference attribute.
+         * @param die (out) User allocated struct to be filled, may be NULL.
+         * @return Error code, DWRF_BAD_ARG if no DIE starts at the offset.
+         * @brief Positions the cursor on the DIE so its attributes can be read.
+         *
+         * The DIE is reported at depth 0, the ones dwarf_cursor_next() returns after it are counted from there.
+         * Seeking within the current unit is constant time, other units are found by walking the unit headers
+         * from the start of the section so prefer dwarf_cursor_seek_unit() first when the unit is known.
+         */
+        DwrfResult dwarf_cursor_seek_die(DwrfCursor *cur, uint64_t die_offset, DwrfDie *die);
+
+        /**
+         * @param cur Initialized cursor.
+         * @param die (out) User allocated struct to be filled, may be NULL.
+         * @return DWRF_OK, DWRF_END after the last DIE of the section, or an error code.
+         * @brief Advances to the next DIE in file order (children before siblings), crossing unit boundaries.
+         */
+        DwrfResult dwarf_cursor_next(DwrfCursor *cur, DwrfDie *die);
+
+        /**
+         * @param cur Cursor positioned on a DIE.
+         * @return Error code
+         * @brief Makes the next call to dwarf_cursor_next() return the sibling of the current DIE.
+         *
+         * Uses DW_AT_sibling when present, otherwise the subtree is walked without decoding attributes.
+         */
+        DwrfResult dwarf_cursor_skip_children(DwrfCursor *cur);
+
+        /**
+         * @param cur Initialized cursor.
+         * @param unit (out) Header of the unit the cursor is in.
+         * @return Error code, DWRF_BAD_ARG if the cursor hasn't entered a unit yet.
+         */
+        DwrfResult dwarf_cursor_unit(const DwrfCursor *cur, DwrfUnitHeader *unit);
+
+        /**
+         * @param cur Cursor positioned on a DIE.
+         * @param name Attribute to look up (DW_AT_*).
+         * @param attr (out) User allocated struct to be filled.
+         * @return Error code, DWRF_NOT_FOUND if the DIE does not have the attribute.
+         */
+        DwrfResult dwarf_cursor_get_attr(DwrfCursor *cur, uint16_t name, DwrfAttr *attr);
+
+        /**
+         * @param cur Cursor positioned on a DIE.
+         * @param names Attributes to look up (DW_AT_*).
+         * @param count Number of entries in "names" and "attrs".
+         * @param attrs (out) attrs[i] receives names[i], missing attributes have a Form of 0.
+         * @return Error code
+         * @brief Decodes several attributes in a single pass over the DIE.
+         */
+        DwrfResult dwarf_cursor_get_attrs(DwrfCursor *cur, const uint16_t *names, uint32_t count, DwrfAttr *attrs);
+
+        /**
+         * @param cur Cursor in the unit the attribute was read from.
+         * @param attr Attribute to resolve, updated in place.
+         * @return Error code
+         * @brief Replaces an indexed form by the value it refers to.
+         *
+         * strx forms become DW_FORM_strp, addrx forms DW_FORM_addr and rnglistx/loclistx
+         * DW_FORM_sec_offset. Other forms are left untouched. The bases the indexes are relative
+         * to are read from the unit DIE once and cached in the context.
+         */
+        DwrfResult dwarf_cursor_resolve(DwrfCursor *cur, DwrfAttr *attr);
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param attr String attribute (DW_FORM_string, DW_FORM_strp or DW_FORM_line_strp),
+         *             strx forms must go through dwarf_cursor_resolve() first. DW_FORM_strp_sup
+         *             strings are read from the supplementary file, see dwarf_set_supplementary().
+         * @param buff (out) Character buffer to return the string.
+         * @param len lenght of "buff".
+         * @return Error code
+         */
+        DwrfResult dwarf_get_string(DwrfCtx *ctx, const DwrfAttr *attr, uint8_t *buff, uint16_t len);
+
+/***************
+ * Line tables *
+ ***************/
+        /* Flags of a line table row */
+        #define DWRF_LINE_IS_STMT        0x01u
+        #define DWRF_LINE_BASIC_BLOCK    0x02u
+        #define DWRF_LINE_END_SEQUENCE   0x04u  // first address after the sequence, not an instruction
+        #define DWRF_LINE_PROLOGUE_END   0x08u
+        #define DWRF_LINE_EPILOGUE_BEGIN 0x10u
+
+        #define DWRF_LINE_NO_FILE 0xFFFFFFFFu
+
+        /**
+         * @brief One row of the line number matrix, it covers the addresses from its own up to the next row.
+         */
+        typedef struct
+        {
+                uint64_t Address;
+                uint32_t File;          // Index for dwarf_line_get_file(), DWRF_LINE_NO_FILE if the program used an invalid one
+                uint32_t Line;          // 0 when the instructions have no source line
+                uint16_t Column;        // 0 for unknown, saturated at 0xFFFF
+                uint8_t  Flags;         // DWRF_LINE_*
+        } DwrfLineRow;
+
+        typedef struct
+        {
+                const char *Name;       // Path as written in the line program header
+                const char *Dir;        // Include directory, joined with the compilation directory if relative. May be NULL
+                uint64_t Mtime;         // 0 if unknown
+                uint64_t Size;          // 0 if unknown
+                uint8_t  Md5[16];
+                uint8_t  HasMd5;
+        } DwrfLineFile;
+
+        /**
+         * @brief Decoded line programs of one or more units.
+         *
+         * Rows are grouped by sequence and the sequences sorted by address, so address lookups are two
+         * binary searches. File indexes are global to the table. The table owns copies of every string
+         * and stays valid after the context is destroyed.
+         */
+        typedef struct DwrfLineTable DwrfLineTable;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param unit Unit header obtained with dwarf_get_unit_header().
+         * @param table (out) Line table of the unit, release with dwarf_line_table_destroy().
+         * @return Error code, DWRF_NOT_FOUND if the unit has no DW_AT_stmt_list, DWRF_SEC_MISSING without .debug_line.
+         */
+        DwrfResult dwarf_line_table_unit(DwrfCtx *ctx, const DwrfUnitHeader *unit, DwrfLineTable **table);
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param threads Number of threads decoding line programs, 0 for one per online CPU.
+         * @param table (out) Line table of every compile unit, release with dwarf_line_table_destroy().
+         * @return Error code, DWRF_SEC_MISSING without .debug_line.
+         * @brief Decodes the line programs of the whole file. The result doesn't depend on the thread count.
+         */
+        DwrfResult dwarf_line_table_all(DwrfCtx *ctx, uint32_t threads, DwrfLineTable **table);
+
+        /**
+         * @param table Table to release, NULL has no effect.
+         */
+        void dwarf_line_table_destroy(DwrfLineTable *table);
+
+        /**
+         * @param table Line table.
+         * @param addr Address to look up.
+         * @param row (out) Row whose address range contains addr, points into the table.
+         * @return Error code, DWRF_NOT_FOUND if no sequence covers the address.
+         */
+        DwrfResult dwarf_line_lookup(const DwrfLineTable *table, uint64_t addr, const DwrfLineRow **row);
+
+        /**
+         * @param table Line table.
+         * @param rows (out) Every row of the table, sequence after sequence in address order.
+         * @param count (out) Number of rows.
+         * @return Error code
+         */
+        DwrfResult dwarf_line_rows(const DwrfLineTable *table, const DwrfLineRow **rows, uint64_t *count);
+
+        /**
+         * @param table Line table.
+         * @param file File index of a row.
+         * @param out (out) User allocated struct to be filled, the strings point into the table.
+         * @return Error code, DWRF_BAD_ARG if the index is out of range.
+         */
+        DwrfResult dwarf_line_get_file(const DwrfLineTable *table, uint32_t file, DwrfLineFile *out);
+
+        /**
+         * @param table Line table.
+         * @param file File index of a row.
+         * @param buff (out) Character buffer to return the path, the directory and the name joined.
+         * @param len lenght of "buff".
+         * @return Error code
+         */
+        DwrfResult dwarf_line_file_path(const DwrfLineTable *table, uint32_t file, char *buff, uint16_t len);
+
+/***************
+ *    Lists    *
+ ***************/
+        /**
+         * @brief Addresses [Low, High) of a range list.
+         */
+        typedef struct
+        {
+                uint64_t Low;
+                uint64_t High;
+        } DwrfRange;
+
+        /**
+         * @brief Entry of a location list, the location description that holds for [Low, High).
+         */
+        typedef struct
+        {
+                uint64_t Low;
+                uint64_t High;
+                const uint8_t *Expr;    // DWARF expression of the location, points into the section
+                uint64_t ExprLen;
+                uint8_t  Default;       // DW_LLE_default_location, holds wherever no other entry does (Low 0, High UINT64_MAX)
+        } DwrfLocation;
+
+        /**
+         * @brief Range and location lists decoded on first use and kept by offset, the same list is
+         * usually referenced by many DIEs. Not thread safe, use one cache per thread.
+         */
+        typedef struct DwrfListCache DwrfListCache;
+
+        typedef struct
+        {
+                uint64_t Hits;
+                uint64_t Misses;        // Lists decoded
+                uint64_t Bytes;         // Memory held by the decoded lists
+        } DwrfListCacheStats;
+
+        /**
+         * @param cache (out) Empty cache, release with dwarf_list_cache_destroy().
+         * @return Error code
+         */
+        DwrfResult dwarf_list_cache_create(DwrfListCache **cache);
+
+        /**
+         * @param cache Cache to release along with every list it returned, NULL has no effect.
+         */
+        void dwarf_list_cache_destroy(DwrfListCache *cache);
+
+        /**
+         * @param cache List cache.
+         * @param cur Cursor in the unit the attribute was read from.
+         * @param attr DW_AT_ranges attribute (DW_FORM_sec_offset or DW_FORM_rnglistx).
+         * @param ranges (out) Ranges sorted by address, overlapping and adjacent ones merged. Point into the cache.
+         * @param count (out) Number of ranges, may be 0.
+         * @return Error code, DWRF_BAD_ARG if the attribute is not a range list.
+         * @brief Decodes every kind of entry of .debug_rnglists (DWARF 5) and .debug_ranges (older units),
+         * base address entries included.
+         */
+        DwrfResult dwarf_list_ranges(DwrfListCache *cache, DwrfCursor *cur, const DwrfAttr *attr, const DwrfRange **ranges,
+                                     uint64_t *count);
+
+        /**
+         * @param cache List cache.
+         * @param cur Cursor in the unit the attribute was read from.
+         * @param attr Location list attribute (DW_FORM_sec_offset or DW_FORM_loclistx), e.g. DW_AT_location.
+         * @param locs (out) Entries sorted by address, the default location last. Point into the cache.
+         * @param count (out) Number of entries, may be 0.
+         * @return Error code, DWRF_BAD_ARG if the attribute is not a location list (DW_FORM_exprloc is a
+         * single location description, not a list).
+         * @brief Decodes every kind of entry of .debug_loclists (DWARF 5) and .debug_loc (older units).
+         */
+        DwrfResult dwarf_list_locations(DwrfListCache *cache, DwrfCursor *cur, const DwrfAttr *attr,
+                                        const DwrfLocation **locs, uint64_t *count);
+
+        /**
+         * @param cache List cache.
+         * @param stats (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_list_cache_stats(const DwrfListCache *cache, DwrfListCacheStats *stats);
+
+/***************
+ * Addr index  *
+ ***************/
+        /**
+         * @brief Address range [Low, High) covered by the code of a unit.
+         */
+        typedef struct
+        {
+                uint64_t Low;
+                uint64_t High;
+                uint64_t UnitOffset;    // Offset of the unit header in .debug_info
+        } DwrfAddrRange;
+
+        /**
+         * @brief Sorted, non-overlapping address ranges of every compile unit, answers which unit covers an address.
+         */
+        typedef struct DwrfAddrIndex DwrfAddrIndex;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param index (out) Index of the file, release with dwarf_addr_index_destroy().
+         * @return Error code
+         * @brief Builds the index from .debug_aranges. Units it doesn't describe (or every unit when the
+         * section is missing) contribute the DW_AT_low_pc/DW_AT_high_pc or DW_AT_ranges of their unit DIE.
+         *
+         * Where ranges of different units overlap, the one starting first keeps the shared addresses.
+         */
+        DwrfResult dwarf_addr_index_build(DwrfCtx *ctx, DwrfAddrIndex **index);
+
+        /**
+         * @param index Address index.
+         * @param addr Address to look up.
+         * @param unit_offset (out) Offset of the header of the unit covering addr.
+         * @return Error code, DWRF_NOT_FOUND if no unit covers the address.
+         */
+        DwrfResult dwarf_addr_index_lookup(const DwrfAddrIndex *index, uint64_t addr, uint64_t *unit_offset);
+
+        /**
+         * @param index Address index.
+         * @param ranges (out) Ranges sorted by address, they point into the index.
+         * @param count (out) Number of ranges.
+         * @return Error code
+         */
+        DwrfResult dwarf_addr_index_ranges(const DwrfAddrIndex *index, const DwrfAddrRange **ranges, uint64_t *count);
+
+        /**
+         * @param index Address index.
+         * @param buff (out) Buffer receiving the flat representation, NULL to only query the size.
+         * @param len Size of "buff".
+         * @param size (out) Bytes needed for the blob.
+         * @return Error code, DWRF_BUFFER_OVERFLOW if len is smaller than size.
+         * @note The blob is in the byte order of the host, dwarf_addr_index_load() rejects other hosts' blobs.
+         */
+        DwrfResult dwarf_addr_index_serialize(const DwrfAddrIndex *index, void *buff, uint64_t len, uint64_t *size);
+
+        /**
+         * @param blob Data written by dwarf_addr_index_serialize().
+         * @param size Size of the blob.
+         * @param index (out) Index, release with dwarf_addr_index_destroy().
+         * @return Error code, DWRF_DECODE_ERR if the blob is malformed, DWRF_UNSUPPORTED for another version or byte order.
+         * @brief Reloads an index without copying: when the blob is 8-byte aligned the ranges are used in place,
+         * so it must outlive the index. Unaligned blobs are copied.
+         */
+        DwrfResult dwarf_addr_index_load(const void *blob, uint64_t size, DwrfAddrIndex **index);
+
+        /**
+         * @param index Index to release, NULL has no effect.
+         */
+        void dwarf_addr_index_destroy(DwrfAddrIndex *index);
+
+/***************
+ * Name index  *
+ ***************/
+        /**
+         * @brief DIE that carries a name, as found in the name index.
+         */
+        typedef struct
+        {
+                uint64_t DieOffset;     // Offset of the DIE in .debug_info
+                uint64_t UnitOffset;    // Offset of the header of the unit that owns the DIE
+                uint16_t Tag;           // DW_TAG_*
+        } DwrfNameEntry;
+
+        /**
+         * @brief Maps the names of functions, variables, types and namespaces to their DIEs.
+         */
+        typedef struct DwrfNameIndex DwrfNameIndex;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param threads Threads used to scan units, 0 for one per CPU.
+         * @param index (out) Index of the file, release with dwarf_name_index_destroy().
+         * @return Error code
+         * @brief Reads the hash tables of .debug_names, lookups then never touch .debug_info. Units the
+         * section doesn't cover (or every unit when it is missing) are scanned once in parallel
+         * into an equivalent in-memory table.
+         *
+         * The scan indexes DW_AT_name and DW_AT_linkage_name of the entities listed in section 6.1.1.1
+         * of the standard, except those scoped to a function body.
+         * @note The context must outlive the index.
+         */
+        DwrfResult dwarf_name_index_build(DwrfCtx *ctx, uint32_t threads, DwrfNameIndex **index);
+
+        /**
+         * @param index Name index.
+         * @param name Name to look up, case sensitive.
+         * @param entries (out) Array receiving the first "max" matches, may be NULL if max is 0.
+         * @param max Size of "entries".
+         * @param count (out) Total number of matches.
+         * @return Error code, DWRF_NOT_FOUND if nothing matches, DWRF_BUFFER_OVERFLOW if count exceeds max.
+         * @note Lookups only read the index, they can run concurrently.
+         */
+        DwrfResult dwarf_name_index_find(const DwrfNameIndex *index, const char *name, DwrfNameEntry *entries, uint32_t max,
+                                         uint32_t *count);
+
+        /**
+         * @param index Name index.
+         * @param names (out) Number of distinct names (per name table of .debug_names).
+         * @return Error code
+         */
+        DwrfResult dwarf_name_index_size(const DwrfNameIndex *index, uint64_t *names);
+
+        /**
+         * @param index Index to release, NULL has no effect.
+         */
+        void dwarf_name_index_destroy(DwrfNameIndex *index);
+
+/***************
+ *  GDB index  *
+ ***************/
+        /**
+         * @brief Kind of a .gdb_index symbol, recorded from version 7 of the format.
+         */
+        typedef enum
+        {
+                DWRF_GDB_KIND_NONE = 0,         // Not recorded
+                DWRF_GDB_KIND_TYPE,
+                DWRF_GDB_KIND_VARIABLE,         // Variables and enumerators
+                DWRF_GDB_KIND_FUNCTION,
+                DWRF_GDB_KIND_OTHER,            // Namespaces, modules...
+        } DwrfGdbKind;
+
+        /**
+         * @brief Unit that defines a name, as listed by the symbol table of .gdb_index.
+         */
+        typedef struct
+        {
+                uint64_t UnitOffset;    // Offset of the unit header in .debug_info (.debug_types for DWARF 4 type units)
+                uint64_t Signature;     // Type signature of type units, 0 for compile units
+                uint32_t Unit;          // Position in the CU list, type units follow the compile units
+                uint8_t  Kind;          // DwrfGdbKind
+                uint8_t  Static;        // The symbol isn't visible outside its unit
+                uint8_t  TypeUnit;
+        } DwrfGdbSymbol;
+
+        /**
+         * @brief Summary of a .gdb_index section.
+         */
+        typedef struct
+        {
+                uint32_t Version;
+                uint32_t Units;         // Compile units
+                uint32_t TypeUnits;
+                uint64_t Ranges;        // Address ranges after merging
+                uint32_t Slots;         // Size of the symbol hash table
+                uint32_t Symbols;       // Slots in use
+        } DwrfGdbIndexInfo;
+
+        /**
+         * @brief Reader of the .gdb_index section GDB, gold and lld write: name and address lookups that
+         * narrow a search down to a few units without scanning .debug_info.
+         */
+        typedef struct DwrfGdbIndex DwrfGdbIndex;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param index (out) Index of the file, release with dwarf_gdb_index_destroy().
+         * @return Error code, DWRF_SEC_MISSING without .gdb_index, DWRF_UNSUPPORTED for versions other than 7 to 9.
+         * @brief Validates the section and sorts its address area, the symbol table is used in place.
+         * @note The context must outlive the index.
+         */
+        DwrfResult dwarf_gdb_index_open(DwrfCtx *ctx, DwrfGdbIndex **index);
+
+        /**
+         * @param index GDB index.
+         * @param name Name to look up, case sensitive. C++ names are qualified ("ns::klass::method") and
+         *             have no parameter list.
+         * @param symbols (out) Array receiving the first "max" units defining the name, may be NULL if max is 0.
+         * @param max Size of "symbols".
+         * @param count (out) Total number of units.
+         * @return Error code, DWRF_NOT_FOUND if nothing matches, DWRF_BUFFER_OVERFLOW if count exceeds max.
+         * @note Lookups only read the index, they can run concurrently.
+         */
+        DwrfResult dwarf_gdb_index_find(const DwrfGdbIndex *index, const char *name, DwrfGdbSymbol *symbols, uint32_t max,
+                                        uint32_t *count);
+
+        /**
+         * @param index GDB index.
+         * @param name Name to look up, as for dwarf_gdb_index_find().
+         * @param entries (out) Array receiving the first "max" DIEs, may be NULL if max is 0.
+         * @param max Size of "entries".
+         * @param count (out) Total number of DIEs.
+         * @return Error code, DWRF_NOT_FOUND if nothing matches, DWRF_BUFFER_OVERFLOW if count exceeds max.
+         * @brief Resolves a name to its DIEs by walking the units the symbol table lists for it. Scopes that
+         * can't contain the name are skipped, function bodies are never entered.
+         *
+         * Definitions that take their name from a declaration (DW_AT_specification) or an abstract instance
+         * (DW_AT_abstract_origin) are reported in place of it, declarations are only reported when the unit
+         * has no definition. Type units are only walked when they are in .debug_info.
+         * @note Decodes units through the context, calls must not overlap with other uses of it.
+         */
+        DwrfResult dwarf_gdb_index_find_dies(const DwrfGdbIndex *index, const char *name, DwrfNameEntry *entries,
+                                             uint32_t max, uint32_t *count);
+
+        /**
+         * @param index GDB index.
+         * @param addr Address to look up.
+         * @param unit_offset (out) Offset of the header of the compile unit covering addr.
+         * @return Error code, DWRF_NOT_FOUND if the address area doesn't cover the address.
+         */
+        DwrfResult dwarf_gdb_index_lookup_addr(const DwrfGdbIndex *index, uint64_t addr, uint64_t *unit_offset);
+
+        /**
+         * @param index GDB index.
+         * @param info (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_gdb_index_info(const DwrfGdbIndex *index, DwrfGdbIndexInfo *info);
+
+        /**
+         * @param index Index to release, NULL has no effect.
+         */
+        void dwarf_gdb_index_destroy(DwrfGdbIndex *index);
+
+/***************
+ * Split DWARF *
+ ***************/
+        /**
+         * @brief Contribution of a package unit to one section of the package.
+         */
+        typedef struct
+        {
+                uint64_t Offset;        // Start of the contribution in the package section
+                uint64_t Size;          // 0 if the unit has nothing in that section
+        } DwrfContribution;
+
+        #define DWRF_PACKAGE_SECTIONS 9u        // DW_SECT_* values are below it
+
+        /**
+         * @brief Row of the index of a package (.dwp), see section 7.3.5 of spec v5.
+         */
+        typedef struct
+        {
+                uint64_t Signature;     // dwo_id of a split compilation unit, type signature of a split type unit
+                DwrfContribution Sections[DWRF_PACKAGE_SECTIONS];       // indexed by DW_SECT_*
+        } DwrfPackageUnit;
+
+        /**
+         * @param pkg DWARF context of a package, initialized with dwarf_init().
+         * @param unit_type DW_UT_split_compile to search .debug_cu_index, DW_UT_split_type for .debug_tu_index.
+         * @param signature dwo_id or type signature of the unit.
+         * @param unit (out) User allocated struct to be filled.
+         * @return Error code, DWRF_SEC_MISSING if the file has no such index, DWRF_NOT_FOUND if the unit isn't in it.
+         * @brief Looks the unit up in the hash table of the index, in place.
+         */
+        DwrfResult dwarf_package_find(DwrfCtx *pkg, uint8_t unit_type, uint64_t signature, DwrfPackageUnit *unit);
+
+        /**
+         * @param pkg DWARF context of a package, initialized with dwarf_init().
+         * @param unit_type DW_UT_split_compile or DW_UT_split_type.
+         * @param units (out) Array receiving the first "max" units in index order, may be NULL if max is 0.
+         * @param max Size of "units".
+         * @param count (out) Number of units in the index.
+         * @return Error code, DWRF_BUFFER_OVERFLOW if count exceeds max.
+         */
+        DwrfResult dwarf_package_units(DwrfCtx *pkg, uint8_t unit_type, DwrfPackageUnit *units, uint32_t max,
+                                       uint32_t *count);
+
+        /**
+         * @param pkg DWARF context of a package, initialized with dwarf_init().
+         * @param unit Unit obtained with dwarf_package_find() or dwarf_package_units().
+         * @param ctx (out) User allocated context, release it with dwarf_destroy().
+         * @return Error code
+         * @brief Opens one unit of a package as if it were a .dwo file of its own.
+         *
+         * The sections of the new context are the unit's contributions, so the unit starts at offset 0 and every
+         * offset is relative to them. They point into the sections of the package, which are loaded and must
+         * outlive the context; the package context must not be in use by another thread meanwhile.
+         */
+        DwrfResult dwarf_package_open_unit(DwrfCtx *pkg, const DwrfPackageUnit *unit, DwrfCtx *ctx);
+
+        /**
+         * @param split Context of a .dwo file or of a package unit.
+         * @param ctx Context of the file that holds the skeleton unit, it must outlive "split".
+         * @param skeleton Skeleton unit (DW_UT_skeleton) of ctx.
+         * @return Error code
+         * @brief Makes the addresses of the split units resolvable (DW_FORM_addrx and the lists that use it),
+         * they live in the .debug_addr of the skeleton's file at the skeleton's DW_AT_addr_base.
+         */
+        DwrfResult dwarf_split_link(DwrfCtx *split, DwrfCtx *ctx, const DwrfUnitHeader *skeleton);
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param sup Context of the supplementary file, NULL to unset it. Must outlive ctx.
+         * @return Error code
+         * @brief Lets dwarf_get_string() read DW_FORM_strp_sup (and GNU alternate) strings.
+         */
+        DwrfResult dwarf_set_supplementary(DwrfCtx *ctx, const DwrfCtx *sup);
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param path (out) Character buffer for the path of the supplementary file, as recorded.
+         * @param len Length of "path".
+         * @param id (out) Buffer for the checksum or build ID identifying the file, may be NULL.
+         * @param id_len (in/out) Size of "id", receives the size of the checksum.
+         * @return Error code, DWRF_NOT_FOUND if the file doesn't refer to a supplementary file.
+         * @brief Reads .debug_sup (DWARF 5) or, failing that, .gnu_debugaltlink (dwz).
+         */
+        DwrfResult dwarf_supplementary_file(DwrfCtx *ctx, char *path, uint16_t len, uint8_t *id, uint16_t *id_len);
+
+        /**
+         * @brief Bounded set of open split units, shared by the lookups that follow skeleton units.
+         *
+         * Units are identified by their dwo_id. They are searched in the package first and then in the
+         * .dwo named by DW_AT_dwo_name (joined with DW_AT_comp_dir when relative), opened through the
+         * callbacks. Each handle is a prepared context linked to its skeleton. When more than MaxOpen
+         * handles are open, the least recently used one that nobody holds is closed. Units that can't be
+         * found are remembered so they aren't searched again.
+         */
+        typedef struct DwrfDwoPool DwrfDwoPool;
+
+        /**
+         * @param user User pointer of the pool.
+         * @param path Path of the .dwo file.
+         * @param elf (out) Initialized ELF context of the file, valid until the close callback receives it.
+         * @param image (out) Whole file in memory (see dwarf_set_image()), NULL to read through elf.
+         * @param size (out) Size of the image.
+         * @return Error code, DWRF_NOT_FOUND if the file doesn't exist.
+         */
+        typedef DwrfResult (*DwrfDwoOpenFn)(void *user, const char *path, const ElfCtx **elf, const void **image,
+                                            uint64_t *size);
+
+        typedef void (*DwrfDwoCloseFn)(void *user, const ElfCtx *elf);
+
+        typedef struct
+        {
+                DwrfDwoOpenFn Open;     // NULL to only use the package
+                DwrfDwoCloseFn Close;   // May be NULL
+                void *User;
+                DwrfCtx *Package;       // Context of the .dwp, NULL if there is none. Must outlive the pool
+                uint32_t MaxOpen;       // Handles kept open, 0 for the default of 64
+        } DwrfDwoPoolInfo;
+
+        typedef struct
+        {
+                uint64_t Hits;          // Acquisitions served by an open handle
+                uint64_t Opens;         // Units opened, reopens after an eviction included
+                uint64_t Failures;      // Units that couldn't be opened
+                uint64_t Evictions;
+                uint64_t Resident;      // Handles currently open
+        } DwrfDwoPoolStats;
+
+        /**
+         * @param info Callbacks and limits, copied.
+         * @param pool (out) Pool, release with dwarf_dwo_pool_destroy().
+         * @return Error code
+         */
+        DwrfResult dwarf_dwo_pool_create(const DwrfDwoPoolInfo *info, DwrfDwoPool **pool);
+
+        /**
+         * @param pool Pool to release with every handle, NULL has no effect. No handle may be in use.
+         */
+        void dwarf_dwo_pool_destroy(DwrfDwoPool *pool);
+
+        /**
+         * @param pool Pool.
+         * @param ctx Context of the skeleton unit, it must outlive the pool.
+         * @param skeleton Skeleton unit (DW_UT_skeleton) of ctx.
+         * @param split (out) Context of the split unit, valid until released with dwarf_dwo_release().
+         * @param unit (out) Header of the split compilation unit in "split".
+         * @return Error code, DWRF_NOT_FOUND if the split unit can't be found or doesn't match the skeleton.
+         * @note Acquisitions can run concurrently, the handle is shared by its holders and only read
+         * through private copies by the library. Opening a unit holds the pool's lock.
+         */
+        DwrfResult dwarf_dwo_acquire(DwrfDwoPool *pool, DwrfCtx *ctx, const DwrfUnitHeader *skeleton, DwrfCtx **split,
+                                     DwrfUnitHeader *unit);
+
+        /**
+         * @param pool Pool the handle was acquired from.
+         * @param split Handle returned by dwarf_dwo_acquire().
+         */
+        void dwarf_dwo_release(DwrfDwoPool *pool, DwrfCtx *split);
+
+        /**
+         * @param pool Pool.
+         * @param stats (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_dwo_pool_stats(DwrfDwoPool *pool, DwrfDwoPoolStats *stats);
+
+/***************
+ *   Budget    *
+ ***************/
+        /**
+         * @brief Memory limit shared by the units loaded by symbolizers.
+         *
+         * Each unit lives in an arena of its own, the least recently used ones nobody is reading are
+         * released as a whole when the units of all the symbolizers charging the budget exceed its limit.
+         * A long running process serving many files bounds its memory with a single budget.
+         */
+        typedef struct DwrfMemBudget DwrfMemBudget;
+
+        typedef struct
+        {
+                uint64_t Limit;         // 0 for no limit
+                uint64_t Used;          // Memory held by the loaded units
+                uint64_t Units;         // Units currently loaded
+                uint64_t Evictions;
+                uint32_t Owners;        // Symbolizers charging the budget
+        } DwrfMemBudgetStats;
+
+        /**
+         * @param limit Bytes the loaded units may hold, 0 for no limit. The units being read are kept even
+         *              if they alone exceed it.
+         * @param budget (out) Budget, release with dwarf_mem_budget_destroy().
+         * @return Error code
+         */
+        DwrfResult dwarf_mem_budget_create(uint64_t limit, DwrfMemBudget **budget);
+
+        /**
+         * @param budget Budget to release, NULL has no effect.
+         * @note The symbolizers charging it must have been destroyed or moved to another budget.
+         */
+        void dwarf_mem_budget_destroy(DwrfMemBudget *budget);
+
+        /**
+         * @param budget Budget.
+         * @param limit New limit, 0 for no limit. Lowering it evicts the units over it right away.
+         * @return Error code
+         */
+        DwrfResult dwarf_mem_budget_set_limit(DwrfMemBudget *budget, uint64_t limit);
+
+        /**
+         * @param budget Budget.
+         * @param stats (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_mem_budget_stats(DwrfMemBudget *budget, DwrfMemBudgetStats *stats);
+
+/***************
+ * Symbolizer  *
+ ***************/
+        /**
+         * @brief One frame of the source level call chain of an address.
+         */
+        typedef struct
+        {
+                const char *Function;   // DW_AT_name of the function, its ELF symbol when there's no debug information. May be NULL
+                const char *LinkageName;// Mangled name, NULL if the debug information doesn't have one
+                const char *File;       // Source path, NULL if unknown
+                uint32_t Line;          // 0 if unknown
+                uint16_t Column;        // 0 if unknown
+                uint8_t  Inlined;       // The function was inlined into the one of the next frame
+        } DwrfFrame;
+
+        /**
+         * @brief Maps addresses to functions, source lines and inlined call chains.
+         *
+         * The ELF symbol table and the address index are built up front, the line table and the inline
+         * scopes of a unit are decoded the first time one of its addresses is looked up and dropped in
+         * least recently used order once they exceed the memory budget. Recent results are kept in a
+         * cache split in independently locked shards.
+         */
+        typedef struct DwrfSymbolizer DwrfSymbolizer;
+
+        typedef struct
+        {
+                uint64_t CacheHits;
+                uint64_t CacheMisses;
+                uint64_t UnitsLoaded;   // Unit loads, reloads after an eviction included
+                uint64_t UnitsEvicted;
+                uint64_t UnitsResident; // Units currently loaded
+                uint64_t UnitBytes;     // Memory held by the loaded units
+                uint64_t Symbols;       // Function symbols indexed from the ELF symbol table
+        } DwrfSymbolizerStats;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param budget Bytes the loaded units may hold, 0 for no limit. The units being read are kept even
+         *               if they alone exceed it. See dwarf_symbolizer_set_budget() to share a limit.
+         * @param cache_entries Results kept in the cache, 0 to disable it.
+         * @param sym (out) Symbolizer, release with dwarf_symbolizer_destroy().
+         * @return Error code
+         * @note The context must outlive the symbolizer, lookups work on private copies of it and can run
+         * concurrently.
+         */
+        DwrfResult dwarf_symbolizer_create(DwrfCtx *ctx, uint64_t budget, uint32_t cache_entries, DwrfSymbolizer **sym);
+
+        /**
+         * @param sym Symbolizer to release, NULL has no effect.
+         */
+        void dwarf_symbolizer_destroy(DwrfSymbolizer *sym);
+
+        /**
+         * @param sym Symbolizer.
+         * @param addr Address to look up.
+         * @param frames (out) Array receiving the first "max" frames, innermost first: the inlined subroutines
+         *               down to the function they were inlined into. May be NULL if max is 0.
+         * @param max Size of "frames".
+         * @param count (out) Total number of frames.
+         * @return Error code, DWRF_NOT_FOUND if nothing is known about the address, DWRF_BUFFER_OVERFLOW if
+         * count exceeds max.
+         * @note The strings point into the context and the symbolizer, they stay valid until it is destroyed.
+         */
+        DwrfResult dwarf_symbolize(DwrfSymbolizer *sym, uint64_t addr, DwrfFrame *frames, uint32_t max, uint32_t *count);
+
+        /**
+         * @param sym Symbolizer.
+         * @param stats (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_symbolizer_stats(DwrfSymbolizer *sym, DwrfSymbolizerStats *stats);
+
+        /**
+         * @param sym Symbolizer.
+         * @param pool Pool the split units of the skeleton units are read from, NULL to stop following them.
+         *             It must outlive the symbolizer.
+         * @return Error code
+         * @brief Lets lookups find the functions and inlined calls of split DWARF units, the lines come
+         * from the skeleton. Units already loaded are kept as they are.
+         */
+        DwrfResult dwarf_symbolizer_set_dwo_pool(DwrfSymbolizer *sym, DwrfDwoPool *pool);
+
+        /**
+         * @param sym Symbolizer.
+         * @param budget Budget the loaded units are charged to, NULL to go back to a private one with the
+         *               limit given to dwarf_symbolizer_create(). It must outlive the symbolizer.
+         * @return Error code
+         * @brief Moves the symbolizer to a budget shared with others. The units already loaded are released,
+         * the cached results are kept.
+         * @note Must not run concurrently with lookups on the symbolizer.
+         */
+        DwrfResult dwarf_symbolizer_set_budget(DwrfSymbolizer *sym, DwrfMemBudget *budget);
+
+/***************
+ *  Sym index  *
+ ***************/
+        /**
+         * @brief Symbol of the ELF symbol table, as found in a symbol index.
+         */
+        typedef struct
+        {
+                uint64_t Address;
+                uint64_t Size;          // 0 if unknown
+                const char *Name;       // Points into the index
+        } DwrfIndexSymbol;
+
+        /**
+         * @brief Persistent lookup tables of a file: its function and object symbols sorted by address with a
+         * hash table of their names, the address ranges of its units and its decoded line tables.
+         *
+         * The serialized form is little endian and made of offsets only, so a file mapped in memory is
+         * used in place once its header and checksum are verified. It is keyed by the GNU build ID of the
+         * file it was built from.
+         */
+        typedef struct DwrfSymIndex DwrfSymIndex;
+
+        typedef struct
+        {
+                uint64_t Symbols;
+                uint64_t Units;
+                uint64_t Sequences;     // Line table sequences
+                uint64_t Rows;          // Line table rows
+                uint64_t Files;
+                uint64_t Size;          // Bytes of the serialized index
+        } DwrfSymIndexInfo;
+
+        /**
+         * @param elf ELF file the index describes.
+         * @param ctx DWARF context of the same file, initialized with dwarf_init(). NULL for files without
+         *            debug information, the index then only holds the symbols.
+         * @param threads Threads decoding line programs, 0 for one per CPU.
+         * @param blob (out) Serialized index allocated with malloc(), release it with free().
+         * @param size (out) Size of the blob.
+         * @return Error code, DWRF_UNSUPPORTED on big endian hosts.
+         */
+        DwrfResult dwarf_sym_index_build(const ElfCtx *elf, DwrfCtx *ctx, uint32_t threads, void **blob, uint64_t *size);
+
+        /**
+         * @param blob Serialized index, typically a mapped file. Must be 8-byte aligned and outlive the index.
+         * @param size Size of the blob.
+         * @param index (out) Index reading the blob in place, release with dwarf_sym_index_destroy().
+         * @return Error code, DWRF_DECODE_ERR if the blob is malformed or the checksum doesn't match,
+         * DWRF_UNSUPPORTED for another version or a big endian host.
+         */
+        DwrfResult dwarf_sym_index_open(const void *blob, uint64_t size, DwrfSymIndex **index);
+
+        /**
+         * @param index Index to release, NULL has no effect. The blob is left to the caller.
+         */
+        void dwarf_sym_index_destroy(DwrfSymIndex *index);
+
+        /**
+         * @param index Symbol index.
+         * @param id (out) Build ID of the indexed file, points into the blob.
+         * @param len (out) Length of the build ID, 0 if the file had none.
+         * @return Error code
+         */
+        DwrfResult dwarf_sym_index_build_id(const DwrfSymIndex *index, const uint8_t **id, uint32_t *len);
+
+        /**
+         * @param index Symbol index.
+         * @param info (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_sym_index_info(const DwrfSymIndex *index, DwrfSymIndexInfo *info);
+
+        /**
+         * @param index Symbol index.
+         * @param addr Address to look up.
+         * @param sym (out) Closest symbol at or before addr that covers it. Symbols without size cover the
+         *            addresses up to the next one.
+         * @return Error code, DWRF_NOT_FOUND if no symbol covers the address.
+         */
+        DwrfResult dwarf_sym_index_symbol(const DwrfSymIndex *index, uint64_t addr, DwrfIndexSymbol *sym);
+
+        /**
+         * @param index Symbol index.
+         * @param name Symbol name, case sensitive.
+         * @param sym (out) Symbol with that name, global symbols take precedence over weak and local ones.
+         * @return Error code, DWRF_NOT_FOUND if no symbol has the name.
+         */
+        DwrfResult dwarf_sym_index_find_symbol(const DwrfSymIndex *index, const char *name, DwrfIndexSymbol *sym);
+
+        /**
+         * @param index Symbol index.
+         * @param addr Address to look up.
+         * @param unit_offset (out) Offset of the header of the unit covering addr.
+         * @return Error code, DWRF_NOT_FOUND if no unit covers the address.
+         * @see dwarf_addr_index_lookup
+         */
+        DwrfResult dwarf_sym_index_unit(const DwrfSymIndex *index, uint64_t addr, uint64_t *unit_offset);
+
+        /**
+         * @param index Symbol index.
+         * @param addr Address to look up.
+         * @param row (out) User allocated struct receiving the line table row covering addr, its File field
+         *            is an index of the symbol index.
+         * @param file (out) Path of the source file, NULL if unknown. Points into the index.
+         * @return Error code, DWRF_NOT_FOUND if no sequence covers the address.
+         */
+        DwrfResult dwarf_sym_index_line(const DwrfSymIndex *index, uint64_t addr, DwrfLineRow *row, const char **file);
+
+/***************
+ * Type table  *
+ ***************/
+        #define DWRF_TYPE_VOID      0u                  // Type id of void and of references that couldn't be followed
+        #define DWRF_TYPE_NO_VALUE  UINT64_MAX          // DwrfTypeMember.Value when unknown
+
+        /* Flags of a type */
+        #define DWRF_TYPE_DECLARATION 0x01u             // Incomplete type (DW_AT_declaration) without a matching definition
+        #define DWRF_TYPE_PROTOTYPED  0x02u             // Subroutine type with a prototype
+
+        #define DWRF_TYPE_SECTION ".dwrf_types"         // Name for a section holding a serialized table
+
+        /**
+         * @brief Type of the deduplicated type graph, ids go from 1 to DwrfTypeTableStats.Types.
+         */
+        typedef struct
+        {
+                const char *Name;       // NULL for anonymous types
+                uint64_t Size;          // DW_AT_byte_size, 0 if absent
+                uint32_t Type;          // Pointee, aliased, element, return or underlying type
+                uint32_t MemberCount;   // See dwarf_type_table_members()
+                uint16_t Tag;           // DW_TAG_*
+                uint8_t  Encoding;      // DW_ATE_* of base types
+                uint8_t  Flags;         // DWRF_TYPE_*
+        } DwrfType;
+
+        /**
+         * @brief Child of a type: a member or base class of a structure, an enumerator, one dimension of an
+         * array or a parameter of a subroutine type. Pointers to members have one, their containing type.
+         */
+        typedef struct
+        {
+                const char *Name;       // NULL if unnamed
+                uint64_t Value;         // Bit offset of data members and base classes, value of enumerators,
+                                        // element count of array dimensions. DWRF_TYPE_NO_VALUE if unknown or static
+                uint32_t Type;
+                uint32_t BitSize;       // Bit fields, 0 otherwise
+                uint16_t Tag;           // DW_TAG_*
+        } DwrfTypeMember;
+
+        /**
+         * @brief Types of every unit with the structurally identical ones merged, in the spirit of BTF and CTF.
+         *
+         * Types are equal when they have the same kind, name, scope, size and children and refer to equal
+         * types, recursive types included: the graph is partitioned by the shallow properties of each type
+         * and the partition refined by the classes of the referenced types until it is stable. Declarations
+         * resolve to the definition of the same name when there is exactly one. The table owns its strings.
+         */
+        typedef struct DwrfTypeTable DwrfTypeTable;
+
+        typedef struct
+        {
+                uint64_t InputTypes;    // Type DIEs read
+                uint64_t InputMembers;
+                uint64_t Types;         // Types left after deduplication
+                uint64_t Members;
+                uint64_t Declarations;  // Declarations resolved to their definition
+                uint64_t InputBytes;    // Memory the graph would take without deduplication
+                uint64_t Bytes;         // Memory of the types, members and strings of the table
+                uint64_t DieMapBytes;   // Memory of the DIE to type map of dwarf_type_table_die()
+                uint32_t Rounds;        // Refinement rounds, declaration resolution included
+        } DwrfTypeTableStats;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param threads Threads reading units and hashing types, 0 for one per CPU.
+         * @param table (out) Table of the file, release with dwarf_type_table_destroy().
+         * @return Error code
+         * @brief Reads the types of every unit in parallel and deduplicates them. The ids don't depend on the
+         * thread count.
+         * @note Type units and references through DW_FORM_ref_sig8 are not followed, those become DWRF_TYPE_VOID.
+         */
+        DwrfResult dwarf_type_table_build(DwrfCtx *ctx, uint32_t threads, DwrfTypeTable **table);
+
+        /**
+         * @param table Table to release, NULL has no effect.
+         */
+        void dwarf_type_table_destroy(DwrfTypeTable *table);
+
+        /**
+         * @param table Type table.
+         * @param id Type id.
+         * @param type (out) User allocated struct to be filled, strings point into the table.
+         * @return Error code, DWRF_BAD_ARG if the id is out of range (DWRF_TYPE_VOID included).
+         */
+        DwrfResult dwarf_type_table_get(const DwrfTypeTable *table, uint32_t id, DwrfType *type);
+
+        /**
+         * @param table Type table.
+         * @param id Type id.
+         * @param members (out) Children of the type in DIE order, they point into the table.
+         * @param count (out) Number of members.
+         * @return Error code, DWRF_BAD_ARG if the id is out of range.
+         */
+        DwrfResult dwarf_type_table_members(const DwrfTypeTable *table, uint32_t id, const DwrfTypeMember **members,
+                                            uint32_t *count);
+
+        /**
+         * @param table Type table built with dwarf_type_table_build().
+         * @param die_offset Offset in .debug_info of a type DIE, e.g. the target of a DW_AT_type.
+         * @param id (out) Id of the deduplicated type.
+         * @return Error code, DWRF_NOT_FOUND if the DIE isn't a type or the table was loaded from a blob.
+         */
+        DwrfResult dwarf_type_table_die(const DwrfTypeTable *table, uint64_t die_offset, uint32_t *id);
+
+        /**
+         * @param table Type table.
+         * @param stats (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_type_table_stats(const DwrfTypeTable *table, DwrfTypeTableStats *stats);
+
+        /**
+         * @param table Type table.
+         * @param buff (out) Buffer receiving the serialized table, NULL to only query the size.
+         * @param len Size of "buff".
+         * @param size (out) Bytes needed.
+         * @return Error code, DWRF_BUFFER_OVERFLOW if len is smaller than size.
+         * @brief Writes the types, members and strings in a little endian format suited for a non allocated
+         * section (see DWRF_TYPE_SECTION), e.g. a chunk added with elfw_section_append_data(). The DIE map is
+         * left out, the section is meant for files whose debug information is stripped.
+         */
+        DwrfResult dwarf_type_table_serialize(const DwrfTypeTable *table, void *buff, uint64_t len, uint64_t *size);
+
+        /**
+         * @param blob Data written by dwarf_type_table_serialize(), e.g. the contents of a DWRF_TYPE_SECTION section.
+         * @param size Size of the blob.
+         * @param table (out) Table, release with dwarf_type_table_destroy(). It doesn't reference the blob.
+         * @return Error code, DWRF_DECODE_ERR if the blob is malformed, DWRF_UNSUPPORTED for another version.
+         */
+        DwrfResult dwarf_type_table_load(const void *blob, uint64_t size, DwrfTypeTable **table);
+
+/***************
+ * Type index  *
+ ***************/
+        /**
+         * @brief Type DIE found by name in a type index.
+         */
+        typedef struct
+        {
+                uint64_t DieOffset;     // Offset of the DIE in .debug_info
+                uint16_t Tag;           // DW_TAG_*_type or DW_TAG_typedef
+                uint8_t  Declaration;   // DW_AT_declaration, definitions are returned first
+        } DwrfTypeIndexEntry;
+
+        /**
+         * @brief Map from the qualified names of the named types of a file ("ns::Outer::Inner", "std::vector<int>")
+         * to their DIEs, with a minimal perfect hash of the names so a lookup reads one bucket and one slot.
+         *
+         * Names are the DW_AT_name of the type joined to its enclosing namespaces, structures, classes and
+         * unions with "::", as the producer spelled them. Types nested in functions or anonymous types are
+         * left out, anonymous namespaces are named "(anonymous namespace)". The serialized form is little
+         * endian and made of offsets only, like the one of a symbol index.
+         */
+        typedef struct DwrfTypeIndex DwrfTypeIndex;
+
+        typedef struct
+        {
+                uint64_t Names;         // Distinct qualified names
+                uint64_t Entries;       // Type DIEs
+                uint64_t StringBytes;   // Of the name pool
+                uint64_t Buckets;
+                uint64_t Slots;
+                uint64_t Size;          // Bytes of the serialized index
+        } DwrfTypeIndexInfo;
+
+        /**
+         * @param ctx DWARF context initialized with dwarf_init().
+         * @param threads Threads scanning units, 0 for one per CPU.
+         * @param blob (out) Serialized index allocated with malloc(), release it with free().
+         * @param size (out) Size of the blob.
+         * @return Error code, DWRF_UNSUPPORTED on big endian hosts.
+         */
+        DwrfResult dwarf_type_index_build(DwrfCtx *ctx, uint32_t threads, void **blob, uint64_t *size);
+
+        /**
+         * @param blob Serialized index, typically a mapped file. Must be 8-byte aligned and outlive the index.
+         * @param size Size of the blob.
+         * @param index (out) Index reading the blob in place, release with dwarf_type_index_destroy().
+         * @return Error code, DWRF_DECODE_ERR if the blob is malformed or the checksum doesn't match,
+         * DWRF_UNSUPPORTED for another version or a big endian host.
+         */
+        DwrfResult dwarf_type_index_open(const void *blob, uint64_t size, DwrfTypeIndex **index);
+
+        /**
+         * @param index Index to release, NULL has no effect. The blob is left to the caller.
+         */
+        void dwarf_type_index_destroy(DwrfTypeIndex *index);
+
+        /**
+         * @param index Type index.
+         * @param info (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_type_index_info(const DwrfTypeIndex *index, DwrfTypeIndexInfo *info);
+
+        /**
+         * @param index Type index.
+         * @param name Qualified name, case sensitive.
+         * @param entries (out) User allocated array receiving the DIEs with that name.
+         * @param max Size of the array.
+         * @param count (out) Number of DIEs with that name, may exceed max.
+         * @return Error code, DWRF_NOT_FOUND if no type has the name, DWRF_BUFFER_OVERFLOW if count > max
+         * (the first max entries are filled).
+         */
+        DwrfResult dwarf_type_index_find(const DwrfTypeIndex *index, const char *name, DwrfTypeIndexEntry *entries,
+                                         uint32_t max, uint32_t *count);
+
+/***************
+ * Call frames *
+ ***************/
+        /**
+         * @brief How the value of a register (or the CFA) in the caller is recovered.
+         */
+        typedef enum
+        {
+                DWRF_RULE_SAME_VALUE,           // Not modified by the function, also the rule of registers without one
+                DWRF_RULE_UNDEFINED,            // Not recoverable, for the return address it marks the outermost frame
+                DWRF_RULE_OFFSET,               // Saved at address CFA + Offset
+                DWRF_RULE_VAL_OFFSET,           // The value is CFA + Offset
+                DWRF_RULE_REGISTER,             // Held in register Reg. For the CFA the value of Reg plus Offset
+                DWRF_RULE_EXPRESSION,           // Saved at the address computed by Expr, with the CFA pushed first
+                DWRF_RULE_VAL_EXPRESSION,       // The value is computed by Expr. For the CFA nothing is pushed first
+        } DwrfRuleKind;
+
+        typedef struct
+        {
+                const uint8_t *Expr;    // DWARF expression of the expression kinds, points into the section
+                int64_t Offset;
+                uint32_t ExprLen;
+                uint16_t Reg;
+                uint8_t Kind;           // DwrfRuleKind
+        } DwrfRule;
+
+        /**
+         * @brief Unwind rules that hold for the addresses [Low, High) of a function.
+         */
+        typedef struct
+        {
+                uint64_t Low;
+                uint64_t High;
+                DwrfRule Cfa;           // Canonical frame address, the value of the stack pointer at the call site
+                DwrfRule Ra;            // Rule of the return address column
+                DwrfRule Fp;            // Rule of the register chosen with dwarf_cfi_create(), usually the frame pointer
+                uint16_t RaReg;         // Return address column, where the return address is for DWRF_RULE_SAME_VALUE
+                uint8_t  Signal;        // Signal frame, the return address is the interrupted instruction, not the one after a call
+        } DwrfUnwindRow;
+
+        /**
+         * @brief Call frame information of a file, answers how to unwind one frame at a given address.
+         *
+         * FDEs are looked up in place through the sorted table of .eh_frame_hdr, the table is built when the
+         * header is missing or unusable. .eh_frame is searched first and .debug_frame then.
+         */
+        typedef struct DwrfCfi DwrfCfi;
+
+        typedef struct
+        {
+                uint64_t Fdes;          // FDEs in the search tables, those of .eh_frame_hdr included
+                uint64_t HeaderFdes;    // FDEs looked up through .eh_frame_hdr
+                uint64_t Rows;          // Precompiled rows, 0 before dwarf_cfi_precompile()
+                uint64_t RowBytes;      // Memory held by the precompiled rows
+        } DwrfCfiStats;
+
+        /**
+         * @param elf ELF context, initialized with elf_init(). The file needs no .debug_info: .eh_frame,
+         *            .eh_frame_hdr and .debug_frame are read on their own, so stripped binaries unwind too.
+         * @param fp_reg DWARF number of the register reported in DwrfUnwindRow.Fp, e.g. 6 (rbp) on x86-64 or
+         *               29 on AArch64.
+         * @param cfi (out) Call frame information, release with dwarf_cfi_destroy().
+         * @return Error code, DWRF_SEC_MISSING if the file has neither .eh_frame nor .debug_frame.
+         * @note The sections are loaded by the call, the ELF context must outlive the object. Lookups only
+         *       read it, they can run concurrently.
+         */
+        DwrfResult dwarf_cfi_create(const ElfCtx *elf, uint16_t fp_reg, DwrfCfi **cfi);
+
+        /**
+         * @param cfi Call frame information.
+         * @return Error code
+         * @brief Runs the instructions of every FDE once and keeps the resulting rows in a compact sorted
+         * table, lookups then are a binary search instead of interpreting the FDE. Must not run concurrently
+         * with lookups.
+         *
+         * Where FDEs overlap the first one by address keeps the shared addresses, .eh_frame before .debug_frame.
+         */
+        DwrfResult dwarf_cfi_precompile(DwrfCfi *cfi);
+
+        /**
+         * @param cfi Call frame information.
+         * @param pc Address of the instruction, for caller frames the return address minus one (unless the
+         *           callee is a signal frame).
+         * @param row (out) User allocated struct to be filled.
+         * @return Error code, DWRF_NOT_FOUND if no FDE covers the address.
+         */
+        DwrfResult dwarf_cfi_find(const DwrfCfi *cfi, uint64_t pc, DwrfUnwindRow *row);
+
+        /**
+         * @param cfi Call frame information.
+         * @param stats (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_cfi_stats(const DwrfCfi *cfi, DwrfCfiStats *stats);
+
+        /**
+         * @param cfi Object to release, NULL has no effect.
+         */
+        void dwarf_cfi_destroy(DwrfCfi *cfi);
+
+/***************
+ * Expressions *
+ ***************/
+        /**
+         * @brief Reads register "reg" (DWARF number) of the frame being inspected.
+         * @return DWRF_OK, DWRF_NOT_FOUND if the value isn't known.
+         */
+        typedef DwrfResult (*DwrfReadRegFn)(void *user, uint32_t reg, uint64_t *value);
+
+        /**
+         * @brief Reads "size" bytes of target memory at "addr", in the byte order of the file.
+         * @return DWRF_OK, DWRF_NOT_FOUND if the memory isn't readable.
+         */
+        typedef DwrfResult (*DwrfReadMemFn)(void *user, uint64_t addr, void *buff, uint32_t size);
+
+        /**
+         * @brief Address of the byte at "offset" of the thread local storage block of the module (DW_OP_form_tls_address).
+         */
+        typedef DwrfResult (*DwrfTlsAddrFn)(void *user, uint64_t offset, uint64_t *addr);
+
+        /**
+         * @brief Value register "reg" held on entry to the current function (DW_OP_entry_value).
+         */
+        typedef DwrfResult (*DwrfEntryRegFn)(void *user, uint32_t reg, uint64_t *value);
+
+        /**
+         * @brief Target state an expression is evaluated against. Operations that need a missing callback or
+         * value fail with DWRF_NOT_FOUND.
+         */
+        typedef struct
+        {
+                DwrfReadRegFn ReadReg;
+                DwrfReadMemFn ReadMem;
+                DwrfTlsAddrFn TlsAddr;
+                DwrfEntryRegFn EntryReg;
+                void *User;             // Passed to the callbacks
+                uint64_t Bias;          // Load bias, added to the addresses of DW_OP_addr and DW_OP_addrx
+                uint64_t FrameBase;     // DW_OP_fbreg base, the evaluated DW_AT_frame_base of the function
+                uint64_t Cfa;           // DW_OP_call_frame_cfa
+                uint64_t ObjectAddress; // DW_OP_push_object_address
+                uint64_t Initial;       // Pushed before evaluating, e.g. the CFA for DWRF_RULE_EXPRESSION
+                uint8_t  HasFrameBase;
+                uint8_t  HasCfa;
+                uint8_t  HasObjectAddress;
+                uint8_t  HasInitial;
+        } DwrfExprEnv;
+
+        typedef enum
+        {
+                DWRF_LOC_EMPTY,                 // Optimized out, or a piece without a location
+                DWRF_LOC_MEMORY,                // At address Value
+                DWRF_LOC_REGISTER,              // In register Value
+                DWRF_LOC_VALUE,                 // Not in the target, Value is the value (DW_OP_stack_value)
+                DWRF_LOC_IMPLICIT,              // Not in the target, the Size bytes at Data are the value
+                DWRF_LOC_IMPLICIT_POINTER,      // Pointer to Offset bytes into the object of the DIE at Value
+        } DwrfLocKind;
+
+        /**
+         * @brief Location computed by an expression, or one piece of a composite location.
+         */
+        typedef struct
+        {
+                uint64_t Value;
+                int64_t  Offset;        // Implicit pointers only
+                const uint8_t *Data;    // Implicit values, points into the compiled expression
+                uint64_t Size;          // Bytes at Data
+                uint64_t PieceBits;     // Size of the piece in bits, 0 for a location that isn't composite
+                uint64_t PieceOffset;   // Offset in bits of the piece in the location (DW_OP_bit_piece)
+                uint8_t  Kind;          // DwrfLocKind
+        } DwrfLocPiece;
+
+        /**
+         * @brief Expression decoded once into fixed width instructions: LEB128 operands are expanded,
+         * addrx and constx indexes, base types and call targets resolved and branch targets turned into
+         * instruction indexes.
+         */
+        typedef struct DwrfExpr DwrfExpr;
+
+        /**
+         * @brief Compiled expressions of a context, kept by unit and by the location of their bytes in
+         * the section. Not thread safe, but the expressions it returns can be evaluated concurrently.
+         */
+        typedef struct DwrfExprCache DwrfExprCache;
+
+        typedef struct
+        {
+                uint64_t Hits;
+                uint64_t Misses;        // Expressions compiled
+                uint64_t Insns;         // Instructions of the compiled expressions
+                uint64_t Bytes;         // Memory held by the compiled expressions
+        } DwrfExprCacheStats;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param cache (out) Empty cache, release with dwarf_expr_cache_destroy().
+         * @return Error code
+         * @note The context must outlive the cache.
+         */
+        DwrfResult dwarf_expr_cache_create(DwrfCtx *ctx, DwrfExprCache **cache);
+
+        /**
+         * @param cache Cache to release along with every expression it returned, NULL has no effect.
+         */
+        void dwarf_expr_cache_destroy(DwrfExprCache *cache);
+
+        /**
+         * @param cache Expression cache.
+         * @param cur Cursor in the unit of the expression, NULL for expressions outside units (call frame rules).
+         * @param expr Bytes of the expression, in a section of the context (a location list entry, a rule
+         *             of dwarf_cfi_find()...) since the cache is keyed by their address.
+         * @param len Size of the expression.
+         * @param out (out) Compiled expression, owned by the cache.
+         * @return Error code, DWRF_UNSUPPORTED for operations this implementation doesn't handle
+         * (DW_OP_GNU_parameter_ref, DW_OP_GNU_variable_value, DW_OP_entry_value of anything but a register,
+         * 16-byte base types, location lists called with DW_OP_call*).
+         */
+        DwrfResult dwarf_expr_compile(DwrfExprCache *cache, DwrfCursor *cur, const uint8_t *expr, uint64_t len,
+                                      const DwrfExpr **out);
+
+        /**
+         * @param cache Expression cache.
+         * @param cur Cursor in the unit the attribute was read from.
+         * @param attr Single location description (DW_FORM_exprloc, or a block form before DWARF 4).
+         * @param out (out) Compiled expression, owned by the cache.
+         * @return Error code, DWRF_BAD_ARG if the attribute isn't an expression (location lists go through
+         * dwarf_list_locations() first).
+         */
+        DwrfResult dwarf_expr_compile_attr(DwrfExprCache *cache, DwrfCursor *cur, const DwrfAttr *attr,
+                                           const DwrfExpr **out);
+
+        /**
+         * @param expr Compiled expression.
+         * @param env Target state, may be NULL for expressions that don't read it.
+         * @param pieces (out) Array receiving the first "max" pieces of the location, may be NULL if max is 0.
+         * @param max Size of "pieces".
+         * @param count (out) Number of pieces, 1 unless the location is composite (DW_OP_piece).
+         * @return Error code, DWRF_BUFFER_OVERFLOW if count exceeds max, DWRF_DECODE_ERR for invalid expressions
+         * (stack underflow, division by zero, mismatched types...), DWRF_UNSUPPORTED for address spaces
+         * (DW_OP_xderef*).
+         * @brief Runs the expression. An empty expression gives a single DWRF_LOC_EMPTY piece.
+         */
+        DwrfResult dwarf_expr_eval(const DwrfExpr *expr, const DwrfExprEnv *env, DwrfLocPiece *pieces, uint32_t max,
+                                   uint32_t *count);
+
+        /**
+         * @param cache Expression cache.
+         * @param stats (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_expr_cache_stats(const DwrfExprCache *cache, DwrfExprCacheStats *stats);
+
+/***************
+ *  Parallel   *
+ ***************/
+        /**
+         * @brief Per-thread bump allocator handed to the callbacks of dwarf_for_each_cu_parallel().
+         * Memory is released all at once when the call returns.
+         */
+        typedef struct DwrfArena DwrfArena;
+
+        /**
+         * @param arena Arena received by the callback.
+         * @param size Bytes to allocate.
+         * @return Memory aligned for any type, NULL on failure.
+         */
+        void *dwarf_arena_alloc(DwrfArena *arena, size_t size);
+
+        /**
+         * @brief Parses one unit on a worker thread.
+         * @param ctx Private copy of the context for the thread, valid for the duration of the call. Cursors,
+         *            dwarf_cursor_resolve() and dwarf_line_table_unit() can be used on it, dwarf_destroy() must not.
+         * @param unit Unit to parse.
+         * @param arena Arena of the thread, where the result should be allocated.
+         * @param user User pointer given to dwarf_for_each_cu_parallel().
+         * @param result (out) Result of the unit handed to the merge callback, NULL by default.
+         * @return Error code, any error stops the walk.
+         */
+        typedef DwrfResult (*DwrfUnitFn)(DwrfCtx *ctx, const DwrfUnitHeader *unit, DwrfArena *arena, void *user,
+                                         void **result);
+
+        /**
+         * @brief Receives the result of every unit on the calling thread, in .debug_info order.
+         * @return Error code, any error stops the merge.
+         */
+        typedef DwrfResult (*DwrfUnitMergeFn)(void *user, const DwrfUnitHeader *unit, void *result);
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param threads Number of threads, 0 for one per CPU.
+         * @param fn Called once per unit of .debug_info, from any thread.
+         * @param merge Called with the results once every unit has been parsed, may be NULL.
+         * @param user Passed to both callbacks.
+         * @return Error code, the error of the first failing unit (in .debug_info order) if any.
+         * @brief Parses the units of .debug_info in parallel and merges their results deterministically.
+         *
+         * The unit headers are collected in one serial pass, the shared state the cursors need (sections,
+         * abbreviation tables, unit bases) is loaded up front and the units are spread over a work-stealing
+         * pool. The merge order doesn't depend on the number of threads or on scheduling.
+         */
+        DwrfResult dwarf_for_each_cu_parallel(DwrfCtx *ctx, uint32_t threads, DwrfUnitFn fn, DwrfUnitMergeFn merge,
+                                              void *user);
+
+/***************
+ *    Stats    *
+ ***************/
+        /**
+         * @brief Counters of the work done by the context, intended for profiling and benchmarks.
+         */
+        typedef struct
+        {
+                uint64_t AbbrevTables;  // Abbreviation tables parsed (cache misses)
+                uint64_t Abbrevs;       // Abbreviation declarations parsed
+                uint64_t AbbrevHits;    // Abbreviation table lookups served by the cache
+                uint64_t DiesSkipped;   // DIEs walked over without decoding attributes
+        } DwrfStats;
+
+        /**
+         * @param ctx DWARF context, initialized with dwarf_init().
+         * @param stats (out) User allocated struct to be filled.
+         * @return Error code
+         */
+        DwrfResult dwarf_get_stats(const DwrfCtx *ctx, DwrfStats *stats);
+
 #endif //include guard;
\ No newline at end of file
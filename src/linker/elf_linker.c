@@ -0,0 +1,1973 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(ELFL_NO_THREADS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // pthreads and sysconf
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "common/elf_core.h"
+#include "common/elf_repr.h"
+#include "common/elf_common.h"
+#include "reader/elf_reader.h"
+#include "elf_linker.h"
+#include "elf_reloc.h"
+
+#ifndef ELFL_NO_THREADS
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+typedef atomic_uint_fast64_t ElflAtomic;
+#else
+typedef uint64_t ElflAtomic;
+#endif
+
+#define NO_INDEX            UINT32_MAX
+#define ELFL_BATCH          4096        // symbols and relocations decoded per reader call
+#define ELFL_MAX_WORKERS    256
+#define ELFL_MAX_OUTPUTS    64
+#define ELFL_MAX_INPUTS     (1u << 30)  // the owner keys of the global table hold 30 bits
+#define ELFL_PREFETCH       16          // slots of the global table requested ahead of their use
+#define ELFL_GROUP          64          // inputs laid out together by a worker before the groups are placed
+#define ELFL_WINDOW         4096        // bytes of a section read and relocated together
+#define ELFL_WINDOW_SLACK   16          // for the relocations at one offset, which stay in one window
+
+#if defined(__GNUC__)
+#define elfl_prefetch(p) __builtin_prefetch(p)
+#else
+#define elfl_prefetch(p) ((void)(p))
+#endif
+
+/*
+ * Atomics, plain memory accesses without threads.
+ */
+
+static inline uint64_t load64(ElflAtomic *p)
+{
+#ifndef ELFL_NO_THREADS
+        return atomic_load(p);
+#else
+        return *p;
+#endif
+}
+
+static inline void store64(ElflAtomic *p, uint64_t v)
+{
+#ifndef ELFL_NO_THREADS
+        atomic_store(p, v);
+#else
+        *p = v;
+#endif
+}
+
+static inline uint64_t fetch_add64(ElflAtomic *p, uint64_t v)
+{
+#ifndef ELFL_NO_THREADS
+        return atomic_fetch_add(p, v);
+#else
+        uint64_t old = *p;
+        *p += v;
+        return old;
+#endif
+}
+
+static inline uint64_t fetch_or64(ElflAtomic *p, uint64_t v)
+{
+#ifndef ELFL_NO_THREADS
+        return atomic_fetch_or(p, v);
+#else
+        uint64_t old = *p;
+        *p |= v;
+        return old;
+#endif
+}
+
+static inline bool cas64(ElflAtomic *p, uint64_t *expected, uint64_t desired)
+{
+#ifndef ELFL_NO_THREADS
+        uint_fast64_t e = *expected;
+        bool ok = atomic_compare_exchange_strong(p, &e, desired);
+        *expected = e;
+        return ok;
+#else
+        if (*p != *expected)
+        {
+                *expected = *p;
+                return false;
+        }
+        *p = desired;
+        return true;
+#endif
+}
+
+static inline uint64_t align_up(uint64_t value, uint64_t align)
+{
+        return (value + align - 1) & ~(align - 1);
+}
+
+static inline int is_pow2(uint64_t v)
+{
+        return (v != 0) && ((v & (v - 1)) == 0);
+}
+
+static uint64_t now_ns(void)
+{
+        struct timespec ts;
+
+        if (timespec_get(&ts, TIME_UTC) != TIME_UTC)
+                return 0;
+        return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/***************
+ *    Types    *
+ ***************/
+
+/* Symbol of an input, what resolution and relocation need of it */
+typedef struct
+{
+        uint64_t Value;         // offset in the block of common symbols once they are allocated
+        uint32_t Sec;           // SHN_XINDEX resolved, SHN_UNDEF, SHN_ABS or SHN_COMMON
+        uint32_t Slot;          // in the global table, NO_INDEX for local symbols
+} InSym;
+
+/* Relocated bytes, laid over the section data while it is written */
+typedef struct
+{
+        uint32_t Offset;        // in the input section
+        uint32_t Size;
+        uint8_t Bytes[8];       // file byte order
+} Patch;
+
+typedef struct Input Input;
+
+/* Input section linked into an output section */
+typedef struct
+{
+        Input *In;              // NULL for the block of common symbols
+        uint32_t Sec;
+        uint32_t Out;
+        uint32_t Rel;           // relocation section patching it, 0 for none
+        uint32_t PatchCount;
+        uint64_t Size;
+        uint64_t Align;         // of the chunk, the first member of an input gets the alignment of its share
+        uint64_t Offset;        // in the input's share of the output section, then in the output section
+        uint64_t Address;
+        Patch *Patches;
+} Member;
+
+struct Input
+{
+        ElfCtx Elf;
+        const char *Name;
+        uint32_t Index;
+
+        ElfSecHeader *Headers;
+        uint32_t SecCount;
+        char *SecNames;
+        uint64_t SecNamesSize;
+
+        uint32_t SymTab;        // 0 without symbols
+        uint32_t SymCount;
+        uint32_t FirstGlobal;
+        InSym *Syms;
+        char *Strtab;
+        uint64_t StrtabSize;
+
+        uint32_t *SecMember;    // member of each section, NO_INDEX if it isn't linked
+        Member *Members;
+        uint32_t MemberCount;
+
+        uint64_t *OutSize;      // the input's share of each output section
+        uint64_t *OutAlign;
+        uint64_t *OutBase;      // offset of the share in the output section
+
+        /* first problem found with the symbols, reported in input order */
+        ElfResult SymError;
+        uint32_t SymErrorIdx;
+
+        /* globals defined here, in the output symbol table */
+        uint64_t *Owned;        // bit per symbol
+        uint32_t OutSyms;
+        uint64_t OutNames;
+        uint32_t OutSymFirst;
+        uint64_t OutNameFirst;
+};
+
+/* Global symbol: the name and the best definition seen so far */
+typedef struct
+{
+        ElflAtomic Hash;        // 0 while the slot is free
+        ElflAtomic Name;        // const char *, set right after Hash, readers wait for it
+        ElflAtomic Owner;       // see owner_key()
+        ElflAtomic Flags;       // SLOT_*
+} GlobalSym;
+
+#define SLOT_STRONG_REF  1u     // referenced by an undefined symbol that isn't weak
+#define SLOT_DUPLICATE   2u     // defined by two strong symbols
+
+enum
+{
+        RANK_UNDEF,
+        RANK_WEAK,
+        RANK_COMMON,
+        RANK_STRONG,
+};
+
+/* Output section, one per distinct name of the rules */
+typedef struct
+{
+        const char *Name;
+        uint64_t Flags;
+        ElfSectionType Type;    // SHT_NOBITS while all its members are
+        uint64_t Size;
+        uint64_t Align;
+        uint64_t Address;
+        uint64_t Members;
+        sec_hndl Sec;
+} OutSec;
+
+struct ElflCtx
+{
+        ElflLinkInfo Info;
+        EiClass Class;
+        EiData Data;
+        uint32_t Flags;         // e_flags of the first input (RISC-V float ABI and RVC)
+        uint32_t Workers;
+
+        Input **Inputs;
+        uint32_t InputCount;
+        uint32_t InputCap;
+
+        const ElflSectionRule *Rules;
+        uint32_t RuleCount;
+        uint32_t RuleOut[ELFL_MAX_OUTPUTS * 4];
+        OutSec Outs[ELFL_MAX_OUTPUTS];
+        uint32_t OutCount;
+        uint32_t Order[ELFL_MAX_OUTPUTS];       // outputs in file order
+
+        GlobalSym *Table;
+        uint64_t TableMask;
+
+        Member Common;          // block of the common symbols
+        uint64_t CommonAlign;
+
+        Member **Jobs;          // members with relocations, by output section
+        uint64_t JobCount;
+
+        uint8_t *SymtabData;
+        char *StrtabData;
+
+        ElflAtomic Failed;
+        ElflAtomic Relocations;
+        char Error[512];
+        ElflStats Stats;
+};
+
+static const ElflSectionRule default_rules[] = {
+        { ".text",   ".text",     0 },
+        { ".text",   ".text.*",   0 },
+        { ".rodata", ".rodata",   0 },
+        { ".rodata", ".rodata.*", 0 },
+        { ".data",   ".data",     0 },
+        { ".data",   ".data.*",   0 },
+        { ".bss",    ".bss",      0 },
+        { ".bss",    ".bss.*",    0 },
+        { ".bss",    "COMMON",    0 },
+        { ".text",   "*",         SHF_EXECINSTR },
+        { ".data",   "*",         SHF_WRITE },
+        { ".rodata", "*",         0 },
+};
+
+/** Records the first error of the link, the later ones are dropped. */
+static void link_error(ElflCtx *ctx, ElfResult code, const char *fmt, ...)
+{
+        uint64_t expected = ELF_OK;
+        va_list ap;
+
+        if (!cas64(&ctx->Failed, &expected, (uint64_t)code))
+                return;
+
+        va_start(ap, fmt);
+        vsnprintf(ctx->Error, sizeof(ctx->Error), fmt, ap);
+        va_end(ap);
+}
+
+static inline bool link_failed(ElflCtx *ctx)
+{
+        return load64(&ctx->Failed) != ELF_OK;
+}
+
+/***************
+ *    Jobs     *
+ ***************/
+
+typedef void (*ElflJobFn)(ElflCtx *ctx, void *arg, uint64_t job);
+
+typedef struct
+{
+        ElflCtx *ctx;
+        ElflJobFn fn;
+        void *arg;
+        uint64_t count;
+        ElflAtomic next;
+} ElflJobs;
+
+/** Runs jobs one at a time until they are all taken or the link failed, run by every thread. */
+static void *job_worker(void *arg)
+{
+        ElflJobs *jobs = arg;
+        uint64_t job;
+
+        while (((job = fetch_add64(&jobs->next, 1)) < jobs->count) && !link_failed(jobs->ctx))
+                jobs->fn(jobs->ctx, jobs->arg, job);
+        return NULL;
+}
+
+static void run_jobs(ElflCtx *ctx, uint64_t count, ElflJobFn fn, void *arg)
+{
+        ElflJobs jobs = { ctx, fn, arg, count, 0 };
+        uint32_t workers = (ctx->Workers < count) ? ctx->Workers : (uint32_t)count;
+
+#ifndef ELFL_NO_THREADS
+        pthread_t tids[ELFL_MAX_WORKERS];
+        uint32_t n = 0;
+
+        /* the calling thread works too, the jobs of a thread that fails to start are taken by the others */
+        for (uint32_t i = 1; i < workers; i++)
+        {
+                if (pthread_create(&tids[n], NULL, job_worker, &jobs) == 0)
+                        n++;
+        }
+        job_worker(&jobs);
+        for (uint32_t i = 0; i < n; i++)
+                pthread_join(tids[i], NULL);
+#else
+        (void)workers;
+        job_worker(&jobs);
+#endif
+}
+
+/***************
+ *   Context   *
+ ***************/
+
+ElfResult elfl_create(const ElflLinkInfo *info, ElflCtx **ctx)
+{
+        ElflCtx *c;
+
+        if ((info == NULL) || (ctx == NULL))
+                return ELF_BAD_ARG;
+
+        if ((info->PageSize != 0) && !is_pow2(info->PageSize))
+                return ELF_BAD_ARG;
+
+        if ((info->Rules != NULL) && ((info->RuleCount == 0) || (info->RuleCount > ELFL_MAX_OUTPUTS * 4)))
+                return ELF_BAD_ARG;
+
+        if ((c = calloc(1, sizeof(*c))) == NULL)
+                return ELF_NO_MEM;
+
+        c->Info = *info;
+        if (c->Info.BaseAddress == 0)
+                c->Info.BaseAddress = 0x400000;
+        if (c->Info.PageSize == 0)
+                c->Info.PageSize = 0x1000;
+        if (c->Info.Entry == NULL)
+                c->Info.Entry = "_start";
+
+        c->Rules = (info->Rules != NULL) ? info->Rules : default_rules;
+        c->RuleCount = (info->Rules != NULL) ? info->RuleCount : sizeof(default_rules) / sizeof(default_rules[0]);
+
+        /* one output section per distinct name, in order of first appearance */
+        for (uint32_t r = 0; r < c->RuleCount; r++)
+        {
+                uint32_t o = 0;
+
+                if ((c->Rules[r].Output == NULL) || (c->Rules[r].Input == NULL))
+                {
+                        free(c);
+                        return ELF_BAD_ARG;
+                }
+
+                while ((o < c->OutCount) && (strcmp(c->Outs[o].Name, c->Rules[r].Output) != 0))
+                        o++;
+                if (o == c->OutCount)
+                {
+                        if (o == ELFL_MAX_OUTPUTS)
+                        {
+                                free(c);
+                                return ELF_BAD_ARG;
+                        }
+                        c->Outs[o].Name = c->Rules[r].Output;
+                        c->Outs[o].Type = SHT_NOBITS;
+                        c->Outs[o].Align = 1;
+                        c->OutCount++;
+                }
+                c->RuleOut[r] = o;
+        }
+
+#ifndef ELFL_NO_THREADS
+        if (c->Info.Threads == 0)
+        {
+                long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                c->Info.Threads = (cpus > 0) ? (uint32_t)cpus : 1;
+        }
+        c->Workers = (c->Info.Threads > ELFL_MAX_WORKERS) ? ELFL_MAX_WORKERS : c->Info.Threads;
+#else
+        c->Workers = 1;
+#endif
+
+        c->Common.Sec = NO_INDEX;
+        c->Common.Out = NO_INDEX;
+        c->CommonAlign = 1;
+
+        *ctx = c;
+        return ELF_OK;
+}
+
+static void input_destroy(Input *in)
+{
+        if (in == NULL)
+                return;
+
+        for (uint32_t m = 0; m < in->MemberCount; m++)
+                free(in->Members[m].Patches);
+
+        free(in->Headers);
+        free(in->SecNames);
+        free(in->Syms);
+        free(in->Owned);
+        free(in->Strtab);
+        free(in->SecMember);
+        free(in->Members);
+        free(in->OutSize);
+        free(in);
+}
+
+void elfl_destroy(ElflCtx *ctx)
+{
+        if (ctx == NULL)
+                return;
+
+        for (uint32_t i = 0; i < ctx->InputCount; i++)
+                input_destroy(ctx->Inputs[i]);
+
+        free(ctx->Inputs);
+        free(ctx->Table);
+        free(ctx->Jobs);
+        free(ctx->SymtabData);
+        free(ctx->StrtabData);
+        free(ctx);
+}
+
+ElfResult elfl_add_input(ElflCtx *ctx, const ElfCtx *input, const char *name)
+{
+        ElfHeader hdr;
+        ElfResult res;
+        Input *in;
+
+        if (ctx == NULL)
+                return ELF_UNINIT;
+
+        if ((input == NULL) || (name == NULL))
+                return ELF_BAD_ARG;
+
+        if ((res = get_header(input, &hdr)) != ELF_OK)
+                return res;
+
+        if ((hdr.Type != ET_REL) || (hdr.Machine != ctx->Info.Machine))
+                return ELF_BAD_HEADER;
+
+        if (ctx->InputCount == 0)
+        {
+                ctx->Class = hdr.EI_Class;
+                ctx->Data = hdr.EI_Data;
+                ctx->Flags = hdr.Flags;
+        }
+        else if (hdr.EI_Class != ctx->Class)
+        {
+                return ELF_BAD_CLASS;
+        }
+        else if (hdr.EI_Data != ctx->Data)
+        {
+                return ELF_BAD_ENDIANNESS;
+        }
+
+        if (ctx->InputCount == ELFL_MAX_INPUTS)
+                return ELF_BAD_INDX;
+
+        if (ctx->InputCount == ctx->InputCap)
+        {
+                uint32_t cap = ctx->InputCap ? ctx->InputCap * 2 : 64;
+                Input **inputs = realloc(ctx->Inputs, (size_t)cap * sizeof(*inputs));
+                if (inputs == NULL)
+                        return ELF_NO_MEM;
+                ctx->Inputs = inputs;
+                ctx->InputCap = cap;
+        }
+
+        if ((in = calloc(1, sizeof(*in))) == NULL)
+                return ELF_NO_MEM;
+
+        in->Elf = *input;
+        in->Name = name;
+        in->Index = ctx->InputCount;
+        ctx->Inputs[ctx->InputCount++] = in;
+        return ELF_OK;
+}
+
+const char *elfl_error(const ElflCtx *ctx)
+{
+        return (ctx != NULL) ? ctx->Error : "";
+}
+
+void elfl_get_stats(const ElflCtx *ctx, ElflStats *stats)
+{
+        if ((ctx != NULL) && (stats != NULL))
+                *stats = ctx->Stats;
+}
+
+/***************
+ *    Load     *
+ ***************/
+
+static inline uint32_t file_32(uint32_t v, EiData data)
+{
+        return (data != host_endianness()) ? swap32(v) : v;
+}
+
+/** Reads a whole section and terminates it with a NUL so that its strings are always bounded. */
+static ElfResult read_table(const Input *in, const ElfSecHeader *sh, char **out, uint64_t *size)
+{
+        ElfResult res;
+
+        if ((sh->Type == SHT_NOBITS) || (sh->Size > SIZE_MAX - 1))
+                return ELF_BAD_FORMAT;
+
+        if ((*out = malloc((size_t)sh->Size + 1)) == NULL)
+                return ELF_NO_MEM;
+
+        res = get_section_data(&in->Elf, sh, 0, sh->Size, *out);
+        (*out)[sh->Size] = '\0';
+        *size = sh->Size;
+        return res;
+}
+
+static const char *section_name(const Input *in, uint32_t sec)
+{
+        uint32_t idx = in->Headers[sec].NameIdx;
+
+        return (idx < in->SecNamesSize) ? in->SecNames + idx : "";
+}
+
+static bool rule_match(const ElflSectionRule *rule, const char *name, uint64_t flags)
+{
+        size_t len = strlen(rule->Input);
+
+        if ((flags & rule->Flags) != rule->Flags)
+                return false;
+
+        if ((len != 0) && (rule->Input[len - 1] == '*'))
+                return strncmp(name, rule->Input, len - 1) == 0;
+
+        return strcmp(name, rule->Input) == 0;
+}
+
+/** Output section of an allocated input section, NO_INDEX if no rule takes it. */
+static uint32_t map_section(const ElflCtx *ctx, const char *name, uint64_t flags)
+{
+        for (uint32_t r = 0; r < ctx->RuleCount; r++)
+        {
+                if (rule_match(&ctx->Rules[r], name, flags))
+                        return ctx->RuleOut[r];
+        }
+        return NO_INDEX;
+}
+
+/* Section headers, names and section mapping of one input */
+static void load_input(ElflCtx *ctx, void *arg, uint64_t job)
+{
+        Input *in = ctx->Inputs[job];
+        ElfHeader hdr;
+        ElfResult res;
+        uint32_t n;
+        (void)arg;
+
+        if ((res = get_header(&in->Elf, &hdr)) != ELF_OK)
+                goto fail;
+
+        n = get_section_count(&in->Elf);
+        in->SecCount = n;
+        in->Headers = malloc(((size_t)n + 1) * sizeof(ElfSecHeader));
+        in->SecMember = malloc(((size_t)n + 1) * sizeof(uint32_t));
+        in->OutSize = calloc((size_t)ctx->OutCount * 3, sizeof(uint64_t));
+        if ((in->Headers == NULL) || (in->SecMember == NULL) || (in->OutSize == NULL))
+        {
+                res = ELF_NO_MEM;
+                goto fail;
+        }
+        in->OutAlign = in->OutSize + ctx->OutCount;
+        in->OutBase = in->OutAlign + ctx->OutCount;
+
+        if ((res = get_section_headers(&in->Elf, 0, n, in->Headers)) != ELF_OK)
+                goto fail;
+
+        if ((hdr.SecStrIndx == SHN_UNDEF) || (hdr.SecStrIndx >= n))
+        {
+                res = ELF_BAD_INDX;
+                goto fail;
+        }
+        if ((res = read_table(in, &in->Headers[hdr.SecStrIndx], &in->SecNames, &in->SecNamesSize)) != ELF_OK)
+                goto fail;
+
+        /* members, in section order */
+        in->MemberCount = 0;
+        for (uint32_t s = 0; s < n; s++)
+        {
+                const ElfSecHeader *sh = &in->Headers[s];
+
+                in->SecMember[s] = NO_INDEX;
+                if ((s == 0) || !(sh->Flags & SHF_ALLOC) || (sh->Type == SHT_NULL) || (sh->Type == SHT_REL) ||
+                    (sh->Type == SHT_RELA) || (sh->Type == SHT_GROUP))
+                        continue;
+
+                if (sh->Type == SHT_SYMTAB)
+                        continue;
+                in->SecMember[s] = in->MemberCount++;
+        }
+
+        if ((in->Members = calloc((size_t)in->MemberCount + 1, sizeof(Member))) == NULL)
+        {
+                res = ELF_NO_MEM;
+                goto fail;
+        }
+
+        for (uint32_t s = 0; s < n; s++)
+        {
+                const ElfSecHeader *sh = &in->Headers[s];
+                Member *m;
+
+                if (in->SecMember[s] == NO_INDEX)
+                        continue;
+
+                m = &in->Members[in->SecMember[s]];
+                m->In = in;
+                m->Sec = s;
+                m->Size = sh->Size;
+                m->Align = (sh->Alignment > 1) ? sh->Alignment : 1;
+                m->Out = map_section(ctx, section_name(in, s), sh->Flags);
+
+                if (m->Out == NO_INDEX)
+                {
+                        link_error(ctx, ELF_BAD_FORMAT, "%s: no rule takes section %s", in->Name, section_name(in, s));
+                        return;
+                }
+                if (sh->Flags & SHF_TLS)
+                {
+                        link_error(ctx, ELF_BAD_FORMAT, "%s: section %s: TLS isn't supported", in->Name, section_name(in, s));
+                        return;
+                }
+                if (!is_pow2(m->Align) || (sh->Size > UINT32_MAX))
+                {
+                        link_error(ctx, ELF_BAD_FORMAT, "%s: section %s: bad size or alignment", in->Name, section_name(in, s));
+                        return;
+                }
+        }
+
+        /* relocation sections of the linked sections, the others go with their targets */
+        for (uint32_t s = 1; s < n; s++)
+        {
+                const ElfSecHeader *sh = &in->Headers[s];
+
+                if (sh->Type == SHT_SYMTAB)
+                        in->SymTab = s;
+
+                if (((sh->Type == SHT_REL) || (sh->Type == SHT_RELA)) && (sh->Info < n) && (in->SecMember[sh->Info] != NO_INDEX))
+                        in->Members[in->SecMember[sh->Info]].Rel = s;
+        }
+
+        if (in->SymTab != 0)
+        {
+                const ElfSecHeader *st = &in->Headers[in->SymTab];
+
+                in->SymCount = get_symbol_count(&in->Elf, st);
+                in->FirstGlobal = (st->Info < in->SymCount) ? st->Info : in->SymCount;
+        }
+        return;
+
+fail:
+        link_error(ctx, res, "%s: can't read the section headers (error %d)", in->Name, (int)res);
+}
+
+/***************
+ *   Resolve   *
+ ***************/
+
+static inline uint64_t owner_key(uint32_t rank, uint32_t input, uint32_t sym)
+{
+        /* the highest key wins: the best rank, then the first input */
+        return ((uint64_t)rank << 62) | ((uint64_t)(ELFL_MAX_INPUTS - 1 - input) << 32) | sym;
+}
+
+static inline uint32_t owner_rank(uint64_t key)
+{
+        return (uint32_t)(key >> 62);
+}
+
+static inline uint32_t owner_input(uint64_t key)
+{
+        return ELFL_MAX_INPUTS - 1 - (uint32_t)((key >> 32) & (ELFL_MAX_INPUTS - 1));
+}
+
+static inline uint32_t owner_sym(uint64_t key)
+{
+        return (uint32_t)key;
+}
+
+static uint64_t name_hash(const char *name)
+{
+        /* FNV-1a with a final mix, never 0 so that free slots stay recognizable */
+        uint64_t h = 0xcbf29ce484222325ULL;
+
+        for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+                h = (h ^ *p) * 0x100000001b3ULL;
+
+        h ^= h >> 32;
+        return h | 1;
+}
+
+/** Slot of a name, taken if it is new. Lock free: a slot is claimed with a CAS on its hash. */
+static uint32_t table_slot(ElflCtx *ctx, const char *name, uint64_t h)
+{
+        for (uint64_t i = h & ctx->TableMask;; i = (i + 1) & ctx->TableMask)
+        {
+                GlobalSym *g = &ctx->Table[i];
+                uint64_t cur = load64(&g->Hash);
+
+                if (cur == 0)
+                {
+                        if (cas64(&g->Hash, &cur, h))
+                        {
+                                store64(&g->Name, (uint64_t)(uintptr_t)name);
+                                return (uint32_t)i;
+                        }
+                }
+
+                if (cur == h)
+                {
+                        const char *other;
+
+                        /* the claiming thread publishes the name right after the hash */
+                        while ((other = (const char *)(uintptr_t)load64(&g->Name)) == NULL)
+                                ;
+                        if (strcmp(other, name) == 0)
+                                return (uint32_t)i;
+                }
+        }
+}
+
+/** Slot of a name if it is in the table, NO_INDEX otherwise. Only after resolution. */
+static uint32_t table_find(const ElflCtx *ctx, const char *name)
+{
+        uint64_t h = name_hash(name);
+
+        for (uint64_t i = h & ctx->TableMask;; i = (i + 1) & ctx->TableMask)
+        {
+                const GlobalSym *g = &ctx->Table[i];
+
+                if (g->Hash == 0)
+                        return NO_INDEX;
+                if ((g->Hash == h) && (strcmp((const char *)(uintptr_t)g->Name, name) == 0))
+                        return (uint32_t)i;
+        }
+}
+
+static void table_offer(ElflCtx *ctx, uint32_t slot, uint64_t key, bool strong_ref)
+{
+        GlobalSym *g = &ctx->Table[slot];
+        uint64_t cur = load64(&g->Owner);
+
+        while ((key > cur) && !cas64(&g->Owner, &cur, key))
+                ;
+
+        /* cur is the owner the key was compared with, a strong one on either side makes a duplicate */
+        if ((owner_rank(key) == RANK_STRONG) && (owner_rank(cur) == RANK_STRONG) && (cur != key))
+                fetch_or64(&g->Flags, SLOT_DUPLICATE);
+
+        if (strong_ref)
+                fetch_or64(&g->Flags, SLOT_STRONG_REF);
+}
+
+/* Reads the symbols of one input and offers its globals to the table */
+static void resolve_input(ElflCtx *ctx, void *arg, uint64_t job)
+{
+        Input *in = ctx->Inputs[job];
+        ElfSymTabEntry batch[ELFL_BATCH];
+        uint64_t hashes[ELFL_BATCH];
+        uint8_t ranks[ELFL_BATCH];
+        const ElfSecHeader *st;
+        uint32_t *shndx = NULL;
+        ElfResult res;
+        (void)arg;
+
+        if (in->SymTab == 0)
+                return;
+
+        st = &in->Headers[in->SymTab];
+        if ((st->Link == 0) || (st->Link >= in->SecCount) ||
+            ((res = read_table(in, &in->Headers[st->Link], &in->Strtab, &in->StrtabSize)) != ELF_OK))
+        {
+                link_error(ctx, ELF_BAD_FORMAT, "%s: bad symbol string table", in->Name);
+                return;
+        }
+
+        /* section indexes that don't fit st_shndx */
+        for (uint32_t s = 1; s < in->SecCount; s++)
+        {
+                const ElfSecHeader *sh = &in->Headers[s];
+
+                if ((sh->Type == SHT_SYMTAB_SHNDX) && (sh->Link == in->SymTab))
+                {
+                        if ((sh->Size / 4 < in->SymCount) || ((shndx = malloc((size_t)sh->Size)) == NULL) ||
+                            (get_section_data(&in->Elf, sh, 0, sh->Size, shndx) != ELF_OK))
+                        {
+                                free(shndx);
+                                link_error(ctx, ELF_BAD_FORMAT, "%s: bad extended section indexes", in->Name);
+                                return;
+                        }
+                }
+        }
+
+        in->Syms = malloc(((size_t)in->SymCount + 1) * sizeof(InSym));
+        in->Owned = calloc((size_t)in->SymCount / 64 + 1, sizeof(uint64_t));
+        if ((in->Syms == NULL) || (in->Owned == NULL))
+        {
+                free(shndx);
+                link_error(ctx, ELF_NO_MEM, "out of memory");
+                return;
+        }
+
+        for (uint32_t first = 0; first < in->SymCount; first += ELFL_BATCH)
+        {
+                uint32_t count = (in->SymCount - first < ELFL_BATCH) ? in->SymCount - first : ELFL_BATCH;
+
+                if ((res = get_symbol_entries(&in->Elf, st, first, count, batch)) != ELF_OK)
+                {
+                        link_error(ctx, res, "%s: can't read the symbols (error %d)", in->Name, (int)res);
+                        break;
+                }
+
+                for (uint32_t i = 0; i < count; i++)
+                {
+                        const ElfSymTabEntry *e = &batch[i];
+                        uint32_t k = first + i;
+                        InSym *s = &in->Syms[k];
+
+                        hashes[i] = 0;
+                        s->Value = e->Value;
+                        s->Sec = (uint32_t)e->SecIdx;
+                        s->Slot = NO_INDEX;
+
+                        if (s->Sec == SHN_XINDEX)
+                                s->Sec = shndx ? file_32(shndx[k], ctx->Data) : SHN_UNDEF;
+                        else if ((s->Sec >= SHN_LORESERVE) && (s->Sec != SHN_ABS) && (s->Sec != SHN_COMMON))
+                                s->Sec = SHN_ABS;
+
+                        if ((s->Sec != SHN_ABS) && (s->Sec != SHN_COMMON) && (s->Sec >= in->SecCount))
+                        {
+                                link_error(ctx, ELF_BAD_FORMAT, "%s: symbol %u has a bad section index", in->Name, k);
+                                s->Sec = SHN_UNDEF;
+                        }
+
+                        if ((e->Binding == STB_LOCAL) || (k == 0) || (e->NameIdx >= in->StrtabSize) ||
+                            (in->Strtab[e->NameIdx] == '\0'))
+                                continue;
+
+                        if (s->Sec == SHN_UNDEF)
+                                ranks[i] = RANK_UNDEF;
+                        else if (e->Binding == STB_WEAK)
+                                ranks[i] = RANK_WEAK;
+                        else if (s->Sec == SHN_COMMON)
+                                ranks[i] = RANK_COMMON;
+                        else
+                                ranks[i] = RANK_STRONG;
+                        hashes[i] = name_hash(in->Strtab + e->NameIdx);
+                }
+
+                /* the slots are random accesses to a large table, they are requested ahead of the inserts */
+                for (uint32_t i = 0; (i < ELFL_PREFETCH) && (i < count); i++)
+                        elfl_prefetch(&ctx->Table[hashes[i] & ctx->TableMask]);
+
+                for (uint32_t i = 0; i < count; i++)
+                {
+                        const ElfSymTabEntry *e = &batch[i];
+                        InSym *s = &in->Syms[first + i];
+
+                        if (i + ELFL_PREFETCH < count)
+                                elfl_prefetch(&ctx->Table[hashes[i + ELFL_PREFETCH] & ctx->TableMask]);
+                        if (hashes[i] == 0)
+                                continue;
+
+                        s->Slot = table_slot(ctx, in->Strtab + e->NameIdx, hashes[i]);
+                        table_offer(ctx, s->Slot, owner_key(ranks[i], in->Index, first + i),
+                                    (ranks[i] == RANK_UNDEF) && (e->Binding != STB_WEAK));
+                }
+        }
+        free(shndx);
+}
+
+/** True if symbol k of an input is the definition that goes into the output symbol table. */
+static bool owns_symbol(const ElflCtx *ctx, const Input *in, uint32_t k)
+{
+        const InSym *s = &in->Syms[k];
+        uint64_t owner;
+
+        if (s->Slot == NO_INDEX)
+                return false;
+
+        owner = ctx->Table[s->Slot].Owner;
+        if ((owner_input(owner) != in->Index) || (owner_sym(owner) != k) || (owner_rank(owner) == RANK_UNDEF))
+                return false;
+
+        /* definitions in sections that aren't linked, like debug sections, are left out */
+        return (s->Sec == SHN_ABS) || (s->Sec == SHN_COMMON) || (in->SecMember[s->Sec] != NO_INDEX);
+}
+
+/* Finds the duplicate and undefined symbols of one input, counts the globals it owns */
+static void check_input(ElflCtx *ctx, void *arg, uint64_t job)
+{
+        Input *in = ctx->Inputs[job];
+        (void)arg;
+
+        in->SymError = ELF_OK;
+        in->OutSyms = 0;
+        in->OutNames = 0;
+
+        for (uint32_t k = in->FirstGlobal; (in->Syms != NULL) && (k < in->SymCount); k++)
+        {
+                const InSym *s = &in->Syms[k];
+                const GlobalSym *g;
+                uint64_t owner;
+
+                if ((k + ELFL_PREFETCH < in->SymCount) && (in->Syms[k + ELFL_PREFETCH].Slot != NO_INDEX))
+                        elfl_prefetch(&ctx->Table[in->Syms[k + ELFL_PREFETCH].Slot]);
+
+                if (s->Slot == NO_INDEX)
+                        continue;
+
+                g = &ctx->Table[s->Slot];
+                owner = g->Owner;
+
+                if (owns_symbol(ctx, in, k))
+                {
+                        in->Owned[k / 64] |= 1ULL << (k % 64);
+                        in->OutSyms++;
+                        in->OutNames += strlen((const char *)(uintptr_t)g->Name) + 1;
+                }
+                else if ((g->Flags & SLOT_DUPLICATE) && (owner != owner_key(RANK_STRONG, in->Index, k)) &&
+                         (s->Sec != SHN_UNDEF) && (s->Sec != SHN_COMMON) && (in->SymError == ELF_OK))
+                {
+                        /* a definition that lost against the owner, only a strong one is an error */
+                        ElfSymTabEntry e;
+
+                        if ((get_symbol_entry(&in->Elf, &in->Headers[in->SymTab], k, &e) == ELF_OK) &&
+                            (e.Binding != STB_WEAK))
+                        {
+                                in->SymError = ELF_BAD_FORMAT;
+                                in->SymErrorIdx = k;
+                        }
+                }
+
+                /* PIC objects name the GOT without using it once their GOT loads are relaxed */
+                if ((owner_rank(owner) == RANK_UNDEF) && (g->Flags & SLOT_STRONG_REF) && !ctx->Info.AllowUndefined &&
+                    (in->SymError == ELF_OK) && (owner_input(owner) == in->Index) && (owner_sym(owner) == k) &&
+                    (strcmp((const char *)(uintptr_t)g->Name, "_GLOBAL_OFFSET_TABLE_") != 0))
+                {
+                        in->SymError = ELF_NOT_FOUND;
+                        in->SymErrorIdx = k;
+                }
+        }
+}
+
+/** Reports the first symbol problem in input order, so the message doesn't depend on the threads. */
+static ElfResult report_symbols(ElflCtx *ctx)
+{
+        for (uint32_t i = 0; i < ctx->InputCount; i++)
+        {
+                const Input *in = ctx->Inputs[i];
+                const GlobalSym *g;
+
+                if (in->SymError == ELF_OK)
+                        continue;
+
+                g = &ctx->Table[in->Syms[in->SymErrorIdx].Slot];
+                if (in->SymError == ELF_NOT_FOUND)
+                        link_error(ctx, ELF_NOT_FOUND, "%s: undefined reference to %s", in->Name,
+                                   (const char *)(uintptr_t)g->Name);
+                else
+                        link_error(ctx, ELF_BAD_FORMAT, "%s: multiple definition of %s, first defined in %s", in->Name,
+                                   (const char *)(uintptr_t)g->Name, ctx->Inputs[owner_input(g->Owner)]->Name);
+                return in->SymError;
+        }
+        return ELF_OK;
+}
+
+/***************
+ *   Layout    *
+ ***************/
+
+/* Offsets of the members of one input in its share of each output section */
+static void layout_input(ElflCtx *ctx, void *arg, uint64_t job)
+{
+        Input *in = ctx->Inputs[job];
+        uint32_t first[ELFL_MAX_OUTPUTS];
+        (void)arg;
+
+        for (uint32_t o = 0; o < ctx->OutCount; o++)
+        {
+                in->OutSize[o] = 0;
+                in->OutAlign[o] = 1;
+                first[o] = NO_INDEX;
+        }
+
+        for (uint32_t i = 0; i < in->MemberCount; i++)
+        {
+                Member *m = &in->Members[i];
+                uint32_t o = m->Out;
+
+                m->Offset = align_up(in->OutSize[o], m->Align);
+                in->OutSize[o] = m->Offset + m->Size;
+                if (m->Align > in->OutAlign[o])
+                        in->OutAlign[o] = m->Align;
+                if (first[o] == NO_INDEX)
+                        first[o] = i;
+        }
+
+        /* the writer aligns the first chunk of the share like the share itself */
+        for (uint32_t o = 0; o < ctx->OutCount; o++)
+        {
+                if (first[o] != NO_INDEX)
+                        in->Members[first[o]].Align = in->OutAlign[o];
+        }
+}
+
+/*
+ * Shares of a group of inputs in each output section, laid out from offset 0. The group keeps the
+ * size and the largest alignment of its shares in arg, the offsets hold once the group is placed at
+ * a multiple of that alignment.
+ */
+static void layout_group(ElflCtx *ctx, void *arg, uint64_t job)
+{
+        uint64_t *size = (uint64_t *)arg + job * 2 * ctx->OutCount;
+        uint64_t *align = size + ctx->OutCount;
+        uint32_t lead[ELFL_MAX_OUTPUTS];
+        uint64_t first = job * ELFL_GROUP;
+        uint64_t end = (ctx->InputCount - first < ELFL_GROUP) ? ctx->InputCount : first + ELFL_GROUP;
+
+        for (uint32_t o = 0; o < ctx->OutCount; o++)
+        {
+                size[o] = 0;
+                align[o] = 1;
+                lead[o] = NO_INDEX;
+        }
+
+        for (uint64_t i = first; i < end; i++)
+        {
+                Input *in = ctx->Inputs[i];
+
+                for (uint32_t o = 0; o < ctx->OutCount; o++)
+                {
+                        if (in->OutSize[o] == 0 && in->OutAlign[o] == 1)
+                        {
+                                in->OutBase[o] = size[o];
+                                continue;
+                        }
+                        if (lead[o] == NO_INDEX)
+                                lead[o] = (uint32_t)i;
+                        in->OutBase[o] = align_up(size[o], in->OutAlign[o]);
+                        size[o] = in->OutBase[o] + in->OutSize[o];
+                        if (in->OutAlign[o] > align[o])
+                                align[o] = in->OutAlign[o];
+                }
+        }
+
+        /* the writer pads the first chunk of the group to the alignment the group is placed at */
+        for (uint32_t o = 0; o < ctx->OutCount; o++)
+        {
+                Input *in = (lead[o] != NO_INDEX) ? ctx->Inputs[lead[o]] : NULL;
+
+                for (uint32_t m = 0; (in != NULL) && (m < in->MemberCount); m++)
+                {
+                        if (in->Members[m].Out == o)
+                        {
+                                in->Members[m].Align = align[o];
+                                break;
+                        }
+                }
+        }
+}
+
+/* Final offsets and addresses of the members of one input, arg holds the offsets of the groups */
+static void place_input(ElflCtx *ctx, void *arg, uint64_t job)
+{
+        Input *in = ctx->Inputs[job];
+        const uint64_t *base = (const uint64_t *)arg + (job / ELFL_GROUP) * 2 * ctx->OutCount;
+
+        for (uint32_t o = 0; o < ctx->OutCount; o++)
+                in->OutBase[o] += base[o];
+
+        for (uint32_t i = 0; i < in->MemberCount; i++)
+        {
+                Member *m = &in->Members[i];
+
+                m->Offset += in->OutBase[m->Out];
+                m->Address = ctx->Outs[m->Out].Address + m->Offset;
+        }
+}
+
+/* Segment of an output section: code, read only data and writable data with .bss at its end */
+static uint32_t out_kind(const OutSec *out)
+{
+        if (out->Flags & SHF_EXECINSTR)
+                return 0;
+        if (!(out->Flags & SHF_WRITE))
+                return 1;
+        return (out->Type == SHT_NOBITS) ? 3 : 2;
+}
+
+static inline uint32_t segment_of(uint32_t kind)
+{
+        return (kind == 3) ? 2 : kind;
+}
+
+/** Allocates the common symbols won by their owners in input order, at the end of their output section. */
+static ElfResult layout_commons(ElflCtx *ctx)
+{
+        uint32_t out = map_section(ctx, "COMMON", SHF_ALLOC | SHF_WRITE);
+        uint64_t size = 0;
+
+        for (uint32_t i = 0; i < ctx->InputCount; i++)
+        {
+                Input *in = ctx->Inputs[i];
+
+                for (uint32_t k = in->FirstGlobal; (in->Syms != NULL) && (k < in->SymCount); k++)
+                {
+                        InSym *s = &in->Syms[k];
+                        ElfSymTabEntry e;
+                        uint64_t align;
+
+                        if ((s->Sec != SHN_COMMON) || (s->Slot == NO_INDEX) ||
+                            (ctx->Table[s->Slot].Owner != owner_key(RANK_COMMON, in->Index, k)))
+                                continue;
+
+                        if (out == NO_INDEX)
+                        {
+                                link_error(ctx, ELF_BAD_FORMAT, "%s: no rule takes the common symbols", in->Name);
+                                return ELF_BAD_FORMAT;
+                        }
+
+                        /* the value of a common symbol is its alignment */
+                        if (get_symbol_entry(&in->Elf, &in->Headers[in->SymTab], k, &e) != ELF_OK)
+                                return ELF_IO_ERROR;
+                        align = is_pow2(s->Value) ? s->Value : 1;
+
+                        size = align_up(size, align);
+                        s->Value = size;
+                        size += e.Size;
+                        if (align > ctx->CommonAlign)
+                                ctx->CommonAlign = align;
+                }
+        }
+
+        if (size != 0)
+        {
+                ctx->Common.Out = out;
+                ctx->Common.Size = size;
+                ctx->Common.Align = ctx->CommonAlign;
+        }
+        return ELF_OK;
+}
+
+static ElfResult layout(ElflCtx *ctx)
+{
+        uint64_t run[ELFL_MAX_OUTPUTS] = {0};
+        uint64_t addr, headers, *groups;
+        uint64_t group_count = (ctx->InputCount + (uint64_t)ELFL_GROUP - 1) / ELFL_GROUP;
+        uint32_t segments = 0, last = NO_INDEX;
+        ElfResult res;
+
+        run_jobs(ctx, ctx->InputCount, layout_input, NULL);
+        if ((res = layout_commons(ctx)) != ELF_OK)
+                return res;
+
+        /* the output flags and types come from the members */
+        for (uint32_t i = 0; i < ctx->InputCount; i++)
+        {
+                const Input *in = ctx->Inputs[i];
+
+                for (uint32_t m = 0; m < in->MemberCount; m++)
+                {
+                        OutSec *out = &ctx->Outs[in->Members[m].Out];
+                        const ElfSecHeader *sh = &in->Headers[in->Members[m].Sec];
+
+                        out->Flags |= sh->Flags & (SHF_ALLOC | SHF_WRITE | SHF_EXECINSTR);
+                        if (sh->Type != SHT_NOBITS)
+                                out->Type = SHT_PROGBITS;
+                        out->Members++;
+                }
+        }
+        if (ctx->Common.Out != NO_INDEX)
+        {
+                ctx->Outs[ctx->Common.Out].Flags |= SHF_ALLOC | SHF_WRITE;
+                ctx->Outs[ctx->Common.Out].Members++;
+        }
+
+        /*
+         * Prefix sum of the shares over the inputs, in two levels: the groups of inputs are laid out
+         * in parallel, a scan over the groups places each one at its alignment and the offsets of the
+         * inputs are added up in parallel by place_input(). A group may start up to its alignment
+         * minus one bytes later than a scan over the inputs would put it.
+         */
+        if ((groups = malloc((group_count * 2 * ctx->OutCount + 1) * sizeof(uint64_t))) == NULL)
+                return ELF_NO_MEM;
+
+        run_jobs(ctx, group_count, layout_group, groups);
+        for (uint64_t g = 0; g < group_count; g++)
+        {
+                uint64_t *size = groups + g * 2 * ctx->OutCount;
+                const uint64_t *align = size + ctx->OutCount;
+
+                /* the size of the group becomes its offset */
+                for (uint32_t o = 0; o < ctx->OutCount; o++)
+                {
+                        uint64_t base = align_up(run[o], align[o]);
+
+                        run[o] = base + size[o];
+                        size[o] = base;
+                        if (align[o] > ctx->Outs[o].Align)
+                                ctx->Outs[o].Align = align[o];
+                }
+        }
+        if (ctx->Common.Out != NO_INDEX)
+        {
+                uint32_t o = ctx->Common.Out;
+
+                ctx->Common.Offset = align_up(run[o], ctx->Common.Align);
+                run[o] = ctx->Common.Offset + ctx->Common.Size;
+                if (ctx->Common.Align > ctx->Outs[o].Align)
+                        ctx->Outs[o].Align = ctx->Common.Align;
+        }
+
+        /* file order: code, read only data, data then .bss */
+        ctx->Stats.OutputSections = 0;
+        for (uint32_t kind = 0; kind < 4; kind++)
+        {
+                for (uint32_t o = 0; o < ctx->OutCount; o++)
+                {
+                        if ((ctx->Outs[o].Members != 0) && (out_kind(&ctx->Outs[o]) == kind))
+                        {
+                                ctx->Order[ctx->Stats.OutputSections++] = o;
+                                if (segment_of(kind) != last)
+                                        segments++;
+                                last = segment_of(kind);
+                        }
+                }
+        }
+
+        /*
+         * Addresses: the first section follows the headers in the first page, each segment starts
+         * one page after the end of the previous one so that addresses and file offsets stay
+         * congruent without padding the file.
+         */
+        headers = (ctx->Class == ELFCLASS32) ? sizeof(Elf32Header) + segments * sizeof(Elf32ProHeader)
+                                             : sizeof(Elf64Header) + segments * sizeof(Elf64ProHeader);
+        addr = ctx->Info.BaseAddress + headers;
+        last = NO_INDEX;
+        for (uint32_t i = 0; i < ctx->Stats.OutputSections; i++)
+        {
+                OutSec *out = &ctx->Outs[ctx->Order[i]];
+                uint32_t seg = segment_of(out_kind(out));
+
+                if ((last != NO_INDEX) && (seg != last))
+                        addr += ctx->Info.PageSize;
+                last = seg;
+
+                out->Address = align_up(addr, out->Align);
+                out->Size = run[ctx->Order[i]];
+                addr = out->Address + out->Size;
+                if ((ctx->Class == ELFCLASS32) && (addr > UINT32_MAX))
+                {
+                        link_error(ctx, ELF_BAD_SIZE, "the image doesn't fit a 32-bit address space");
+                        free(groups);
+                        return ELF_BAD_SIZE;
+                }
+        }
+
+        run_jobs(ctx, ctx->InputCount, place_input, groups);
+        free(groups);
+        if (ctx->Common.Out != NO_INDEX)
+                ctx->Common.Address = ctx->Outs[ctx->Common.Out].Address + ctx->Common.Offset;
+
+        return ELF_OK;
+}
+
+/***************
+ *  Relocate   *
+ ***************/
+
+/** Address of a symbol defined by an input, after layout. */
+static bool definition_address(const ElflCtx *ctx, const Input *in, const InSym *s, uint64_t *addr)
+{
+        switch (s->Sec)
+        {
+        case SHN_UNDEF:
+                *addr = 0;
+                return true;
+        case SHN_ABS:
+                *addr = s->Value;
+                return true;
+        case SHN_COMMON:
+                *addr = ctx->Common.Address + s->Value;
+                return true;
+        default:
+                if (in->SecMember[s->Sec] == NO_INDEX)
+                        return false;
+                *addr = in->Members[in->SecMember[s->Sec]].Address + s->Value;
+                return true;
+        }
+}
+
+/** Address of symbol k of an input, globals resolve to their definition. */
+static bool symbol_address(const ElflCtx *ctx, const Input *in, uint32_t k, uint64_t *addr)
+{
+        const InSym *s;
+
+        if (k >= in->SymCount)
+                return false;
+
+        s = &in->Syms[k];
+        if (s->Slot != NO_INDEX)
+        {
+                uint64_t owner = ctx->Table[s->Slot].Owner;
+
+                if (owner_rank(owner) == RANK_UNDEF)
+                {
+                        *addr = 0;
+                        return true;
+                }
+                in = ctx->Inputs[owner_input(owner)];
+                s = &in->Syms[owner_sym(owner)];
+        }
+        return definition_address(ctx, in, s, addr);
+}
+
+/* Symbols of the relocations of one input */
+typedef struct
+{
+        const ElflCtx *Ctx;
+        const Input *In;
+} RelocSymbols;
+
+static ElfResult reloc_symbol(void *user_ctx, uint32_t symbol, uint64_t *value)
+{
+        const RelocSymbols *rs = user_ctx;
+
+        *value = 0;
+        if (symbol == 0)
+                return ELF_OK;
+        return symbol_address(rs->Ctx, rs->In, symbol, value) ? ELF_OK : ELF_NOT_FOUND;
+}
+
+static int patch_cmp(const void *a, const void *b)
+{
+        const Patch *pa = a, *pb = b;
+
+        return (pa->Offset > pb->Offset) - (pa->Offset < pb->Offset);
+}
+
+/** Stable merge sort of relocations by offset, the relocations at one offset keep their order. */
+static void sort_relocations(ElfRelocation *rels, ElfRelocation *tmp, uint32_t count)
+{
+        for (uint32_t width = 1; width < count; width *= 2)
+        {
+                for (uint32_t lo = 0; lo < count; lo += 2 * width)
+                {
+                        uint32_t mid = (count - lo > width) ? lo + width : count;
+                        uint32_t hi = (count - mid > width) ? mid + width : count;
+                        uint32_t a = lo, b = mid, k = lo;
+
+                        while ((a < mid) && (b < hi))
+                                tmp[k++] = (rels[b].Offset < rels[a].Offset) ? rels[b++] : rels[a++];
+                        while (a < mid)
+                                tmp[k++] = rels[a++];
+                        while (b < hi)
+                                tmp[k++] = rels[b++];
+                }
+                memcpy(rels, tmp, (size_t)count * sizeof(ElfRelocation));
+        }
+}
+
+/*
+ * A PCREL_LO12 takes its value from the PCREL_HI20 its symbol points at, which may be anywhere in the
+ * section. Each one is turned into the absolute LO12 of the same value, applied alone in any window.
+ */
+static bool pair_pcrel_lo12(const ElflCtx *ctx, const Member *m, ElfRelocation *rels, uint32_t count,
+                            uint32_t *bad)
+{
+        for (uint32_t i = 0; i < count; i++)
+        {
+                ElfRelocation *r = &rels[i];
+                uint32_t lo = 0, hi = count;
+                uint64_t auipc, S;
+
+                if ((r->Type != R_RISCV_PCREL_LO12_I) && (r->Type != R_RISCV_PCREL_LO12_S))
+                        continue;
+
+                *bad = i;
+                if (!symbol_address(ctx, m->In, r->Symbol, &auipc) || (auipc < m->Address))
+                        return false;
+                auipc -= m->Address;
+
+                while (lo < hi)
+                {
+                        uint32_t mid = lo + (hi - lo) / 2;
+                        if (rels[mid].Offset < auipc)
+                                lo = mid + 1;
+                        else
+                                hi = mid;
+                }
+                for (; (lo < count) && (rels[lo].Offset == auipc) && (rels[lo].Type != R_RISCV_PCREL_HI20); lo++)
+                        ;
+                if ((lo == count) || (rels[lo].Offset != auipc) || !symbol_address(ctx, m->In, rels[lo].Symbol, &S))
+                        return false;
+
+                r->Type = (r->Type == R_RISCV_PCREL_LO12_I) ? R_RISCV_LO12_I : R_RISCV_LO12_S;
+                r->Symbol = 0;
+                r->Addend = (int64_t)(S + (uint64_t)rels[lo].Addend - (m->Address + auipc));
+        }
+        return true;
+}
+
+/*
+ * Computes the patches of one member. The relocations are sorted by offset and cut into windows of
+ * at most ELFL_WINDOW bytes of the section, each window is read, relocated by the engine and the
+ * bytes each relocation wrote are kept: only the relocated parts of the section are read, through a
+ * buffer on the stack.
+ */
+static void relocate_member(ElflCtx *ctx, void *arg, uint64_t job)
+{
+        Member *m = ctx->Jobs[job];
+        Input *in = m->In;
+        const ElfSecHeader *rs = &in->Headers[m->Rel];
+        uint32_t count = get_relocation_count(&in->Elf, rs);
+        RelocSymbols symbols = { ctx, in };
+        ElfRelocation *rels = NULL;
+        uint8_t window[ELFL_WINDOW + ELFL_WINDOW_SLACK];
+        ElfrTarget target;
+        ElfrError err = { 0, "" };
+        bool sorted = true, in_order = true;
+        uint32_t bad = 0;
+        ElfResult res;
+        (void)arg;
+
+        if (rs->Type != SHT_RELA)
+        {
+                link_error(ctx, ELF_BAD_FORMAT, "%s: section %s: REL relocations aren't supported", in->Name,
+                           section_name(in, m->Sec));
+                return;
+        }
+
+        rels = malloc(((size_t)count + 1) * sizeof(ElfRelocation));
+        m->Patches = malloc(((size_t)count + 1) * sizeof(Patch));
+        if ((rels == NULL) || (m->Patches == NULL))
+        {
+                link_error(ctx, ELF_NO_MEM, "out of memory");
+                goto out;
+        }
+
+        if ((res = get_relocation_entries(&in->Elf, rs, 0, count, rels)) != ELF_OK)
+        {
+                link_error(ctx, res, "%s: section %s: can't read the relocations (error %d)", in->Name,
+                           section_name(in, m->Sec), (int)res);
+                goto out;
+        }
+
+        for (uint32_t i = 1; (i < count) && sorted; i++)
+                sorted = (rels[i - 1].Offset <= rels[i].Offset);
+        if (!sorted)
+        {
+                ElfRelocation *tmp = malloc((size_t)count * sizeof(ElfRelocation));
+
+                if (tmp == NULL)
+                {
+                        link_error(ctx, ELF_NO_MEM, "out of memory");
+                        goto out;
+                }
+                sort_relocations(rels, tmp, count);
+                free(tmp);
+        }
+
+        if ((ctx->Info.Machine == EM_RISCV) && !pair_pcrel_lo12(ctx, m, rels, count, &bad))
+        {
+                link_error(ctx, ELF_BAD_FORMAT, "%s: section %s offset 0x%llx: PCREL_LO12 without its PCREL_HI20 (%s %u)",
+                           in->Name, section_name(in, m->Sec), (unsigned long long)rels[bad].Offset,
+                           elfr_type_name(EM_RISCV, rels[bad].Type), rels[bad].Type);
+                goto out;
+        }
+
+        target.Machine = ctx->Info.Machine;
+        target.Data = ctx->Data;
+        target.Bytes = window;
+
+        for (uint32_t first = 0, end; first < count; first = end)
+        {
+                uint64_t lo = UINT64_MAX, hi = 0;
+
+                /* the bytes each relocation touches, unknown types are left to the engine to report */
+                for (end = first; end < count; end++)
+                {
+                        uint64_t s = rels[end].Offset, e = rels[end].Offset;
+                        int32_t from = 0;
+                        uint32_t size = 0;
+
+                        if (elfr_patch_range(ctx->Info.Machine, rels[end].Type, &from, &size) == ELF_OK)
+                        {
+                                s += (uint64_t)(int64_t)from;
+                                e = s + size;
+                        }
+                        if (((from < 0) && (rels[end].Offset < (uint64_t)-(int64_t)from)) || (e > m->Size))
+                        {
+                                const char *type = elfr_type_name(ctx->Info.Machine, rels[end].Type);
+
+                                link_error(ctx, ELF_BAD_FORMAT, "%s: section %s offset 0x%llx: relocation outside its section (%s %u)",
+                                           in->Name, section_name(in, m->Sec), (unsigned long long)rels[end].Offset,
+                                           (type != NULL) ? type : "type", rels[end].Type);
+                                goto out;
+                        }
+
+                        s = (s < lo) ? s : lo;
+                        e = (e > hi) ? e : hi;
+                        if ((end != first) && (e - s > ELFL_WINDOW) &&
+                            ((rels[end].Offset != rels[end - 1].Offset) || (e - s > sizeof(window))))
+                                break;
+                        lo = s;
+                        hi = e;
+                }
+
+                if ((hi > lo) &&
+                    ((res = get_section_data(&in->Elf, &in->Headers[m->Sec], lo, hi - lo, window)) != ELF_OK))
+                {
+                        link_error(ctx, res, "%s: section %s: can't read the section (error %d)", in->Name,
+                                   section_name(in, m->Sec), (int)res);
+                        goto out;
+                }
+
+                for (uint32_t i = first; i < end; i++)
+                        rels[i].Offset -= lo;
+                target.Size = hi - lo;
+                target.Address = m->Address + lo;
+
+                if ((res = elfr_apply(&target, rels + first, end - first, reloc_symbol, &symbols, &err)) != ELF_OK)
+                {
+                        const ElfRelocation *r = &rels[first + err.Index];
+                        const char *type = elfr_type_name(ctx->Info.Machine, r->Type);
+
+                        if (res == ELF_NOT_FOUND)
+                                err.Reason = "relocation against a discarded section";
+                        if (res == ELF_BAD_HEADER)
+                                link_error(ctx, res, "relocations of machine %u aren't supported", (unsigned)ctx->Info.Machine);
+                        else
+                                link_error(ctx, ELF_BAD_FORMAT, "%s: section %s offset 0x%llx: %s (%s %u)", in->Name,
+                                           section_name(in, m->Sec), (unsigned long long)(r->Offset + lo), err.Reason,
+                                           (type != NULL) ? type : "type", r->Type);
+                        goto out;
+                }
+
+                /* the bytes the relocations wrote, laid over the input section when it is written */
+                for (uint32_t i = first; i < end; i++)
+                {
+                        Patch *p = &m->Patches[m->PatchCount];
+                        int32_t from;
+                        uint32_t size;
+
+                        if ((elfr_patch_range(ctx->Info.Machine, rels[i].Type, &from, &size) != ELF_OK) || (size == 0))
+                                continue;
+
+                        p->Offset = (uint32_t)(lo + rels[i].Offset + (uint64_t)(int64_t)from);
+                        p->Size = size;
+                        memcpy(p->Bytes, window + (p->Offset - lo), size);
+                        if ((m->PatchCount != 0) && (p->Offset < p[-1].Offset))
+                                in_order = false;
+                        m->PatchCount++;
+                }
+        }
+
+        if (!in_order)
+                qsort(m->Patches, m->PatchCount, sizeof(Patch), patch_cmp);
+        fetch_add64(&ctx->Relocations, count);
+
+out:
+        free(rels);
+}
+
+static ElfResult relocate(ElflCtx *ctx)
+{
+        uint64_t n = 0;
+
+        for (uint32_t i = 0; i < ctx->InputCount; i++)
+        {
+                for (uint32_t m = 0; m < ctx->Inputs[i]->MemberCount; m++)
+                        n += (ctx->Inputs[i]->Members[m].Rel != 0);
+        }
+
+        if ((ctx->Jobs = malloc((n + 1) * sizeof(Member *))) == NULL)
+                return ELF_NO_MEM;
+
+        /* grouped by output section, the neighbouring jobs patch the same part of the output */
+        for (uint32_t o = 0; o < ctx->OutCount; o++)
+        {
+                for (uint32_t i = 0; i < ctx->InputCount; i++)
+                {
+                        Input *in = ctx->Inputs[i];
+
+                        for (uint32_t m = 0; m < in->MemberCount; m++)
+                        {
+                                if ((in->Members[m].Rel != 0) && (in->Members[m].Out == o))
+                                        ctx->Jobs[ctx->JobCount++] = &in->Members[m];
+                        }
+                }
+        }
+
+        run_jobs(ctx, ctx->JobCount, relocate_member, NULL);
+        ctx->Stats.Relocations = load64(&ctx->Relocations);
+        return (ElfResult)load64(&ctx->Failed);
+}
+
+/***************
+ *    Emit     *
+ ***************/
+
+/** Source of a member's chunk: the bytes of the input file with the patches laid over them. */
+static ElfResult member_read(void *user_ctx, uint64_t offset, uint64_t size, void *buffer)
+{
+        const Member *m = user_ctx;
+        const Input *in = m->In;
+        uint8_t *out = buffer;
+        uint32_t lo = 0, hi = m->PatchCount;
+        ElfResult res;
+
+        if (in->Headers[m->Sec].Type == SHT_NOBITS)
+        {
+                memset(buffer, 0, size);
+                return ELF_OK;
+        }
+
+        if ((res = get_section_data(&in->Elf, &in->Headers[m->Sec], offset, size, buffer)) != ELF_OK)
+                return res;
+
+        /* first patch ending after the start of the piece */
+        while (lo < hi)
+        {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (m->Patches[mid].Offset + m->Patches[mid].Size <= offset)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        for (; (lo < m->PatchCount) && (m->Patches[lo].Offset < offset + size); lo++)
+        {
+                const Patch *p = &m->Patches[lo];
+
+                for (uint32_t b = 0; b < p->Size; b++)
+                {
+                        uint64_t at = (uint64_t)p->Offset + b;
+                        if ((at >= offset) && (at < offset + size))
+                                out[at - offset] = p->Bytes[b];
+                }
+        }
+        return ELF_OK;
+}
+
+static ElfResult emit_member(ElflCtx *ctx, const OutSec *out, Member *m)
+{
+        if (elfw_section_next_offset(out->Sec, m->Align) != m->Offset)
+        {
+                link_error(ctx, ELF_BAD_FORMAT, "internal error: layout mismatch in %s", out->Name);
+                return ELF_BAD_FORMAT;
+        }
+
+        if (out->Type == SHT_NOBITS)
+                return elfw_section_append_data(out->Sec, NULL, m->Size, m->Align);
+        return elfw_section_append_source(out->Sec, member_read, m, m->Size, m->Align);
+}
+
+/* Encodes the globals an input owns into the output symbol table */
+static void emit_symbols(ElflCtx *ctx, void *arg, uint64_t job)
+{
+        Input *in = ctx->Inputs[job];
+        ElfwCtx *elf = arg;
+        uint64_t entry = elfw_symbol_entry_size(elf);
+        uint32_t at = in->OutSymFirst;
+        uint64_t name = in->OutNameFirst;
+        ElfSymTabEntry batch[ELFL_BATCH];
+
+        if (in->OutSyms == 0)
+                return;
+
+        for (uint32_t first = in->FirstGlobal; first < in->SymCount; first += ELFL_BATCH)
+        {
+                uint32_t count = (in->SymCount - first < ELFL_BATCH) ? in->SymCount - first : ELFL_BATCH;
+
+                if (get_symbol_entries(&in->Elf, &in->Headers[in->SymTab], first, count, batch) != ELF_OK)
+                {
+                        link_error(ctx, ELF_IO_ERROR, "%s: can't read the symbols", in->Name);
+                        return;
+                }
+
+                for (uint32_t i = 0; i < count; i++)
+                {
+                        uint32_t k = first + i;
+                        const InSym *s = &in->Syms[k];
+                        ElfSymTabEntry *e = &batch[i];
+                        const char *str;
+                        size_t len;
+
+                        if (!(in->Owned[k / 64] & (1ULL << (k % 64))))
+                                continue;
+
+                        /* the name of an owned symbol, from the input's own string table */
+                        str = in->Strtab + e->NameIdx;
+                        len = strlen(str) + 1;
+                        memcpy(ctx->StrtabData + name, str, len);
+
+                        e->NameIdx = (uint32_t)name;
+                        e->Attr = STA_DEFAULT;
+                        definition_address(ctx, in, s, &e->Value);
+                        if (s->Sec == SHN_ABS)
+                        {
+                                e->Attr = STA_ABS;
+                        }
+                        else if (s->Sec == SHN_COMMON)
+                        {
+                                e->Type = STT_OBJECT;
+                                e->SecIdx = elfw_section_index(ctx->Outs[ctx->Common.Out].Sec);
+                        }
+                        else
+                        {
+                                e->SecIdx = elfw_section_index(ctx->Outs[in->Members[in->SecMember[s->Sec]].Out].Sec);
+                        }
+
+                        if (elfw_encode_symbols(elf, e, 1, ctx->SymtabData + (uint64_t)at * entry, NULL) != ELF_OK)
+                        {
+                                link_error(ctx, ELF_BAD_SIZE, "%s: can't encode symbol %s", in->Name, str);
+                                return;
+                        }
+                        at++;
+                        name += len;
+                }
+        }
+}
+
+static ElfResult emit(ElflCtx *ctx, ElfwCtx *elf)
+{
+        ElfwHeaderCreateInfo hdr = { ctx->Class, ctx->Data, ET_EXEC, ctx->Info.Machine, ELFOSABI_NONE, 0, 0, ctx->Flags };
+        uint32_t entry_slot = table_find(ctx, ctx->Info.Entry);
+        uint64_t syms = 1, names = 1, entry_size;
+        sec_hndl symtab, strtab;
+        ElfResult res;
+
+        /* the entry point, the start of the code if its symbol isn't defined */
+        if ((entry_slot != NO_INDEX) && (owner_rank(ctx->Table[entry_slot].Owner) != RANK_UNDEF))
+        {
+                uint64_t owner = ctx->Table[entry_slot].Owner;
+                symbol_address(ctx, ctx->Inputs[owner_input(owner)], owner_sym(owner), &hdr.Entry);
+        }
+        else if (ctx->Stats.OutputSections != 0)
+        {
+                hdr.Entry = ctx->Outs[ctx->Order[0]].Address;
+        }
+
+        if ((res = elfw_create_header(elf, &hdr)) != ELF_OK)
+                return res;
+
+        for (uint32_t i = 0; i < ctx->Stats.OutputSections; i++)
+        {
+                OutSec *out = &ctx->Outs[ctx->Order[i]];
+                uint32_t o = ctx->Order[i];
+                ElfwSectionCreateInfo info = { out->Name, out->Type, out->Flags | SHF_ALLOC, out->Address, NULL, 0, out->Align, 0 };
+
+                if ((res = elfw_add_section(elf, &info, &out->Sec)) != ELF_OK)
+                        return res;
+
+                for (uint32_t k = 0; k < ctx->InputCount; k++)
+                {
+                        Input *in = ctx->Inputs[k];
+
+                        for (uint32_t m = 0; m < in->MemberCount; m++)
+                        {
+                                if ((in->Members[m].Out == o) && ((res = emit_member(ctx, out, &in->Members[m])) != ELF_OK))
+                                        return res;
+                        }
+                }
+
+                if ((ctx->Common.Out == o) &&
+                    ((res = elfw_section_append_data(out->Sec, NULL, ctx->Common.Size, ctx->Common.Align)) != ELF_OK))
+                        return res;
+        }
+
+        /* one PT_LOAD per run of sections with the same permissions */
+        for (uint32_t i = 0; i < ctx->Stats.OutputSections;)
+        {
+                const OutSec *first = &ctx->Outs[ctx->Order[i]];
+                uint32_t seg = segment_of(out_kind(first));
+                uint32_t j = i;
+                ElfwSegmentCreateInfo info;
+
+                while ((j + 1 < ctx->Stats.OutputSections) && (segment_of(out_kind(&ctx->Outs[ctx->Order[j + 1]])) == seg))
+                        j++;
+
+                info.Type = PT_LOAD;
+                info.Flags = PF_R | ((seg == 0) ? PF_X : 0) | ((seg == 2) ? PF_W : 0);
+                info.Alignment = ctx->Info.PageSize;
+                info.First = first->Sec;
+                info.Last = ctx->Outs[ctx->Order[j]].Sec;
+                if ((res = elfw_add_segment(elf, &info)) != ELF_OK)
+                        return res;
+                i = j + 1;
+        }
+
+        /* symbol table of the globals, in input order */
+        for (uint32_t i = 0; i < ctx->InputCount; i++)
+        {
+                Input *in = ctx->Inputs[i];
+
+                in->OutSymFirst = (uint32_t)syms;
+                in->OutNameFirst = names;
+                syms += in->OutSyms;
+                names += in->OutNames;
+        }
+        if ((syms > UINT32_MAX) || (names > UINT32_MAX))
+        {
+                link_error(ctx, ELF_BAD_SIZE, "too many global symbols for the symbol table");
+                return ELF_BAD_SIZE;
+        }
+
+        entry_size = elfw_symbol_entry_size(elf);
+        ctx->SymtabData = calloc(syms, entry_size);
+        ctx->StrtabData = malloc(names);
+        if ((ctx->SymtabData == NULL) || (ctx->StrtabData == NULL))
+                return ELF_NO_MEM;
+        ctx->StrtabData[0] = '\0';
+
+        run_jobs(ctx, ctx->InputCount, emit_symbols, elf);
+        if (link_failed(ctx))
+                return (ElfResult)load64(&ctx->Failed);
+
+        {
+                ElfwSectionCreateInfo str_info = { ".strtab", SHT_STRTAB, 0, 0, NULL, 0, 1, 0 };
+                ElfwSectionCreateInfo sym_info = { ".symtab", SHT_SYMTAB, 0, 0, NULL, 1, (ctx->Class == ELFCLASS32) ? 4 : 8,
+                                                   entry_size };
+
+                if (((res = elfw_add_section(elf, &str_info, &strtab)) != ELF_OK) ||
+                    ((res = elfw_section_append_data(strtab, ctx->StrtabData, names, 1)) != ELF_OK))
+                        return res;
+
+                sym_info.Link = strtab;
+                if (((res = elfw_add_section(elf, &sym_info, &symtab)) != ELF_OK) ||
+                    ((res = elfw_section_append_data(symtab, ctx->SymtabData, syms * entry_size, 1)) != ELF_OK))
+                        return res;
+        }
+        return ELF_OK;
+}
+
+/***************
+ *    Link     *
+ ***************/
+
+ElfResult elfl_link(ElflCtx *ctx, ElfwCtx *elf)
+{
+        uint64_t globals = 0, t;
+        ElfResult res;
+
+        if (ctx == NULL)
+                return ELF_UNINIT;
+
+        if ((elf == NULL) || (ctx->InputCount == 0) || (ctx->Table != NULL))
+                return ELF_BAD_ARG;
+
+        ctx->Stats.Inputs = ctx->InputCount;
+
+        t = now_ns();
+        run_jobs(ctx, ctx->InputCount, load_input, NULL);
+        if (link_failed(ctx))
+                return (ElfResult)load64(&ctx->Failed);
+
+        for (uint32_t i = 0; i < ctx->InputCount; i++)
+        {
+                globals += ctx->Inputs[i]->SymCount - ctx->Inputs[i]->FirstGlobal;
+                ctx->Stats.Symbols += ctx->Inputs[i]->SymCount;
+                ctx->Stats.InputSections += ctx->Inputs[i]->MemberCount;
+        }
+        ctx->Stats.LoadNs = now_ns() - t;
+
+        /* a power of two with at least one free slot in three */
+        t = now_ns();
+        ctx->TableMask = 63;
+        while (ctx->TableMask + 1 < globals + globals / 2)
+                ctx->TableMask = ctx->TableMask * 2 + 1;
+        if ((ctx->Table = calloc(ctx->TableMask + 1, sizeof(GlobalSym))) == NULL)
+                return ELF_NO_MEM;
+
+        run_jobs(ctx, ctx->InputCount, resolve_input, NULL);
+        if (link_failed(ctx))
+                return (ElfResult)load64(&ctx->Failed);
+
+        run_jobs(ctx, ctx->InputCount, check_input, NULL);
+        if ((res = report_symbols(ctx)) != ELF_OK)
+                return res;
+
+        for (uint64_t i = 0; i <= ctx->TableMask; i++)
+                ctx->Stats.GlobalSymbols += (ctx->Table[i].Hash != 0);
+        ctx->Stats.ResolveNs = now_ns() - t;
+
+        t = now_ns();
+        if ((res = layout(ctx)) != ELF_OK)
+                return res;
+        ctx->Stats.LayoutNs = now_ns() - t;
+
+        t = now_ns();
+        if ((res = relocate(ctx)) != ELF_OK)
+                return res;
+        ctx->Stats.RelocateNs = now_ns() - t;
+
+        t = now_ns();
+        res = emit(ctx, elf);
+        ctx->Stats.EmitNs = now_ns() - t;
+        return res;
+}
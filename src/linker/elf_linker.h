@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ELFL_LIB
+#define ELFL_LIB
+
+#include "common/elf_core.h"
+#include "writer/elf_writer.h"
+
+/**
+ * Linker core: links relocatable files opened with the reader into a static executable built with
+ * the writer.
+ *
+ * The link runs in phases, each one spread over worker threads (define ELFL_NO_THREADS to build
+ * without them):
+ *  - Load: the section headers, names and symbols of every input are read and each allocated input
+ *    section is mapped to an output section by the rules.
+ *  - Resolve: the global symbols go into one lock free hash map, a strong definition replaces a
+ *    common one that replaces a weak one, undefined references only keep the slot.
+ *  - Layout: each input sums the sizes of its sections per output section, the offsets of the inputs
+ *    follow from a two level prefix sum over those totals (within groups of inputs in parallel, then
+ *    over the groups) and the output sections get their addresses.
+ *  - Relocate: the relocations of each output section are applied by the workers, sorted by offset,
+ *    to windows of a few KiB of the input sections read around them. The patched bytes are kept as
+ *    a short list per input section.
+ *  - Emit: every input section becomes a chunk of its output section that the writer reads from the
+ *    input file while the executable is written, with the patches laid over it. Besides the relocation
+ *    windows, section contents are only read by the writer, once, straight into the output.
+ *
+ * Only what a static link of C objects needs is supported: no shared libraries, no TLS, no GOT or PLT
+ * (calls through the PLT are bound directly and GOT loads of x86-64 are relaxed to address
+ * computations), section groups are linked as plain sections. Relocations are applied by the engine
+ * of elf_reloc.h, for x86-64, AArch64 and RISC-V; RISC-V code isn't relaxed.
+ */
+
+/**
+ * @brief Linker context, created with elfl_create().
+ */
+typedef struct ElflCtx ElflCtx;
+
+/***************
+ *    Rules    *
+ ***************/
+        /**
+         * @brief Maps allocated input sections to an output section, the first matching rule wins.
+         */
+        typedef struct
+        {
+                const char *Output;     // Name of the output section
+                const char *Input;      // Input section name, a trailing '*' matches any suffix ("*" matches all)
+                uint64_t Flags;         // SHF_* the input section must have, 0 for any
+        } ElflSectionRule;
+
+        typedef struct
+        {
+                ElfMachine Machine;     // Machine of every input, EM_X86_64, EM_AARCH64 or EM_RISCV
+                uint64_t BaseAddress;   // Address of the first page of the image, 0x400000 when 0
+                uint64_t PageSize;      // Alignment of the segments, 0x1000 when 0
+                const char *Entry;      // Entry point symbol, "_start" when NULL. The start of .text if undefined
+                const ElflSectionRule *Rules;   // NULL for the default rules (.text, .rodata, .data and .bss)
+                uint32_t RuleCount;
+                uint32_t Threads;       // Worker threads, 0 for one per online CPU
+                bool AllowUndefined;    // Resolve undefined symbols to 0 instead of failing
+        } ElflLinkInfo;
+
+/***************
+ *   Context   *
+ ***************/
+        /**
+         * @param info Link parameters, copied (the rules and the strings are not).
+         * @param ctx (out) New linker context, released with elfl_destroy().
+         * @return Error code, ELF_BAD_ARG if the page size isn't a power of two.
+         */
+        ElfResult elfl_create(const ElflLinkInfo *info, ElflCtx **ctx);
+
+        /**
+         * @param ctx Linker context, NULL is allowed.
+         */
+        void elfl_destroy(ElflCtx *ctx);
+
+        /**
+         * @param ctx Linker context.
+         * @param input Reader context of a relocatable file, copied. Its callback is called from the worker
+         *              threads, for different inputs at the same time, and again while the output is written.
+         * @param name Name of the input in the error messages, not copied.
+         * @return Error code, ELF_BAD_HEADER if the input isn't a relocatable file, ELF_BAD_CLASS and
+         *         ELF_BAD_ENDIANNESS if it doesn't match the first input.
+         */
+        ElfResult elfl_add_input(ElflCtx *ctx, const ElfCtx *input, const char *name);
+
+        /**
+         * @param ctx Linker context with its inputs.
+         * @param elf Empty writer context, receives the header, the output sections with their segments
+         *            and a symbol table of the global symbols.
+         * @return Error code, ELF_NOT_FOUND for undefined symbols, ELF_BAD_FORMAT for duplicate
+         *         definitions and relocations that can't be applied. elfl_error() describes the failure.
+         * @note The output sections read the inputs while the file is written, keep the linker context
+         *       and the input files alive until elfw_write() returns.
+         */
+        ElfResult elfl_link(ElflCtx *ctx, ElfwCtx *elf);
+
+        /**
+         * @param ctx Linker context.
+         * @return Description of the first error of the link, an empty string if there was none.
+         */
+        const char *elfl_error(const ElflCtx *ctx);
+
+/***************
+ *    Stats    *
+ ***************/
+        typedef struct
+        {
+                uint32_t Inputs;
+                uint32_t OutputSections;
+                uint64_t InputSections;         // linked into the output
+                uint64_t Symbols;               // read from the inputs
+                uint64_t GlobalSymbols;         // distinct names in the global table
+                uint64_t Relocations;           // applied
+                uint64_t LoadNs;                // wall time of each phase
+                uint64_t ResolveNs;
+                uint64_t LayoutNs;
+                uint64_t RelocateNs;
+                uint64_t EmitNs;
+        } ElflStats;
+
+        /**
+         * @param ctx Linker context.
+         * @param stats (out) Counters of the last elfl_link().
+         */
+        void elfl_get_stats(const ElflCtx *ctx, ElflStats *stats);
+
+#endif // Include guard;
@@ -0,0 +1,731 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/elf_core.h"
+#include "common/elf_machines.h"
+#include "elf_reloc.h"
+
+#define ELFR_BATCH      1024    // relocations resolved and sorted together
+#define ELFR_PAGE_SHIFT 12
+
+/***************
+ *    Bytes    *
+ ***************/
+
+/* Written byte by byte, compilers merge them into single loads and stores */
+
+static inline uint32_t rd16(const uint8_t *p)
+{
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static inline uint32_t rd32(const uint8_t *p)
+{
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t rd64(const uint8_t *p)
+{
+        return (uint64_t)rd32(p) | ((uint64_t)rd32(p + 4) << 32);
+}
+
+static inline void wr16(uint8_t *p, uint64_t v)
+{
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void wr32(uint8_t *p, uint64_t v)
+{
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)(v >> 16);
+        p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void wr64(uint8_t *p, uint64_t v)
+{
+        wr32(p, v);
+        wr32(p + 4, v >> 32);
+}
+
+/* Data fields, be is a constant in every loop so the other byte order is compiled out */
+
+static inline void put16(uint8_t *p, uint64_t v, int be)
+{
+        if (be)
+        {
+                p[0] = (uint8_t)(v >> 8);
+                p[1] = (uint8_t)v;
+        }
+        else
+        {
+                wr16(p, v);
+        }
+}
+
+static inline void put32(uint8_t *p, uint64_t v, int be)
+{
+        if (be)
+        {
+                put16(p, v >> 16, 1);
+                put16(p + 2, v, 1);
+        }
+        else
+        {
+                wr32(p, v);
+        }
+}
+
+static inline void put64(uint8_t *p, uint64_t v, int be)
+{
+        if (be)
+        {
+                put32(p, v >> 32, 1);
+                put32(p + 4, v, 1);
+        }
+        else
+        {
+                wr64(p, v);
+        }
+}
+
+/** Replaces the bits of mask in a little endian instruction. */
+static inline void insn32(uint8_t *p, uint32_t mask, uint64_t bits)
+{
+        wr32(p, (rd32(p) & ~mask) | ((uint32_t)bits & mask));
+}
+
+static inline void insn16(uint8_t *p, uint32_t mask, uint64_t bits)
+{
+        wr16(p, (rd16(p) & ~mask) | ((uint32_t)bits & mask));
+}
+
+/* Overflow bits, 0 when the value fits. v is the value in two's complement over 64 bits */
+#define FITS_S(v, n)   (((v) + (1ULL << ((n) - 1))) >> (n))                        // signed n bits
+#define FITS_U(v, n)   ((v) >> (n))                                                // unsigned n bits
+#define FITS_X(v, n)   ((uint64_t)(((v) + (1ULL << ((n) - 1))) >= (3ULL << ((n) - 1))))   // either
+
+/* AArch64 ADR and ADRP immediates: immlo in bits 29-30, immhi in bits 5-23 */
+static inline uint64_t a64_adr(uint64_t x)
+{
+        return ((x & 3) << 29) | (((x >> 2) & 0x7ffff) << 5);
+}
+
+/* RISC-V immediates, v is the offset or value the instruction holds */
+static inline uint64_t rv_btype(uint64_t v)
+{
+        return ((v & 0x1000) << 19) | ((v & 0x7e0) << 20) | ((v & 0x1e) << 7) | ((v & 0x800) >> 4);
+}
+
+static inline uint64_t rv_jtype(uint64_t v)
+{
+        return ((v & 0x100000) << 11) | ((v & 0x7fe) << 20) | ((v & 0x800) << 9) | (v & 0xff000);
+}
+
+static inline uint64_t rv_stype(uint64_t v)
+{
+        return ((v & 0xfe0) << 20) | ((v & 0x1f) << 7);
+}
+
+static inline uint64_t rv_cbtype(uint64_t v)
+{
+        return ((v & 0x100) << 4) | ((v & 0x18) << 7) | ((v & 0xc0) >> 1) | ((v & 0x6) << 2) | ((v & 0x20) >> 3);
+}
+
+static inline uint64_t rv_cjtype(uint64_t v)
+{
+        return ((v & 0x800) << 1) | ((v & 0x10) << 7) | ((v & 0x300) << 1) | ((v & 0x400) >> 2) | ((v & 0x40) << 1) |
+               ((v & 0x80) >> 1) | ((v & 0xe) << 2) | ((v & 0x20) >> 3);
+}
+
+/***************
+ *    Kinds    *
+ ***************/
+
+/*
+ * Every kind: the bytes it writes (first, relative to the offset, and size), the value it stores
+ * from V = S + A and P, the overflow bits of that value and the store. In the expressions p points
+ * at the relocated field and be is the byte order of data.
+ */
+#define ELFR_KINDS(X) \
+        /* data */ \
+        X(ABS64,        0, 8, V,                        0,                                  put64(p, v, be)) \
+        X(ABS32,        0, 4, V,                        FITS_X(v, 32),                      put32(p, v, be)) \
+        X(ABS32U,       0, 4, V,                        FITS_U(v, 32),                      put32(p, v, be)) \
+        X(ABS32S,       0, 4, V,                        FITS_S(v, 32),                      put32(p, v, be)) \
+        X(ABS16,        0, 2, V,                        FITS_X(v, 16),                      put16(p, v, be)) \
+        X(PC64,         0, 8, V - P,                    0,                                  put64(p, v, be)) \
+        X(PC32,         0, 4, V - P,                    FITS_X(v, 32),                      put32(p, v, be)) \
+        X(PC32S,        0, 4, V - P,                    FITS_S(v, 32),                      put32(p, v, be)) \
+        X(PC16,         0, 2, V - P,                    FITS_X(v, 16),                      put16(p, v, be)) \
+        /* x86-64 GOT loads and calls relaxed to direct ones, the opcode picks the kind */ \
+        X(X86_GOT_MOV, -2, 6, V - P,                    FITS_S(v, 32),                      p[-2] = 0x8d; wr32(p, v)) \
+        X(X86_GOT_CALL,-2, 6, V - P,                    FITS_S(v, 32),                      p[-2] = 0x67; p[-1] = 0xe8; wr32(p, v)) \
+        X(X86_GOT_JMP, -2, 6, V - P + 1,                FITS_S(v, 32),                      p[-2] = 0xe9; wr32(p - 1, v); p[3] = 0x90) \
+        /* AArch64 */ \
+        X(A64_BRANCH26, 0, 4, V - P,                    FITS_S(v, 28) | (v & 3),            insn32(p, 0x03ffffff, v >> 2)) \
+        X(A64_BRANCH19, 0, 4, V - P,                    FITS_S(v, 21) | (v & 3),            insn32(p, 0x00ffffe0, (v >> 2) << 5)) \
+        X(A64_BRANCH14, 0, 4, V - P,                    FITS_S(v, 16) | (v & 3),            insn32(p, 0x0007ffe0, (v >> 2) << 5)) \
+        X(A64_ADR,      0, 4, V - P,                    FITS_S(v, 21),                      insn32(p, 0x60ffffe0, a64_adr(v))) \
+        X(A64_ADRP,     0, 4, (V & ~0xfffULL) - (P & ~0xfffULL), FITS_S(v, 33),            insn32(p, 0x60ffffe0, a64_adr(v >> 12))) \
+        X(A64_ADRP_NC,  0, 4, (V & ~0xfffULL) - (P & ~0xfffULL), 0,                        insn32(p, 0x60ffffe0, a64_adr(v >> 12))) \
+        X(A64_LO12,     0, 4, V,                        0,                                  insn32(p, 0x003ffc00, (v & 0xfff) << 10)) \
+        X(A64_LO12_2,   0, 4, V,                        v & 1,                              insn32(p, 0x003ffc00, (v & 0xfff) << 9)) \
+        X(A64_LO12_4,   0, 4, V,                        v & 3,                              insn32(p, 0x003ffc00, (v & 0xfff) << 8)) \
+        X(A64_LO12_8,   0, 4, V,                        v & 7,                              insn32(p, 0x003ffc00, (v & 0xfff) << 7)) \
+        X(A64_LO12_16,  0, 4, V,                        v & 15,                             insn32(p, 0x003ffc00, (v & 0xfff) << 6)) \
+        X(A64_MOVW0,    0, 4, V,                        FITS_U(v, 16),                      insn32(p, 0x001fffe0, v << 5)) \
+        X(A64_MOVW0_NC, 0, 4, V,                        0,                                  insn32(p, 0x001fffe0, v << 5)) \
+        X(A64_MOVW1,    0, 4, V,                        FITS_U(v, 32),                      insn32(p, 0x001fffe0, (v >> 16) << 5)) \
+        X(A64_MOVW1_NC, 0, 4, V,                        0,                                  insn32(p, 0x001fffe0, (v >> 16) << 5)) \
+        X(A64_MOVW2,    0, 4, V,                        FITS_U(v, 48),                      insn32(p, 0x001fffe0, (v >> 32) << 5)) \
+        X(A64_MOVW2_NC, 0, 4, V,                        0,                                  insn32(p, 0x001fffe0, (v >> 32) << 5)) \
+        X(A64_MOVW3,    0, 4, V,                        0,                                  insn32(p, 0x001fffe0, (v >> 48) << 5)) \
+        /* RISC-V, the HI20 values are rounded so that the sign extended LO12 completes them */ \
+        X(RV_BRANCH,    0, 4, V - P,                    FITS_S(v, 13) | (v & 1),            insn32(p, 0xfe000f80, rv_btype(v))) \
+        X(RV_JAL,       0, 4, V - P,                    FITS_S(v, 21) | (v & 1),            insn32(p, 0xfffff000, rv_jtype(v))) \
+        X(RV_CALL,      0, 8, V - P,                    FITS_S(v + 0x800, 32),              insn32(p, 0xfffff000, v + 0x800); insn32(p + 4, 0xfff00000, v << 20)) \
+        X(RV_HI20,      0, 4, V - P,                    FITS_S(v + 0x800, 32),              insn32(p, 0xfffff000, v + 0x800)) \
+        X(RV_ABS_HI20,  0, 4, V,                        FITS_S(v + 0x800, 32),              insn32(p, 0xfffff000, v + 0x800)) \
+        X(RV_LO12_I,    0, 4, V,                        0,                                  insn32(p, 0xfff00000, v << 20)) \
+        X(RV_LO12_S,    0, 4, V,                        0,                                  insn32(p, 0xfe000f80, rv_stype(v))) \
+        X(RV_RVC_BRANCH,0, 2, V - P,                    FITS_S(v, 9) | (v & 1),             insn16(p, 0x1c7c, rv_cbtype(v))) \
+        X(RV_RVC_JUMP,  0, 2, V - P,                    FITS_S(v, 12) | (v & 1),            insn16(p, 0x1ffc, rv_cjtype(v))) \
+        /* a SETn and the SUBn that follows it rewrite one field, SET sorts first */ \
+        X(RV_SET6,      0, 1, V,                        0,                                  p[0] = (uint8_t)((p[0] & 0xc0) | (v & 0x3f))) \
+        X(RV_SET8,      0, 1, V,                        0,                                  p[0] = (uint8_t)v) \
+        X(RV_SET16,     0, 2, V,                        0,                                  wr16(p, v)) \
+        X(RV_SET32,     0, 4, V,                        0,                                  wr32(p, v)) \
+        X(RV_ADD8,      0, 1, V,                        0,                                  p[0] = (uint8_t)(p[0] + v)) \
+        X(RV_ADD16,     0, 2, V,                        0,                                  wr16(p, rd16(p) + v)) \
+        X(RV_ADD32,     0, 4, V,                        0,                                  wr32(p, rd32(p) + v)) \
+        X(RV_ADD64,     0, 8, V,                        0,                                  wr64(p, rd64(p) + v)) \
+        X(RV_SUB6,      0, 1, V,                        0,                                  p[0] = (uint8_t)((p[0] & 0xc0) | ((p[0] - v) & 0x3f))) \
+        X(RV_SUB8,      0, 1, V,                        0,                                  p[0] = (uint8_t)(p[0] - v)) \
+        X(RV_SUB16,     0, 2, V,                        0,                                  wr16(p, rd16(p) - v)) \
+        X(RV_SUB32,     0, 4, V,                        0,                                  wr32(p, rd32(p) - v)) \
+        X(RV_SUB64,     0, 8, V,                        0,                                  wr64(p, rd64(p) - v))
+
+typedef enum
+{
+        K_UNSUPPORTED,
+        K_NONE,
+#define ELFR_ENUM(name, first, size, value, check, store) K_##name,
+        ELFR_KINDS(ELFR_ENUM)
+#undef ELFR_ENUM
+        K_COUNT
+} Kind;
+
+/* Relocation ready to be applied */
+typedef struct
+{
+        uint64_t Offset;
+        uint64_t Value;         // S + A, the value of the PCREL_HI20 for RISC-V PCREL_LO12
+        uint32_t Index;
+        uint32_t Kind;
+} Item;
+
+typedef uint64_t (*ElfrLoop)(uint8_t *bytes, uint64_t address, const Item *items, uint32_t count);
+typedef uint64_t (*ElfrCheck)(uint64_t V, uint64_t P);
+
+/*
+ * One loop per kind and byte order. The overflow bits of the run are or-ed together, the caller
+ * looks for the relocation that failed only when the result isn't 0.
+ */
+#define ELFR_LOOP(name, first, size, value, check, store) \
+        static inline uint64_t value_##name(uint64_t V, uint64_t P) \
+        { \
+                (void)V; \
+                (void)P; \
+                return value; \
+        } \
+        static uint64_t check_##name(uint64_t V, uint64_t P) \
+        { \
+                uint64_t v = value_##name(V, P); \
+                (void)v; \
+                return check; \
+        } \
+        static inline void apply_##name(uint8_t *p, uint64_t v, int be) \
+        { \
+                (void)be; \
+                store; \
+        } \
+        static uint64_t loop_##name##_le(uint8_t *bytes, uint64_t address, const Item *items, uint32_t count) \
+        { \
+                uint64_t bad = 0; \
+                for (uint32_t i = 0; i < count; i++) \
+                { \
+                        uint64_t v = value_##name(items[i].Value, address + items[i].Offset); \
+                        bad |= check; \
+                        apply_##name(bytes + items[i].Offset, v, 0); \
+                } \
+                return bad; \
+        } \
+        static uint64_t loop_##name##_be(uint8_t *bytes, uint64_t address, const Item *items, uint32_t count) \
+        { \
+                uint64_t bad = 0; \
+                for (uint32_t i = 0; i < count; i++) \
+                { \
+                        uint64_t v = value_##name(items[i].Value, address + items[i].Offset); \
+                        bad |= check; \
+                        apply_##name(bytes + items[i].Offset, v, 1); \
+                } \
+                return bad; \
+        }
+
+ELFR_KINDS(ELFR_LOOP)
+#undef ELFR_LOOP
+
+static const struct
+{
+        int8_t First;
+        uint8_t Size;
+        ElfrLoop Loop[2];       // little, big endian data
+        ElfrCheck Check;
+} kinds[K_COUNT] = {
+        [K_UNSUPPORTED] = { 0, 0, { NULL, NULL }, NULL },
+        [K_NONE]        = { 0, 0, { NULL, NULL }, NULL },
+#define ELFR_INFO(name, first, size, value, check, store) \
+        [K_##name] = { first, size, { loop_##name##_le, loop_##name##_be }, check_##name },
+        ELFR_KINDS(ELFR_INFO)
+#undef ELFR_INFO
+};
+
+/***************
+ *  Machines   *
+ ***************/
+
+#define ELFR_MAX_TYPE 320       // the static relocations of the three machines are below
+
+/* Handler table entry of a relocation type, indexed by type */
+typedef struct
+{
+        uint8_t Kind;
+        const char *Name;
+} TypeInfo;
+
+#define T(arch, type, kind) [R_##arch##_##type] = { K_##kind, "R_" #arch "_" #type }
+
+static const TypeInfo x86_64_types[ELFR_MAX_TYPE] = {
+        T(X86_64, NONE,          NONE),
+        T(X86_64, 64,            ABS64),
+        T(X86_64, PC32,          PC32S),
+        T(X86_64, PLT32,         PC32S),       // direct call, there is no PLT
+        T(X86_64, 32,            ABS32U),
+        T(X86_64, 32S,           ABS32S),
+        T(X86_64, 16,            ABS16),
+        T(X86_64, PC16,          PC16),
+        T(X86_64, PC64,          PC64),
+        T(X86_64, GOTPCRELX,     X86_GOT_MOV), // refined from the opcode
+        T(X86_64, REX_GOTPCRELX, X86_GOT_MOV),
+        T(X86_64, GOTPCREL,      UNSUPPORTED),
+};
+
+static const TypeInfo aarch64_types[ELFR_MAX_TYPE] = {
+        T(AARCH64, NONE,                  NONE),
+        T(AARCH64, NONE_OLD,              NONE),
+        T(AARCH64, ABS64,                 ABS64),
+        T(AARCH64, ABS32,                 ABS32),
+        T(AARCH64, ABS16,                 ABS16),
+        T(AARCH64, PREL64,                PC64),
+        T(AARCH64, PREL32,                PC32),
+        T(AARCH64, PREL16,                PC16),
+        T(AARCH64, MOVW_UABS_G0,          A64_MOVW0),
+        T(AARCH64, MOVW_UABS_G0_NC,       A64_MOVW0_NC),
+        T(AARCH64, MOVW_UABS_G1,          A64_MOVW1),
+        T(AARCH64, MOVW_UABS_G1_NC,       A64_MOVW1_NC),
+        T(AARCH64, MOVW_UABS_G2,          A64_MOVW2),
+        T(AARCH64, MOVW_UABS_G2_NC,       A64_MOVW2_NC),
+        T(AARCH64, MOVW_UABS_G3,          A64_MOVW3),
+        T(AARCH64, ADR_PREL_LO21,         A64_ADR),
+        T(AARCH64, ADR_PREL_PG_HI21,      A64_ADRP),
+        T(AARCH64, ADR_PREL_PG_HI21_NC,   A64_ADRP_NC),
+        T(AARCH64, ADD_ABS_LO12_NC,       A64_LO12),
+        T(AARCH64, LDST8_ABS_LO12_NC,     A64_LO12),
+        T(AARCH64, LDST16_ABS_LO12_NC,    A64_LO12_2),
+        T(AARCH64, LDST32_ABS_LO12_NC,    A64_LO12_4),
+        T(AARCH64, LDST64_ABS_LO12_NC,    A64_LO12_8),
+        T(AARCH64, LDST128_ABS_LO12_NC,   A64_LO12_16),
+        T(AARCH64, TSTBR14,               A64_BRANCH14),
+        T(AARCH64, CONDBR19,              A64_BRANCH19),
+        T(AARCH64, JUMP26,                A64_BRANCH26),
+        T(AARCH64, CALL26,                A64_BRANCH26),
+        T(AARCH64, ADR_GOT_PAGE,          UNSUPPORTED),
+        T(AARCH64, LD64_GOT_LO12_NC,      UNSUPPORTED),
+};
+
+static const TypeInfo riscv_types[ELFR_MAX_TYPE] = {
+        T(RISCV, NONE,          NONE),
+        T(RISCV, 32,            ABS32),
+        T(RISCV, 64,            ABS64),
+        T(RISCV, BRANCH,        RV_BRANCH),
+        T(RISCV, JAL,           RV_JAL),
+        T(RISCV, CALL,          RV_CALL),
+        T(RISCV, CALL_PLT,      RV_CALL),
+        T(RISCV, GOT_HI20,      UNSUPPORTED),
+        T(RISCV, PCREL_HI20,    RV_HI20),
+        T(RISCV, PCREL_LO12_I,  RV_LO12_I),   // value taken from the PCREL_HI20
+        T(RISCV, PCREL_LO12_S,  RV_LO12_S),
+        T(RISCV, HI20,          RV_ABS_HI20),
+        T(RISCV, LO12_I,        RV_LO12_I),
+        T(RISCV, LO12_S,        RV_LO12_S),
+        T(RISCV, ADD8,          RV_ADD8),
+        T(RISCV, ADD16,         RV_ADD16),
+        T(RISCV, ADD32,         RV_ADD32),
+        T(RISCV, ADD64,         RV_ADD64),
+        T(RISCV, SUB6,          RV_SUB6),
+        T(RISCV, SUB8,          RV_SUB8),
+        T(RISCV, SUB16,         RV_SUB16),
+        T(RISCV, SUB32,         RV_SUB32),
+        T(RISCV, SUB64,         RV_SUB64),
+        T(RISCV, SET6,          RV_SET6),
+        T(RISCV, SET8,          RV_SET8),
+        T(RISCV, SET16,         RV_SET16),
+        T(RISCV, SET32,         RV_SET32),
+        T(RISCV, ALIGN,         NONE),        // the code isn't relaxed, the padding stays as assembled
+        T(RISCV, RELAX,         NONE),
+        T(RISCV, RVC_BRANCH,    RV_RVC_BRANCH),
+        T(RISCV, RVC_JUMP,      RV_RVC_JUMP),
+        T(RISCV, 32_PCREL,      PC32S),
+        T(RISCV, PLT32,         PC32S),
+};
+
+#undef T
+
+typedef struct
+{
+        ElfMachine Machine;
+        const TypeInfo *Types;
+} Arch;
+
+static const Arch arches[] = {
+        { EM_X86_64,  x86_64_types },
+        { EM_AARCH64, aarch64_types },
+        { EM_RISCV,   riscv_types },
+};
+
+static const Arch *find_arch(ElfMachine machine)
+{
+        for (size_t a = 0; a < sizeof(arches) / sizeof(arches[0]); a++)
+        {
+                if (arches[a].Machine == machine)
+                        return &arches[a];
+        }
+        return NULL;
+}
+
+static inline uint32_t kind_of(const Arch *arch, uint32_t type)
+{
+        return (type < ELFR_MAX_TYPE) ? arch->Types[type].Kind : K_UNSUPPORTED;
+}
+
+const char *elfr_type_name(ElfMachine machine, uint32_t type)
+{
+        const Arch *arch = find_arch(machine);
+
+        if ((arch == NULL) || (type >= ELFR_MAX_TYPE))
+                return NULL;
+        return arch->Types[type].Name;
+}
+
+ElfResult elfr_patch_range(ElfMachine machine, uint32_t type, int32_t *first, uint32_t *size)
+{
+        const Arch *arch = find_arch(machine);
+        uint32_t kind;
+
+        if ((first == NULL) || (size == NULL))
+                return ELF_BAD_ARG;
+
+        if ((arch == NULL) || ((kind = kind_of(arch, type)) == K_UNSUPPORTED))
+                return ELF_BAD_FORMAT;
+
+        *first = kinds[kind].First;
+        *size = kinds[kind].Size;
+        return ELF_OK;
+}
+
+/***************
+ *   Engine    *
+ ***************/
+
+/* PCREL_HI20 relocation of a section, for its PCREL_LO12 relocations */
+typedef struct
+{
+        uint64_t Offset;
+        uint64_t Value;         // S + A - P
+} HiPart;
+
+typedef struct
+{
+        const ElfrTarget *Target;
+        const Arch *Arch;
+        const ElfRelocation *Rels;
+        uint32_t Count;
+        elfr_symbol_callback Resolve;
+        void *UserCtx;
+        ElfrError *Error;
+
+        HiPart *Hi;             // sorted by offset, built on the first PCREL_LO12
+        uint32_t HiCount;
+        bool HiBuilt;
+} Job;
+
+static ElfResult fail(Job *job, uint32_t index, ElfResult res, const char *reason)
+{
+        if (job->Error != NULL)
+        {
+                job->Error->Index = index;
+                job->Error->Reason = reason;
+        }
+        return res;
+}
+
+static int hi_cmp(const void *a, const void *b)
+{
+        const HiPart *ha = a, *hb = b;
+
+        return (ha->Offset > hb->Offset) - (ha->Offset < hb->Offset);
+}
+
+static ElfResult build_hi_parts(Job *job)
+{
+        uint32_t n = 0;
+
+        job->HiBuilt = true;
+        for (uint32_t i = 0; i < job->Count; i++)
+                n += (job->Rels[i].Type == R_RISCV_PCREL_HI20);
+
+        if ((job->Hi = malloc(((size_t)n + 1) * sizeof(HiPart))) == NULL)
+                return fail(job, 0, ELF_NO_MEM, "out of memory");
+
+        for (uint32_t i = 0; i < job->Count; i++)
+        {
+                const ElfRelocation *r = &job->Rels[i];
+                uint64_t S = 0;
+                ElfResult res;
+
+                if (r->Type != R_RISCV_PCREL_HI20)
+                        continue;
+                if ((res = job->Resolve(job->UserCtx, r->Symbol, &S)) != ELF_OK)
+                        return fail(job, i, res, "symbol can't be resolved");
+
+                job->Hi[job->HiCount].Offset = r->Offset;
+                job->Hi[job->HiCount].Value = S + (uint64_t)r->Addend - (job->Target->Address + r->Offset);
+                job->HiCount++;
+        }
+
+        qsort(job->Hi, job->HiCount, sizeof(HiPart), hi_cmp);
+        return ELF_OK;
+}
+
+/** Value of the PCREL_HI20 at an address, for a PCREL_LO12 whose symbol is the auipc. */
+static bool hi_part(const Job *job, uint64_t address, uint64_t *value)
+{
+        uint64_t offset = address - job->Target->Address;
+        uint32_t lo = 0, hi = job->HiCount;
+
+        while (lo < hi)
+        {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (job->Hi[mid].Offset < offset)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        if ((lo == job->HiCount) || (job->Hi[lo].Offset != offset))
+                return false;
+        *value = job->Hi[lo].Value;
+        return true;
+}
+
+/** Turns relocations into items: kind, bounds and the value of the symbol. */
+static ElfResult prepare(Job *job, uint32_t first, uint32_t count, Item *items, uint32_t *n)
+{
+        const ElfrTarget *t = job->Target;
+        ElfResult res;
+
+        *n = 0;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+                const ElfRelocation *r = &job->Rels[i];
+                uint32_t kind = kind_of(job->Arch, r->Type);
+                uint64_t S = 0;
+                Item *it;
+
+                if (kind == K_NONE)
+                        continue;
+                if (kind == K_UNSUPPORTED)
+                        return fail(job, i, ELF_BAD_FORMAT, "unsupported relocation type");
+
+                if ((r->Offset < (uint64_t)-kinds[kind].First) || (r->Offset > t->Size) ||
+                    (t->Size - r->Offset < (uint64_t)(kinds[kind].First + kinds[kind].Size)))
+                        return fail(job, i, ELF_BAD_FORMAT, "relocation outside its section");
+
+                if (kind == K_X86_GOT_MOV)
+                {
+                        const uint8_t *op = t->Bytes + r->Offset - 2;
+
+                        /* mov foo@GOTPCREL(%rip) becomes lea, call and jmp *foo@GOTPCREL(%rip) direct ones */
+                        if ((op[0] == 0xff) && (op[1] == 0x15) && (r->Type == R_X86_64_GOTPCRELX))
+                                kind = K_X86_GOT_CALL;
+                        else if ((op[0] == 0xff) && (op[1] == 0x25) && (r->Type == R_X86_64_GOTPCRELX))
+                                kind = K_X86_GOT_JMP;
+                        else if (op[0] != 0x8b)
+                                return fail(job, i, ELF_BAD_FORMAT, "GOT load that can't be relaxed");
+                }
+
+                if ((res = job->Resolve(job->UserCtx, r->Symbol, &S)) != ELF_OK)
+                        return fail(job, i, res, "symbol can't be resolved");
+
+                it = &items[(*n)++];
+                it->Offset = r->Offset;
+                it->Value = S + (uint64_t)r->Addend;
+                it->Index = i;
+                it->Kind = kind;
+
+                if ((r->Type == R_RISCV_PCREL_LO12_I || r->Type == R_RISCV_PCREL_LO12_S) && (t->Machine == EM_RISCV))
+                {
+                        if (!job->HiBuilt && ((res = build_hi_parts(job)) != ELF_OK))
+                                return res;
+                        if (!hi_part(job, S, &it->Value))
+                                return fail(job, i, ELF_BAD_FORMAT, "PCREL_LO12 without its PCREL_HI20");
+                }
+        }
+        return ELF_OK;
+}
+
+/** Key of the batch order: the page of the field, then the kind. */
+static inline uint64_t item_key(const Item *it, uint64_t base_page)
+{
+        return (((it->Offset >> ELFR_PAGE_SHIFT) - base_page) << 8) | it->Kind;
+}
+
+/** Stable LSD radix sort of a batch on its keys, a pass per significant byte. */
+static Item *sort_items(Item *items, Item *tmp, uint32_t n)
+{
+        uint64_t base = UINT64_MAX, top = 0, prev = 0;
+        bool sorted = true;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+                uint64_t page = items[i].Offset >> ELFR_PAGE_SHIFT;
+                base = (page < base) ? page : base;
+        }
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+                uint64_t key = item_key(&items[i], base);
+
+                sorted = sorted && (key >= prev);
+                prev = key;
+                top |= key;
+        }
+        if (sorted)
+                return items;
+
+        for (uint32_t shift = 0; (shift < 64) && (top >> shift); shift += 8)
+        {
+                uint32_t count[257] = {0};
+                Item *swap;
+
+                for (uint32_t i = 0; i < n; i++)
+                        count[((item_key(&items[i], base) >> shift) & 0xff) + 1]++;
+                for (uint32_t b = 1; b < 257; b++)
+                        count[b] += count[b - 1];
+                for (uint32_t i = 0; i < n; i++)
+                        tmp[count[(item_key(&items[i], base) >> shift) & 0xff]++] = items[i];
+
+                swap = items;
+                items = tmp;
+                tmp = swap;
+        }
+        return items;
+}
+
+ElfResult elfr_apply(const ElfrTarget *target, const ElfRelocation *rels, uint32_t count,
+                     elfr_symbol_callback resolve, void *user_ctx, ElfrError *error)
+{
+        Item buf[2][ELFR_BATCH];
+        uint32_t bad = UINT32_MAX;
+        ElfResult res = ELF_OK;
+        Job job = {0};
+        int be;
+
+        if ((target == NULL) || (resolve == NULL) || ((rels == NULL) && (count != 0)) ||
+            ((target->Bytes == NULL) && (target->Size != 0)))
+                return ELF_BAD_ARG;
+
+        if ((job.Arch = find_arch(target->Machine)) == NULL)
+                return ELF_BAD_HEADER;
+
+        job.Target = target;
+        job.Rels = rels;
+        job.Count = count;
+        job.Resolve = resolve;
+        job.UserCtx = user_ctx;
+        job.Error = error;
+        be = (target->Data == ELFDATA2MSB);
+
+        for (uint32_t first = 0; first < count; first += ELFR_BATCH)
+        {
+                uint32_t n, size = (count - first < ELFR_BATCH) ? count - first : ELFR_BATCH;
+                Item *items;
+
+                if ((res = prepare(&job, first, size, buf[0], &n)) != ELF_OK)
+                        break;
+
+                items = sort_items(buf[0], buf[1], n);
+
+                /* runs of one kind go through its loop */
+                for (uint32_t i = 0, end; i < n; i = end)
+                {
+                        uint32_t kind = items[i].Kind;
+
+                        for (end = i + 1; (end < n) && (items[end].Kind == kind); end++)
+                                ;
+
+                        if (kinds[kind].Loop[be](target->Bytes, target->Address, items + i, end - i) == 0)
+                                continue;
+
+                        /* slow path, the first relocation of the batch that doesn't fit */
+                        for (uint32_t k = i; k < end; k++)
+                        {
+                                if (kinds[kind].Check(items[k].Value, target->Address + items[k].Offset) &&
+                                    (items[k].Index < bad))
+                                        bad = items[k].Index;
+                        }
+                }
+                if (bad != UINT32_MAX)
+                {
+                        res = fail(&job, bad, ELF_BAD_FORMAT, "relocation value out of range");
+                        break;
+                }
+        }
+
+        free(job.Hi);
+        return res;
+}
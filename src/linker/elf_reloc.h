@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ELFR_LIB
+#define ELFR_LIB
+
+#include "common/elf_core.h"
+#include "common/elf_machines.h"
+
+/**
+ * Relocation engine: patches the bytes of a section with its decoded REL/RELA entries, for the
+ * linker and for loaders that place relocatable code in memory themselves.
+ *
+ * Each machine has a table mapping its relocation types to a small set of kinds (the same
+ * computation and encoding, like "32-bit PC relative data" or "AArch64 26-bit branch"), and each
+ * kind has its own loop applying a run of relocations with the computation and the store inlined.
+ * Relocations are taken in batches: their symbols are resolved, the batch is sorted by target page
+ * and by kind, and the runs of one kind are handed to their loop. Range checks don't branch, the
+ * loops accumulate the overflow bits of a run and only a failed run is checked again entry by entry.
+ *
+ * Supported: the static relocations of x86-64, AArch64 and RISC-V (RV32 and RV64) that don't need
+ * a GOT, a PLT or TLS. x86-64 GOT loads and calls are relaxed to direct ones. RISC-V code is never
+ * relaxed, R_RISCV_RELAX and R_RISCV_ALIGN are accepted and leave the code as assembled.
+ */
+
+/***************
+ *   Engine    *
+ ***************/
+        /**
+         * @brief Section to patch.
+         */
+        typedef struct
+        {
+                ElfMachine Machine;
+                EiData Data;            // Byte order of the data relocations, instructions are little endian
+                uint8_t *Bytes;         // Contents of the section
+                uint64_t Size;
+                uint64_t Address;       // Address of Bytes[0] once loaded, P is Address + Offset
+        } ElfrTarget;
+
+        /**
+         * @brief Resolves the symbol of a relocation.
+         *
+         * @param user_ctx  User provided context.
+         * @param symbol    Index in the symbol table of the relocation section, 0 for none.
+         * @param value     (out) Address of the symbol, S in the psABI formulas. 0 for symbol 0.
+         *
+         * @return ELF_OK, any other value stops elfr_apply() with that error.
+         */
+        typedef ElfResult (*elfr_symbol_callback)(void *user_ctx, uint32_t symbol, uint64_t *value);
+
+        /**
+         * @brief Relocation that stopped elfr_apply().
+         */
+        typedef struct
+        {
+                uint32_t Index;         // In the array given to elfr_apply()
+                const char *Reason;
+        } ElfrError;
+
+        /**
+         * @brief Applies relocations to the bytes of a section.
+         *
+         * @param target    Section to patch.
+         * @param rels      Relocations, in any order. REL entries (Addend 0) are applied like RELA ones,
+         *                  decode the implicit addends from the section first.
+         * @param count     Number of relocations.
+         * @param resolve   Symbol resolution callback, called once per relocation.
+         * @param user_ctx  Passed to the callback.
+         * @param error     (out) Failed relocation, may be NULL.
+         *
+         * @return Error code, ELF_BAD_HEADER for a machine without handlers, ELF_BAD_FORMAT for an
+         *         unsupported type, a value out of range and a relocation outside the section, or the
+         *         error of the callback. On failure the section is left partially patched.
+         */
+        ElfResult elfr_apply(const ElfrTarget *target, const ElfRelocation *rels, uint32_t count,
+                             elfr_symbol_callback resolve, void *user_ctx, ElfrError *error);
+
+        /**
+         * @param machine   Machine of the relocation.
+         * @param type      Relocation type.
+         * @param first     (out) Offset of the first byte written, relative to the relocation Offset.
+         *                  Negative when an instruction before the field is rewritten.
+         * @param size      (out) Number of bytes written from there, at most 8. 0 for types that write
+         *                  nothing.
+         *
+         * @return ELF_OK, ELF_BAD_FORMAT if elfr_apply() doesn't handle the type.
+         *
+         * @brief Bytes elfr_apply() may write for one relocation, to copy the patched bytes elsewhere.
+         */
+        ElfResult elfr_patch_range(ElfMachine machine, uint32_t type, int32_t *first, uint32_t *size);
+
+        /**
+         * @param machine   Machine of the relocation.
+         * @param type      Relocation type.
+         *
+         * @return psABI name of the type, NULL if it isn't known to the engine.
+         */
+        const char *elfr_type_name(ElfMachine machine, uint32_t type);
+
+#endif // Include guard;
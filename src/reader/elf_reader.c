@@ -28,6 +28,15 @@
 
 #define CTX(ctx) ((InternalElfCtx *)(ctx))
 
+/**
+ * Bytes read per callback call by the batch functions, rounded down to whole entries. The buffer
+ * lives on the stack, the default keeps the frames small for bootloaders, hosted builds may raise it.
+ */
+#ifndef ELF_BATCH_BYTES
+#define ELF_BATCH_BYTES 768
+#endif
+_Static_assert(ELF_BATCH_BYTES >= sizeof(Elf64SecHeader), "ELF_BATCH_BYTES must hold the largest entry");
+
 typedef struct
 {
         uint8_t initialized;
@@ -151,6 +160,8 @@ ElfResult elf_init(void *user_ctx, elf_read_callback callback, ElfCtx *ctx)
                 return ELF_BAD_ENDIANNESS;
         }
 
+        CTX(ctx)->Hdr.EI_Class = CTX(ctx)->Class;
+        CTX(ctx)->Hdr.EI_Data = CTX(ctx)->Endianness;
         CTX(ctx)->Hdr.EI_OS_ABI = (ElfABI)hdr_info.EI_OS_ABI;
         CTX(ctx)->Hdr.EI_ABI_Version = hdr_info.EI_ABI_Version;
 
@@ -180,6 +191,7 @@ ElfResult elf_init(void *user_ctx, elf_read_callback callback, ElfCtx *ctx)
                         CTX(ctx)->Hdr.Entry       = (uint64_t)read_32(&((Elf32Header *)header_buff)->e_entry,     CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.ProHeadOff  = (uint64_t)read_32(&((Elf32Header *)header_buff)->e_phoff,     CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.SecHeadOff  = (uint64_t)read_32(&((Elf32Header *)header_buff)->e_shoff,     CTX(ctx)->Endianness);
+                        CTX(ctx)->Hdr.Flags       =           read_32(&((Elf32Header *)header_buff)->e_flags,     CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.HeadSize    =           read_16(&((Elf32Header *)header_buff)->e_ehsize,    CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.PHEntrySize =           read_16(&((Elf32Header *)header_buff)->e_phentsize, CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.PHEntryNum  =           read_16(&((Elf32Header *)header_buff)->e_phnum,     CTX(ctx)->Endianness);
@@ -211,6 +223,7 @@ ElfResult elf_init(void *user_ctx, elf_read_callback callback, ElfCtx *ctx)
                         CTX(ctx)->Hdr.Entry       = read_64(&((Elf64Header *)header_buff)->e_entry,     CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.ProHeadOff  = read_64(&((Elf64Header *)header_buff)->e_phoff,     CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.SecHeadOff  = read_64(&((Elf64Header *)header_buff)->e_shoff,     CTX(ctx)->Endianness);
+                        CTX(ctx)->Hdr.Flags       = read_32(&((Elf64Header *)header_buff)->e_flags,     CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.HeadSize    = read_16(&((Elf64Header *)header_buff)->e_ehsize,    CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.PHEntrySize = read_16(&((Elf64Header *)header_buff)->e_phentsize, CTX(ctx)->Endianness);
                         CTX(ctx)->Hdr.PHEntryNum  = read_16(&((Elf64Header *)header_buff)->e_phnum,     CTX(ctx)->Endianness);
@@ -245,15 +258,31 @@ ElfResult elf_init(void *user_ctx, elf_read_callback callback, ElfCtx *ctx)
                         return ELF_BAD_HEADER;
                 }
 
-                /* detect special indexes and get the proper values for the fields. */
-                if (CTX(ctx)->Hdr.SHEntryNum == SHN_UNDEF || CTX(ctx)->Hdr.SecStrIndx == SHN_XINDEX)
+                /* detect special indexes and get the proper values for the fields, a zero count without
+                   a table is a file without sections. */
+                if ((CTX(ctx)->Hdr.SHEntryNum == SHN_UNDEF && CTX(ctx)->Hdr.SecHeadOff != 0) || CTX(ctx)->Hdr.SecStrIndx == SHN_XINDEX)
                 {
+                        uint8_t extended_count = (CTX(ctx)->Hdr.SHEntryNum == SHN_UNDEF);
+
                         if (CTX(ctx)->Hdr.SecHeadOff == 0)
                         {
                                 return ELF_BAD_HEADER;
                         }
 
+                        /* the entry size checks above are skipped for a zero e_shnum, the table is used from here on */
+                        if (CTX(ctx)->Hdr.SHEntrySize != ((CTX(ctx)->Class == ELFCLASS32) ? sizeof(Elf32SecHeader) : sizeof(Elf64SecHeader)))
+                        {
+                                return ELF_BAD_SIZE;
+                        }
+
+                        /* the null section goes through the regular path, which needs a usable context */
+                        if (extended_count)
+                        {
+                                CTX(ctx)->Hdr.SHEntryNum = 1;
+                        }
+                        CTX(ctx)->initialized = true;
                         res = get_section_header(ctx, 0, &null_sec);
+                        CTX(ctx)->initialized = false;
                         if (res)
                         {
                                 return res;
@@ -264,9 +293,13 @@ ElfResult elf_init(void *user_ctx, elf_read_callback callback, ElfCtx *ctx)
                                 return ELF_BAD_FORMAT;
                         }
 
-                        if (CTX(ctx)->Hdr.SHEntryNum == SHN_UNDEF)
+                        if (extended_count)
                         {
-                                CTX(ctx)->Hdr.SHEntryNum = null_sec.Size;
+                                if (null_sec.Size > UINT32_MAX)
+                                {
+                                        return ELF_BAD_HEADER;
+                                }
+                                CTX(ctx)->Hdr.SHEntryNum = (uint32_t)null_sec.Size;
                         }
 
                         if (CTX(ctx)->Hdr.SecStrIndx == SHN_XINDEX)
@@ -299,7 +332,7 @@ ElfResult get_header(const ElfCtx *ctx, ElfHeader *header)
         return res;
 }
 
-uint16_t get_section_count(const ElfCtx *ctx)
+uint32_t get_section_count(const ElfCtx *ctx)
 {
         /* This function is designed to facilitate iterating over the sections,
         returning an error would make this fucntion useless as it would require
@@ -323,6 +356,87 @@ uint16_t get_program_header_count(const ElfCtx *ctx)
         return CTX(ctx)->Hdr.PHEntryNum;
 }
 
+/** internal fuction, decodes and validates one raw section header of the file's class and endianness */
+static ElfResult decode_section_header(const ElfCtx *ctx, const uint8_t *sec_head_buff, ElfSecHeader *sec_header)
+{
+        sec_header->NameIdx = read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_name), CTX(ctx)->Endianness);
+        sec_header->Type    = read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_type), CTX(ctx)->Endianness);
+
+        if (CTX(ctx)->Class == ELFCLASS32)
+        {
+                sec_header->Flags     = (uint64_t) read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_flags),     CTX(ctx)->Endianness);
+                sec_header->Address   = (uint64_t) read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_addr),      CTX(ctx)->Endianness);
+                sec_header->Offset    = (uint64_t) read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_offset),    CTX(ctx)->Endianness);
+                sec_header->Size      = (uint64_t) read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_size),      CTX(ctx)->Endianness);
+                sec_header->Link      =            read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_link),      CTX(ctx)->Endianness);
+                sec_header->Info      =            read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_info),      CTX(ctx)->Endianness);
+                sec_header->Alignment = (uint64_t) read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_addralign), CTX(ctx)->Endianness);
+                sec_header->EntrySize = (uint64_t) read_32(&(((const Elf32SecHeader *)sec_head_buff)->sh_entsize),   CTX(ctx)->Endianness);
+        
+                /* Perform validation based on section type */
+                if ((sec_header->Type == SHT_RELA) && (sec_header->EntrySize != sizeof(Elf32Rela)))
+                {
+                        return ELF_BAD_SIZE;
+                }
+                if ((sec_header->Type == SHT_REL) && (sec_header->EntrySize != sizeof(Elf32Rel)))
+                {
+                        return ELF_BAD_SIZE;
+                }
+                if ((sec_header->Type == SHT_RELR) && (sec_header->EntrySize != sizeof(Elf32Relr)))
+                {
+                        return ELF_BAD_SIZE;
+                }
+                if ((sec_header->Type == SHT_DYNSYM || sec_header->Type == SHT_SYMTAB) 
+                && (sec_header->EntrySize != sizeof(Elf32SymEntry)))
+                {
+                        return ELF_BAD_SIZE;
+                }
+        }
+        else // 64 bit
+        {
+                sec_header->Flags     = read_64(&(((const Elf64SecHeader *)sec_head_buff)->sh_flags),     CTX(ctx)->Endianness);
+                sec_header->Address   = read_64(&(((const Elf64SecHeader *)sec_head_buff)->sh_addr),      CTX(ctx)->Endianness);
+                sec_header->Offset    = read_64(&(((const Elf64SecHeader *)sec_head_buff)->sh_offset),    CTX(ctx)->Endianness);
+                sec_header->Size      = read_64(&(((const Elf64SecHeader *)sec_head_buff)->sh_size),      CTX(ctx)->Endianness);
+                sec_header->Link      = read_32(&(((const Elf64SecHeader *)sec_head_buff)->sh_link),      CTX(ctx)->Endianness);
+                sec_header->Info      = read_32(&(((const Elf64SecHeader *)sec_head_buff)->sh_info),      CTX(ctx)->Endianness);
+                sec_header->Alignment = read_64(&(((const Elf64SecHeader *)sec_head_buff)->sh_addralign), CTX(ctx)->Endianness);
+                sec_header->EntrySize = read_64(&(((const Elf64SecHeader *)sec_head_buff)->sh_entsize),   CTX(ctx)->Endianness);
+        
+                /* Perform validation based on section type */
+                if ((sec_header->Type == SHT_RELA) && (sec_header->EntrySize != sizeof(Elf64Rela)))
+                {
+                        return ELF_BAD_SIZE;
+                }
+                if ((sec_header->Type == SHT_REL) && (sec_header->EntrySize != sizeof(Elf64Rel)))
+                {
+                        return ELF_BAD_SIZE;
+                }
+                if ((sec_header->Type == SHT_RELR) && (sec_header->EntrySize != sizeof(Elf64Relr)))
+                {
+                        return ELF_BAD_SIZE;
+                }
+                if ((sec_header->Type == SHT_DYNSYM || sec_header->Type == SHT_SYMTAB) 
+                && (sec_header->EntrySize != sizeof(Elf64SymEntry)))
+                {
+                        return ELF_BAD_SIZE;
+                }
+        }
+        
+        if (((sec_header->Flags & SHF_COMPRESSED) && (sec_header->Flags & SHF_ALLOC))
+         || ((sec_header->Flags & SHF_COMPRESSED) &&  (sec_header->Type == SHT_NOBITS)))
+        {
+                return ELF_BAD_FORMAT;
+        }
+
+        if (sec_header->Type == SHT_GROUP && CTX(ctx)->Hdr.Type != ET_REL)
+        {
+                return ELF_BAD_FORMAT;
+        }
+
+        return ELF_OK;
+}
+
 ElfResult get_section_header(const ElfCtx *ctx, uint32_t idx, ElfSecHeader *sec_header)
 {
         /*
@@ -365,81 +479,55 @@ ElfResult get_section_header(const ElfCtx *ctx, uint32_t idx, ElfSecHeader *sec_
         {
                 res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, (CTX(ctx)->Hdr.SecHeadOff) + idx * (CTX(ctx)->Hdr.SHEntrySize), sizeof(Elf64SecHeader), sec_head_buff);
         }
-        if(!res)
+        if (!res)
         {
-                sec_header->NameIdx = read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_name), CTX(ctx)->Endianness);
-                sec_header->Type    = read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_type), CTX(ctx)->Endianness);
+                res = decode_section_header(ctx, sec_head_buff, sec_header);
+        }
 
-                if (CTX(ctx)->Class == ELFCLASS32)
-                {
-                        sec_header->Flags     = (uint64_t) read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_flags),     CTX(ctx)->Endianness);
-                        sec_header->Address   = (uint64_t) read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_addr),      CTX(ctx)->Endianness);
-                        sec_header->Offset    = (uint64_t) read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_offset),    CTX(ctx)->Endianness);
-                        sec_header->Size      = (uint64_t) read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_size),      CTX(ctx)->Endianness);
-                        sec_header->Link      =            read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_link),      CTX(ctx)->Endianness);
-                        sec_header->Info      =            read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_info),      CTX(ctx)->Endianness);
-                        sec_header->Alignment = (uint64_t) read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_addralign), CTX(ctx)->Endianness);
-                        sec_header->EntrySize = (uint64_t) read_32(&(((Elf32SecHeader *)sec_head_buff)->sh_entsize),   CTX(ctx)->Endianness);
-                
-                        /* Perform validation based on section type */
-                        if ((sec_header->Type == SHT_RELA) && (sec_header->EntrySize != sizeof(Elf32Rela)))
-                        {
-                                return ELF_BAD_SIZE;
-                        }
-                        if ((sec_header->Type == SHT_REL) && (sec_header->EntrySize != sizeof(Elf32Rel)))
-                        {
-                                return ELF_BAD_SIZE;
-                        }
-                        if ((sec_header->Type == SHT_RELR) && (sec_header->EntrySize != sizeof(Elf32Relr)))
-                        {
-                                return ELF_BAD_SIZE;
-                        }
-                        if ((sec_header->Type == SHT_DYNSYM || sec_header->Type == SHT_SYMTAB) 
-                        && (sec_header->EntrySize != sizeof(Elf32SymEntry)))
-                        {
-                                return ELF_BAD_SIZE;
-                        }
-                }
-                else // 64 bit
-                {
-                        sec_header->Flags     = read_64(&(((Elf64SecHeader *)sec_head_buff)->sh_flags),     CTX(ctx)->Endianness);
-                        sec_header->Address   = read_64(&(((Elf64SecHeader *)sec_head_buff)->sh_addr),      CTX(ctx)->Endianness);
-                        sec_header->Offset    = read_64(&(((Elf64SecHeader *)sec_head_buff)->sh_offset),    CTX(ctx)->Endianness);
-                        sec_header->Size      = read_64(&(((Elf64SecHeader *)sec_head_buff)->sh_size),      CTX(ctx)->Endianness);
-                        sec_header->Link      = read_32(&(((Elf64SecHeader *)sec_head_buff)->sh_link),      CTX(ctx)->Endianness);
-                        sec_header->Info      = read_32(&(((Elf64SecHeader *)sec_head_buff)->sh_info),      CTX(ctx)->Endianness);
-                        sec_header->Alignment = read_64(&(((Elf64SecHeader *)sec_head_buff)->sh_addralign), CTX(ctx)->Endianness);
-                        sec_header->EntrySize = read_64(&(((Elf64SecHeader *)sec_head_buff)->sh_entsize),   CTX(ctx)->Endianness);
-                
-                        /* Perform validation based on section type */
-                        if ((sec_header->Type == SHT_RELA) && (sec_header->EntrySize != sizeof(Elf64Rela)))
-                        {
-                                return ELF_BAD_SIZE;
-                        }
-                        if ((sec_header->Type == SHT_REL) && (sec_header->EntrySize != sizeof(Elf64Rel)))
-                        {
-                                return ELF_BAD_SIZE;
-                        }
-                        if ((sec_header->Type == SHT_RELR) && (sec_header->EntrySize != sizeof(Elf64Relr)))
-                        {
-                                return ELF_BAD_SIZE;
-                        }
-                        if ((sec_header->Type == SHT_DYNSYM || sec_header->Type == SHT_SYMTAB) 
-                        && (sec_header->EntrySize != sizeof(Elf64SymEntry)))
-                        {
-                                return ELF_BAD_SIZE;
-                        }
-                }
-                
-                if (((sec_header->Flags & SHF_COMPRESSED) && (sec_header->Flags & SHF_ALLOC))
-                 || ((sec_header->Flags & SHF_COMPRESSED) &&  (sec_header->Type == SHT_NOBITS)))
-                {
-                        return ELF_BAD_FORMAT;
-                }
+        return res;
+}
+
+ElfResult get_section_headers(const ElfCtx *ctx, uint32_t first, uint32_t count, ElfSecHeader *sec_headers)
+{
+        /*
+         * Same checks as get_section_header(), the table is read in chunks of
+         * ELF_BATCH_BYTES so a whole table costs a few callback calls.
+         */
+
+        ElfResult res = ELF_OK;
+        uint64_t raw[ELF_BATCH_BYTES / sizeof(uint64_t)];
+        uint32_t per_read;
+
+        if (validate_ctx(ctx))
+        {
+                return ELF_UNINIT;
+        }
+
+        if ((sec_headers == NULL) && (count != 0))
+        {
+                return ELF_BAD_ARG;
+        }
 
-                if (sec_header->Type == SHT_GROUP && CTX(ctx)->Hdr.Type != ET_REL)
+        if ((first > CTX(ctx)->Hdr.SHEntryNum) || (count > CTX(ctx)->Hdr.SHEntryNum - first))
+        {
+                return ELF_BAD_INDX;
+        }
+
+        per_read = (CTX(ctx)->Hdr.SHEntrySize != 0) ? ELF_BATCH_BYTES / CTX(ctx)->Hdr.SHEntrySize : 0;
+        if ((per_read == 0) && (count != 0))
+        {
+                return ELF_BAD_SIZE;
+        }
+
+        for (uint32_t done = 0; (done < count) && !res; done += per_read)
+        {
+                uint32_t n = (count - done < per_read) ? count - done : per_read;
+                uint64_t offset = CTX(ctx)->Hdr.SecHeadOff + (uint64_t)(first + done) * CTX(ctx)->Hdr.SHEntrySize;
+
+                res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, offset, (uint64_t)n * CTX(ctx)->Hdr.SHEntrySize, raw);
+                for (uint32_t i = 0; (i < n) && !res; i++)
                 {
-                        return ELF_BAD_FORMAT;
+                        res = decode_section_header(ctx, (const uint8_t *)raw + i * CTX(ctx)->Hdr.SHEntrySize, &sec_headers[done + i]);
                 }
         }
 
@@ -498,6 +586,38 @@ ElfResult get_section_name(const ElfCtx *ctx, const ElfSecHeader *sec_header, ui
         return internal_get_str_from_offset(ctx, offset, buff, len);
 }
 
+ElfResult get_section_data(const ElfCtx *ctx, const ElfSecHeader *sec_header, uint64_t offset, uint64_t size, void *buff)
+{
+        if (validate_ctx(ctx))
+        {
+                return ELF_UNINIT;
+        }
+
+        if ((sec_header == NULL) || (buff == NULL))
+        {
+                return ELF_BAD_ARG;
+        }
+
+        /* NOBITS sections occupy no space in the file */
+        if (sec_header->Type == SHT_NOBITS)
+        {
+                return ELF_BAD_SECTION_TYPE;
+        }
+
+        /* written to avoid overflowing offset + size */
+        if ((offset > sec_header->Size) || (size > sec_header->Size - offset))
+        {
+                return ELF_BAD_INDX;
+        }
+
+        if (size == 0)
+        {
+                return ELF_OK;
+        }
+
+        return CTX(ctx)->Callback(CTX(ctx)->UserCtx, sec_header->Offset + offset, size, buff);
+}
+
 ElfResult get_section_by_name(const ElfCtx *ctx, const uint8_t *name, ElfSecHeader *sec)
 {
         uint8_t sec_name[256];
@@ -563,6 +683,35 @@ uint32_t get_symbol_count(const ElfCtx *ctx, const ElfSecHeader *sym_tab)
 
 }
 
+/** internal fuction, decodes one raw symbol of the file's class and endianness */
+static void decode_symbol_entry(const ElfCtx *ctx, const uint8_t *sym_buff, ElfSymTabEntry *sym)
+{
+        if (CTX(ctx)->Class == ELFCLASS32)
+        {
+                sym->NameIdx =            read_32(&(((const Elf32SymEntry *)sym_buff)->st_name),  CTX(ctx)->Endianness);
+                sym->Value   = (uint64_t) read_32(&(((const Elf32SymEntry *)sym_buff)->st_value), CTX(ctx)->Endianness);
+                sym->Size    = (uint64_t) read_32(&(((const Elf32SymEntry *)sym_buff)->st_size),  CTX(ctx)->Endianness);
+                sym->Type    =        ELF32_ST_TYPE(((const Elf32SymEntry *)sym_buff)->st_info);
+                sym->Binding =        ELF32_ST_BIND(((const Elf32SymEntry *)sym_buff)->st_info);
+                sym->Visib   =  ELF32_ST_VISIBILITY(((const Elf32SymEntry *)sym_buff)->st_other);
+                sym->SecIdx  =            read_16(&(((const Elf32SymEntry *)sym_buff)->st_shndx), CTX(ctx)->Endianness);
+        }
+        else // 64 bit
+        {
+                sym->NameIdx =           read_32(&(((const Elf64SymEntry *)sym_buff)->st_name),  CTX(ctx)->Endianness);
+                sym->Type    =       ELF32_ST_TYPE(((const Elf64SymEntry *)sym_buff)->st_info);
+                sym->Binding =       ELF32_ST_BIND(((const Elf64SymEntry *)sym_buff)->st_info);
+                sym->SecIdx  =           read_16(&(((const Elf64SymEntry *)sym_buff)->st_shndx), CTX(ctx)->Endianness);
+                sym->Value   =           read_64(&(((const Elf64SymEntry *)sym_buff)->st_value), CTX(ctx)->Endianness);
+                sym->Visib   = ELF64_ST_VISIBILITY(((const Elf64SymEntry *)sym_buff)->st_other);
+                sym->Size    =           read_64(&(((const Elf64SymEntry *)sym_buff)->st_size),  CTX(ctx)->Endianness);
+        }
+        
+        //TODO: any checks?
+        //TODO: handle special secIdx (SHN_XINDEX pg 30)
+        //TODO: manage my attributes implementation
+}
+
 ElfResult get_symbol_entry(const ElfCtx *ctx, const ElfSecHeader *sym_tab, uint32_t idx, ElfSymTabEntry *sym)
 {
         ElfResult res = ELF_OK;
@@ -582,33 +731,48 @@ ElfResult get_symbol_entry(const ElfCtx *ctx, const ElfSecHeader *sym_tab, uint3
         {
                 res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, (sym_tab->Offset) + idx * (sym_tab->EntrySize), sizeof(Elf64SymEntry), sym_buff);
         }
-        if(!res)
+        if (!res)
         {
-                
-                if (CTX(ctx)->Class == ELFCLASS32)
-                {
-                        sym->NameIdx =            read_32(&(((Elf32SymEntry *)sym_buff)->st_name),  CTX(ctx)->Endianness);
-                        sym->Value   = (uint64_t) read_32(&(((Elf32SymEntry *)sym_buff)->st_value), CTX(ctx)->Endianness);
-                        sym->Size    = (uint64_t) read_32(&(((Elf32SymEntry *)sym_buff)->st_size),  CTX(ctx)->Endianness);
-                        sym->Type    =        ELF32_ST_TYPE(((Elf32SymEntry *)sym_buff)->st_info);
-                        sym->Binding =        ELF32_ST_BIND(((Elf32SymEntry *)sym_buff)->st_info);
-                        sym->Visib   =  ELF32_ST_VISIBILITY(((Elf32SymEntry *)sym_buff)->st_other);
-                        sym->SecIdx  =            read_16(&(((Elf32SymEntry *)sym_buff)->st_shndx), CTX(ctx)->Endianness);
-                }
-                else // 64 bit
-                {
-                        sym->NameIdx =           read_32(&(((Elf64SymEntry *)sym_buff)->st_name),  CTX(ctx)->Endianness);
-                        sym->Type    =       ELF32_ST_TYPE(((Elf64SymEntry *)sym_buff)->st_info);
-                        sym->Binding =       ELF32_ST_BIND(((Elf64SymEntry *)sym_buff)->st_info);
-                        sym->SecIdx  =           read_16(&(((Elf64SymEntry *)sym_buff)->st_shndx), CTX(ctx)->Endianness);
-                        sym->Value   =           read_64(&(((Elf64SymEntry *)sym_buff)->st_value), CTX(ctx)->Endianness);
-                        sym->Visib   = ELF64_ST_VISIBILITY(((Elf64SymEntry *)sym_buff)->st_other);
-                        sym->Size    =           read_64(&(((Elf64SymEntry *)sym_buff)->st_size),  CTX(ctx)->Endianness);
-                }
-                
-                //TODO: any checks?
-                //TODO: handle special secIdx (SHN_XINDEX pg 30)
-                //TODO: manage my attributes implementation
+                decode_symbol_entry(ctx, sym_buff, sym);
+        }
+        return res;
+}
+
+ElfResult get_symbol_entries(const ElfCtx *ctx, const ElfSecHeader *sym_tab, uint32_t first, uint32_t count, ElfSymTabEntry *syms)
+{
+        ElfResult res = ELF_OK;
+        uint64_t raw[ELF_BATCH_BYTES / sizeof(uint64_t)];
+        uint64_t entry_size;
+        uint32_t sym_cnt, per_read;
+
+        if (validate_ctx(ctx))
+                return ELF_UNINIT;
+
+        entry_size = (CTX(ctx)->Class == ELFCLASS32) ? sizeof(Elf32SymEntry) : sizeof(Elf64SymEntry);
+
+        if ((sym_tab == NULL) || ((syms == NULL) && (count != 0)))
+                return ELF_BAD_ARG;
+
+        if ((sym_tab->Type != SHT_DYNSYM) && (sym_tab->Type != SHT_SYMTAB))
+                return ELF_BAD_SECTION_TYPE;
+
+        /* the entries are decoded from a packed buffer, any other stride would misplace them */
+        if (sym_tab->EntrySize != entry_size)
+                return ELF_BAD_SIZE;
+
+        sym_cnt = get_symbol_count(ctx, sym_tab);
+        if ((first > sym_cnt) || (count > sym_cnt - first))
+                return ELF_BAD_INDX;
+
+        per_read = ELF_BATCH_BYTES / entry_size;
+
+        for (uint32_t done = 0; (done < count) && !res; done += per_read)
+        {
+                uint32_t n = (count - done < per_read) ? count - done : per_read;
+
+                res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, sym_tab->Offset + (first + done) * entry_size, n * entry_size, raw);
+                for (uint32_t i = 0; (i < n) && !res; i++)
+                        decode_symbol_entry(ctx, (const uint8_t *)raw + i * entry_size, &syms[done + i]);
         }
         return res;
 }
@@ -730,11 +894,11 @@ ElfResult get_program_header(const ElfCtx *ctx, uint32_t idx, ElfProHeader *prog
 
         if (CTX(ctx)->Class == ELFCLASS32)
         {
-                res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, (CTX(ctx)->Hdr.ProHeadOff) + idx * (CTX(ctx)->Hdr.PHEntrySize), sizeof(Elf32SecHeader), prog_head_buff);
+                res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, (CTX(ctx)->Hdr.ProHeadOff) + idx * (CTX(ctx)->Hdr.PHEntrySize), sizeof(Elf32ProHeader), prog_head_buff);
         }
         else
         {
-                res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, (CTX(ctx)->Hdr.ProHeadOff) + idx * (CTX(ctx)->Hdr.PHEntrySize), sizeof(Elf64SecHeader), prog_head_buff);
+                res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, (CTX(ctx)->Hdr.ProHeadOff) + idx * (CTX(ctx)->Hdr.PHEntrySize), sizeof(Elf64ProHeader), prog_head_buff);
         }
         if(!res)
         {
@@ -769,6 +933,83 @@ ElfResult get_program_header(const ElfCtx *ctx, uint32_t idx, ElfProHeader *prog
 }
 
 
+uint32_t get_relocation_count(const ElfCtx *ctx, const ElfSecHeader *rel_sec)
+{
+        /* same as get_symbol_count(), 0 makes the iteration empty */
+        if (validate_ctx(ctx) || (rel_sec == NULL) || (rel_sec->EntrySize == 0) ||
+            ((rel_sec->Type != SHT_REL) && (rel_sec->Type != SHT_RELA)))
+                return 0;
+
+        return (uint32_t)(rel_sec->Size / rel_sec->EntrySize);
+}
+
+/** internal fuction, decodes one raw REL or RELA entry of the file's class and endianness */
+static void decode_relocation_entry(const ElfCtx *ctx, const uint8_t *rel_buff, bool rela, ElfRelocation *rel)
+{
+        if (CTX(ctx)->Class == ELFCLASS32)
+        {
+                uint32_t info = read_32(&(((const Elf32Rela *)rel_buff)->r_info), CTX(ctx)->Endianness);
+
+                rel->Offset = (uint64_t) read_32(&(((const Elf32Rela *)rel_buff)->r_offset), CTX(ctx)->Endianness);
+                rel->Symbol = ELF32_R_SYM(info);
+                rel->Type   = ELF32_R_TYPE(info);
+                rel->Addend = rela ? (int32_t)read_32((const uint32_t *)&(((const Elf32Rela *)rel_buff)->r_addend), CTX(ctx)->Endianness) : 0;
+        }
+        else // 64 bit
+        {
+                uint64_t info = read_64(&(((const Elf64Rela *)rel_buff)->r_info), CTX(ctx)->Endianness);
+
+                rel->Offset = read_64(&(((const Elf64Rela *)rel_buff)->r_offset), CTX(ctx)->Endianness);
+                rel->Symbol = (uint32_t)ELF64_R_SYM(info);
+                rel->Type   = (uint32_t)ELF64_R_TYPE(info);
+                rel->Addend = rela ? (int64_t)read_64((const uint64_t *)&(((const Elf64Rela *)rel_buff)->r_addend), CTX(ctx)->Endianness) : 0;
+        }
+}
+
+ElfResult get_relocation_entries(const ElfCtx *ctx, const ElfSecHeader *rel_sec, uint32_t first, uint32_t count, ElfRelocation *rels)
+{
+        ElfResult res = ELF_OK;
+        uint64_t raw[ELF_BATCH_BYTES / sizeof(uint64_t)];
+        uint64_t entry_size;
+        uint32_t rel_cnt, per_read;
+        bool rela;
+
+        if (validate_ctx(ctx))
+                return ELF_UNINIT;
+
+        if ((rel_sec == NULL) || ((rels == NULL) && (count != 0)))
+                return ELF_BAD_ARG;
+
+        if ((rel_sec->Type != SHT_REL) && (rel_sec->Type != SHT_RELA))
+                return ELF_BAD_SECTION_TYPE;
+
+        rela = (rel_sec->Type == SHT_RELA);
+        if (CTX(ctx)->Class == ELFCLASS32)
+                entry_size = rela ? sizeof(Elf32Rela) : sizeof(Elf32Rel);
+        else
+                entry_size = rela ? sizeof(Elf64Rela) : sizeof(Elf64Rel);
+
+        /* same as get_symbol_entries(), the entries are decoded from a packed buffer */
+        if (rel_sec->EntrySize != entry_size)
+                return ELF_BAD_SIZE;
+
+        rel_cnt = get_relocation_count(ctx, rel_sec);
+        if ((first > rel_cnt) || (count > rel_cnt - first))
+                return ELF_BAD_INDX;
+
+        per_read = (uint32_t)(ELF_BATCH_BYTES / entry_size);
+
+        for (uint32_t done = 0; (done < count) && !res; done += per_read)
+        {
+                uint32_t n = (count - done < per_read) ? count - done : per_read;
+
+                res = CTX(ctx)->Callback(CTX(ctx)->UserCtx, rel_sec->Offset + (first + done) * entry_size, n * entry_size, raw);
+                for (uint32_t i = 0; (i < n) && !res; i++)
+                        decode_relocation_entry(ctx, (const uint8_t *)raw + i * entry_size, rela, &rels[done + i]);
+        }
+        return res;
+}
+
 ElfResult get_str_from_table(const ElfCtx *ctx, uint32_t sec_idx, uint32_t str_idx, uint8_t *buff, uint16_t len)
 {
         ElfResult res = ELF_OK;
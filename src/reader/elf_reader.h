@@ -36,7 +36,7 @@ ElfResult get_header(const ElfCtx *ctx, ElfHeader *header);
  * @param ctx Lib context, initialized on Elf_init().
  * @return Number of section headers in the file.
  */
-uint16_t get_section_count(const ElfCtx *ctx);
+uint32_t get_section_count(const ElfCtx *ctx);
 
 /**
  * @param ctx Lib context, initialized on Elf_init().
@@ -52,6 +52,17 @@ uint16_t get_program_header_count(const ElfCtx *ctx);
  */
 ElfResult get_section_header(const ElfCtx *ctx, uint32_t idx, ElfSecHeader *sec_header);
 
+/**
+ * @param ctx Lib context, initialized on Elf_init().
+ * @param first Index of the first section in the section header table.
+ * @param count Number of consecutive sections to read.
+ * @param sec_headers (out) User allocated array of at least "count" structs to be filled.
+ * @return Error code, ELF_BAD_INDX if the range goes past the end of the table.
+ * @brief Reads a range of section headers with a few large reads instead of one per header,
+ * the headers go through the same checks as in get_section_header().
+ */
+ElfResult get_section_headers(const ElfCtx *ctx, uint32_t first, uint32_t count, ElfSecHeader *sec_headers);
+
 /**
  * @param ctx Lib context, initialized on Elf_init().
  * @param sec_header  Section header structure.
@@ -61,6 +72,17 @@ ElfResult get_section_header(const ElfCtx *ctx, uint32_t idx, ElfSecHeader *sec_
  */
 ElfResult get_section_name(const ElfCtx *ctx, const ElfSecHeader *sec_header, uint8_t *buff, uint16_t len);
 
+/**
+ * @param ctx Lib context, initialized on Elf_init().
+ * @param sec_header Section header structure.
+ * @param offset Offset inside the section of the first byte to read.
+ * @param size Number of bytes to read.
+ * @param buff (out) User allocated buffer of at least "size" bytes.
+ * @return Error code
+ * @brief Reads raw bytes of a section's content, the data is copied as is (no endianness conversion).
+ */
+ElfResult get_section_data(const ElfCtx *ctx, const ElfSecHeader *sec_header, uint64_t offset, uint64_t size, void *buff);
+
 /**
  * @param ctx Lib context, initialized with Elf_init().
  * @param name Null-terminated section name to search for.
@@ -94,6 +116,18 @@ uint32_t get_symbol_count(const ElfCtx *ctx, const ElfSecHeader *sym_tab);
  */
 ElfResult get_symbol_entry(const ElfCtx *ctx, const ElfSecHeader *sym_tab, uint32_t idx, ElfSymTabEntry *sym);
 
+/**
+ * @param ctx Lib context, initialized on Elf_init().
+ * @param sym_tab Section header corresponding to the symbol table (SHT_SYMTAB or SHT_DYNSYM).
+ * @param first Index of the first symbol entry to read.
+ * @param count Number of consecutive symbol entries to read.
+ * @param syms (out) User allocated array of at least "count" structs to be filled.
+ * @return Error code, ELF_BAD_INDX if the range goes past the end of the table.
+ * @brief Reads a range of symbol entries with a few large reads instead of one per symbol.
+ * Names are best resolved against the whole string table, read once with get_section_data().
+ */
+ElfResult get_symbol_entries(const ElfCtx *ctx, const ElfSecHeader *sym_tab, uint32_t first, uint32_t count, ElfSymTabEntry *syms);
+
 /**
  * @param ctx Lib context, initialized on Elf_init().
  * @param str_tab_idx  Index into the section header table of the string table related to this symbols table (Link field).
@@ -150,6 +184,26 @@ ElfResult get_symbol_by_addr_range(const ElfCtx *ctx, const ElfSecHeader *sym_ta
  */
 ElfResult get_symbol_by_name(const ElfCtx *ctx, const uint8_t *name, const ElfSecHeader *sym_tab, ElfSymTabEntry *sym);
 
+/**
+ * @param ctx Lib context, initialized on Elf_init().
+ * @param rel_sec Section header of a relocation section (SHT_REL or SHT_RELA).
+ * @return Number of relocations in the section.
+ */
+uint32_t get_relocation_count(const ElfCtx *ctx, const ElfSecHeader *rel_sec);
+
+/**
+ * @param ctx Lib context, initialized on Elf_init().
+ * @param rel_sec Section header of a relocation section (SHT_REL or SHT_RELA).
+ * @param first Index of the first relocation to read.
+ * @param count Number of consecutive relocations to read.
+ * @param rels (out) User allocated array of at least "count" structs to be filled.
+ * @return Error code, ELF_BAD_INDX if the range goes past the end of the section.
+ * @brief Reads a range of relocations with a few large reads. Symbol indexes the symbol table of the
+ * Link field, the section patched is the one of the Info field. REL entries get a 0 Addend, theirs is
+ * stored in the field they patch.
+ */
+ElfResult get_relocation_entries(const ElfCtx *ctx, const ElfSecHeader *rel_sec, uint32_t first, uint32_t count, ElfRelocation *rels);
+
 /**
  * @param ctx Lib context, initialized on Elf_init().
  * @param sec_idx  Index of the string table in the section header table
@@ -21,18 +21,17 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
-#include "src/common/elf_core.h"
-#include "src/common/elf_common.h"
+#include "common/elf_core.h"
+#include "common/elf_repr.h"
+#include "common/elf_common.h"
 #include "elf_writer.h"
 
-typedef struct
-{
-        // TODO: think about this stuff.
-        void (*write)(void *user, const void *buf, size_t size);
-} ElfwSink;
+/** Bytes produced per call to a source callback and section headers encoded per write */
+#define ELFW_BATCH_BYTES 65536
 
-// TODO(section-data-model):
+// Section data model:
 // Sections are internally represented as a list of data chunks (scatter–gather),
 // not as a single contiguous buffer.
 //
@@ -42,13 +41,11 @@ typedef struct
 // - Naturally fits assemblers, debug info generation, and future linker-like use cases.
 // - A contiguous buffer is a special case of a single chunk.
 //
-// Intended design:
-// - Internally: section owns a dynamic list of { const void *data, size_t size } chunks.
-// - sh_size is computed as the sum of all chunk sizes.
+// - Internally: section owns a dynamic list of chunks, either { const void *data } buffers owned
+//   by the caller or { source, user_ctx } callbacks that produce the bytes at write time.
+// - sh_size is the offset past the last chunk.
 // - At write time, chunks are emitted sequentially to produce a contiguous section image.
 //
-// This keeps the simple cases trivial while preserving flexibility for advanced tools.
-// Implementation deferred until section/segment layout logic is in place.
 // TODO(alignment-model): think about this, this library is not a linker
 // - Section alignment (sh_addralign) is enforced automatically by the layout engine.
 // - Internal section layout uses explicit chunk alignment only.
@@ -72,9 +69,11 @@ static void *elfw_vec_get(const ElfwVec *v, uint32_t idx);
 
 typedef struct
 {
-        const void *data; // not owned
+        const void *data;               // not owned, NULL for source chunks and SHT_NOBITS sections
+        elf_read_callback source;       // produces the bytes when data is NULL
+        void *user_ctx;
         uint64_t size;
-        uint64_t align;
+        uint64_t offset;                // from the start of the section, aligned
 } Chunk;
 
 /* Internal section representation */
@@ -94,51 +93,58 @@ struct ElfWSection
 
         // Next free address after the data
         uint64_t Offset;
-};
 
-// typedef struct
-//{
-//         uint32_t type;
-//         uint32_t flags;
-//         uint64_t align;
-//
-//         /* Filled during layout */
-//         uint64_t offset;
-//         uint64_t vaddr;
-//         uint64_t paddr;
-//         uint64_t filesz;
-//         uint64_t memsz;
-//
-//         /* Which sections are covered */
-//         size_t *section_indices;
-//         size_t section_count;
-// } ElfWSegment;
+        uint32_t Index;                 // in the section header table
+        uint32_t NameIdx;               // in .shstrtab, filled during layout
+        uint64_t FileOff;               // filled during layout
+};
 
+/* Program header, its addresses and sizes are taken from the sections it covers during layout */
 typedef struct
 {
-        ElfWSection *section;
-    uint64_t     sec_offset;   /* offset inside section */
-    uint64_t     size;
-    uint64_t     vaddr_align;  /* optional */
-} ElfwSegMap;
-typedef struct {
-    //ElfWSegmentType type;
-    uint32_t        flags;
-    uint64_t        align;
-
-    ElfwSegMap     *maps;
-    size_t          map_count;
-    size_t          map_cap;
+        ElfSegmentType Type;
+        uint32_t Flags;
+        uint64_t Align;
+        ElfWSection *First;
+        ElfWSection *Last;
 } ElfWSegment;
 
 struct ElfwCtx
 {
-        Elf64Header *Head;
+        Elf64Header *Head;              // host byte order, encoded for the class and endianness on write
 
         ElfwVec Sections;
         ElfwVec Segments;
 };
 
+/** Write functions, the inverse of the reader's read_* */
+static inline uint16_t write_16(uint16_t v, EiData elf_endianness) {
+        return (elf_endianness != host_endianness()) ? swap16(v) : v;
+}
+
+static inline uint32_t write_32(uint32_t v, EiData elf_endianness) {
+        return (elf_endianness != host_endianness()) ? swap32(v) : v;
+}
+
+static inline uint64_t write_64(uint64_t v, EiData elf_endianness) {
+        return (elf_endianness != host_endianness()) ? swap64(v) : v;
+}
+
+static inline uint64_t align_up(uint64_t value, uint64_t align)
+{
+        // Power of 2 aligment:
+        //  - Add (alignment - 1) to the current offset. This ensures that
+        //    any remainder will carry the value past the next multiple.
+        //  - Clear the lower bits corresponding to the alignment using bitwise AND with ~(alignment - 1),
+        //    effectively rounding down to the nearest multiple of `alignment`.
+        return (value + align - 1) & ~(align - 1);
+}
+
+static inline int is_pow2(uint64_t v)
+{
+        return (v != 0) && ((v & (v - 1)) == 0);
+}
+
 ElfwCtx *elfw_create(void)
 {
         ElfwCtx *res;
@@ -150,7 +156,7 @@ ElfwCtx *elfw_create(void)
         else
         {
                 ctx->Head = NULL;
-                elfw_vec_init(&(ctx->Segments));
+                elfw_vec_init(&(ctx->Sections));
                 elfw_vec_init(&(ctx->Segments));
 
                 res = ctx;
@@ -182,36 +188,49 @@ ElfResult elfw_create_header(ElfwCtx *ctx, const ElfwHeaderCreateInfo *info)
         if (ctx == NULL)
                 return ELF_UNINIT;
 
-        Elf64Header *header = malloc(sizeof(*header));
+        if (info == NULL)
+                return ELF_BAD_ARG;
+
+        if ((info->Class != ELFCLASS32) && (info->Class != ELFCLASS64))
+                return ELF_BAD_CLASS;
+
+        if ((info->Endianness != ELFDATA2LSB) && (info->Endianness != ELFDATA2MSB))
+                return ELF_BAD_ENDIANNESS;
+
+        /* symbol tables may already be sized for the class, the type decides what the file is */
+        if ((ctx->Head != NULL) && ((ctx->Head->info.EI_Class != info->Class) || (ctx->Head->e_type != info->Type)))
+                return ELF_BAD_ARG;
+
+        Elf64Header *header = (ctx->Head != NULL) ? ctx->Head : malloc(sizeof(*header));
         if (header == NULL)
                 return ELF_NO_MEM;
 
         *header = (Elf64Header){
-            .Info = {
+            .info = {
                 .Magic      = {0x7f, 'E', 'L', 'F'},
-                .EI_Class   = info->Class,
-                .EI_Data    = info->Endianness,
-                .EI_Version = 1,
-                .EI_OS_ABI  = info->Os_abi,
+                .EI_Class   = (uint8_t)info->Class,
+                .EI_Data    = (uint8_t)info->Endianness,
+                .EI_Version = EV_CURRENT,
+                .EI_OS_ABI  = (uint8_t)info->Os_abi,
                 .EI_ABI_Version = info->Abi_version,
                 .Pad     = {0},
-                .Type    = info->Type,
-                .Machine = info->Machine,
-                .Version = 1,
             },
-            .Flags      = info->Flags,
-            .Entry      = info->Entry,
-
-            .HeadSize = sizeof(Elf64Header),
-            .PHEntrySize = sizeof(Elf64ProHeader),
-            .SHEntrySize = sizeof(Elf64SecHeader),
-
-            /* Filled later */
-            .SecHeadOff = 0,
-            .ProHeadOff = 0,
-            .PHEntryNum = 0,
-            .SHEntryNum = 0,
-            .SecNameStrIndx = 0,
+            .e_type     = (uint16_t)info->Type,
+            .e_machine  = (uint16_t)info->Machine,
+            .e_version  = EV_CURRENT,
+            .e_flags    = info->Flags,
+            .e_entry    = info->Entry,
+
+            .e_ehsize    = (info->Class == ELFCLASS32) ? sizeof(Elf32Header)    : sizeof(Elf64Header),
+            .e_phentsize = (info->Class == ELFCLASS32) ? sizeof(Elf32ProHeader) : sizeof(Elf64ProHeader),
+            .e_shentsize = (info->Class == ELFCLASS32) ? sizeof(Elf32SecHeader) : sizeof(Elf64SecHeader),
+
+            /* Filled on write */
+            .e_shoff = 0,
+            .e_phoff = 0,
+            .e_phnum = 0,
+            .e_shnum = 0,
+            .e_shstrndx = 0,
         };
 
         ctx->Head = header;
@@ -221,14 +240,20 @@ ElfResult elfw_create_header(ElfwCtx *ctx, const ElfwHeaderCreateInfo *info)
 
 ElfResult elfw_add_section(ElfwCtx *ctx, const ElfwSectionCreateInfo *info, sec_hndl *new_sec)
 {
-        *new_sec = NULL;
+        if (new_sec != NULL)
+                *new_sec = NULL;
 
         if (ctx == NULL)
                 return ELF_UNINIT;
 
-        if ((info == NULL) || (new_sec == NULL))
+        if ((info == NULL) || (new_sec == NULL) || (info->Name == NULL))
                 return ELF_BAD_ARG;
 
+        /* the null section and the name table are added by the writer, the rest must keep index
+           space for them */
+        if (ctx->Sections.length >= UINT32_MAX - 2)
+                return ELF_BAD_INDX;
+
         /* Aligment and validity checks */
         {
                 uint64_t align = info->Alignment;
@@ -238,7 +263,7 @@ ElfResult elfw_add_section(ElfwCtx *ctx, const ElfwSectionCreateInfo *info, sec_
                         return ELF_BAD_ARG;
 
                 /* power to two */
-                if ((align != 0) && ((align & (align - 1)) == 0))
+                if (!is_pow2(align))
                         return ELF_BAD_ARG;
 
                 /* address is aligned */
@@ -246,7 +271,7 @@ ElfResult elfw_add_section(ElfwCtx *ctx, const ElfwSectionCreateInfo *info, sec_
                         return ELF_BAD_ARG;
 
                 /* Address only meaningful for allocatable sections */
-                if ((!(info->Flags & SEC_FLAG_ALLOC)) && (addr != 0))
+                if ((!(info->Flags & SHF_ALLOC)) && (addr != 0))
                         return ELF_BAD_ARG;
 
                 /* Entry size must respect alignment */
@@ -255,29 +280,34 @@ ElfResult elfw_add_section(ElfwCtx *ctx, const ElfwSectionCreateInfo *info, sec_
 
                 switch (info->Type)
                 {
-                case SECTION_NULL:
+                case SHT_NULL:
                         /* NULL sections must not have payload semantics */
                         if ((addr != 0) || (info->EntrySize != 0))
                                 return ELF_BAD_ARG;
                         break;
 
-                case SECTION_STRTAB:
+                case SHT_STRTAB:
                         /* String tables have byte entries */
                         if ((info->EntrySize != 0) && (info->EntrySize != 1))
                                 return ELF_BAD_ARG;
                         break;
 
-                case SECTION_DYNSYM:
-                case SECTION_SYMTAB:
+                case SHT_DYNSYM:
+                case SHT_SYMTAB:
                         if (ctx->Head != NULL)
                         {
-                                uint64_t expected = (ctx->Head->Info.EI_Class == CLASS_32) ? sizeof(Elf32SymEntry) : sizeof(Elf64SymEntry);
+                                uint64_t expected = (ctx->Head->info.EI_Class == ELFCLASS32) ? sizeof(Elf32SymEntry) : sizeof(Elf64SymEntry);
                                 if (info->EntrySize != expected)
                                         return ELF_BAD_ARG;
                         }
 
                         break;
 
+                case SHT_SYMTAB_SHNDX:
+                        if (info->EntrySize != sizeof(uint32_t))
+                                return ELF_BAD_ARG;
+                        break;
+
                 default:
                         /* Other types: no strict validation here */
                         // TODO: check what other validation could be done. This is the main validation point for genreating valid elfs.
@@ -291,17 +321,16 @@ ElfResult elfw_add_section(ElfwCtx *ctx, const ElfwSectionCreateInfo *info, sec_
 
         /* copy name */
         {
-                uint32_t len = 0;
-
-                while (info->Name[len] != '\0')
-                        len++;
+                size_t len = strlen(info->Name);
 
                 sec->Name = malloc(len + 1);
                 if (sec->Name == NULL)
+                {
+                        free(sec);
                         return ELF_NO_MEM;
+                }
 
-                for (uint32_t i = 0; i <= len; i++)
-                        sec->Name[i] = info->Name[i];
+                memcpy(sec->Name, info->Name, len + 1);
         }
 
         elfw_vec_init(&(sec->Chunks));
@@ -315,13 +344,25 @@ ElfResult elfw_add_section(ElfwCtx *ctx, const ElfwSectionCreateInfo *info, sec_
         sec->EntrySize = info->EntrySize;
 
         sec->Offset = 0;
+        sec->Index = ctx->Sections.length + 1;
+        sec->NameIdx = 0;
+        sec->FileOff = 0;
 
-        elfw_vec_push(&(ctx->Sections), sec);
+        if (elfw_vec_push(&(ctx->Sections), sec) != ELF_OK)
+        {
+                elfw_section_destroy(sec);
+                return ELF_NO_MEM;
+        }
 
         *new_sec = sec;
         return ELF_OK;
 }
 
+uint32_t elfw_section_index(sec_hndl section)
+{
+        return (section != NULL) ? section->Index : 0;
+}
+
 static inline void elfw_section_destroy(ElfWSection *s)
 {
         if (s == NULL)
@@ -329,6 +370,12 @@ static inline void elfw_section_destroy(ElfWSection *s)
 
         free(s->Name);
         elfw_vec_destroy(&(s->Chunks), (ElfwElemDestroyFn)free);
+        free(s);
+}
+
+static inline void elfw_segment_destroy(ElfWSegment *s)
+{
+        free(s);
 }
 
 ElfResult elfw_section_set_data(sec_hndl section, const void *data, uint64_t size, uint64_t align)
@@ -342,38 +389,716 @@ ElfResult elfw_section_set_data(sec_hndl section, const void *data, uint64_t siz
         return elfw_section_append_data(section, data, size, align);
 }
 
-ElfResult elfw_section_append_data(sec_hndl section, const void *data, uint64_t size, uint64_t align)
+/* Common part of the append functions, data and source are both NULL for SHT_NOBITS sections */
+static ElfResult section_append(sec_hndl section, const void *data, elf_read_callback source, void *user_ctx,
+                                uint64_t size, uint64_t align)
 {
+        uint64_t offset;
+
         if (section == NULL)
                 return ELF_UNINIT;
 
-        if (data == NULL)
+        if (!is_pow2(align))
+                return ELF_BAD_ARG;
+
+        if ((data == NULL) && (source == NULL) && (section->Type != SHT_NOBITS))
                 return ELF_BAD_ARG;
 
         if (size == 0)
                 return ELF_OK;
 
+        offset = elfw_section_next_offset(section, align);
+        if ((offset < section->Offset) || (size > UINT64_MAX - offset))
+                return ELF_BAD_SIZE;
+
         Chunk *chk = malloc(sizeof(*chk));
-        
-        chk->data  = data;
-        chk->size  = size;
-        chk->align = align;
-        
-        elfw_vec_push(&(section->Chunks), &chk);
+        if (chk == NULL)
+                return ELF_NO_MEM;
+
+        chk->data     = data;
+        chk->source   = source;
+        chk->user_ctx = user_ctx;
+        chk->size     = size;
+        chk->offset   = offset;
+
+        if (elfw_vec_push(&(section->Chunks), chk) != ELF_OK)
+        {
+                free(chk);
+                return ELF_NO_MEM;
+        }
 
-        section->Offset =elfw_section_next_offset(section, align) + size;
+        section->Offset = offset + size;
 
         return ELF_OK;
 }
 
+ElfResult elfw_section_append_data(sec_hndl section, const void *data, uint64_t size, uint64_t align)
+{
+        return section_append(section, data, NULL, NULL, size, align);
+}
+
+ElfResult elfw_section_append_source(sec_hndl section, elf_read_callback source, void *user_ctx, uint64_t size,
+                                     uint64_t align)
+{
+        if (source == NULL)
+                return ELF_BAD_ARG;
+
+        return section_append(section, NULL, source, user_ctx, size, align);
+}
+
 uint64_t elfw_section_next_offset(sec_hndl section, uint64_t align)
 {
-        // Power of 2 aligment:
-        //  - Add (alignment - 1) to the current offset. This ensures that
-        //    any remainder will carry the value past the next multiple.
-        //  - Clear the lower bits corresponding to the alignment using bitwise AND with ~(alignment - 1),
-        //    effectively rounding down to the nearest multiple of `alignment`.
-        return (section->Offset + align - 1) & ~(align- 1);
+        return align_up(section->Offset, align);
+}
+
+/****************
+ *   Entries    *
+ ****************/
+
+uint64_t elfw_symbol_entry_size(const ElfwCtx *ctx)
+{
+        if ((ctx == NULL) || (ctx->Head == NULL))
+                return 0;
+
+        return (ctx->Head->info.EI_Class == ELFCLASS32) ? sizeof(Elf32SymEntry) : sizeof(Elf64SymEntry);
+}
+
+ElfResult elfw_encode_symbols(const ElfwCtx *ctx, const ElfSymTabEntry *syms, uint32_t count, void *out,
+                              uint32_t *shndx)
+{
+        EiData data;
+        int is32;
+
+        if ((ctx == NULL) || (ctx->Head == NULL))
+                return ELF_UNINIT;
+
+        if ((syms == NULL) || (out == NULL))
+                return ELF_BAD_ARG;
+
+        data = (EiData)ctx->Head->info.EI_Data;
+        is32 = (ctx->Head->info.EI_Class == ELFCLASS32);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+                const ElfSymTabEntry *sym = &syms[i];
+                uint8_t info  = (uint8_t)ELF32_ST_INFO((unsigned)sym->Binding, (unsigned)sym->Type);
+                uint8_t other = (uint8_t)ELF64_ST_VISIBILITY((unsigned)sym->Visib);
+                uint32_t ext  = 0;
+                uint16_t sec;
+
+                switch (sym->Attr)
+                {
+                case STA_ABS:
+                        sec = SHN_ABS;
+                        break;
+                case STA_COMMON:
+                        sec = SHN_COMMON;
+                        break;
+                case STA_UNDEF:
+                        sec = SHN_UNDEF;
+                        break;
+                case STA_UNKNOWN:
+                        sec = (uint16_t)sym->SecIdx;
+                        break;
+                default:
+                        if (sym->SecIdx > UINT32_MAX)
+                                return ELF_BAD_INDX;
+                        if (sym->SecIdx >= SHN_LORESERVE)
+                        {
+                                if (shndx == NULL)
+                                        return ELF_BAD_INDX;
+                                sec = SHN_XINDEX;
+                                ext = (uint32_t)sym->SecIdx;
+                        }
+                        else
+                        {
+                                sec = (uint16_t)sym->SecIdx;
+                        }
+                        break;
+                }
+
+                if (shndx != NULL)
+                        shndx[i] = write_32(ext, data);
+
+                if (is32)
+                {
+                        Elf32SymEntry *e = (Elf32SymEntry *)out + i;
+
+                        if ((sym->Value > UINT32_MAX) || (sym->Size > UINT32_MAX))
+                                return ELF_BAD_SIZE;
+
+                        e->st_name  = write_32(sym->NameIdx, data);
+                        e->st_value = write_32((uint32_t)sym->Value, data);
+                        e->st_size  = write_32((uint32_t)sym->Size, data);
+                        e->st_info  = info;
+                        e->st_other = other;
+                        e->st_shndx = write_16(sec, data);
+                }
+                else
+                {
+                        Elf64SymEntry *e = (Elf64SymEntry *)out + i;
+
+                        e->st_name  = write_32(sym->NameIdx, data);
+                        e->st_info  = info;
+                        e->st_other = other;
+                        e->st_shndx = write_16(sec, data);
+                        e->st_value = write_64(sym->Value, data);
+                        e->st_size  = write_64(sym->Size, data);
+                }
+        }
+
+        return ELF_OK;
+}
+
+uint64_t elfw_relocation_entry_size(const ElfwCtx *ctx, int rela)
+{
+        if ((ctx == NULL) || (ctx->Head == NULL))
+                return 0;
+
+        if (ctx->Head->info.EI_Class == ELFCLASS32)
+                return rela ? sizeof(Elf32Rela) : sizeof(Elf32Rel);
+
+        return rela ? sizeof(Elf64Rela) : sizeof(Elf64Rel);
+}
+
+ElfResult elfw_encode_relocations(const ElfwCtx *ctx, const ElfRelocation *rels, uint32_t count, int rela, void *out)
+{
+        EiData data;
+
+        if ((ctx == NULL) || (ctx->Head == NULL))
+                return ELF_UNINIT;
+
+        if ((rels == NULL) || (out == NULL))
+                return ELF_BAD_ARG;
+
+        data = (EiData)ctx->Head->info.EI_Data;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+                const ElfRelocation *r = &rels[i];
+
+                if (ctx->Head->info.EI_Class == ELFCLASS32)
+                {
+                        uint32_t r_info;
+
+                        /* 24-bit symbol indexes and 8-bit types */
+                        if ((r->Offset > UINT32_MAX) || (r->Symbol > 0xffffff) || (r->Type > 0xff) ||
+                            (r->Addend < INT32_MIN) || (r->Addend > INT32_MAX))
+                                return ELF_BAD_SIZE;
+
+                        r_info = ELF32_R_INFO(r->Symbol, r->Type);
+                        if (rela)
+                        {
+                                Elf32Rela *e = (Elf32Rela *)out + i;
+
+                                e->r_offset = write_32((uint32_t)r->Offset, data);
+                                e->r_info   = write_32(r_info, data);
+                                e->r_addend = (int32_t)write_32((uint32_t)(int32_t)r->Addend, data);
+                        }
+                        else
+                        {
+                                Elf32Rel *e = (Elf32Rel *)out + i;
+
+                                e->r_offset = write_32((uint32_t)r->Offset, data);
+                                e->r_info   = write_32(r_info, data);
+                        }
+                }
+                else
+                {
+                        uint64_t r_info = ELF64_R_INFO((uint64_t)r->Symbol, (uint64_t)r->Type);
+
+                        if (rela)
+                        {
+                                Elf64Rela *e = (Elf64Rela *)out + i;
+
+                                e->r_offset = write_64(r->Offset, data);
+                                e->r_info   = write_64(r_info, data);
+                                e->r_addend = (int64_t)write_64((uint64_t)r->Addend, data);
+                        }
+                        else
+                        {
+                                Elf64Rel *e = (Elf64Rel *)out + i;
+
+                                e->r_offset = write_64(r->Offset, data);
+                                e->r_info   = write_64(r_info, data);
+                        }
+                }
+        }
+
+        return ELF_OK;
+}
+
+/****************
+ *   Segments   *
+ ****************/
+
+ElfResult elfw_add_segment(ElfwCtx *ctx, const ElfwSegmentCreateInfo *info)
+{
+        ElfWSegment *seg;
+        ElfResult res;
+
+        if (ctx == NULL)
+                return ELF_UNINIT;
+
+        if ((info == NULL) || (info->First == NULL) || (info->Last == NULL) || (info->First->Index > info->Last->Index))
+                return ELF_BAD_ARG;
+
+        if ((info->Alignment != 0) && !is_pow2(info->Alignment))
+                return ELF_BAD_ARG;
+
+        /* e_phnum has no extended form here */
+        if (ctx->Segments.length >= 0xffff)
+                return ELF_BAD_INDX;
+
+        if ((seg = malloc(sizeof(*seg))) == NULL)
+                return ELF_NO_MEM;
+
+        seg->Type = info->Type;
+        seg->Flags = info->Flags;
+        seg->Align = (info->Alignment != 0) ? info->Alignment : 1;
+        seg->First = info->First;
+        seg->Last = info->Last;
+
+        if ((res = elfw_vec_push(&(ctx->Segments), seg)) != ELF_OK)
+                free(seg);
+        return res;
+}
+
+/* Largest alignment of the PT_LOAD segments covering a section, its offset must be congruent to its address modulo it */
+static uint64_t load_alignment(const ElfwCtx *ctx, const ElfWSection *sec)
+{
+        uint64_t align = 1;
+
+        for (uint32_t i = 0; i < ctx->Segments.length; i++)
+        {
+                const ElfWSegment *seg = elfw_vec_get(&(ctx->Segments), i);
+
+                if ((seg->Type == PT_LOAD) && (seg->First->Index <= sec->Index) && (sec->Index <= seg->Last->Index) &&
+                    (seg->Align > align))
+                        align = seg->Align;
+        }
+        return align;
+}
+
+/* Program header of a segment, from the layout of its sections */
+static void segment_header(const ElfwCtx *ctx, const ElfWSegment *seg, ElfProHeader *ph)
+{
+        uint64_t file_end = seg->First->FileOff;
+        uint64_t mem_end = seg->First->StartAddr;
+
+        for (uint32_t i = seg->First->Index; i <= seg->Last->Index; i++)
+        {
+                const ElfWSection *sec = elfw_vec_get(&(ctx->Sections), i - 1);
+
+                if ((sec->Type != SHT_NOBITS) && (sec->Type != SHT_NULL) && (sec->FileOff + sec->Offset > file_end))
+                        file_end = sec->FileOff + sec->Offset;
+                if (sec->StartAddr + sec->Offset > mem_end)
+                        mem_end = sec->StartAddr + sec->Offset;
+        }
+
+        ph->Type = seg->Type;
+        ph->Flags = seg->Flags;
+        ph->Offset = seg->First->FileOff;
+        ph->VirAddress = seg->First->StartAddr;
+        ph->PhyAddress = seg->First->StartAddr;
+        ph->FileSize = file_end - seg->First->FileOff;
+        ph->MemSize = mem_end - seg->First->StartAddr;
+        ph->Alignment = seg->Align;
+}
+
+/****************
+ *    Output    *
+ ****************/
+
+/* Sequential output, keeps the offset the callback expects next */
+typedef struct
+{
+        elfw_write_callback Callback;
+        void *UserCtx;
+        uint64_t Pos;
+        uint8_t *Buff;                  // ELFW_BATCH_BYTES, for source chunks and section headers
+} ElfwOut;
+
+static ElfResult out_bytes(ElfwOut *out, const void *data, uint64_t size)
+{
+        ElfResult res;
+
+        if (size == 0)
+                return ELF_OK;
+
+        res = out->Callback(out->UserCtx, out->Pos, size, data);
+        out->Pos += size;
+        return res;
+}
+
+/* Zero padding up to an absolute offset */
+static ElfResult out_pad(ElfwOut *out, uint64_t offset)
+{
+        static const uint8_t zeros[4096];
+        ElfResult res = ELF_OK;
+
+        while ((res == ELF_OK) && (out->Pos < offset))
+        {
+                uint64_t n = offset - out->Pos;
+                res = out_bytes(out, zeros, (n < sizeof(zeros)) ? n : sizeof(zeros));
+        }
+        return res;
+}
+
+static ElfResult out_source(ElfwOut *out, const Chunk *chk)
+{
+        ElfResult res = ELF_OK;
+
+        for (uint64_t done = 0; (res == ELF_OK) && (done < chk->size);)
+        {
+                uint64_t n = chk->size - done;
+                if (n > ELFW_BATCH_BYTES)
+                        n = ELFW_BATCH_BYTES;
+
+                res = chk->source(chk->user_ctx, done, n, out->Buff);
+                if (res == ELF_OK)
+                        res = out_bytes(out, out->Buff, n);
+                done += n;
+        }
+        return res;
+}
+
+/* Section header table layout, filled by elfw_layout() */
+typedef struct
+{
+        uint64_t ShstrtabOff;
+        uint64_t ShstrtabSize;
+        uint64_t SecHeadOff;
+        uint64_t FileSize;
+        uint32_t SecCount;              // including the null section and .shstrtab
+} ElfwLayout;
+
+static const char shstrtab_name[] = ".shstrtab";
+
+/* Assigns file offsets and name offsets, the names are laid out in section order */
+static ElfResult elfw_layout(ElfwCtx *ctx, ElfwLayout *lay)
+{
+        int is32 = (ctx->Head->info.EI_Class == ELFCLASS32);
+        uint64_t off = ctx->Head->e_ehsize + (uint64_t)ctx->Segments.length * ctx->Head->e_phentsize;
+        uint64_t names = 1;             // the empty name
+
+        for (uint32_t i = 0; i < ctx->Sections.length; i++)
+        {
+                ElfWSection *sec = elfw_vec_get(&(ctx->Sections), i);
+                uint64_t len = strlen(sec->Name);
+
+                /* the empty name is shared */
+                sec->NameIdx = (len == 0) ? 0 : (uint32_t)names;
+                names += (len == 0) ? 0 : len + 1;
+                if (names > UINT32_MAX)
+                        return ELF_BAD_SIZE;
+
+                sec->FileOff = align_up(off, sec->Align);
+                if (sec->FileOff < off)
+                        return ELF_BAD_SIZE;
+
+                /* loadable sections are mapped from offsets congruent to their addresses */
+                if (ctx->Segments.length != 0)
+                {
+                        uint64_t align = load_alignment(ctx, sec);
+                        if (align < sec->Align)
+                                align = sec->Align;
+                        sec->FileOff += (sec->StartAddr - sec->FileOff) & (align - 1);
+                }
+
+                if ((sec->Type != SHT_NOBITS) && (sec->Type != SHT_NULL))
+                {
+                        if (sec->Offset > UINT64_MAX - sec->FileOff)
+                                return ELF_BAD_SIZE;
+                        off = sec->FileOff + sec->Offset;
+                }
+
+                if (is32 && ((sec->FileOff > UINT32_MAX) || (sec->Offset > UINT32_MAX) || (sec->StartAddr > UINT32_MAX) ||
+                             (sec->Flags > UINT32_MAX)))
+                        return ELF_BAD_SIZE;
+        }
+
+        lay->ShstrtabOff = off;
+        lay->ShstrtabSize = names + sizeof(shstrtab_name);
+        lay->SecHeadOff = align_up(off + lay->ShstrtabSize, is32 ? 4 : 8);
+        lay->SecCount = ctx->Sections.length + 2;
+        lay->FileSize = lay->SecHeadOff + (uint64_t)lay->SecCount * ctx->Head->e_shentsize;
+
+        if (is32 && (lay->FileSize > UINT32_MAX))
+                return ELF_BAD_SIZE;
+
+        return ELF_OK;
+}
+
+static ElfResult write_header(ElfwCtx *ctx, const ElfwLayout *lay, ElfwOut *out)
+{
+        const Elf64Header *h = ctx->Head;
+        EiData data = (EiData)h->info.EI_Data;
+        uint32_t shstrndx = lay->SecCount - 1;
+        uint16_t shnum = (lay->SecCount >= SHN_LORESERVE) ? 0 : (uint16_t)lay->SecCount;
+        uint16_t shstrx = (shstrndx >= SHN_LORESERVE) ? SHN_XINDEX : (uint16_t)shstrndx;
+        uint16_t phnum = (uint16_t)ctx->Segments.length;
+
+        if (h->info.EI_Class == ELFCLASS32)
+        {
+                Elf32Header e = {0};
+
+                memcpy(e.e_ident, h->e_ident, EI_NIDENT);
+                e.e_type      = write_16(h->e_type, data);
+                e.e_machine   = write_16(h->e_machine, data);
+                e.e_version   = write_32(h->e_version, data);
+                e.e_entry     = write_32((uint32_t)h->e_entry, data);
+                e.e_phoff     = write_32(phnum ? h->e_ehsize : 0, data);
+                e.e_shoff     = write_32((uint32_t)lay->SecHeadOff, data);
+                e.e_flags     = write_32(h->e_flags, data);
+                e.e_ehsize    = write_16(h->e_ehsize, data);
+                e.e_phentsize = write_16(h->e_phentsize, data);
+                e.e_phnum     = write_16(phnum, data);
+                e.e_shentsize = write_16(h->e_shentsize, data);
+                e.e_shnum     = write_16(shnum, data);
+                e.e_shstrndx  = write_16(shstrx, data);
+
+                return out_bytes(out, &e, sizeof(e));
+        }
+        else
+        {
+                Elf64Header e = {0};
+
+                memcpy(e.e_ident, h->e_ident, EI_NIDENT);
+                e.e_type      = write_16(h->e_type, data);
+                e.e_machine   = write_16(h->e_machine, data);
+                e.e_version   = write_32(h->e_version, data);
+                e.e_entry     = write_64(h->e_entry, data);
+                e.e_phoff     = write_64(phnum ? h->e_ehsize : 0, data);
+                e.e_shoff     = write_64(lay->SecHeadOff, data);
+                e.e_flags     = write_32(h->e_flags, data);
+                e.e_ehsize    = write_16(h->e_ehsize, data);
+                e.e_phentsize = write_16(h->e_phentsize, data);
+                e.e_phnum     = write_16(phnum, data);
+                e.e_shentsize = write_16(h->e_shentsize, data);
+                e.e_shnum     = write_16(shnum, data);
+                e.e_shstrndx  = write_16(shstrx, data);
+
+                return out_bytes(out, &e, sizeof(e));
+        }
+}
+
+static ElfResult write_program_headers(ElfwCtx *ctx, ElfwOut *out)
+{
+        EiData data = (EiData)ctx->Head->info.EI_Data;
+        ElfResult res = ELF_OK;
+
+        for (uint32_t i = 0; (res == ELF_OK) && (i < ctx->Segments.length); i++)
+        {
+                ElfProHeader ph;
+
+                segment_header(ctx, elfw_vec_get(&(ctx->Segments), i), &ph);
+
+                if (ctx->Head->info.EI_Class == ELFCLASS32)
+                {
+                        Elf32ProHeader e;
+
+                        e.p_type   = write_32((uint32_t)ph.Type, data);
+                        e.p_offset = write_32((uint32_t)ph.Offset, data);
+                        e.p_vaddr  = write_32((uint32_t)ph.VirAddress, data);
+                        e.p_paddr  = write_32((uint32_t)ph.PhyAddress, data);
+                        e.p_filesz = write_32((uint32_t)ph.FileSize, data);
+                        e.p_memsz  = write_32((uint32_t)ph.MemSize, data);
+                        e.p_flags  = write_32(ph.Flags, data);
+                        e.p_align  = write_32((uint32_t)ph.Alignment, data);
+                        res = out_bytes(out, &e, sizeof(e));
+                }
+                else
+                {
+                        Elf64ProHeader e;
+
+                        e.p_type   = write_32((uint32_t)ph.Type, data);
+                        e.p_flags  = write_32(ph.Flags, data);
+                        e.p_offset = write_64(ph.Offset, data);
+                        e.p_vaddr  = write_64(ph.VirAddress, data);
+                        e.p_paddr  = write_64(ph.PhyAddress, data);
+                        e.p_filesz = write_64(ph.FileSize, data);
+                        e.p_memsz  = write_64(ph.MemSize, data);
+                        e.p_align  = write_64(ph.Alignment, data);
+                        res = out_bytes(out, &e, sizeof(e));
+                }
+        }
+        return res;
+}
+
+/* Encodes one section header at "dst" */
+static void encode_section_header(const ElfwCtx *ctx, const ElfSecHeader *sh, uint8_t *dst)
+{
+        EiData data = (EiData)ctx->Head->info.EI_Data;
+
+        if (ctx->Head->info.EI_Class == ELFCLASS32)
+        {
+                Elf32SecHeader e;
+
+                e.sh_name      = write_32(sh->NameIdx, data);
+                e.sh_type      = write_32((uint32_t)sh->Type, data);
+                e.sh_flags     = write_32((uint32_t)sh->Flags, data);
+                e.sh_addr      = write_32((uint32_t)sh->Address, data);
+                e.sh_offset    = write_32((uint32_t)sh->Offset, data);
+                e.sh_size      = write_32((uint32_t)sh->Size, data);
+                e.sh_link      = write_32(sh->Link, data);
+                e.sh_info      = write_32(sh->Info, data);
+                e.sh_addralign = write_32((uint32_t)sh->Alignment, data);
+                e.sh_entsize   = write_32((uint32_t)sh->EntrySize, data);
+                memcpy(dst, &e, sizeof(e));
+        }
+        else
+        {
+                Elf64SecHeader e;
+
+                e.sh_name      = write_32(sh->NameIdx, data);
+                e.sh_type      = write_32((uint32_t)sh->Type, data);
+                e.sh_flags     = write_64(sh->Flags, data);
+                e.sh_addr      = write_64(sh->Address, data);
+                e.sh_offset    = write_64(sh->Offset, data);
+                e.sh_size      = write_64(sh->Size, data);
+                e.sh_link      = write_32(sh->Link, data);
+                e.sh_info      = write_32(sh->Info, data);
+                e.sh_addralign = write_64(sh->Alignment, data);
+                e.sh_entsize   = write_64(sh->EntrySize, data);
+                memcpy(dst, &e, sizeof(e));
+        }
+}
+
+static ElfResult write_section_headers(ElfwCtx *ctx, const ElfwLayout *lay, ElfwOut *out)
+{
+        uint32_t entry = ctx->Head->e_shentsize;
+        uint32_t per_batch = ELFW_BATCH_BYTES / entry;
+        uint32_t used = 0;
+        ElfResult res = ELF_OK;
+
+        for (uint32_t i = 0; (res == ELF_OK) && (i < lay->SecCount); i++)
+        {
+                ElfSecHeader sh = {0};
+
+                if (i == 0)
+                {
+                        /* extended numbering: the real count and name table index */
+                        sh.Type = SHT_NULL;
+                        sh.Size = (lay->SecCount >= SHN_LORESERVE) ? lay->SecCount : 0;
+                        sh.Link = (lay->SecCount - 1 >= SHN_LORESERVE) ? lay->SecCount - 1 : 0;
+                }
+                else if (i == lay->SecCount - 1)
+                {
+                        sh.NameIdx = (uint32_t)(lay->ShstrtabSize - sizeof(shstrtab_name));
+                        sh.Type = SHT_STRTAB;
+                        sh.Offset = lay->ShstrtabOff;
+                        sh.Size = lay->ShstrtabSize;
+                        sh.Alignment = 1;
+                }
+                else
+                {
+                        const ElfWSection *sec = elfw_vec_get(&(ctx->Sections), i - 1);
+
+                        sh.NameIdx = sec->NameIdx;
+                        sh.Type = sec->Type;
+                        sh.Flags = sec->Flags;
+                        sh.Address = sec->StartAddr;
+                        sh.Offset = (sec->Type == SHT_NULL) ? 0 : sec->FileOff;
+                        sh.Size = sec->Offset;
+                        sh.Link = (sec->Link != NULL) ? sec->Link->Index : 0;
+                        sh.Info = sec->Info;
+                        sh.Alignment = sec->Align;
+                        sh.EntrySize = sec->EntrySize;
+                }
+
+                encode_section_header(ctx, &sh, out->Buff + (size_t)used * entry);
+                if (++used == per_batch)
+                {
+                        res = out_bytes(out, out->Buff, (uint64_t)used * entry);
+                        used = 0;
+                }
+        }
+
+        if ((res == ELF_OK) && (used != 0))
+                res = out_bytes(out, out->Buff, (uint64_t)used * entry);
+
+        return res;
+}
+
+uint64_t elfw_file_size(ElfwCtx *ctx)
+{
+        ElfwLayout lay;
+
+        if ((ctx == NULL) || (ctx->Head == NULL) || (elfw_layout(ctx, &lay) != ELF_OK))
+                return 0;
+
+        return lay.FileSize;
+}
+
+ElfResult elfw_write(ElfwCtx *ctx, void *user_ctx, elfw_write_callback callback)
+{
+        ElfwLayout lay;
+        ElfwOut out = { callback, user_ctx, 0, NULL };
+        ElfResult res;
+
+        if (ctx == NULL)
+                return ELF_UNINIT;
+
+        if (callback == NULL)
+                return ELF_BAD_ARG;
+
+        if (ctx->Head == NULL)
+                return ELF_BAD_HEADER;
+
+        if ((res = elfw_layout(ctx, &lay)) != ELF_OK)
+                return res;
+
+        if ((out.Buff = malloc(ELFW_BATCH_BYTES)) == NULL)
+                return ELF_NO_MEM;
+
+        res = write_header(ctx, &lay, &out);
+        if (res == ELF_OK)
+                res = write_program_headers(ctx, &out);
+
+        for (uint32_t i = 0; (res == ELF_OK) && (i < ctx->Sections.length); i++)
+        {
+                const ElfWSection *sec = elfw_vec_get(&(ctx->Sections), i);
+
+                if ((sec->Type == SHT_NOBITS) || (sec->Type == SHT_NULL))
+                        continue;
+
+                for (uint32_t c = 0; (res == ELF_OK) && (c < sec->Chunks.length); c++)
+                {
+                        const Chunk *chk = elfw_vec_get(&(sec->Chunks), c);
+
+                        res = out_pad(&out, sec->FileOff + chk->offset);
+                        if (res == ELF_OK)
+                                res = (chk->data != NULL) ? out_bytes(&out, chk->data, chk->size) : out_source(&out, chk);
+                }
+
+                /* trailing alignment of the last chunk */
+                if (res == ELF_OK)
+                        res = out_pad(&out, sec->FileOff + sec->Offset);
+        }
+
+        /* section names */
+        if (res == ELF_OK)
+                res = out_pad(&out, lay.ShstrtabOff);
+        if (res == ELF_OK)
+                res = out_bytes(&out, "", 1);
+        for (uint32_t i = 0; (res == ELF_OK) && (i < ctx->Sections.length); i++)
+        {
+                const ElfWSection *sec = elfw_vec_get(&(ctx->Sections), i);
+
+                if (sec->Name[0] != '\0')
+                        res = out_bytes(&out, sec->Name, strlen(sec->Name) + 1);
+        }
+        if (res == ELF_OK)
+                res = out_bytes(&out, shstrtab_name, sizeof(shstrtab_name));
+
+        if (res == ELF_OK)
+                res = out_pad(&out, lay.SecHeadOff);
+        if (res == ELF_OK)
+                res = write_section_headers(ctx, &lay, &out);
+
+        free(out.Buff);
+        return res;
 }
 
 static ElfResult elfw_vec_init(ElfwVec *v)
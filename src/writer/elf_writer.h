@@ -23,7 +23,7 @@
 #ifndef ELFW_LIB
 #define ELFW_LIB
 
-#include "src/common/elf_core.h"
+#include "common/elf_core.h"
 
 /**
  * @brief Library context, holds internal information used by the library between function calls, initialized on elfw_create()
@@ -136,11 +136,24 @@ void elfw_destroy(ElfwCtx *ctx);
          */
         ElfResult elfw_add_section(ElfwCtx *ctx, const ElfwSectionCreateInfo *info, sec_hndl *new_sec);
 
+        /**
+         * @brief Index the section will have in the section header table of the written file.
+         *
+         * The null section takes index 0, sections are numbered in creation order from 1 and the
+         * section name table is added after them. Use it for the Info field of relocation sections
+         * and the SecIdx of symbols.
+         *
+         * @param section   Valid section handle.
+         *
+         * @return Section index, 0 for a NULL handle.
+         */
+        uint32_t elfw_section_index(sec_hndl section);
+
         /**
          * @brief Replaces all previous section data with a single new chunk.
          *
          * @param section   Valid section handle.
-         * @param data      Pointer to the data buffer.
+         * @param data      Pointer to the data buffer, NULL for SHT_NOBITS sections.
          * @param size      Size of the data buffer in bytes.
          * @param align     Required alignment of the chunk within the section. (must be a power of two)
          *
@@ -154,7 +167,7 @@ void elfw_destroy(ElfwCtx *ctx);
          * @brief Appends a data chunk to the section.
          *
          * @param section   Valid section handle.
-         * @param data      Pointer to the data buffer.
+         * @param data      Pointer to the data buffer, NULL for SHT_NOBITS sections.
          * @param size      Size of the data buffer in bytes.
          * @param align     Required alignment of the chunk within the section. (must be a power of two)
          *
@@ -164,6 +177,25 @@ void elfw_destroy(ElfwCtx *ctx);
          */
         ElfResult elfw_section_append_data(sec_hndl section, const void *data, uint64_t size, uint64_t align);
 
+        /**
+         * @brief Appends a chunk whose bytes are produced while the ELF is written.
+         *
+         * The writer calls @p source with offsets relative to the start of the chunk, in increasing
+         * order and in pieces of a few KiB, to fill its buffer right before writing them. This lets
+         * tables far larger than memory (generated or copied from other files) be written without
+         * building them first, the callback has the same signature as the reader's.
+         *
+         * @param section   Valid section handle.
+         * @param source    Callback filling a range of the chunk.
+         * @param user_ctx  Passed back to @p source, NULL if unused.
+         * @param size      Size of the chunk in bytes.
+         * @param align     Required alignment of the chunk within the section. (must be a power of two)
+         *
+         * @return ELF_OK on success, or an error code on failure.
+         */
+        ElfResult elfw_section_append_source(sec_hndl section, elf_read_callback source, void *user_ctx, uint64_t size,
+                                             uint64_t align);
+
         /**
          * @brief Returns the offset where the next chunk would be placed.
          *
@@ -177,10 +209,118 @@ void elfw_destroy(ElfwCtx *ctx);
          */
         uint64_t elfw_section_next_offset(sec_hndl section, uint64_t align);
 
+/****************
+ *   Entries    *
+ ****************/
+        /**
+         * @param ctx  Writer context with a header.
+         *
+         * @return Size of one symbol table entry for the class of the file, 0 without a header.
+         */
+        uint64_t elfw_symbol_entry_size(const ElfwCtx *ctx);
+
+        /**
+         * @param ctx   Writer context with a header.
+         * @param syms  Symbols to encode. Attr selects the special section indexes (STA_ABS, STA_COMMON,
+         *              STA_UNDEF), STA_UNKNOWN writes SecIdx as is and STA_DEFAULT writes the index of
+         *              a section, SHN_XINDEX when it doesn't fit below SHN_LORESERVE.
+         * @param count Number of symbols.
+         * @param out   (out) Buffer of count * elfw_symbol_entry_size() bytes, in the file layout.
+         * @param shndx (out) count entries of the matching SHT_SYMTAB_SHNDX section, in the file layout.
+         *              May be NULL when no symbol needs one.
+         *
+         * @return Error code, ELF_BAD_INDX if a symbol needs an extended index and @p shndx is NULL,
+         *         ELF_BAD_SIZE if a value doesn't fit a 32-bit file.
+         *
+         * @brief Encodes symbols in the class and byte order of the file, the inverse of get_symbol_entries().
+         */
+        ElfResult elfw_encode_symbols(const ElfwCtx *ctx, const ElfSymTabEntry *syms, uint32_t count, void *out,
+                                      uint32_t *shndx);
+
+        /**
+         * @param ctx   Writer context with a header.
+         * @param rela  Non zero for SHT_RELA entries, zero for SHT_REL.
+         *
+         * @return Size of one relocation entry for the class of the file, 0 without a header.
+         */
+        uint64_t elfw_relocation_entry_size(const ElfwCtx *ctx, int rela);
+
+        /**
+         * @param ctx   Writer context with a header.
+         * @param rels  Relocations to encode.
+         * @param count Number of relocations.
+         * @param rela  Non zero to write SHT_RELA entries, zero for SHT_REL ones (the addends are dropped).
+         * @param out   (out) Buffer of count * elfw_relocation_entry_size() bytes, in the file layout.
+         *
+         * @return Error code, ELF_BAD_SIZE if a field doesn't fit a 32-bit file.
+         */
+        ElfResult elfw_encode_relocations(const ElfwCtx *ctx, const ElfRelocation *rels, uint32_t count, int rela,
+                                          void *out);
+
+/****************
+ *    Output    *
+ ****************/
+        /**
+         * @brief callback receiving the bytes of the file, with the same arguments as the reader's one.
+         * Calls are made in increasing offset order without gaps, the padding is written as zeros, so
+         * it can append to a stream and ignore @p offset.
+         */
+        typedef ElfResult (*elfw_write_callback)(
+            void *user_ctx,     // user-provided context (file handle, pointer, etc.)
+            uint64_t offset,    // absolute offset in the "file"
+            uint64_t size,      // number of bytes given
+            const void *buffer  // bytes to write
+        );
+
+        /**
+         * @param ctx       Writer context with a header.
+         * @param user_ctx  Passed back to @p callback, NULL if unused.
+         * @param callback  Receives the file.
+         *
+         * @return Error code, ELF_BAD_HEADER without a header, ELF_BAD_SIZE if the layout doesn't fit
+         *         a 32-bit file, or the first error returned by a callback.
+         *
+         * @brief Lays out and writes the file: the ELF header, the sections in creation order, each
+         * one at an offset aligned to its Alignment, then the section header table. The null section
+         * and the section name table (.shstrtab, the last section) are added by the writer, extended
+         * section numbering is used when there are SHN_LORESERVE sections or more.
+         */
+        ElfResult elfw_write(ElfwCtx *ctx, void *user_ctx, elfw_write_callback callback);
+
+        /**
+         * @param ctx   Writer context.
+         *
+         * @return Size of the file elfw_write() would produce, 0 without a header.
+         */
+        uint64_t elfw_file_size(ElfwCtx *ctx);
+
 /****************
  *   Segments   *
  ****************/
-        //TODO
+        typedef struct
+        {
+                ElfSegmentType Type;
+                uint32_t Flags;         // PF_*
+                uint64_t Alignment;     // Power of two, the page size for PT_LOAD. 0 is the same as 1
+                sec_hndl First;         // First section of the segment
+                sec_hndl Last;          // Last one, the segment covers every section created between both
+        } ElfwSegmentCreateInfo;
+
+        /**
+         * @brief Adds a program header covering a range of sections.
+         *
+         * The segment starts at the Address and file offset of its first section. Its memory size ends
+         * after the last section and its file size after the last one with data, so SHT_NOBITS sections
+         * go at the end. Each section of a PT_LOAD segment is placed at a file offset congruent to its
+         * Address modulo the segment Alignment, give them addresses in creation order with the gaps their
+         * alignments need. The program header table follows the ELF header.
+         *
+         * @param ctx   Valid ELF writer context.
+         * @param info  Segment creation parameters. (copied internally)
+         *
+         * @return ELF_OK on success, ELF_BAD_ARG if the range is empty or reversed.
+         */
+        ElfResult elfw_add_segment(ElfwCtx *ctx, const ElfwSegmentCreateInfo *info);
 
 
 
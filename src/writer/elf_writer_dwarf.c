@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "elf_writer_dwarf.h"
+
+ElfResult elfw_add_dwarf(ElfwCtx *ctx, const DwrfProducer *prod)
+{
+        if ((ctx == NULL) || (prod == NULL))
+                return ELF_BAD_ARG;
+
+        for (int i = 0; i < DWRF_PROD_SECTION_COUNT; i++)
+        {
+                int strings = (i == DWRF_PROD_STR) || (i == DWRF_PROD_LINE_STR);
+                ElfwSectionCreateInfo info = {
+                        .Name = dwarf_producer_section_name((DwrfProducerSection)i),
+                        .Type = SHT_PROGBITS,
+                        .Flags = strings ? (SHF_MERGE | SHF_STRINGS) : 0,
+                        .Address = 0,
+                        .Link = NULL,
+                        .Info = 0,
+                        .Alignment = 1,
+                        .EntrySize = strings ? 1 : 0,
+                };
+                const void *data;
+                uint64_t size;
+                sec_hndl sec;
+                ElfResult res;
+
+                if (dwarf_producer_section(prod, (DwrfProducerSection)i, &data, &size) != DWRF_OK)
+                        return ELF_BAD_ARG;
+                if (size == 0)
+                        continue;
+
+                if (((res = elfw_add_section(ctx, &info, &sec)) != ELF_OK) ||
+                    ((res = elfw_section_append_data(sec, data, size, 1)) != ELF_OK))
+                        return res;
+        }
+        return ELF_OK;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025 Hugo Cebrecos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ELFW_DWARF_LIB
+#define ELFW_DWARF_LIB
+
+#include "writer/elf_writer.h"
+#include "dwarf/dwarf_producer.h"
+
+/**
+ * NOTE: Glue between the DWARF producer and the writer, the only part of either module that
+ * needs the other. Build it with both.
+ */
+
+/***************
+ *    DWARF    *
+ ***************/
+        /**
+         * @param ctx  Writer context, initialized with elfw_create().
+         * @param prod Finished producer (see dwarf_producer_finish()).
+         *
+         * @return Error code, ELF_BAD_ARG if the producer isn't finished.
+         *
+         * @brief Adds one section per non empty section of the producer, each made of a single chunk
+         *        that points into the producer: keep it alive until the file is written.
+         */
+        ElfResult elfw_add_dwarf(ElfwCtx *ctx, const DwrfProducer *prod);
+
+#endif // Include guard;